@@ -0,0 +1,110 @@
+#include "../include/alert_writer.h"
+#include "../include/log_entry.h"
+#include "../include/timestamp.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+/**
+ * Alert output benchmark.
+ *
+ * Writes a storm of alerts to a file, first the way the alerter used to
+ * (localtime + strftime + fprintf + fflush per alert, plus a printf echo
+ * to /dev/null), then through alert_writer with several batch sizes, the
+ * way a file sink's worker drives it, and in each output format.
+ * Reports alerts/s.
+ */
+
+#define BENCH_ALERTS 200000
+#define BENCH_PATH "bench_alerts.log"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// The per-alert path alerter_write_alert used before alert_writer
+static double legacy_write(FILE* echo) {
+    FILE* file = fopen(BENCH_PATH, "w");
+    if (!file) {
+        return 0.0;
+    }
+
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_ALERTS; i++) {
+        char timestamp_str[64];
+        time_t seconds = time(NULL);
+        struct tm* timeinfo = localtime(&seconds);
+        strftime(timestamp_str, sizeof(timestamp_str), "%Y-%m-%d %H:%M:%S", timeinfo);
+        fprintf(file, "[%s] [%s] [%s] %s%s\n", timestamp_str, "ERROR", "logs/app.log",
+                "Failed to process user request 4711", "");
+        fflush(file);
+        fprintf(echo, "[ALERT] [%s] [%s] [%s] %s%s\n", timestamp_str, "ERROR", "logs/app.log",
+                "Failed to process user request 4711", "");
+    }
+    double elapsed = now_seconds() - start;
+    fclose(file);
+    return elapsed;
+}
+
+static int fd_deliver(void* ctx, struct iovec* iov, int count) {
+    return alert_write_fd(*(int*)ctx, iov, count);
+}
+
+static double writer_write(alert_format_t format, size_t buffer_size) {
+    int fd = open(BENCH_PATH, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) {
+        return 0.0;
+    }
+    alert_writer_t writer;
+    if (alert_writer_init(&writer, fd_deliver, &fd, format, NULL, buffer_size, 0) != 0) {
+        close(fd);
+        return 0.0;
+    }
+
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_ALERTS; i++) {
+        int64_t now = timestamp_now();
+        alert_line_t line = {now, LOG_LEVEL_ERROR, "logs/app.log",
+                             "Failed to process \"user\" request 4711", NULL, 17,
+                             LOG_RULE_ID(LOG_RULE_FIELD, 0), 0x5, NULL};
+        alert_writer_append(&writer, &line, now);
+    }
+    alert_writer_close(&writer);
+    double elapsed = now_seconds() - start;
+    alert_writer_destroy(&writer);
+    close(fd);
+    return elapsed;
+}
+
+static void report(const char* name, double seconds) {
+    printf("  %-22s %10.0f alerts/s  %7.1f ns/alert\n", name, BENCH_ALERTS / seconds,
+           seconds * 1e9 / BENCH_ALERTS);
+}
+
+int main(void) {
+    FILE* devnull = fopen("/dev/null", "w");
+    if (!devnull) {
+        return 1;
+    }
+
+    printf("Writing %d alerts\n", BENCH_ALERTS);
+    report("fprintf+fflush", legacy_write(devnull));
+
+    size_t sizes[] = {4096, 65536, 1048576};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "writer %zu KiB", sizes[i] / 1024);
+        report(name, writer_write(ALERT_FORMAT_TEXT, sizes[i]));
+    }
+    report("writer json 64 KiB", writer_write(ALERT_FORMAT_JSON, 65536));
+    report("writer binary 64 KiB", writer_write(ALERT_FORMAT_BINARY, 65536));
+
+    fclose(devnull);
+    remove(BENCH_PATH);
+    return 0;
+}
\ No newline at end of file
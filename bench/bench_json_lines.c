@@ -0,0 +1,83 @@
+#include "../include/json_lines.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * JSON-lines scanner throughput benchmark.
+ *
+ * Scans a synthetic buffer of typical structured log lines and reports
+ * bytes per second for json_lines_scan (level, message, timestamp and two
+ * selected fields extracted, everything else skipped).
+ *
+ * The target is about 1 GB/s on one core for these ~190-byte lines; most of
+ * the time goes to per-line setup and field extraction, not the structural
+ * scan, so short lines do not reach multi-GB/s.
+ */
+
+#define BENCH_LINES 200000
+#define BENCH_ROUNDS 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+    static const char* templates[] = {
+        "{\"ts\":\"2025-12-03T10:15:%02d.123Z\",\"level\":\"info\",\"service\":\"checkout\","
+        "\"msg\":\"request completed\",\"status\":200,\"latency_ms\":%d,"
+        "\"trace\":{\"id\":\"4bf92f3577b34da6a3ce929d0e0e4736\",\"span\":\"00f067aa0ba902b7\"}}",
+        "{\"ts\":\"2025-12-03T10:15:%02d.456Z\",\"level\":\"error\",\"service\":\"payments\","
+        "\"msg\":\"upstream \\\"ledger\\\" timed out\",\"status\":504,\"latency_ms\":%d,"
+        "\"tags\":[\"retry\",\"timeout\"],\"user\":\"u-1842\"}",
+    };
+
+    size_t capacity = (size_t)BENCH_LINES * 320;
+    char* buffer = (char*)malloc(capacity);
+    size_t* offsets = (size_t*)malloc((BENCH_LINES + 1) * sizeof(size_t));
+    if (!buffer || !offsets) {
+        return 1;
+    }
+
+    size_t used = 0;
+    for (int i = 0; i < BENCH_LINES; i++) {
+        offsets[i] = used;
+        used += (size_t)snprintf(buffer + used, capacity - used, templates[i % 2], i % 60, i % 997);
+    }
+    offsets[BENCH_LINES] = used;
+
+    char* fields[] = {"status", "latency_ms"};
+    json_lines_t parser;
+    if (json_lines_init(&parser, NULL, "msg", "ts", fields, 2) != 0) {
+        return 1;
+    }
+
+    double best = 1e9;
+    size_t found = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_LINES; i++) {
+            json_lines_result_t result;
+            if (json_lines_scan(&parser, buffer + offsets[i], offsets[i + 1] - offsets[i], &result) == 0 &&
+                result.fields[1].start) {
+                found++;
+            }
+        }
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    printf("json_lines_scan: %d lines, %.1f MB, best of %d: %.3f s, %.2f GB/s, %.0f ns/line (%zu matched)\n",
+           BENCH_LINES, (double)used / 1e6, BENCH_ROUNDS, best,
+           (double)used / best / 1e9, best * 1e9 / BENCH_LINES, found / BENCH_ROUNDS);
+
+    json_lines_destroy(&parser);
+    free(offsets);
+    free(buffer);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "../include/line_scan.h"
+#include "../include/log_entry.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Line framing and level classification benchmark.
+ *
+ * Frames a synthetic buffer of `[LEVEL] message` lines and resolves each
+ * level, first the way the sources used to (strchr per line, copy the
+ * token, lowercase + strstr chain), then with line_scan() for every block
+ * classifier the CPU supports. Reports ns/byte and GB/s.
+ */
+
+#define BENCH_LINES 200000
+#define BENCH_ROUNDS 5
+
+static const char* LEVELS[] = {"INFO", "DEBUG", "WARNING", "ERROR", "CRITICAL", "warn", "err"};
+static const char* IMPL_NAMES[] = {"avx512", "avx2", "sse2", "scalar"};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// The strstr-based level parser the sources used before the perfect hash
+static log_level_t legacy_parse_level(const char* level_str) {
+    char lower[32];
+    size_t len = strlen(level_str);
+    if (len >= sizeof(lower)) {
+        len = sizeof(lower) - 1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        lower[i] = (char)tolower((unsigned char)level_str[i]);
+    }
+    lower[len] = '\0';
+
+    if (strstr(lower, "debug") || strstr(lower, "dbg")) {
+        return LOG_LEVEL_DEBUG;
+    } else if (strstr(lower, "info")) {
+        return LOG_LEVEL_INFO;
+    } else if (strstr(lower, "warn")) {
+        return LOG_LEVEL_WARNING;
+    } else if (strstr(lower, "error") || strstr(lower, "err")) {
+        return LOG_LEVEL_ERROR;
+    } else if (strstr(lower, "critical") || strstr(lower, "crit") || strstr(lower, "fatal")) {
+        return LOG_LEVEL_CRITICAL;
+    }
+    return LOG_LEVEL_INFO;
+}
+
+static size_t legacy_scan(const char* buf, size_t len, unsigned long* checksum) {
+    size_t lines = 0;
+    const char* p = buf;
+    const char* end = buf + len;
+    while (p < end) {
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        if (!newline) {
+            break;
+        }
+        log_level_t level = LOG_LEVEL_INFO;
+        if (*p == '[') {
+            const char* close = memchr(p, ']', (size_t)(newline - p));
+            if (close) {
+                char token[16];
+                size_t length = (size_t)(close - p - 1);
+                if (length >= sizeof(token)) {
+                    length = sizeof(token) - 1;
+                }
+                memcpy(token, p + 1, length);
+                token[length] = '\0';
+                level = legacy_parse_level(token);
+            }
+        }
+        *checksum += (unsigned long)level + (unsigned long)(newline - p);
+        lines++;
+        p = newline + 1;
+    }
+    return lines;
+}
+
+static size_t vector_scan(const char* buf, size_t len, unsigned long* checksum) {
+    line_span_t spans[LINE_SCAN_BATCH];
+    size_t lines = 0;
+    size_t offset = 0;
+    for (;;) {
+        size_t consumed;
+        size_t count = line_scan(buf + offset, len - offset, spans, LINE_SCAN_BATCH, &consumed);
+        for (size_t i = 0; i < count; i++) {
+            *checksum += (unsigned long)spans[i].level + spans[i].length;
+        }
+        lines += count;
+        offset += consumed;
+        if (count < LINE_SCAN_BATCH) {
+            break;
+        }
+    }
+    return lines;
+}
+
+static void report(const char* name, size_t bytes, size_t lines, double seconds,
+                   unsigned long checksum) {
+    printf("  %-8s %7.3f ns/byte  %6.2f GB/s  %6.1f ns/line  (%zu lines, checksum %lu)\n",
+           name, seconds * 1e9 / (double)bytes, (double)bytes / seconds / 1e9,
+           seconds * 1e9 / (double)lines, lines, checksum);
+}
+
+int main(void) {
+    size_t capacity = (size_t)BENCH_LINES * 160;
+    char* buffer = (char*)malloc(capacity);
+    if (!buffer) {
+        return 1;
+    }
+
+    size_t used = 0;
+    for (int i = 0; i < BENCH_LINES; i++) {
+        if (i % 10 == 9) {
+            used += (size_t)snprintf(buffer + used, capacity - used,
+                                     "plain message without a level, request %d took %d ms\n",
+                                     i, i % 997);
+        } else {
+            used += (size_t)snprintf(buffer + used, capacity - used,
+                                     "[%s] worker-%d handled request %d for tenant %d in %d us\n",
+                                     LEVELS[i % 7], i % 16, i, i % 113, i % 9973);
+        }
+    }
+
+    printf("Framing %d lines (%zu bytes), best of %d rounds\n", BENCH_LINES, used, BENCH_ROUNDS);
+
+    double best = 1e9;
+    size_t lines = 0;
+    unsigned long checksum = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        checksum = 0;
+        double start = now_seconds();
+        lines = legacy_scan(buffer, used, &checksum);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    report("strchr", used, lines, best, checksum);
+
+    for (size_t i = 0; i < sizeof(IMPL_NAMES) / sizeof(IMPL_NAMES[0]); i++) {
+        if (line_scan_force(IMPL_NAMES[i]) != 0) {
+            printf("  %-8s unsupported on this CPU\n", IMPL_NAMES[i]);
+            continue;
+        }
+        best = 1e9;
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            checksum = 0;
+            double start = now_seconds();
+            lines = vector_scan(buffer, used, &checksum);
+            double elapsed = now_seconds() - start;
+            if (elapsed < best) best = elapsed;
+        }
+        report(IMPL_NAMES[i], used, lines, best, checksum);
+    }
+
+    free(buffer);
+    return 0;
+}
\ No newline at end of file
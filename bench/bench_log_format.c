@@ -0,0 +1,130 @@
+#include "../include/log_format.h"
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Compiled format vs. regex benchmark.
+ *
+ * For each built-in format, matches a synthetic buffer of lines with the
+ * compiled matcher and with an equivalent POSIX extended regex extracting
+ * the same captures, and reports ns/line for both.
+ */
+
+#define BENCH_LINES 50000
+#define BENCH_ROUNDS 3
+#define BENCH_MAX_GROUPS 12
+
+typedef struct {
+    const char* format;
+    const char* regex;
+    const char* templates[2];
+} bench_case_t;
+
+static const bench_case_t CASES[] = {
+    {
+        "clf",
+        "^([0-9a-fA-F.:]+) ([^ ]+) ([^ ]+) \\[([^]]+)\\] \"((\\\\.|[^\"\\\\])*)\" ([0-9]+) ([^ ]+)$",
+        {"10.0.%d.%d - - [03/Dec/2025:10:15:%02d +0000] \"GET /index.html HTTP/1.1\" 200 %d",
+         "192.168.%d.%d - alice [03/Dec/2025:10:15:%02d +0000] \"POST /api/data HTTP/1.1\" 500 %d"},
+    },
+    {
+        "combined",
+        "^([0-9a-fA-F.:]+) ([^ ]+) ([^ ]+) \\[([^]]+)\\] \"((\\\\.|[^\"\\\\])*)\" ([0-9]+) ([^ ]+) "
+        "\"((\\\\.|[^\"\\\\])*)\" \"((\\\\.|[^\"\\\\])*)\"$",
+        {"10.0.%d.%d - - [03/Dec/2025:10:15:%02d +0000] \"GET /index.html HTTP/1.1\" 200 %d "
+         "\"https://example.com/\" \"Mozilla/5.0 (X11; Linux x86_64) Firefox/120.0\"",
+         "192.168.%d.%d - alice [03/Dec/2025:10:15:%02d +0000] \"POST /api/data HTTP/1.1\" 500 %d "
+         "\"-\" \"curl/8.4.0\""},
+    },
+    {
+        "rfc3164",
+        "^<([0-9]+)>([A-Z][a-z]{2} [ 0-9][0-9] [0-9]{2}:[0-9]{2}:[0-9]{2}) ([^ ]+) ([^:]*): (.*)$",
+        {"<%1$d>Dec  3 10:15:%3$02d web-%2$d sshd[%4$d]: Accepted publickey for deploy",
+         "<%1$d>Dec  3 10:15:%3$02d db-%2$d postgres[%4$d]: connection to replica lost, retrying"},
+    },
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void run_case(const bench_case_t* bench) {
+    size_t capacity = (size_t)BENCH_LINES * 256;
+    char* buffer = (char*)malloc(capacity);
+    size_t* offsets = (size_t*)malloc((BENCH_LINES + 1) * sizeof(size_t));
+    if (!buffer || !offsets) {
+        free(buffer);
+        free(offsets);
+        return;
+    }
+
+    size_t used = 0;
+    for (int i = 0; i < BENCH_LINES; i++) {
+        offsets[i] = used;
+        used += (size_t)snprintf(buffer + used, capacity - used, bench->templates[i % 2],
+                                 i % 191, i % 251, i % 60, 100 + i % 9000) + 1;
+    }
+    offsets[BENCH_LINES] = used;
+
+    log_format_t format;
+    regex_t regex;
+    if (log_format_builtin(&format, bench->format) != 0) {
+        fprintf(stderr, "%s: no such format\n", bench->format);
+        free(buffer);
+        free(offsets);
+        return;
+    }
+    if (regcomp(&regex, bench->regex, REG_EXTENDED) != 0) {
+        fprintf(stderr, "%s: regex does not compile\n", bench->format);
+        log_format_destroy(&format);
+        free(buffer);
+        free(offsets);
+        return;
+    }
+
+    double best_format = 1e9, best_regex = 1e9;
+    size_t matched_format = 0, matched_regex = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_LINES; i++) {
+            format_span_t spans[LOG_FORMAT_MAX_CAPTURES];
+            const char* line = buffer + offsets[i];
+            matched_format += log_format_match(&format, line, offsets[i + 1] - offsets[i] - 1, spans, NULL);
+        }
+        double elapsed = now_seconds() - start;
+        if (elapsed < best_format) {
+            best_format = elapsed;
+        }
+
+        start = now_seconds();
+        for (int i = 0; i < BENCH_LINES; i++) {
+            regmatch_t groups[BENCH_MAX_GROUPS];
+            matched_regex += regexec(&regex, buffer + offsets[i], BENCH_MAX_GROUPS, groups, 0) == 0;
+        }
+        elapsed = now_seconds() - start;
+        if (elapsed < best_regex) {
+            best_regex = elapsed;
+        }
+    }
+
+    printf("%-9s compiled: %7.0f ns/line (%zu matched)   regex: %7.0f ns/line (%zu matched)   %.1fx\n",
+           bench->format, best_format * 1e9 / BENCH_LINES, matched_format / BENCH_ROUNDS,
+           best_regex * 1e9 / BENCH_LINES, matched_regex / BENCH_ROUNDS, best_regex / best_format);
+
+    regfree(&regex);
+    log_format_destroy(&format);
+    free(offsets);
+    free(buffer);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++) {
+        run_case(&CASES[i]);
+    }
+    return 0;
+}
\ No newline at end of file
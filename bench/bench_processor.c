@@ -0,0 +1,188 @@
+#include "../include/processor.h"
+#include "../include/ingest.h"
+#include "../include/queue.h"
+#include "../include/config.h"
+#include "../include/log_entry.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * End-to-end processor throughput benchmark.
+ *
+ * Producer threads create entries and hand them to the processor, which
+ * evaluates the alert patterns and forwards every entry to the alert
+ * queue, where a drain thread destroys them. One entry in 50 carries a
+ * long message, so pattern matching on it is expensive. Queue mode
+ * reproduces the original design: producers enqueue entries one by one
+ * and every processing thread consumes the shared input queue. Steal
+ * mode submits batches of one source's lines to the work-stealing pool;
+ * shard mode routes them to the thread owning the source. The last runs
+ * also append every entry to a segment store (see log_store.h).
+ */
+
+#define BENCH_ENTRIES 400000
+#define BENCH_PRODUCERS 2
+#define BENCH_BATCH 64
+#define BENCH_PATTERNS 16
+#define BENCH_LONG_MESSAGE 8192
+
+typedef struct {
+    ingest_t* ingest;
+    size_t count;
+    int id;
+} producer_t;
+
+typedef struct {
+    log_queue_t* queue;
+    size_t target;
+    size_t drained;
+} drain_t;
+
+static char g_long_message[BENCH_LONG_MESSAGE];
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void* producer_thread(void* arg) {
+    producer_t* producer = (producer_t*)arg;
+    char source[64];
+    snprintf(source, sizeof(source), "logs/producer-%d.log", producer->id);
+    uint64_t affinity = ingest_affinity(source);
+
+    log_entry_t* batch[BENCH_BATCH];
+    size_t filled = 0;
+    for (size_t i = 0; i < producer->count; i++) {
+        const char* message = (i % 50 == 0) ? g_long_message : "request handled in 12 ms";
+        batch[filled++] = log_entry_create(source, message, LOG_LEVEL_ERROR, message);
+        if (filled == BENCH_BATCH || i + 1 == producer->count) {
+            ingest_submit(producer->ingest, batch, filled, affinity);
+            filled = 0;
+        }
+    }
+    return NULL;
+}
+
+static void* drain_thread(void* arg) {
+    drain_t* drain = (drain_t*)arg;
+    while (drain->drained < drain->target) {
+        log_entry_t* entry = queue_dequeue(drain->queue);
+        if (!entry) {
+            break;
+        }
+        log_entry_destroy(entry);
+        drain->drained++;
+    }
+    return NULL;
+}
+
+static void remove_tree(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* item;
+        while ((item = readdir(dir)) != NULL) {
+            if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+                char child[512];
+                snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+                remove_tree(child);
+            }
+        }
+        closedir(dir);
+    }
+    remove(path);
+}
+
+static void run(const char* name, processor_mode_t mode, int threads, const char* store_dir) {
+    config_t config;
+    config_init_defaults(&config);
+    config.store_dir = store_dir ? strdup(store_dir) : NULL;
+    config.processor_mode = mode;
+    config.num_processing_threads = threads;
+    config.queue_max_size = 10000;
+    config.rule_cache_size = 0;
+    config.alert_patterns = (char**)calloc(BENCH_PATTERNS, sizeof(char*));
+    for (int i = 0; i < BENCH_PATTERNS; i++) {
+        char pattern[32];
+        snprintf(pattern, sizeof(pattern), "no-such-pattern-%d", i);
+        config.alert_patterns[i] = strdup(pattern);
+    }
+    config.num_patterns = BENCH_PATTERNS;
+
+    log_queue_t input_queue;
+    log_queue_t alert_queue;
+    queue_init(&input_queue, config.queue_max_size);
+    queue_init(&alert_queue, config.queue_max_size);
+
+    processor_t processor;
+    if (processor_init(&processor, &input_queue, &alert_queue, &config) != 0 ||
+        processor_start(&processor) != 0) {
+        fprintf(stderr, "%s: failed to start processor\n", name);
+        return;
+    }
+    ingest_t ingest;
+    processor_ingest(&processor, &ingest);
+
+    drain_t drain = {&alert_queue, BENCH_ENTRIES, 0};
+    pthread_t drainer;
+    pthread_create(&drainer, NULL, drain_thread, &drain);
+
+    producer_t producers[BENCH_PRODUCERS];
+    pthread_t producer_threads[BENCH_PRODUCERS];
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_PRODUCERS; i++) {
+        producers[i].ingest = &ingest;
+        producers[i].count = BENCH_ENTRIES / BENCH_PRODUCERS;
+        producers[i].id = i;
+        pthread_create(&producer_threads[i], NULL, producer_thread, &producers[i]);
+    }
+    for (int i = 0; i < BENCH_PRODUCERS; i++) {
+        pthread_join(producer_threads[i], NULL);
+    }
+    pthread_join(drainer, NULL);
+    double elapsed = now_seconds() - start;
+
+    printf("  %-6s %d threads  %8.0f entries/s  (%.3f s)\n", name, threads,
+           (double)BENCH_ENTRIES / elapsed, elapsed);
+
+    queue_shutdown(&input_queue);
+    queue_shutdown(&alert_queue);
+    processor_stop(&processor);
+    queue_destroy(&alert_queue);
+    queue_destroy(&input_queue);
+    processor_destroy(&processor);
+    config_destroy(&config);
+    if (store_dir) {
+        remove_tree(store_dir);
+    }
+}
+
+int main(void) {
+    // Near-misses of every pattern keep strstr from skipping ahead
+    for (size_t i = 0; i + 1 < sizeof(g_long_message); i++) {
+        g_long_message[i] = "no-such-pattern-x "[i % 18];
+    }
+
+    printf("Processing %d entries from %d producers (1 in 50 with a %d-byte message)\n",
+           BENCH_ENTRIES, BENCH_PRODUCERS, BENCH_LONG_MESSAGE);
+    int thread_counts[] = {1, 2, 4};
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        run("queue", PROCESSOR_MODE_QUEUE, thread_counts[i], NULL);
+        run("steal", PROCESSOR_MODE_STEAL, thread_counts[i], NULL);
+        run("shard", PROCESSOR_MODE_SHARD, thread_counts[i], NULL);
+    }
+
+    char store_dir[] = "/tmp/bench_store_XXXXXX";
+    if (mkdtemp(store_dir)) {
+        printf("Storing every entry as well\n");
+        for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+            run("steal", PROCESSOR_MODE_STEAL, thread_counts[i], store_dir);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
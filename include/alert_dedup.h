@@ -0,0 +1,115 @@
+#ifndef ALERT_DEDUP_H
+#define ALERT_DEDUP_H
+
+#include "log_entry.h"
+#include "metrics.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file alert_dedup.h
+ * @brief Alert storm suppression by message fingerprint
+ *
+ * A fingerprint hashes the level, the source class and the message with
+ * numbers, hex identifiers, UUIDs and IPs masked, so
+ * `timeout after 503 ms on 10.0.0.7` and `timeout after 12 ms on
+ * 10.0.0.9` collapse into one. Entries tagged with a mined template (see
+ * template_miner.h) hash the template ID instead of the message. The
+ * first alert of a fingerprint is emitted; repeats within the window are
+ * only counted, and when the window ends the count is emitted as one
+ * summary and a new window starts. A window without repeats retires the
+ * storm, so the next alert is emitted again.
+ *
+ * Fingerprints live in a fixed table of 4-way buckets. When a bucket is
+ * full its least recently seen fingerprint is evicted, after its pending
+ * count is summarized, so memory stays bounded without losing counts.
+ * The table is not thread-safe; the alerter thread owns it.
+ */
+
+#define ALERT_DEDUP_WAYS 4
+#define ALERT_DEDUP_SOURCE_MAX 64
+#define ALERT_DEDUP_SAMPLE_MAX 192
+
+// One tracked fingerprint
+typedef struct {
+    uint64_t fingerprint;
+    bool used;
+    bool storming;              // A window is open
+    int64_t window_start;       // ns
+    int64_t last_seen;          // ns
+    uint64_t repeats;           // Suppressed in the current window
+    log_level_t level;
+    char source[ALERT_DEDUP_SOURCE_MAX];    // First occurrence, truncated
+    char sample[ALERT_DEDUP_SAMPLE_MAX];    // First occurrence's message, truncated
+} alert_dedup_slot_t;
+
+/**
+ * @brief Receives a "repeated N times" summary
+ * @param ctx Callback context
+ * @param slot Fingerprint being summarized
+ * @param repeats Alerts suppressed since the window started
+ * @param elapsed Window length in ns
+ */
+typedef void (*alert_dedup_summary_fn)(void* ctx, const alert_dedup_slot_t* slot,
+                                       uint64_t repeats, int64_t elapsed);
+
+// Fingerprint table
+typedef struct {
+    alert_dedup_slot_t* slots;
+    size_t num_buckets;         // Power of two
+    int64_t window;             // ns
+    alert_dedup_summary_fn summary;
+    void* ctx;
+
+    metric_t* suppressed;
+    metric_t* summaries;
+    metric_t* evictions;
+} alert_dedup_t;
+
+/**
+ * @brief Initialize a table
+ * @param dedup Table to initialize
+ * @param capacity Maximum tracked fingerprints (rounded up to a whole number of buckets)
+ * @param window Window length in ns
+ * @param summary Called for every summary
+ * @param ctx Context passed to the callback
+ * @return 0 on success, -1 on failure
+ */
+int alert_dedup_init(alert_dedup_t* dedup, size_t capacity, int64_t window,
+                     alert_dedup_summary_fn summary, void* ctx);
+
+/**
+ * @brief Destroy a table (pending counts are not summarized)
+ * @param dedup Table to destroy
+ */
+void alert_dedup_destroy(alert_dedup_t* dedup);
+
+/**
+ * @brief Compute the fingerprint of an alert
+ * @param level Level
+ * @param source Source identifier
+ * @param message Message
+ * @return 64-bit fingerprint
+ */
+uint64_t alert_dedup_fingerprint(log_level_t level, const char* source, const char* message);
+
+/**
+ * @brief Decide whether an alert is written
+ * @param dedup Table
+ * @param entry Alert
+ * @param now Current time in ns
+ * @return true to write it, false if it was counted as a repeat
+ */
+bool alert_dedup_admit(alert_dedup_t* dedup, const log_entry_t* entry, int64_t now);
+
+/**
+ * @brief Summarize windows that have ended
+ * @param dedup Table
+ * @param now Current time in ns
+ * @param all Summarize every pending count regardless of the window (shutdown)
+ */
+void alert_dedup_flush(alert_dedup_t* dedup, int64_t now, bool all);
+
+#endif // ALERT_DEDUP_H
+
@@ -0,0 +1,153 @@
+#ifndef ALERT_ENCODER_H
+#define ALERT_ENCODER_H
+
+#include "context_ring.h"
+#include "log_entry.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file alert_encoder.h
+ * @brief Machine-readable alert encodings
+ *
+ * JSON lines: one object per line, e.g.
+ *
+ *     {"ts":1735725600123456789,"level":"ERROR","source":"logs/app.log",
+ *      "source_id":2866427911,"message":"disk \"/var\" full","template_id":12,
+ *      "rule":"rate:2","patterns":[1,3]}
+ *
+ * `ts` is the event time in ns since the epoch. `template_id`, `rule`
+ * (`field:N`, `rate:N` or `sequence:N`, the Nth `alert_rule`, `alert_rate`
+ * or `alert_sequence`) and `patterns` (1-based positions of the matching
+ * `alert_pattern`s) are left out when unset. Strings are escaped per
+ * RFC 8259; other bytes, including invalid UTF-8, pass through. A message
+ * cut to fit the batch buffer adds `"truncated":true`. Alerts with context
+ * (see context_ring.h) carry the raw lines around them in `"before"` and
+ * `"after"` arrays of strings, oldest first.
+ *
+ * Binary: a sequence of length-prefixed records, all integers
+ * little-endian:
+ *
+ *     offset size
+ *          0    4  length of the rest of the record
+ *          4    1  type (1: alert, 2: rate-limit note, 3/4: context line
+ *                  before/after the preceding alert)
+ *          5    1  level (log_level_t)
+ *          6    2  source length
+ *          8    8  timestamp, ns since the epoch (signed)
+ *         16    4  source ID
+ *         20    4  template ID (0: none)
+ *         24    4  rule ID (kind << 24 | position, see LOG_RULE_ID; 0: none)
+ *         28    8  pattern bit set (bit i: the (i+1)th alert_pattern)
+ *         36    4  message length
+ *         40       source bytes, then message bytes
+ *
+ * The message includes any suffix (dedup summaries). The source ID is a
+ * hash of the source string (alert_source_id()), so it is stable across
+ * restarts and lets readers group alerts without comparing strings. A
+ * rate-limit note has an empty source and the note as its message; in
+ * JSON it is `{"ts":...,"note":"rate_limit","skipped":N}`. Context lines
+ * follow their alert as records of their own, with the raw line as the
+ * message and no template, rule or patterns; readers that do not know
+ * the type can skip them by length.
+ */
+
+// Alert output encodings
+typedef enum {
+    ALERT_FORMAT_TEXT = 0,      // `[time] [LEVEL] [source] message`
+    ALERT_FORMAT_JSON = 1,      // JSON lines
+    ALERT_FORMAT_BINARY = 2     // Length-prefixed records
+} alert_format_t;
+
+#define ALERT_BINARY_HEADER 40
+#define ALERT_BINARY_ALERT 1
+#define ALERT_BINARY_NOTE 2
+#define ALERT_BINARY_BEFORE 3
+#define ALERT_BINARY_AFTER 4
+
+// One alert as encoded
+typedef struct {
+    int64_t timestamp;          // ns
+    log_level_t level;
+    const char* source;
+    const char* message;
+    const char* suffix;         // Appended to the message (NULL for none)
+    uint32_t template_id;
+    uint32_t rule_id;
+    uint64_t patterns;
+    const log_context_t* context;   // Surrounding lines (NULL for none)
+} alert_line_t;
+
+/**
+ * @brief Parse a format name
+ * @param text "text", "json" or "binary"
+ * @param format Receives the format
+ * @return 0 on success, -1 if the name is unknown
+ */
+int alert_format_parse(const char* text, alert_format_t* format);
+
+/**
+ * @brief Get the name of a format
+ * @param format Format
+ * @return Name
+ */
+const char* alert_format_to_string(alert_format_t format);
+
+/**
+ * @brief Compute the ID of a source
+ * @param source Source identifier
+ * @return 32-bit hash of the source string
+ */
+uint32_t alert_source_id(const char* source);
+
+/**
+ * @brief Encode an alert as a JSON line (with the newline)
+ *
+ * Writes go straight into the destination and never past size; a line
+ * that does not fit is abandoned, to be encoded again after a flush.
+ *
+ * @param out Destination
+ * @param size Bytes available at out
+ * @param line Alert
+ * @param max_message Longest encoded message in bytes before it is cut
+ *        and marked truncated (SIZE_MAX: never cut)
+ * @return Length of the line, 0 if it does not fit
+ */
+size_t alert_encode_json(char* out, size_t size, const alert_line_t* line, size_t max_message);
+
+/**
+ * @brief Encode a rate-limit note as a JSON line
+ * @param out Destination
+ * @param size Bytes available at out
+ * @param timestamp Time of the note in ns
+ * @param skipped Alerts held back
+ * @return Length of the line, 0 if it does not fit
+ */
+size_t alert_encode_json_note(char* out, size_t size, int64_t timestamp, uint64_t skipped);
+
+/**
+ * @brief Encode the fixed part of a binary record
+ *
+ * The source (cut to the length in the header), message and suffix
+ * follow it as they are.
+ *
+ * @param out Receives ALERT_BINARY_HEADER bytes
+ * @param type ALERT_BINARY_ALERT or ALERT_BINARY_NOTE
+ * @param line Alert (sources longer than 65535 bytes are cut)
+ * @return Length of the whole record (header, source, message and suffix)
+ */
+size_t alert_encode_binary_header(uint8_t* out, int type, const alert_line_t* line);
+
+/**
+ * @brief Encode the fixed part of the binary record of a context line
+ *
+ * The source (cut like the alert's) and the raw line follow it.
+ *
+ * @param out Receives ALERT_BINARY_HEADER bytes
+ * @param line Alert with context
+ * @param index Context line, below line->context->num_lines
+ * @return Length of the whole record
+ */
+size_t alert_encode_binary_context(uint8_t* out, const alert_line_t* line, uint32_t index);
+
+#endif // ALERT_ENCODER_H
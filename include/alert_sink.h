@@ -0,0 +1,151 @@
+#ifndef ALERT_SINK_H
+#define ALERT_SINK_H
+
+#include "alert_writer.h"
+#include "config.h"
+#include "file_rotator.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "sink_spec.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file alert_sink.h
+ * @brief Asynchronous alert destinations
+ *
+ * Every sink owns a bounded queue of alert records and a worker thread
+ * that group-commits them through an alert_writer (see alert_writer.h):
+ * the batch goes out when the queue runs dry, the buffer fills or the
+ * oldest line is `alert_flush_ms` old. Enqueueing never blocks; when the
+ * queue is full the alert is dropped for that sink only and counted, so
+ * a slow or unreachable destination cannot hold up the alerter or the
+ * other sinks.
+ *
+ * A failed delivery keeps the batch and retries it with exponential
+ * backoff (100 ms doubling up to `alert_sink_retry_max_ms`) while new
+ * alerts queue behind it. Socket and HTTP sinks connect lazily and
+ * reconnect after errors; sends and HTTP responses time out after
+ * `alert_sink_timeout_ms`. A batch the destination rejects (an HTTP 4xx
+ * status) is dropped instead of retried, and so is an alert too large to
+ * batch once it is rejected or fails 5 times in a row, so one bad alert
+ * cannot stall the sink. On stop the worker makes one last attempt and
+ * drops whatever cannot be delivered. File sinks rotate their file as
+ * configured by the `alert_rotate_*` keys (see file_rotator.h). Sinks
+ * encode alerts as text, JSON lines or binary records (`format=` or
+ * `alert_format`, see alert_encoder.h); stdout sinks default to text.
+ *
+ * Counters per sink: `alerts.sink.<name>.sent`, `.dropped`, `.suppressed`
+ * (held back by `rate`), `.flushes`, `.failures`, `.retries`; gauge
+ * `.queued`; file sinks add `.rotations`, `.compressed`, `.expired` and
+ * `.rotate_errors`.
+ */
+
+// Alert shared by every sink it is routed to (reference counted)
+typedef struct {
+    int refs;
+    alert_line_t line;          // Strings live in the same allocation
+} alert_record_t;
+
+// Sink structure
+typedef struct {
+    char* name;
+    sink_type_t type;
+    char* target;
+    char* host;                 // TCP and HTTP
+    char* port;
+    char* path;                 // HTTP request path
+
+    alert_record_t** ring;      // Queued records
+    size_t capacity;
+    size_t head;
+    size_t count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    bool running;
+    bool started;
+    bool tick;                  // Rate-limit note may be due
+
+    alert_writer_t writer;      // Batch (worker thread only)
+    file_rotator_t file;        // File sinks
+    int fd;                     // Connection (-1 if none)
+    int64_t flush_ns;           // Longest time a line stays batched
+    int64_t batch_start;        // When the batch got its first line (0: empty)
+    int64_t retry_at;           // Next delivery attempt after a failure (0: none)
+    int64_t retry_delay;        // Current backoff
+    int64_t retry_max;          // Backoff cap
+    int timeout_ms;             // Socket send/receive timeout
+    int attempts;               // Failed deliveries of the next record
+    bool rejected;              // The last failure cannot succeed on retry
+
+    metric_t* sent;
+    metric_t* dropped;
+    metric_t* suppressed;
+    metric_t* flushes;
+    metric_t* failures;
+    metric_t* retries;
+    metric_t* queued;
+} alert_sink_t;
+
+/**
+ * @brief Create an alert record
+ * @param line Alert (strings are copied)
+ * @return Record with one reference, or NULL on failure
+ */
+alert_record_t* alert_record_create(const alert_line_t* line);
+
+/**
+ * @brief Drop a reference to a record (freed with the last one)
+ * @param record Record to release
+ */
+void alert_record_release(alert_record_t* record);
+
+/**
+ * @brief Initialize a sink (files are opened here, sockets on first use)
+ * @param sink Sink to initialize
+ * @param spec Sink declaration (copied)
+ * @param config Configuration (queue, buffer, flush, timeout and retry defaults)
+ * @return 0 on success, -1 on failure
+ */
+int alert_sink_init(alert_sink_t* sink, const sink_spec_t* spec, const config_t* config);
+
+/**
+ * @brief Start the worker thread
+ * @param sink Sink to start
+ * @return 0 on success, -1 on failure
+ */
+int alert_sink_start(alert_sink_t* sink);
+
+/**
+ * @brief Queue a record for delivery without blocking
+ * @param sink Sink
+ * @param record Record (a reference is taken on success)
+ * @return true if queued, false if the queue was full (the alert is dropped)
+ */
+bool alert_sink_enqueue(alert_sink_t* sink, alert_record_t* record);
+
+/**
+ * @brief Have the worker write a pending rate-limit note
+ *
+ * Called from the alerter's periodic tick, so the note goes out after a
+ * storm ends instead of with the next alert. No-op without a `rate`.
+ *
+ * @param sink Sink
+ */
+void alert_sink_tick(alert_sink_t* sink);
+
+/**
+ * @brief Stop the worker after a last delivery attempt
+ * @param sink Sink to stop (also drains a sink that was never started)
+ */
+void alert_sink_stop(alert_sink_t* sink);
+
+/**
+ * @brief Free sink resources (stops the sink first)
+ * @param sink Sink to destroy
+ */
+void alert_sink_destroy(alert_sink_t* sink);
+
+#endif // ALERT_SINK_H
@@ -0,0 +1,141 @@
+#ifndef ALERT_WRITER_H
+#define ALERT_WRITER_H
+
+#include "alert_encoder.h"
+#include "log_entry.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <time.h>
+
+/**
+ * @file alert_writer.h
+ * @brief Group-commit batching of alert lines for one destination
+ *
+ * Lines are formatted by hand into a batch buffer and handed to the
+ * destination with one call per batch (a single writev() for files and
+ * sockets) instead of one fprintf()/fflush() per alert. The formatted
+ * `YYYY-mm-dd HH:MM:SS` string is cached and only rebuilt when the second
+ * changes, so localtime_r() runs at most once a second.
+ *
+ * The owner flushes when it runs out of work; the writer flushes on its
+ * own when the buffer is full. Lines larger than the buffer bypass it and
+ * are delivered from their parts. A failed delivery keeps the batch, so
+ * the owner can retry it later.
+ *
+ * JSON lines and binary records (see alert_encoder.h) are encoded
+ * straight into the batch buffer with no intermediate copy. A JSON line
+ * that cannot fit in an empty buffer has its message cut; a binary record
+ * larger than the buffer is delivered from its parts like a long text line.
+ *
+ * Text writers may prefix every line (`[ALERT] ` on stdout). Writers pass
+ * at most `rate` lines per second; the rest are counted and reported in a
+ * single note with the first line of a later second, at
+ * alert_writer_tick() once that second is over, or at
+ * alert_writer_close(). Not thread-safe: one writer per thread.
+ */
+
+/**
+ * @brief Deliver bytes to a destination
+ * @param ctx Destination context
+ * @param iov Parts to deliver in order (may be modified)
+ * @param count Number of parts
+ * @return 0 once every byte is delivered, -1 on failure
+ */
+typedef int (*alert_deliver_fn)(void* ctx, struct iovec* iov, int count);
+
+// Alert writer
+typedef struct {
+    alert_deliver_fn deliver;
+    void* ctx;
+    alert_format_t format;
+    char* data;                 // Batch buffer
+    size_t used;
+    size_t capacity;
+    size_t lines;               // Lines in the batch
+    const char* prefix;         // Prepended to every line (static string)
+    size_t prefix_len;
+
+    time_t cached_second;       // Second the cached string describes
+    char cached_time[32];       // Formatted cached_second
+    size_t cached_time_len;
+
+    uint64_t rate;              // Lines per second (0: unlimited)
+    time_t rate_second;         // Second the budget applies to
+    uint64_t rate_count;        // Lines passed in rate_second
+    uint64_t rate_skipped;      // Lines held back in rate_second
+} alert_writer_t;
+
+/**
+ * @brief Write every part to a file descriptor, resuming after partial writes
+ * @param fd File descriptor
+ * @param iov Parts (modified)
+ * @param count Number of parts
+ * @return 0 on success, -1 on failure
+ */
+int alert_write_fd(int fd, struct iovec* iov, int count);
+
+/**
+ * @brief Initialize a writer
+ * @param writer Writer to initialize
+ * @param deliver Destination callback
+ * @param ctx Destination context
+ * @param format Encoding
+ * @param prefix Text line prefix (static string, NULL for none)
+ * @param buffer_size Batch buffer size in bytes
+ * @param rate Lines per second (0: unlimited)
+ * @return 0 on success, -1 on failure
+ */
+int alert_writer_init(alert_writer_t* writer, alert_deliver_fn deliver, void* ctx,
+                      alert_format_t format, const char* prefix, size_t buffer_size,
+                      uint64_t rate);
+
+/**
+ * @brief Free a writer (buffered lines are discarded)
+ * @param writer Writer to destroy
+ */
+void alert_writer_destroy(alert_writer_t* writer);
+
+/**
+ * @brief Buffer an alert in the writer's format
+ *
+ * Text lines read `[time] [LEVEL] [source] message<suffix>`, with the
+ * time in local time.
+ *
+ * @param writer Writer
+ * @param line Alert
+ * @param now Current time in ns (for the rate limit)
+ * @return 0 if buffered, 1 if held back by the rate limit (or too large
+ *         to encode at all), -1 if a full batch could not be delivered
+ *         (the alert is not buffered)
+ */
+int alert_writer_append(alert_writer_t* writer, const alert_line_t* line, int64_t now);
+
+/**
+ * @brief Buffer the rate-limit note once its second is over
+ *
+ * Called periodically so the note is not held back until the next alert.
+ *
+ * @param writer Writer
+ * @param now Current time in ns
+ * @return 0 on success, -1 if a full batch could not be delivered (the
+ *         note stays pending)
+ */
+int alert_writer_tick(alert_writer_t* writer, int64_t now);
+
+/**
+ * @brief Deliver the buffered batch
+ * @param writer Writer
+ * @return 0 on success, -1 on failure (the batch is kept)
+ */
+int alert_writer_flush(alert_writer_t* writer);
+
+/**
+ * @brief Buffer the rate-limit note, if any, and deliver the batch
+ * @param writer Writer
+ * @return 0 on success, -1 on failure (the batch is kept)
+ */
+int alert_writer_close(alert_writer_t* writer);
+
+#endif // ALERT_WRITER_H
@@ -4,12 +4,26 @@
 #include "log_entry.h"
 #include "queue.h"
 #include "config.h"
+#include "alert_dedup.h"
+#include "alert_sink.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @file alerter.h
  * @brief Alert generation and output
+ *
+ * With alert_dedup_window set, repeats of an alert are folded into
+ * periodic "repeated N times" lines (see alert_dedup.h).
+ *
+ * Admitted alerts are copied once into a shared record and handed to
+ * every sink they are routed to (see alert_sink.h); each sink delivers
+ * on its own thread, so the alerter never waits for output. Sinks named
+ * in an `alert_route` receive only the alerts matching one of their
+ * routes; the others receive every alert. Without `alert_sink` entries
+ * the alerter writes to `alert_file` and, with `alert_stdout`, to stdout.
  */
 
 // Alerter structure
@@ -18,7 +32,12 @@ typedef struct {
     config_t* config;
     bool running;
     pthread_t thread;
-    FILE* alert_file;
+    alert_sink_t* sinks;           // Output destinations
+    size_t num_sinks;
+    uint64_t* route_sinks;         // Bit set of the sinks each route sends to
+    uint64_t unrouted;             // Sinks named in no route (get every alert)
+    metric_t* written;             // Alerts handed to the sinks
+    alert_dedup_t* dedup;          // Storm suppression (NULL when disabled)
 } alerter_t;
 
 /**
@@ -50,7 +69,7 @@ void alerter_stop(alerter_t* alerter);
 void alerter_destroy(alerter_t* alerter);
 
 /**
- * @brief Write alert to file
+ * @brief Hand an alert to its sinks (delivered by their threads)
  * @param alerter Alerter instance
  * @param entry Log entry to alert on
  */
@@ -0,0 +1,119 @@
+#ifndef AUTOSCALER_H
+#define AUTOSCALER_H
+
+#include "work_pool.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file autoscaler.h
+ * @brief Grows and shrinks the processing pool with the load
+ *
+ * A controller thread samples the pool every interval: entries pending,
+ * the average time batches waited before a worker took them, and the
+ * average and peak utilization of the running workers. One worker is
+ * added after AUTOSCALE_UP_SAMPLES consecutive overloaded samples and
+ * one is retired after AUTOSCALE_DOWN_SAMPLES consecutive idle samples,
+ * always staying within the configured bounds. Samples that are neither
+ * reset both streaks, so the pool does not flap around a threshold.
+ *
+ * Every change is logged and counted in `processor.scale_ups` and
+ * `processor.scale_downs`; `processor.threads`,
+ * `processor.dequeue_wait_us` and `processor.utilization` show the last
+ * sample.
+ */
+
+#define AUTOSCALE_UP_UTILIZATION 75     // Average percent busy to grow
+#define AUTOSCALE_DOWN_UTILIZATION 25   // Peak percent busy to shrink
+#define AUTOSCALE_UP_WAIT_US 5000       // Average dequeue wait to grow
+#define AUTOSCALE_DOWN_WAIT_US 500      // Average dequeue wait to shrink
+#define AUTOSCALE_UP_SAMPLES 2
+#define AUTOSCALE_DOWN_SAMPLES 10
+
+// One observation of the pool
+typedef struct {
+    size_t workers;                 // Running workers
+    size_t pending;                 // Entries waiting to be taken
+    uint64_t wait_us;               // Average dequeue wait since the previous sample
+    unsigned int utilization;       // Average percent busy of running workers
+    unsigned int peak_utilization;  // Busiest running worker
+} autoscale_sample_t;
+
+// Controller state
+typedef struct {
+    work_pool_t* pool;
+    size_t min_workers;
+    size_t max_workers;
+    unsigned int interval_ms;
+
+    pthread_t thread;
+    bool started;
+    bool running;
+    pthread_mutex_t mutex;          // Guards running for the sleeping controller
+    pthread_cond_t wake;
+
+    int up_streak;                  // Consecutive overloaded samples
+    int down_streak;                // Consecutive idle samples
+    uint64_t* last_busy_ns;         // Per worker, at the previous sample
+    uint64_t last_sample_ns;
+    uint64_t last_wait_ns;
+    uint64_t last_waited_batches;
+
+    metric_t* threads;
+    metric_t* scale_ups;
+    metric_t* scale_downs;
+    metric_t* wait_us;
+    metric_t* utilization;
+} autoscaler_t;
+
+/**
+ * @brief Initialize a controller
+ * @param autoscaler Controller to initialize
+ * @param pool Pool to resize
+ * @param min_workers Lower bound (at least 1)
+ * @param max_workers Upper bound (at most the pool's max_workers)
+ * @param interval_ms Time between samples
+ * @return 0 on success, -1 on failure
+ */
+int autoscaler_init(autoscaler_t* autoscaler, work_pool_t* pool, size_t min_workers,
+                    size_t max_workers, unsigned int interval_ms);
+
+/**
+ * @brief Start the controller thread (the pool must be running)
+ * @param autoscaler Controller
+ * @return 0 on success, -1 on failure
+ */
+int autoscaler_start(autoscaler_t* autoscaler);
+
+/**
+ * @brief Stop and join the controller thread; the pool keeps its size
+ * @param autoscaler Controller
+ */
+void autoscaler_stop(autoscaler_t* autoscaler);
+
+/**
+ * @brief Destroy a controller
+ * @param autoscaler Controller
+ */
+void autoscaler_destroy(autoscaler_t* autoscaler);
+
+/**
+ * @brief Observe the pool since the previous sample
+ * @param autoscaler Controller
+ * @param sample Receives the observation
+ */
+void autoscaler_sample(autoscaler_t* autoscaler, autoscale_sample_t* sample);
+
+/**
+ * @brief Feed a sample to the hysteresis and get the worker count to run
+ * @param autoscaler Controller
+ * @param sample Observation
+ * @return Target number of workers
+ */
+size_t autoscaler_decide(autoscaler_t* autoscaler, const autoscale_sample_t* sample);
+
+#endif // AUTOSCALER_H
+
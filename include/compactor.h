@@ -0,0 +1,119 @@
+#ifndef COMPACTOR_H
+#define COMPACTOR_H
+
+#include "config.h"
+#include "log_store.h"
+#include "metrics.h"
+#include "retention_rule.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file compactor.h
+ * @brief Background compaction and retention of stored segments
+ *
+ * Every flush writes one small segment per partition it touches, so a
+ * busy partition collects many of them. Every `store_compact_interval`
+ * seconds a background thread (at the lowest CPU priority):
+ *
+ * 1. enforces the retention rules (see retention_rule.h): lines of a
+ *    source class are expired once the newest line of their segment is
+ *    older than the rule's age, and a class over its size loses its
+ *    oldest segments' lines until it fits. A segment left with no lines
+ *    is deleted; one that keeps some is rewritten without the others.
+ *    A segment's size is shared among classes by their bytes of lines.
+ * 2. merges runs of adjacent segments of one partition (in ID order) that
+ *    are each smaller than half of `store_compact_size`, as long as the
+ *    result stays within `store_compact_size`. Rows are merged by time
+ *    and the merged segment gets a new ID, dictionary and token index.
+ *
+ * A rewritten segment lists the IDs it replaces (see segment.h), so the
+ * inputs of a rewrite interrupted by a crash are removed at the next
+ * start instead of being read twice. Reads and writes are paced to
+ * `store_compact_rate` bytes per second so that compaction never takes
+ * the disk from ingestion or queries. Merging holds the input lines in
+ * memory, at most about the raw size of one `store_compact_size` segment.
+ */
+
+#define COMPACTOR_MAX_RULES 32
+
+// Bytes of one segment's lines per retention rule, kept across passes
+typedef struct {
+    uint64_t id;
+    uint64_t total;             // All rows: line bytes plus one per row
+    uint64_t* bytes;            // Per rule, the same way
+} compactor_usage_t;
+
+// Compactor structure
+typedef struct {
+    log_store_t* store;
+    const retention_rule_t* rules; // Not owned
+    size_t num_rules;
+    uint64_t compact_size;      // Bytes (0: no merging)
+    int64_t interval;           // ns between passes
+    uint64_t rate;              // Bytes per second (0: no limit)
+
+    compactor_usage_t* usage;   // By segment ID
+    size_t num_usage;
+    int64_t paced_since;        // Start of the current pass (monotonic ns)
+    uint64_t paced_bytes;       // Bytes read and written since
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    bool running;
+    bool started;
+
+    metric_t* passes;
+    metric_t* merges;
+    metric_t* merged_segments;
+    metric_t* bytes_read;
+    metric_t* bytes_written;
+    metric_t* pending;
+    metric_t* write_amplification;
+    metric_t* expired_segments;
+    metric_t* rewritten_segments;
+    metric_t* expired_rows;
+    metric_t* errors;
+} compactor_t;
+
+/**
+ * @brief Initialize a compactor
+ * @param compactor Compactor to initialize
+ * @param store Store to compact (not owned)
+ * @param config Configuration (store_compact_* keys and retention rules, which must
+ *               outlive the compactor)
+ * @return 0 on success, -1 on failure
+ */
+int compactor_init(compactor_t* compactor, log_store_t* store, const config_t* config);
+
+/**
+ * @brief Start the background thread
+ * @param compactor Compactor
+ * @return 0 on success, -1 on failure
+ */
+int compactor_start(compactor_t* compactor);
+
+/**
+ * @brief Stop the background thread (a merge in progress is finished first)
+ * @param compactor Compactor
+ */
+void compactor_stop(compactor_t* compactor);
+
+/**
+ * @brief Stop a compactor and free its resources
+ * @param compactor Compactor to destroy
+ */
+void compactor_destroy(compactor_t* compactor);
+
+/**
+ * @brief Run one retention and compaction pass on the calling thread
+ * @param compactor Compactor
+ * @param now Current time in ns (retention ages are measured from it)
+ * @return 0 on success, -1 if some segment could not be rewritten
+ */
+int compactor_run(compactor_t* compactor, int64_t now);
+
+#endif // COMPACTOR_H
@@ -2,6 +2,11 @@
 #define CONFIG_H
 
 #include "log_entry.h"
+#include "field_rule.h"
+#include "rate_rule.h"
+#include "retention_rule.h"
+#include "sequence_rule.h"
+#include "sink_spec.h"
 #include <stdbool.h>
 
 /**
@@ -9,6 +14,13 @@
  * @brief Configuration management
  */
 
+// How processing threads receive entries
+typedef enum {
+    PROCESSOR_MODE_STEAL = 0,      // Per-worker batch deques with work stealing
+    PROCESSOR_MODE_QUEUE,          // All threads consume one shared input queue
+    PROCESSOR_MODE_SHARD           // Each thread owns a fixed set of sources
+} processor_mode_t;
+
 // Configuration structure
 typedef struct {
     // File monitoring
@@ -23,15 +35,112 @@ typedef struct {
     // Processing
     size_t queue_max_size;         // Maximum queue size
     int num_processing_threads;    // Number of processing threads
+    int min_processing_threads;    // Autoscaling lower bound (0: num_processing_threads)
+    int max_processing_threads;    // Autoscaling upper bound (0: num_processing_threads)
+    int autoscale_interval_ms;     // Time between autoscaling samples
+    processor_mode_t processor_mode; // How entries reach processing threads
+    bool processor_affinity;       // Keep a source's batches on one worker (steal mode)
+    int shard_rebalance_interval;  // Seconds between shard rebalances (0 disables)
     
     // Alerting
     bool enable_alerts;            // Enable alerting
     char* alert_file;              // File to write alerts to
+    size_t alert_buffer_size;      // Bytes of alert lines batched per write
+    int alert_flush_ms;            // Longest time an alert line stays buffered
+    alert_format_t alert_format;   // Encoding of sinks without a format option
+    bool alert_stdout;             // Echo alerts to stdout
+    size_t alert_stdout_rate;      // Alerts echoed per second (0 for unlimited)
     log_level_t alert_threshold;   // Minimum level to alert on
+    int alert_dedup_window;        // Seconds repeats are folded into one summary (0 disables)
+    size_t alert_dedup_capacity;   // Fingerprints tracked for dedup
+    sink_spec_t* alert_sinks;      // Output destinations (file/stdout defaults if none)
+    size_t num_alert_sinks;        // Number of sinks
+    sink_route_t* alert_routes;    // Which alerts go to which sinks
+    size_t num_alert_routes;       // Number of routes
+    size_t alert_sink_queue;       // Alerts queued per sink before dropping
+    int alert_sink_timeout_ms;     // Socket send/receive timeout
+    int alert_sink_retry_max_ms;   // Longest backoff between delivery attempts
+    size_t alert_rotate_size;      // Bytes after which alert files rotate (0 disables)
+    int alert_rotate_interval;     // Seconds after which alert files rotate (0 disables)
+    size_t alert_rotate_keep;      // Rotated alert files kept (0 keeps all)
+    int alert_rotate_max_age;      // Seconds rotated alert files are kept (0 keeps all)
+    bool alert_rotate_compress;    // gzip rotated alert files (needs zlib)
+    size_t alert_context_before;   // Preceding lines attached to alerts (see context_ring.h)
+    size_t alert_context_after;    // Following lines attached to alerts
+    size_t alert_context_buffer;   // Bytes of recent lines kept per source
+    size_t alert_context_memory;   // Bytes of recent lines kept across all sources
+    int alert_context_wait_ms;     // Longest an alert waits for its following lines
     
     // Pattern detection
     char** alert_patterns;         // Patterns to alert on
     size_t num_patterns;           // Number of patterns
+    field_rule_t* field_rules;     // Structured rules over extracted fields
+    size_t num_field_rules;        // Number of field rules
+    size_t rule_cache_size;        // Cached rule results (0 disables the cache)
+    rate_rule_t* rate_rules;       // Windowed count/rate rules
+    size_t num_rate_rules;         // Number of rate rules
+    size_t alert_rate_capacity;    // Live (rule, source) counters for rate rules
+    sequence_rule_t* sequence_rules; // "A followed by B within T" rules
+    size_t num_sequence_rules;     // Number of sequence rules
+    size_t alert_sequence_capacity; // Open partial matches for sequence rules
+    
+    // Template mining (see template_miner.h)
+    bool template_mining;          // Tag entries with mined message templates
+    size_t template_capacity;      // Maximum templates kept
+    int template_depth;            // Leading tokens in a parse tree path
+    double template_similarity;    // Share of equal tokens needed to join a template
+    char* template_file;           // Templates kept across restarts (NULL disables)
+    
+    // Streaming sketches (see stream_stats.h)
+    bool sketches;                 // Track heavy hitters and cardinalities
+    size_t sketch_top_k;           // Heaviest sources/templates kept
+    size_t sketch_width;           // Count-Min counters per row
+    size_t sketch_depth;           // Count-Min rows
+    int sketch_precision;          // HyperLogLog register index bits
+    char** sketch_fields;          // Fields whose distinct values are counted
+    size_t num_sketch_fields;      // Number of counted fields
+    int sketch_interval;           // Seconds between shard merges
+    char* sketch_file;             // Periodic dump (NULL disables)
+    
+    // Segment store (see log_store.h)
+    char* store_dir;               // Directory of stored segments (NULL disables)
+    size_t store_memtable_size;    // Unflushed bytes that trigger a flush
+    int store_flush_ms;            // Longest time a line stays unflushed
+    int store_partition;           // Seconds of event time per partition
+    size_t store_compact_size;     // Largest segment compaction builds (0 disables)
+    int store_compact_interval;    // Seconds between compaction and retention passes
+    size_t store_compact_rate;     // Compaction bytes read and written per second (0: no limit)
+    retention_rule_t* retention_rules; // Age and size limits per source class
+    size_t num_retention_rules;    // Number of retention rules
+    char* query_socket;            // Unix socket answering queries (NULL disables)
+    int query_threads;             // Scan threads per query besides the caller
+    size_t query_cache_size;       // Bytes of cached per-segment results (0 disables)
+    
+    // Structured (JSON-lines) parsing
+    bool json_lines;               // Parse lines starting with '{' as JSON
+    char* json_level_keys;         // Comma-separated keys holding the level
+    char* json_message_keys;       // Comma-separated keys holding the message
+    char* json_timestamp_keys;     // Comma-separated keys holding the timestamp
+    char** json_fields;            // Extra keys copied into entry fields
+    size_t num_json_fields;        // Number of extra keys
+    
+    // Declarative line formats
+    char** log_format_names;       // Custom format names
+    char** log_format_specs;       // Custom format specs (see log_format.h)
+    size_t num_log_formats;        // Number of custom formats
+    char** source_format_globs;    // Source globs with an assigned format
+    char** source_format_names;    // Format assigned to each glob
+    size_t num_source_formats;     // Number of assignments
+    
+    // Source filters (applied where lines are read, see pushdown.h)
+    char** source_include_globs;   // Only sources matching one of these alert
+    size_t num_source_includes;    // Number of include globs
+    char** source_exclude_globs;   // Sources matching any of these never alert
+    size_t num_source_excludes;    // Number of exclude globs
+    
+    // Metrics
+    char* metrics_file;            // File to dump metrics to (NULL disables)
+    int metrics_interval_seconds;  // How often to dump metrics
 } config_t;
 
 /**
@@ -0,0 +1,179 @@
+#ifndef CONTEXT_RING_H
+#define CONTEXT_RING_H
+
+#include "log_entry.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file context_ring.h
+ * @brief Recent lines per source, attached to alerts as context
+ *
+ * Every source has a fixed-size byte ring of its latest raw lines. A line
+ * is stored as a varint of its length and level, a zigzag varint of its
+ * timestamp delta to the previous line and the raw bytes; new lines
+ * overwrite the oldest ones in place, so a ring never grows or
+ * reallocates. Lines longer than a quarter of the ring are cut.
+ *
+ * An alerting entry is held until `after` more lines of its source have
+ * been recorded, or until the wait runs out (a background thread checks
+ * every CONTEXT_RING_TICK_NS), and then released with up to `before`
+ * preceding and `after` following lines attached (log_entry_t.context).
+ * Lines the ring has already overwritten are left out.
+ *
+ * Rings are spread over up to CONTEXT_RING_STRIPES independently locked
+ * stripes, each with its share of the memory limit. A stripe that needs a
+ * ring for a new source while at its share reuses the one of its least
+ * recently recorded source, releasing that source's held alerts first.
+ */
+
+#define CONTEXT_RING_STRIPES 16
+#define CONTEXT_RING_TICK_NS 100000000LL  // Thread period (100 ms)
+#define CONTEXT_RING_MAX_LINES 64         // Most lines on either side of an alert
+
+// One line around an alerting entry
+typedef struct {
+    int64_t timestamp;      // Event time in ns
+    uint32_t offset;        // Raw line position from the start of the context
+    uint32_t length;        // Raw line length (not NUL-terminated)
+    log_level_t level;
+} log_context_line_t;
+
+// Lines recorded around an entry; one self-contained allocation, so it
+// can be copied as a block
+typedef struct log_context {
+    size_t size;            // Bytes in the allocation, lines included
+    uint32_t num_before;    // Lines preceding the entry, oldest first
+    uint32_t num_lines;     // num_before plus the lines that followed it
+    log_context_line_t lines[];
+} log_context_t;
+
+#define LOG_CONTEXT_TEXT(context, i) ((const char*)(context) + (context)->lines[i].offset)
+
+/**
+ * @brief Called with a released alert (outside the stripe lock)
+ * @param ctx Callback context
+ * @param entry Alert, context attached if any (ownership is passed on)
+ */
+typedef void (*context_ring_release_fn)(void* ctx, log_entry_t* entry);
+
+struct context_hold;
+struct context_source;
+
+// Independently locked part of the sources
+typedef struct {
+    pthread_mutex_t mutex;
+    struct context_source** table;      // Hash chains
+    size_t table_mask;
+    struct context_source* newest;      // LRU list, most recently recorded first
+    struct context_source* oldest;
+    size_t num_sources;
+    size_t max_sources;
+    size_t held;                        // Alerts waiting in this stripe
+    uint64_t base;                      // First position of a new source's ring
+} context_stripe_t;
+
+// Rings for all sources
+typedef struct {
+    context_stripe_t* stripes;
+    size_t num_stripes;
+    size_t before;
+    size_t after;
+    size_t ring_size;                   // Bytes per source
+    int64_t wait;                       // ns an alert waits for following lines
+    context_ring_release_fn release;
+    void* ctx;
+    size_t num_sources;                 // Rings in use
+    size_t num_held;                    // Alerts waiting for following lines
+
+    bool running;
+    bool started;
+    pthread_t thread;
+    pthread_mutex_t mutex;              // Guards running for the timed wait
+    pthread_cond_t wake;
+
+    metric_t* sources;
+    metric_t* held;
+    metric_t* evictions;
+    metric_t* expired;
+} context_ring_t;
+
+/**
+ * @brief Initialize the rings
+ * @param ring Rings to initialize
+ * @param before Preceding lines attached to an alert (at most CONTEXT_RING_MAX_LINES)
+ * @param after Following lines attached to an alert (at most CONTEXT_RING_MAX_LINES)
+ * @param ring_size Bytes of lines kept per source
+ * @param memory Bytes kept across all sources (at least one ring)
+ * @param wait_ms Longest an alert waits for its following lines
+ * @param release Called with every held alert once it is complete
+ * @param ctx Context passed to the callback
+ * @return 0 on success, -1 on failure
+ */
+int context_ring_init(context_ring_t* ring, size_t before, size_t after, size_t ring_size,
+                      size_t memory, int wait_ms, context_ring_release_fn release, void* ctx);
+
+/**
+ * @brief Start the thread that releases alerts whose wait ran out
+ * @param ring Rings
+ * @return 0 on success, -1 on failure
+ */
+int context_ring_start(context_ring_t* ring);
+
+/**
+ * @brief Stop the thread and release every held alert
+ * @param ring Rings
+ */
+void context_ring_stop(context_ring_t* ring);
+
+/**
+ * @brief Destroy the rings (held alerts are released first)
+ * @param ring Rings to destroy
+ */
+void context_ring_destroy(context_ring_t* ring);
+
+/**
+ * @brief Record an entry's raw line in its source's ring (thread-safe)
+ *
+ * Alerts of the source that now have all their following lines are
+ * released before this returns.
+ *
+ * @param ring Rings
+ * @param entry Log entry (not retained)
+ * @return Position of the line in its source (pass to context_ring_hold())
+ */
+uint64_t context_ring_record(context_ring_t* ring, const log_entry_t* entry);
+
+/**
+ * @brief Hold an alert until its following lines are recorded (thread-safe)
+ *
+ * Without following lines to wait for the alert is released right away.
+ *
+ * @param ring Rings
+ * @param entry Recorded alerting entry (ownership is taken)
+ * @param position Value context_ring_record() returned for the entry
+ * @param now Current time in ns
+ */
+void context_ring_hold(context_ring_t* ring, log_entry_t* entry, uint64_t position, int64_t now);
+
+/**
+ * @brief Attach the latest lines of the entry's source (thread-safe)
+ *
+ * For alerts that do not stand for a recorded line, e.g. rate alerts.
+ *
+ * @param ring Rings
+ * @param entry Alert to attach up to `before` lines to
+ */
+void context_ring_attach(context_ring_t* ring, log_entry_t* entry);
+
+/**
+ * @brief Release every held alert whose wait has run out (thread-safe)
+ * @param ring Rings
+ * @param now Current time in ns
+ */
+void context_ring_advance(context_ring_t* ring, int64_t now);
+
+#endif // CONTEXT_RING_H
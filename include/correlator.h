@@ -0,0 +1,160 @@
+#ifndef CORRELATOR_H
+#define CORRELATOR_H
+
+#include "log_entry.h"
+#include "sequence_rule.h"
+#include "timer_wheel.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file correlator.h
+ * @brief Per-source state machines for sequence rules
+ *
+ * Every (rule, source) pair with a partial match holds one state: the
+ * next step it waits for and when the first step happened. An entry that
+ * matches the awaited step advances it; one that matches the first step
+ * while only the first step has happened restarts the window, so "A
+ * followed by B" is measured from the latest A. A completed sequence is
+ * reported and its state freed. An absence rule whose last step arrives
+ * is freed quietly.
+ *
+ * Windows are measured in event time (the entries' timestamps), so a
+ * backlog replayed in seconds or a queue running behind judges steps by
+ * when they were written, not when they were processed. A step past the
+ * window ends the state: a sequence is dropped, an absence rule reported.
+ *
+ * States also expire on the wall clock through a timing wheel (see
+ * timer_wheel.h), for sources that go quiet: at the event deadline plus
+ * the source's lag (wall clock minus event time at its latest step). A
+ * background thread advances the wheels, so absence rules fire even when
+ * no more entries arrive.
+ *
+ * States are keyed by rule and source class; a hash collision between
+ * two sources is told apart by the stored source.
+ *
+ * States come from a fixed pool sized at init, spread over
+ * CORRELATOR_STRIPES independently locked stripes. When a stripe is full
+ * the state closest to its deadline is evicted.
+ */
+
+#define CORRELATOR_STRIPES 16
+#define CORRELATOR_TICK_NS 100000000LL     // Wheel tick and thread period (100 ms)
+#define CORRELATOR_SOURCE_MAX 128
+
+// Partial match for one (rule, source) pair
+typedef struct correlation_state {
+    timer_wheel_timer_t timer;          // Fires at deadline + lag (wall clock)
+    struct correlation_state* hash_next; // Chain in the stripe table (or free/fired list)
+    uint64_t key;
+    int64_t started;                    // Event time of the first step, ns
+    int64_t deadline;                   // Event time, ns
+    int64_t lag;                        // Wall clock minus event time at the latest step
+    uint32_t rule;
+    uint32_t step;                      // Next step awaited
+    uint32_t source_len;                // Of the whole source class
+    char source[CORRELATOR_SOURCE_MAX]; // Source class (truncated), for lookups and alerts
+} correlation_state_t;
+
+// Independently locked part of the key space
+typedef struct {
+    pthread_mutex_t mutex;
+    correlation_state_t* states;        // Pool
+    correlation_state_t* free_list;
+    correlation_state_t** table;        // Hash chains
+    size_t table_mask;
+    timer_wheel_t wheel;
+} correlation_stripe_t;
+
+/**
+ * @brief Called when a rule matches (outside the stripe lock)
+ * @param ctx Callback context
+ * @param rule Rule that matched
+ * @param source Source of the entries (the source class for absence rules)
+ * @param level Level of the completing entry (WARNING for absence rules)
+ * @param elapsed Event time from the first step to the match, ns
+ */
+typedef void (*correlator_alert_fn)(void* ctx, const sequence_rule_t* rule, const char* source,
+                                    log_level_t level, int64_t elapsed);
+
+// Correlator for a set of rules
+typedef struct {
+    const sequence_rule_t* rules;       // Not owned
+    size_t num_rules;
+    correlation_stripe_t* stripes;
+    size_t open;                        // States in use
+    correlator_alert_fn alert;
+    void* ctx;
+
+    bool running;
+    bool started;
+    pthread_t thread;
+    pthread_mutex_t mutex;              // Guards running for the timed wait
+    pthread_cond_t wake;
+
+    metric_t* open_gauge;
+    metric_t* matched;
+    metric_t* expired;
+    metric_t* evictions;
+} correlator_t;
+
+/**
+ * @brief Initialize a correlator
+ * @param correlator Correlator to initialize
+ * @param rules Rules (must outlive the correlator)
+ * @param num_rules Number of rules
+ * @param capacity Maximum open partial matches across all rules and sources
+ * @param alert Called whenever a rule matches
+ * @param ctx Context passed to the callback
+ * @param now Current wall-clock time in ns
+ * @return 0 on success, -1 on failure
+ */
+int correlator_init(correlator_t* correlator, const sequence_rule_t* rules, size_t num_rules,
+                    size_t capacity, correlator_alert_fn alert, void* ctx, int64_t now);
+
+/**
+ * @brief Start the thread that expires states on the coarse clock
+ * @param correlator Correlator
+ * @return 0 on success, -1 on failure
+ */
+int correlator_start(correlator_t* correlator);
+
+/**
+ * @brief Stop the expiry thread
+ * @param correlator Correlator
+ */
+void correlator_stop(correlator_t* correlator);
+
+/**
+ * @brief Destroy a correlator (open partial matches are dropped)
+ * @param correlator Correlator to destroy
+ */
+void correlator_destroy(correlator_t* correlator);
+
+/**
+ * @brief Feed an entry to every rule with a step it matches (thread-safe)
+ * @param correlator Correlator
+ * @param entry Log entry (not retained); windows use its timestamp
+ * @param now Current wall-clock time in ns, for expiry
+ */
+void correlator_observe(correlator_t* correlator, log_entry_t* entry, int64_t now);
+
+/**
+ * @brief Expire every state whose wall-clock deadline has passed (thread-safe)
+ * @param correlator Correlator
+ * @param now Current wall-clock time in ns
+ */
+void correlator_advance(correlator_t* correlator, int64_t now);
+
+/**
+ * @brief Get the number of open partial matches
+ * @param correlator Correlator
+ * @return States in use
+ */
+size_t correlator_open(const correlator_t* correlator);
+
+#endif // CORRELATOR_H
+
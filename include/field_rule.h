@@ -0,0 +1,61 @@
+#ifndef FIELD_RULE_H
+#define FIELD_RULE_H
+
+#include "log_entry.h"
+#include <stdbool.h>
+
+/**
+ * @file field_rule.h
+ * @brief Structured alert rules over extracted log fields
+ *
+ * Rules have the form `<field><op><value>`, e.g. `status>=500`,
+ * `latency_ms>1000`, `user==admin` or `path~/api/`. A bare field name
+ * matches entries that carry the field. Fields are extracted lazily, so
+ * entries dropped before rule evaluation are never tokenized.
+ */
+
+// Rule comparison operators
+typedef enum {
+    FIELD_OP_EXISTS = 0,   // field
+    FIELD_OP_EQ,           // field==value (or field=value)
+    FIELD_OP_NE,           // field!=value
+    FIELD_OP_LT,           // field<value
+    FIELD_OP_LE,           // field<=value
+    FIELD_OP_GT,           // field>value
+    FIELD_OP_GE,           // field>=value
+    FIELD_OP_CONTAINS      // field~value
+} field_op_t;
+
+// Field rule structure
+typedef struct {
+    char* field;           // Field name
+    field_op_t op;         // Comparison operator
+    char* value;           // Right-hand side as text
+    double number;         // Right-hand side as number (if numeric)
+    bool numeric;          // Whether value parsed completely as a number
+} field_rule_t;
+
+/**
+ * @brief Parse a rule expression
+ * @param rule Rule to populate
+ * @param text Rule text, e.g. "status>=500"
+ * @return 0 on success, -1 on invalid syntax
+ */
+int field_rule_parse(field_rule_t* rule, const char* text);
+
+/**
+ * @brief Free rule resources
+ * @param rule Rule to free
+ */
+void field_rule_destroy(field_rule_t* rule);
+
+/**
+ * @brief Evaluate a rule against an entry (extracts the field on demand)
+ * @param rule Rule to evaluate
+ * @param entry Log entry
+ * @return true if the rule matches, false otherwise
+ */
+bool field_rule_matches(const field_rule_t* rule, log_entry_t* entry);
+
+#endif // FIELD_RULE_H
+
@@ -0,0 +1,99 @@
+#ifndef FILE_ROTATOR_H
+#define FILE_ROTATOR_H
+
+#include "config.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/**
+ * @file file_rotator.h
+ * @brief Size- and time-based rotation of an append-only output file
+ *
+ * The writer checks before each batch whether the file has reached
+ * `alert_rotate_size` bytes or is `alert_rotate_interval` seconds old. If
+ * so it renames the file to `<path>.<YYYYmmdd-HHMMSS>` (with a `.N`
+ * suffix if that name is taken) and opens a new one. Rename and reopen
+ * are the only work done on the writer's thread: nothing is copied or
+ * truncated, so no line is lost, unlike an external copytruncate. An
+ * idle file is rotated by its next write.
+ *
+ * Rotated files are handed to a background thread running at the lowest
+ * CPU priority, which gzips them (`alert_rotate_compress`, when built
+ * with zlib) and then removes rotated files beyond `alert_rotate_keep`
+ * or older than `alert_rotate_max_age` seconds. The thread is started by
+ * the first rotation. Retention also runs once when the file is opened, so
+ * files from earlier runs expire even if nothing is written. Not
+ * thread-safe apart from that thread: one writer.
+ */
+
+#define FILE_ROTATOR_PENDING 16
+
+// Rotated file
+typedef struct {
+    char* path;                 // Output file
+    int fd;                     // Current file (-1 if closed)
+    uint64_t size;              // Bytes in the current file
+    int64_t opened_at;          // When the current file was started (ns)
+    int64_t retry_at;           // No rotation attempt before this after a failure
+
+    uint64_t max_size;          // Rotate at this size (0: never)
+    int64_t interval;           // Rotate after this long (ns, 0: never)
+    size_t keep;                // Rotated files kept (0: all)
+    int64_t max_age;            // Rotated files removed after this long (ns, 0: never)
+    bool compress;              // gzip rotated files
+
+    // Background compression and retention
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool running;
+    bool started;
+    char* pending[FILE_ROTATOR_PENDING]; // Rotated files to compress
+    size_t num_pending;
+
+    metric_t* rotations;
+    metric_t* compressed;
+    metric_t* expired;
+    metric_t* errors;
+} file_rotator_t;
+
+/**
+ * @brief Open (append to) a file with the configured rotation policy
+ * @param rotator Rotator to initialize
+ * @param name Metric name prefix (`<name>.rotations`, ...)
+ * @param path File path
+ * @param config Configuration (alert_rotate_* keys)
+ * @return 0 on success, -1 on failure
+ */
+int file_rotator_open(file_rotator_t* rotator, const char* name, const char* path,
+                      const config_t* config);
+
+/**
+ * @brief Write every part, rotating first if the policy says so
+ * @param rotator Rotator
+ * @param iov Parts (modified)
+ * @param count Number of parts
+ * @param now Current time in ns
+ * @return 0 on success, -1 on failure
+ */
+int file_rotator_write(file_rotator_t* rotator, struct iovec* iov, int count, int64_t now);
+
+/**
+ * @brief Rotate now, whatever the policy
+ * @param rotator Rotator
+ * @param now Current time in ns
+ * @return 0 on success, -1 on failure (writing continues to the old file)
+ */
+int file_rotator_rotate(file_rotator_t* rotator, int64_t now);
+
+/**
+ * @brief Close the file after finishing pending compression and retention
+ * @param rotator Rotator to close
+ */
+void file_rotator_close(file_rotator_t* rotator);
+
+#endif // FILE_ROTATOR_H
@@ -0,0 +1,29 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file hash.h
+ * @brief Fast non-cryptographic 64-bit hashing
+ */
+
+/**
+ * @brief Hash a byte range
+ * @param data Bytes to hash
+ * @param len Number of bytes
+ * @param seed Seed (use different seeds for independent hash functions)
+ * @return 64-bit hash value
+ */
+uint64_t hash64(const void* data, size_t len, uint64_t seed);
+
+/**
+ * @brief Mix a 64-bit value into a well-distributed 64-bit hash
+ * @param value Value to mix
+ * @return Mixed value
+ */
+uint64_t hash64_mix(uint64_t value);
+
+#endif // HASH_H
+
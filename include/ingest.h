@@ -0,0 +1,58 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "log_entry.h"
+#include "queue.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file ingest.h
+ * @brief Destination for entries produced by log sources
+ *
+ * Sources hand over the entries of one framed buffer at a time, tagged
+ * with an affinity derived from the source, so the processor can
+ * distribute whole batches instead of taking a queue lock per entry.
+ */
+
+// Submit callback; takes ownership of the entries even on failure
+typedef int (*ingest_submit_fn)(void* ctx, log_entry_t** entries, size_t count,
+                                uint64_t affinity);
+
+// Entry sink
+typedef struct {
+    ingest_submit_fn submit;
+    void* ctx;
+} ingest_t;
+
+/**
+ * @brief Initialize a sink that enqueues entries one by one on a queue
+ * @param ingest Sink to initialize
+ * @param queue Destination queue
+ */
+void ingest_init_queue(ingest_t* ingest, log_queue_t* queue);
+
+/**
+ * @brief Hand a batch of entries to a sink
+ *
+ * The sink owns the entries afterwards; entries it cannot accept are
+ * destroyed.
+ *
+ * @param ingest Sink
+ * @param entries Entries to submit
+ * @param count Number of entries
+ * @param affinity Source affinity from ingest_affinity()
+ * @return 0 on success, -1 if some entries were dropped
+ */
+int ingest_submit(const ingest_t* ingest, log_entry_t** entries, size_t count,
+                  uint64_t affinity);
+
+/**
+ * @brief Affinity of a source (network clients share one affinity per IP)
+ * @param source Source identifier
+ * @return Affinity value
+ */
+uint64_t ingest_affinity(const char* source);
+
+#endif // INGEST_H
+
@@ -0,0 +1,129 @@
+#ifndef JSON_LINES_H
+#define JSON_LINES_H
+
+#include "log_entry.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file json_lines.h
+ * @brief Vectorized JSON-lines scanner for structured application logs
+ *
+ * Each line is classified 64 bytes at a time into bitmaps of quotes,
+ * backslashes and structural characters. Only the top-level keys that
+ * are mapped to level, message, timestamp or a selected field are
+ * examined; every other value is skipped over using the bitmaps, and no
+ * DOM or per-field allocation is ever made.
+ */
+
+#define JSON_LINES_MAX_KEYS 8
+#define JSON_LINES_MAX_FIELDS 8
+
+// Set of alternative key names (e.g. "level", "severity")
+typedef struct {
+    char* names[JSON_LINES_MAX_KEYS];
+    size_t lengths[JSON_LINES_MAX_KEYS];
+    size_t count;
+} json_key_set_t;
+
+// JSON-lines parser configuration (key mappings)
+typedef struct {
+    json_key_set_t level_keys;
+    json_key_set_t message_keys;
+    json_key_set_t timestamp_keys;
+    char* fields[JSON_LINES_MAX_FIELDS];     // Selected fields copied into entries
+    size_t field_lengths[JSON_LINES_MAX_FIELDS];
+    size_t num_fields;
+    uint64_t length_filter;                  // Bit n set if some mapped key has length n
+    uint64_t first_char_filter[4];           // Bitmap of first bytes of mapped keys
+} json_lines_t;
+
+// Value span inside a line (strings exclude their quotes)
+typedef struct {
+    const char* start;      // NULL if the key was not present
+    size_t length;
+    bool is_string;         // Value was a JSON string (may contain escapes)
+} json_span_t;
+
+// Scan result
+typedef struct {
+    json_span_t level;
+    json_span_t message;
+    json_span_t timestamp;
+    json_span_t fields[JSON_LINES_MAX_FIELDS];
+} json_lines_result_t;
+
+/**
+ * @brief Initialize key mappings
+ * @param parser Parser to initialize
+ * @param level_keys Comma-separated level keys (NULL for defaults)
+ * @param message_keys Comma-separated message keys (NULL for defaults)
+ * @param timestamp_keys Comma-separated timestamp keys (NULL for defaults)
+ * @param fields Selected field names
+ * @param num_fields Number of selected fields
+ * @return 0 on success, -1 on failure
+ */
+int json_lines_init(json_lines_t* parser, const char* level_keys, const char* message_keys,
+                    const char* timestamp_keys, char** fields, size_t num_fields);
+
+/**
+ * @brief Free parser resources
+ * @param parser Parser to destroy
+ */
+void json_lines_destroy(json_lines_t* parser);
+
+/**
+ * @brief Check whether a line looks like a JSON object
+ * @param line Line bytes
+ * @param length Line length
+ * @return true if the first non-blank character is '{'
+ */
+bool json_lines_is_json(const char* line, size_t length);
+
+/**
+ * @brief Scan one JSON object and locate the mapped keys
+ * @param parser Parser with key mappings
+ * @param line Line bytes
+ * @param length Line length
+ * @param result Receives value spans pointing into line
+ * @return 0 on success, -1 if the line is not a well-formed JSON object
+ */
+int json_lines_scan(const json_lines_t* parser, const char* line, size_t length,
+                    json_lines_result_t* result);
+
+/**
+ * @brief Find a single top-level key in a JSON object
+ * @param line Line bytes
+ * @param length Line length
+ * @param key Key to find
+ * @param value Receives the value span
+ * @return true if the key was found
+ */
+bool json_lines_find(const char* line, size_t length, const char* key, json_span_t* value);
+
+/**
+ * @brief Decode JSON string escapes
+ *
+ * \\u0000 is copied through escaped, since the output is used as a C string.
+ * @param src Escaped string contents (without quotes)
+ * @param length Length of src
+ * @param dst Output buffer
+ * @param size Size of dst (output is always NUL-terminated)
+ * @return Number of bytes written, excluding the terminator
+ */
+size_t json_lines_unescape(const char* src, size_t length, char* dst, size_t size);
+
+/**
+ * @brief Field extractor for entries whose raw line is a JSON object
+ * @param entry Log entry
+ * @param name Top-level key
+ * @param value Receives the value pointer
+ * @param length Receives the value length
+ * @return true if the key is present
+ */
+bool json_lines_extract_field(const log_entry_t* entry, const char* name,
+                              const char** value, size_t* length);
+
+#endif // JSON_LINES_H
+
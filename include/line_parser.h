@@ -0,0 +1,124 @@
+#ifndef LINE_PARSER_H
+#define LINE_PARSER_H
+
+#include "log_entry.h"
+#include "config.h"
+#include "json_lines.h"
+#include "log_format.h"
+#include "line_scan.h"
+#include "pushdown.h"
+#include "metrics.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file line_parser.h
+ * @brief Turns raw lines from any source into log entries
+ *
+ * Shared by the file monitor and the network server so that every source
+ * understands the same line formats: `[LEVEL] message`, JSON objects with
+ * configurable key mappings when enabled, and compiled declarative formats
+ * assigned to sources by glob.
+ */
+
+// Line parser structure
+typedef struct {
+    bool json_enabled;                  // Parse lines that start with '{' as JSON
+    json_lines_t json;                  // JSON key mappings
+    
+    log_format_t* formats;              // Compiled formats (custom and referenced built-ins)
+    size_t num_formats;
+    char** source_globs;                // Source globs, matched in order
+    const log_format_t** source_formats;// Format assigned to each glob
+    size_t num_assignments;
+    metric_t* format_mismatches;        // Lines that fell back to default parsing
+    
+    pushdown_t pushdown;                // Prefilters applied by sources while reading
+} line_parser_t;
+
+/**
+ * @brief Initialize a line parser from configuration
+ * @param parser Parser to initialize
+ * @param config Configuration (NULL for built-in defaults)
+ * @return 0 on success, -1 on failure
+ */
+int line_parser_init(line_parser_t* parser, const config_t* config);
+
+/**
+ * @brief Free parser resources
+ * @param parser Parser to destroy
+ */
+void line_parser_destroy(line_parser_t* parser);
+
+/**
+ * @brief Find the format assigned to a source
+ *
+ * Sources resolve their format once (per file or per connection) rather
+ * than once per line.
+ *
+ * @param parser Parser
+ * @param source Source identifier (file path or network:<ip>:<port>)
+ * @return Assigned format, or NULL for the default formats
+ */
+const log_format_t* line_parser_format_for(const line_parser_t* parser, const char* source);
+
+/**
+ * @brief Parse a line with a resolved format and create a log entry for it
+ *
+ * Lines that do not match the format fall back to the default formats.
+ *
+ * @param parser Parser (NULL parses `[LEVEL] message` only)
+ * @param format Format from line_parser_format_for (NULL for the defaults)
+ * @param source Source identifier
+ * @param line Line bytes without the trailing newline (not modified)
+ * @param length Line length
+ * @return New log entry, or NULL if the line is empty or allocation failed
+ */
+log_entry_t* line_parser_create_entry_format(const line_parser_t* parser,
+                                             const log_format_t* format, const char* source,
+                                             const char* line, size_t length);
+
+/**
+ * @brief Resolve the parser's prefilters for one source
+ * @param parser Parser (NULL admits everything)
+ * @param state State to initialize
+ * @param source Source identifier
+ * @param format Format from line_parser_format_for
+ */
+void line_parser_source_filter(const line_parser_t* parser, pushdown_source_t* state,
+                               const char* source, const log_format_t* format);
+
+/**
+ * @brief Create a log entry for a line framed by line_scan()
+ *
+ * Plain `[LEVEL] message` lines reuse the prefix classified during
+ * framing; everything else goes through line_parser_create_entry_format().
+ * With a filter, lines that cannot alert are dropped before an entry is
+ * allocated (or, for formats, right after parsing).
+ *
+ * @param parser Parser (NULL parses `[LEVEL] message` only)
+ * @param format Format from line_parser_format_for (NULL for the defaults)
+ * @param filter Source prefilters from line_parser_source_filter (NULL keeps every line)
+ * @param source Source identifier
+ * @param buf Buffer the line was framed in
+ * @param span Framed line
+ * @return New log entry, or NULL if the line is empty, was dropped or allocation failed
+ */
+log_entry_t* line_parser_create_entry_span(const line_parser_t* parser,
+                                           const log_format_t* format,
+                                           const pushdown_source_t* filter, const char* source,
+                                           const char* buf, const line_span_t* span);
+
+/**
+ * @brief Parse a line and create a log entry for it
+ * @param parser Parser (NULL parses `[LEVEL] message` only)
+ * @param source Source identifier
+ * @param line Line bytes without the trailing newline (not modified)
+ * @param length Line length
+ * @return New log entry, or NULL if the line is empty or allocation failed
+ */
+log_entry_t* line_parser_create_entry(const line_parser_t* parser, const char* source,
+                                      const char* line, size_t length);
+
+#endif // LINE_PARSER_H
+
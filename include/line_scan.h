@@ -0,0 +1,59 @@
+#ifndef LINE_SCAN_H
+#define LINE_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file line_scan.h
+ * @brief Vectorized line framing and `[LEVEL]` prefix classification
+ *
+ * Frames a whole read buffer at once: each 64-byte block is classified
+ * into newline and closing-bracket bitmaps, lines are cut at the set
+ * newline bits, and a line starting with `[` has its level token resolved
+ * through the perfect hash in log_entry_parse_level_len(). The block
+ * classifier is picked at runtime (AVX-512BW, AVX2, SSE2 or scalar).
+ */
+
+#define LINE_SCAN_BATCH 256
+
+// One framed line
+typedef struct {
+    uint32_t start;         // Offset of the line in the buffer
+    uint32_t length;        // Length without the newline (and a trailing '\r')
+    uint32_t message;       // Offset of the message within the line (0 without a prefix)
+    uint8_t level;          // log_level_t from the prefix (INFO without one)
+    uint8_t has_level;      // Line starts with a bracketed level prefix
+} line_span_t;
+
+/**
+ * @brief Frame complete lines in a buffer
+ *
+ * Stops after max_lines lines; call again from *consumed for the rest.
+ * Bytes after the last newline are a partial line and are not consumed.
+ *
+ * @param buf Buffer
+ * @param len Buffer length (less than 4 GiB)
+ * @param lines Receives the framed lines
+ * @param max_lines Capacity of lines
+ * @param consumed Receives the number of bytes up to and including the last framed newline
+ * @return Number of lines framed
+ */
+size_t line_scan(const char* buf, size_t len, line_span_t* lines, size_t max_lines,
+                 size_t* consumed);
+
+/**
+ * @brief Name of the block classifier in use
+ * @return "avx512", "avx2", "sse2" or "scalar"
+ */
+const char* line_scan_impl(void);
+
+/**
+ * @brief Force a block classifier (for benchmarks and tests)
+ * @param impl "avx512", "avx2", "sse2", "scalar", or NULL to auto-detect
+ * @return 0 on success, -1 if the CPU or build does not support it
+ */
+int line_scan_force(const char* impl);
+
+#endif // LINE_SCAN_H
+
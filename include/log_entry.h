@@ -3,6 +3,8 @@
 
 #include <time.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /**
  * @file log_entry.h
@@ -18,13 +20,52 @@ typedef enum {
     LOG_LEVEL_CRITICAL = 4
 } log_level_t;
 
-// Log entry structure
+// Kind of rule that raised an alert
+typedef enum {
+    LOG_RULE_NONE = 0,
+    LOG_RULE_FIELD = 1,         // alert_rule
+    LOG_RULE_RATE = 2,          // alert_rate
+    LOG_RULE_SEQUENCE = 3       // alert_sequence
+} log_rule_kind_t;
+
+// Rule identifier: kind in the top byte, 1-based position among the rules of that kind
+#define LOG_RULE_ID(kind, index) (((uint32_t)(kind) << 24) | (uint32_t)((index) + 1))
+#define LOG_RULE_KIND(id) ((log_rule_kind_t)((uint32_t)(id) >> 24))
+#define LOG_RULE_NUMBER(id) ((uint32_t)(id) & 0xffffff)
+
+#define LOG_ENTRY_MAX_FIELDS 8
+
+struct log_entry;
+struct log_context;
+
+// Field extractor: locate a named field without modifying the entry
+typedef bool (*log_field_extractor_fn)(const struct log_entry* entry, const char* name,
+                                       const char** value, size_t* length);
+
+// Memoized field slot (value points into the entry's own strings)
 typedef struct {
+    const char* name;       // Field name (not owned, must outlive the entry)
+    const char* value;      // Field value, NULL if the field is absent
+    size_t length;          // Value length in bytes
+} log_field_t;
+
+// Log entry structure
+typedef struct log_entry {
     char* source;           // Source identifier (file path or network client)
     char* message;          // Log message content
     log_level_t level;      // Severity level
-    time_t timestamp;       // Timestamp when log was received
+    int64_t timestamp;      // Event time in ns since the epoch (ingest time if the line has none)
+    int64_t ingest_time;    // Arrival time in ns since the epoch (coarse clock)
     char* raw_line;         // Original raw log line
+    uint32_t template_id;   // Mined message template (0 if none, see template_miner.h)
+    uint32_t rule_id;       // Rule that raised the alert (0 if none, see LOG_RULE_ID)
+    uint64_t patterns;      // alert_patterns found in an alerting entry (bit i: pattern i)
+    struct log_context* context; // Lines around an alerting entry (NULL if none, owned)
+    
+    // Lazily extracted fields, filled on first access by a rule
+    log_field_t fields[LOG_ENTRY_MAX_FIELDS];
+    unsigned int num_fields;
+    log_field_extractor_fn extractor;   // NULL selects key=value extraction
 } log_entry_t;
 
 /**
@@ -38,6 +79,19 @@ typedef struct {
 log_entry_t* log_entry_create(const char* source, const char* message, 
                                log_level_t level, const char* raw_line);
 
+/**
+ * @brief Create a new log entry from length-delimited strings
+ * @param source Source identifier
+ * @param message Log message bytes (need not be NUL-terminated)
+ * @param message_len Length of message
+ * @param level Severity level
+ * @param raw_line Original raw log line bytes (need not be NUL-terminated)
+ * @param raw_len Length of raw_line
+ * @return Pointer to new log entry, or NULL on failure
+ */
+log_entry_t* log_entry_create_len(const char* source, const char* message, size_t message_len,
+                                  log_level_t level, const char* raw_line, size_t raw_len);
+
 /**
  * @brief Free a log entry and its resources
  * @param entry Log entry to free
@@ -51,6 +105,22 @@ void log_entry_destroy(log_entry_t* entry);
  */
 log_level_t log_entry_parse_level(const char* level_str);
 
+/**
+ * @brief Parse log level from a length-delimited token
+ *
+ * Exact tokens (debug, dbg, info, warn, warning, error, err, crit,
+ * critical, fatal in any case, so at most 8 bytes) are resolved with a
+ * single perfect-hash probe. Anything else falls back to substring
+ * matching over its first 15 bytes, in the order debug/dbg, info, warn,
+ * error/err, crit/critical/fatal: "E_ERROR" and "terrible" both read as
+ * ERROR, and a token with none of these (or only past byte 15) as INFO.
+ *
+ * @param level_str Level token (need not be NUL-terminated)
+ * @param len Token length
+ * @return Log level enum value
+ */
+log_level_t log_entry_parse_level_len(const char* level_str, size_t len);
+
 /**
  * @brief Get string representation of log level
  * @param level Log level enum
@@ -58,5 +128,64 @@ log_level_t log_entry_parse_level(const char* level_str);
  */
 const char* log_entry_level_to_string(log_level_t level);
 
+/**
+ * @brief Get a named field, extracting and memoizing it on first access
+ *
+ * Nothing is tokenized until a field is requested. The default extractor
+ * finds `name=value`, `name: value` and `"name": value` pairs in the
+ * message; parsers may install their own extractor or pre-populate slots.
+ *
+ * @param entry Log entry
+ * @param name Field name (must outlive the entry, e.g. owned by config)
+ * @param value Receives a pointer to the value (not NUL-terminated)
+ * @param length Receives the value length
+ * @return true if the field is present, false otherwise
+ */
+bool log_entry_get_field(log_entry_t* entry, const char* name,
+                         const char** value, size_t* length);
+
+/**
+ * @brief Get a named field as a number
+ * @param entry Log entry
+ * @param name Field name
+ * @param number Receives the parsed leading number (e.g. "12ms" -> 12)
+ * @return true if the field is present and starts with a number
+ */
+bool log_entry_get_field_number(log_entry_t* entry, const char* name, double* number);
+
+/**
+ * @brief Store an already-extracted field in the entry's slot table
+ * @param entry Log entry
+ * @param name Field name (must outlive the entry)
+ * @param value Value pointer into the entry's own strings, or NULL if absent
+ * @param length Value length
+ * @return 0 on success, -1 if the slot table is full
+ */
+int log_entry_set_field(log_entry_t* entry, const char* name,
+                        const char* value, size_t length);
+
+/**
+ * @brief Default field extractor for key=value style messages
+ * @param entry Log entry
+ * @param name Field name
+ * @param value Receives the value pointer
+ * @param length Receives the value length
+ * @return true if the field is present
+ */
+bool log_entry_extract_kv(const log_entry_t* entry, const char* name,
+                          const char** value, size_t* length);
+
+/**
+ * @brief Get the length of the source class prefix of a source identifier
+ *
+ * Network sources ("network:<ip>:<port>") are classified by client address
+ * so that reconnects from the same host share a class; file sources are
+ * their own class.
+ *
+ * @param source Source identifier
+ * @return Number of leading bytes of source forming its class
+ */
+size_t log_entry_source_class_len(const char* source);
+
 #endif // LOG_ENTRY_H
 
@@ -0,0 +1,137 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include "log_entry.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file log_format.h
+ * @brief Declarative line formats compiled to specialized matchers
+ *
+ * A format spec is literal text interleaved with typed captures, in the
+ * spirit of grok:
+ *
+ *     %{ip:client} %{word} %{word:user} [%{timestamp:timestamp}] %{quoted:request} %{int:status}
+ *
+ * At startup the spec is compiled into a flat program of literal and
+ * capture ops. Each capture op knows the literal that follows it, so
+ * matching a line is a single forward pass with no backtracking and no
+ * allocation. Supported capture types:
+ *
+ * - `int`       optionally signed decimal digits
+ * - `number`    int with an optional fraction
+ * - `word`      run of non-blank characters
+ * - `ip`        IPv4 or IPv6 address
+ * - `quoted`    double-quoted string, captured without the quotes
+ * - `timestamp` ISO-8601/RFC3339, common log format, syslog or epoch;
+ *               the first one becomes the entry's event time
+ * - `data`      everything up to the next literal
+ * - `rest`      everything up to the end of the line
+ *
+ * A space in the spec matches one or more blanks; `%%` is a literal `%`.
+ * Captures named `level`, `message`, `priority` (syslog PRI) and `status`
+ * (HTTP status, used when there is no level) set the entry's level and
+ * message; every other named capture is stored as an entry field.
+ */
+
+#define LOG_FORMAT_MAX_OPS 48
+#define LOG_FORMAT_MAX_CAPTURES 16
+
+// Capture types
+typedef enum {
+    FORMAT_INT,
+    FORMAT_NUMBER,
+    FORMAT_WORD,
+    FORMAT_IP,
+    FORMAT_QUOTED,
+    FORMAT_TIMESTAMP,
+    FORMAT_DATA,
+    FORMAT_REST
+} format_type_t;
+
+// Compiled op
+typedef struct {
+    bool is_literal;
+    format_type_t type;         // Capture type (captures only)
+    int capture;                // Capture slot, -1 if unnamed
+    const char* literal;        // Literal bytes (points into the format's spec copy)
+    size_t literal_len;
+    bool blank;                 // Literal is a single space matching 1+ blanks
+    int next_literal;           // Op index of the literal following a capture, -1 if none
+} format_op_t;
+
+// Compiled format
+typedef struct {
+    char* name;
+    char* spec;                                 // Owned copy; literals point into it
+    format_op_t ops[LOG_FORMAT_MAX_OPS];
+    size_t num_ops;
+    char* captures[LOG_FORMAT_MAX_CAPTURES];    // Capture names
+    size_t num_captures;
+    int level_capture;                          // Slot of the special captures, -1 if absent
+    int message_capture;
+    int priority_capture;
+    int status_capture;
+} log_format_t;
+
+// Span of one capture inside a matched line
+typedef struct {
+    const char* start;      // NULL if the capture is unnamed or did not match
+    size_t length;
+} format_span_t;
+
+/**
+ * @brief Compile a format spec
+ * @param format Format to initialize
+ * @param name Format name
+ * @param spec Format spec
+ * @return 0 on success, -1 if the spec is invalid (reason printed to stderr)
+ */
+int log_format_compile(log_format_t* format, const char* name, const char* spec);
+
+/**
+ * @brief Compile one of the built-in formats
+ *
+ * Built-ins: `clf` (common log format), `combined` (nginx/Apache
+ * combined), `syslog` (RFC3164 as written to files), `rfc3164` (with
+ * `<PRI>`) and `rfc5424`.
+ *
+ * @param format Format to initialize
+ * @param name Built-in format name
+ * @return 0 on success, -1 if there is no such built-in
+ */
+int log_format_builtin(log_format_t* format, const char* name);
+
+/**
+ * @brief Free format resources
+ * @param format Format to destroy
+ */
+void log_format_destroy(log_format_t* format);
+
+/**
+ * @brief Match a line against a compiled format
+ * @param format Compiled format
+ * @param line Line bytes
+ * @param length Line length
+ * @param spans Receives one span per capture (LOG_FORMAT_MAX_CAPTURES entries)
+ * @param timestamp Receives the first timestamp capture in ns, 0 if none (may be NULL)
+ * @return true if the whole line matched
+ */
+bool log_format_match(const log_format_t* format, const char* line, size_t length,
+                      format_span_t* spans, int64_t* timestamp);
+
+/**
+ * @brief Match a line and create a log entry from the captures
+ * @param format Compiled format
+ * @param source Source identifier
+ * @param line Line bytes
+ * @param length Line length
+ * @return New log entry, or NULL if the line does not match or allocation failed
+ */
+log_entry_t* log_format_create_entry(const log_format_t* format, const char* source,
+                                     const char* line, size_t length);
+
+#endif // LOG_FORMAT_H
+
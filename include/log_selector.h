@@ -0,0 +1,51 @@
+#ifndef LOG_SELECTOR_H
+#define LOG_SELECTOR_H
+
+#include "log_entry.h"
+#include "field_rule.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file log_selector.h
+ * @brief Entry selectors shared by rate and sequence rules
+ *
+ * A selector is an optional level name (that level and above) followed
+ * by either a field rule (see field_rule.h) or a message substring:
+ * `ERROR`, `status>=500`, `WARN connection refused`. A substring that
+ * contains an operator character is written in double quotes.
+ */
+
+// Selector structure
+typedef struct {
+    log_level_t min_level;      // Entries below this level never match
+    bool has_field;
+    field_rule_t field;         // Field rule (if has_field)
+    char* pattern;              // Message substring (NULL if none)
+} log_selector_t;
+
+/**
+ * @brief Parse a selector
+ * @param selector Selector to populate
+ * @param text Selector text (need not be NUL-terminated)
+ * @param length Length of text
+ * @return 0 on success, -1 on invalid syntax
+ */
+int log_selector_parse(log_selector_t* selector, const char* text, size_t length);
+
+/**
+ * @brief Free selector resources
+ * @param selector Selector to free
+ */
+void log_selector_destroy(log_selector_t* selector);
+
+/**
+ * @brief Check whether an entry matches a selector
+ * @param selector Selector
+ * @param entry Log entry (fields are extracted on demand)
+ * @return true on a match
+ */
+bool log_selector_matches(const log_selector_t* selector, log_entry_t* entry);
+
+#endif // LOG_SELECTOR_H
+
@@ -1,8 +1,9 @@
 #ifndef LOG_SOURCE_H
 #define LOG_SOURCE_H
 
-#include "queue.h"
+#include "ingest.h"
 #include "config.h"
+#include "line_parser.h"
 #include <stdbool.h>
 
 /**
@@ -14,7 +15,8 @@
 typedef struct {
     char* directory;
     int poll_interval;
-    log_queue_t* queue;
+    const ingest_t* ingest;
+    const line_parser_t* parser;
     bool running;
     pthread_t thread;
 } file_monitor_t;
@@ -22,7 +24,8 @@ typedef struct {
 // Network server structure
 typedef struct {
     int port;
-    log_queue_t* queue;
+    const ingest_t* ingest;
+    const line_parser_t* parser;
     bool running;
     pthread_t thread;
     int server_fd;
@@ -33,11 +36,13 @@ typedef struct {
  * @param monitor Monitor to initialize
  * @param directory Directory to monitor
  * @param poll_interval Poll interval in seconds
- * @param queue Queue to add logs to
+ * @param ingest Sink for parsed entries
+ * @param parser Line parser shared by all sources (NULL for `[LEVEL] message` only)
  * @return 0 on success, -1 on failure
  */
 int file_monitor_init(file_monitor_t* monitor, const char* directory, 
-                      int poll_interval, log_queue_t* queue);
+                      int poll_interval, const ingest_t* ingest,
+                      const line_parser_t* parser);
 
 /**
  * @brief Start file monitoring thread
@@ -62,10 +67,12 @@ void file_monitor_destroy(file_monitor_t* monitor);
  * @brief Initialize network server
  * @param server Server to initialize
  * @param port Port to listen on
- * @param queue Queue to add logs to
+ * @param ingest Sink for parsed entries
+ * @param parser Line parser shared by all sources (NULL for `[LEVEL] message` only)
  * @return 0 on success, -1 on failure
  */
-int network_server_init(network_server_t* server, int port, log_queue_t* queue);
+int network_server_init(network_server_t* server, int port, const ingest_t* ingest,
+                        const line_parser_t* parser);
 
 /**
  * @brief Start network server thread
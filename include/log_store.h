@@ -0,0 +1,211 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include "config.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "segment.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file log_store.h
+ * @brief Time-partitioned store of every processed line
+ *
+ * Every processing thread appends to its own memtable (a byte arena of
+ * timestamp, level, source and raw line), so the hot path takes no shared
+ * lock and does one copy. A background thread flushes all memtables once
+ * together they reach `store_memtable_size` bytes, or every
+ * `store_flush_ms`: it sorts the rows by timestamp, splits them at
+ * `store_partition` boundaries and writes one immutable columnar segment
+ * per partition (see segment.h) to
+ * `<store_dir>/<YYYYmmdd-HHMMSS>/<ID>.seg`, named by the partition's UTC
+ * start. Segment IDs increase across restarts.
+ *
+ * Appends never wait for the disk: while the flush thread is behind by a
+ * second memtable's worth, new lines are dropped and counted
+ * (`store.dropped`). The store keeps a catalogue of its segments, loaded
+ * from the directory at startup.
+ *
+ * Searches look words up in each segment's token index: segments whose
+ * bloom filter rules a word out are skipped without touching their lines
+ * (`store.search_skipped`), and only rows the posting lists name are
+ * decompressed and checked (`store.search_scanned`).
+ */
+
+#define LOG_STORE_NAME_MAX 48
+
+// Segment in the catalogue
+typedef struct {
+    uint64_t id;
+    int64_t min_time;                   // ns
+    int64_t max_time;                   // ns
+    int64_t partition;                  // Partition start, ns
+    uint64_t rows;
+    uint64_t bytes;                     // File size
+    char name[LOG_STORE_NAME_MAX];      // Path below the store directory
+} log_store_segment_t;
+
+// One thread's unflushed lines
+typedef struct log_store_shard {
+    pthread_mutex_t mutex;              // Owner thread vs flush
+    struct log_store_shard* next;
+    void* store;                        // Owning log_store_t
+    bool owned;                         // A live thread appends to this shard
+    char* data;                         // Rows (see log_store.c)
+    size_t used;
+    size_t capacity;
+    size_t published;                   // Part of used already counted in pending
+} log_store_shard_t;
+
+// Segment store
+typedef struct {
+    char* dir;
+    bool read_only;                     // Opened by log_store_open()
+    size_t memtable_size;               // Bytes that trigger a flush
+    int64_t flush_interval;             // ns
+    int64_t partition;                  // ns
+
+    pthread_key_t key;                  // Calling thread's shard
+    pthread_mutex_t mutex;              // Guards shards, catalogue and running
+    pthread_mutex_t flush_mutex;        // One flush at a time
+    log_store_shard_t* shards;
+    size_t pending;                     // Unflushed bytes over all shards
+    bool flush_requested;
+
+    log_store_segment_t* segments;      // Catalogue, by ID
+    size_t num_segments;
+    size_t segment_capacity;
+    uint64_t next_id;
+
+    bool running;
+    bool started;
+    pthread_t thread;
+    pthread_cond_t wake;
+
+    metric_t* rows;
+    metric_t* raw_bytes;
+    metric_t* bytes;
+    metric_t* segments_written;
+    metric_t* flushes;
+    metric_t* dropped;
+    metric_t* errors;
+    metric_t* memtable;
+    metric_t* searches;
+    metric_t* search_skipped;
+    metric_t* search_scanned;
+} log_store_t;
+
+/**
+ * @brief Called for every matching row of a search
+ * @param ctx Caller's context
+ * @param segment Segment holding the row (open only during the search)
+ * @param row Row number in the segment
+ * @return true to continue, false to stop the search
+ */
+typedef bool (*log_store_match_fn)(void* ctx, segment_t* segment, size_t row);
+
+/**
+ * @brief Open (creating if needed) the store directory and load its catalogue
+ * @param store Store to initialize
+ * @param config Configuration (`store_*` keys; store_dir must be set)
+ * @return 0 on success, -1 on failure
+ */
+int log_store_init(log_store_t* store, const config_t* config);
+
+/**
+ * @brief Load an existing store's catalogue without modifying the directory
+ *
+ * For reading segments while another process owns the store: nothing is
+ * created or removed, appends are dropped and the flush thread cannot be
+ * started.
+ *
+ * @param store Store to initialize
+ * @param dir Store directory
+ * @return 0 on success, -1 on failure
+ */
+int log_store_open(log_store_t* store, const char* dir);
+
+/**
+ * @brief Start the flush thread
+ * @param store Store
+ * @return 0 on success, -1 on failure
+ */
+int log_store_start(log_store_t* store);
+
+/**
+ * @brief Stop the flush thread after flushing every memtable
+ * @param store Store
+ */
+void log_store_stop(log_store_t* store);
+
+/**
+ * @brief Destroy a store (unflushed lines are lost; stop it first)
+ * @param store Store to destroy
+ */
+void log_store_destroy(log_store_t* store);
+
+/**
+ * @brief Add an entry to the calling thread's memtable (thread-safe)
+ * @param store Store
+ * @param entry Log entry (not retained)
+ */
+void log_store_append(log_store_t* store, const log_entry_t* entry);
+
+/**
+ * @brief Write every memtable out as segments now (thread-safe)
+ * @param store Store
+ * @return 0 on success, -1 if a segment could not be written (its lines are dropped)
+ */
+int log_store_flush(log_store_t* store);
+
+/**
+ * @brief Copy the catalogue (thread-safe)
+ * @param store Store
+ * @param segments Receives up to max segments, by ID
+ * @param max Capacity of segments
+ * @return Number of segments in the store (may exceed max)
+ */
+size_t log_store_segments(log_store_t* store, log_store_segment_t* segments, size_t max);
+
+/**
+ * @brief Take a new segment ID (thread-safe)
+ * @param store Store
+ * @return ID above every segment's so far
+ */
+uint64_t log_store_next_id(log_store_t* store);
+
+/**
+ * @brief Swap segments in the catalogue and delete the removed files (thread-safe)
+ *
+ * Used by compaction and retention. The added segment must already be
+ * written; searches and queries that opened a removed file keep reading it.
+ *
+ * @param store Store
+ * @param removed IDs of the segments to remove (unknown IDs are ignored)
+ * @param num_removed Number of IDs
+ * @param added Segment to add (NULL to only remove)
+ * @return 0 on success, -1 on failure (nothing changed)
+ */
+int log_store_replace(log_store_t* store, const uint64_t* removed, size_t num_removed,
+                      const log_store_segment_t* added);
+
+/**
+ * @brief Find the stored lines containing a text at token boundaries (thread-safe)
+ *
+ * Segments are searched by ID, rows in timestamp order; lines not yet
+ * flushed are not searched. See token_index_match() for the semantics.
+ *
+ * @param store Store
+ * @param text Search text (need not be NUL-terminated)
+ * @param length Text length
+ * @param fn Called for each match
+ * @param ctx Passed to fn
+ * @return Number of matches reported to fn
+ */
+size_t log_store_search(log_store_t* store, const char* text, size_t length,
+                        log_store_match_fn fn, void* ctx);
+
+#endif // LOG_STORE_H
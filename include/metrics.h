@@ -0,0 +1,95 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * @file metrics.h
+ * @brief Process-wide registry of named counters and gauges
+ */
+
+#define METRICS_NAME_MAX 128
+#define METRICS_MAX 1024
+#define METRICS_MAX_COLLECTORS 64
+
+// Metric kinds
+typedef enum {
+    METRIC_COUNTER = 0,    // Monotonically increasing
+    METRIC_GAUGE = 1       // Last written value
+} metric_type_t;
+
+// Metric structure (updated with atomic operations)
+typedef struct {
+    char name[METRICS_NAME_MAX];
+    metric_type_t type;
+    uint64_t value;
+} metric_t;
+
+// Collector callback, run before every dump to refresh derived metrics
+typedef void (*metrics_collector_fn)(void* ctx);
+
+/**
+ * @brief Register a metric, or return the existing one with the same name
+ * @param name Metric name
+ * @param type Metric kind
+ * @return Pointer to the metric, or NULL if the registry is full
+ */
+metric_t* metrics_register(const char* name, metric_type_t type);
+
+/**
+ * @brief Add to a counter (thread-safe, NULL is ignored)
+ * @param metric Metric to update
+ * @param delta Amount to add
+ */
+void metrics_add(metric_t* metric, uint64_t delta);
+
+/**
+ * @brief Set a gauge (thread-safe, NULL is ignored)
+ * @param metric Metric to update
+ * @param value New value
+ */
+void metrics_set(metric_t* metric, uint64_t value);
+
+/**
+ * @brief Read a metric value
+ * @param metric Metric to read
+ * @return Current value, 0 for NULL
+ */
+uint64_t metrics_get(const metric_t* metric);
+
+/**
+ * @brief Register a collector that publishes a component's statistics
+ * @param fn Collector callback
+ * @param ctx Context passed to the callback
+ * @return 0 on success, -1 on failure
+ */
+int metrics_add_collector(metrics_collector_fn fn, void* ctx);
+
+/**
+ * @brief Unregister a collector (must be called before ctx is freed)
+ * @param fn Collector callback
+ * @param ctx Context it was registered with
+ */
+void metrics_remove_collector(metrics_collector_fn fn, void* ctx);
+
+/**
+ * @brief Run all registered collectors
+ */
+void metrics_collect(void);
+
+/**
+ * @brief Write all metrics as "name value" lines
+ * @param out Stream to write to
+ */
+void metrics_write(FILE* out);
+
+/**
+ * @brief Atomically replace a file with the current metrics
+ * @param path File path
+ * @return 0 on success, -1 on failure
+ */
+int metrics_write_file(const char* path);
+
+#endif // METRICS_H
+
@@ -4,11 +4,49 @@
 #include "log_entry.h"
 #include "queue.h"
 #include "config.h"
+#include "rule_cache.h"
+#include "work_pool.h"
+#include "shard_pool.h"
+#include "autoscaler.h"
+#include "rate_tracker.h"
+#include "correlator.h"
+#include "template_miner.h"
+#include "stream_stats.h"
+#include "context_ring.h"
+#include "log_store.h"
+#include "ingest.h"
 #include <stdbool.h>
 
 /**
  * @file processor.h
  * @brief Log processing and pattern detection
+ *
+ * In the default steal mode entries reach the processing threads through
+ * a work-stealing pool (see work_pool.h); in shard mode every thread owns
+ * a fixed set of sources (see shard_pool.h); in queue mode every thread
+ * consumes the shared input queue. Sources submit through
+ * processor_ingest() in every mode.
+ *
+ * Rate rules (see rate_rule.h) count every entry before the per-line
+ * rules run, and put their own alert on the output queue when they fire.
+ * Sequence rules (see sequence_rule.h) see every entry after the per-line
+ * rules and do the same when a sequence completes or an expected step
+ * does not arrive in time.
+ *
+ * With template mining enabled every entry is first tagged with its
+ * message template (see template_miner.h); the templates are loaded from
+ * and saved to the template file at startup and shutdown. With sketches
+ * enabled every entry then feeds the stream statistics (see
+ * stream_stats.h), which are dumped a last time once the threads stop.
+ *
+ * With alert context enabled every raw line is recorded in its source's
+ * recent-line ring first (see context_ring.h). Alerting entries are then
+ * held there until their following lines arrive, and rate and sequence
+ * alerts take the latest lines of their source along.
+ *
+ * With a store directory every entry is also appended to the calling
+ * thread's memtable of the segment store (see log_store.h) before the
+ * rules run; the memtables are flushed once more when the threads stop.
  */
 
 // Processor structure
@@ -17,8 +55,18 @@ typedef struct {
     log_queue_t* output_queue;
     config_t* config;
     bool running;
-    pthread_t* threads;
+    pthread_t* threads;            // Queue mode threads
     int num_threads;
+    rule_cache_t* rule_cache;      // Memoized rule results (NULL when disabled)
+    work_pool_t* pool;             // Steal mode workers (NULL in other modes)
+    shard_pool_t* shards;          // Shard mode threads (NULL in other modes)
+    autoscaler_t* autoscaler;      // Resizes the steal mode pool (NULL when bounds are fixed)
+    rate_tracker_t* rates;         // Rate rule counters (NULL without rate rules)
+    correlator_t* correlator;      // Sequence rule states (NULL without sequence rules)
+    template_miner_t* templates;   // Message templates (NULL when mining is off)
+    stream_stats_t* stats;         // Heavy hitters and cardinalities (NULL when sketches are off)
+    context_ring_t* context;       // Recent lines per source (NULL when alert context is off)
+    log_store_t* store;            // Stored lines (NULL without store_dir)
 } processor_t;
 
 /**
@@ -32,6 +80,20 @@ typedef struct {
 int processor_init(processor_t* processor, log_queue_t* input_queue,
                    log_queue_t* output_queue, config_t* config);
 
+/**
+ * @brief Evaluate one entry and forward it to the output queue or destroy it
+ * @param ctx Processor
+ * @param entry Log entry (ownership is taken)
+ */
+void processor_handle_entry(void* ctx, log_entry_t* entry);
+
+/**
+ * @brief Get the sink sources should submit entries to
+ * @param processor Initialized processor
+ * @param ingest Receives the sink (valid until the processor is destroyed)
+ */
+void processor_ingest(processor_t* processor, ingest_t* ingest);
+
 /**
  * @brief Start processing threads
  * @param processor Processor to start
@@ -53,12 +115,30 @@ void processor_destroy(processor_t* processor);
 
 /**
  * @brief Process a single log entry
+ *
+ * Entries below the alert threshold are dropped. When alert_rule entries
+ * are configured, the remaining entries alert only if a rule matches.
+ *
  * @param entry Log entry to process
  * @param config Configuration
  * @return true if entry should be alerted, false otherwise
  */
 bool processor_process_entry(log_entry_t* entry, config_t* config);
 
+/**
+ * @brief Evaluate alert rules for an entry, consulting the rule cache
+ *
+ * Byte-identical lines from the same source class reuse the cached result
+ * of processor_process_entry, and the alert patterns they contain, instead
+ * of re-matching every field rule and pattern. Alerts get their matched
+ * patterns in entry->patterns.
+ *
+ * @param processor Processor instance
+ * @param entry Log entry to evaluate
+ * @return true if entry should be alerted, false otherwise
+ */
+bool processor_evaluate(processor_t* processor, log_entry_t* entry);
+
 /**
  * @brief Check if log entry matches alert patterns
  * @param entry Log entry to check
@@ -67,5 +147,13 @@ bool processor_process_entry(log_entry_t* entry, config_t* config);
  */
 bool processor_check_patterns(log_entry_t* entry, config_t* config);
 
+/**
+ * @brief Find every alert pattern an entry contains
+ * @param entry Log entry to check
+ * @param config Configuration
+ * @return Bit set of matching patterns (bit i: alert_patterns[i], first 64)
+ */
+uint64_t processor_match_patterns(const log_entry_t* entry, const config_t* config);
+
 #endif // PROCESSOR_H
 
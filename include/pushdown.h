@@ -0,0 +1,112 @@
+#ifndef PUSHDOWN_H
+#define PUSHDOWN_H
+
+#include "config.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file pushdown.h
+ * @brief Alert-rule prefilters evaluated in the source read path
+ *
+ * Lines that can never alert are dropped right after framing, before an
+ * entry is allocated or queued:
+ *
+ * - the level threshold (a hard gate in processor_process_entry), or the
+ *   lowest level an `alert_rate` rule or `alert_sequence` step counts if
+ *   that is lower,
+ * - `source_include` / `source_exclude` globs over source identifiers,
+ * - a literal prefilter derived from `alert_rule`s: a rule only matches
+ *   when its field exists, and on sources without an assigned format a
+ *   field can only be extracted if its name appears in the raw line
+ *   (rate rules and sequence steps add their field selectors, or disable
+ *   it without one).
+ *
+ * With `sketches`, `template_mining`, alert context or `store_dir` enabled
+ * only the source globs apply, since the stream statistics (see
+ * stream_stats.h) count every line, the template miner (see
+ * template_miner.h) learns from every message, the context rings (see
+ * context_ring.h) keep the lines around alerts and the store (see
+ * log_store.h) keeps them all.
+ *
+ * Filters are compiled once at startup. Drops are counted per reason
+ * (`pushdown.level_dropped`, `pushdown.source_dropped`,
+ * `pushdown.literal_dropped`) and per source class
+ * (`source.<class>.dropped`).
+ */
+
+// Compiled prefilters
+typedef struct {
+    log_level_t min_level;      // Entries below this level never alert
+    char** include_globs;       // Sources must match one of these (none: all sources)
+    size_t num_include;
+    char** exclude_globs;       // Sources matching any of these are dropped
+    size_t num_exclude;
+    char** literals;            // Lines must contain one of these (none: no prefilter)
+    size_t* literal_lengths;
+    size_t num_literals;
+    metric_t* level_dropped;
+    metric_t* source_dropped;
+    metric_t* literal_dropped;
+} pushdown_t;
+
+// Prefilter state resolved once per file or connection
+typedef struct {
+    const pushdown_t* pushdown;
+    bool admitted;              // Source passes include/exclude
+    bool check_literals;        // Literal prefilter applies to this source
+    metric_t* dropped;          // source.<class>.dropped
+} pushdown_source_t;
+
+/**
+ * @brief Compile prefilters from configuration
+ * @param pushdown Prefilters to initialize
+ * @param config Configuration (NULL admits everything)
+ * @return 0 on success, -1 on failure
+ */
+int pushdown_init(pushdown_t* pushdown, const config_t* config);
+
+/**
+ * @brief Free prefilter resources
+ * @param pushdown Prefilters to destroy
+ */
+void pushdown_destroy(pushdown_t* pushdown);
+
+/**
+ * @brief Resolve the prefilters for one source
+ * @param pushdown Compiled prefilters
+ * @param state State to initialize
+ * @param source Source identifier (file path or network:<ip>:<port>)
+ * @param has_format Whether the source has an assigned line format
+ */
+void pushdown_source_init(const pushdown_t* pushdown, pushdown_source_t* state,
+                          const char* source, bool has_format);
+
+/**
+ * @brief Check the source filter for one line (counts the drop)
+ * @param state Source state
+ * @return true if lines from this source may alert
+ */
+bool pushdown_admit_source(const pushdown_source_t* state);
+
+/**
+ * @brief Check the literal prefilter against a raw line (counts the drop)
+ * @param state Source state
+ * @param line Line bytes
+ * @param length Line length
+ * @return true if the line may alert
+ */
+bool pushdown_admit_line(const pushdown_source_t* state, const char* line, size_t length);
+
+/**
+ * @brief Check the level threshold (counts the drop)
+ * @param state Source state
+ * @param level Parsed level
+ * @return true if the level may alert
+ */
+bool pushdown_admit_level(const pushdown_source_t* state, log_level_t level);
+
+#endif // PUSHDOWN_H
+
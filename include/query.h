@@ -0,0 +1,213 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "log_entry.h"
+#include "log_store.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file query.h
+ * @brief Parallel queries over the stored segments
+ *
+ * A query is a set of `key=value` terms:
+ *
+ * - `from`, `to`: event time range, `to` exclusive; a timestamp (see
+ *   timestamp_parse(), epoch numbers included) or `-<duration>` before now,
+ * - `level`: comma-separated levels (`ERROR,CRITICAL`),
+ * - `source`: source glob,
+ * - `contains`: substring of the raw line,
+ * - `word`: text at word boundaries (like grep -w), looked up in the
+ *   segments' token indexes (see token_index.h),
+ * - `regex`: POSIX extended regular expression matched against the line,
+ * - `limit`: most lines returned (default QUERY_DEFAULT_LIMIT, 0 for all),
+ * - `count`: return counts instead of lines: `total`, or per `level`,
+ *   `source` or `minute`.
+ *
+ * The engine prunes segments by their time range from the catalogue, then
+ * scans the rest in parallel on its thread pool, one segment at a time per
+ * thread, reading the mapped files. Timestamps are sorted, so the time
+ * range becomes a row range; the level and source columns are filtered 64
+ * rows at a time into bitmaps (levels with SSE2 compares where available,
+ * sources through a table built once per segment from the glob), and only
+ * rows passing every column predicate have their line decompressed for
+ * the text filters. Lines come back in event-time order, the earliest
+ * first.
+ *
+ * With a cache (see query_cache.h), each segment's part of the result is
+ * kept, and a repeated query scans only the segments it has not seen and
+ * those its time range cuts through.
+ */
+
+#define QUERY_DEFAULT_LIMIT 1000
+
+// What a query returns
+typedef enum {
+    QUERY_LINES = 0,
+    QUERY_COUNT_TOTAL,
+    QUERY_COUNT_LEVEL,
+    QUERY_COUNT_SOURCE,
+    QUERY_COUNT_MINUTE
+} query_mode_t;
+
+// Parsed query
+typedef struct {
+    int64_t from;               // ns, inclusive (INT64_MIN: unbounded)
+    int64_t to;                 // ns, exclusive (INT64_MAX: unbounded)
+    uint32_t levels;            // Bit per log_level_t (0: any)
+    char* source;               // Source glob (NULL: any)
+    char* contains;             // Substring (NULL: any)
+    char* word;                 // Word-boundary text (NULL: any)
+    char* pattern;              // Regex source (NULL: any)
+    regex_t regex;              // Compiled pattern
+    size_t limit;               // Most lines (0: unlimited)
+    query_mode_t mode;
+} query_t;
+
+// Matching line (strings are NUL-terminated copies)
+typedef struct {
+    int64_t timestamp;          // ns
+    uint64_t segment;           // Segment ID
+    uint32_t row;               // Row in the segment
+    log_level_t level;
+    char* source;
+    char* line;
+} query_row_t;
+
+// Count of one group
+typedef struct {
+    char* key;                  // Level name, source, or minute (YYYY-mm-ddTHH:MMZ)
+    uint64_t count;
+} query_bucket_t;
+
+// Result of a query, or the part of it from one segment
+typedef struct {
+    query_row_t* rows;          // QUERY_LINES: by (timestamp, segment, row)
+    size_t num_rows;
+    query_bucket_t* buckets;    // QUERY_COUNT_*: by key
+    size_t num_buckets;
+    uint64_t matched;           // Matching rows (including those past the limit)
+    uint64_t rows_read;         // Rows whose lines were read
+    uint64_t segments_scanned;
+    uint64_t segments_skipped;  // Ruled out by time range or bloom filter
+    uint64_t segments_cached;   // Answered from the cache
+    int64_t elapsed_ns;
+} query_result_t;
+
+struct query_job;
+struct query_cache;
+
+// Query engine with its scan threads
+typedef struct {
+    log_store_t* store;
+    pthread_t* threads;
+    size_t num_threads;
+    pthread_mutex_t run_mutex;  // One query at a time
+    pthread_mutex_t mutex;      // Guards job and running
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct query_job* job;
+    bool running;
+    struct query_cache* cache;  // NULL when disabled
+
+    metric_t* queries;
+    metric_t* errors;
+    metric_t* segments_scanned;
+    metric_t* segments_skipped;
+    metric_t* rows_read;
+    metric_t* last_ms;
+} query_engine_t;
+
+/**
+ * @brief Initialize a query matching everything
+ * @param query Query to initialize
+ */
+void query_init(query_t* query);
+
+/**
+ * @brief Set one query term
+ * @param query Query
+ * @param key Term name
+ * @param value Term value
+ * @return 0 on success, -1 if the key is unknown or the value invalid
+ */
+int query_set(query_t* query, const char* key, const char* value);
+
+/**
+ * @brief Set a term from `key=value` text
+ * @param query Query
+ * @param term Term text
+ * @return 0 on success, -1 if the term is invalid
+ */
+int query_parse_term(query_t* query, const char* term);
+
+/**
+ * @brief Free a query's strings and compiled regex
+ * @param query Query to destroy
+ */
+void query_destroy(query_t* query);
+
+/**
+ * @brief Canonical text of a query's filters and output, equal for queries
+ *        selecting the same rows the same way (the time range is left out)
+ * @param query Query
+ * @return Newly allocated text, or NULL on allocation failure
+ */
+char* query_normalize(const query_t* query);
+
+/**
+ * @brief Deep-copy a result
+ * @param dest Receives the copy (destroy it with query_result_destroy())
+ * @param src Result to copy
+ * @return 0 on success, -1 on allocation failure
+ */
+int query_result_copy(query_result_t* dest, const query_result_t* src);
+
+/**
+ * @brief Free a result's rows and buckets
+ * @param result Result to destroy
+ */
+void query_result_destroy(query_result_t* result);
+
+/**
+ * @brief Print a result: one line per row or `key<TAB>count` per bucket,
+ *        then a `#` summary line
+ * @param query Query the result answers
+ * @param result Result
+ * @param out Stream to write to
+ * @return 0 on success, -1 on write failure
+ */
+int query_write(const query_t* query, const query_result_t* result, FILE* out);
+
+/**
+ * @brief Start an engine over a store
+ * @param engine Engine to initialize
+ * @param store Store whose catalogue is queried (not owned)
+ * @param num_threads Scan threads besides the calling one (0 scans on the caller only)
+ * @param cache_size Bytes of per-segment results kept for repeated queries (0 disables)
+ * @return 0 on success, -1 on failure
+ */
+int query_engine_init(query_engine_t* engine, log_store_t* store, size_t num_threads,
+                      size_t cache_size);
+
+/**
+ * @brief Stop the scan threads and free an engine
+ * @param engine Engine to destroy
+ */
+void query_engine_destroy(query_engine_t* engine);
+
+/**
+ * @brief Run a query over every segment in the catalogue (thread-safe)
+ * @param engine Engine
+ * @param query Query
+ * @param result Receives the result (destroy it with query_result_destroy())
+ * @return 0 on success, -1 on failure
+ */
+int query_run(query_engine_t* engine, const query_t* query, query_result_t* result);
+
+#endif // QUERY_H
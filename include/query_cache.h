@@ -0,0 +1,121 @@
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include "query.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file query_cache.h
+ * @brief Per-segment query results kept for repeated queries
+ *
+ * Segments never change once written, so the part of a query's result that
+ * comes from one segment stays valid for as long as the segment exists. An
+ * entry is keyed by the normalized query (see query_normalize()), the
+ * segment ID and the query's time range clipped to the segment: a range
+ * covering the whole segment is stored as unbounded, so "the last hour"
+ * asked again a minute later finds every segment but the ones at its
+ * edges. Entries hold deep copies of the rows and buckets. Their sizes add
+ * up against a byte budget, and the least recently used entries are evicted
+ * to stay within it. Entries of removed segments are never asked for again
+ * and age out the same way.
+ */
+
+// Cached result of one segment
+typedef struct query_cache_entry {
+    uint64_t hash;
+    uint64_t segment;
+    int64_t from;               // Clipped range (INT64_MIN/INT64_MAX: unbounded)
+    int64_t to;
+    char* query;                // Normalized query
+    size_t query_len;
+    size_t bytes;               // Accounted size
+    query_result_t result;
+    struct query_cache_entry* next;     // Next in the same bucket
+    struct query_cache_entry* newer;    // LRU list
+    struct query_cache_entry* older;
+} query_cache_entry_t;
+
+// Query cache structure
+typedef struct query_cache {
+    pthread_mutex_t mutex;
+    query_cache_entry_t** buckets;
+    size_t bucket_mask;
+    query_cache_entry_t* newest;
+    query_cache_entry_t* oldest;
+    size_t num_entries;
+    size_t bytes;
+    size_t budget;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} query_cache_t;
+
+// Query cache statistics
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t bytes;
+} query_cache_stats_t;
+
+/**
+ * @brief Initialize a query cache
+ * @param cache Cache to initialize
+ * @param budget Most bytes of cached results
+ * @return 0 on success, -1 on failure
+ */
+int query_cache_init(query_cache_t* cache, size_t budget);
+
+/**
+ * @brief Destroy a query cache and free its entries
+ * @param cache Cache to destroy
+ */
+void query_cache_destroy(query_cache_t* cache);
+
+/**
+ * @brief Look up a segment's result and copy it
+ * @param cache Cache to search
+ * @param query Normalized query
+ * @param query_len Length of query
+ * @param segment Segment ID
+ * @param from Start of the range clipped to the segment
+ * @param to End of the range clipped to the segment
+ * @param result Receives a copy on a hit (destroy it with query_result_destroy())
+ * @return true on hit, false on miss
+ */
+bool query_cache_lookup(query_cache_t* cache, const char* query, size_t query_len,
+                        uint64_t segment, int64_t from, int64_t to, query_result_t* result);
+
+/**
+ * @brief Store a copy of a segment's result, evicting the least recently used
+ *        entries beyond the budget (results larger than the budget are not kept)
+ * @param cache Cache to update
+ * @param query Normalized query
+ * @param query_len Length of query
+ * @param segment Segment ID
+ * @param from Start of the range clipped to the segment
+ * @param to End of the range clipped to the segment
+ * @param result Result to copy
+ */
+void query_cache_insert(query_cache_t* cache, const char* query, size_t query_len,
+                        uint64_t segment, int64_t from, int64_t to,
+                        const query_result_t* result);
+
+/**
+ * @brief Drop all cached results
+ * @param cache Cache to clear
+ */
+void query_cache_clear(query_cache_t* cache);
+
+/**
+ * @brief Get cache statistics
+ * @param cache Cache to inspect
+ * @param stats Receives the statistics
+ */
+void query_cache_get_stats(query_cache_t* cache, query_cache_stats_t* stats);
+
+#endif // QUERY_CACHE_H
@@ -0,0 +1,78 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include "metrics.h"
+#include "query.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @file query_server.h
+ * @brief Local Unix-socket endpoint for stored-line queries
+ *
+ * A client connects, sends the query terms (see query.h) one per line,
+ * ends the request with an empty line (or by shutting down its side) and
+ * reads the result as printed by query_write() until the server closes
+ * the connection. An invalid request is answered with a single
+ * `# error: ...` line. Connections are served one at a time, so a query
+ * has the engine's threads to itself.
+ */
+
+#define QUERY_SERVER_MAX_REQUEST 65536
+#define QUERY_SERVER_TIMEOUT_MS 5000   // Longest wait for a client's request
+
+// Query endpoint
+typedef struct {
+    char* path;
+    query_engine_t* engine;
+    int fd;
+    pthread_t thread;
+    bool running;
+    bool started;
+
+    metric_t* requests;
+    metric_t* rejected;
+} query_server_t;
+
+/**
+ * @brief Bind the socket (replacing a stale one at path)
+ * @param server Server to initialize
+ * @param path Socket path
+ * @param engine Engine answering the queries (not owned)
+ * @return 0 on success, -1 on failure
+ */
+int query_server_init(query_server_t* server, const char* path, query_engine_t* engine);
+
+/**
+ * @brief Start accepting connections
+ * @param server Server
+ * @return 0 on success, -1 on failure
+ */
+int query_server_start(query_server_t* server);
+
+/**
+ * @brief Stop accepting connections (the current one is finished first)
+ * @param server Server
+ */
+void query_server_stop(query_server_t* server);
+
+/**
+ * @brief Stop a server, close and remove its socket
+ * @param server Server to destroy
+ */
+void query_server_destroy(query_server_t* server);
+
+/**
+ * @brief Send a query to a server and copy the answer
+ * @param path Socket path
+ * @param terms Query terms (`key=value`, without newlines)
+ * @param count Number of terms
+ * @param out Stream the answer is copied to
+ * @return 0 on success, 1 if the server rejected the query, -1 if it could not be
+ *         reached or a term holds a newline
+ */
+int query_server_request(const char* path, char* const* terms, size_t count, FILE* out);
+
+#endif // QUERY_SERVER_H
@@ -51,9 +51,12 @@ void queue_destroy(log_queue_t* queue);
 
 /**
  * @brief Enqueue a log entry (thread-safe)
+ *
+ * Blocks while the queue is full, unless it has been shut down.
+ *
  * @param queue Queue to add to
  * @param entry Log entry to enqueue
- * @return 0 on success, -1 on failure
+ * @return 0 on success, -1 on failure (the caller keeps the entry)
  */
 int queue_enqueue(log_queue_t* queue, log_entry_t* entry);
 
@@ -64,6 +67,14 @@ int queue_enqueue(log_queue_t* queue, log_entry_t* entry);
  */
 log_entry_t* queue_dequeue(log_queue_t* queue);
 
+/**
+ * @brief Dequeue a log entry, waiting at most timeout_ms (thread-safe)
+ * @param queue Queue to remove from
+ * @param timeout_ms Maximum time to wait while the queue is empty
+ * @return Log entry pointer, or NULL on timeout, shutdown or error
+ */
+log_entry_t* queue_dequeue_timeout(log_queue_t* queue, unsigned int timeout_ms);
+
 /**
  * @brief Get current queue size
  * @param queue Queue to check
@@ -0,0 +1,59 @@
+#ifndef RATE_RULE_H
+#define RATE_RULE_H
+
+#include "log_entry.h"
+#include "log_selector.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file rate_rule.h
+ * @brief Windowed count and rate alert rules
+ *
+ * Rules have the form `<limit> <selector> in <window>` and fire when more
+ * than `limit` entries from one source match the selector within the
+ * window:
+ *
+ * - `50 ERROR in 60s`: more than 50 ERROR or CRITICAL entries in a minute
+ * - `100 status>=500 in 5m`: a field rule as the selector (see field_rule.h)
+ * - `10/s connection refused in 30s`: a message substring, at more than
+ *   10 per second averaged over 30 seconds (a limit of 300)
+ *
+ * Selectors are described in log_selector.h.
+ *
+ * The window takes an `s`, `m` or `h` suffix (seconds if none). Network
+ * sources are counted per client address.
+ */
+
+// Rule structure
+typedef struct {
+    char* text;                 // Rule as configured (used in alert messages)
+    uint64_t limit;             // Fires when the windowed count exceeds this
+    int64_t window;             // ns
+    log_selector_t selector;    // Entries that count
+} rate_rule_t;
+
+/**
+ * @brief Parse a rule expression
+ * @param rule Rule to populate
+ * @param text Rule text, e.g. "50 ERROR in 60s"
+ * @return 0 on success, -1 on invalid syntax
+ */
+int rate_rule_parse(rate_rule_t* rule, const char* text);
+
+/**
+ * @brief Free rule resources
+ * @param rule Rule to free
+ */
+void rate_rule_destroy(rate_rule_t* rule);
+
+/**
+ * @brief Check whether an entry counts towards a rule
+ * @param rule Rule
+ * @param entry Log entry (fields are extracted on demand)
+ * @return true if the entry matches the selector
+ */
+bool rate_rule_matches(const rate_rule_t* rule, log_entry_t* entry);
+
+#endif // RATE_RULE_H
+
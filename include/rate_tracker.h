@@ -0,0 +1,144 @@
+#ifndef RATE_TRACKER_H
+#define RATE_TRACKER_H
+
+#include "log_entry.h"
+#include "rate_rule.h"
+#include "timer_wheel.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file rate_tracker.h
+ * @brief Per-source sliding-window counters for rate rules
+ *
+ * Every (rule, source) pair that sees a matching entry gets a counter of
+ * RATE_TRACKER_BUCKETS sub-window buckets; the windowed count is their
+ * sum, so it slides in steps of 1/8 of the window and never undercounts
+ * the most recent 7/8. Counting and firing are O(1). A rule fires when the
+ * count first exceeds its limit, then stays quiet for one window.
+ *
+ * Windows are measured in event time (the entries' timestamps), like
+ * sequence windows (see correlator.h), so a replayed backlog or a burst
+ * of a file's tail is counted by when the lines were written, not by how
+ * fast they arrive. An entry older than its counter's window is not
+ * counted; an older one within it goes to its own bucket.
+ *
+ * Each counter has a timer in a hierarchical timing wheel (see
+ * timer_wheel.h) set to when its window empties, on the wall clock: the
+ * event time plus the source's lag (wall clock minus event time at its
+ * latest hit). Timers are not moved later on
+ * every hit; when one fires early the counter is rescheduled, otherwise it
+ * is reclaimed, so idle keys expire in O(1) amortized without scanning.
+ *
+ * Counters come from a fixed pool sized at init, spread over
+ * RATE_TRACKER_STRIPES independently locked stripes. When a stripe is
+ * full the counter with the earliest timer is evicted. Counters are keyed
+ * by a hash of the rule and source class and compared on the source, so
+ * colliding sources never share a count.
+ */
+
+#define RATE_TRACKER_BUCKETS 8
+#define RATE_TRACKER_STRIPES 16
+#define RATE_TRACKER_TICK_NS 100000000LL   // Wheel tick (100 ms)
+#define RATE_TRACKER_SOURCE_MAX 128
+
+// Counter for one (rule, source) pair
+typedef struct rate_counter {
+    timer_wheel_timer_t timer;          // Fires when the window has emptied (wall clock)
+    struct rate_counter* hash_next;     // Chain in the stripe table (or free list)
+    uint64_t key;
+    int64_t epoch;                      // Sub-window of the newest bucket (event time)
+    int64_t quiet_until;                // Event time, ns; no firing before this
+    int64_t lag;                        // Wall clock minus event time at the latest hit
+    uint32_t rule;
+    uint32_t total;                     // Sum of the buckets
+    uint32_t buckets[RATE_TRACKER_BUCKETS];
+    uint32_t source_len;                // Of the whole source class
+    char source[RATE_TRACKER_SOURCE_MAX]; // Source class (truncated)
+} rate_counter_t;
+
+// Independently locked part of the key space
+typedef struct {
+    pthread_mutex_t mutex;
+    rate_counter_t* counters;           // Pool
+    rate_counter_t* free_list;
+    rate_counter_t** table;             // Hash chains
+    size_t table_mask;
+    timer_wheel_t wheel;
+} rate_stripe_t;
+
+/**
+ * @brief Called when a rule fires (outside the stripe lock)
+ * @param ctx Callback context
+ * @param rule Rule that fired
+ * @param entry Entry that pushed the count over the limit
+ * @param count Windowed count
+ */
+typedef void (*rate_alert_fn)(void* ctx, const rate_rule_t* rule, log_entry_t* entry,
+                              uint64_t count);
+
+// Tracker for a set of rules
+typedef struct {
+    const rate_rule_t* rules;           // Not owned
+    size_t num_rules;
+    rate_stripe_t* stripes;
+    size_t active;                      // Counters in use
+    rate_alert_fn alert;
+    void* ctx;
+
+    metric_t* keys;
+    metric_t* fired;
+    metric_t* expired;
+    metric_t* evictions;
+} rate_tracker_t;
+
+/**
+ * @brief Initialize a tracker
+ * @param tracker Tracker to initialize
+ * @param rules Rules (must outlive the tracker)
+ * @param num_rules Number of rules
+ * @param capacity Maximum live counters across all rules and sources
+ * @param alert Called whenever a rule fires
+ * @param ctx Context passed to the callback
+ * @param now Current wall-clock time in ns
+ * @return 0 on success, -1 on failure
+ */
+int rate_tracker_init(rate_tracker_t* tracker, const rate_rule_t* rules, size_t num_rules,
+                      size_t capacity, rate_alert_fn alert, void* ctx, int64_t now);
+
+/**
+ * @brief Destroy a tracker
+ * @param tracker Tracker to destroy
+ */
+void rate_tracker_destroy(rate_tracker_t* tracker);
+
+/**
+ * @brief Count an entry against every rule it matches (thread-safe)
+ * @param tracker Tracker
+ * @param entry Log entry (not retained); windows use its timestamp
+ * @param now Current wall-clock time in ns, for expiry
+ */
+void rate_tracker_observe(rate_tracker_t* tracker, log_entry_t* entry, int64_t now);
+
+/**
+ * @brief Get the windowed count of one rule for one source (thread-safe)
+ * @param tracker Tracker
+ * @param rule Rule index
+ * @param source Source identifier
+ * @param now Event time in ns the window ends at
+ * @return Count, 0 if the source has no live counter
+ */
+uint64_t rate_tracker_count(rate_tracker_t* tracker, size_t rule, const char* source, int64_t now);
+
+/**
+ * @brief Get the number of live counters
+ * @param tracker Tracker
+ * @return Counters in use
+ */
+size_t rate_tracker_active(const rate_tracker_t* tracker);
+
+#endif // RATE_TRACKER_H
+
@@ -0,0 +1,55 @@
+#ifndef RETENTION_RULE_H
+#define RETENTION_RULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file retention_rule.h
+ * @brief How long, and how much of, a class of sources is stored
+ *
+ * Rules have the form `<source glob> [<max age>] [<max size>]`, with at
+ * least one of the limits:
+ *
+ * - `/var/log/debug-* 1d`: lines of matching sources go after a day
+ * - `network:* 10G`: the oldest lines go once matching sources take more
+ *   than 10 GiB
+ * - `* 30d 100G`: both, for every source
+ *
+ * Ages take an `s`, `m`, `h` or `d` suffix, sizes a `K`, `M`, `G` or `T`
+ * (binary multiples) or `B` suffix. A source belongs to the first rule
+ * whose glob matches it; sources matching none are kept for good.
+ */
+
+// Rule structure
+typedef struct {
+    char* text;                 // Rule as configured
+    char* source;               // Source glob
+    int64_t max_age;            // ns (0: no age limit)
+    uint64_t max_bytes;         // Stored bytes (0: no size limit)
+} retention_rule_t;
+
+/**
+ * @brief Parse a rule expression
+ * @param rule Rule to populate
+ * @param text Rule text, e.g. "* 30d 100G"
+ * @return 0 on success, -1 on invalid syntax
+ */
+int retention_rule_parse(retention_rule_t* rule, const char* text);
+
+/**
+ * @brief Free rule resources
+ * @param rule Rule to free
+ */
+void retention_rule_destroy(retention_rule_t* rule);
+
+/**
+ * @brief Check whether a source belongs to a rule
+ * @param rule Rule
+ * @param source Source name (NUL-terminated)
+ * @return true if the glob matches
+ */
+bool retention_rule_matches(const retention_rule_t* rule, const char* source);
+
+#endif // RETENTION_RULE_H
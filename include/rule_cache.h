@@ -0,0 +1,138 @@
+#ifndef RULE_CACHE_H
+#define RULE_CACHE_H
+
+#include "log_entry.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file rule_cache.h
+ * @brief Bounded, concurrent memo of rule-evaluation results
+ *
+ * Entries are keyed by a 64-bit hash of (source class, level, raw line);
+ * the message is parsed from the raw line by the source's format, so it
+ * adds nothing to the key. The full key is stored alongside the result so
+ * that hash collisions are detected and never return a wrong answer. Each
+ * shard evicts with the CLOCK (second-chance) algorithm.
+ *
+ * Rules are fixed once the configuration is loaded, and a cache lives
+ * only as long as the processor built from that configuration, so a rule
+ * change (a restart) always starts from an empty cache. An embedder that
+ * changes rules in place must call rule_cache_clear().
+ */
+
+#define RULE_CACHE_KEY_MAX 512
+#define RULE_CACHE_NUM_SHARDS 16
+
+// Result of evaluating the rules on one line
+typedef struct {
+    uint64_t result;            // Caller's encoding of the rule result
+    uint64_t patterns;          // Alert patterns the line contains (bit i: pattern i)
+} rule_cache_value_t;
+
+// Cache slot structure
+typedef struct {
+    uint64_t hash;
+    rule_cache_value_t value;
+    int32_t next;               // Next slot in the same bucket, -1 terminates
+    uint16_t key_len;
+    bool used;
+    bool referenced;            // CLOCK reference bit
+    char key[RULE_CACHE_KEY_MAX];
+} rule_cache_slot_t;
+
+// Cache shard structure (one mutex per shard)
+typedef struct {
+    pthread_mutex_t mutex;
+    rule_cache_slot_t* slots;
+    int32_t* buckets;
+    size_t num_slots;
+    size_t bucket_mask;
+    size_t clock_hand;
+    size_t num_used;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t collisions;
+    uint64_t invalidations;
+} rule_cache_shard_t;
+
+// Rule cache structure
+typedef struct {
+    rule_cache_shard_t shards[RULE_CACHE_NUM_SHARDS];
+    size_t capacity;
+} rule_cache_t;
+
+// Rule cache statistics
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t collisions;
+    uint64_t invalidations;
+    size_t entries;
+} rule_cache_stats_t;
+
+/**
+ * @brief Initialize a rule cache
+ * @param cache Cache to initialize
+ * @param capacity Maximum number of cached results
+ * @return 0 on success, -1 on failure
+ */
+int rule_cache_init(rule_cache_t* cache, size_t capacity);
+
+/**
+ * @brief Destroy a rule cache and free resources
+ * @param cache Cache to destroy
+ */
+void rule_cache_destroy(rule_cache_t* cache);
+
+/**
+ * @brief Build the cache key for a log entry
+ * @param entry Log entry
+ * @param buffer Output buffer (at least RULE_CACHE_KEY_MAX bytes)
+ * @param size Size of buffer
+ * @return Key length, or 0 if the entry is too large to be cached
+ */
+size_t rule_cache_build_key(const log_entry_t* entry, char* buffer, size_t size);
+
+/**
+ * @brief Look up a cached result
+ * @param cache Cache to search
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param hash Hash of the key
+ * @param value Receives the cached value on a hit
+ * @return true on hit, false on miss
+ */
+bool rule_cache_lookup(rule_cache_t* cache, const char* key, size_t key_len,
+                       uint64_t hash, rule_cache_value_t* value);
+
+/**
+ * @brief Insert or replace a cached result
+ * @param cache Cache to update
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param hash Hash of the key
+ * @param value Value to store
+ */
+void rule_cache_insert(rule_cache_t* cache, const char* key, size_t key_len,
+                       uint64_t hash, const rule_cache_value_t* value);
+
+/**
+ * @brief Drop all cached results (counted as an invalidation)
+ * @param cache Cache to clear
+ */
+void rule_cache_clear(rule_cache_t* cache);
+
+/**
+ * @brief Get cache statistics
+ * @param cache Cache to inspect
+ * @param stats Receives the statistics
+ */
+void rule_cache_get_stats(rule_cache_t* cache, rule_cache_stats_t* stats);
+
+#endif // RULE_CACHE_H
+
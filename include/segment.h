@@ -0,0 +1,224 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "log_entry.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file segment.h
+ * @brief Immutable columnar segment files of stored log lines
+ *
+ * A segment holds rows sorted by timestamp, column by column, little-endian:
+ *
+ *     header      SEGMENT_HEADER_SIZE bytes: magic, version, ID, time range, counts
+ *     directory   one SEGMENT_SECTION_SIZE entry per section: kind, offset, length
+ *     sections    each starting at a multiple of 8 bytes
+ *
+ * - SEGMENT_TIMESTAMPS: varint deltas to the previous row (the first to
+ *   the segment's minimum time),
+ * - SEGMENT_LEVELS: one byte per row,
+ * - SEGMENT_SOURCES: the distinct sources (varint length and bytes each),
+ * - SEGMENT_SOURCE_IDS: each row's index into the sources, 1, 2 or 4 bytes
+ *   wide as the number of sources requires,
+ * - SEGMENT_LENGTHS: varint raw line lengths,
+ * - SEGMENT_BLOCKS: one SEGMENT_BLOCK_ENTRY_SIZE entry per block of lines,
+ * - SEGMENT_LINES: the raw lines, concatenated in blocks of about
+ *   SEGMENT_BLOCK_SIZE bytes, each deflated when built with zlib and
+ *   smaller that way,
+ * - SEGMENT_BLOOM, SEGMENT_TERMS, SEGMENT_POSTINGS: the token index of the
+ *   raw lines (see token_index.h), absent from segments written before it,
+ * - SEGMENT_REPLACES: only in segments written by compaction, the IDs of
+ *   the segments whose rows this one holds instead (64 bits each); those
+ *   left behind by a crash are removed when the store is next loaded.
+ *
+ * Readers map the file and skip sections of kinds they do not know. Files
+ * are written to `<path>.tmp` with one batched write, synced and renamed,
+ * so a segment is either complete or absent.
+ */
+
+#define SEGMENT_MAGIC 0x4745534cU      // "LSEG"
+#define SEGMENT_VERSION 1
+#define SEGMENT_HEADER_SIZE 64
+#define SEGMENT_SECTION_SIZE 24
+#define SEGMENT_BLOCK_ENTRY_SIZE 24
+#define SEGMENT_BLOCK_SIZE 65536        // Raw line bytes per block (a longer line gets its own)
+
+// Section kinds
+#define SEGMENT_TIMESTAMPS 1
+#define SEGMENT_LEVELS 2
+#define SEGMENT_SOURCES 3
+#define SEGMENT_SOURCE_IDS 4
+#define SEGMENT_LENGTHS 5
+#define SEGMENT_BLOCKS 6
+#define SEGMENT_LINES 7
+#define SEGMENT_BLOOM 8
+#define SEGMENT_TERMS 9
+#define SEGMENT_POSTINGS 10
+#define SEGMENT_REPLACES 11
+
+// Block codecs
+#define SEGMENT_CODEC_NONE 0
+#define SEGMENT_CODEC_DEFLATE 1
+
+// Row handed to the writer (strings are not NUL-terminated)
+typedef struct {
+    int64_t timestamp;          // Event time in ns
+    const char* source;
+    const char* line;           // Raw line
+    uint32_t source_len;
+    uint32_t line_len;
+    log_level_t level;
+} segment_row_t;
+
+// Block of raw lines
+typedef struct {
+    uint32_t first_row;
+    uint32_t raw_length;
+    uint32_t stored_length;
+    uint32_t codec;
+    uint64_t offset;            // In the file
+} segment_block_t;
+
+// Open segment (mapped read-only; not thread-safe, open one per reader)
+typedef struct {
+    const uint8_t* map;
+    size_t size;
+    uint64_t id;
+    int64_t min_time;           // ns
+    int64_t max_time;           // ns
+    size_t num_rows;
+    size_t num_sources;
+    size_t num_blocks;
+    uint64_t raw_bytes;         // Raw line bytes of all rows
+
+    const uint8_t* levels;      // One per row, in the map
+    const uint8_t* source_ids;  // In the map, source_width bytes per row
+    unsigned int source_width;
+    const char** source_names;  // Not NUL-terminated
+    uint32_t* source_lengths;
+    segment_block_t* blocks;
+    uint32_t* line_offsets;     // Row's start within its block
+    const uint8_t* bloom;       // Token index sections in the map, NULL if absent
+    size_t bloom_size;
+    const uint8_t* terms;
+    size_t num_terms;
+    const uint8_t* postings;
+    size_t postings_size;
+    const uint8_t* replaces;    // SEGMENT_REPLACES in the map, NULL if absent
+    size_t num_replaces;
+
+    const uint8_t* timestamp_data; // Encoded, decoded by segment_timestamps()
+    size_t timestamp_size;
+    int64_t* timestamps;
+    const uint8_t* line_data;
+    size_t line_size;
+    char* block_data;           // Last decoded block
+    size_t block_capacity;
+    size_t cached_block;        // SIZE_MAX if none
+} segment_t;
+
+/**
+ * @brief Write rows as a new segment
+ * @param path Final file path
+ * @param id Segment ID stored in the header
+ * @param rows Rows sorted by timestamp
+ * @param count Number of rows (at least one)
+ * @param bytes Receives the file size (may be NULL)
+ * @return 0 on success, -1 on failure (nothing is left at path)
+ */
+int segment_write(const char* path, uint64_t id, const segment_row_t* rows, size_t count,
+                  uint64_t* bytes);
+
+/**
+ * @brief Write rows as a new segment that takes the place of others
+ * @param path Final file path
+ * @param id Segment ID stored in the header
+ * @param rows Rows sorted by timestamp
+ * @param count Number of rows (at least one)
+ * @param replaces IDs of the segments this one supersedes
+ * @param num_replaces Number of IDs (0 writes a plain segment)
+ * @param bytes Receives the file size (may be NULL)
+ * @return 0 on success, -1 on failure (nothing is left at path)
+ */
+int segment_write_replacing(const char* path, uint64_t id, const segment_row_t* rows,
+                            size_t count, const uint64_t* replaces, size_t num_replaces,
+                            uint64_t* bytes);
+
+/**
+ * @brief Map and validate a segment
+ * @param segment Segment to open
+ * @param path File path
+ * @return 0 on success, -1 on failure
+ */
+int segment_open(segment_t* segment, const char* path);
+
+/**
+ * @brief Unmap a segment and free its decoded columns
+ * @param segment Segment to close
+ */
+void segment_close(segment_t* segment);
+
+/**
+ * @brief Get every row's timestamp (decoded on first use)
+ * @param segment Open segment
+ * @return num_rows timestamps in ns, or NULL on failure
+ */
+const int64_t* segment_timestamps(segment_t* segment);
+
+/**
+ * @brief Get a row's source index
+ * @param segment Open segment
+ * @param row Row number
+ * @return Index into source_names
+ */
+uint32_t segment_source_id(const segment_t* segment, size_t row);
+
+/**
+ * @brief Get a row's raw line, decompressing its block if needed
+ * @param segment Open segment
+ * @param row Row number
+ * @param length Receives the line length
+ * @return Line (not NUL-terminated, valid until another block is read), or NULL on failure
+ */
+const char* segment_line(segment_t* segment, size_t row, size_t* length);
+
+/**
+ * @brief Get a row's raw line length without reading the line
+ * @param segment Open segment
+ * @param row Row number
+ * @return Length in bytes (0 for a row out of range)
+ */
+size_t segment_line_length(const segment_t* segment, size_t row);
+
+/**
+ * @brief Check a segment's bloom filter for search tokens
+ * @param segment Open segment
+ * @param hashes Token hashes (see token_index_tokens())
+ * @param count Number of hashes
+ * @return false only if some token is certainly absent (true without an index)
+ */
+bool segment_may_contain(const segment_t* segment, const uint64_t* hashes, size_t count);
+
+/**
+ * @brief Find the rows holding every search token, using the token index
+ * @param segment Open segment
+ * @param hashes Token hashes (1 to TOKEN_INDEX_MAX_QUERY)
+ * @param count Number of hashes
+ * @param rows Receives the ascending candidate rows (free() it; NULL if none)
+ * @param num_rows Receives the number of rows
+ * @return 0 on success, -1 without an index or on failure
+ */
+int segment_find(const segment_t* segment, const uint64_t* hashes, size_t count,
+                 uint32_t** rows, size_t* num_rows);
+
+/**
+ * @brief Get the ID of a segment this one supersedes
+ * @param segment Open segment
+ * @param index Index below num_replaces
+ * @return Segment ID, 0 if index is out of range
+ */
+uint64_t segment_replaced_id(const segment_t* segment, size_t index);
+
+#endif // SEGMENT_H
@@ -0,0 +1,54 @@
+#ifndef SEQUENCE_RULE_H
+#define SEQUENCE_RULE_H
+
+#include "log_entry.h"
+#include "log_selector.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file sequence_rule.h
+ * @brief "A followed by B within T" correlation rules
+ *
+ * Rules have the form `<step> -> <step> [-> <step>...] within <window>`,
+ * where every step is a selector (see log_selector.h), and match when
+ * entries from one source satisfy the steps in order within the window,
+ * counted from the first step:
+ *
+ * - `connection refused -> circuit open within 30s`
+ * - `ERROR db timeout -> status>=500 -> circuit open within 1m`
+ *
+ * A `!` before the last step makes it an absence rule, which matches
+ * when the earlier steps happen and the last one does not follow in time:
+ *
+ * - `deploy started -> !deploy finished within 10m`
+ */
+
+#define SEQUENCE_RULE_MAX_STEPS 4
+
+// Rule structure
+typedef struct {
+    char* text;                 // Rule as configured (used in alert messages)
+    log_selector_t steps[SEQUENCE_RULE_MAX_STEPS];
+    size_t num_steps;
+    bool absence;               // The last step must not happen
+    int64_t window;             // ns from the first step
+} sequence_rule_t;
+
+/**
+ * @brief Parse a rule expression
+ * @param rule Rule to populate
+ * @param text Rule text, e.g. "connection refused -> circuit open within 30s"
+ * @return 0 on success, -1 on invalid syntax
+ */
+int sequence_rule_parse(sequence_rule_t* rule, const char* text);
+
+/**
+ * @brief Free rule resources
+ * @param rule Rule to free
+ */
+void sequence_rule_destroy(sequence_rule_t* rule);
+
+#endif // SEQUENCE_RULE_H
+
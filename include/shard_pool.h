@@ -0,0 +1,160 @@
+#ifndef SHARD_POOL_H
+#define SHARD_POOL_H
+
+#include "log_entry.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file shard_pool.h
+ * @brief Processing threads that each own a fixed set of sources
+ *
+ * Sources are hashed onto SHARD_POOL_SLOTS slots and every slot is owned
+ * by exactly one shard thread, which processes its entries in submission
+ * order, so a source's entries are never processed concurrently or out
+ * of order. Shards route work; they do not own state. Rate tracking,
+ * sequence correlation and alert context keep per-source state in shared
+ * structures guarded by striped locks, because rebalancing moves a
+ * slot's sources to another thread and background expiry threads touch
+ * the same state. Since one thread handles a source at a time, those
+ * locks are rarely contended, but they are still taken.
+ *
+ * Rebalancing moves slots from the busiest shard to the idlest one. A
+ * slot only moves while none of its entries are queued or being
+ * processed, so its entries never overtake each other.
+ *
+ * Each shard publishes `processor.shard<N>.entries`, `.pending` and
+ * `.slots`; moved slots are counted in `processor.shard.rebalances`.
+ */
+
+#define SHARD_POOL_SLOTS 1024
+#define SHARD_POOL_BATCH 64
+
+// Called for every entry; takes ownership of it
+typedef void (*shard_pool_fn)(void* ctx, log_entry_t* entry);
+
+// Sources hashing to the same slot
+typedef struct {
+    uint32_t owner;             // Shard processing the slot (guarded by route_mutex)
+    size_t inflight;            // Entries routed but not yet processed (atomic)
+    uint64_t load;              // Decayed count of routed entries (guarded by route_mutex)
+} shard_slot_t;
+
+// Entries of one slot
+typedef struct {
+    size_t slot;
+    size_t count;
+    log_entry_t* entries[SHARD_POOL_BATCH];
+} shard_batch_t;
+
+struct shard_pool;
+
+// Shard thread with its FIFO of batches
+typedef struct {
+    struct shard_pool* pool;
+    size_t index;
+    pthread_t thread;
+    bool started;
+
+    pthread_mutex_t mutex;      // Guards the FIFO
+    pthread_cond_t work;
+    pthread_cond_t space;
+    shard_batch_t** ring;       // FIFO ring buffer (capacity is a power of two)
+    size_t capacity;
+    size_t head;
+    size_t count;               // Batches in the FIFO
+    size_t pending;             // Entries in the FIFO
+
+    metric_t* entries;
+    metric_t* pending_gauge;
+    metric_t* slots;
+} shard_t;
+
+// Sharded pool
+typedef struct shard_pool {
+    shard_t* shards;
+    size_t num_shards;
+    shard_slot_t* slots;
+    shard_pool_fn fn;
+    void* ctx;
+
+    pthread_mutex_t route_mutex; // Guards slot owners, loads and rebalancing
+    bool running;
+    size_t max_pending;         // Per shard, 0 for unlimited
+    uint64_t rebalance_interval_ns;
+    uint64_t next_rebalance_ns;
+    uint64_t* shard_load;       // Rebalancing scratch
+    metric_t* rebalances;
+} shard_pool_t;
+
+/**
+ * @brief Initialize a pool
+ * @param pool Pool to initialize
+ * @param num_shards Number of shards (one thread each)
+ * @param max_pending Submitters block while a shard has this many entries queued (0 for unlimited)
+ * @param rebalance_interval Seconds between automatic rebalances (0 disables them)
+ * @param fn Callback run for every entry
+ * @param ctx Context passed to the callback
+ * @return 0 on success, -1 on failure
+ */
+int shard_pool_init(shard_pool_t* pool, size_t num_shards, size_t max_pending,
+                    int rebalance_interval, shard_pool_fn fn, void* ctx);
+
+/**
+ * @brief Start the shard threads
+ * @param pool Pool to start
+ * @return 0 on success, -1 on failure
+ */
+int shard_pool_start(shard_pool_t* pool);
+
+/**
+ * @brief Stop and join the shard threads (queued entries stay queued)
+ * @param pool Pool to stop
+ */
+void shard_pool_stop(shard_pool_t* pool);
+
+/**
+ * @brief Destroy a pool, destroying entries that were never processed
+ * @param pool Pool to destroy
+ */
+void shard_pool_destroy(shard_pool_t* pool);
+
+/**
+ * @brief Submit entries of one source (thread-safe)
+ *
+ * All entries go to the shard owning the source's slot, in order. The
+ * pool owns the entries afterwards; if it is stopped they are destroyed.
+ *
+ * @param pool Pool
+ * @param entries Entries to submit
+ * @param count Number of entries
+ * @param affinity Source hash (see ingest_affinity())
+ * @return 0 on success, -1 if entries were dropped
+ */
+int shard_pool_submit(shard_pool_t* pool, log_entry_t** entries, size_t count,
+                      uint64_t affinity);
+
+/**
+ * @brief Move quiescent slots from hot shards to idle ones
+ *
+ * Runs automatically from shard_pool_submit() every rebalance interval.
+ * Loads decay by half on every call.
+ *
+ * @param pool Pool
+ * @return Number of slots moved
+ */
+size_t shard_pool_rebalance(shard_pool_t* pool);
+
+/**
+ * @brief Shard currently owning a source
+ * @param pool Pool
+ * @param affinity Source hash
+ * @return Shard index
+ */
+size_t shard_pool_shard_of(shard_pool_t* pool, uint64_t affinity);
+
+#endif // SHARD_POOL_H
+
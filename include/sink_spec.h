@@ -0,0 +1,104 @@
+#ifndef SINK_SPEC_H
+#define SINK_SPEC_H
+
+#include "alert_encoder.h"
+#include "log_entry.h"
+#include "log_selector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file sink_spec.h
+ * @brief Alert sink declarations and routing rules
+ *
+ * Sinks have the form `<name> <type> [<target>] [option=value ...]`:
+ *
+ * - `audit file /var/log/alerts.log`
+ * - `console stdout rate=10`
+ * - `siem tcp 127.0.0.1:5140 queue=50000 format=json`
+ * - `local unix /run/alerts.sock`
+ * - `pager http http://127.0.0.1:9000/alerts buffer=16384`
+ *
+ * Options are `queue` (alerts waiting for the sink), `rate` (lines per
+ * second, the rest are counted), `buffer` (bytes per batch) and `format`
+ * (`text`, `json` or `binary`, see alert_encoder.h).
+ *
+ * Routes have the form `<selector> -> <sink>[,<sink>...]` and send the
+ * alerts matching the selector (see log_selector.h, `*` for every alert)
+ * to the listed sinks: `CRITICAL -> pager,siem`.
+ */
+
+// Destination kinds
+typedef enum {
+    SINK_FILE = 0,              // Appended to a file
+    SINK_STDOUT,                // Written to stdout with an "[ALERT] " prefix
+    SINK_TCP,                   // Lines over a TCP connection ("host:port")
+    SINK_UNIX,                  // Lines over a Unix stream socket (path)
+    SINK_HTTP                   // One POST per batch ("http://host[:port]/path")
+} sink_type_t;
+
+// Sink declaration
+typedef struct {
+    char* name;
+    sink_type_t type;
+    char* target;               // Path, address or URL (NULL for stdout)
+    size_t queue_size;          // Alerts queued at most (0: alert_sink_queue)
+    size_t rate;                // Lines per second (0: unlimited)
+    size_t buffer_size;         // Batch size in bytes (0: alert_buffer_size)
+    alert_format_t format;      // Encoding (if has_format)
+    bool has_format;            // Otherwise alert_format applies
+} sink_spec_t;
+
+// Routing rule
+typedef struct {
+    char* text;                 // Route as configured
+    bool match_all;             // "*" selector
+    log_selector_t selector;    // Alerts routed (unless match_all)
+    char** sinks;               // Sink names
+    size_t num_sinks;
+} sink_route_t;
+
+/**
+ * @brief Parse a sink declaration
+ * @param spec Spec to populate
+ * @param text Declaration, e.g. "siem tcp 127.0.0.1:5140 queue=50000"
+ * @return 0 on success, -1 on invalid syntax
+ */
+int sink_spec_parse(sink_spec_t* spec, const char* text);
+
+/**
+ * @brief Free spec resources
+ * @param spec Spec to free
+ */
+void sink_spec_destroy(sink_spec_t* spec);
+
+/**
+ * @brief Get the name of a sink type
+ * @param type Sink type
+ * @return Static name ("file", "stdout", ...)
+ */
+const char* sink_type_to_string(sink_type_t type);
+
+/**
+ * @brief Parse a routing rule
+ * @param route Route to populate
+ * @param text Route, e.g. "CRITICAL -> pager,siem"
+ * @return 0 on success, -1 on invalid syntax
+ */
+int sink_route_parse(sink_route_t* route, const char* text);
+
+/**
+ * @brief Free route resources
+ * @param route Route to free
+ */
+void sink_route_destroy(sink_route_t* route);
+
+/**
+ * @brief Check whether an alert takes a route
+ * @param route Route
+ * @param entry Alerting entry (fields are extracted on demand)
+ * @return true if the alert goes to the route's sinks
+ */
+bool sink_route_matches(const sink_route_t* route, log_entry_t* entry);
+
+#endif // SINK_SPEC_H
@@ -0,0 +1,196 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file sketch.h
+ * @brief Fixed-memory streaming summaries
+ *
+ * - Space-Saving (topk_t) keeps the k heaviest keys of a stream; every
+ *   key with a true count above N/k is present, and each reported count
+ *   overestimates the true one by at most the item's `error`.
+ * - Count-Min (count_min_t) estimates the count of any key from a
+ *   depth x width counter table, with conservative update (only the
+ *   counters at the current minimum grow), so estimates never fall below
+ *   the true count and rarely exceed it by much.
+ * - HyperLogLog (hll_t) estimates the number of distinct keys from
+ *   2^precision one-byte registers, with a standard error of about
+ *   1.04 / sqrt(2^precision).
+ *
+ * Keys are 64-bit hashes (see hash.h). All three merge, so per-thread
+ * sketches can be combined into one. None are thread-safe.
+ */
+
+#define SKETCH_LABEL_MAX 64
+#define COUNT_MIN_MAX_DEPTH 16
+
+// Space-Saving counter
+typedef struct {
+    uint64_t key;
+    uint64_t count;             // Upper bound of the true count
+    uint64_t error;             // Overestimation bound
+    char label[SKETCH_LABEL_MAX]; // Readable key, truncated
+} topk_item_t;
+
+// Space-Saving summary
+typedef struct {
+    topk_item_t* items;         // Counters (never move, so heap swaps stay cheap)
+    uint32_t* heap;             // Item indexes, min-heap by count
+    uint32_t* positions;        // Heap position of each item
+    uint32_t* index;            // Open-addressing table of item indexes + 1 (0: empty)
+    size_t index_mask;
+    size_t capacity;
+    size_t size;
+} topk_t;
+
+// Count-Min table
+typedef struct {
+    uint64_t* counters;         // depth rows of width counters
+    size_t width;               // Power of two
+    size_t depth;
+} count_min_t;
+
+// HyperLogLog registers
+typedef struct {
+    uint8_t* registers;
+    unsigned int precision;
+} hll_t;
+
+/**
+ * @brief Initialize a Space-Saving summary
+ * @param topk Summary to initialize
+ * @param k Number of counters
+ * @return 0 on success, -1 on failure
+ */
+int topk_init(topk_t* topk, size_t k);
+
+/**
+ * @brief Free a summary
+ * @param topk Summary to free
+ */
+void topk_destroy(topk_t* topk);
+
+/**
+ * @brief Forget every key
+ * @param topk Summary
+ */
+void topk_reset(topk_t* topk);
+
+/**
+ * @brief Count occurrences of a key
+ * @param topk Summary
+ * @param key Key hash
+ * @param label Readable key, copied when the key enters the summary
+ * @param label_len Label length
+ * @param count Occurrences
+ */
+void topk_add(topk_t* topk, uint64_t key, const char* label, size_t label_len, uint64_t count);
+
+/**
+ * @brief Add another summary's counts into this one
+ * @param topk Summary to update
+ * @param other Summary to add
+ * @return 0 on success, -1 on failure
+ */
+int topk_merge(topk_t* topk, const topk_t* other);
+
+/**
+ * @brief List the heaviest keys
+ * @param topk Summary
+ * @param items Receives up to max items, heaviest first
+ * @param max Capacity of items
+ * @return Number of items written
+ */
+size_t topk_list(const topk_t* topk, topk_item_t* items, size_t max);
+
+/**
+ * @brief Initialize a Count-Min table
+ * @param sketch Table to initialize
+ * @param width Counters per row (rounded up to a power of two)
+ * @param depth Rows (at most COUNT_MIN_MAX_DEPTH)
+ * @return 0 on success, -1 on failure
+ */
+int count_min_init(count_min_t* sketch, size_t width, size_t depth);
+
+/**
+ * @brief Free a table
+ * @param sketch Table to free
+ */
+void count_min_destroy(count_min_t* sketch);
+
+/**
+ * @brief Zero every counter
+ * @param sketch Table
+ */
+void count_min_reset(count_min_t* sketch);
+
+/**
+ * @brief Count occurrences of a key (conservative update)
+ * @param sketch Table
+ * @param key Key hash
+ * @param count Occurrences
+ */
+void count_min_add(count_min_t* sketch, uint64_t key, uint64_t count);
+
+/**
+ * @brief Estimate a key's count
+ * @param sketch Table
+ * @param key Key hash
+ * @return Estimated count (never below the true count)
+ */
+uint64_t count_min_estimate(const count_min_t* sketch, uint64_t key);
+
+/**
+ * @brief Add another table's counters into this one
+ * @param sketch Table to update
+ * @param other Table with the same dimensions
+ * @return 0 on success, -1 if the dimensions differ
+ */
+int count_min_merge(count_min_t* sketch, const count_min_t* other);
+
+/**
+ * @brief Initialize a HyperLogLog
+ * @param hll Sketch to initialize
+ * @param precision Register index bits (4 to 16)
+ * @return 0 on success, -1 on failure
+ */
+int hll_init(hll_t* hll, unsigned int precision);
+
+/**
+ * @brief Free a sketch
+ * @param hll Sketch to free
+ */
+void hll_destroy(hll_t* hll);
+
+/**
+ * @brief Forget every key
+ * @param hll Sketch
+ */
+void hll_reset(hll_t* hll);
+
+/**
+ * @brief Add a key
+ * @param hll Sketch
+ * @param key Key hash
+ */
+void hll_add(hll_t* hll, uint64_t key);
+
+/**
+ * @brief Estimate the number of distinct keys added
+ * @param hll Sketch
+ * @return Estimated cardinality
+ */
+double hll_estimate(const hll_t* hll);
+
+/**
+ * @brief Add another sketch's keys into this one
+ * @param hll Sketch to update
+ * @param other Sketch with the same precision
+ * @return 0 on success, -1 if the precisions differ
+ */
+int hll_merge(hll_t* hll, const hll_t* other);
+
+#endif // SKETCH_H
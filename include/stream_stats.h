@@ -0,0 +1,201 @@
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include "config.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "sketch.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @file stream_stats.h
+ * @brief Heavy hitters and cardinalities of the entry stream
+ *
+ * Tracks, in fixed memory (see sketch.h):
+ *
+ * - the heaviest sources (by source class) and message templates
+ *   (Space-Saving), both since startup and over the last interval,
+ * - an estimated entry count for any source (Count-Min),
+ * - the number of distinct sources, templates and values of up to
+ *   STREAM_STATS_MAX_FIELDS configured fields, such as `user`
+ *   (HyperLogLog).
+ *
+ * Every processing thread feeds its own shard, so the hot path takes no
+ * shared lock. A shard first folds repeats of a source or template in a
+ * small direct-mapped table and passes weighted counts to the sketches
+ * when a slot is reused or at merge time, so the steady-state cost per
+ * entry is a hash and an increment. A background thread merges the shards into the totals
+ * every `sketch_interval` seconds, publishes the cardinalities as
+ * `sketch.*` gauges and, when `sketch_file` is set, writes a dump.
+ * Queries read the merged totals.
+ */
+
+#define STREAM_STATS_MAX_FIELDS 4
+#define STREAM_STATS_PENDING 256    // Pre-aggregation slots per shard (power of two)
+
+// One thread's sketches (also used for the merged totals)
+typedef struct stream_stats_shard {
+    pthread_mutex_t mutex;              // Owner thread vs merger
+    struct stream_stats_shard* next;
+    void* stats;                        // Owning stream_stats_t
+    bool owned;                         // A live thread feeds this shard
+    uint64_t entries;
+    topk_t sources;
+    topk_t templates;
+    count_min_t source_counts;
+    hll_t distinct_sources;
+    hll_t distinct_templates;
+    hll_t distinct_fields[STREAM_STATS_MAX_FIELDS];
+    topk_item_t pending_sources[STREAM_STATS_PENDING];   // Not yet in the sketches (count 0: free)
+    topk_item_t pending_templates[STREAM_STATS_PENDING];
+} stream_stats_shard_t;
+
+// Sketch aggregator
+typedef struct {
+    size_t top_k;
+    size_t width;
+    size_t depth;
+    unsigned int precision;
+    const char* fields[STREAM_STATS_MAX_FIELDS]; // Owned by the config
+    size_t num_fields;
+    const char* path;                   // Dump file (NULL disables, owned by the config)
+    int interval_seconds;
+
+    pthread_key_t key;                  // Calling thread's shard
+    pthread_mutex_t mutex;              // Guards shards, totals and running
+    stream_stats_shard_t* shards;
+    stream_stats_shard_t total;         // Since startup
+    stream_stats_shard_t recent;        // Last interval
+    int64_t recent_start;               // ns
+    int64_t recent_end;                 // ns
+
+    bool running;
+    bool started;
+    pthread_t thread;
+    pthread_cond_t wake;
+
+    metric_t* distinct_sources;
+    metric_t* distinct_templates;
+    metric_t* distinct_fields[STREAM_STATS_MAX_FIELDS];
+} stream_stats_t;
+
+/**
+ * @brief Initialize from the `sketch_*` configuration
+ * @param stats Aggregator to initialize
+ * @param config Configuration (must outlive the aggregator)
+ * @return 0 on success, -1 on failure
+ */
+int stream_stats_init(stream_stats_t* stats, const config_t* config);
+
+/**
+ * @brief Start the merge thread
+ * @param stats Aggregator
+ * @return 0 on success, -1 on failure
+ */
+int stream_stats_start(stream_stats_t* stats);
+
+/**
+ * @brief Stop the merge thread after a final merge and dump
+ * @param stats Aggregator
+ */
+void stream_stats_stop(stream_stats_t* stats);
+
+/**
+ * @brief Destroy an aggregator
+ * @param stats Aggregator to destroy
+ */
+void stream_stats_destroy(stream_stats_t* stats);
+
+/**
+ * @brief Count an entry in the calling thread's shard (thread-safe)
+ * @param stats Aggregator
+ * @param entry Log entry (fields are extracted on demand)
+ */
+void stream_stats_observe(stream_stats_t* stats, log_entry_t* entry);
+
+/**
+ * @brief Merge every shard into the totals now (thread-safe)
+ * @param stats Aggregator
+ * @param now Current time in ns
+ */
+void stream_stats_merge(stream_stats_t* stats, int64_t now);
+
+/**
+ * @brief List the heaviest sources
+ * @param stats Aggregator
+ * @param recent Last interval only instead of since startup
+ * @param items Receives up to max items, heaviest first
+ * @param max Capacity of items
+ * @return Number of items written
+ */
+size_t stream_stats_top_sources(stream_stats_t* stats, bool recent, topk_item_t* items,
+                                size_t max);
+
+/**
+ * @brief List the heaviest templates (labels are template IDs)
+ * @param stats Aggregator
+ * @param recent Last interval only instead of since startup
+ * @param items Receives up to max items, heaviest first
+ * @param max Capacity of items
+ * @return Number of items written
+ */
+size_t stream_stats_top_templates(stream_stats_t* stats, bool recent, topk_item_t* items,
+                                  size_t max);
+
+/**
+ * @brief Estimate the entries seen from a source since startup
+ * @param stats Aggregator
+ * @param source Source identifier (counted by source class)
+ * @return Estimated count (never below the merged true count)
+ */
+uint64_t stream_stats_source_count(stream_stats_t* stats, const char* source);
+
+/**
+ * @brief Get the number of entries merged since startup
+ * @param stats Aggregator
+ * @return Entry count
+ */
+uint64_t stream_stats_entries(stream_stats_t* stats);
+
+/**
+ * @brief Estimate the distinct sources seen since startup
+ * @param stats Aggregator
+ * @return Estimated cardinality
+ */
+double stream_stats_distinct_sources(stream_stats_t* stats);
+
+/**
+ * @brief Estimate the distinct templates seen since startup
+ * @param stats Aggregator
+ * @return Estimated cardinality
+ */
+double stream_stats_distinct_templates(stream_stats_t* stats);
+
+/**
+ * @brief Estimate the distinct values of a configured field since startup
+ * @param stats Aggregator
+ * @param field Field name
+ * @return Estimated cardinality, or -1 if the field is not tracked
+ */
+double stream_stats_distinct_field(stream_stats_t* stats, const char* field);
+
+/**
+ * @brief Write the merged totals as `<name> <value>` lines
+ * @param stats Aggregator
+ * @param out Output stream
+ */
+void stream_stats_write(stream_stats_t* stats, FILE* out);
+
+/**
+ * @brief Write the merged totals to a file (atomically replaced)
+ * @param stats Aggregator
+ * @param path File path
+ * @return 0 on success, -1 on failure
+ */
+int stream_stats_write_file(stream_stats_t* stats, const char* path);
+
+#endif // STREAM_STATS_H
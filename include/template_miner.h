@@ -0,0 +1,154 @@
+#ifndef TEMPLATE_MINER_H
+#define TEMPLATE_MINER_H
+
+#include "log_entry.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file template_miner.h
+ * @brief Online message template mining (Drain)
+ *
+ * Messages are split into whitespace-separated tokens and routed through
+ * a fixed-depth parse tree: first by token count, then by their first
+ * `depth` tokens (tokens containing a digit route as the wildcard `<*>`).
+ * The leaf reached holds candidate templates of that length; the one
+ * sharing the most tokens with the message is taken if that share is at
+ * least `similarity`, and positions where they differ become `<*>`.
+ * Otherwise the message starts a new template, with its digit tokens
+ * already wildcarded. So `Failed to process user request 4711` and
+ * `Failed to process user request 4712` share the template `Failed to
+ * process user request <*>`, and the tokens under its wildcards are the
+ * message's variables.
+ *
+ * Every template keeps the ID it was created with, so IDs are stable
+ * while templates generalize, and a template file carries them across
+ * restarts. At most `capacity` templates exist; when full, the least
+ * recently matched template of the tree part being updated is evicted
+ * and its ID retired, or, when that part has none, that of another part
+ * whose lock is free.
+ *
+ * Trees are split by token count over TEMPLATE_MINER_STRIPES
+ * independently locked stripes.
+ */
+
+#define TEMPLATE_MINER_STRIPES 16
+#define TEMPLATE_MINER_MAX_TOKENS 64     // Further tokens are folded into the last one
+#define TEMPLATE_MINER_MAX_CHILDREN 64   // Per tree node; further tokens share the wildcard child
+#define TEMPLATE_MINER_WILDCARD "<*>"
+
+struct template_node;
+struct template_cluster;
+
+// Variable part of a message (points into the message)
+typedef struct {
+    const char* value;
+    size_t length;
+} template_var_t;
+
+// Independently locked part of the tree (token counts congruent to its index)
+typedef struct {
+    pthread_mutex_t mutex;
+    struct template_node** table;       // Tree nodes by (parent, token)
+    size_t table_mask;
+    struct template_cluster* lru_head;  // Most recently matched
+    struct template_cluster* lru_tail;
+} template_stripe_t;
+
+// Template miner
+typedef struct {
+    template_stripe_t* stripes;
+    struct template_node* roots;        // One per token count
+    size_t capacity;
+    size_t count;                       // Templates in use
+    uint32_t next_id;
+    size_t depth;                       // Leading tokens in a tree path
+    double similarity;                  // Minimum share of equal tokens
+
+    metric_t* count_gauge;
+    metric_t* created;
+    metric_t* evictions;
+} template_miner_t;
+
+/**
+ * @brief Initialize a miner
+ * @param miner Miner to initialize
+ * @param capacity Maximum number of templates
+ * @param depth Leading tokens used to route messages (at least 1)
+ * @param similarity Share of equal tokens needed to join a template (0 to 1)
+ * @return 0 on success, -1 on failure
+ */
+int template_miner_init(template_miner_t* miner, size_t capacity, size_t depth,
+                        double similarity);
+
+/**
+ * @brief Destroy a miner and all its templates
+ * @param miner Miner to destroy
+ */
+void template_miner_destroy(template_miner_t* miner);
+
+/**
+ * @brief Assign a message to a template, creating or generalizing one (thread-safe)
+ * @param miner Miner
+ * @param message Message to classify
+ * @param vars Receives the message's variables (may be NULL)
+ * @param max_vars Capacity of vars
+ * @param num_vars Receives the number of variables, which may exceed max_vars (may be NULL)
+ * @return Template ID, or 0 if the message could not be assigned
+ */
+uint32_t template_miner_match(template_miner_t* miner, const char* message,
+                              template_var_t* vars, size_t max_vars, size_t* num_vars);
+
+/**
+ * @brief Tag an entry with the template of its message (thread-safe)
+ * @param miner Miner
+ * @param entry Log entry; its template_id is set
+ */
+void template_miner_observe(template_miner_t* miner, log_entry_t* entry);
+
+/**
+ * @brief Look up a template by ID (thread-safe, scans all templates)
+ * @param miner Miner
+ * @param id Template ID
+ * @param text Receives the template text, truncated to size (may be NULL)
+ * @param size Capacity of text
+ * @param hits Receives the number of messages matched (may be NULL)
+ * @return 0 if found, -1 otherwise
+ */
+int template_miner_lookup(template_miner_t* miner, uint32_t id, char* text, size_t size,
+                          uint64_t* hits);
+
+/**
+ * @brief Get the number of templates
+ * @param miner Miner
+ * @return Templates in use
+ */
+size_t template_miner_count(const template_miner_t* miner);
+
+/**
+ * @brief Write every template to a file, one `<id>\t<hits>\t<template>` line each
+ *
+ * The file is written under a temporary name and renamed into place.
+ *
+ * @param miner Miner
+ * @param path File path
+ * @return 0 on success, -1 on failure
+ */
+int template_miner_save(template_miner_t* miner, const char* path);
+
+/**
+ * @brief Restore templates written by template_miner_save()
+ *
+ * Templates keep their IDs and counts; new templates get IDs above the
+ * largest one loaded. A missing file is not an error.
+ *
+ * @param miner Miner (normally empty)
+ * @param path File path
+ * @return Number of templates loaded, or -1 on a read error
+ */
+int template_miner_load(template_miner_t* miner, const char* path);
+
+#endif // TEMPLATE_MINER_H
@@ -0,0 +1,109 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file timer_wheel.h
+ * @brief Hierarchical timing wheel
+ *
+ * Four levels of 64 slots. A timer due within 64 ticks sits in a level 0
+ * slot, one due within 64^2 ticks in a level 1 slot, and so on; when
+ * level 0 wraps, the next level 1 slot is cascaded down. Scheduling and
+ * cancelling are O(1) and every timer is moved at most once per level, so
+ * expiring timers costs O(1) amortized however many are pending. Timers
+ * further out than 64^4 ticks are clamped and fire early; callers check
+ * their own deadline and reschedule.
+ *
+ * Timers are intrusive: embed a timer_wheel_timer_t in the tracked object.
+ * The wheel is not thread-safe.
+ */
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+// Timer node (also used as the list head of every slot)
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer* next;
+    struct timer_wheel_timer* prev;
+    uint64_t expires;           // Tick
+} timer_wheel_timer_t;
+
+/**
+ * @brief Called for every expired timer (already unlinked, may be rescheduled)
+ * @param ctx Callback context
+ * @param timer Expired timer
+ */
+typedef void (*timer_wheel_fn)(void* ctx, timer_wheel_timer_t* timer);
+
+// Timing wheel
+typedef struct {
+    timer_wheel_timer_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t now;               // Last processed tick
+    int64_t origin;             // ns at tick 0
+    int64_t tick;               // ns per tick
+    size_t count;               // Pending timers
+} timer_wheel_t;
+
+/**
+ * @brief Initialize a wheel
+ * @param wheel Wheel to initialize
+ * @param tick Tick length in ns
+ * @param now Current time in ns (tick 0)
+ * @return 0 on success, -1 on failure
+ */
+int timer_wheel_init(timer_wheel_t* wheel, int64_t tick, int64_t now);
+
+/**
+ * @brief Initialize a timer that is not scheduled
+ * @param timer Timer to initialize
+ */
+void timer_wheel_timer_init(timer_wheel_timer_t* timer);
+
+/**
+ * @brief Check whether a timer is scheduled
+ * @param timer Timer
+ * @return true if scheduled
+ */
+bool timer_wheel_pending(const timer_wheel_timer_t* timer);
+
+/**
+ * @brief Schedule (or reschedule) a timer
+ * @param wheel Wheel
+ * @param timer Timer
+ * @param expires Deadline in ns (past deadlines fire on the next tick)
+ */
+void timer_wheel_schedule(timer_wheel_t* wheel, timer_wheel_timer_t* timer, int64_t expires);
+
+/**
+ * @brief Cancel a timer (no-op if it is not scheduled)
+ * @param wheel Wheel
+ * @param timer Timer
+ */
+void timer_wheel_cancel(timer_wheel_t* wheel, timer_wheel_timer_t* timer);
+
+/**
+ * @brief Advance the wheel and fire every timer that is due
+ * @param wheel Wheel
+ * @param now Current time in ns
+ * @param fn Called for each expired timer
+ * @param ctx Callback context
+ * @return Number of timers fired
+ */
+size_t timer_wheel_advance(timer_wheel_t* wheel, int64_t now, timer_wheel_fn fn, void* ctx);
+
+/**
+ * @brief Find a timer in the earliest non-empty slot
+ *
+ * Exact for timers due within 64 ticks, slot-granular beyond.
+ *
+ * @param wheel Wheel
+ * @return Timer, or NULL if none is pending
+ */
+timer_wheel_timer_t* timer_wheel_earliest(timer_wheel_t* wheel);
+
+#endif // TIMER_WHEEL_H
+
@@ -0,0 +1,58 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file timestamp.h
+ * @brief Event-time parsing and the coarse ingest clock
+ *
+ * All times are nanoseconds since the Unix epoch. Parsing is fixed-width
+ * per shape and remembers the last date prefix it converted (per thread),
+ * so consecutive lines from the same day cost a memcmp plus the clock
+ * digits. Timestamps without a zone are taken as local time.
+ */
+
+#define TIMESTAMP_NS_PER_SEC 1000000000LL
+
+/**
+ * @brief Current wall-clock time from the coarse clock
+ *
+ * Uses CLOCK_REALTIME_COARSE where available: served from the vDSO
+ * without a syscall, with tick (1-4 ms) resolution.
+ *
+ * @return Nanoseconds since the epoch
+ */
+int64_t timestamp_now(void);
+
+/**
+ * @brief Parse a timestamp at the start of text
+ *
+ * Recognized shapes:
+ * - ISO-8601/RFC3339: `2024-01-02T03:04:05.123456789+01:00` (`T` or space,
+ *   optional fraction, optional `Z` or numeric zone)
+ * - Common log format: `10/Oct/2000:13:55:36 -0700`
+ * - Syslog (RFC3164): `Oct  1 22:14:15`, year inferred from the clock
+ * - Epoch seconds, milliseconds, microseconds or nanoseconds (9-19 digits,
+ *   unit chosen by digit count, optional fraction) if allow_epoch is set
+ *
+ * @param text Text to parse (need not be NUL-terminated)
+ * @param length Length of text
+ * @param allow_epoch Also accept bare epoch numbers
+ * @param ns Receives the time in nanoseconds since the epoch
+ * @return Number of bytes consumed, 0 if no timestamp was recognized
+ */
+size_t timestamp_parse(const char* text, size_t length, bool allow_epoch, int64_t* ns);
+
+/**
+ * @brief Parse a positive duration such as `30`, `30s`, `5m` or `1h`
+ * @param text Duration text (seconds without a suffix)
+ * @param ns Receives the duration in nanoseconds
+ * @return 0 on success, -1 if text is not a positive duration
+ */
+int timestamp_parse_duration(const char* text, int64_t* ns);
+
+#endif // TIMESTAMP_H
+
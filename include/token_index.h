@@ -0,0 +1,163 @@
+#ifndef TOKEN_INDEX_H
+#define TOKEN_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file token_index.h
+ * @brief Inverted token index and bloom filter of a segment's lines
+ *
+ * A token is a maximal run of ASCII letters, digits and underscores,
+ * compared case-sensitively and identified by its 64-bit hash. Numbers
+ * shorter than TOKEN_INDEX_MIN_NUMBER digits are not indexed: counters,
+ * durations and date fields would make the index about as large as the
+ * lines, while longer numbers are usually IDs worth finding. The
+ * builder is fed one row at a time while a segment is written and
+ * produces three sections (see segment.h), little-endian:
+ *
+ * - terms: one TOKEN_INDEX_TERM_SIZE entry per distinct token, sorted by
+ *   hash: hash, offset of its posting list, number of rows,
+ * - postings: each term's ascending row numbers as gaps (the first row
+ *   itself, then the distance to the previous row minus one), in blocks
+ *   of TOKEN_INDEX_BLOCK gaps bit-packed at the width of the block's
+ *   largest gap (one width byte, then the bits, least significant first),
+ * - bloom: the number of probes (4 bytes) and of bits (4 bytes), then the
+ *   bits, with TOKEN_INDEX_BLOOM_BITS bits per term (about 1% false
+ *   positives), so a search can rule a segment out by reading a few bytes.
+ *
+ * Word searches use the index: a line matches when it contains the
+ * searched text starting and ending at token boundaries (like grep -w),
+ * so every token of the text is a whole token of the line. Hash
+ * collisions and unindexed numbers only add candidates, which are checked
+ * against the line.
+ */
+
+#define TOKEN_INDEX_TERM_SIZE 16
+#define TOKEN_INDEX_BLOCK 128
+#define TOKEN_INDEX_BLOOM_BITS 10
+#define TOKEN_INDEX_BLOOM_PROBES 7
+#define TOKEN_INDEX_MAX_QUERY 32        // Most distinct tokens used from a search
+#define TOKEN_INDEX_MIN_NUMBER 6        // Digits a number needs to be indexed
+
+// Index under construction
+typedef struct {
+    uint64_t* hashes;           // Per term
+    uint32_t* counts;           // Rows per term
+    uint32_t* last_rows;        // Latest row added per term
+    size_t num_terms;
+    size_t term_capacity;
+    uint32_t* table;            // Hash table of term index + 1 (0: free)
+    size_t table_mask;
+    uint32_t* pair_terms;       // (term, row) occurrences, in row order
+    uint32_t* pair_rows;
+    size_t num_pairs;
+    size_t pair_capacity;
+    uint32_t next_row;
+
+    // Encoded sections, filled by token_index_finish()
+    uint8_t* terms;
+    size_t terms_size;
+    uint8_t* postings;
+    size_t postings_size;
+    uint8_t* bloom;
+    size_t bloom_size;
+} token_index_builder_t;
+
+/**
+ * @brief Initialize a builder
+ * @param builder Builder to initialize
+ * @return 0 on success, -1 on failure
+ */
+int token_index_builder_init(token_index_builder_t* builder);
+
+/**
+ * @brief Free a builder and its encoded sections
+ * @param builder Builder to destroy
+ */
+void token_index_builder_destroy(token_index_builder_t* builder);
+
+/**
+ * @brief Index the tokens of the next row
+ * @param builder Builder
+ * @param row Row number (rows must be added in ascending order)
+ * @param text Line (need not be NUL-terminated)
+ * @param length Line length
+ * @return 0 on success, -1 on failure
+ */
+int token_index_add(token_index_builder_t* builder, uint32_t row, const char* text,
+                    size_t length);
+
+/**
+ * @brief Encode the terms, postings and bloom sections
+ * @param builder Builder (no rows may be added afterwards)
+ * @return 0 on success, -1 on failure
+ */
+int token_index_finish(token_index_builder_t* builder);
+
+/**
+ * @brief Hash the distinct indexed tokens of a search text
+ * @param text Search text
+ * @param length Text length
+ * @param hashes Receives up to max token hashes
+ * @param max Capacity of hashes
+ * @return Number of hashes written
+ */
+size_t token_index_tokens(const char* text, size_t length, uint64_t* hashes, size_t max);
+
+/**
+ * @brief Check whether a bloom section may hold a token
+ * @param bloom Bloom section
+ * @param size Section size
+ * @param hash Token hash
+ * @return false only if the token is certainly absent
+ */
+bool token_index_bloom_test(const uint8_t* bloom, size_t size, uint64_t hash);
+
+/**
+ * @brief Find a token in a terms section
+ * @param terms Terms section
+ * @param num_terms Number of entries
+ * @param hash Token hash
+ * @param offset Receives the posting list's offset in the postings section
+ * @param count Receives the number of rows
+ * @return true if the token is indexed
+ */
+bool token_index_lookup(const uint8_t* terms, size_t num_terms, uint64_t hash, uint32_t* offset,
+                        uint32_t* count);
+
+/**
+ * @brief Decode a posting list
+ * @param postings Postings section
+ * @param size Section size
+ * @param offset List offset
+ * @param count Number of rows in the list
+ * @param rows Receives count ascending row numbers
+ * @return 0 on success, -1 if the list is corrupt
+ */
+int token_index_decode(const uint8_t* postings, size_t size, uint32_t offset, uint32_t count,
+                       uint32_t* rows);
+
+/**
+ * @brief Intersect two ascending row lists in place
+ * @param rows First list, receives the intersection
+ * @param count Length of rows
+ * @param other Second list
+ * @param other_count Length of other
+ * @return Length of the intersection
+ */
+size_t token_index_intersect(uint32_t* rows, size_t count, const uint32_t* other,
+                             size_t other_count);
+
+/**
+ * @brief Check whether a line contains a text at token boundaries
+ * @param line Line (need not be NUL-terminated)
+ * @param length Line length
+ * @param text Search text
+ * @param text_len Text length (0 never matches)
+ * @return true if an occurrence neither starts nor ends inside a token
+ */
+bool token_index_match(const char* line, size_t length, const char* text, size_t text_len);
+
+#endif // TOKEN_INDEX_H
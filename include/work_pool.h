@@ -0,0 +1,163 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include "log_entry.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file work_pool.h
+ * @brief Work-stealing pool of entry-processing threads
+ *
+ * Every worker owns a deque of entry batches. Producers push whole
+ * batches onto one worker's deque, chosen round-robin or by source
+ * affinity, so a queue lock is taken once per batch rather than once per
+ * entry. A worker takes its oldest batch first; an idle worker steals the
+ * newest batch of another worker, so one slow batch only delays its own
+ * entries.
+ *
+ * The number of running workers can change at runtime (see
+ * work_pool_resize()); retired workers leave their queued batches to be
+ * stolen by the others.
+ *
+ * Each worker publishes `processor.worker<N>.entries`, `.steals` and
+ * `.utilization` (percent of wall time spent processing since the
+ * previous metrics dump).
+ */
+
+#define WORK_POOL_BATCH 64
+#define WORK_POOL_ANY UINT64_MAX
+
+// Called for every entry; takes ownership of it
+typedef void (*work_pool_fn)(void* ctx, log_entry_t* entry);
+
+// Batch of entries
+typedef struct {
+    size_t count;
+    uint64_t submitted_ns;      // Monotonic time of submission
+    log_entry_t* entries[WORK_POOL_BATCH];
+} work_batch_t;
+
+struct work_pool;
+
+// Worker with its own batch deque
+typedef struct {
+    struct work_pool* pool;
+    size_t index;
+    pthread_t thread;
+    bool started;
+
+    pthread_mutex_t mutex;      // Guards the deque
+    work_batch_t** ring;        // Deque ring buffer (capacity is a power of two)
+    size_t capacity;
+    size_t head;                // Oldest batch
+    size_t count;               // Batches in the deque
+
+    uint64_t busy_ns;           // Time spent in the callback (atomic)
+    uint64_t last_busy_ns;      // Collector bookkeeping
+    uint64_t last_sample_ns;
+    metric_t* entries;
+    metric_t* steals;
+    metric_t* utilization;
+} work_worker_t;
+
+// Worker pool
+typedef struct work_pool {
+    work_worker_t* workers;
+    size_t max_workers;
+    size_t num_workers;         // Running workers (atomic)
+    pthread_mutex_t resize_mutex; // Serializes starting and joining workers
+    work_pool_fn fn;
+    void* ctx;
+
+    pthread_mutex_t mutex;      // Guards sleeping and backpressure
+    pthread_cond_t work;        // Signalled when batches are submitted
+    pthread_cond_t space;       // Signalled when pending entries drop
+    bool running;
+    size_t pending;             // Entries submitted but not yet taken (atomic)
+    size_t max_pending;         // 0 for unlimited
+    size_t sleepers;            // Workers waiting for work (atomic)
+    size_t blocked;             // Submitters waiting for space (atomic)
+    size_t next;                // Round-robin cursor (atomic)
+    uint64_t wait_ns;           // Total time batches waited to be taken (atomic)
+    uint64_t waited_batches;    // Batches counted in wait_ns (atomic)
+} work_pool_t;
+
+/**
+ * @brief Initialize a pool
+ * @param pool Pool to initialize
+ * @param max_workers Maximum number of workers
+ * @param max_pending Submitters block while this many entries are pending (0 for unlimited)
+ * @param fn Callback run for every entry
+ * @param ctx Context passed to the callback
+ * @return 0 on success, -1 on failure
+ */
+int work_pool_init(work_pool_t* pool, size_t max_workers, size_t max_pending,
+                   work_pool_fn fn, void* ctx);
+
+/**
+ * @brief Start worker threads
+ * @param pool Pool to start
+ * @param num_workers Number of workers (at most max_workers)
+ * @return 0 on success, -1 on failure
+ */
+int work_pool_start(work_pool_t* pool, size_t num_workers);
+
+/**
+ * @brief Change the number of running workers (thread-safe)
+ *
+ * New workers start immediately. Retiring workers finish their current
+ * batch and are joined before this returns.
+ *
+ * @param pool Running pool
+ * @param num_workers New number of workers (1 to max_workers)
+ * @return 0 on success, -1 on failure
+ */
+int work_pool_resize(work_pool_t* pool, size_t num_workers);
+
+/**
+ * @brief Number of running workers
+ * @param pool Pool
+ * @return Running workers
+ */
+size_t work_pool_size(const work_pool_t* pool);
+
+/**
+ * @brief Stop and join all workers (pending entries stay queued)
+ * @param pool Pool to stop
+ */
+void work_pool_stop(work_pool_t* pool);
+
+/**
+ * @brief Destroy a pool, destroying entries that were never processed
+ * @param pool Pool to destroy
+ */
+void work_pool_destroy(work_pool_t* pool);
+
+/**
+ * @brief Submit entries (thread-safe)
+ *
+ * Entries are split into batches of WORK_POOL_BATCH. The pool owns the
+ * entries afterwards; if it is stopped they are destroyed.
+ *
+ * @param pool Pool
+ * @param entries Entries to submit
+ * @param count Number of entries
+ * @param affinity Worker affinity, or WORK_POOL_ANY for round-robin
+ * @return 0 on success, -1 if entries were dropped
+ */
+int work_pool_submit(work_pool_t* pool, log_entry_t** entries, size_t count,
+                     uint64_t affinity);
+
+/**
+ * @brief Number of entries submitted but not yet taken by a worker
+ * @param pool Pool
+ * @return Pending entries
+ */
+size_t work_pool_pending(const work_pool_t* pool);
+
+#endif // WORK_POOL_H
+
@@ -0,0 +1,268 @@
+#include "alert_dedup.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NORMALIZE_CHUNK 256
+#define UUID_LENGTH 36
+#define MIN_HEX_ID_LENGTH 8
+
+// Normalized text is hashed in chunks, so messages of any length fit
+typedef struct {
+    char buf[NORMALIZE_CHUNK];
+    size_t len;
+    uint64_t hash;
+} normalizer_t;
+
+static void normalizer_put(normalizer_t* norm, char c) {
+    if (norm->len == sizeof(norm->buf)) {
+        norm->hash = hash64(norm->buf, norm->len, norm->hash);
+        norm->len = 0;
+    }
+    norm->buf[norm->len++] = c;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_hex(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool is_alnum(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// 8-4-4-4-12 hex digits
+static size_t match_uuid(const char* s) {
+    for (size_t i = 0; i < UUID_LENGTH; i++) {
+        bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+        if (dash ? s[i] != '-' : !is_hex(s[i])) {
+            return 0;
+        }
+    }
+    return is_alnum(s[UUID_LENGTH]) ? 0 : UUID_LENGTH;
+}
+
+// 0x-prefixed hex, or a whole word of at least 8 hex digits with a digit
+// among them (so plain words such as "deadbeef" or "accepted" survive)
+static size_t match_hex_id(const char* s) {
+    size_t i = 0;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X') && is_hex(s[2])) {
+        i = 2;
+        while (is_hex(s[i])) {
+            i++;
+        }
+        return i;
+    }
+
+    bool has_digit = false;
+    while (is_hex(s[i])) {
+        has_digit |= is_digit(s[i]);
+        i++;
+    }
+    return i >= MIN_HEX_ID_LENGTH && has_digit && !is_alnum(s[i]) ? i : 0;
+}
+
+uint64_t alert_dedup_fingerprint(log_level_t level, const char* source, const char* message) {
+    normalizer_t norm;
+    norm.len = 0;
+    norm.hash = source ? hash64(source, log_entry_source_class_len(source), (uint64_t)level + 1)
+                       : (uint64_t)level + 1;
+    if (!message) {
+        return norm.hash;
+    }
+
+    // Variable tokens become '#': UUIDs and hex IDs at word starts, digit
+    // runs anywhere (which also covers IPv4 addresses and decimals)
+    bool word_start = true;
+    const char* p = message;
+    while (*p) {
+        if (word_start && is_hex(*p)) {
+            size_t n = match_uuid(p);
+            if (n == 0) {
+                n = match_hex_id(p);
+            }
+            if (n > 0) {
+                normalizer_put(&norm, '#');
+                p += n;
+                word_start = false;
+                continue;
+            }
+        }
+        if (is_digit(*p)) {
+            while (is_digit(*p)) {
+                p++;
+            }
+            normalizer_put(&norm, '#');
+            word_start = false;
+            continue;
+        }
+
+        normalizer_put(&norm, *p);
+        word_start = !is_alnum(*p);
+        p++;
+    }
+
+    return hash64(norm.buf, norm.len, norm.hash);
+}
+
+static void copy_truncated(char* dst, size_t size, const char* src) {
+    if (!src) {
+        dst[0] = '\0';
+        return;
+    }
+
+    size_t len = strlen(src);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void summarize(alert_dedup_t* dedup, alert_dedup_slot_t* slot, int64_t now) {
+    if (slot->repeats == 0) {
+        return;
+    }
+
+    dedup->summary(dedup->ctx, slot, slot->repeats, now - slot->window_start);
+    metrics_add(dedup->summaries, 1);
+    slot->repeats = 0;
+}
+
+// Ends the slot's window if it is over: a window with repeats is
+// summarized and followed by a new one, a quiet window ends the storm
+static void expire(alert_dedup_t* dedup, alert_dedup_slot_t* slot, int64_t now) {
+    if (!slot->storming || now - slot->window_start < dedup->window) {
+        return;
+    }
+
+    if (slot->repeats > 0) {
+        summarize(dedup, slot, now);
+        slot->window_start = now;
+    } else {
+        slot->storming = false;
+    }
+}
+
+int alert_dedup_init(alert_dedup_t* dedup, size_t capacity, int64_t window,
+                     alert_dedup_summary_fn summary, void* ctx) {
+    if (!dedup || capacity == 0 || window <= 0 || !summary) {
+        return -1;
+    }
+
+    memset(dedup, 0, sizeof(alert_dedup_t));
+    size_t buckets = 1;
+    while (buckets * ALERT_DEDUP_WAYS < capacity) {
+        buckets <<= 1;
+    }
+
+    dedup->slots = (alert_dedup_slot_t*)calloc(buckets * ALERT_DEDUP_WAYS, sizeof(alert_dedup_slot_t));
+    if (!dedup->slots) {
+        return -1;
+    }
+
+    dedup->num_buckets = buckets;
+    dedup->window = window;
+    dedup->summary = summary;
+    dedup->ctx = ctx;
+    dedup->suppressed = metrics_register("alerter.suppressed", METRIC_COUNTER);
+    dedup->summaries = metrics_register("alerter.summaries", METRIC_COUNTER);
+    dedup->evictions = metrics_register("alerter.dedup_evictions", METRIC_COUNTER);
+
+    return 0;
+}
+
+void alert_dedup_destroy(alert_dedup_t* dedup) {
+    if (!dedup) {
+        return;
+    }
+
+    free(dedup->slots);
+    memset(dedup, 0, sizeof(alert_dedup_t));
+}
+
+bool alert_dedup_admit(alert_dedup_t* dedup, const log_entry_t* entry, int64_t now) {
+    if (!dedup || !dedup->slots || !entry) {
+        return true;
+    }
+
+    // A mined template already identifies the message shape
+    uint64_t fingerprint;
+    if (entry->template_id != 0) {
+        fingerprint = alert_dedup_fingerprint(entry->level, entry->source, NULL) ^
+                      hash64_mix(entry->template_id);
+    } else {
+        fingerprint = alert_dedup_fingerprint(entry->level, entry->source, entry->message);
+    }
+    alert_dedup_slot_t* bucket =
+        &dedup->slots[(fingerprint & (dedup->num_buckets - 1)) * ALERT_DEDUP_WAYS];
+
+    alert_dedup_slot_t* victim = NULL;
+    for (size_t i = 0; i < ALERT_DEDUP_WAYS; i++) {
+        alert_dedup_slot_t* slot = &bucket[i];
+        if (!slot->used) {
+            if (!victim || victim->used) {
+                victim = slot;
+            }
+            continue;
+        }
+
+        if (slot->fingerprint == fingerprint) {
+            expire(dedup, slot, now);
+            slot->last_seen = now;
+            if (slot->storming) {
+                slot->repeats++;
+                metrics_add(dedup->suppressed, 1);
+                return false;
+            }
+            slot->storming = true;
+            slot->window_start = now;
+            return true;
+        }
+
+        if (!victim || (victim->used && slot->last_seen < victim->last_seen)) {
+            victim = slot;
+        }
+    }
+
+    // New fingerprint: take a free way or evict the least recently seen
+    if (victim->used) {
+        summarize(dedup, victim, now);
+        metrics_add(dedup->evictions, 1);
+    }
+
+    victim->fingerprint = fingerprint;
+    victim->used = true;
+    victim->storming = true;
+    victim->window_start = now;
+    victim->last_seen = now;
+    victim->repeats = 0;
+    victim->level = entry->level;
+    copy_truncated(victim->source, sizeof(victim->source), entry->source);
+    copy_truncated(victim->sample, sizeof(victim->sample), entry->message);
+    return true;
+}
+
+void alert_dedup_flush(alert_dedup_t* dedup, int64_t now, bool all) {
+    if (!dedup || !dedup->slots) {
+        return;
+    }
+
+    size_t count = dedup->num_buckets * ALERT_DEDUP_WAYS;
+    for (size_t i = 0; i < count; i++) {
+        alert_dedup_slot_t* slot = &dedup->slots[i];
+        if (!slot->used) {
+            continue;
+        }
+        if (all) {
+            summarize(dedup, slot, now);
+        } else {
+            expire(dedup, slot, now);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "alert_encoder.h"
+#include "hash.h"
+#include <stdbool.h>
+#include <string.h>
+
+// Escape for each byte: 0 (copied as is), a short escape letter or 'u'
+static const char ESCAPES[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+};
+
+static const char* RULE_KINDS[] = {NULL, "field", "rate", "sequence"};
+
+// Append to p, giving up (return 0) when the line does not fit before end
+#define PUT(data, length) \
+    do { \
+        size_t length_ = (length); \
+        if ((size_t)(end - p) < length_) { \
+            return 0; \
+        } \
+        memcpy(p, data, length_); \
+        p += length_; \
+    } while (0)
+#define PUT_LITERAL(text) PUT(text, sizeof(text) - 1)
+#define PUT_U64(value) \
+    do { \
+        char digits_[20]; \
+        size_t count_ = format_u64(digits_ + sizeof(digits_), value); \
+        PUT(digits_ + sizeof(digits_) - count_, count_); \
+    } while (0)
+
+// Digits of value, written backwards ending at end
+static inline size_t format_u64(char* end, uint64_t value) {
+    char* p = end;
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    return (size_t)(end - p);
+}
+
+// Escape length bytes of text, producing at most *budget bytes (*whole is
+// cleared if it had to be cut); NULL if end is reached first
+static char* put_escaped(char* p, char* end, const char* text, size_t length_in, size_t* budget,
+                         bool* whole) {
+    static const char HEX[] = "0123456789abcdef";
+    const unsigned char* in = (const unsigned char*)text;
+    const unsigned char* stop = in + length_in;
+    while (in < stop) {
+        const unsigned char* run = in;
+        while (in < stop && ESCAPES[*in] == 0) {
+            in++;
+        }
+        size_t length = (size_t)(in - run);
+        if (length > *budget) {
+            // Never split a UTF-8 sequence
+            length = *budget;
+            while (length > 0 && run + length < stop && (run[length] & 0xC0) == 0x80) {
+                length--;
+            }
+            *whole = false;
+            in = run + length;
+        }
+        if ((size_t)(end - p) < length) {
+            return NULL;
+        }
+        memcpy(p, run, length);
+        p += length;
+        *budget -= length;
+        if (!*whole || in == stop) {
+            break;
+        }
+
+        size_t escape_len = ESCAPES[*in] == 'u' ? 6 : 2;
+        if (escape_len > *budget) {
+            *whole = false;
+            break;
+        }
+        if ((size_t)(end - p) < escape_len) {
+            return NULL;
+        }
+        p[0] = '\\';
+        p[1] = ESCAPES[*in];
+        if (escape_len == 6) {
+            p[2] = '0';
+            p[3] = '0';
+            p[4] = HEX[*in >> 4];
+            p[5] = HEX[*in & 0xF];
+        }
+        p += escape_len;
+        *budget -= escape_len;
+        in++;
+    }
+    return p;
+}
+
+int alert_format_parse(const char* text, alert_format_t* format) {
+    if (!text || !format) {
+        return -1;
+    }
+    if (strcmp(text, "text") == 0) {
+        *format = ALERT_FORMAT_TEXT;
+    } else if (strcmp(text, "json") == 0) {
+        *format = ALERT_FORMAT_JSON;
+    } else if (strcmp(text, "binary") == 0) {
+        *format = ALERT_FORMAT_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char* alert_format_to_string(alert_format_t format) {
+    switch (format) {
+        case ALERT_FORMAT_JSON: return "json";
+        case ALERT_FORMAT_BINARY: return "binary";
+        default: return "text";
+    }
+}
+
+uint32_t alert_source_id(const char* source) {
+    return source ? (uint32_t)hash64(source, strlen(source), 0) : 0;
+}
+
+size_t alert_encode_json(char* out, size_t size, const alert_line_t* line, size_t max_message) {
+    char* p = out;
+    char* end = out + size;
+    bool whole = true;
+    size_t budget = SIZE_MAX;
+
+    PUT_LITERAL("{\"ts\":");
+    if (line->timestamp < 0) {
+        PUT_LITERAL("-");
+        PUT_U64((uint64_t)0 - (uint64_t)line->timestamp);
+    } else {
+        PUT_U64((uint64_t)line->timestamp);
+    }
+    PUT_LITERAL(",\"level\":\"");
+    const char* level = log_entry_level_to_string(line->level);
+    PUT(level, strlen(level));
+    PUT_LITERAL("\",\"source\":\"");
+    if (!(p = put_escaped(p, end, line->source, strlen(line->source), &budget, &whole))) {
+        return 0;
+    }
+    PUT_LITERAL("\",\"source_id\":");
+    PUT_U64(alert_source_id(line->source));
+    PUT_LITERAL(",\"message\":\"");
+    budget = max_message;
+    if (!(p = put_escaped(p, end, line->message, strlen(line->message), &budget, &whole))) {
+        return 0;
+    }
+    if (whole && line->suffix &&
+        !(p = put_escaped(p, end, line->suffix, strlen(line->suffix), &budget, &whole))) {
+        return 0;
+    }
+    PUT_LITERAL("\"");
+
+    if (line->template_id != 0) {
+        PUT_LITERAL(",\"template_id\":");
+        PUT_U64(line->template_id);
+    }
+    log_rule_kind_t kind = LOG_RULE_KIND(line->rule_id);
+    if (line->rule_id != 0 && kind > LOG_RULE_NONE && kind <= LOG_RULE_SEQUENCE) {
+        PUT_LITERAL(",\"rule\":\"");
+        PUT(RULE_KINDS[kind], strlen(RULE_KINDS[kind]));
+        PUT_LITERAL(":");
+        PUT_U64(LOG_RULE_NUMBER(line->rule_id));
+        PUT_LITERAL("\"");
+    }
+    if (line->patterns != 0) {
+        PUT_LITERAL(",\"patterns\":[");
+        for (uint64_t patterns = line->patterns; patterns; patterns &= patterns - 1) {
+            if (patterns != line->patterns) {
+                PUT_LITERAL(",");
+            }
+            PUT_U64((uint64_t)__builtin_ctzll(patterns) + 1);
+        }
+        PUT_LITERAL("]");
+    }
+    if (line->context) {
+        // Context lines are never cut; the caller drops them if they do not fit
+        const log_context_t* context = line->context;
+        for (uint32_t i = 0; i < context->num_lines; i++) {
+            if (i == 0 || i == context->num_before) {
+                if (i > 0) {
+                    PUT_LITERAL("]");
+                }
+                if (i < context->num_before) {
+                    PUT_LITERAL(",\"before\":[\"");
+                } else {
+                    PUT_LITERAL(",\"after\":[\"");
+                }
+            } else {
+                PUT_LITERAL(",\"");
+            }
+            size_t unlimited = SIZE_MAX;
+            bool complete = true;
+            if (!(p = put_escaped(p, end, LOG_CONTEXT_TEXT(context, i), context->lines[i].length,
+                                  &unlimited, &complete))) {
+                return 0;
+            }
+            PUT_LITERAL("\"");
+        }
+        if (context->num_lines > 0) {
+            PUT_LITERAL("]");
+        }
+    }
+    if (!whole) {
+        PUT_LITERAL(",\"truncated\":true");
+    }
+    PUT_LITERAL("}\n");
+    return (size_t)(p - out);
+}
+
+size_t alert_encode_json_note(char* out, size_t size, int64_t timestamp, uint64_t skipped) {
+    char* p = out;
+    char* end = out + size;
+    PUT_LITERAL("{\"ts\":");
+    if (timestamp < 0) {
+        PUT_LITERAL("-");
+        PUT_U64((uint64_t)0 - (uint64_t)timestamp);
+    } else {
+        PUT_U64((uint64_t)timestamp);
+    }
+    PUT_LITERAL(",\"note\":\"rate_limit\",\"skipped\":");
+    PUT_U64(skipped);
+    PUT_LITERAL("}\n");
+    return (size_t)(p - out);
+}
+
+static inline void store_le(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+size_t alert_encode_binary_header(uint8_t* out, int type, const alert_line_t* line) {
+    size_t source_len = strlen(line->source);
+    if (source_len > UINT16_MAX) {
+        source_len = UINT16_MAX;
+    }
+    size_t message_len = strlen(line->message) + (line->suffix ? strlen(line->suffix) : 0);
+    size_t total = ALERT_BINARY_HEADER + source_len + message_len;
+
+    store_le(out, total - 4, 4);
+    out[4] = (uint8_t)type;
+    out[5] = (uint8_t)line->level;
+    store_le(out + 6, source_len, 2);
+    store_le(out + 8, (uint64_t)line->timestamp, 8);
+    store_le(out + 16, type == ALERT_BINARY_ALERT ? alert_source_id(line->source) : 0, 4);
+    store_le(out + 20, line->template_id, 4);
+    store_le(out + 24, line->rule_id, 4);
+    store_le(out + 28, line->patterns, 8);
+    store_le(out + 36, message_len, 4);
+    return total;
+}
+
+size_t alert_encode_binary_context(uint8_t* out, const alert_line_t* line, uint32_t index) {
+    const log_context_line_t* context_line = &line->context->lines[index];
+    size_t source_len = strlen(line->source);
+    if (source_len > UINT16_MAX) {
+        source_len = UINT16_MAX;
+    }
+    size_t total = ALERT_BINARY_HEADER + source_len + context_line->length;
+
+    memset(out, 0, ALERT_BINARY_HEADER);
+    store_le(out, total - 4, 4);
+    out[4] = index < line->context->num_before ? ALERT_BINARY_BEFORE : ALERT_BINARY_AFTER;
+    out[5] = (uint8_t)context_line->level;
+    store_le(out + 6, source_len, 2);
+    store_le(out + 8, (uint64_t)context_line->timestamp, 8);
+    store_le(out + 16, alert_source_id(line->source), 4);
+    store_le(out + 36, context_line->length, 4);
+    return total;
+}
\ No newline at end of file
@@ -0,0 +1,608 @@
+#include "alert_sink.h"
+#include "alert_writer.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Records moved from the ring per lock acquisition
+#define SINK_TAKE 256
+// First retry delay after a failed delivery
+#define SINK_RETRY_MIN_NS (100 * 1000000LL)
+// Parts sent with the HTTP header; the rest of a long record follows
+#define SINK_MAX_PARTS 16
+// Failed deliveries of one record before it is dropped
+#define SINK_RECORD_ATTEMPTS 5
+
+// HTTP body type by alert_format_t
+static const char* CONTENT_TYPES[] = {"text/plain", "application/x-ndjson",
+                                      "application/octet-stream"};
+
+alert_record_t* alert_record_create(const alert_line_t* line) {
+    if (!line || !line->source || !line->message) {
+        return NULL;
+    }
+    const char* suffix = line->suffix ? line->suffix : "";
+
+    size_t source_len = strlen(line->source) + 1;
+    size_t message_len = strlen(line->message) + 1;
+    size_t suffix_len = strlen(suffix) + 1;
+    // The context block goes last, aligned for its line table
+    size_t context_at = (sizeof(alert_record_t) + source_len + message_len + suffix_len + 7) &
+                        ~(size_t)7;
+    size_t context_size = line->context ? line->context->size : 0;
+    alert_record_t* record = (alert_record_t*)malloc(context_at + context_size);
+    if (!record) {
+        return NULL;
+    }
+
+    char* strings = (char*)(record + 1);
+    memcpy(strings, line->source, source_len);
+    memcpy(strings + source_len, line->message, message_len);
+    memcpy(strings + source_len + message_len, suffix, suffix_len);
+    record->refs = 1;
+    record->line = *line;
+    record->line.source = strings;
+    record->line.message = strings + source_len;
+    record->line.suffix = strings + source_len + message_len;
+    if (line->context) {
+        memcpy((char*)record + context_at, line->context, context_size);
+        record->line.context = (const log_context_t*)((char*)record + context_at);
+    }
+    return record;
+}
+
+void alert_record_release(alert_record_t* record) {
+    if (record && __atomic_sub_fetch(&record->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(record);
+    }
+}
+
+// Send every part, resuming after partial sends (no SIGPIPE on a closed peer)
+static int send_all(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = (size_t)count;
+        ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + sent;
+            iov->iov_len -= (size_t)sent;
+        }
+    }
+    return 0;
+}
+
+static void close_connection(alert_sink_t* sink) {
+    if (sink->fd >= 0) {
+        close(sink->fd);
+        sink->fd = -1;
+    }
+}
+
+static void set_timeouts(int fd, int timeout_ms) {
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    // Also bounds a blocking connect()
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+static int connect_unix(alert_sink_t* sink) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(sink->target) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    strcpy(address.sun_path, sink->target);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    set_timeouts(fd, sink->timeout_ms);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int connect_tcp(alert_sink_t* sink) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses;
+    if (getaddrinfo(sink->host, sink->port, &hints, &addresses) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        set_timeouts(fd, sink->timeout_ms);
+        if (connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+// Reuse the connection unless the peer has closed it
+static int ensure_connected(alert_sink_t* sink) {
+    if (sink->fd >= 0) {
+        char byte;
+        ssize_t peeked = recv(sink->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (peeked == 0 || (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            close_connection(sink);
+        }
+    }
+    if (sink->fd < 0) {
+        sink->fd = sink->type == SINK_UNIX ? connect_unix(sink) : connect_tcp(sink);
+    }
+    return sink->fd >= 0 ? 0 : -1;
+}
+
+static int deliver_socket(alert_sink_t* sink, struct iovec* iov, int count) {
+    if (ensure_connected(sink) != 0) {
+        return -1;
+    }
+    if (send_all(sink->fd, iov, count) != 0) {
+        close_connection(sink);
+        return -1;
+    }
+    return 0;
+}
+
+// One POST per batch; any 2xx status is a delivery, and a 4xx status
+// (or a request that cannot be built) rejects it for good
+static int deliver_http(alert_sink_t* sink, struct iovec* iov, int count) {
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        length += iov[i].iov_len;
+    }
+    char header[512];
+    int header_len = snprintf(header, sizeof(header),
+                              "POST %s HTTP/1.1\r\nHost: %s:%s\r\n"
+                              "Content-Type: %s\r\nContent-Length: %zu\r\n"
+                              "Connection: close\r\n\r\n",
+                              sink->path, sink->host, sink->port,
+                              CONTENT_TYPES[sink->writer.format], length);
+    if (header_len < 0 || (size_t)header_len >= sizeof(header)) {
+        sink->rejected = true;
+        return -1;
+    }
+    // An alert with context has hundreds of parts: they go in a second send
+    int first = count < SINK_MAX_PARTS - 1 ? count : SINK_MAX_PARTS - 1;
+    struct iovec parts[SINK_MAX_PARTS];
+    parts[0].iov_base = header;
+    parts[0].iov_len = (size_t)header_len;
+    memcpy(parts + 1, iov, (size_t)first * sizeof(struct iovec));
+
+    int fd = connect_tcp(sink);
+    if (fd < 0) {
+        return -1;
+    }
+    int result = -1;
+    if (send_all(fd, parts, first + 1) == 0 && send_all(fd, iov + first, count - first) == 0) {
+        // "HTTP/1.1 200 ..." is all that matters of the response
+        char status[16];
+        size_t received = 0;
+        while (received < 12) {
+            ssize_t n = recv(fd, status + received, 12 - received, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            received += (size_t)n;
+        }
+        if (received == 12 && strncmp(status, "HTTP/1.", 7) == 0 && status[9] == '2') {
+            result = 0;
+        } else if (received == 12 && strncmp(status, "HTTP/1.", 7) == 0 && status[9] == '4') {
+            sink->rejected = true;
+        }
+    }
+    close(fd);
+    return result;
+}
+
+static int sink_deliver(void* ctx, struct iovec* iov, int count) {
+    alert_sink_t* sink = (alert_sink_t*)ctx;
+    bool batch = count == 1 && iov[0].iov_base == sink->writer.data;
+    size_t lines = batch ? sink->writer.lines : 1;
+
+    sink->rejected = false;
+    int result;
+    switch (sink->type) {
+        case SINK_FILE:
+            result = file_rotator_write(&sink->file, iov, count, timestamp_now());
+            break;
+        case SINK_STDOUT:
+            // Keep the order of anything already printed through stdio
+            fflush(stdout);
+            result = alert_write_fd(STDOUT_FILENO, iov, count);
+            break;
+        case SINK_HTTP:
+            result = deliver_http(sink, iov, count);
+            break;
+        default:
+            result = deliver_socket(sink, iov, count);
+            break;
+    }
+
+    if (result != 0) {
+        metrics_add(sink->failures, 1);
+        return -1;
+    }
+    metrics_add(sink->sent, lines);
+    metrics_add(sink->flushes, 1);
+    if (batch) {
+        sink->batch_start = 0;
+    }
+    return 0;
+}
+
+// Split "host:port" (or the authority of an HTTP URL) and the request path
+static int parse_target(alert_sink_t* sink) {
+    const char* authority = sink->target;
+    const char* end = authority + strlen(authority);
+    if (sink->type == SINK_HTTP) {
+        authority += 7; // "http://"
+        const char* slash = strchr(authority, '/');
+        if (slash) {
+            end = slash;
+        }
+        sink->path = strdup(slash ? slash : "/");
+        if (!sink->path) {
+            return -1;
+        }
+    }
+
+    const char* colon = memchr(authority, ':', (size_t)(end - authority));
+    sink->host = strndup(authority, (size_t)((colon ? colon : end) - authority));
+    sink->port = colon ? strndup(colon + 1, (size_t)(end - colon - 1)) : strdup("80");
+    return sink->host && sink->port ? 0 : -1;
+}
+
+int alert_sink_init(alert_sink_t* sink, const sink_spec_t* spec, const config_t* config) {
+    if (!sink || !spec || !spec->name || !config) {
+        return -1;
+    }
+
+    memset(sink, 0, sizeof(alert_sink_t));
+    sink->fd = -1;
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->wake, NULL);
+    sink->type = spec->type;
+    sink->capacity = spec->queue_size > 0 ? spec->queue_size : config->alert_sink_queue;
+    sink->flush_ns = (int64_t)config->alert_flush_ms * 1000000;
+    sink->retry_delay = SINK_RETRY_MIN_NS;
+    sink->retry_max = (int64_t)config->alert_sink_retry_max_ms * 1000000;
+    if (sink->retry_max < SINK_RETRY_MIN_NS) {
+        sink->retry_max = SINK_RETRY_MIN_NS;
+    }
+    sink->timeout_ms = config->alert_sink_timeout_ms > 0 ? config->alert_sink_timeout_ms : 1;
+    size_t buffer_size = spec->buffer_size > 0 ? spec->buffer_size : config->alert_buffer_size;
+    // The console stays readable unless a format is asked for
+    alert_format_t format = spec->has_format ? spec->format
+        : sink->type == SINK_STDOUT ? ALERT_FORMAT_TEXT : config->alert_format;
+
+    sink->name = strdup(spec->name);
+    sink->target = spec->target ? strdup(spec->target) : NULL;
+    sink->ring = sink->capacity > 0
+        ? (alert_record_t**)calloc(sink->capacity, sizeof(alert_record_t*)) : NULL;
+    if (!sink->name || (spec->target && !sink->target) || !sink->ring ||
+        (sink->target && sink->type != SINK_FILE && sink->type != SINK_UNIX &&
+         parse_target(sink) != 0) ||
+        alert_writer_init(&sink->writer, sink_deliver, sink, format,
+                          sink->type == SINK_STDOUT ? "[ALERT] " : NULL, buffer_size,
+                          spec->rate) != 0) {
+        alert_sink_destroy(sink);
+        return -1;
+    }
+
+    char name[METRICS_NAME_MAX];
+    snprintf(name, sizeof(name), "alerts.sink.%s", sink->name);
+    if (sink->type == SINK_FILE && file_rotator_open(&sink->file, name, sink->target, config) != 0) {
+        alert_sink_destroy(sink);
+        return -1;
+    }
+
+    snprintf(name, sizeof(name), "alerts.sink.%s.sent", sink->name);
+    sink->sent = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "alerts.sink.%s.dropped", sink->name);
+    sink->dropped = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "alerts.sink.%s.suppressed", sink->name);
+    sink->suppressed = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "alerts.sink.%s.flushes", sink->name);
+    sink->flushes = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "alerts.sink.%s.failures", sink->name);
+    sink->failures = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "alerts.sink.%s.retries", sink->name);
+    sink->retries = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "alerts.sink.%s.queued", sink->name);
+    sink->queued = metrics_register(name, METRIC_GAUGE);
+    metrics_set(sink->queued, 0);
+    return 0;
+}
+
+bool alert_sink_enqueue(alert_sink_t* sink, alert_record_t* record) {
+    if (!sink || !sink->ring || !record) {
+        return false;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    if (sink->count == sink->capacity) {
+        pthread_mutex_unlock(&sink->lock);
+        metrics_add(sink->dropped, 1);
+        return false;
+    }
+    __atomic_add_fetch(&record->refs, 1, __ATOMIC_RELAXED);
+    sink->ring[(sink->head + sink->count) % sink->capacity] = record;
+    if (sink->count++ == 0) {
+        pthread_cond_signal(&sink->wake);
+    }
+    pthread_mutex_unlock(&sink->lock);
+    return true;
+}
+
+void alert_sink_tick(alert_sink_t* sink) {
+    if (!sink || !sink->ring || sink->writer.rate == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    sink->tick = true;
+    pthread_cond_signal(&sink->wake);
+    pthread_mutex_unlock(&sink->lock);
+}
+
+// Move queued records out of the ring (lock held)
+static size_t take_records(alert_sink_t* sink, alert_record_t** records, bool* more) {
+    size_t taken = 0;
+    while (taken < SINK_TAKE && sink->count > 0) {
+        records[taken++] = sink->ring[sink->head];
+        sink->head = (sink->head + 1) % sink->capacity;
+        sink->count--;
+    }
+    *more = sink->count > 0;
+    metrics_set(sink->queued, sink->count);
+    return taken;
+}
+
+static void delivery_failed(alert_sink_t* sink, int64_t now) {
+    sink->retry_at = now + sink->retry_delay;
+    sink->retry_delay = sink->retry_delay * 2 < sink->retry_max
+        ? sink->retry_delay * 2 : sink->retry_max;
+}
+
+// A batch the destination rejected would be rejected again: drop it
+static bool drop_rejected_batch(alert_sink_t* sink) {
+    if (!sink->rejected || sink->writer.used == 0) {
+        return false;
+    }
+    metrics_add(sink->dropped, sink->writer.lines);
+    sink->writer.used = 0;
+    sink->writer.lines = 0;
+    return true;
+}
+
+// Batch records and deliver (lock not held); stops at the first failure
+static void deliver_records(alert_sink_t* sink, alert_record_t** records, size_t* next,
+                            size_t taken, bool more) {
+    int64_t now = timestamp_now();
+    if (sink->retry_at != 0) {
+        metrics_add(sink->retries, 1);
+        if (alert_writer_flush(&sink->writer) != 0 && !drop_rejected_batch(sink)) {
+            delivery_failed(sink, now);
+            return;
+        }
+        sink->retry_at = 0;
+        sink->retry_delay = SINK_RETRY_MIN_NS;
+    }
+
+    while (*next < taken) {
+        alert_record_t* record = records[*next];
+        int result = alert_writer_append(&sink->writer, &record->line, now);
+        if (result < 0 && drop_rejected_batch(sink)) {
+            continue;
+        }
+        // An empty batch means the record itself failed (it was too large
+        // to batch): drop it once rejected or out of attempts, so it
+        // cannot stall the sink
+        if (result < 0 && sink->writer.used == 0 &&
+            (sink->rejected || ++sink->attempts >= SINK_RECORD_ATTEMPTS)) {
+            metrics_add(sink->dropped, 1);
+            result = 0;
+        } else if (result < 0) {
+            delivery_failed(sink, now);
+            return;
+        }
+        sink->attempts = 0;
+        if (result == 1) {
+            metrics_add(sink->suppressed, 1);
+        }
+        if (sink->writer.used > 0 && sink->batch_start == 0) {
+            sink->batch_start = now;
+        }
+        alert_record_release(record);
+        (*next)++;
+    }
+
+    // Group commit: keep batching while records are queued, within alert_flush_ms
+    if ((!more || now - sink->batch_start >= sink->flush_ns) &&
+        alert_writer_flush(&sink->writer) != 0 && !drop_rejected_batch(sink)) {
+        delivery_failed(sink, now);
+    }
+}
+
+// Last attempt at everything left; what cannot be delivered is dropped
+static void drain(alert_sink_t* sink, alert_record_t** records, size_t next, size_t taken) {
+    int64_t now = timestamp_now();
+    bool delivering = alert_writer_flush(&sink->writer) == 0;
+    alert_record_t* rest[SINK_TAKE];
+    bool more = true;
+
+    while (next < taken || more) {
+        if (next == taken) {
+            pthread_mutex_lock(&sink->lock);
+            taken = take_records(sink, rest, &more);
+            pthread_mutex_unlock(&sink->lock);
+            records = rest;
+            next = 0;
+            continue;
+        }
+        alert_record_t* record = records[next++];
+        int result = delivering ? alert_writer_append(&sink->writer, &record->line, now) : -1;
+        if (result < 0) {
+            delivering = false;
+            metrics_add(sink->dropped, 1);
+        } else if (result == 1) {
+            metrics_add(sink->suppressed, 1);
+        }
+        alert_record_release(record);
+    }
+
+    if (!delivering || alert_writer_close(&sink->writer) != 0) {
+        metrics_add(sink->dropped, sink->writer.lines);
+        sink->writer.used = 0;
+        sink->writer.lines = 0;
+    }
+    sink->retry_at = 0;
+    close_connection(sink);
+}
+
+static void* alert_sink_thread_func(void* arg) {
+    alert_sink_t* sink = (alert_sink_t*)arg;
+    alert_record_t* records[SINK_TAKE];
+    size_t taken = 0;
+    size_t next = 0;
+    bool more = false;
+
+    pthread_mutex_lock(&sink->lock);
+    while (true) {
+        if (next == taken) {
+            taken = take_records(sink, records, &more);
+            next = 0;
+        }
+
+        // Idle, or backing off after a failure
+        bool backoff = sink->retry_at != 0 && timestamp_now() < sink->retry_at;
+        if (backoff || (taken == 0 && sink->retry_at == 0 && !sink->tick)) {
+            if (!sink->running) {
+                break;
+            }
+            if (backoff) {
+                struct timespec deadline;
+                deadline.tv_sec = (time_t)(sink->retry_at / TIMESTAMP_NS_PER_SEC);
+                deadline.tv_nsec = (long)(sink->retry_at % TIMESTAMP_NS_PER_SEC);
+                pthread_cond_timedwait(&sink->wake, &sink->lock, &deadline);
+            } else {
+                pthread_cond_wait(&sink->wake, &sink->lock);
+            }
+            continue;
+        }
+        bool tick = sink->tick;
+        sink->tick = false;
+        pthread_mutex_unlock(&sink->lock);
+
+        // On failure the note stays pending and the batch is retried below
+        if (tick) {
+            alert_writer_tick(&sink->writer, timestamp_now());
+        }
+        deliver_records(sink, records, &next, taken, more);
+
+        pthread_mutex_lock(&sink->lock);
+    }
+    pthread_mutex_unlock(&sink->lock);
+
+    drain(sink, records, next, taken);
+    return NULL;
+}
+
+int alert_sink_start(alert_sink_t* sink) {
+    if (!sink || !sink->ring || sink->started) {
+        return -1;
+    }
+
+    sink->running = true;
+    if (pthread_create(&sink->thread, NULL, alert_sink_thread_func, sink) != 0) {
+        sink->running = false;
+        return -1;
+    }
+    sink->started = true;
+    return 0;
+}
+
+void alert_sink_stop(alert_sink_t* sink) {
+    if (!sink || !sink->ring) {
+        return;
+    }
+
+    if (!sink->started) {
+        drain(sink, NULL, 0, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    sink->running = false;
+    pthread_cond_signal(&sink->wake);
+    pthread_mutex_unlock(&sink->lock);
+
+    pthread_join(sink->thread, NULL);
+    sink->started = false;
+}
+
+void alert_sink_destroy(alert_sink_t* sink) {
+    if (!sink || (!sink->ring && !sink->name)) {
+        return;
+    }
+
+    if (sink->ring && sink->writer.data) {
+        alert_sink_stop(sink);
+    }
+    pthread_cond_destroy(&sink->wake);
+    pthread_mutex_destroy(&sink->lock);
+    alert_writer_destroy(&sink->writer);
+    file_rotator_close(&sink->file);
+    if (sink->fd >= 0) {
+        close(sink->fd);
+    }
+    free(sink->ring);
+    free(sink->name);
+    free(sink->target);
+    free(sink->host);
+    free(sink->port);
+    free(sink->path);
+    memset(sink, 0, sizeof(alert_sink_t));
+    sink->fd = -1;
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "alert_writer.h"
+#include "context_ring.h"
+#include "timestamp.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Parts of a line: prefix "[" time "] [" level "] [" source "] " message suffix "\n"
+#define LINE_PARTS 11
+// Parts of a binary record: header source message suffix
+#define BINARY_PARTS 4
+
+int alert_write_fd(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    return 0;
+}
+
+int alert_writer_init(alert_writer_t* writer, alert_deliver_fn deliver, void* ctx,
+                      alert_format_t format, const char* prefix, size_t buffer_size,
+                      uint64_t rate) {
+    if (!writer || !deliver || buffer_size == 0) {
+        return -1;
+    }
+
+    memset(writer, 0, sizeof(alert_writer_t));
+    writer->data = (char*)malloc(buffer_size);
+    if (!writer->data) {
+        return -1;
+    }
+    writer->deliver = deliver;
+    writer->ctx = ctx;
+    writer->format = format;
+    writer->capacity = buffer_size;
+    writer->prefix = prefix ? prefix : "";
+    writer->prefix_len = strlen(writer->prefix);
+    writer->cached_second = (time_t)-1;
+    writer->rate = rate;
+    return 0;
+}
+
+void alert_writer_destroy(alert_writer_t* writer) {
+    if (!writer) {
+        return;
+    }
+    free(writer->data);
+    memset(writer, 0, sizeof(alert_writer_t));
+}
+
+int alert_writer_flush(alert_writer_t* writer) {
+    if (!writer || !writer->data) {
+        return -1;
+    }
+    if (writer->used == 0) {
+        return 0;
+    }
+
+    struct iovec iov = {writer->data, writer->used};
+    if (writer->deliver(writer->ctx, &iov, 1) != 0) {
+        return -1;
+    }
+    writer->used = 0;
+    writer->lines = 0;
+    return 0;
+}
+
+// Copy a line into the batch, or deliver it directly if it can never fit
+static int append_parts(alert_writer_t* writer, struct iovec* parts, int count) {
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        length += parts[i].iov_len;
+    }
+
+    if (writer->used + length > writer->capacity && alert_writer_flush(writer) != 0) {
+        return -1;
+    }
+    if (length > writer->capacity) {
+        return writer->deliver(writer->ctx, parts, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        memcpy(writer->data + writer->used, parts[i].iov_base, parts[i].iov_len);
+        writer->used += parts[i].iov_len;
+    }
+    writer->lines++;
+    return 0;
+}
+
+static void format_time(alert_writer_t* writer, int64_t timestamp) {
+    time_t seconds = (time_t)(timestamp / TIMESTAMP_NS_PER_SEC);
+    if (seconds == writer->cached_second) {
+        return;
+    }
+
+    struct tm timeinfo;
+    localtime_r(&seconds, &timeinfo);
+    writer->cached_time_len = strftime(writer->cached_time, sizeof(writer->cached_time),
+                                       "%Y-%m-%d %H:%M:%S", &timeinfo);
+    writer->cached_second = seconds;
+}
+
+// Encode a JSON line in place; a line that can never fit loses its
+// context, then has its message cut
+static int append_json(alert_writer_t* writer, const alert_line_t* line) {
+    size_t length = alert_encode_json(writer->data + writer->used,
+                                      writer->capacity - writer->used, line, SIZE_MAX);
+    if (length == 0) {
+        if (alert_writer_flush(writer) != 0) {
+            return -1;
+        }
+        length = alert_encode_json(writer->data, writer->capacity, line, SIZE_MAX);
+    }
+    if (length == 0 && line->context) {
+        alert_line_t bare = *line;
+        bare.context = NULL;
+        return append_json(writer, &bare);
+    }
+    if (length == 0) {
+        // Whatever is left after an empty message goes to the message
+        size_t fixed = alert_encode_json(writer->data, writer->capacity, line, 0);
+        if (fixed == 0) {
+            return 1;
+        }
+        length = alert_encode_json(writer->data, writer->capacity, line,
+                                   writer->capacity - fixed);
+    }
+    writer->used += length;
+    writer->lines++;
+    return 0;
+}
+
+// Context lines an alert can carry (every part of an alert goes in one append)
+static size_t context_lines(const alert_line_t* line) {
+    if (!line->context) {
+        return 0;
+    }
+    return line->context->num_lines < 2 * CONTEXT_RING_MAX_LINES
+        ? line->context->num_lines : 2 * CONTEXT_RING_MAX_LINES;
+}
+
+// Header, source, message and suffix copied into the batch, followed by a
+// record per context line
+static int append_binary(alert_writer_t* writer, int type, const alert_line_t* line) {
+    uint8_t headers[1 + 2 * CONTEXT_RING_MAX_LINES][ALERT_BINARY_HEADER];
+    struct iovec parts[BINARY_PARTS + 3 * 2 * CONTEXT_RING_MAX_LINES];
+    alert_encode_binary_header(headers[0], type, line);
+    size_t source_len = (size_t)headers[0][6] | (size_t)headers[0][7] << 8;
+    parts[0] = (struct iovec){headers[0], ALERT_BINARY_HEADER};
+    parts[1] = (struct iovec){(void*)line->source, source_len};
+    parts[2] = (struct iovec){(void*)line->message, strlen(line->message)};
+    parts[3] = (struct iovec){(void*)(line->suffix ? line->suffix : ""),
+                              line->suffix ? strlen(line->suffix) : 0};
+    int count = BINARY_PARTS;
+
+    size_t lines = context_lines(line);
+    for (size_t i = 0; i < lines; i++) {
+        alert_encode_binary_context(headers[i + 1], line, (uint32_t)i);
+        parts[count++] = (struct iovec){headers[i + 1], ALERT_BINARY_HEADER};
+        parts[count++] = (struct iovec){(void*)line->source, source_len};
+        parts[count++] = (struct iovec){(void*)LOG_CONTEXT_TEXT(line->context, i),
+                                        line->context->lines[i].length};
+    }
+    return append_parts(writer, parts, count);
+}
+
+static int append_text(alert_writer_t* writer, const alert_line_t* line) {
+    format_time(writer, line->timestamp);
+    const char* level_str = log_entry_level_to_string(line->level);
+    struct iovec parts[LINE_PARTS] = {
+        {(void*)writer->prefix, writer->prefix_len},
+        {(void*)"[", 1},
+        {writer->cached_time, writer->cached_time_len},
+        {(void*)"] [", 3},
+        {(void*)level_str, strlen(level_str)},
+        {(void*)"] [", 3},
+        {(void*)line->source, strlen(line->source)},
+        {(void*)"] ", 2},
+        {(void*)line->message, strlen(line->message)},
+        {(void*)(line->suffix ? line->suffix : ""), line->suffix ? strlen(line->suffix) : 0},
+        {(void*)"\n", 1},
+    };
+    size_t lines = context_lines(line);
+    if (lines == 0) {
+        return append_parts(writer, parts, LINE_PARTS);
+    }
+
+    // Raw context lines, indented and marked as before (-) or after (+)
+    struct iovec all[LINE_PARTS + 4 * 2 * CONTEXT_RING_MAX_LINES];
+    memcpy(all, parts, sizeof(parts));
+    int count = LINE_PARTS;
+    for (size_t i = 0; i < lines; i++) {
+        all[count++] = (struct iovec){(void*)writer->prefix, writer->prefix_len};
+        all[count++] = (struct iovec){(void*)(i < line->context->num_before ? "  - " : "  + "), 4};
+        all[count++] = (struct iovec){(void*)LOG_CONTEXT_TEXT(line->context, i),
+                                      line->context->lines[i].length};
+        all[count++] = (struct iovec){(void*)"\n", 1};
+    }
+    return append_parts(writer, all, count);
+}
+
+// Report the lines the rate limit held back
+static int append_note(alert_writer_t* writer) {
+    if (writer->rate_skipped == 0) {
+        return 0;
+    }
+
+    char note[96];
+    unsigned long long skipped = (unsigned long long)writer->rate_skipped;
+    int64_t timestamp = (int64_t)writer->rate_second * TIMESTAMP_NS_PER_SEC;
+    int result;
+    if (writer->format == ALERT_FORMAT_JSON) {
+        // Always fits: two numbers of at most 20 digits
+        struct iovec part = {note, alert_encode_json_note(note, sizeof(note), timestamp,
+                                                          writer->rate_skipped)};
+        result = append_parts(writer, &part, 1);
+    } else if (writer->format == ALERT_FORMAT_BINARY) {
+        snprintf(note, sizeof(note), "%llu more alerts not shown (rate limit)", skipped);
+        alert_line_t line = {timestamp, LOG_LEVEL_WARNING, "", note, NULL, 0, 0, 0, NULL};
+        result = append_binary(writer, ALERT_BINARY_NOTE, &line);
+    } else {
+        int length = snprintf(note, sizeof(note), "%s%llu more alerts not shown (rate limit)\n",
+                              writer->prefix, skipped);
+        struct iovec part = {note, (size_t)length};
+        result = append_parts(writer, &part, 1);
+    }
+    if (result != 0) {
+        return -1;
+    }
+    writer->rate_skipped = 0;
+    return 0;
+}
+
+int alert_writer_append(alert_writer_t* writer, const alert_line_t* line, int64_t now) {
+    if (!writer || !writer->data || !line || !line->source || !line->message) {
+        return -1;
+    }
+
+    if (writer->rate > 0) {
+        time_t second = (time_t)(now / TIMESTAMP_NS_PER_SEC);
+        if (second != writer->rate_second) {
+            if (append_note(writer) != 0) {
+                return -1;
+            }
+            writer->rate_second = second;
+            writer->rate_count = 0;
+        }
+        if (writer->rate_count >= writer->rate) {
+            writer->rate_skipped++;
+            return 1;
+        }
+    }
+
+    int result;
+    switch (writer->format) {
+        case ALERT_FORMAT_JSON:
+            result = append_json(writer, line);
+            break;
+        case ALERT_FORMAT_BINARY:
+            result = append_binary(writer, ALERT_BINARY_ALERT, line);
+            break;
+        default:
+            result = append_text(writer, line);
+            break;
+    }
+    if (result != 0) {
+        return result;
+    }
+    writer->rate_count++;
+    return 0;
+}
+
+int alert_writer_tick(alert_writer_t* writer, int64_t now) {
+    if (!writer || !writer->data) {
+        return -1;
+    }
+    time_t second = (time_t)(now / TIMESTAMP_NS_PER_SEC);
+    if (writer->rate_skipped == 0 || second == writer->rate_second) {
+        return 0;
+    }
+    if (append_note(writer) != 0) {
+        return -1;
+    }
+    writer->rate_second = second;
+    writer->rate_count = 0;
+    return 0;
+}
+
+int alert_writer_close(alert_writer_t* writer) {
+    if (!writer || !writer->data) {
+        return -1;
+    }
+    if (append_note(writer) != 0) {
+        return -1;
+    }
+    return alert_writer_flush(writer);
+}
\ No newline at end of file
@@ -1,15 +1,93 @@
 #include "alerter.h"
 #include "log_entry.h"
 #include "queue.h"
+#include "timestamp.h"
+#include "alert_dedup.h"
+#include "alert_sink.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <assert.h>
 #include <pthread.h>
 
+// How often ended dedup windows are summarized
+#define DEDUP_FLUSH_MS 1000
+
 // Forward declaration for thread function
 static void* alerter_thread_func(void* arg);
+static void write_summary(void* ctx, const alert_dedup_slot_t* slot, uint64_t repeats,
+                          int64_t elapsed);
+
+// The sinks configured, or the alert file and stdout echo
+static int init_sinks(alerter_t* alerter) {
+    config_t* config = alerter->config;
+    const sink_spec_t* specs = config->alert_sinks;
+    size_t count = config->num_alert_sinks;
+    sink_spec_t defaults[2];
+    if (count == 0) {
+        memset(defaults, 0, sizeof(defaults));
+        if (config->alert_file) {
+            defaults[count].name = (char*)"file";
+            defaults[count].type = SINK_FILE;
+            defaults[count].target = config->alert_file;
+            count++;
+        }
+        if (config->alert_stdout) {
+            defaults[count].name = (char*)"stdout";
+            defaults[count].type = SINK_STDOUT;
+            defaults[count].rate = config->alert_stdout_rate;
+            count++;
+        }
+        specs = defaults;
+    }
+    
+    alerter->sinks = (alert_sink_t*)calloc(count > 0 ? count : 1, sizeof(alert_sink_t));
+    if (!alerter->sinks) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(specs[i].name, specs[j].name) == 0) {
+                fprintf(stderr, "Duplicate alert sink %s\n", specs[i].name);
+                return -1;
+            }
+        }
+        if (alert_sink_init(&alerter->sinks[i], &specs[i], config) != 0) {
+            fprintf(stderr, "Failed to initialize alert sink %s\n", specs[i].name);
+            return -1;
+        }
+        alerter->num_sinks++;
+    }
+    return 0;
+}
+
+// Resolve route sink names into bit sets
+static int init_routes(alerter_t* alerter) {
+    config_t* config = alerter->config;
+    alerter->unrouted = alerter->num_sinks > 0 ? (1ULL << alerter->num_sinks) - 1 : 0;
+    alerter->route_sinks = (uint64_t*)calloc(config->num_alert_routes > 0
+                                             ? config->num_alert_routes : 1, sizeof(uint64_t));
+    if (!alerter->route_sinks) {
+        return -1;
+    }
+    
+    for (size_t r = 0; r < config->num_alert_routes; r++) {
+        const sink_route_t* route = &config->alert_routes[r];
+        for (size_t n = 0; n < route->num_sinks; n++) {
+            size_t i = 0;
+            while (i < alerter->num_sinks && strcmp(alerter->sinks[i].name, route->sinks[n]) != 0) {
+                i++;
+            }
+            if (i == alerter->num_sinks) {
+                fprintf(stderr, "Unknown alert sink %s in route %s\n", route->sinks[n], route->text);
+                return -1;
+            }
+            alerter->route_sinks[r] |= 1ULL << i;
+            alerter->unrouted &= ~(1ULL << i);
+        }
+    }
+    return 0;
+}
 
 int alerter_init(alerter_t* alerter, log_queue_t* alert_queue, config_t* config) {
     if (!alerter || !alert_queue || !config) {
@@ -19,13 +97,28 @@ int alerter_init(alerter_t* alerter, log_queue_t* alert_queue, config_t* config)
     alerter->alert_queue = alert_queue;
     alerter->config = config;
     alerter->running = false;
-    alerter->alert_file = NULL;
+    alerter->thread = 0;
+    alerter->dedup = NULL;
+    alerter->sinks = NULL;
+    alerter->num_sinks = 0;
+    alerter->route_sinks = NULL;
+    alerter->written = metrics_register("alerts.written", METRIC_COUNTER);
     
-    // Open alert file
-    if (config->alert_file) {
-        alerter->alert_file = fopen(config->alert_file, "a");
-        if (!alerter->alert_file) {
-            perror("Failed to open alert file");
+    // Open the alert file and other destinations
+    if (init_sinks(alerter) != 0 || init_routes(alerter) != 0) {
+        alerter_destroy(alerter);
+        return -1;
+    }
+    
+    if (config->alert_dedup_window > 0) {
+        alerter->dedup = (alert_dedup_t*)malloc(sizeof(alert_dedup_t));
+        if (!alerter->dedup ||
+            alert_dedup_init(alerter->dedup, config->alert_dedup_capacity,
+                             (int64_t)config->alert_dedup_window * TIMESTAMP_NS_PER_SEC,
+                             write_summary, alerter) != 0) {
+            free(alerter->dedup);
+            alerter->dedup = NULL;
+            alerter_destroy(alerter);
             return -1;
         }
     }
@@ -33,22 +126,78 @@ int alerter_init(alerter_t* alerter, log_queue_t* alert_queue, config_t* config)
     return 0;
 }
 
+// Fan an alert out to the sinks its routes select
+static void dispatch(alerter_t* alerter, log_entry_t* entry, int64_t timestamp,
+                     const char* suffix) {
+    uint64_t targets = alerter->unrouted;
+    for (size_t r = 0; r < alerter->config->num_alert_routes; r++) {
+        if ((targets & alerter->route_sinks[r]) != alerter->route_sinks[r] &&
+            sink_route_matches(&alerter->config->alert_routes[r], entry)) {
+            targets |= alerter->route_sinks[r];
+        }
+    }
+    if (targets == 0) {
+        return;
+    }
+    
+    alert_line_t line = {timestamp, entry->level, entry->source, entry->message, suffix,
+                         entry->template_id, entry->rule_id, entry->patterns, entry->context};
+    alert_record_t* record = alert_record_create(&line);
+    if (!record) {
+        return;
+    }
+    for (size_t i = 0; i < alerter->num_sinks; i++) {
+        if (targets & (1ULL << i)) {
+            alert_sink_enqueue(&alerter->sinks[i], record);
+        }
+    }
+    alert_record_release(record);
+    metrics_add(alerter->written, 1);
+}
+
 static void* alerter_thread_func(void* arg) {
     alerter_t* alerter = (alerter_t*)arg;
+    int64_t next_flush = timestamp_now() + (int64_t)DEDUP_FLUSH_MS * 1000000;
+    bool periodic = alerter->dedup != NULL;
+    for (size_t i = 0; i < alerter->num_sinks; i++) {
+        periodic = periodic || alerter->sinks[i].writer.rate > 0;
+    }
     
     while (alerter->running) {
-        log_entry_t* entry = queue_dequeue(alerter->alert_queue);
-        if (!entry) {
-            // If queue returned NULL, it might be shutdown
-            // Check running flag and exit if needed
-            if (!alerter->running) {
-                break;
+        // Wake up periodically so summaries and rate-limit notes go out
+        // after a storm ends
+        log_entry_t* entry = periodic
+            ? queue_dequeue_timeout(alerter->alert_queue, DEDUP_FLUSH_MS)
+            : queue_dequeue(alerter->alert_queue);
+        int64_t now = timestamp_now();
+        
+        if (entry) {
+            if (!alerter->dedup || alert_dedup_admit(alerter->dedup, entry, now)) {
+                dispatch(alerter, entry, entry->timestamp, "");
             }
-            continue;
+            log_entry_destroy(entry);
         }
         
-        alerter_write_alert(alerter, entry);
-        log_entry_destroy(entry);
+        if (periodic && now >= next_flush) {
+            if (alerter->dedup) {
+                alert_dedup_flush(alerter->dedup, now, false);
+            }
+            for (size_t i = 0; i < alerter->num_sinks; i++) {
+                alert_sink_tick(&alerter->sinks[i]);
+            }
+            next_flush = now + (int64_t)DEDUP_FLUSH_MS * 1000000;
+        }
+        
+        // If queue returned NULL, it might be shutdown
+        // Check running flag and exit if needed
+        if (!entry && !alerter->running) {
+            break;
+        }
+    }
+    
+    // Counts still pending would be lost otherwise
+    if (alerter->dedup) {
+        alert_dedup_flush(alerter->dedup, timestamp_now(), true);
     }
     
     return NULL;
@@ -63,9 +212,17 @@ int alerter_start(alerter_t* alerter) {
         return 0; // Alerts disabled
     }
     
+    for (size_t i = 0; i < alerter->num_sinks; i++) {
+        if (alert_sink_start(&alerter->sinks[i]) != 0) {
+            alerter_stop(alerter);
+            return -1;
+        }
+    }
+    
     alerter->running = true;
     if (pthread_create(&alerter->thread, NULL, alerter_thread_func, alerter) != 0) {
         alerter->running = false;
+        alerter_stop(alerter);
         return -1;
     }
     
@@ -80,6 +237,12 @@ void alerter_stop(alerter_t* alerter) {
     alerter->running = false;
     if (alerter->thread) {
         pthread_join(alerter->thread, NULL);
+        alerter->thread = 0; // Joined, safe to stop again
+    }
+    
+    // Sinks go last so they deliver what the alerter produced
+    for (size_t i = 0; i < alerter->num_sinks; i++) {
+        alert_sink_stop(&alerter->sinks[i]);
     }
 }
 
@@ -90,9 +253,34 @@ void alerter_destroy(alerter_t* alerter) {
     
     alerter_stop(alerter);
     
-    if (alerter->alert_file) {
-        fclose(alerter->alert_file);
-        alerter->alert_file = NULL;
+    for (size_t i = 0; i < alerter->num_sinks; i++) {
+        alert_sink_destroy(&alerter->sinks[i]);
+    }
+    free(alerter->sinks);
+    free(alerter->route_sinks);
+    alerter->sinks = NULL;
+    alerter->route_sinks = NULL;
+    alerter->num_sinks = 0;
+    
+    if (alerter->dedup) {
+        alert_dedup_destroy(alerter->dedup);
+        free(alerter->dedup);
+        alerter->dedup = NULL;
+    }
+}
+
+static void write_summary(void* ctx, const alert_dedup_slot_t* slot, uint64_t repeats,
+                          int64_t elapsed) {
+    char suffix[96];
+    snprintf(suffix, sizeof(suffix), " (repeated %llu times in %llds)",
+             (unsigned long long)repeats,
+             (long long)((elapsed + TIMESTAMP_NS_PER_SEC / 2) / TIMESTAMP_NS_PER_SEC));
+    alerter_t* alerter = (alerter_t*)ctx;
+    // Routes select on entries
+    log_entry_t* entry = log_entry_create(slot->source, slot->sample, slot->level, slot->sample);
+    if (entry) {
+        dispatch(alerter, entry, timestamp_now(), suffix);
+        log_entry_destroy(entry);
     }
 }
 
@@ -101,20 +289,5 @@ void alerter_write_alert(alerter_t* alerter, log_entry_t* entry) {
         return;
     }
     
-    char timestamp_str[64];
-    struct tm* timeinfo = localtime(&entry->timestamp);
-    strftime(timestamp_str, sizeof(timestamp_str), "%Y-%m-%d %H:%M:%S", timeinfo);
-    
-    const char* level_str = log_entry_level_to_string(entry->level);
-    
-    // Write to file
-    if (alerter->alert_file) {
-        fprintf(alerter->alert_file, "[%s] [%s] [%s] %s\n",
-                timestamp_str, level_str, entry->source, entry->message);
-        fflush(alerter->alert_file);
-    }
-    
-    // Also print to stdout
-    printf("[ALERT] [%s] [%s] [%s] %s\n",
-           timestamp_str, level_str, entry->source, entry->message);
+    dispatch(alerter, entry, entry->timestamp, "");
 }
\ No newline at end of file
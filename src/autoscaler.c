@@ -0,0 +1,229 @@
+#include "autoscaler.h"
+#include "work_pool.h"
+#include "metrics.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// A backlog counts as deep at half the submit limit, or when every
+// worker has several batches queued if there is no limit
+static bool is_backlogged(const autoscaler_t* autoscaler, const autoscale_sample_t* sample) {
+    size_t max_pending = autoscaler->pool->max_pending;
+    if (max_pending > 0) {
+        return sample->pending >= max_pending / 2;
+    }
+    return sample->pending >= sample->workers * WORK_POOL_BATCH * 4;
+}
+
+void autoscaler_sample(autoscaler_t* autoscaler, autoscale_sample_t* sample) {
+    if (!autoscaler || !sample) {
+        return;
+    }
+
+    work_pool_t* pool = autoscaler->pool;
+    uint64_t now = monotonic_ns();
+    uint64_t elapsed = now - autoscaler->last_sample_ns;
+    autoscaler->last_sample_ns = now;
+
+    memset(sample, 0, sizeof(autoscale_sample_t));
+    sample->workers = work_pool_size(pool);
+    sample->pending = work_pool_pending(pool);
+
+    uint64_t busy_total = 0;
+    for (size_t i = 0; i < pool->max_workers; i++) {
+        uint64_t busy = __atomic_load_n(&pool->workers[i].busy_ns, __ATOMIC_RELAXED);
+        uint64_t delta = busy - autoscaler->last_busy_ns[i];
+        autoscaler->last_busy_ns[i] = busy;
+        if (i >= sample->workers || elapsed == 0) {
+            continue;
+        }
+
+        // Busy time is credited when a batch completes, so a short
+        // interval can see more than it spans
+        unsigned int percent = delta >= elapsed ? 100 : (unsigned int)(delta * 100 / elapsed);
+        if (percent > sample->peak_utilization) {
+            sample->peak_utilization = percent;
+        }
+        busy_total += delta;
+    }
+    if (sample->workers > 0 && elapsed > 0) {
+        uint64_t capacity = elapsed * sample->workers;
+        sample->utilization = busy_total >= capacity ? 100
+            : (unsigned int)(busy_total * 100 / capacity);
+    }
+
+    uint64_t wait_ns = __atomic_load_n(&pool->wait_ns, __ATOMIC_RELAXED);
+    uint64_t waited = __atomic_load_n(&pool->waited_batches, __ATOMIC_RELAXED);
+    if (waited > autoscaler->last_waited_batches) {
+        sample->wait_us = (wait_ns - autoscaler->last_wait_ns) /
+                          (waited - autoscaler->last_waited_batches) / 1000;
+    }
+    autoscaler->last_wait_ns = wait_ns;
+    autoscaler->last_waited_batches = waited;
+}
+
+size_t autoscaler_decide(autoscaler_t* autoscaler, const autoscale_sample_t* sample) {
+    if (!autoscaler || !sample) {
+        return 0;
+    }
+
+    size_t workers = sample->workers;
+    if (workers < autoscaler->min_workers) {
+        return autoscaler->min_workers;
+    }
+    if (workers > autoscaler->max_workers) {
+        return autoscaler->max_workers;
+    }
+
+    bool overloaded = sample->utilization >= AUTOSCALE_UP_UTILIZATION ||
+                      sample->wait_us >= AUTOSCALE_UP_WAIT_US ||
+                      is_backlogged(autoscaler, sample);
+    bool idle = sample->peak_utilization < AUTOSCALE_DOWN_UTILIZATION &&
+                sample->wait_us < AUTOSCALE_DOWN_WAIT_US &&
+                sample->pending < WORK_POOL_BATCH;
+
+    if (overloaded && workers < autoscaler->max_workers) {
+        autoscaler->down_streak = 0;
+        if (++autoscaler->up_streak >= AUTOSCALE_UP_SAMPLES) {
+            autoscaler->up_streak = 0;
+            return workers + 1;
+        }
+    } else if (idle && workers > autoscaler->min_workers) {
+        autoscaler->up_streak = 0;
+        if (++autoscaler->down_streak >= AUTOSCALE_DOWN_SAMPLES) {
+            autoscaler->down_streak = 0;
+            return workers - 1;
+        }
+    } else {
+        autoscaler->up_streak = 0;
+        autoscaler->down_streak = 0;
+    }
+    return workers;
+}
+
+static void* autoscaler_thread_func(void* arg) {
+    autoscaler_t* autoscaler = (autoscaler_t*)arg;
+
+    pthread_mutex_lock(&autoscaler->mutex);
+    while (autoscaler->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += autoscaler->interval_ms / 1000;
+        deadline.tv_nsec += (long)(autoscaler->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = 0;
+        while (autoscaler->running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&autoscaler->wake, &autoscaler->mutex, &deadline);
+        }
+        if (!autoscaler->running) {
+            break;
+        }
+        pthread_mutex_unlock(&autoscaler->mutex);
+
+        autoscale_sample_t sample;
+        autoscaler_sample(autoscaler, &sample);
+        metrics_set(autoscaler->wait_us, sample.wait_us);
+        metrics_set(autoscaler->utilization, sample.utilization);
+
+        size_t target = autoscaler_decide(autoscaler, &sample);
+        if (target != sample.workers && work_pool_resize(autoscaler->pool, target) == 0) {
+            printf("Scaled processing threads %s from %zu to %zu "
+                   "(pending %zu, wait %llu us, utilization %u%%)\n",
+                   target > sample.workers ? "up" : "down", sample.workers, target,
+                   sample.pending, (unsigned long long)sample.wait_us, sample.utilization);
+            metrics_add(target > sample.workers ? autoscaler->scale_ups : autoscaler->scale_downs, 1);
+        }
+        metrics_set(autoscaler->threads, work_pool_size(autoscaler->pool));
+
+        pthread_mutex_lock(&autoscaler->mutex);
+    }
+    pthread_mutex_unlock(&autoscaler->mutex);
+
+    return NULL;
+}
+
+int autoscaler_init(autoscaler_t* autoscaler, work_pool_t* pool, size_t min_workers,
+                    size_t max_workers, unsigned int interval_ms) {
+    if (!autoscaler || !pool || min_workers == 0 || min_workers > max_workers ||
+        max_workers > pool->max_workers || interval_ms == 0) {
+        return -1;
+    }
+
+    memset(autoscaler, 0, sizeof(autoscaler_t));
+    autoscaler->last_busy_ns = (uint64_t*)calloc(pool->max_workers, sizeof(uint64_t));
+    if (!autoscaler->last_busy_ns) {
+        return -1;
+    }
+
+    autoscaler->pool = pool;
+    autoscaler->min_workers = min_workers;
+    autoscaler->max_workers = max_workers;
+    autoscaler->interval_ms = interval_ms;
+    pthread_mutex_init(&autoscaler->mutex, NULL);
+    pthread_cond_init(&autoscaler->wake, NULL);
+
+    return 0;
+}
+
+int autoscaler_start(autoscaler_t* autoscaler) {
+    if (!autoscaler || !autoscaler->pool || autoscaler->started) {
+        return -1;
+    }
+
+    autoscaler->threads = metrics_register("processor.threads", METRIC_GAUGE);
+    autoscaler->scale_ups = metrics_register("processor.scale_ups", METRIC_COUNTER);
+    autoscaler->scale_downs = metrics_register("processor.scale_downs", METRIC_COUNTER);
+    autoscaler->wait_us = metrics_register("processor.dequeue_wait_us", METRIC_GAUGE);
+    autoscaler->utilization = metrics_register("processor.utilization", METRIC_GAUGE);
+    metrics_set(autoscaler->threads, work_pool_size(autoscaler->pool));
+
+    // Start counting from now rather than from pool creation
+    autoscale_sample_t sample;
+    autoscaler_sample(autoscaler, &sample);
+
+    autoscaler->running = true;
+    if (pthread_create(&autoscaler->thread, NULL, autoscaler_thread_func, autoscaler) != 0) {
+        autoscaler->running = false;
+        return -1;
+    }
+    autoscaler->started = true;
+    return 0;
+}
+
+void autoscaler_stop(autoscaler_t* autoscaler) {
+    if (!autoscaler || !autoscaler->started) {
+        return;
+    }
+
+    pthread_mutex_lock(&autoscaler->mutex);
+    autoscaler->running = false;
+    pthread_cond_signal(&autoscaler->wake);
+    pthread_mutex_unlock(&autoscaler->mutex);
+
+    pthread_join(autoscaler->thread, NULL);
+    autoscaler->started = false;
+}
+
+void autoscaler_destroy(autoscaler_t* autoscaler) {
+    if (!autoscaler || !autoscaler->last_busy_ns) {
+        return;
+    }
+
+    autoscaler_stop(autoscaler);
+    pthread_cond_destroy(&autoscaler->wake);
+    pthread_mutex_destroy(&autoscaler->mutex);
+    free(autoscaler->last_busy_ns);
+    memset(autoscaler, 0, sizeof(autoscaler_t));
+}
\ No newline at end of file
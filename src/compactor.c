@@ -0,0 +1,609 @@
+#include "compactor.h"
+#include "segment.h"
+#include "timestamp.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Segment in the order retention takes space back: oldest lines first
+typedef struct {
+    int64_t max_time;
+    uint64_t id;
+    size_t index;
+} age_order_t;
+
+static void* compactor_thread_func(void* arg);
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * TIMESTAMP_NS_PER_SEC + ts.tv_nsec;
+}
+
+// Whether compactor_stop() is waiting for the thread
+static bool stopping(compactor_t* compactor) {
+    pthread_mutex_lock(&compactor->mutex);
+    bool stop = compactor->started && !compactor->running;
+    pthread_mutex_unlock(&compactor->mutex);
+    return stop;
+}
+
+// Account for bytes read or written, then wait until the pass is back
+// within the rate (a stop cuts the wait short)
+static void pace(compactor_t* compactor, uint64_t bytes) {
+    compactor->paced_bytes += bytes;
+    if (compactor->rate == 0) {
+        return;
+    }
+    int64_t due = compactor->paced_since +
+                  (int64_t)((long double)compactor->paced_bytes * TIMESTAMP_NS_PER_SEC /
+                            compactor->rate);
+
+    pthread_mutex_lock(&compactor->mutex);
+    while (!(compactor->started && !compactor->running)) {
+        int64_t remaining = due - monotonic_ns();
+        if (remaining <= 0) {
+            break;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        int64_t nanoseconds = deadline.tv_nsec + remaining;
+        deadline.tv_sec += nanoseconds / TIMESTAMP_NS_PER_SEC;
+        deadline.tv_nsec = nanoseconds % TIMESTAMP_NS_PER_SEC;
+        if (pthread_cond_timedwait(&compactor->wake, &compactor->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&compactor->mutex);
+}
+
+static int open_entry(const compactor_t* compactor, const log_store_segment_t* entry,
+                      segment_t* segment) {
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", compactor->store->dir, entry->name) >=
+        (int)sizeof(path)) {
+        return -1;
+    }
+    return segment_open(segment, path);
+}
+
+// Rule of every source of a segment (num_rules if none matches), or NULL
+static uint8_t* source_rules(const compactor_t* compactor, const segment_t* segment) {
+    uint8_t* rules = (uint8_t*)malloc(segment->num_sources + 1);
+    if (!rules) {
+        return NULL;
+    }
+    char name[PATH_MAX];
+    for (size_t id = 0; id < segment->num_sources; id++) {
+        size_t rule = compactor->num_rules;
+        size_t length = segment->source_lengths[id];
+        if (length < sizeof(name)) {
+            memcpy(name, segment->source_names[id], length);
+            name[length] = '\0';
+            rule = 0;
+            while (rule < compactor->num_rules &&
+                   !retention_rule_matches(&compactor->rules[rule], name)) {
+                rule++;
+            }
+        }
+        rules[id] = (uint8_t)rule;
+    }
+    return rules;
+}
+
+// Catalogue copy, by ID
+static log_store_segment_t* snapshot(log_store_t* store, size_t* count) {
+    size_t total = log_store_segments(store, NULL, 0);
+    log_store_segment_t* segments = NULL;
+    do {
+        free(segments);
+        *count = total;
+        segments = (log_store_segment_t*)malloc((total + 1) * sizeof(log_store_segment_t));
+        if (!segments) {
+            return NULL;
+        }
+        total = log_store_segments(store, segments, total);
+    } while (total > *count);
+    *count = total;
+    return segments;
+}
+
+// Rows by time; equal times keep their input order (lines are copied in it)
+static int compare_rows(const void* a, const void* b) {
+    const segment_row_t* left = (const segment_row_t*)a;
+    const segment_row_t* right = (const segment_row_t*)b;
+    if (left->timestamp != right->timestamp) {
+        return left->timestamp < right->timestamp ? -1 : 1;
+    }
+    uintptr_t left_line = (uintptr_t)left->line;
+    uintptr_t right_line = (uintptr_t)right->line;
+    return left_line < right_line ? -1 : (left_line > right_line ? 1 : 0);
+}
+
+// Write the rows of segments of one partition, less those of the rules in
+// drop, as one segment in their place (or just remove them if none is left)
+static int rewrite(compactor_t* compactor, const log_store_segment_t* inputs, size_t count,
+                   uint32_t drop) {
+    segment_t* segments = (segment_t*)calloc(count, sizeof(segment_t));
+    uint64_t* ids = (uint64_t*)malloc(count * sizeof(uint64_t));
+    if (!segments || !ids) {
+        free(segments);
+        free(ids);
+        return -1;
+    }
+
+    int status = 0;
+    size_t opened = 0;
+    size_t total_rows = 0;
+    uint64_t raw_bytes = 0;
+    uint64_t read = 0;
+    for (size_t i = 0; i < count && status == 0; i++) {
+        ids[i] = inputs[i].id;
+        if (open_entry(compactor, &inputs[i], &segments[i]) != 0) {
+            status = -1; // Removed meanwhile, or unreadable
+            break;
+        }
+        opened++;
+        total_rows += segments[i].num_rows;
+        raw_bytes += segments[i].raw_bytes;
+        read += segments[i].size;
+    }
+
+    segment_row_t* rows = NULL;
+    char* lines = NULL;
+    if (status == 0) {
+        rows = (segment_row_t*)malloc((total_rows + 1) * sizeof(segment_row_t));
+        lines = (char*)malloc(raw_bytes + 1);
+        status = rows && lines ? 0 : -1;
+    }
+
+    // Lines are copied: a segment's decoded block is reused for the next one
+    size_t kept = 0;
+    uint64_t used = 0;
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < opened && status == 0; i++) {
+        segment_t* segment = &segments[i];
+        const int64_t* timestamps = segment_timestamps(segment);
+        uint8_t* rules = drop ? source_rules(compactor, segment) : NULL;
+        if (!timestamps || (drop && !rules)) {
+            status = -1;
+        }
+        for (size_t row = 0; row < segment->num_rows && status == 0; row++) {
+            uint32_t source = segment_source_id(segment, row);
+            if (rules && rules[source] < compactor->num_rules && ((drop >> rules[source]) & 1)) {
+                dropped++;
+                continue;
+            }
+            size_t length;
+            const char* line = segment_line(segment, row, &length);
+            if (!line || length > raw_bytes - used) {
+                status = -1;
+                break;
+            }
+            memcpy(lines + used, line, length);
+            segment_row_t* out = &rows[kept++];
+            out->timestamp = timestamps[row];
+            out->source = segment->source_names[source];
+            out->source_len = segment->source_lengths[source];
+            out->line = lines + used;
+            out->line_len = (uint32_t)length;
+            out->level = (log_level_t)segment->levels[row];
+            used += length;
+        }
+        free(rules);
+    }
+    metrics_add(compactor->bytes_read, read);
+    pace(compactor, read);
+
+    if (status == 0 && kept == 0) {
+        status = log_store_replace(compactor->store, ids, count, NULL);
+    } else if (status == 0) {
+        qsort(rows, kept, sizeof(segment_row_t), compare_rows);
+
+        // Same partition directory as the inputs
+        log_store_segment_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.id = log_store_next_id(compactor->store);
+        entry.min_time = rows[0].timestamp;
+        entry.max_time = rows[kept - 1].timestamp;
+        entry.partition = inputs[0].partition;
+        entry.rows = kept;
+        const char* slash = strchr(inputs[0].name, '/');
+        int partition_len = slash ? (int)(slash - inputs[0].name) : 0;
+        char path[PATH_MAX];
+        if (!slash ||
+            snprintf(entry.name, sizeof(entry.name), "%.*s/%010llu.seg", partition_len,
+                     inputs[0].name, (unsigned long long)entry.id) >= (int)sizeof(entry.name) ||
+            snprintf(path, sizeof(path), "%s/%s", compactor->store->dir, entry.name) >=
+                (int)sizeof(path) ||
+            segment_write_replacing(path, entry.id, rows, kept, ids, count, &entry.bytes) != 0) {
+            status = -1;
+        } else {
+            metrics_add(compactor->bytes_written, entry.bytes);
+            pace(compactor, entry.bytes);
+            if (log_store_replace(compactor->store, ids, count, &entry) != 0) {
+                unlink(path);
+                status = -1;
+            }
+        }
+    }
+    if (status == 0) {
+        metrics_add(compactor->expired_rows, dropped);
+    }
+
+    for (size_t i = 0; i < opened; i++) {
+        segment_close(&segments[i]);
+    }
+    free(lines);
+    free(rows);
+    free(segments);
+    free(ids);
+    return status;
+}
+
+// Bytes per rule of a segment's rows
+static void compute_usage(const compactor_t* compactor, const log_store_segment_t* entry,
+                          compactor_usage_t* usage) {
+    memset(usage, 0, sizeof(compactor_usage_t));
+    usage->id = entry->id;
+    segment_t segment;
+    if (open_entry(compactor, entry, &segment) != 0) {
+        return;
+    }
+    uint8_t* rules = source_rules(compactor, &segment);
+    usage->bytes = (uint64_t*)calloc(compactor->num_rules + 1, sizeof(uint64_t));
+    if (rules && usage->bytes) {
+        for (size_t row = 0; row < segment.num_rows; row++) {
+            uint64_t size = segment_line_length(&segment, row) + 1;
+            usage->total += size;
+            usage->bytes[rules[segment_source_id(&segment, row)]] += size;
+        }
+    } else {
+        free(usage->bytes);
+        usage->bytes = NULL;
+    }
+    free(rules);
+    segment_close(&segment);
+}
+
+// Match the usage table to the catalogue, reading only new segments (and
+// those that could not be read before)
+static int refresh_usage(compactor_t* compactor, const log_store_segment_t* segments,
+                         size_t count) {
+    compactor_usage_t* usage =
+        (compactor_usage_t*)calloc(count + 1, sizeof(compactor_usage_t));
+    if (!usage) {
+        return -1;
+    }
+    size_t old = 0;
+    for (size_t i = 0; i < count; i++) {
+        while (old < compactor->num_usage && compactor->usage[old].id < segments[i].id) {
+            free(compactor->usage[old++].bytes);
+        }
+        if (old < compactor->num_usage && compactor->usage[old].id == segments[i].id &&
+            compactor->usage[old].bytes) {
+            usage[i] = compactor->usage[old++];
+        } else {
+            compute_usage(compactor, &segments[i], &usage[i]);
+        }
+    }
+    while (old < compactor->num_usage) {
+        free(compactor->usage[old++].bytes);
+    }
+    free(compactor->usage);
+    compactor->usage = usage;
+    compactor->num_usage = count;
+    return 0;
+}
+
+// Part of a segment's file size taken by a rule's lines
+static uint64_t share(const log_store_segment_t* segment, const compactor_usage_t* usage,
+                      size_t rule) {
+    if (!usage->bytes || usage->total == 0) {
+        return 0;
+    }
+    return (uint64_t)((long double)segment->bytes * usage->bytes[rule] / usage->total);
+}
+
+static int compare_age(const void* a, const void* b) {
+    const age_order_t* left = (const age_order_t*)a;
+    const age_order_t* right = (const age_order_t*)b;
+    if (left->max_time != right->max_time) {
+        return left->max_time < right->max_time ? -1 : 1;
+    }
+    return left->id < right->id ? -1 : (left->id > right->id ? 1 : 0);
+}
+
+static int apply_retention(compactor_t* compactor, const log_store_segment_t* segments,
+                           size_t count, int64_t now) {
+    if (compactor->num_rules == 0 || count == 0) {
+        return 0;
+    }
+    uint32_t* drop = (uint32_t*)calloc(count, sizeof(uint32_t));
+    age_order_t* order = (age_order_t*)malloc(count * sizeof(age_order_t));
+    if (!drop || !order || refresh_usage(compactor, segments, count) != 0) {
+        free(drop);
+        free(order);
+        return -1;
+    }
+
+    // Whole segments past a rule's age
+    for (size_t i = 0; i < count; i++) {
+        const compactor_usage_t* usage = &compactor->usage[i];
+        for (size_t r = 0; r < compactor->num_rules && usage->bytes; r++) {
+            int64_t max_age = compactor->rules[r].max_age;
+            if (max_age > 0 && usage->bytes[r] > 0 && segments[i].max_time < now - max_age) {
+                drop[i] |= 1u << r;
+            }
+        }
+        order[i].max_time = segments[i].max_time;
+        order[i].id = segments[i].id;
+        order[i].index = i;
+    }
+
+    // Then the oldest segments of a class over its size
+    qsort(order, count, sizeof(age_order_t), compare_age);
+    for (size_t r = 0; r < compactor->num_rules; r++) {
+        uint64_t max_bytes = compactor->rules[r].max_bytes;
+        if (max_bytes == 0) {
+            continue;
+        }
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!(drop[i] & (1u << r))) {
+                total += share(&segments[i], &compactor->usage[i], r);
+            }
+        }
+        for (size_t k = 0; k < count && total > max_bytes; k++) {
+            size_t i = order[k].index;
+            uint64_t bytes = share(&segments[i], &compactor->usage[i], r);
+            if (bytes > 0 && !(drop[i] & (1u << r))) {
+                drop[i] |= 1u << r;
+                total -= bytes;
+            }
+        }
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < count && !stopping(compactor); i++) {
+        if (!drop[i]) {
+            continue;
+        }
+        const compactor_usage_t* usage = &compactor->usage[i];
+        uint64_t left = usage->total;
+        for (size_t r = 0; r < compactor->num_rules; r++) {
+            left -= (drop[i] >> r) & 1 ? usage->bytes[r] : 0;
+        }
+        if (left == 0) {
+            if (log_store_replace(compactor->store, &segments[i].id, 1, NULL) == 0) {
+                metrics_add(compactor->expired_segments, 1);
+                metrics_add(compactor->expired_rows, segments[i].rows);
+            } else {
+                status = -1;
+            }
+        } else if (rewrite(compactor, &segments[i], 1, drop[i]) == 0) {
+            metrics_add(compactor->rewritten_segments, 1);
+        } else {
+            status = -1;
+        }
+    }
+    free(order);
+    free(drop);
+    return status;
+}
+
+static int compare_partition(const void* a, const void* b) {
+    const log_store_segment_t* left = (const log_store_segment_t*)a;
+    const log_store_segment_t* right = (const log_store_segment_t*)b;
+    if (left->partition != right->partition) {
+        return left->partition < right->partition ? -1 : 1;
+    }
+    return left->id < right->id ? -1 : (left->id > right->id ? 1 : 0);
+}
+
+static int compact(compactor_t* compactor, log_store_segment_t* segments, size_t count) {
+    if (compactor->compact_size == 0 || count < 2) {
+        metrics_set(compactor->pending, 0);
+        return 0;
+    }
+    qsort(segments, count, sizeof(log_store_segment_t), compare_partition);
+
+    // Runs of small neighbours within a partition, as (first, length) pairs
+    size_t* runs = (size_t*)malloc(count * 2 * sizeof(size_t));
+    if (!runs) {
+        return -1;
+    }
+    size_t num_runs = 0;
+    size_t pending = 0;
+    size_t first = 0;
+    size_t length = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i <= count; i++) {
+        bool small = i < count && segments[i].bytes < compactor->compact_size / 2;
+        bool joins = small && length > 0 && segments[i].partition == segments[first].partition &&
+                     bytes + segments[i].bytes <= compactor->compact_size;
+        if (joins) {
+            length++;
+            bytes += segments[i].bytes;
+            continue;
+        }
+        if (length >= 2) {
+            runs[2 * num_runs] = first;
+            runs[2 * num_runs + 1] = length;
+            num_runs++;
+            pending += length;
+        }
+        first = i;
+        length = small ? 1 : 0;
+        bytes = small ? segments[i].bytes : 0;
+    }
+    metrics_set(compactor->pending, pending);
+
+    int status = 0;
+    for (size_t r = 0; r < num_runs && !stopping(compactor); r++) {
+        size_t run = runs[2 * r + 1];
+        if (rewrite(compactor, &segments[runs[2 * r]], run, 0) == 0) {
+            metrics_add(compactor->merges, 1);
+            metrics_add(compactor->merged_segments, run);
+        } else {
+            status = -1;
+        }
+        pending -= run;
+        metrics_set(compactor->pending, pending);
+    }
+    free(runs);
+    return status;
+}
+
+int compactor_init(compactor_t* compactor, log_store_t* store, const config_t* config) {
+    if (!compactor || !store || !config || store->read_only ||
+        config->num_retention_rules > COMPACTOR_MAX_RULES || config->store_compact_interval <= 0) {
+        return -1;
+    }
+
+    memset(compactor, 0, sizeof(compactor_t));
+    compactor->store = store;
+    compactor->rules = config->retention_rules;
+    compactor->num_rules = config->num_retention_rules;
+    compactor->compact_size = config->store_compact_size;
+    compactor->interval = (int64_t)config->store_compact_interval * TIMESTAMP_NS_PER_SEC;
+    compactor->rate = config->store_compact_rate;
+    pthread_mutex_init(&compactor->mutex, NULL);
+    pthread_cond_init(&compactor->wake, NULL);
+
+    compactor->passes = metrics_register("compaction.passes", METRIC_COUNTER);
+    compactor->merges = metrics_register("compaction.merges", METRIC_COUNTER);
+    compactor->merged_segments = metrics_register("compaction.merged_segments", METRIC_COUNTER);
+    compactor->bytes_read = metrics_register("compaction.bytes_read", METRIC_COUNTER);
+    compactor->bytes_written = metrics_register("compaction.bytes_written", METRIC_COUNTER);
+    compactor->pending = metrics_register("compaction.pending", METRIC_GAUGE);
+    compactor->write_amplification =
+        metrics_register("compaction.write_amplification_pct", METRIC_GAUGE);
+    compactor->expired_segments = metrics_register("retention.expired_segments", METRIC_COUNTER);
+    compactor->rewritten_segments =
+        metrics_register("retention.rewritten_segments", METRIC_COUNTER);
+    compactor->expired_rows = metrics_register("retention.expired_rows", METRIC_COUNTER);
+    compactor->errors = metrics_register("compaction.errors", METRIC_COUNTER);
+    return 0;
+}
+
+int compactor_run(compactor_t* compactor, int64_t now) {
+    if (!compactor || !compactor->store) {
+        return -1;
+    }
+    compactor->paced_since = monotonic_ns();
+    compactor->paced_bytes = 0;
+
+    // Retention first, so that nothing about to expire is merged
+    size_t count;
+    log_store_segment_t* segments = snapshot(compactor->store, &count);
+    int status = segments ? apply_retention(compactor, segments, count, now) : -1;
+    free(segments);
+    segments = snapshot(compactor->store, &count);
+    if (!segments || compact(compactor, segments, count) != 0) {
+        status = -1;
+    }
+    free(segments);
+
+    // Bytes written to disk per byte flushed, in percent
+    uint64_t flushed = metrics_get(compactor->store->bytes);
+    if (flushed > 0) {
+        metrics_set(compactor->write_amplification,
+                    (flushed + metrics_get(compactor->bytes_written)) * 100 / flushed);
+    }
+    metrics_add(compactor->passes, 1);
+    if (status != 0) {
+        metrics_add(compactor->errors, 1);
+    }
+    return status;
+}
+
+static void* compactor_thread_func(void* arg) {
+    compactor_t* compactor = (compactor_t*)arg;
+#ifdef __linux__
+    // Compaction is background work: lowest priority for this thread only
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+
+    pthread_mutex_lock(&compactor->mutex);
+    while (compactor->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        int64_t nanoseconds = deadline.tv_nsec + compactor->interval;
+        deadline.tv_sec += nanoseconds / TIMESTAMP_NS_PER_SEC;
+        deadline.tv_nsec = nanoseconds % TIMESTAMP_NS_PER_SEC;
+
+        int rc = 0;
+        while (compactor->running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&compactor->wake, &compactor->mutex, &deadline);
+        }
+        if (!compactor->running) {
+            break;
+        }
+        pthread_mutex_unlock(&compactor->mutex);
+
+        compactor_run(compactor, timestamp_now());
+
+        pthread_mutex_lock(&compactor->mutex);
+    }
+    pthread_mutex_unlock(&compactor->mutex);
+    return NULL;
+}
+
+int compactor_start(compactor_t* compactor) {
+    if (!compactor || !compactor->store || compactor->started) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&compactor->mutex);
+    compactor->running = true;
+    compactor->started = true;
+    pthread_mutex_unlock(&compactor->mutex);
+    if (pthread_create(&compactor->thread, NULL, compactor_thread_func, compactor) != 0) {
+        pthread_mutex_lock(&compactor->mutex);
+        compactor->running = false;
+        compactor->started = false;
+        pthread_mutex_unlock(&compactor->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+void compactor_stop(compactor_t* compactor) {
+    if (!compactor || !compactor->store) {
+        return;
+    }
+
+    pthread_mutex_lock(&compactor->mutex);
+    bool started = compactor->started;
+    compactor->running = false;
+    pthread_cond_broadcast(&compactor->wake);
+    pthread_mutex_unlock(&compactor->mutex);
+    if (started) {
+        pthread_join(compactor->thread, NULL);
+        pthread_mutex_lock(&compactor->mutex);
+        compactor->started = false;
+        pthread_mutex_unlock(&compactor->mutex);
+    }
+}
+
+void compactor_destroy(compactor_t* compactor) {
+    if (!compactor || !compactor->store) {
+        return;
+    }
+
+    compactor_stop(compactor);
+    for (size_t i = 0; i < compactor->num_usage; i++) {
+        free(compactor->usage[i].bytes);
+    }
+    free(compactor->usage);
+    pthread_cond_destroy(&compactor->wake);
+    pthread_mutex_destroy(&compactor->mutex);
+    memset(compactor, 0, sizeof(compactor_t));
+}
\ No newline at end of file
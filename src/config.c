@@ -8,6 +8,43 @@
 #define MAX_LINE_LENGTH 1024
 #define MAX_DIRECTORIES 32
 #define MAX_PATTERNS 64
+#define MAX_FIELD_RULES 64
+#define MAX_RATE_RULES 32
+#define MAX_SEQUENCE_RULES 32
+#define MAX_RETENTION_RULES 32
+#define MAX_ALERT_SINKS 16
+#define MAX_ALERT_ROUTES 32
+#define MAX_SKETCH_FIELDS 4
+#define MAX_JSON_FIELDS 8
+#define MAX_LOG_FORMATS 32
+#define MAX_SOURCE_FILTERS 32
+#define MAX_CONTEXT_LINES 64
+
+// Split "<first> <rest>" into two allocated strings and append them
+static int config_add_pair(char*** firsts, char*** rests, size_t* count, const char* value) {
+    const char* space = strchr(value, ' ');
+    if (!space) {
+        return -1;
+    }
+    const char* rest = space;
+    while (*rest == ' ') rest++;
+    if (*rest == '\0' || *count >= MAX_LOG_FORMATS) {
+        return -1;
+    }
+
+    if (!*firsts) {
+        *firsts = (char**)calloc(MAX_LOG_FORMATS, sizeof(char*));
+        *rests = (char**)calloc(MAX_LOG_FORMATS, sizeof(char*));
+        if (!*firsts || !*rests) {
+            return -1;
+        }
+    }
+
+    (*firsts)[*count] = strndup(value, (size_t)(space - value));
+    (*rests)[*count] = strdup(rest);
+    (*count)++;
+    return 0;
+}
 
 void config_init_defaults(config_t* config) {
     if (!config) {
@@ -21,9 +58,46 @@ void config_init_defaults(config_t* config) {
     config->enable_network = true;
     config->queue_max_size = 1000;
     config->num_processing_threads = 2;
+    config->autoscale_interval_ms = 1000;
+    config->processor_mode = PROCESSOR_MODE_STEAL;
+    config->shard_rebalance_interval = 1;
     config->enable_alerts = true;
     config->alert_file = strdup("alerts.log");
+    config->alert_buffer_size = 65536;
+    config->alert_flush_ms = 100;
+    config->alert_format = ALERT_FORMAT_TEXT;
+    config->alert_stdout = true;
+    config->alert_stdout_rate = 100;
     config->alert_threshold = LOG_LEVEL_WARNING;
+    config->alert_dedup_window = 10;
+    config->alert_dedup_capacity = 4096;
+    config->alert_sink_queue = 10000;
+    config->alert_sink_timeout_ms = 5000;
+    config->alert_sink_retry_max_ms = 30000;
+    config->alert_rotate_compress = true;
+    config->alert_context_buffer = 16384;
+    config->alert_context_memory = 16 * 1024 * 1024;
+    config->alert_context_wait_ms = 2000;
+    config->rule_cache_size = 4096;
+    config->alert_rate_capacity = 65536;
+    config->alert_sequence_capacity = 65536;
+    config->template_capacity = 4096;
+    config->template_depth = 2;
+    config->template_similarity = 0.4;
+    config->sketch_top_k = 32;
+    config->sketch_width = 2048;
+    config->sketch_depth = 4;
+    config->sketch_precision = 12;
+    config->sketch_interval = 10;
+    config->store_memtable_size = 8 * 1024 * 1024;
+    config->store_flush_ms = 5000;
+    config->store_partition = 3600;
+    config->store_compact_size = 16 * 1024 * 1024;
+    config->store_compact_interval = 60;
+    config->store_compact_rate = 16 * 1024 * 1024;
+    config->query_threads = 3;
+    config->query_cache_size = 64 * 1024 * 1024;
+    config->metrics_interval_seconds = 10;
 }
 
 int config_load(config_t* config, const char* filename) {
@@ -43,6 +117,7 @@ int config_load(config_t* config, const char* filename) {
     char line[MAX_LINE_LENGTH];
     char key[256];
     char value[768];
+    bool mode_set = false;
     
     while (fgets(line, sizeof(line), file)) {
         // Skip comments and empty lines
@@ -50,8 +125,8 @@ int config_load(config_t* config, const char* filename) {
             continue;
         }
         
-        // Parse key=value pairs
-        if (sscanf(line, "%255[^=]=%767s", key, value) == 2) {
+        // Parse key=value pairs (the value runs to the end of the line)
+        if (sscanf(line, "%255[^=]=%767[^\n]", key, value) == 2) {
             // Remove trailing whitespace from value
             size_t len = strlen(value);
             while (len > 0 && (value[len-1] == '\n' || value[len-1] == '\r' || value[len-1] == ' ')) {
@@ -68,13 +143,310 @@ int config_load(config_t* config, const char* filename) {
                 config->queue_max_size = (size_t)atoi(value);
             } else if (strcmp(key, "num_processing_threads") == 0) {
                 config->num_processing_threads = atoi(value);
+            } else if (strcmp(key, "min_processing_threads") == 0) {
+                config->min_processing_threads = atoi(value);
+            } else if (strcmp(key, "max_processing_threads") == 0) {
+                config->max_processing_threads = atoi(value);
+            } else if (strcmp(key, "autoscale_interval_ms") == 0) {
+                if (atoi(value) > 0) {
+                    config->autoscale_interval_ms = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid autoscale interval %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "processor_mode") == 0) {
+                mode_set = true;
+                if (strcmp(value, "steal") == 0) {
+                    config->processor_mode = PROCESSOR_MODE_STEAL;
+                } else if (strcmp(value, "queue") == 0) {
+                    config->processor_mode = PROCESSOR_MODE_QUEUE;
+                } else if (strcmp(value, "shard") == 0) {
+                    config->processor_mode = PROCESSOR_MODE_SHARD;
+                } else {
+                    fprintf(stderr, "Ignoring invalid processor mode %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "processor_affinity") == 0) {
+                config->processor_affinity = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "shard_rebalance_interval") == 0) {
+                config->shard_rebalance_interval = atoi(value);
             } else if (strcmp(key, "enable_alerts") == 0) {
                 config->enable_alerts = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
             } else if (strcmp(key, "alert_file") == 0) {
                 free(config->alert_file);
                 config->alert_file = strdup(value);
+            } else if (strcmp(key, "alert_buffer_size") == 0) {
+                if (atol(value) > 0) {
+                    config->alert_buffer_size = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert buffer size %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_flush_ms") == 0) {
+                config->alert_flush_ms = atoi(value) > 0 ? atoi(value) : 0;
+            } else if (strcmp(key, "alert_format") == 0) {
+                if (alert_format_parse(value, &config->alert_format) != 0) {
+                    fprintf(stderr, "Ignoring invalid alert format %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_stdout") == 0) {
+                config->alert_stdout = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "alert_stdout_rate") == 0) {
+                config->alert_stdout_rate = atol(value) > 0 ? (size_t)atol(value) : 0;
+            } else if (strcmp(key, "alert_sink_queue") == 0) {
+                if (atol(value) > 0) {
+                    config->alert_sink_queue = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert sink queue %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_sink_timeout_ms") == 0) {
+                if (atoi(value) > 0) {
+                    config->alert_sink_timeout_ms = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert sink timeout %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_sink_retry_max_ms") == 0) {
+                if (atoi(value) > 0) {
+                    config->alert_sink_retry_max_ms = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert sink retry %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_rotate_size") == 0) {
+                config->alert_rotate_size = atol(value) > 0 ? (size_t)atol(value) : 0;
+            } else if (strcmp(key, "alert_rotate_interval") == 0) {
+                config->alert_rotate_interval = atoi(value) > 0 ? atoi(value) : 0;
+            } else if (strcmp(key, "alert_rotate_keep") == 0) {
+                config->alert_rotate_keep = atol(value) > 0 ? (size_t)atol(value) : 0;
+            } else if (strcmp(key, "alert_rotate_max_age") == 0) {
+                config->alert_rotate_max_age = atoi(value) > 0 ? atoi(value) : 0;
+            } else if (strcmp(key, "alert_rotate_compress") == 0) {
+                config->alert_rotate_compress = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "alert_context_before") == 0 ||
+                       strcmp(key, "alert_context_after") == 0) {
+                size_t* lines = strcmp(key, "alert_context_before") == 0
+                    ? &config->alert_context_before : &config->alert_context_after;
+                if (atol(value) >= 0 && atol(value) <= MAX_CONTEXT_LINES) {
+                    *lines = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert context lines %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_context_buffer") == 0) {
+                if (atol(value) >= 256) {
+                    config->alert_context_buffer = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert context buffer %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_context_memory") == 0) {
+                if (atol(value) > 0) {
+                    config->alert_context_memory = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid alert context memory %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_context_wait_ms") == 0) {
+                config->alert_context_wait_ms = atoi(value) > 0 ? atoi(value) : 0;
             } else if (strcmp(key, "alert_threshold") == 0) {
                 config->alert_threshold = log_entry_parse_level(value);
+            } else if (strcmp(key, "alert_dedup_window") == 0) {
+                config->alert_dedup_window = atoi(value);
+            } else if (strcmp(key, "alert_dedup_capacity") == 0) {
+                if (atol(value) > 0) {
+                    config->alert_dedup_capacity = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid dedup capacity %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_rate_capacity") == 0) {
+                if (atol(value) > 0) {
+                    config->alert_rate_capacity = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid rate capacity %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "alert_sequence_capacity") == 0) {
+                if (atol(value) > 0) {
+                    config->alert_sequence_capacity = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid sequence capacity %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "rule_cache_size") == 0) {
+                config->rule_cache_size = (size_t)atol(value);
+            } else if (strcmp(key, "template_mining") == 0) {
+                config->template_mining = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "template_capacity") == 0) {
+                if (atol(value) > 0) {
+                    config->template_capacity = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid template capacity %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "template_depth") == 0) {
+                if (atoi(value) > 0) {
+                    config->template_depth = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid template depth %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "template_similarity") == 0) {
+                char* end;
+                double similarity = strtod(value, &end);
+                if (end != value && *end == '\0' && similarity >= 0.0 && similarity <= 1.0) {
+                    config->template_similarity = similarity;
+                } else {
+                    fprintf(stderr, "Ignoring invalid template similarity %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "template_file") == 0) {
+                free(config->template_file);
+                config->template_file = strdup(value);
+            } else if (strcmp(key, "sketches") == 0) {
+                config->sketches = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "sketch_top_k") == 0) {
+                if (atol(value) > 0) {
+                    config->sketch_top_k = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid sketch size %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "sketch_width") == 0) {
+                if (atol(value) > 0) {
+                    config->sketch_width = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid sketch width %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "sketch_depth") == 0) {
+                if (atol(value) > 0 && atol(value) <= 16) {
+                    config->sketch_depth = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid sketch depth %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "sketch_precision") == 0) {
+                if (atoi(value) >= 4 && atoi(value) <= 16) {
+                    config->sketch_precision = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid sketch precision %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "sketch_interval") == 0) {
+                if (atoi(value) > 0) {
+                    config->sketch_interval = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid sketch interval %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "sketch_file") == 0) {
+                free(config->sketch_file);
+                config->sketch_file = strdup(value);
+            } else if (strcmp(key, "store_dir") == 0) {
+                free(config->store_dir);
+                config->store_dir = strdup(value);
+            } else if (strcmp(key, "store_memtable_size") == 0) {
+                if (atol(value) >= 65536) {
+                    config->store_memtable_size = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid store memtable size %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "store_flush_ms") == 0 ||
+                       strcmp(key, "store_partition") == 0) {
+                int* setting = strcmp(key, "store_flush_ms") == 0
+                    ? &config->store_flush_ms : &config->store_partition;
+                if (atoi(value) > 0) {
+                    *setting = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid store interval %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "query_socket") == 0) {
+                free(config->query_socket);
+                config->query_socket = strdup(value);
+            } else if (strcmp(key, "query_threads") == 0) {
+                if (atoi(value) >= 0 && value[0] >= '0' && value[0] <= '9') {
+                    config->query_threads = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid query threads %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "query_cache_size") == 0) {
+                if (value[0] >= '0' && value[0] <= '9') {
+                    config->query_cache_size = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid query cache size %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "store_compact_size") == 0 ||
+                       strcmp(key, "store_compact_rate") == 0) {
+                size_t* setting = strcmp(key, "store_compact_size") == 0
+                    ? &config->store_compact_size : &config->store_compact_rate;
+                if (value[0] >= '0' && value[0] <= '9') {
+                    *setting = (size_t)atol(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid compaction setting %s=%s\n", key, value);
+                }
+            } else if (strcmp(key, "store_compact_interval") == 0) {
+                if (atoi(value) > 0) {
+                    config->store_compact_interval = atoi(value);
+                } else {
+                    fprintf(stderr, "Ignoring invalid compaction interval %s=%s\n", key, value);
+                }
+            } else if (strncmp(key, "store_retention", 15) == 0) {
+                // Support multiple store_retention entries (<source glob> [<age>] [<size>])
+                if (config->num_retention_rules < MAX_RETENTION_RULES) {
+                    if (!config->retention_rules) {
+                        config->retention_rules = (retention_rule_t*)calloc(
+                            MAX_RETENTION_RULES, sizeof(retention_rule_t));
+                    }
+                    if (config->retention_rules &&
+                        retention_rule_parse(&config->retention_rules[config->num_retention_rules],
+                                             value) == 0) {
+                        config->num_retention_rules++;
+                    } else {
+                        fprintf(stderr, "Ignoring invalid retention rule %s=%s\n", key, value);
+                    }
+                }
+            } else if (strcmp(key, "json_lines") == 0) {
+                config->json_lines = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+            } else if (strcmp(key, "json_level_key") == 0) {
+                free(config->json_level_keys);
+                config->json_level_keys = strdup(value);
+            } else if (strcmp(key, "json_message_key") == 0) {
+                free(config->json_message_keys);
+                config->json_message_keys = strdup(value);
+            } else if (strcmp(key, "json_timestamp_key") == 0) {
+                free(config->json_timestamp_keys);
+                config->json_timestamp_keys = strdup(value);
+            } else if (strncmp(key, "json_field", 10) == 0) {
+                // Support multiple json_field entries
+                if (config->num_json_fields < MAX_JSON_FIELDS) {
+                    if (!config->json_fields) {
+                        config->json_fields = (char**)calloc(MAX_JSON_FIELDS, sizeof(char*));
+                    }
+                    config->json_fields[config->num_json_fields++] = strdup(value);
+                }
+            } else if (strncmp(key, "sketch_field", 12) == 0) {
+                // Support multiple sketch_field entries
+                if (config->num_sketch_fields < MAX_SKETCH_FIELDS) {
+                    if (!config->sketch_fields) {
+                        config->sketch_fields = (char**)calloc(MAX_SKETCH_FIELDS, sizeof(char*));
+                    }
+                    config->sketch_fields[config->num_sketch_fields++] = strdup(value);
+                }
+            } else if (strncmp(key, "log_format", 10) == 0) {
+                // Custom line format: <name> <spec>
+                if (config_add_pair(&config->log_format_names, &config->log_format_specs,
+                                    &config->num_log_formats, value) != 0) {
+                    fprintf(stderr, "Ignoring invalid format %s=%s\n", key, value);
+                }
+            } else if (strncmp(key, "source_format", 13) == 0) {
+                // Format assignment: <source glob> <format name>
+                if (config_add_pair(&config->source_format_globs, &config->source_format_names,
+                                    &config->num_source_formats, value) != 0) {
+                    fprintf(stderr, "Ignoring invalid format assignment %s=%s\n", key, value);
+                }
+            } else if (strncmp(key, "source_include", 14) == 0) {
+                // Support multiple source_include entries (source globs)
+                if (config->num_source_includes < MAX_SOURCE_FILTERS) {
+                    if (!config->source_include_globs) {
+                        config->source_include_globs = (char**)calloc(MAX_SOURCE_FILTERS, sizeof(char*));
+                    }
+                    config->source_include_globs[config->num_source_includes++] = strdup(value);
+                }
+            } else if (strncmp(key, "source_exclude", 14) == 0) {
+                // Support multiple source_exclude entries (source globs)
+                if (config->num_source_excludes < MAX_SOURCE_FILTERS) {
+                    if (!config->source_exclude_globs) {
+                        config->source_exclude_globs = (char**)calloc(MAX_SOURCE_FILTERS, sizeof(char*));
+                    }
+                    config->source_exclude_globs[config->num_source_excludes++] = strdup(value);
+                }
+            } else if (strcmp(key, "metrics_file") == 0) {
+                free(config->metrics_file);
+                config->metrics_file = strdup(value);
+            } else if (strcmp(key, "metrics_interval") == 0) {
+                config->metrics_interval_seconds = atoi(value);
             } else if (strncmp(key, "watch_directory", 15) == 0) {
                 // Support multiple watch_directory entries
                 if (config->num_directories < MAX_DIRECTORIES) {
@@ -83,6 +455,73 @@ int config_load(config_t* config, const char* filename) {
                     }
                     config->watch_directories[config->num_directories++] = strdup(value);
                 }
+            } else if (strncmp(key, "alert_rule", 10) == 0) {
+                // Support multiple alert_rule entries (field<op>value)
+                if (config->num_field_rules < MAX_FIELD_RULES) {
+                    if (!config->field_rules) {
+                        config->field_rules = (field_rule_t*)calloc(MAX_FIELD_RULES, sizeof(field_rule_t));
+                    }
+                    if (config->field_rules &&
+                        field_rule_parse(&config->field_rules[config->num_field_rules], value) == 0) {
+                        config->num_field_rules++;
+                    } else {
+                        fprintf(stderr, "Ignoring invalid rule %s=%s\n", key, value);
+                    }
+                }
+            } else if (strncmp(key, "alert_rate", 10) == 0) {
+                // Support multiple alert_rate entries (<limit> <selector> in <window>)
+                if (config->num_rate_rules < MAX_RATE_RULES) {
+                    if (!config->rate_rules) {
+                        config->rate_rules = (rate_rule_t*)calloc(MAX_RATE_RULES, sizeof(rate_rule_t));
+                    }
+                    if (config->rate_rules &&
+                        rate_rule_parse(&config->rate_rules[config->num_rate_rules], value) == 0) {
+                        config->num_rate_rules++;
+                    } else {
+                        fprintf(stderr, "Ignoring invalid rate rule %s=%s\n", key, value);
+                    }
+                }
+            } else if (strncmp(key, "alert_sequence", 14) == 0) {
+                // Support multiple alert_sequence entries (<step> -> <step> within <window>)
+                if (config->num_sequence_rules < MAX_SEQUENCE_RULES) {
+                    if (!config->sequence_rules) {
+                        config->sequence_rules = (sequence_rule_t*)calloc(MAX_SEQUENCE_RULES,
+                                                                          sizeof(sequence_rule_t));
+                    }
+                    if (config->sequence_rules &&
+                        sequence_rule_parse(&config->sequence_rules[config->num_sequence_rules],
+                                            value) == 0) {
+                        config->num_sequence_rules++;
+                    } else {
+                        fprintf(stderr, "Ignoring invalid sequence rule %s=%s\n", key, value);
+                    }
+                }
+            } else if (strncmp(key, "alert_sink", 10) == 0) {
+                // Support multiple alert_sink entries (<name> <type> [<target>] [options])
+                if (config->num_alert_sinks < MAX_ALERT_SINKS) {
+                    if (!config->alert_sinks) {
+                        config->alert_sinks = (sink_spec_t*)calloc(MAX_ALERT_SINKS, sizeof(sink_spec_t));
+                    }
+                    if (config->alert_sinks &&
+                        sink_spec_parse(&config->alert_sinks[config->num_alert_sinks], value) == 0) {
+                        config->num_alert_sinks++;
+                    } else {
+                        fprintf(stderr, "Ignoring invalid alert sink %s=%s\n", key, value);
+                    }
+                }
+            } else if (strncmp(key, "alert_route", 11) == 0) {
+                // Support multiple alert_route entries (<selector> -> <sink>[,<sink>])
+                if (config->num_alert_routes < MAX_ALERT_ROUTES) {
+                    if (!config->alert_routes) {
+                        config->alert_routes = (sink_route_t*)calloc(MAX_ALERT_ROUTES, sizeof(sink_route_t));
+                    }
+                    if (config->alert_routes &&
+                        sink_route_parse(&config->alert_routes[config->num_alert_routes], value) == 0) {
+                        config->num_alert_routes++;
+                    } else {
+                        fprintf(stderr, "Ignoring invalid alert route %s=%s\n", key, value);
+                    }
+                }
             } else if (strncmp(key, "alert_pattern", 13) == 0) {
                 // Support multiple alert_pattern entries
                 if (config->num_patterns < MAX_PATTERNS) {
@@ -96,6 +535,17 @@ int config_load(config_t* config, const char* filename) {
     }
     
     fclose(file);
+
+    // Sequence rules need each source's lines in order, which stolen
+    // batches do not keep
+    if (config->num_sequence_rules > 0 && config->processor_mode == PROCESSOR_MODE_STEAL) {
+        if (mode_set) {
+            fprintf(stderr, "Sequence rules may miss or misfire with processor_mode=steal, "
+                            "use shard or queue with one thread\n");
+        } else {
+            config->processor_mode = PROCESSOR_MODE_SHARD;
+        }
+    }
     return 0;
 }
 
@@ -118,6 +568,91 @@ void config_destroy(config_t* config) {
         free(config->alert_patterns);
     }
     
+    if (config->field_rules) {
+        for (size_t i = 0; i < config->num_field_rules; i++) {
+            field_rule_destroy(&config->field_rules[i]);
+        }
+        free(config->field_rules);
+    }
+    
+    if (config->rate_rules) {
+        for (size_t i = 0; i < config->num_rate_rules; i++) {
+            rate_rule_destroy(&config->rate_rules[i]);
+        }
+        free(config->rate_rules);
+    }
+    
+    if (config->sequence_rules) {
+        for (size_t i = 0; i < config->num_sequence_rules; i++) {
+            sequence_rule_destroy(&config->sequence_rules[i]);
+        }
+        free(config->sequence_rules);
+    }
+    
+    if (config->retention_rules) {
+        for (size_t i = 0; i < config->num_retention_rules; i++) {
+            retention_rule_destroy(&config->retention_rules[i]);
+        }
+        free(config->retention_rules);
+    }
+    
+    if (config->alert_sinks) {
+        for (size_t i = 0; i < config->num_alert_sinks; i++) {
+            sink_spec_destroy(&config->alert_sinks[i]);
+        }
+        free(config->alert_sinks);
+    }
+    
+    if (config->alert_routes) {
+        for (size_t i = 0; i < config->num_alert_routes; i++) {
+            sink_route_destroy(&config->alert_routes[i]);
+        }
+        free(config->alert_routes);
+    }
+    
+    if (config->json_fields) {
+        for (size_t i = 0; i < config->num_json_fields; i++) {
+            free(config->json_fields[i]);
+        }
+        free(config->json_fields);
+    }
+    
+    for (size_t i = 0; i < config->num_log_formats; i++) {
+        free(config->log_format_names[i]);
+        free(config->log_format_specs[i]);
+    }
+    free(config->log_format_names);
+    free(config->log_format_specs);
+    
+    for (size_t i = 0; i < config->num_source_formats; i++) {
+        free(config->source_format_globs[i]);
+        free(config->source_format_names[i]);
+    }
+    free(config->source_format_globs);
+    free(config->source_format_names);
+    
+    for (size_t i = 0; i < config->num_source_includes; i++) {
+        free(config->source_include_globs[i]);
+    }
+    free(config->source_include_globs);
+    for (size_t i = 0; i < config->num_source_excludes; i++) {
+        free(config->source_exclude_globs[i]);
+    }
+    free(config->source_exclude_globs);
+    
+    for (size_t i = 0; i < config->num_sketch_fields; i++) {
+        free(config->sketch_fields[i]);
+    }
+    free(config->sketch_fields);
+    
+    free(config->json_level_keys);
+    free(config->json_message_keys);
+    free(config->json_timestamp_keys);
     free(config->alert_file);
+    free(config->metrics_file);
+    free(config->template_file);
+    free(config->sketch_file);
+    free(config->store_dir);
+    free(config->query_socket);
     memset(config, 0, sizeof(config_t));
 }
\ No newline at end of file
@@ -0,0 +1,593 @@
+#include "context_ring.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Longest record header: two 64-bit varints
+#define MAX_HEADER 20
+
+// Alert waiting for the lines after it
+typedef struct context_hold {
+    struct context_hold* next;
+    log_entry_t* entry;
+    uint64_t position;
+    int64_t deadline;                   // ns
+} context_hold_t;
+
+// Ring of one source; records from head, wrapping at the ring size
+typedef struct context_source {
+    struct context_source* hash_next;
+    struct context_source* newer;       // LRU neighbours
+    struct context_source* older;
+    uint64_t key;
+    uint64_t first;                     // Position of the oldest record
+    uint64_t next;                      // Position of the next record
+    size_t head;                        // Offset of the oldest record
+    size_t used;                        // Bytes of records
+    int64_t first_time;                 // Timestamp of the oldest record
+    int64_t last_time;                  // Timestamp of the newest record
+    context_hold_t* held;               // In position order
+    context_hold_t** held_tail;
+    unsigned char data[];
+} context_source_t;
+
+// Located record, as an offset from the source's head
+typedef struct {
+    size_t offset;
+    uint32_t length;
+    log_level_t level;
+    int64_t timestamp;
+} context_record_t;
+
+static uint64_t source_key(const char* source) {
+    return hash64(source, strlen(source), 0);
+}
+
+static context_stripe_t* stripe_of(context_ring_t* ring, uint64_t key) {
+    return &ring->stripes[(key >> 60) % ring->num_stripes];
+}
+
+static context_source_t** chain_of(context_stripe_t* stripe, uint64_t key) {
+    return &stripe->table[key & stripe->table_mask];
+}
+
+static context_source_t* lookup(context_stripe_t* stripe, uint64_t key) {
+    for (context_source_t* source = *chain_of(stripe, key); source; source = source->hash_next) {
+        if (source->key == key) {
+            return source;
+        }
+    }
+    return NULL;
+}
+
+static void lru_unlink(context_stripe_t* stripe, context_source_t* source) {
+    if (source->newer) {
+        source->newer->older = source->older;
+    } else {
+        stripe->newest = source->older;
+    }
+    if (source->older) {
+        source->older->newer = source->newer;
+    } else {
+        stripe->oldest = source->newer;
+    }
+    source->newer = NULL;
+    source->older = NULL;
+}
+
+static void lru_push(context_stripe_t* stripe, context_source_t* source) {
+    source->older = stripe->newest;
+    source->newer = NULL;
+    if (stripe->newest) {
+        stripe->newest->newer = source;
+    } else {
+        stripe->oldest = source;
+    }
+    stripe->newest = source;
+}
+
+static inline unsigned char byte_at(const context_ring_t* ring, const context_source_t* source,
+                                    size_t offset) {
+    return source->data[(source->head + offset) % ring->ring_size];
+}
+
+static uint64_t read_varint(const context_ring_t* ring, const context_source_t* source,
+                            size_t* offset) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char byte = byte_at(ring, source, (*offset)++);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+static size_t write_varint(unsigned char* out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char)value;
+    return length;
+}
+
+static inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Decode the record at offset; the timestamp is relative to the previous one
+static size_t read_record(const context_ring_t* ring, const context_source_t* source,
+                          size_t offset, context_record_t* record) {
+    uint64_t header = read_varint(ring, source, &offset);
+    int64_t delta = unzigzag(read_varint(ring, source, &offset));
+    record->offset = offset;
+    record->length = (uint32_t)(header >> 3);
+    record->level = (log_level_t)(header & 7);
+    record->timestamp = delta;
+    return offset + record->length;
+}
+
+// Copy bytes out of the ring, which may wrap
+static void copy_out(const context_ring_t* ring, const context_source_t* source, size_t offset,
+                     char* out, size_t length) {
+    size_t start = (source->head + offset) % ring->ring_size;
+    size_t first = ring->ring_size - start < length ? ring->ring_size - start : length;
+    memcpy(out, source->data + start, first);
+    memcpy(out + first, source->data, length - first);
+}
+
+static void copy_in(const context_ring_t* ring, context_source_t* source, const void* data,
+                    size_t length) {
+    size_t start = (source->head + source->used) % ring->ring_size;
+    size_t first = ring->ring_size - start < length ? ring->ring_size - start : length;
+    memcpy(source->data + start, data, first);
+    memcpy(source->data, (const char*)data + first, length - first);
+    source->used += length;
+}
+
+static void drop_oldest(const context_ring_t* ring, context_source_t* source) {
+    context_record_t record;
+    size_t end = read_record(ring, source, 0, &record);
+    source->head = (source->head + end) % ring->ring_size;
+    source->used -= end;
+    source->first++;
+    if (source->used > 0) {
+        read_record(ring, source, 0, &record);
+        source->first_time += record.timestamp;
+    }
+}
+
+// Copy the records in [from, to), except skip, into one allocation; lines
+// before skip count as preceding ones
+static log_context_t* build_context(const context_ring_t* ring, const context_source_t* source,
+                                    uint64_t from, uint64_t to, uint64_t skip) {
+    context_record_t records[2 * CONTEXT_RING_MAX_LINES + 1];
+    size_t count = 0;
+    size_t text = 0;
+    uint32_t before = 0;
+    size_t offset = 0;
+    int64_t timestamp = source->first_time;
+    if (from < source->first) {
+        from = source->first;
+    }
+    if (to > source->next) {
+        to = source->next;
+    }
+
+    for (uint64_t position = source->first; position < to; position++) {
+        context_record_t record;
+        offset = read_record(ring, source, offset, &record);
+        if (position != source->first) {
+            timestamp += record.timestamp;
+        }
+        if (position < from || position == skip || count == sizeof(records) / sizeof(records[0])) {
+            continue;
+        }
+        record.timestamp = timestamp;
+        records[count++] = record;
+        text += record.length;
+        before += position < skip;
+    }
+    if (count == 0) {
+        return NULL;
+    }
+
+    size_t lines_size = sizeof(log_context_t) + count * sizeof(log_context_line_t);
+    log_context_t* context = (log_context_t*)malloc(lines_size + text);
+    if (!context) {
+        return NULL;
+    }
+    context->size = lines_size + text;
+    context->num_before = before;
+    context->num_lines = (uint32_t)count;
+    size_t at = lines_size;
+    for (size_t i = 0; i < count; i++) {
+        context->lines[i].timestamp = records[i].timestamp;
+        context->lines[i].offset = (uint32_t)at;
+        context->lines[i].length = records[i].length;
+        context->lines[i].level = records[i].level;
+        copy_out(ring, source, records[i].offset, (char*)context + at, records[i].length);
+        at += records[i].length;
+    }
+    return context;
+}
+
+// Attach context to the first held alert and move it to the released list
+static void complete_hold(context_ring_t* ring, context_stripe_t* stripe,
+                          context_source_t* source, context_hold_t** released) {
+    context_hold_t* hold = source->held;
+    source->held = hold->next;
+    if (!source->held) {
+        source->held_tail = &source->held;
+    }
+    stripe->held--;
+    size_t held = __atomic_sub_fetch(&ring->num_held, 1, __ATOMIC_RELAXED);
+    metrics_set(ring->held, held);
+
+    uint64_t from = hold->position > ring->before ? hold->position - ring->before : 0;
+    hold->entry->context = build_context(ring, source, from, hold->position + ring->after + 1,
+                                         hold->position);
+    hold->next = *released;
+    *released = hold;
+}
+
+// Hand released alerts on in the order they were held
+static void release_all(context_ring_t* ring, context_hold_t* released) {
+    context_hold_t* ordered = NULL;
+    while (released) {
+        context_hold_t* next = released->next;
+        released->next = ordered;
+        ordered = released;
+        released = next;
+    }
+    while (ordered) {
+        context_hold_t* next = ordered->next;
+        ring->release(ring->ctx, ordered->entry);
+        free(ordered);
+        ordered = next;
+    }
+}
+
+// Reuse the least recently recorded ring; its held alerts are released
+static context_source_t* evict(context_ring_t* ring, context_stripe_t* stripe,
+                               context_hold_t** released) {
+    context_source_t* victim = stripe->oldest;
+    while (victim->held) {
+        complete_hold(ring, stripe, victim, released);
+    }
+    lru_unlink(stripe, victim);
+    context_source_t** link = chain_of(stripe, victim->key);
+    while (*link != victim) {
+        link = &(*link)->hash_next;
+    }
+    *link = victim->hash_next;
+    // Positions of the old source are never handed out again
+    if (victim->next > stripe->base) {
+        stripe->base = victim->next;
+    }
+    metrics_add(ring->evictions, 1);
+    return victim;
+}
+
+static context_source_t* acquire(context_ring_t* ring, context_stripe_t* stripe, uint64_t key,
+                                 context_hold_t** released) {
+    context_source_t* source;
+    if (stripe->num_sources < stripe->max_sources) {
+        source = (context_source_t*)malloc(sizeof(context_source_t) + ring->ring_size);
+        if (!source) {
+            return NULL;
+        }
+        stripe->num_sources++;
+        size_t sources = __atomic_add_fetch(&ring->num_sources, 1, __ATOMIC_RELAXED);
+        metrics_set(ring->sources, sources);
+    } else {
+        source = evict(ring, stripe, released);
+    }
+
+    source->key = key;
+    source->first = stripe->base;
+    source->next = stripe->base;
+    source->head = 0;
+    source->used = 0;
+    source->first_time = 0;
+    source->last_time = 0;
+    source->held = NULL;
+    source->held_tail = &source->held;
+
+    context_source_t** chain = chain_of(stripe, key);
+    source->hash_next = *chain;
+    *chain = source;
+    lru_push(stripe, source);
+    return source;
+}
+
+int context_ring_init(context_ring_t* ring, size_t before, size_t after, size_t ring_size,
+                      size_t memory, int wait_ms, context_ring_release_fn release, void* ctx) {
+    if (!ring || before > CONTEXT_RING_MAX_LINES || after > CONTEXT_RING_MAX_LINES ||
+        ring_size < 2 * MAX_HEADER || !release) {
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(context_ring_t));
+    size_t total = memory / (sizeof(context_source_t) + ring_size);
+    if (total == 0) {
+        total = 1;
+    }
+    ring->num_stripes = total < CONTEXT_RING_STRIPES ? total : CONTEXT_RING_STRIPES;
+    ring->stripes = (context_stripe_t*)calloc(ring->num_stripes, sizeof(context_stripe_t));
+    if (!ring->stripes) {
+        return -1;
+    }
+    ring->before = before;
+    ring->after = after;
+    ring->ring_size = ring_size;
+    ring->wait = (int64_t)(wait_ms > 0 ? wait_ms : 0) * 1000000;
+    ring->release = release;
+    ring->ctx = ctx;
+
+    pthread_mutex_init(&ring->mutex, NULL);
+    pthread_cond_init(&ring->wake, NULL);
+
+    size_t per_stripe = total / ring->num_stripes;
+    size_t table_size = 1;
+    while (table_size < per_stripe) {
+        table_size <<= 1;
+    }
+
+    for (size_t i = 0; i < ring->num_stripes; i++) {
+        context_stripe_t* stripe = &ring->stripes[i];
+        stripe->table = (context_source_t**)calloc(table_size, sizeof(context_source_t*));
+        if (!stripe->table) {
+            context_ring_destroy(ring);
+            return -1;
+        }
+        stripe->table_mask = table_size - 1;
+        stripe->max_sources = per_stripe;
+        pthread_mutex_init(&stripe->mutex, NULL);
+    }
+
+    ring->sources = metrics_register("context.sources", METRIC_GAUGE);
+    ring->held = metrics_register("context.held", METRIC_GAUGE);
+    ring->evictions = metrics_register("context.evictions", METRIC_COUNTER);
+    ring->expired = metrics_register("context.expired", METRIC_COUNTER);
+    metrics_set(ring->sources, 0);
+    metrics_set(ring->held, 0);
+    return 0;
+}
+
+static void* context_ring_thread_func(void* arg) {
+    context_ring_t* ring = (context_ring_t*)arg;
+
+    pthread_mutex_lock(&ring->mutex);
+    while (ring->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)CONTEXT_RING_TICK_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = 0;
+        while (ring->running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&ring->wake, &ring->mutex, &deadline);
+        }
+        if (!ring->running) {
+            break;
+        }
+        pthread_mutex_unlock(&ring->mutex);
+
+        context_ring_advance(ring, timestamp_now());
+
+        pthread_mutex_lock(&ring->mutex);
+    }
+    pthread_mutex_unlock(&ring->mutex);
+
+    return NULL;
+}
+
+int context_ring_start(context_ring_t* ring) {
+    if (!ring || !ring->stripes || ring->started) {
+        return -1;
+    }
+
+    ring->running = true;
+    if (pthread_create(&ring->thread, NULL, context_ring_thread_func, ring) != 0) {
+        ring->running = false;
+        return -1;
+    }
+    ring->started = true;
+    return 0;
+}
+
+void context_ring_stop(context_ring_t* ring) {
+    if (!ring || !ring->stripes) {
+        return;
+    }
+
+    if (ring->started) {
+        pthread_mutex_lock(&ring->mutex);
+        ring->running = false;
+        pthread_cond_signal(&ring->wake);
+        pthread_mutex_unlock(&ring->mutex);
+
+        pthread_join(ring->thread, NULL);
+        ring->started = false;
+    }
+
+    // Nothing follows any more
+    context_ring_advance(ring, INT64_MAX);
+}
+
+void context_ring_destroy(context_ring_t* ring) {
+    if (!ring || !ring->stripes) {
+        return;
+    }
+
+    context_ring_stop(ring);
+    for (size_t i = 0; i < ring->num_stripes; i++) {
+        context_stripe_t* stripe = &ring->stripes[i];
+        if (!stripe->table) {
+            continue;
+        }
+        while (stripe->newest) {
+            context_source_t* source = stripe->newest;
+            stripe->newest = source->older;
+            free(source);
+        }
+        pthread_mutex_destroy(&stripe->mutex);
+        free(stripe->table);
+    }
+    free(ring->stripes);
+    pthread_cond_destroy(&ring->wake);
+    pthread_mutex_destroy(&ring->mutex);
+    memset(ring, 0, sizeof(context_ring_t));
+}
+
+uint64_t context_ring_record(context_ring_t* ring, const log_entry_t* entry) {
+    if (!ring || !ring->stripes || !entry || !entry->source || !entry->raw_line) {
+        return 0;
+    }
+
+    size_t length = strlen(entry->raw_line);
+    if (length > ring->ring_size / 4) {
+        length = ring->ring_size / 4;
+    }
+    uint64_t key = source_key(entry->source);
+    context_stripe_t* stripe = stripe_of(ring, key);
+    context_hold_t* released = NULL;
+    uint64_t position = 0;
+
+    pthread_mutex_lock(&stripe->mutex);
+    context_source_t* source = lookup(stripe, key);
+    if (source) {
+        if (source != stripe->newest) {
+            lru_unlink(stripe, source);
+            lru_push(stripe, source);
+        }
+    } else {
+        source = acquire(ring, stripe, key, &released);
+    }
+
+    if (source) {
+        unsigned char header[MAX_HEADER];
+        int64_t delta = source->used > 0 ? entry->timestamp - source->last_time : 0;
+        size_t header_len = write_varint(header, ((uint64_t)length << 3) | (entry->level & 7));
+        header_len += write_varint(header + header_len, zigzag(delta));
+        while (source->used > 0 && ring->ring_size - source->used < header_len + length) {
+            drop_oldest(ring, source);
+        }
+        if (source->used == 0) {
+            source->head = 0;
+            source->first_time = entry->timestamp;
+            // The delta of the only record is never applied
+        }
+        copy_in(ring, source, header, header_len);
+        copy_in(ring, source, entry->raw_line, length);
+        source->last_time = entry->timestamp;
+        position = source->next++;
+
+        while (source->held && source->next > source->held->position + ring->after) {
+            complete_hold(ring, stripe, source, &released);
+        }
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+
+    release_all(ring, released);
+    return position;
+}
+
+void context_ring_hold(context_ring_t* ring, log_entry_t* entry, uint64_t position, int64_t now) {
+    if (!ring || !ring->stripes || !entry) {
+        log_entry_destroy(entry);
+        return;
+    }
+
+    context_hold_t* hold = (context_hold_t*)malloc(sizeof(context_hold_t));
+    if (!hold) {
+        ring->release(ring->ctx, entry);
+        return;
+    }
+    hold->next = NULL;
+    hold->entry = entry;
+    hold->position = position;
+    hold->deadline = now + ring->wait;
+
+    uint64_t key = source_key(entry->source);
+    context_stripe_t* stripe = stripe_of(ring, key);
+    context_hold_t* released = NULL;
+
+    pthread_mutex_lock(&stripe->mutex);
+    context_source_t* source = lookup(stripe, key);
+    if (!source || position < source->first || position >= source->next) {
+        // The ring moved on to another source, or the entry was never recorded
+        hold->next = released;
+        released = hold;
+    } else {
+        *source->held_tail = hold;
+        source->held_tail = &hold->next;
+        stripe->held++;
+        size_t held = __atomic_add_fetch(&ring->num_held, 1, __ATOMIC_RELAXED);
+        metrics_set(ring->held, held);
+        // Everything may have followed already (or nothing has to)
+        while (source->held && source->next > source->held->position + ring->after) {
+            complete_hold(ring, stripe, source, &released);
+        }
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+
+    release_all(ring, released);
+}
+
+void context_ring_attach(context_ring_t* ring, log_entry_t* entry) {
+    if (!ring || !ring->stripes || !entry || !entry->source || ring->before == 0) {
+        return;
+    }
+
+    uint64_t key = source_key(entry->source);
+    context_stripe_t* stripe = stripe_of(ring, key);
+    pthread_mutex_lock(&stripe->mutex);
+    context_source_t* source = lookup(stripe, key);
+    if (source && !entry->context) {
+        uint64_t from = source->next > ring->before ? source->next - ring->before : 0;
+        entry->context = build_context(ring, source, from, source->next, UINT64_MAX);
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+}
+
+void context_ring_advance(context_ring_t* ring, int64_t now) {
+    if (!ring || !ring->stripes) {
+        return;
+    }
+
+    for (size_t i = 0; i < ring->num_stripes; i++) {
+        context_stripe_t* stripe = &ring->stripes[i];
+        context_hold_t* released = NULL;
+        size_t expired = 0;
+        pthread_mutex_lock(&stripe->mutex);
+        for (context_source_t* source = stripe->newest; source && stripe->held > 0;
+             source = source->older) {
+            while (source->held && source->held->deadline <= now) {
+                complete_hold(ring, stripe, source, &released);
+                expired++;
+            }
+        }
+        pthread_mutex_unlock(&stripe->mutex);
+        if (expired > 0) {
+            metrics_add(ring->expired, expired);
+        }
+        release_all(ring, released);
+    }
+}
\ No newline at end of file
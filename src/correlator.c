@@ -0,0 +1,415 @@
+#include "correlator.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Timers looked at before the earliest one is evicted regardless
+#define EVICT_ATTEMPTS 4
+
+// Passed to the wheel callback
+typedef struct {
+    correlator_t* correlator;
+    correlation_stripe_t* stripe;
+    int64_t now;
+    correlation_state_t* fired;         // Absence matches to report after unlocking
+} expire_ctx_t;
+
+static correlation_state_t* state_of(timer_wheel_timer_t* timer) {
+    return (correlation_state_t*)((char*)timer - offsetof(correlation_state_t, timer));
+}
+
+static uint64_t state_key(size_t rule, const char* source, size_t len) {
+    return hash64(source, len, (uint64_t)rule + 1);
+}
+
+static correlation_stripe_t* stripe_of(correlator_t* correlator, uint64_t key) {
+    return &correlator->stripes[(key >> 60) % CORRELATOR_STRIPES];
+}
+
+static correlation_state_t** chain_of(correlation_stripe_t* stripe, uint64_t key) {
+    return &stripe->table[key & stripe->table_mask];
+}
+
+// The key is only a hash: compare the rule and source too
+static correlation_state_t* lookup(correlation_stripe_t* stripe, uint64_t key, size_t rule,
+                                  const char* source, size_t len) {
+    size_t stored = len < CORRELATOR_SOURCE_MAX ? len : CORRELATOR_SOURCE_MAX - 1;
+    for (correlation_state_t* state = *chain_of(stripe, key); state; state = state->hash_next) {
+        if (state->key == key && state->rule == rule && state->source_len == len &&
+            memcmp(state->source, source, stored) == 0) {
+            return state;
+        }
+    }
+    return NULL;
+}
+
+// Wall-clock time the state expires at if its source goes quiet
+static int64_t expires_at(const correlation_state_t* state) {
+    return state->deadline + state->lag;
+}
+
+// Unlink from the table and the wheel; the caller frees or reports it
+static void detach(correlator_t* correlator, correlation_stripe_t* stripe,
+                   correlation_state_t* state) {
+    correlation_state_t** link = chain_of(stripe, state->key);
+    while (*link != state) {
+        link = &(*link)->hash_next;
+    }
+    *link = state->hash_next;
+    state->hash_next = NULL;
+
+    timer_wheel_cancel(&stripe->wheel, &state->timer);
+    size_t open = __atomic_sub_fetch(&correlator->open, 1, __ATOMIC_RELAXED);
+    metrics_set(correlator->open_gauge, open);
+}
+
+static void free_state(correlation_stripe_t* stripe, correlation_state_t* state) {
+    state->hash_next = stripe->free_list;
+    stripe->free_list = state;
+}
+
+static bool awaits_absence(const sequence_rule_t* rule, const correlation_state_t* state) {
+    return rule->absence && state->step == rule->num_steps - 1;
+}
+
+// Time ran out: an absence rule fires, anything else is dropped
+static void end_state(expire_ctx_t* ctx, correlation_state_t* state) {
+    detach(ctx->correlator, ctx->stripe, state);
+    if (awaits_absence(&ctx->correlator->rules[state->rule], state)) {
+        state->hash_next = ctx->fired;
+        ctx->fired = state;
+    } else {
+        free_state(ctx->stripe, state);
+        metrics_add(ctx->correlator->expired, 1);
+    }
+}
+
+// Wheel callback: expiry moves later on restarts without touching the
+// timer, so an early timer is pushed back instead of expiring the state
+static void expire_state(void* arg, timer_wheel_timer_t* timer) {
+    expire_ctx_t* ctx = (expire_ctx_t*)arg;
+    correlation_state_t* state = state_of(timer);
+    if (expires_at(state) > ctx->now) {
+        timer_wheel_schedule(&ctx->stripe->wheel, timer, expires_at(state));
+        return;
+    }
+    end_state(ctx, state);
+}
+
+// Report absence matches, then return their states to the pool
+static void report_fired(expire_ctx_t* ctx) {
+    if (!ctx->fired) {
+        return;
+    }
+
+    correlator_t* correlator = ctx->correlator;
+    for (correlation_state_t* state = ctx->fired; state; state = state->hash_next) {
+        metrics_add(correlator->matched, 1);
+        correlator->alert(correlator->ctx, &correlator->rules[state->rule], state->source,
+                          LOG_LEVEL_WARNING, state->deadline - state->started);
+    }
+
+    pthread_mutex_lock(&ctx->stripe->mutex);
+    while (ctx->fired) {
+        correlation_state_t* state = ctx->fired;
+        ctx->fired = state->hash_next;
+        free_state(ctx->stripe, state);
+    }
+    pthread_mutex_unlock(&ctx->stripe->mutex);
+}
+
+// Drop the state closest to expiry to make room
+static void evict(correlator_t* correlator, correlation_stripe_t* stripe) {
+    timer_wheel_timer_t* timer = timer_wheel_earliest(&stripe->wheel);
+    for (int i = 0; timer && i < EVICT_ATTEMPTS; i++) {
+        correlation_state_t* state = state_of(timer);
+        if ((int64_t)timer->expires * stripe->wheel.tick + stripe->wheel.origin >=
+            expires_at(state)) {
+            break; // Accurate timer
+        }
+        timer_wheel_schedule(&stripe->wheel, timer, expires_at(state));
+        timer = timer_wheel_earliest(&stripe->wheel);
+    }
+
+    if (timer) {
+        correlation_state_t* state = state_of(timer);
+        detach(correlator, stripe, state);
+        free_state(stripe, state);
+        metrics_add(correlator->evictions, 1);
+    }
+}
+
+static correlation_state_t* acquire(correlator_t* correlator, correlation_stripe_t* stripe,
+                                    uint64_t key, size_t rule, const char* source, size_t len,
+                                    int64_t event, int64_t lag) {
+    if (!stripe->free_list) {
+        evict(correlator, stripe);
+    }
+    correlation_state_t* state = stripe->free_list;
+    if (!state) {
+        return NULL;
+    }
+    stripe->free_list = state->hash_next;
+
+    memset(state, 0, sizeof(correlation_state_t));
+    state->key = key;
+    state->rule = (uint32_t)rule;
+    state->step = 1;
+    state->started = event;
+    state->deadline = event + correlator->rules[rule].window;
+    state->lag = lag;
+
+    state->source_len = (uint32_t)len;
+    if (len >= sizeof(state->source)) {
+        len = sizeof(state->source) - 1;
+    }
+    memcpy(state->source, source, len);
+    state->source[len] = '\0';
+
+    correlation_state_t** chain = chain_of(stripe, key);
+    state->hash_next = *chain;
+    *chain = state;
+    timer_wheel_schedule(&stripe->wheel, &state->timer, expires_at(state));
+
+    size_t open = __atomic_add_fetch(&correlator->open, 1, __ATOMIC_RELAXED);
+    metrics_set(correlator->open_gauge, open);
+    return state;
+}
+
+int correlator_init(correlator_t* correlator, const sequence_rule_t* rules, size_t num_rules,
+                    size_t capacity, correlator_alert_fn alert, void* ctx, int64_t now) {
+    if (!correlator || !rules || num_rules == 0 || capacity == 0 || !alert) {
+        return -1;
+    }
+
+    memset(correlator, 0, sizeof(correlator_t));
+    correlator->stripes = (correlation_stripe_t*)calloc(CORRELATOR_STRIPES,
+                                                        sizeof(correlation_stripe_t));
+    if (!correlator->stripes) {
+        return -1;
+    }
+    correlator->rules = rules;
+    correlator->num_rules = num_rules;
+    correlator->alert = alert;
+    correlator->ctx = ctx;
+
+    pthread_mutex_init(&correlator->mutex, NULL);
+    pthread_cond_init(&correlator->wake, NULL);
+
+    size_t per_stripe = (capacity + CORRELATOR_STRIPES - 1) / CORRELATOR_STRIPES;
+    size_t table_size = 1;
+    while (table_size < per_stripe) {
+        table_size <<= 1;
+    }
+
+    for (size_t i = 0; i < CORRELATOR_STRIPES; i++) {
+        correlation_stripe_t* stripe = &correlator->stripes[i];
+        stripe->states = (correlation_state_t*)calloc(per_stripe, sizeof(correlation_state_t));
+        stripe->table = (correlation_state_t**)calloc(table_size, sizeof(correlation_state_t*));
+        if (!stripe->states || !stripe->table) {
+            free(stripe->states);
+            free(stripe->table);
+            stripe->states = NULL;
+            correlator_destroy(correlator);
+            return -1;
+        }
+        stripe->table_mask = table_size - 1;
+        for (size_t j = per_stripe; j > 0; j--) {
+            free_state(stripe, &stripe->states[j - 1]);
+        }
+        timer_wheel_init(&stripe->wheel, CORRELATOR_TICK_NS, now);
+        pthread_mutex_init(&stripe->mutex, NULL);
+    }
+
+    correlator->open_gauge = metrics_register("correlator.open", METRIC_GAUGE);
+    correlator->matched = metrics_register("correlator.matched", METRIC_COUNTER);
+    correlator->expired = metrics_register("correlator.expired", METRIC_COUNTER);
+    correlator->evictions = metrics_register("correlator.evictions", METRIC_COUNTER);
+    metrics_set(correlator->open_gauge, 0);
+    return 0;
+}
+
+static void* correlator_thread_func(void* arg) {
+    correlator_t* correlator = (correlator_t*)arg;
+
+    pthread_mutex_lock(&correlator->mutex);
+    while (correlator->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)CORRELATOR_TICK_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = 0;
+        while (correlator->running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&correlator->wake, &correlator->mutex, &deadline);
+        }
+        if (!correlator->running) {
+            break;
+        }
+        pthread_mutex_unlock(&correlator->mutex);
+
+        correlator_advance(correlator, timestamp_now());
+
+        pthread_mutex_lock(&correlator->mutex);
+    }
+    pthread_mutex_unlock(&correlator->mutex);
+
+    return NULL;
+}
+
+int correlator_start(correlator_t* correlator) {
+    if (!correlator || !correlator->stripes || correlator->started) {
+        return -1;
+    }
+
+    correlator->running = true;
+    if (pthread_create(&correlator->thread, NULL, correlator_thread_func, correlator) != 0) {
+        correlator->running = false;
+        return -1;
+    }
+    correlator->started = true;
+    return 0;
+}
+
+void correlator_stop(correlator_t* correlator) {
+    if (!correlator || !correlator->started) {
+        return;
+    }
+
+    pthread_mutex_lock(&correlator->mutex);
+    correlator->running = false;
+    pthread_cond_signal(&correlator->wake);
+    pthread_mutex_unlock(&correlator->mutex);
+
+    pthread_join(correlator->thread, NULL);
+    correlator->started = false;
+}
+
+void correlator_destroy(correlator_t* correlator) {
+    if (!correlator || !correlator->stripes) {
+        return;
+    }
+
+    correlator_stop(correlator);
+    for (size_t i = 0; i < CORRELATOR_STRIPES; i++) {
+        correlation_stripe_t* stripe = &correlator->stripes[i];
+        if (!stripe->states) {
+            continue;
+        }
+        pthread_mutex_destroy(&stripe->mutex);
+        free(stripe->states);
+        free(stripe->table);
+    }
+    free(correlator->stripes);
+    pthread_cond_destroy(&correlator->wake);
+    pthread_mutex_destroy(&correlator->mutex);
+    memset(correlator, 0, sizeof(correlator_t));
+}
+
+void correlator_observe(correlator_t* correlator, log_entry_t* entry, int64_t now) {
+    if (!correlator || !correlator->stripes || !entry || !entry->source) {
+        return;
+    }
+
+    // Windows run on event time; the lag carries them over to the wall clock
+    int64_t event = entry->timestamp ? entry->timestamp : now;
+    int64_t lag = now > event ? now - event : 0;
+
+    for (size_t i = 0; i < correlator->num_rules; i++) {
+        const sequence_rule_t* rule = &correlator->rules[i];
+        unsigned int steps = 0;
+        for (size_t s = 0; s < rule->num_steps; s++) {
+            if (log_selector_matches(&rule->steps[s], entry)) {
+                steps |= 1u << s;
+            }
+        }
+        if (steps == 0) {
+            continue;
+        }
+
+        size_t len = log_entry_source_class_len(entry->source);
+        uint64_t key = state_key(i, entry->source, len);
+        correlation_stripe_t* stripe = stripe_of(correlator, key);
+        expire_ctx_t ctx = {correlator, stripe, now, NULL};
+        bool matched = false;
+        int64_t elapsed = 0;
+
+        pthread_mutex_lock(&stripe->mutex);
+        timer_wheel_advance(&stripe->wheel, now, expire_state, &ctx);
+
+        // The entry's own time decides whether it is in the window
+        correlation_state_t* state = lookup(stripe, key, i, entry->source, len);
+        if (state && event >= state->deadline) {
+            end_state(&ctx, state);
+            state = NULL;
+        }
+
+        int64_t expiry = state ? expires_at(state) : 0;
+        if (state) {
+            state->lag = lag;
+        }
+
+        if (!state) {
+            if (steps & 1u) {
+                acquire(correlator, stripe, key, i, entry->source, len, event, lag);
+            }
+        } else if (steps & (1u << state->step)) {
+            if (awaits_absence(rule, state)) {
+                detach(correlator, stripe, state); // Arrived in time
+                free_state(stripe, state);
+                state = NULL;
+            } else if (++state->step == rule->num_steps) {
+                matched = true;
+                elapsed = event > state->started ? event - state->started : 0;
+                detach(correlator, stripe, state);
+                free_state(stripe, state);
+                state = NULL;
+            }
+        } else if ((steps & 1u) && state->step == 1 && !awaits_absence(rule, state) &&
+                   event > state->started) {
+            // Measure from the latest first step
+            state->started = event;
+            state->deadline = event + rule->window;
+        }
+
+        // A shrinking lag moves expiry earlier, which the push-back cannot do
+        if (state && expires_at(state) < expiry) {
+            timer_wheel_schedule(&stripe->wheel, &state->timer, expires_at(state));
+        }
+        pthread_mutex_unlock(&stripe->mutex);
+
+        report_fired(&ctx);
+        if (matched) {
+            metrics_add(correlator->matched, 1);
+            correlator->alert(correlator->ctx, rule, entry->source, entry->level, elapsed);
+        }
+    }
+}
+
+void correlator_advance(correlator_t* correlator, int64_t now) {
+    if (!correlator || !correlator->stripes) {
+        return;
+    }
+
+    for (size_t i = 0; i < CORRELATOR_STRIPES; i++) {
+        correlation_stripe_t* stripe = &correlator->stripes[i];
+        expire_ctx_t ctx = {correlator, stripe, now, NULL};
+        pthread_mutex_lock(&stripe->mutex);
+        timer_wheel_advance(&stripe->wheel, now, expire_state, &ctx);
+        pthread_mutex_unlock(&stripe->mutex);
+        report_fired(&ctx);
+    }
+}
+
+size_t correlator_open(const correlator_t* correlator) {
+    return correlator ? __atomic_load_n(&correlator->open, __ATOMIC_RELAXED) : 0;
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "field_rule.h"
+#include "log_entry.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FIELD_RULE_MAX_NAME 128
+
+int field_rule_parse(field_rule_t* rule, const char* text) {
+    if (!rule || !text) {
+        return -1;
+    }
+    
+    memset(rule, 0, sizeof(field_rule_t));
+    
+    // Field name runs up to the first operator character
+    size_t name_len = strcspn(text, "=!<>~");
+    while (name_len > 0 && text[name_len - 1] == ' ') {
+        name_len--;
+    }
+    if (name_len == 0 || name_len >= FIELD_RULE_MAX_NAME) {
+        return -1;
+    }
+    
+    const char* op = text + strcspn(text, "=!<>~");
+    const char* rhs = op;
+    
+    if (*op == '\0') {
+        rule->op = FIELD_OP_EXISTS;
+    } else if (strncmp(op, "==", 2) == 0) {
+        rule->op = FIELD_OP_EQ;
+        rhs = op + 2;
+    } else if (strncmp(op, "!=", 2) == 0) {
+        rule->op = FIELD_OP_NE;
+        rhs = op + 2;
+    } else if (strncmp(op, "<=", 2) == 0) {
+        rule->op = FIELD_OP_LE;
+        rhs = op + 2;
+    } else if (strncmp(op, ">=", 2) == 0) {
+        rule->op = FIELD_OP_GE;
+        rhs = op + 2;
+    } else if (*op == '=') {
+        rule->op = FIELD_OP_EQ;
+        rhs = op + 1;
+    } else if (*op == '<') {
+        rule->op = FIELD_OP_LT;
+        rhs = op + 1;
+    } else if (*op == '>') {
+        rule->op = FIELD_OP_GT;
+        rhs = op + 1;
+    } else if (*op == '~') {
+        rule->op = FIELD_OP_CONTAINS;
+        rhs = op + 1;
+    } else {
+        return -1;
+    }
+    
+    while (*rhs == ' ') rhs++;
+    if (rule->op != FIELD_OP_EXISTS && *rhs == '\0') {
+        return -1;
+    }
+    
+    rule->field = strndup(text, name_len);
+    rule->value = strdup(rule->op == FIELD_OP_EXISTS ? "" : rhs);
+    if (!rule->field || !rule->value) {
+        field_rule_destroy(rule);
+        return -1;
+    }
+    
+    if (*rule->value) {
+        char* end;
+        rule->number = strtod(rule->value, &end);
+        rule->numeric = (*end == '\0');
+    }
+    
+    return 0;
+}
+
+void field_rule_destroy(field_rule_t* rule) {
+    if (!rule) {
+        return;
+    }
+    
+    free(rule->field);
+    free(rule->value);
+    memset(rule, 0, sizeof(field_rule_t));
+}
+
+static bool contains(const char* haystack, size_t haystack_len, const char* needle) {
+    size_t needle_len = strlen(needle);
+    if (needle_len > haystack_len) {
+        return false;
+    }
+    for (size_t i = 0; i + needle_len <= haystack_len; i++) {
+        if (memcmp(haystack + i, needle, needle_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool field_rule_matches(const field_rule_t* rule, log_entry_t* entry) {
+    if (!rule || !rule->field || !entry) {
+        return false;
+    }
+    
+    const char* value;
+    size_t length;
+    if (!log_entry_get_field(entry, rule->field, &value, &length)) {
+        return false;
+    }
+    
+    if (rule->op == FIELD_OP_EXISTS) {
+        return true;
+    }
+    if (rule->op == FIELD_OP_CONTAINS) {
+        return contains(value, length, rule->value);
+    }
+    
+    // Numeric comparison when both sides are numbers
+    double number;
+    if (rule->numeric && log_entry_get_field_number(entry, rule->field, &number)) {
+        switch (rule->op) {
+            case FIELD_OP_EQ: return number == rule->number;
+            case FIELD_OP_NE: return number != rule->number;
+            case FIELD_OP_LT: return number < rule->number;
+            case FIELD_OP_LE: return number <= rule->number;
+            case FIELD_OP_GT: return number > rule->number;
+            case FIELD_OP_GE: return number >= rule->number;
+            default: return false;
+        }
+    }
+    
+    // Otherwise compare as text
+    size_t rhs_len = strlen(rule->value);
+    size_t n = length < rhs_len ? length : rhs_len;
+    int cmp = memcmp(value, rule->value, n);
+    if (cmp == 0) {
+        cmp = (length > rhs_len) - (length < rhs_len);
+    }
+    
+    switch (rule->op) {
+        case FIELD_OP_EQ: return cmp == 0;
+        case FIELD_OP_NE: return cmp != 0;
+        case FIELD_OP_LT: return cmp < 0;
+        case FIELD_OP_LE: return cmp <= 0;
+        case FIELD_OP_GT: return cmp > 0;
+        case FIELD_OP_GE: return cmp >= 0;
+        default: return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "file_rotator.h"
+#include "alert_writer.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Wait before trying again after a failed rename or reopen
+#define ROTATE_RETRY_NS (60 * TIMESTAMP_NS_PER_SEC)
+// Rotated files considered by retention
+#define RETENTION_MAX 4096
+
+static void* file_rotator_thread_func(void* arg);
+static void apply_retention(file_rotator_t* rotator, int64_t now);
+
+int file_rotator_open(file_rotator_t* rotator, const char* name, const char* path,
+                      const config_t* config) {
+    if (!rotator || !name || !path || !config) {
+        return -1;
+    }
+
+    memset(rotator, 0, sizeof(file_rotator_t));
+    rotator->fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (rotator->fd < 0) {
+        perror("Failed to open alert file");
+        return -1;
+    }
+    rotator->path = strdup(path);
+    if (!rotator->path) {
+        close(rotator->fd);
+        return -1;
+    }
+    struct stat st;
+    rotator->size = fstat(rotator->fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    rotator->opened_at = timestamp_now();
+
+    rotator->max_size = config->alert_rotate_size;
+    rotator->interval = (int64_t)config->alert_rotate_interval * TIMESTAMP_NS_PER_SEC;
+    rotator->keep = config->alert_rotate_keep;
+    rotator->max_age = (int64_t)config->alert_rotate_max_age * TIMESTAMP_NS_PER_SEC;
+#ifdef HAVE_ZLIB
+    rotator->compress = config->alert_rotate_compress;
+#else
+    if (config->alert_rotate_compress && (rotator->max_size > 0 || rotator->interval > 0)) {
+        fprintf(stderr, "Built without zlib, rotated alert files stay uncompressed\n");
+    }
+#endif
+    pthread_mutex_init(&rotator->lock, NULL);
+    pthread_cond_init(&rotator->wake, NULL);
+
+    char metric[METRICS_NAME_MAX];
+    snprintf(metric, sizeof(metric), "%s.rotations", name);
+    rotator->rotations = metrics_register(metric, METRIC_COUNTER);
+    snprintf(metric, sizeof(metric), "%s.compressed", name);
+    rotator->compressed = metrics_register(metric, METRIC_COUNTER);
+    snprintf(metric, sizeof(metric), "%s.expired", name);
+    rotator->expired = metrics_register(metric, METRIC_COUNTER);
+    snprintf(metric, sizeof(metric), "%s.rotate_errors", name);
+    rotator->errors = metrics_register(metric, METRIC_COUNTER);
+
+    // Files left by earlier runs expire even if this one never rotates
+    apply_retention(rotator, rotator->opened_at);
+    return 0;
+}
+
+static bool path_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// "<path>.<YYYYmmdd-HHMMSS>[.N]", unused with or without ".gz"
+static int rotated_name(const file_rotator_t* rotator, int64_t now, char* out, size_t size) {
+    time_t seconds = (time_t)(now / TIMESTAMP_NS_PER_SEC);
+    struct tm timeinfo;
+    localtime_r(&seconds, &timeinfo);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &timeinfo);
+
+    for (int n = 0; n < 100; n++) {
+        int length = n == 0 ? snprintf(out, size, "%s.%s", rotator->path, stamp)
+                            : snprintf(out, size, "%s.%s.%d", rotator->path, stamp, n);
+        char compressed[PATH_MAX];
+        if (length < 0 || (size_t)length + 3 >= size || (size_t)length + 3 >= sizeof(compressed)) {
+            return -1;
+        }
+        memcpy(compressed, out, (size_t)length);
+        memcpy(compressed + length, ".gz", 4);
+        if (!path_exists(out) && !path_exists(compressed)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Hand a rotated file to the background thread (started on first use)
+static void schedule(file_rotator_t* rotator, const char* rotated) {
+    if (!rotator->compress && rotator->keep == 0 && rotator->max_age == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&rotator->lock);
+    if (!rotator->started) {
+        rotator->running = true;
+        if (pthread_create(&rotator->thread, NULL, file_rotator_thread_func, rotator) == 0) {
+            rotator->started = true;
+        } else {
+            rotator->running = false;
+        }
+    }
+    if (rotator->started && rotator->num_pending < FILE_ROTATOR_PENDING) {
+        char* copy = strdup(rotated);
+        if (copy) {
+            rotator->pending[rotator->num_pending++] = copy;
+            pthread_cond_signal(&rotator->wake);
+        }
+    } else {
+        // Left uncompressed; retention still covers it
+        metrics_add(rotator->errors, 1);
+    }
+    pthread_mutex_unlock(&rotator->lock);
+}
+
+int file_rotator_rotate(file_rotator_t* rotator, int64_t now) {
+    if (!rotator || rotator->fd < 0) {
+        return -1;
+    }
+    if (rotator->retry_at != 0 && now < rotator->retry_at) {
+        return -1;
+    }
+
+    char rotated[PATH_MAX];
+    if (rotated_name(rotator, now, rotated, sizeof(rotated)) != 0 ||
+        rename(rotator->path, rotated) != 0) {
+        metrics_add(rotator->errors, 1);
+        rotator->retry_at = now + ROTATE_RETRY_NS;
+        return -1;
+    }
+
+    // The old descriptor still points at the renamed file until the new one is open
+    int fd = open(rotator->path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        rename(rotated, rotator->path);
+        metrics_add(rotator->errors, 1);
+        rotator->retry_at = now + ROTATE_RETRY_NS;
+        return -1;
+    }
+    close(rotator->fd);
+    rotator->fd = fd;
+    rotator->size = 0;
+    rotator->opened_at = now;
+    rotator->retry_at = 0;
+    metrics_add(rotator->rotations, 1);
+
+    schedule(rotator, rotated);
+    return 0;
+}
+
+int file_rotator_write(file_rotator_t* rotator, struct iovec* iov, int count, int64_t now) {
+    if (!rotator || rotator->fd < 0) {
+        return -1;
+    }
+
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        length += iov[i].iov_len;
+    }
+    if ((rotator->max_size > 0 && rotator->size > 0 && rotator->size + length > rotator->max_size) ||
+        (rotator->interval > 0 && now - rotator->opened_at >= rotator->interval)) {
+        file_rotator_rotate(rotator, now);
+    }
+
+    if (alert_write_fd(rotator->fd, iov, count) != 0) {
+        return -1;
+    }
+    rotator->size += length;
+    return 0;
+}
+
+#ifdef HAVE_ZLIB
+// gzip a file next to itself, then remove the original (keeps its mtime)
+static int compress_file(const char* path) {
+    char target[PATH_MAX];
+    char temp[PATH_MAX];
+    snprintf(target, sizeof(target), "%s.gz", path);
+    snprintf(temp, sizeof(temp), "%s.gz.tmp", path);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1; // Already removed by retention
+    }
+    struct stat st;
+    gzFile out = fstat(fd, &st) == 0 ? gzopen(temp, "wb6") : NULL;
+    if (!out) {
+        close(fd);
+        return -1;
+    }
+
+    char buffer[65536];
+    ssize_t n;
+    int result = 0;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = -1;
+            break;
+        }
+        if (gzwrite(out, buffer, (unsigned int)n) != (int)n) {
+            result = -1;
+            break;
+        }
+    }
+    close(fd);
+    if (gzclose(out) != Z_OK) {
+        result = -1;
+    }
+
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    if (result != 0 || utimensat(AT_FDCWD, temp, times, 0) != 0 || rename(temp, target) != 0) {
+        unlink(temp);
+        return -1;
+    }
+    unlink(path);
+    return 1;
+}
+#endif
+
+typedef struct {
+    char* name;
+    int64_t mtime;
+} rotated_file_t;
+
+static int newest_first(const void* a, const void* b) {
+    const rotated_file_t* x = (const rotated_file_t*)a;
+    const rotated_file_t* y = (const rotated_file_t*)b;
+    if (x->mtime != y->mtime) {
+        return x->mtime > y->mtime ? -1 : 1;
+    }
+    return -strcmp(x->name, y->name);
+}
+
+// "<base>.<8 digits>-<6 digits>" followed by nothing, ".N" or ".gz"
+static bool is_rotated(const char* name, const char* base, size_t base_len) {
+    if (strncmp(name, base, base_len) != 0 || name[base_len] != '.') {
+        return false;
+    }
+    const char* stamp = name + base_len + 1;
+    for (int i = 0; i < 15; i++) {
+        bool digit = stamp[i] >= '0' && stamp[i] <= '9';
+        if (i == 8 ? stamp[i] != '-' : !digit) {
+            return false;
+        }
+    }
+    const char* rest = stamp + 15;
+    return *rest == '\0' || *rest == '.';
+}
+
+// Remove rotated files beyond the count or past the age limit
+static void apply_retention(file_rotator_t* rotator, int64_t now) {
+    if (rotator->keep == 0 && rotator->max_age == 0) {
+        return;
+    }
+
+    char directory[PATH_MAX];
+    const char* slash = strrchr(rotator->path, '/');
+    const char* base = slash ? slash + 1 : rotator->path;
+    if (slash) {
+        snprintf(directory, sizeof(directory), "%.*s",
+                 (int)(slash - rotator->path > 0 ? slash - rotator->path : 1), rotator->path);
+    } else {
+        strcpy(directory, ".");
+    }
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        metrics_add(rotator->errors, 1);
+        return;
+    }
+
+    rotated_file_t* files = (rotated_file_t*)malloc(RETENTION_MAX * sizeof(rotated_file_t));
+    size_t count = 0;
+    size_t base_len = strlen(base);
+    struct dirent* item;
+    while (files && count < RETENTION_MAX && (item = readdir(dir)) != NULL) {
+        size_t len = strlen(item->d_name);
+        if (!is_rotated(item->d_name, base, base_len) ||
+            (len > 4 && strcmp(item->d_name + len - 4, ".tmp") == 0)) {
+            continue;
+        }
+        char full[PATH_MAX];
+        struct stat st;
+        if (snprintf(full, sizeof(full), "%s/%s", directory, item->d_name) >= (int)sizeof(full) ||
+            stat(full, &st) != 0) {
+            continue;
+        }
+        files[count].name = strdup(full);
+        files[count].mtime = (int64_t)st.st_mtim.tv_sec * TIMESTAMP_NS_PER_SEC + st.st_mtim.tv_nsec;
+        if (files[count].name) {
+            count++;
+        }
+    }
+    closedir(dir);
+
+    if (files) {
+        qsort(files, count, sizeof(rotated_file_t), newest_first);
+        for (size_t i = 0; i < count; i++) {
+            bool too_many = rotator->keep > 0 && i >= rotator->keep;
+            bool too_old = rotator->max_age > 0 && now - files[i].mtime > rotator->max_age;
+            if ((too_many || too_old) && unlink(files[i].name) == 0) {
+                metrics_add(rotator->expired, 1);
+            }
+            free(files[i].name);
+        }
+        free(files);
+    }
+}
+
+static void* file_rotator_thread_func(void* arg) {
+    file_rotator_t* rotator = (file_rotator_t*)arg;
+#ifdef __linux__
+    // Compression is background work: lowest priority for this thread only
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+
+    pthread_mutex_lock(&rotator->lock);
+    while (true) {
+        while (rotator->running && rotator->num_pending == 0) {
+            pthread_cond_wait(&rotator->wake, &rotator->lock);
+        }
+        if (rotator->num_pending == 0) {
+            break;
+        }
+        char* rotated = rotator->pending[0];
+        rotator->num_pending--;
+        memmove(rotator->pending, rotator->pending + 1, rotator->num_pending * sizeof(char*));
+        pthread_mutex_unlock(&rotator->lock);
+
+#ifdef HAVE_ZLIB
+        if (rotator->compress) {
+            int result = compress_file(rotated);
+            if (result > 0) {
+                metrics_add(rotator->compressed, 1);
+            } else if (result < 0) {
+                metrics_add(rotator->errors, 1);
+            }
+        }
+#endif
+        apply_retention(rotator, timestamp_now());
+        free(rotated);
+
+        pthread_mutex_lock(&rotator->lock);
+    }
+    pthread_mutex_unlock(&rotator->lock);
+
+    return NULL;
+}
+
+void file_rotator_close(file_rotator_t* rotator) {
+    if (!rotator || !rotator->path) {
+        return;
+    }
+
+    if (rotator->started) {
+        pthread_mutex_lock(&rotator->lock);
+        rotator->running = false;
+        pthread_cond_signal(&rotator->wake);
+        pthread_mutex_unlock(&rotator->lock);
+        pthread_join(rotator->thread, NULL);
+    }
+    for (size_t i = 0; i < rotator->num_pending; i++) {
+        free(rotator->pending[i]);
+    }
+    if (rotator->fd >= 0) {
+        close(rotator->fd);
+    }
+    pthread_cond_destroy(&rotator->wake);
+    pthread_mutex_destroy(&rotator->lock);
+    free(rotator->path);
+    memset(rotator, 0, sizeof(file_rotator_t));
+    rotator->fd = -1;
+}
\ No newline at end of file
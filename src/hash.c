@@ -0,0 +1,50 @@
+#include "hash.h"
+#include <string.h>
+
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3 0x165667B19E3779F9ULL
+
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t hash64_mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= HASH_PRIME2;
+    value ^= value >> 29;
+    value *= HASH_PRIME3;
+    value ^= value >> 32;
+    return value;
+}
+
+uint64_t hash64(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (len * HASH_PRIME1);
+
+    // Main loop consumes 8 bytes per step
+    while (len >= 8) {
+        uint64_t k = read64(p) * HASH_PRIME2;
+        k = rotl64(k, 31) * HASH_PRIME1;
+        h = rotl64(h ^ k, 27) * HASH_PRIME1 + HASH_PRIME3;
+        p += 8;
+        len -= 8;
+    }
+
+    // Tail: pack the remaining bytes into one word
+    if (len > 0) {
+        uint64_t k = 0;
+        memcpy(&k, p, len);
+        k *= HASH_PRIME2;
+        k = rotl64(k, 31) * HASH_PRIME1;
+        h ^= k;
+    }
+
+    return hash64_mix(h);
+}
\ No newline at end of file
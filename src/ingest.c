@@ -0,0 +1,52 @@
+#include "ingest.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "queue.h"
+#include <string.h>
+
+static int submit_to_queue(void* ctx, log_entry_t** entries, size_t count, uint64_t affinity) {
+    log_queue_t* queue = (log_queue_t*)ctx;
+    int result = 0;
+    (void)affinity;
+
+    for (size_t i = 0; i < count; i++) {
+        if (queue_enqueue(queue, entries[i]) != 0) {
+            log_entry_destroy(entries[i]);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+void ingest_init_queue(ingest_t* ingest, log_queue_t* queue) {
+    if (!ingest) {
+        return;
+    }
+
+    ingest->submit = submit_to_queue;
+    ingest->ctx = queue;
+}
+
+int ingest_submit(const ingest_t* ingest, log_entry_t** entries, size_t count,
+                  uint64_t affinity) {
+    if (!entries || count == 0) {
+        return 0;
+    }
+
+    if (!ingest || !ingest->submit) {
+        for (size_t i = 0; i < count; i++) {
+            log_entry_destroy(entries[i]);
+        }
+        return -1;
+    }
+
+    return ingest->submit(ingest->ctx, entries, count, affinity);
+}
+
+uint64_t ingest_affinity(const char* source) {
+    if (!source) {
+        return 0;
+    }
+
+    return hash64(source, log_entry_source_class_len(source), 0);
+}
\ No newline at end of file
@@ -0,0 +1,676 @@
+#include "json_lines.h"
+#include "log_entry.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define JSON_LINES_HAVE_AVX2 1
+#endif
+
+#define JSON_BLOCK_SIZE 64
+
+static const char* DEFAULT_LEVEL_KEYS = "level,severity,lvl,loglevel";
+static const char* DEFAULT_MESSAGE_KEYS = "message,msg";
+static const char* DEFAULT_TIMESTAMP_KEYS = "timestamp,time,ts,@timestamp";
+
+// Streaming structural iterator: yields, in order, the offsets of every
+// unescaped quote and every structural character outside strings
+typedef struct {
+    const char* buf;
+    size_t len;
+    size_t block;               // Offset of the current block
+    uint64_t pending;           // Unconsumed event bits in the current block
+    uint64_t in_string_carry;   // All ones if the previous block ended in a string
+    uint64_t escape_carry;      // 1 if the previous block ended with a live backslash
+    bool loaded;
+} json_iter_t;
+
+// Classify 64 bytes into quote, backslash and structural bitmaps
+static inline void classify_block(const char* p, uint64_t* quote, uint64_t* backslash,
+                                  uint64_t* structural) {
+#if defined(__SSE2__)
+    const __m128i q = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    uint64_t qm = 0, bm = 0, sm = 0;
+
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+        // '[' | 0x20 == '{' and ']' | 0x20 == '}', so two compares cover four brackets
+        __m128i folded = _mm_or_si128(v, lower);
+        __m128i s = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                                              _mm_cmpeq_epi8(folded, close)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, colon),
+                                              _mm_cmpeq_epi8(v, comma)));
+        qm |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, q)) << (16 * i);
+        bm |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, bs)) << (16 * i);
+        sm |= (uint64_t)(uint16_t)_mm_movemask_epi8(s) << (16 * i);
+    }
+
+    *quote = qm;
+    *backslash = bm;
+    *structural = sm;
+#else
+    uint64_t qm = 0, bm = 0, sm = 0;
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        char c = p[i];
+        char folded = (char)(c | 0x20);
+        qm |= (uint64_t)(c == '"') << i;
+        bm |= (uint64_t)(c == '\\') << i;
+        sm |= (uint64_t)(folded == '{' || folded == '}' || c == ':' || c == ',') << i;
+    }
+    *quote = qm;
+    *backslash = bm;
+    *structural = sm;
+#endif
+}
+
+#ifdef JSON_LINES_HAVE_AVX2
+// Same classification, 32 bytes per compare; selected at runtime
+__attribute__((target("avx2")))
+static void classify_block_avx2(const char* p, uint64_t* quote, uint64_t* backslash,
+                                uint64_t* structural) {
+    const __m256i q = _mm256_set1_epi8('"');
+    const __m256i bs = _mm256_set1_epi8('\\');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    uint64_t qm = 0, bm = 0, sm = 0;
+
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + 32 * i));
+        __m256i folded = _mm256_or_si256(v, lower);
+        __m256i s = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open),
+                                                     _mm256_cmpeq_epi8(folded, close)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, colon),
+                                                    _mm256_cmpeq_epi8(v, comma)));
+        qm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, q)) << (32 * i);
+        bm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bs)) << (32 * i);
+        sm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(s) << (32 * i);
+    }
+
+    *quote = qm;
+    *backslash = bm;
+    *structural = sm;
+}
+
+static int json_lines_avx2 = -1;   // -1 until probed
+
+static inline bool use_avx2(void) {
+    int value = __atomic_load_n(&json_lines_avx2, __ATOMIC_RELAXED);
+    if (value < 0) {
+        __builtin_cpu_init();
+        value = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&json_lines_avx2, value, __ATOMIC_RELAXED);
+    }
+    return value != 0;
+}
+#endif
+
+// Bits of characters preceded by an odd run of backslashes. Backslashes
+// are rare in log lines, so walking them beats the branch-free carry trick.
+static inline uint64_t find_escaped(uint64_t backslash, uint64_t* carry) {
+    uint64_t escaped = *carry;
+    uint64_t next_carry = 0;
+
+    while (backslash) {
+        int i = __builtin_ctzll(backslash);
+        backslash &= backslash - 1;
+        if (escaped & (1ULL << i)) {
+            continue;   // This backslash is itself escaped
+        }
+        if (i == 63) {
+            next_carry = 1;
+        } else {
+            escaped |= 1ULL << (i + 1);
+        }
+    }
+
+    *carry = next_carry;
+    return escaped;
+}
+
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static void iter_init(json_iter_t* it, const char* buf, size_t len) {
+    memset(it, 0, sizeof(json_iter_t));
+    it->buf = buf;
+    it->len = len;
+}
+
+static void iter_load(json_iter_t* it) {
+    const char* p = it->buf + it->block;
+    char tail[JSON_BLOCK_SIZE];
+
+    // Pad the final partial block with blanks so loads stay in bounds
+    if (it->len - it->block < JSON_BLOCK_SIZE) {
+        size_t remaining = it->len - it->block;
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, p, remaining);
+        p = tail;
+    }
+
+    uint64_t quote, backslash, structural;
+#ifdef JSON_LINES_HAVE_AVX2
+    if (use_avx2()) {
+        classify_block_avx2(p, &quote, &backslash, &structural);
+    } else {
+        classify_block(p, &quote, &backslash, &structural);
+    }
+#else
+    classify_block(p, &quote, &backslash, &structural);
+#endif
+
+    if (backslash | it->escape_carry) {
+        quote &= ~find_escaped(backslash, &it->escape_carry);
+    }
+
+    uint64_t in_string = prefix_xor(quote) ^ it->in_string_carry;
+    it->in_string_carry = (uint64_t)((int64_t)in_string >> 63);
+
+    it->pending = (structural & ~in_string) | quote;
+    it->loaded = true;
+}
+
+// Return the next event offset, or -1 at end of input
+static inline long iter_next(json_iter_t* it) {
+    while (!it->loaded || it->pending == 0) {
+        if (it->loaded) {
+            it->block += JSON_BLOCK_SIZE;
+        }
+        if (it->block >= it->len) {
+            return -1;
+        }
+        iter_load(it);
+    }
+
+    long pos = (long)(it->block + (size_t)__builtin_ctzll(it->pending));
+    it->pending &= it->pending - 1;
+    return pos;
+}
+
+static inline size_t skip_blank(const char* buf, size_t len, size_t pos) {
+    while (pos < len && (buf[pos] == ' ' || buf[pos] == '\t' || buf[pos] == '\r' || buf[pos] == '\n')) {
+        pos++;
+    }
+    return pos;
+}
+
+// Visitor for top-level members; return true to stop walking
+typedef bool (*json_visit_fn)(void* ctx, const char* key, size_t key_len, const json_span_t* value);
+
+// Walk the top-level members of an object, skipping nested values
+static int json_walk(const char* buf, size_t len, json_visit_fn visit, void* ctx) {
+    json_iter_t it;
+    iter_init(&it, buf, len);
+
+    long pos = iter_next(&it);
+    if (pos < 0 || buf[pos] != '{' || skip_blank(buf, len, 0) != (size_t)pos) {
+        return -1;
+    }
+
+    for (;;) {
+        // Key (or end of an empty object)
+        pos = iter_next(&it);
+        if (pos < 0) {
+            return -1;
+        }
+        if (buf[pos] == '}') {
+            return 0;
+        }
+        if (buf[pos] != '"') {
+            return -1;
+        }
+        size_t key_start = (size_t)pos + 1;
+        long key_end = iter_next(&it);
+        if (key_end < 0 || buf[key_end] != '"') {
+            return -1;
+        }
+        long colon = iter_next(&it);
+        if (colon < 0 || buf[colon] != ':') {
+            return -1;
+        }
+
+        // Value
+        json_span_t value;
+        size_t vstart = skip_blank(buf, len, (size_t)colon + 1);
+        if (vstart >= len) {
+            return -1;
+        }
+        char c = buf[vstart];
+        long next;
+
+        if (c == '"') {
+            long open = iter_next(&it);
+            long close = iter_next(&it);
+            if (open != (long)vstart || close < 0 || buf[close] != '"') {
+                return -1;
+            }
+            value.start = buf + vstart + 1;
+            value.length = (size_t)(close - open - 1);
+            value.is_string = true;
+            next = iter_next(&it);
+        } else if (c == '{' || c == '[') {
+            // Skip the nested value by bracket depth; quotes are just passed over
+            long open = iter_next(&it);
+            if (open != (long)vstart) {
+                return -1;
+            }
+            int depth = 1;
+            long p = open;
+            while (depth > 0) {
+                p = iter_next(&it);
+                if (p < 0) {
+                    return -1;
+                }
+                char b = buf[p];
+                if (b == '{' || b == '[') {
+                    depth++;
+                } else if (b == '}' || b == ']') {
+                    depth--;
+                }
+            }
+            value.start = buf + vstart;
+            value.length = (size_t)(p - open + 1);
+            value.is_string = false;
+            next = iter_next(&it);
+        } else {
+            // Scalar: runs up to the next structural character
+            next = iter_next(&it);
+            if (next < 0) {
+                return -1;
+            }
+            size_t vend = (size_t)next;
+            while (vend > vstart && (buf[vend - 1] == ' ' || buf[vend - 1] == '\t')) {
+                vend--;
+            }
+            value.start = buf + vstart;
+            value.length = vend - vstart;
+            value.is_string = false;
+        }
+
+        if (visit(ctx, buf + key_start, (size_t)key_end - key_start, &value)) {
+            return 0;
+        }
+
+        if (next < 0) {
+            return -1;
+        }
+        if (buf[next] == '}') {
+            return 0;
+        }
+        if (buf[next] != ',') {
+            return -1;
+        }
+    }
+}
+
+static int key_set_init(json_key_set_t* set, const char* list) {
+    memset(set, 0, sizeof(json_key_set_t));
+
+    const char* p = list;
+    while (*p && set->count < JSON_LINES_MAX_KEYS) {
+        size_t n = strcspn(p, ",");
+        if (n > 0) {
+            set->names[set->count] = strndup(p, n);
+            if (!set->names[set->count]) {
+                return -1;
+            }
+            set->lengths[set->count] = n;
+            set->count++;
+        }
+        p += n;
+        if (*p == ',') {
+            p++;
+        }
+    }
+
+    return 0;
+}
+
+static void key_set_destroy(json_key_set_t* set) {
+    for (size_t i = 0; i < set->count; i++) {
+        free(set->names[i]);
+    }
+    memset(set, 0, sizeof(json_key_set_t));
+}
+
+static inline bool key_set_contains(const json_key_set_t* set, const char* key, size_t len) {
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->lengths[i] == len && memcmp(set->names[i], key, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint64_t length_bit(size_t len) {
+    return 1ULL << (len < 63 ? len : 63);
+}
+
+static void filter_add(json_lines_t* parser, const char* name, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    unsigned char c = (unsigned char)name[0];
+    parser->length_filter |= length_bit(len);
+    parser->first_char_filter[c >> 6] |= 1ULL << (c & 63);
+}
+
+static inline bool filter_may_contain(const json_lines_t* parser, const char* key, size_t len) {
+    if (len == 0 || !(parser->length_filter & length_bit(len))) {
+        return false;
+    }
+    unsigned char c = (unsigned char)key[0];
+    return (parser->first_char_filter[c >> 6] >> (c & 63)) & 1;
+}
+
+int json_lines_init(json_lines_t* parser, const char* level_keys, const char* message_keys,
+                    const char* timestamp_keys, char** fields, size_t num_fields) {
+    if (!parser) {
+        return -1;
+    }
+
+    memset(parser, 0, sizeof(json_lines_t));
+
+    if (key_set_init(&parser->level_keys, level_keys ? level_keys : DEFAULT_LEVEL_KEYS) != 0 ||
+        key_set_init(&parser->message_keys, message_keys ? message_keys : DEFAULT_MESSAGE_KEYS) != 0 ||
+        key_set_init(&parser->timestamp_keys, timestamp_keys ? timestamp_keys : DEFAULT_TIMESTAMP_KEYS) != 0) {
+        json_lines_destroy(parser);
+        return -1;
+    }
+
+    for (size_t i = 0; fields && i < num_fields && i < JSON_LINES_MAX_FIELDS; i++) {
+        parser->fields[i] = strdup(fields[i]);
+        if (!parser->fields[i]) {
+            json_lines_destroy(parser);
+            return -1;
+        }
+        parser->field_lengths[i] = strlen(fields[i]);
+        parser->num_fields++;
+    }
+
+    // Cheap prefilter so unmapped keys are rejected without any memcmp
+    const json_key_set_t* sets[] = {&parser->level_keys, &parser->message_keys,
+                                    &parser->timestamp_keys};
+    for (size_t s = 0; s < 3; s++) {
+        for (size_t i = 0; i < sets[s]->count; i++) {
+            filter_add(parser, sets[s]->names[i], sets[s]->lengths[i]);
+        }
+    }
+    for (size_t i = 0; i < parser->num_fields; i++) {
+        filter_add(parser, parser->fields[i], parser->field_lengths[i]);
+    }
+
+    return 0;
+}
+
+void json_lines_destroy(json_lines_t* parser) {
+    if (!parser) {
+        return;
+    }
+
+    key_set_destroy(&parser->level_keys);
+    key_set_destroy(&parser->message_keys);
+    key_set_destroy(&parser->timestamp_keys);
+    for (size_t i = 0; i < parser->num_fields; i++) {
+        free(parser->fields[i]);
+    }
+    memset(parser, 0, sizeof(json_lines_t));
+}
+
+bool json_lines_is_json(const char* line, size_t length) {
+    if (!line) {
+        return false;
+    }
+
+    size_t pos = skip_blank(line, length, 0);
+    return pos < length && line[pos] == '{';
+}
+
+typedef struct {
+    const json_lines_t* parser;
+    json_lines_result_t* result;
+    size_t wanted;
+    size_t found;
+} scan_ctx_t;
+
+static bool scan_visit(void* ctx, const char* key, size_t key_len, const json_span_t* value) {
+    scan_ctx_t* scan = (scan_ctx_t*)ctx;
+    const json_lines_t* parser = scan->parser;
+    json_lines_result_t* result = scan->result;
+
+    if (!filter_may_contain(parser, key, key_len)) {
+        return false;
+    }
+
+    // First mapping wins when a line repeats a key
+    if (!result->level.start && key_set_contains(&parser->level_keys, key, key_len)) {
+        result->level = *value;
+        scan->found++;
+    } else if (!result->message.start && key_set_contains(&parser->message_keys, key, key_len)) {
+        result->message = *value;
+        scan->found++;
+    } else if (!result->timestamp.start && key_set_contains(&parser->timestamp_keys, key, key_len)) {
+        result->timestamp = *value;
+        scan->found++;
+    } else {
+        for (size_t i = 0; i < parser->num_fields; i++) {
+            if (!result->fields[i].start && parser->field_lengths[i] == key_len &&
+                memcmp(parser->fields[i], key, key_len) == 0) {
+                result->fields[i] = *value;
+                scan->found++;
+                break;
+            }
+        }
+    }
+
+    // Stop as soon as every mapped key has been seen
+    return scan->found == scan->wanted;
+}
+
+int json_lines_scan(const json_lines_t* parser, const char* line, size_t length,
+                    json_lines_result_t* result) {
+    if (!parser || !line || !result) {
+        return -1;
+    }
+
+    memset(result, 0, sizeof(json_lines_result_t));
+
+    scan_ctx_t ctx;
+    ctx.parser = parser;
+    ctx.result = result;
+    ctx.wanted = 3 + parser->num_fields;
+    ctx.found = 0;
+
+    return json_walk(line, length, scan_visit, &ctx);
+}
+
+typedef struct {
+    const char* key;
+    size_t key_len;
+    json_span_t* value;
+    bool found;
+} find_ctx_t;
+
+static bool find_visit(void* ctx, const char* key, size_t key_len, const json_span_t* value) {
+    find_ctx_t* find = (find_ctx_t*)ctx;
+    if (key_len == find->key_len && memcmp(key, find->key, key_len) == 0) {
+        *find->value = *value;
+        find->found = true;
+        return true;
+    }
+    return false;
+}
+
+bool json_lines_find(const char* line, size_t length, const char* key, json_span_t* value) {
+    if (!line || !key || !value) {
+        return false;
+    }
+
+    find_ctx_t ctx;
+    ctx.key = key;
+    ctx.key_len = strlen(key);
+    ctx.value = value;
+    ctx.found = false;
+
+    return json_walk(line, length, find_visit, &ctx) == 0 && ctx.found;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(const char* p, const char* end, uint32_t* out) {
+    if (end - p < 4) {
+        return false;
+    }
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        int h = hex_value(p[i]);
+        if (h < 0) {
+            return false;
+        }
+        v = (v << 4) | (uint32_t)h;
+    }
+    *out = v;
+    return true;
+}
+
+size_t json_lines_unescape(const char* src, size_t length, char* dst, size_t size) {
+    if (!dst || size == 0) {
+        return 0;
+    }
+    if (!src) {
+        dst[0] = '\0';
+        return 0;
+    }
+
+    const char* p = src;
+    const char* end = src + length;
+    size_t out = 0;
+    size_t limit = size - 1;
+
+    while (p < end && out < limit) {
+        // Copy runs without escapes in one go
+        const char* bs = memchr(p, '\\', (size_t)(end - p));
+        size_t run = (size_t)((bs ? bs : end) - p);
+        if (run > limit - out) {
+            run = limit - out;
+        }
+        memcpy(dst + out, p, run);
+        out += run;
+        p += run;
+        if (!bs || p != bs) {
+            continue;
+        }
+        if (p + 1 >= end) {
+            break;  // Dangling backslash
+        }
+
+        char c = p[1];
+        p += 2;
+        char decoded = 0;
+        switch (c) {
+            case 'n': decoded = '\n'; break;
+            case 't': decoded = '\t'; break;
+            case 'r': decoded = '\r'; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!read_hex4(p, end, &cp)) {
+                    decoded = '?';
+                    break;
+                }
+                p += 4;
+                // Combine a surrogate pair when present
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                    uint32_t low;
+                    if (read_hex4(p + 2, end, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                char utf8[6];
+                size_t n;
+                if (cp == 0) {
+                    // Keep \u0000 escaped: callers treat values as C strings
+                    memcpy(utf8, "\\u0000", 6);
+                    n = 6;
+                } else if (cp < 0x80) {
+                    utf8[0] = (char)cp;
+                    n = 1;
+                } else if (cp < 0x800) {
+                    utf8[0] = (char)(0xC0 | (cp >> 6));
+                    utf8[1] = (char)(0x80 | (cp & 0x3F));
+                    n = 2;
+                } else if (cp < 0x10000) {
+                    utf8[0] = (char)(0xE0 | (cp >> 12));
+                    utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    utf8[2] = (char)(0x80 | (cp & 0x3F));
+                    n = 3;
+                } else {
+                    utf8[0] = (char)(0xF0 | (cp >> 18));
+                    utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+                    utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    utf8[3] = (char)(0x80 | (cp & 0x3F));
+                    n = 4;
+                }
+                if (n > limit - out) {
+                    p = end;
+                    break;
+                }
+                memcpy(dst + out, utf8, n);
+                out += n;
+                continue;
+            }
+            default: decoded = c; break;  // \" \\ \/ and unknown escapes
+        }
+        if (decoded && out < limit) {
+            dst[out++] = decoded;
+        }
+    }
+
+    dst[out] = '\0';
+    return out;
+}
+
+bool json_lines_extract_field(const log_entry_t* entry, const char* name,
+                              const char** value, size_t* length) {
+    if (!entry || !entry->raw_line || !name) {
+        return false;
+    }
+
+    json_span_t span;
+    if (!json_lines_find(entry->raw_line, strlen(entry->raw_line), name, &span)) {
+        return false;
+    }
+
+    *value = span.start;
+    *length = span.length;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,322 @@
+#include "line_parser.h"
+#include "log_entry.h"
+#include "json_lines.h"
+#include "log_format.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STACK_MESSAGE 4096
+
+static const log_format_t* find_format(const line_parser_t* parser, const char* name) {
+    for (size_t i = 0; i < parser->num_formats; i++) {
+        if (strcmp(parser->formats[i].name, name) == 0) {
+            return &parser->formats[i];
+        }
+    }
+    return NULL;
+}
+
+// Compile custom formats, then the built-ins that assignments refer to
+static int init_formats(line_parser_t* parser, const config_t* config) {
+    if (config->num_source_formats == 0) {
+        return 0;
+    }
+
+    size_t capacity = config->num_log_formats + config->num_source_formats;
+    parser->formats = (log_format_t*)calloc(capacity, sizeof(log_format_t));
+    parser->source_globs = (char**)calloc(config->num_source_formats, sizeof(char*));
+    parser->source_formats = (const log_format_t**)calloc(config->num_source_formats,
+                                                          sizeof(log_format_t*));
+    if (!parser->formats || !parser->source_globs || !parser->source_formats) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < config->num_log_formats; i++) {
+        if (log_format_compile(&parser->formats[parser->num_formats],
+                               config->log_format_names[i], config->log_format_specs[i]) != 0) {
+            return -1;
+        }
+        parser->num_formats++;
+    }
+
+    for (size_t i = 0; i < config->num_source_formats; i++) {
+        const char* name = config->source_format_names[i];
+        const log_format_t* format = find_format(parser, name);
+        if (!format) {
+            if (log_format_builtin(&parser->formats[parser->num_formats], name) != 0) {
+                fprintf(stderr, "Unknown log format '%s' for sources %s\n",
+                        name, config->source_format_globs[i]);
+                return -1;
+            }
+            format = &parser->formats[parser->num_formats++];
+        }
+
+        parser->source_globs[i] = strdup(config->source_format_globs[i]);
+        if (!parser->source_globs[i]) {
+            return -1;
+        }
+        parser->source_formats[i] = format;
+        parser->num_assignments++;
+    }
+
+    parser->format_mismatches = metrics_register("parser.format_mismatches", METRIC_COUNTER);
+    return 0;
+}
+
+int line_parser_init(line_parser_t* parser, const config_t* config) {
+    if (!parser) {
+        return -1;
+    }
+
+    memset(parser, 0, sizeof(line_parser_t));
+
+    if (!config) {
+        return 0;
+    }
+
+    parser->json_enabled = config->json_lines;
+    if (parser->json_enabled &&
+        json_lines_init(&parser->json, config->json_level_keys, config->json_message_keys,
+                        config->json_timestamp_keys, config->json_fields,
+                        config->num_json_fields) != 0) {
+        parser->json_enabled = false;
+        return -1;
+    }
+
+    if (init_formats(parser, config) != 0 || pushdown_init(&parser->pushdown, config) != 0) {
+        line_parser_destroy(parser);
+        return -1;
+    }
+
+    return 0;
+}
+
+void line_parser_destroy(line_parser_t* parser) {
+    if (!parser) {
+        return;
+    }
+
+    if (parser->json_enabled) {
+        json_lines_destroy(&parser->json);
+    }
+    for (size_t i = 0; i < parser->num_formats; i++) {
+        log_format_destroy(&parser->formats[i]);
+    }
+    for (size_t i = 0; i < parser->num_assignments; i++) {
+        free(parser->source_globs[i]);
+    }
+    free(parser->formats);
+    free(parser->source_globs);
+    free(parser->source_formats);
+    pushdown_destroy(&parser->pushdown);
+    memset(parser, 0, sizeof(line_parser_t));
+}
+
+// Numeric levels as used by bunyan/pino (10 trace ... 60 fatal)
+static log_level_t numeric_level(long value) {
+    if (value >= 60) return LOG_LEVEL_CRITICAL;
+    if (value >= 50) return LOG_LEVEL_ERROR;
+    if (value >= 40) return LOG_LEVEL_WARNING;
+    if (value >= 30) return LOG_LEVEL_INFO;
+    return LOG_LEVEL_DEBUG;
+}
+
+static log_entry_t* create_json_entry(const line_parser_t* parser, const char* source,
+                                      const char* line, size_t length,
+                                      const pushdown_source_t* filter, bool* dropped) {
+    json_lines_result_t result;
+    if (json_lines_scan(&parser->json, line, length, &result) != 0) {
+        return NULL;
+    }
+
+    log_level_t level = LOG_LEVEL_INFO;
+    if (result.level.start) {
+        if (result.level.is_string) {
+            level = log_entry_parse_level_len(result.level.start, result.level.length);
+        } else {
+            level = numeric_level(strtol(result.level.start, NULL, 10));
+        }
+    }
+    if (!pushdown_admit_level(filter, level)) {
+        *dropped = true;
+        return NULL;
+    }
+
+    // Decode the message; without a message key the whole object is the message
+    const char* message = line;
+    size_t message_len = length;
+    char stack_message[MAX_STACK_MESSAGE];
+    char* heap_message = NULL;
+    if (result.message.start) {
+        if (result.message.is_string && memchr(result.message.start, '\\', result.message.length)) {
+            char* decoded = stack_message;
+            if (result.message.length >= sizeof(stack_message)) {
+                heap_message = (char*)malloc(result.message.length + 1);
+                if (!heap_message) {
+                    return NULL;
+                }
+                decoded = heap_message;
+            }
+            message_len = json_lines_unescape(result.message.start, result.message.length,
+                                              decoded, result.message.length + 1);
+            message = decoded;
+        } else {
+            message = result.message.start;
+            message_len = result.message.length;
+        }
+    }
+
+    log_entry_t* entry = log_entry_create_len(source, message, message_len, level, line, length);
+    free(heap_message);
+    if (!entry) {
+        return NULL;
+    }
+
+    // String timestamps must be consumed whole; numbers are epoch values
+    int64_t event_time;
+    if (result.timestamp.start &&
+        timestamp_parse(result.timestamp.start, result.timestamp.length, true, &event_time) ==
+            result.timestamp.length) {
+        entry->timestamp = event_time;
+    }
+
+    // Selected fields were located in the same pass; store them (and misses)
+    // as offsets into the entry's copy of the line
+    for (size_t i = 0; i < parser->json.num_fields; i++) {
+        const json_span_t* field = &result.fields[i];
+        const char* value = field->start ? entry->raw_line + (field->start - line) : NULL;
+        log_entry_set_field(entry, parser->json.fields[i], value, field->length);
+    }
+
+    // Anything else a rule asks for is found lazily in the raw line
+    entry->extractor = json_lines_extract_field;
+    return entry;
+}
+
+const log_format_t* line_parser_format_for(const line_parser_t* parser, const char* source) {
+    if (!parser || !source) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < parser->num_assignments; i++) {
+        if (fnmatch(parser->source_globs[i], source, 0) == 0) {
+            return parser->source_formats[i];
+        }
+    }
+    return NULL;
+}
+
+log_entry_t* line_parser_create_entry(const line_parser_t* parser, const char* source,
+                                      const char* line, size_t length) {
+    return line_parser_create_entry_format(parser, line_parser_format_for(parser, source),
+                                           source, line, length);
+}
+
+// Parse a line into an entry; with a filter, entries below the level
+// threshold are dropped as soon as their level is known
+static log_entry_t* create_entry(const line_parser_t* parser, const log_format_t* format,
+                                 const pushdown_source_t* filter, const char* source,
+                                 const char* line, size_t length) {
+    if (format) {
+        log_entry_t* entry = log_format_create_entry(format, source, line, length);
+        if (entry) {
+            // Format levels are derived from several captures; check after parsing
+            if (!pushdown_admit_level(filter, entry->level)) {
+                log_entry_destroy(entry);
+                return NULL;
+            }
+            return entry;
+        }
+        // Lines the format does not describe are still ingested
+        metrics_add(parser->format_mismatches, 1);
+    }
+
+    if (parser && parser->json_enabled && json_lines_is_json(line, length)) {
+        bool dropped = false;
+        log_entry_t* entry = create_json_entry(parser, source, line, length, filter, &dropped);
+        if (entry || dropped) {
+            return entry;
+        }
+        // Malformed JSON falls through to plain-text handling
+    }
+
+    // Parse log entry (simple format: [timestamp] [LEVEL] message)
+    log_level_t level = LOG_LEVEL_INFO;
+    const char* message = line;
+    const char* end = line + length;
+
+    // A leading calendar timestamp is the event time (bare numbers are not)
+    int64_t event_time = 0;
+    size_t used = timestamp_parse(line, length, false, &event_time);
+    if (used > 0 && used < length && (line[used] == ' ' || line[used] == '\t')) {
+        message = line + used;
+        while (message < end && (*message == ' ' || *message == '\t')) message++;
+    } else {
+        event_time = 0;
+    }
+
+    if (message < end && *message == '[') {
+        const char* end_bracket = memchr(message, ']', (size_t)(end - message));
+        if (end_bracket) {
+            level = log_entry_parse_level_len(message + 1, (size_t)(end_bracket - message - 1));
+            message = end_bracket + 1;
+            while (message < end && *message == ' ') message++; // Skip spaces
+        }
+    }
+    if (!pushdown_admit_level(filter, level)) {
+        return NULL;
+    }
+
+    log_entry_t* entry = log_entry_create_len(source, message, (size_t)(end - message),
+                                              level, line, length);
+    if (entry && event_time != 0) {
+        entry->timestamp = event_time;
+    }
+    return entry;
+}
+
+log_entry_t* line_parser_create_entry_format(const line_parser_t* parser,
+                                             const log_format_t* format, const char* source,
+                                             const char* line, size_t length) {
+    if (!source || !line || length == 0) {
+        return NULL;
+    }
+
+    return create_entry(parser, format, NULL, source, line, length);
+}
+
+void line_parser_source_filter(const line_parser_t* parser, pushdown_source_t* state,
+                               const char* source, const log_format_t* format) {
+    pushdown_source_init(parser ? &parser->pushdown : NULL, state, source, format != NULL);
+}
+
+log_entry_t* line_parser_create_entry_span(const line_parser_t* parser,
+                                           const log_format_t* format,
+                                           const pushdown_source_t* filter, const char* source,
+                                           const char* buf, const line_span_t* span) {
+    if (!source || !buf || !span || span->length == 0) {
+        return NULL;
+    }
+
+    // Cheapest checks first: none of them touches the allocator
+    const char* line = buf + span->start;
+    if (!pushdown_admit_source(filter)) {
+        return NULL;
+    }
+    if (!format && span->has_level && !pushdown_admit_level(filter, (log_level_t)span->level)) {
+        return NULL;
+    }
+    if (!pushdown_admit_line(filter, line, span->length)) {
+        return NULL;
+    }
+
+    if (!format && span->has_level) {
+        return log_entry_create_len(source, line + span->message, span->length - span->message,
+                                    (log_level_t)span->level, line, span->length);
+    }
+    return create_entry(parser, format, filter, source, line, span->length);
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "line_scan.h"
+#include "log_entry.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LINE_SCAN_HAVE_X86 1
+#endif
+
+#define LINE_SCAN_BLOCK 64
+#define MAX_LEVEL_TOKEN 16
+
+// Classify 64 bytes into newline and ']' bitmaps
+typedef void (*classify_fn)(const char* p, uint64_t* newline, uint64_t* close);
+
+typedef struct {
+    const char* name;
+    classify_fn classify;
+} scan_impl_t;
+
+static void classify_scalar(const char* p, uint64_t* newline, uint64_t* close) {
+    uint64_t nl = 0, cb = 0;
+    for (int i = 0; i < LINE_SCAN_BLOCK; i++) {
+        nl |= (uint64_t)(p[i] == '\n') << i;
+        cb |= (uint64_t)(p[i] == ']') << i;
+    }
+    *newline = nl;
+    *close = cb;
+}
+
+#if defined(__SSE2__)
+static void classify_sse2(const char* p, uint64_t* newline, uint64_t* close) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cb = _mm_set1_epi8(']');
+    uint64_t nm = 0, cm = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+        nm |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << (16 * i);
+        cm |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cb)) << (16 * i);
+    }
+    *newline = nm;
+    *close = cm;
+}
+#endif
+
+#ifdef LINE_SCAN_HAVE_X86
+__attribute__((target("avx2")))
+static void classify_avx2(const char* p, uint64_t* newline, uint64_t* close) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cb = _mm256_set1_epi8(']');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    *newline = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl)) |
+               (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)) << 32;
+    *close = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, cb)) |
+             (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, cb)) << 32;
+}
+
+__attribute__((target("avx512bw")))
+static void classify_avx512(const char* p, uint64_t* newline, uint64_t* close) {
+    __m512i v = _mm512_loadu_si512((const void*)p);
+    *newline = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n'));
+    *close = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(']'));
+}
+#endif
+
+static const scan_impl_t IMPLS[] = {
+#ifdef LINE_SCAN_HAVE_X86
+    {"avx512", classify_avx512},
+    {"avx2", classify_avx2},
+#endif
+#if defined(__SSE2__)
+    {"sse2", classify_sse2},
+#endif
+    {"scalar", classify_scalar},
+};
+
+#define NUM_IMPLS (sizeof(IMPLS) / sizeof(IMPLS[0]))
+
+static const scan_impl_t* selected;
+
+static bool impl_supported(const scan_impl_t* impl) {
+#ifdef LINE_SCAN_HAVE_X86
+    __builtin_cpu_init();
+    if (strcmp(impl->name, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512bw");
+    }
+    if (strcmp(impl->name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void)impl;
+    return true;
+}
+
+static const scan_impl_t* select_impl(void) {
+    const scan_impl_t* impl = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (impl) {
+        return impl;
+    }
+
+    // Best supported implementation first
+    for (size_t i = 0; i < NUM_IMPLS; i++) {
+        if (impl_supported(&IMPLS[i])) {
+            impl = &IMPLS[i];
+            break;
+        }
+    }
+    __atomic_store_n(&selected, impl, __ATOMIC_RELEASE);
+    return impl;
+}
+
+const char* line_scan_impl(void) {
+    return select_impl()->name;
+}
+
+int line_scan_force(const char* impl) {
+    if (!impl) {
+        __atomic_store_n(&selected, NULL, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    for (size_t i = 0; i < NUM_IMPLS; i++) {
+        if (strcmp(IMPLS[i].name, impl) == 0 && impl_supported(&IMPLS[i])) {
+            __atomic_store_n(&selected, &IMPLS[i], __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Fill in the level prefix of a line. close_bits holds the ']' bitmap of
+// the block containing the line start, already shifted to start there.
+static inline void classify_prefix(const char* buf, line_span_t* line, uint64_t close_bits) {
+    const char* p = buf + line->start;
+    line->level = LOG_LEVEL_INFO;
+    line->has_level = 0;
+    line->message = 0;
+
+    if (line->length < 2 || p[0] != '[') {
+        return;
+    }
+
+    size_t limit = line->length < MAX_LEVEL_TOKEN + 1 ? line->length : MAX_LEVEL_TOKEN + 1;
+    size_t close;
+    if (close_bits) {
+        close = (size_t)__builtin_ctzll(close_bits);
+        if (close >= limit) {
+            return;
+        }
+    } else {
+        // Bracket lies beyond the current block
+        const char* hit = memchr(p, ']', limit);
+        if (!hit) {
+            return;
+        }
+        close = (size_t)(hit - p);
+    }
+
+    line->level = (uint8_t)log_entry_parse_level_len(p + 1, close - 1);
+    line->has_level = 1;
+
+    size_t message = close + 1;
+    while (message < line->length && p[message] == ' ') message++; // Skip spaces
+    line->message = (uint32_t)message;
+}
+
+size_t line_scan(const char* buf, size_t len, line_span_t* lines, size_t max_lines,
+                 size_t* consumed) {
+    if (consumed) {
+        *consumed = 0;
+    }
+    if (!buf || !lines || max_lines == 0) {
+        return 0;
+    }
+
+    classify_fn classify = select_impl()->classify;
+    size_t count = 0;
+    size_t line_start = 0;
+
+    for (size_t block = 0; block < len; block += LINE_SCAN_BLOCK) {
+        const char* p = buf + block;
+        char tail[LINE_SCAN_BLOCK];
+        uint64_t valid = ~0ULL;
+
+        // Pad the final partial block so loads stay in bounds
+        if (len - block < LINE_SCAN_BLOCK) {
+            size_t remaining = len - block;
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, p, remaining);
+            p = tail;
+            valid = (1ULL << remaining) - 1;
+        }
+
+        uint64_t newline, close;
+        classify(p, &newline, &close);
+        newline &= valid;
+        close &= valid;
+
+        while (newline) {
+            size_t pos = block + (size_t)__builtin_ctzll(newline);
+            newline &= newline - 1;
+
+            line_span_t* line = &lines[count++];
+            size_t end = pos;
+            if (end > line_start && buf[end - 1] == '\r') {
+                end--;
+            }
+            line->start = (uint32_t)line_start;
+            line->length = (uint32_t)(end - line_start);
+
+            // ']' bits from the line start onwards, when it starts in this block
+            uint64_t close_bits = 0;
+            if (line_start >= block) {
+                size_t shift = line_start - block;
+                close_bits = close >> shift;
+            }
+            classify_prefix(buf, line, close_bits);
+
+            line_start = pos + 1;
+            if (count == max_lines) {
+                if (consumed) {
+                    *consumed = line_start;
+                }
+                return count;
+            }
+        }
+    }
+
+    if (consumed) {
+        *consumed = line_start;
+    }
+    return count;
+}
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "log_entry.h"
+#include "timestamp.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
 #include <time.h>
 
+// Bytes of a non-exact level token considered by substring matching, plus NUL
 #define MAX_LEVEL_STRING 16
 
 log_entry_t* log_entry_create(const char* source, const char* message, 
@@ -22,7 +24,46 @@ log_entry_t* log_entry_create(const char* source, const char* message,
     entry->message = strdup(message);
     entry->raw_line = strdup(raw_line);
     entry->level = level;
-    entry->timestamp = time(NULL);
+    entry->ingest_time = timestamp_now();
+    entry->timestamp = entry->ingest_time;
+    entry->template_id = 0;
+    entry->rule_id = 0;
+    entry->patterns = 0;
+    entry->context = NULL;
+    entry->num_fields = 0;
+    entry->extractor = NULL;
+    
+    if (!entry->source || !entry->message || !entry->raw_line) {
+        log_entry_destroy(entry);
+        return NULL;
+    }
+    
+    return entry;
+}
+
+log_entry_t* log_entry_create_len(const char* source, const char* message, size_t message_len,
+                                  log_level_t level, const char* raw_line, size_t raw_len) {
+    if (!source || !message || !raw_line) {
+        return NULL;
+    }
+    
+    log_entry_t* entry = (log_entry_t*)malloc(sizeof(log_entry_t));
+    if (!entry) {
+        return NULL;
+    }
+    
+    entry->source = strdup(source);
+    entry->message = strndup(message, message_len);
+    entry->raw_line = strndup(raw_line, raw_len);
+    entry->level = level;
+    entry->ingest_time = timestamp_now();
+    entry->timestamp = entry->ingest_time;
+    entry->template_id = 0;
+    entry->rule_id = 0;
+    entry->patterns = 0;
+    entry->context = NULL;
+    entry->num_fields = 0;
+    entry->extractor = NULL;
     
     if (!entry->source || !entry->message || !entry->raw_line) {
         log_entry_destroy(entry);
@@ -40,26 +81,75 @@ void log_entry_destroy(log_entry_t* entry) {
     free(entry->source);
     free(entry->message);
     free(entry->raw_line);
+    free(entry->context);
     free(entry);
 }
 
+// Exact level tokens, placed by LEVEL_HASH (collision-free for this set)
+typedef struct {
+    const char* token;
+    size_t length;
+    log_level_t level;
+} level_token_t;
+
+#define LEVEL_HASH(first, last, len) ((size_t)((first) * 2 + (last) + (len)) & 15)
+
+static const level_token_t LEVEL_TOKENS[16] = {
+    [LEVEL_HASH('w', 'n', 4)] = {"warn", 4, LOG_LEVEL_WARNING},
+    [LEVEL_HASH('e', 'r', 5)] = {"error", 5, LOG_LEVEL_ERROR},
+    [LEVEL_HASH('d', 'g', 3)] = {"dbg", 3, LOG_LEVEL_DEBUG},
+    [LEVEL_HASH('d', 'g', 5)] = {"debug", 5, LOG_LEVEL_DEBUG},
+    [LEVEL_HASH('i', 'o', 4)] = {"info", 4, LOG_LEVEL_INFO},
+    [LEVEL_HASH('c', 'l', 8)] = {"critical", 8, LOG_LEVEL_CRITICAL},
+    [LEVEL_HASH('w', 'g', 7)] = {"warning", 7, LOG_LEVEL_WARNING},
+    [LEVEL_HASH('f', 'l', 5)] = {"fatal", 5, LOG_LEVEL_CRITICAL},
+    [LEVEL_HASH('c', 't', 4)] = {"crit", 4, LOG_LEVEL_CRITICAL},
+    [LEVEL_HASH('e', 'r', 3)] = {"err", 3, LOG_LEVEL_ERROR},
+};
+
+static inline char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+}
+
 log_level_t log_entry_parse_level(const char* level_str) {
     if (!level_str) {
         return LOG_LEVEL_INFO;
     }
     
+    return log_entry_parse_level_len(level_str, strlen(level_str));
+}
+
+log_level_t log_entry_parse_level_len(const char* level_str, size_t len) {
+    if (!level_str || len == 0) {
+        return LOG_LEVEL_INFO;
+    }
+    
+    // Fast path: one probe of the perfect hash for exact tokens
+    if (len <= 8) {
+        const level_token_t* candidate =
+            &LEVEL_TOKENS[LEVEL_HASH(fold(level_str[0]), fold(level_str[len - 1]), len)];
+        if (candidate->length == len) {
+            size_t i = 0;
+            while (i < len && fold(level_str[i]) == candidate->token[i]) i++;
+            if (i == len) {
+                return candidate->level;
+            }
+        }
+    }
+    
     // Convert to lowercase for case-insensitive matching
     char lower[MAX_LEVEL_STRING];
-    size_t len = strlen(level_str);
     if (len >= MAX_LEVEL_STRING) {
         len = MAX_LEVEL_STRING - 1;
     }
     
     for (size_t i = 0; i < len; i++) {
-        lower[i] = tolower(level_str[i]);
+        lower[i] = tolower((unsigned char)level_str[i]);
     }
     lower[len] = '\0';
     
+    // Tokens embedded in longer text ("E_ERROR", "warn:db") keep the old
+    // substring semantics
     if (strstr(lower, "debug") || strstr(lower, "dbg")) {
         return LOG_LEVEL_DEBUG;
     } else if (strstr(lower, "info")) {
@@ -90,4 +180,167 @@ const char* log_entry_level_to_string(log_level_t level) {
         default:
             return "UNKNOWN";
     }
+}
+
+// Characters that may precede a key in key=value text
+static inline bool is_key_boundary(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '{' || c == '[' || c == '(';
+}
+
+// Characters that end an unquoted value
+static inline bool is_value_end(char c) {
+    return c == '\0' || c == ' ' || c == '\t' || c == ',' || c == ';' ||
+           c == '}' || c == ']' || c == ')';
+}
+
+bool log_entry_extract_kv(const log_entry_t* entry, const char* name,
+                          const char** value, size_t* length) {
+    if (!entry || !entry->message || !name || !*name) {
+        return false;
+    }
+    
+    size_t name_len = strlen(name);
+    const char* text = entry->message;
+    const char* p = text;
+    
+    while ((p = strstr(p, name)) != NULL) {
+        const char* key_start = p;
+        const char* after = p + name_len;
+        p = after;
+        
+        // Allow a quoted key ("name": value)
+        bool quoted_key = key_start > text && key_start[-1] == '"';
+        const char* before = quoted_key ? key_start - 1 : key_start;
+        if (before > text && !is_key_boundary(before[-1])) {
+            continue;
+        }
+        if (quoted_key) {
+            if (*after != '"') {
+                continue;
+            }
+            after++;
+        }
+        
+        // Separator: '=' or ':' with optional surrounding spaces
+        while (*after == ' ') after++;
+        if (*after != '=' && *after != ':') {
+            continue;
+        }
+        after++;
+        while (*after == ' ') after++;
+        
+        const char* v = after;
+        const char* end;
+        if (*v == '"') {
+            v++;
+            end = v;
+            while (*end && *end != '"') {
+                if (*end == '\\' && end[1]) {
+                    end++;
+                }
+                end++;
+            }
+        } else {
+            end = v;
+            while (!is_value_end(*end)) {
+                end++;
+            }
+        }
+        
+        *value = v;
+        *length = (size_t)(end - v);
+        return true;
+    }
+    
+    return false;
+}
+
+int log_entry_set_field(log_entry_t* entry, const char* name,
+                        const char* value, size_t length) {
+    if (!entry || !name || entry->num_fields >= LOG_ENTRY_MAX_FIELDS) {
+        return -1;
+    }
+    
+    log_field_t* field = &entry->fields[entry->num_fields++];
+    field->name = name;
+    field->value = value;
+    field->length = value ? length : 0;
+    return 0;
+}
+
+bool log_entry_get_field(log_entry_t* entry, const char* name,
+                         const char** value, size_t* length) {
+    if (!entry || !name) {
+        return false;
+    }
+    
+    // Memoized lookups (including misses) first
+    for (unsigned int i = 0; i < entry->num_fields; i++) {
+        log_field_t* field = &entry->fields[i];
+        if (field->name == name || strcmp(field->name, name) == 0) {
+            if (!field->value) {
+                return false;
+            }
+            if (value) *value = field->value;
+            if (length) *length = field->length;
+            return true;
+        }
+    }
+    
+    const char* found = NULL;
+    size_t found_len = 0;
+    log_field_extractor_fn extractor = entry->extractor ? entry->extractor : log_entry_extract_kv;
+    bool present = extractor(entry, name, &found, &found_len);
+    
+    // When the slot table is full the result is simply not memoized
+    log_entry_set_field(entry, name, present ? found : NULL, found_len);
+    
+    if (present) {
+        if (value) *value = found;
+        if (length) *length = found_len;
+    }
+    return present;
+}
+
+bool log_entry_get_field_number(log_entry_t* entry, const char* name, double* number) {
+    const char* value;
+    size_t length;
+    if (!log_entry_get_field(entry, name, &value, &length) || length == 0) {
+        return false;
+    }
+    
+    char buffer[64];
+    if (length >= sizeof(buffer)) {
+        length = sizeof(buffer) - 1;
+    }
+    memcpy(buffer, value, length);
+    buffer[length] = '\0';
+    
+    char* end;
+    double parsed = strtod(buffer, &end);
+    if (end == buffer) {
+        return false;
+    }
+    
+    if (number) {
+        *number = parsed;
+    }
+    return true;
+}
+
+size_t log_entry_source_class_len(const char* source) {
+    if (!source) {
+        return 0;
+    }
+    
+    size_t len = strlen(source);
+    if (strncmp(source, "network:", 8) == 0) {
+        // Strip the ephemeral client port
+        const char* last_colon = strrchr(source, ':');
+        if (last_colon && last_colon > source + 7) {
+            return (size_t)(last_colon - source);
+        }
+    }
+    
+    return len;
 }
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include "log_format.h"
+#include "log_entry.h"
+#include "timestamp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    const char* spec;
+} builtin_format_t;
+
+static const builtin_format_t BUILTIN_FORMATS[] = {
+    {"clf", "%{ip:client} %{word} %{word:user} [%{timestamp:timestamp}] "
+            "%{quoted:request} %{int:status} %{word:bytes}"},
+    {"combined", "%{ip:client} %{word} %{word:user} [%{timestamp:timestamp}] "
+                 "%{quoted:request} %{int:status} %{word:bytes} %{quoted:referrer} %{quoted:agent}"},
+    {"syslog", "%{timestamp:timestamp} %{word:host} %{data:program}: %{rest:message}"},
+    {"rfc3164", "<%{int:priority}>%{timestamp:timestamp} %{word:host} %{data:program}: %{rest:message}"},
+    {"rfc5424", "<%{int:priority}>%{int} %{timestamp:timestamp} %{word:host} %{word:app} "
+                "%{word:procid} %{word:msgid} %{rest:message}"},
+};
+
+static const struct {
+    const char* name;
+    format_type_t type;
+} TYPE_NAMES[] = {
+    {"int", FORMAT_INT},
+    {"number", FORMAT_NUMBER},
+    {"word", FORMAT_WORD},
+    {"ip", FORMAT_IP},
+    {"quoted", FORMAT_QUOTED},
+    {"timestamp", FORMAT_TIMESTAMP},
+    {"data", FORMAT_DATA},
+    {"rest", FORMAT_REST},
+};
+
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_hex(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool add_op(log_format_t* format, const format_op_t* op) {
+    if (format->num_ops >= LOG_FORMAT_MAX_OPS) {
+        fprintf(stderr, "Format %s: too many elements\n", format->name);
+        return false;
+    }
+    format->ops[format->num_ops++] = *op;
+    return true;
+}
+
+// Split literal text into blank ops (runs of spaces) and exact-byte ops
+static bool add_literal(log_format_t* format, const char* text, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        format_op_t op;
+        memset(&op, 0, sizeof(op));
+        op.is_literal = true;
+        op.capture = -1;
+        op.next_literal = -1;
+        op.literal = text + i;
+
+        if (text[i] == ' ') {
+            while (i < length && text[i] == ' ') i++;
+            op.blank = true;
+            op.literal_len = 1;
+        } else {
+            size_t start = i;
+            while (i < length && text[i] != ' ') i++;
+            op.literal_len = i - start;
+        }
+
+        if (!add_op(format, &op)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool add_capture(log_format_t* format, const char* type, size_t type_len,
+                        const char* name) {
+    format_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.capture = -1;
+    op.next_literal = -1;
+
+    bool known = false;
+    for (size_t i = 0; i < sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]); i++) {
+        if (strlen(TYPE_NAMES[i].name) == type_len &&
+            strncmp(TYPE_NAMES[i].name, type, type_len) == 0) {
+            op.type = TYPE_NAMES[i].type;
+            known = true;
+            break;
+        }
+    }
+    if (!known) {
+        fprintf(stderr, "Format %s: unknown type '%.*s'\n", format->name, (int)type_len, type);
+        return false;
+    }
+
+    // A capture directly after data/rest could never see its input
+    if (format->num_ops > 0) {
+        const format_op_t* prev = &format->ops[format->num_ops - 1];
+        if (!prev->is_literal && (prev->type == FORMAT_DATA || prev->type == FORMAT_REST)) {
+            fprintf(stderr, "Format %s: '%.*s' cannot directly follow data or rest\n",
+                    format->name, (int)type_len, type);
+            return false;
+        }
+    }
+
+    if (name && name[0]) {
+        if (format->num_captures >= LOG_FORMAT_MAX_CAPTURES) {
+            fprintf(stderr, "Format %s: too many captures\n", format->name);
+            return false;
+        }
+        int slot = (int)format->num_captures;
+        format->captures[slot] = strdup(name);
+        if (!format->captures[slot]) {
+            return false;
+        }
+        format->num_captures++;
+        op.capture = slot;
+
+        if (strcmp(name, "level") == 0) {
+            format->level_capture = slot;
+        } else if (strcmp(name, "message") == 0) {
+            format->message_capture = slot;
+        } else if (strcmp(name, "priority") == 0) {
+            format->priority_capture = slot;
+        } else if (strcmp(name, "status") == 0) {
+            format->status_capture = slot;
+        }
+    }
+
+    return add_op(format, &op);
+}
+
+static void init_empty(log_format_t* format) {
+    memset(format, 0, sizeof(log_format_t));
+    format->level_capture = -1;
+    format->message_capture = -1;
+    format->priority_capture = -1;
+    format->status_capture = -1;
+}
+
+int log_format_compile(log_format_t* format, const char* name, const char* spec) {
+    if (!format || !name || !spec) {
+        return -1;
+    }
+
+    init_empty(format);
+    format->name = strdup(name);
+    format->spec = strdup(spec);
+    if (!format->name || !format->spec) {
+        log_format_destroy(format);
+        return -1;
+    }
+
+    // Literals point into our own copy; '%' of an escaped "%%" is kept in
+    // place and the second one is skipped
+    char* p = format->spec;
+    char* literal = p;
+    while (*p) {
+        if (p[0] == '%' && p[1] == '%') {
+            if (!add_literal(format, literal, (size_t)(p - literal + 1))) {
+                log_format_destroy(format);
+                return -1;
+            }
+            p += 2;
+            literal = p;
+            continue;
+        }
+        if (p[0] != '%' || p[1] != '{') {
+            p++;
+            continue;
+        }
+
+        if (!add_literal(format, literal, (size_t)(p - literal))) {
+            log_format_destroy(format);
+            return -1;
+        }
+
+        char* close = strchr(p + 2, '}');
+        if (!close) {
+            fprintf(stderr, "Format %s: unterminated %%{\n", name);
+            log_format_destroy(format);
+            return -1;
+        }
+
+        char capture_name[64] = "";
+        const char* type = p + 2;
+        const char* colon = memchr(type, ':', (size_t)(close - type));
+        size_t type_len = colon ? (size_t)(colon - type) : (size_t)(close - type);
+        if (colon) {
+            size_t name_len = (size_t)(close - colon - 1);
+            if (name_len >= sizeof(capture_name)) {
+                name_len = sizeof(capture_name) - 1;
+            }
+            memcpy(capture_name, colon + 1, name_len);
+            capture_name[name_len] = '\0';
+        }
+
+        if (!add_capture(format, type, type_len, capture_name)) {
+            log_format_destroy(format);
+            return -1;
+        }
+
+        p = close + 1;
+        literal = p;
+    }
+
+    if (!add_literal(format, literal, (size_t)(p - literal))) {
+        log_format_destroy(format);
+        return -1;
+    }
+
+    // Everything but level and message becomes an entry field
+    size_t stored = format->num_captures;
+    if (format->level_capture >= 0) stored--;
+    if (format->message_capture >= 0) stored--;
+    if (stored > LOG_ENTRY_MAX_FIELDS) {
+        fprintf(stderr, "Format %s: more than %d stored captures\n", name, LOG_ENTRY_MAX_FIELDS);
+        log_format_destroy(format);
+        return -1;
+    }
+
+    // Link each capture to the literal that terminates it
+    for (size_t i = 0; i + 1 < format->num_ops; i++) {
+        if (!format->ops[i].is_literal && format->ops[i + 1].is_literal) {
+            format->ops[i].next_literal = (int)(i + 1);
+        }
+    }
+
+    return 0;
+}
+
+int log_format_builtin(log_format_t* format, const char* name) {
+    if (!format || !name) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(BUILTIN_FORMATS) / sizeof(BUILTIN_FORMATS[0]); i++) {
+        if (strcmp(BUILTIN_FORMATS[i].name, name) == 0) {
+            return log_format_compile(format, name, BUILTIN_FORMATS[i].spec);
+        }
+    }
+    return -1;
+}
+
+void log_format_destroy(log_format_t* format) {
+    if (!format) {
+        return;
+    }
+
+    for (size_t i = 0; i < format->num_captures; i++) {
+        free(format->captures[i]);
+    }
+    free(format->name);
+    free(format->spec);
+    init_empty(format);
+}
+
+static size_t match_ip(const char* s, size_t n, char terminator) {
+    // IPv4 first: digits and exactly three dots
+    size_t i = 0;
+    int dots = 0;
+    while (i < n && (is_digit(s[i]) || s[i] == '.')) {
+        dots += s[i] == '.';
+        i++;
+    }
+    if (dots == 3 && i >= 7 && (i == n || s[i] == terminator || !(is_hex(s[i]) || s[i] == ':'))) {
+        return i;
+    }
+
+    // IPv6 (possibly with an embedded IPv4 tail)
+    i = 0;
+    int colons = 0;
+    while (i < n && (is_hex(s[i]) || s[i] == ':' || s[i] == '.')) {
+        colons += s[i] == ':';
+        i++;
+    }
+    return colons >= 2 ? i : 0;
+}
+
+// Find the terminating literal of a data capture starting at pos
+static long find_literal(const format_op_t* literal, const char* line, size_t length, size_t pos) {
+    if (literal->blank) {
+        for (size_t i = pos; i < length; i++) {
+            if (is_blank(line[i])) {
+                return (long)i;
+            }
+        }
+        return -1;
+    }
+
+    const char first = literal->literal[0];
+    while (pos + literal->literal_len <= length) {
+        const char* hit = memchr(line + pos, first, length - pos - literal->literal_len + 1);
+        if (!hit) {
+            return -1;
+        }
+        if (memcmp(hit, literal->literal, literal->literal_len) == 0) {
+            return (long)(hit - line);
+        }
+        pos = (size_t)(hit - line) + 1;
+    }
+    return -1;
+}
+
+// Match one capture at pos; returns the end offset or -1. start/span_len
+// receive the captured bytes (which exclude quotes for quoted strings) and
+// timestamp the parsed time of timestamp captures.
+static long match_capture(const log_format_t* format, const format_op_t* op,
+                          const char* line, size_t length, size_t pos,
+                          size_t* start, size_t* span_len, int64_t* timestamp) {
+    const format_op_t* next = op->next_literal >= 0 ? &format->ops[op->next_literal] : NULL;
+    // First byte of a non-blank terminator, so tokens stop in "[%{word}]"
+    char stop = (next && !next->blank) ? next->literal[0] : ' ';
+    const char* s = line + pos;
+    size_t n = length - pos;
+    size_t i = 0;
+
+    *start = pos;
+
+    switch (op->type) {
+    case FORMAT_INT:
+    case FORMAT_NUMBER:
+        if (i < n && (s[i] == '-' || s[i] == '+')) i++;
+        {
+            size_t digits_start = i;
+            while (i < n && is_digit(s[i])) i++;
+            if (op->type == FORMAT_NUMBER && i < n && s[i] == '.') {
+                i++;
+                while (i < n && is_digit(s[i])) i++;
+            }
+            if (i == digits_start || (i == digits_start + 1 && s[digits_start] == '.')) {
+                return -1;
+            }
+        }
+        break;
+
+    case FORMAT_WORD:
+        while (i < n && !is_blank(s[i]) && s[i] != stop) i++;
+        if (i == 0) {
+            return -1;
+        }
+        break;
+
+    case FORMAT_IP:
+        i = match_ip(s, n, stop);
+        if (i == 0) {
+            return -1;
+        }
+        break;
+
+    case FORMAT_QUOTED:
+        if (n == 0 || s[0] != '"') {
+            return -1;
+        }
+        for (i = 1; i < n && s[i] != '"'; i++) {
+            if (s[i] == '\\') i++;
+        }
+        if (i >= n) {
+            return -1;
+        }
+        *start = pos + 1;
+        *span_len = i - 1;
+        return (long)(pos + i + 1);
+
+    case FORMAT_TIMESTAMP:
+        i = timestamp_parse(s, n, true, timestamp);
+        if (i == 0) {
+            return -1;
+        }
+        break;
+
+    case FORMAT_DATA:
+        if (next) {
+            long end = find_literal(next, line, length, pos);
+            if (end < 0) {
+                return -1;
+            }
+            i = (size_t)end - pos;
+        } else {
+            i = n;
+        }
+        break;
+
+    case FORMAT_REST:
+        i = n;
+        break;
+    }
+
+    *span_len = i;
+    return (long)(pos + i);
+}
+
+bool log_format_match(const log_format_t* format, const char* line, size_t length,
+                      format_span_t* spans, int64_t* timestamp) {
+    if (!format || !line || !spans) {
+        return false;
+    }
+
+    while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == '\n')) {
+        length--;
+    }
+    memset(spans, 0, sizeof(format_span_t) * LOG_FORMAT_MAX_CAPTURES);
+
+    int64_t event_time = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < format->num_ops; i++) {
+        const format_op_t* op = &format->ops[i];
+
+        if (op->is_literal) {
+            if (op->blank) {
+                if (pos >= length || !is_blank(line[pos])) {
+                    return false;
+                }
+                while (pos < length && is_blank(line[pos])) pos++;
+            } else {
+                if (length - pos < op->literal_len ||
+                    memcmp(line + pos, op->literal, op->literal_len) != 0) {
+                    return false;
+                }
+                pos += op->literal_len;
+            }
+            continue;
+        }
+
+        size_t start = 0, span_len = 0;
+        int64_t parsed = 0;
+        long end = match_capture(format, op, line, length, pos, &start, &span_len, &parsed);
+        if (end < 0) {
+            return false;
+        }
+        if (op->type == FORMAT_TIMESTAMP && event_time == 0) {
+            event_time = parsed;
+        }
+        if (op->capture >= 0) {
+            spans[op->capture].start = line + start;
+            spans[op->capture].length = span_len;
+        }
+        pos = (size_t)end;
+    }
+
+    if (pos != length) {
+        return false;
+    }
+    if (timestamp) {
+        *timestamp = event_time;
+    }
+    return true;
+}
+
+static long span_to_long(const format_span_t* span) {
+    long value = 0;
+    for (size_t i = 0; i < span->length && is_digit(span->start[i]); i++) {
+        value = value * 10 + (span->start[i] - '0');
+    }
+    return value;
+}
+
+// Syslog severity is the low three bits of PRI
+static log_level_t priority_level(long priority) {
+    switch (priority & 7) {
+    case 0: case 1: case 2: return LOG_LEVEL_CRITICAL;
+    case 3: return LOG_LEVEL_ERROR;
+    case 4: return LOG_LEVEL_WARNING;
+    case 7: return LOG_LEVEL_DEBUG;
+    default: return LOG_LEVEL_INFO;
+    }
+}
+
+static log_level_t status_level(long status) {
+    if (status >= 500) return LOG_LEVEL_ERROR;
+    if (status >= 400) return LOG_LEVEL_WARNING;
+    return LOG_LEVEL_INFO;
+}
+
+log_entry_t* log_format_create_entry(const log_format_t* format, const char* source,
+                                     const char* line, size_t length) {
+    format_span_t spans[LOG_FORMAT_MAX_CAPTURES];
+    int64_t event_time;
+    if (!source || !log_format_match(format, line, length, spans, &event_time)) {
+        return NULL;
+    }
+
+    log_level_t level = LOG_LEVEL_INFO;
+    if (format->level_capture >= 0 && spans[format->level_capture].start) {
+        level = log_entry_parse_level_len(spans[format->level_capture].start,
+                                          spans[format->level_capture].length);
+    } else if (format->priority_capture >= 0 && spans[format->priority_capture].start) {
+        level = priority_level(span_to_long(&spans[format->priority_capture]));
+    } else if (format->status_capture >= 0 && spans[format->status_capture].start) {
+        level = status_level(span_to_long(&spans[format->status_capture]));
+    }
+
+    // Without a message capture the whole line is the message
+    const char* message = line;
+    size_t message_len = length;
+    if (format->message_capture >= 0 && spans[format->message_capture].start) {
+        message = spans[format->message_capture].start;
+        message_len = spans[format->message_capture].length;
+    }
+
+    log_entry_t* entry = log_entry_create_len(source, message, message_len, level, line, length);
+    if (!entry) {
+        return NULL;
+    }
+    if (event_time != 0) {
+        entry->timestamp = event_time;
+    }
+
+    // Captures are stored as offsets into the entry's copy of the line
+    for (size_t i = 0; i < format->num_captures; i++) {
+        if ((int)i == format->level_capture || (int)i == format->message_capture ||
+            !spans[i].start) {
+            continue;
+        }
+        log_entry_set_field(entry, format->captures[i],
+                            entry->raw_line + (spans[i].start - line), spans[i].length);
+    }
+
+    return entry;
+}
\ No newline at end of file
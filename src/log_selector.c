@@ -0,0 +1,115 @@
+#include "log_selector.h"
+#include "field_rule.h"
+#include "log_entry.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define LOG_SELECTOR_MAX 512
+
+static const struct {
+    const char* name;
+    log_level_t level;
+} LEVEL_NAMES[] = {
+    {"DEBUG", LOG_LEVEL_DEBUG},
+    {"INFO", LOG_LEVEL_INFO},
+    {"WARNING", LOG_LEVEL_WARNING},
+    {"WARN", LOG_LEVEL_WARNING},
+    {"ERROR", LOG_LEVEL_ERROR},
+    {"CRITICAL", LOG_LEVEL_CRITICAL},
+};
+
+// Only exact level names select by level; anything else is a pattern
+static bool parse_level(const char* word, size_t len, log_level_t* level) {
+    for (size_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); i++) {
+        if (strlen(LEVEL_NAMES[i].name) == len && strncasecmp(word, LEVEL_NAMES[i].name, len) == 0) {
+            *level = LEVEL_NAMES[i].level;
+            return true;
+        }
+    }
+    return false;
+}
+
+int log_selector_parse(log_selector_t* selector, const char* text, size_t length) {
+    if (!selector || !text) {
+        return -1;
+    }
+
+    memset(selector, 0, sizeof(log_selector_t));
+    selector->min_level = LOG_LEVEL_DEBUG;
+
+    while (length > 0 && *text == ' ') {
+        text++;
+        length--;
+    }
+    while (length > 0 && text[length - 1] == ' ') {
+        length--;
+    }
+    if (length == 0 || length >= LOG_SELECTOR_MAX) {
+        return -1;
+    }
+
+    // An optional level name comes first
+    size_t word_len = 0;
+    while (word_len < length && text[word_len] != ' ') {
+        word_len++;
+    }
+    if (parse_level(text, word_len, &selector->min_level)) {
+        text += word_len;
+        length -= word_len;
+        while (length > 0 && *text == ' ') {
+            text++;
+            length--;
+        }
+    }
+
+    char rest[LOG_SELECTOR_MAX];
+    memcpy(rest, text, length);
+    rest[length] = '\0';
+
+    // Then a quoted or plain substring, or a field rule
+    if (length >= 2 && rest[0] == '"' && rest[length - 1] == '"') {
+        rest[length - 1] = '\0';
+        selector->pattern = strdup(rest + 1);
+    } else if (length > 0 && strpbrk(rest, "=!<>~")) {
+        if (field_rule_parse(&selector->field, rest) != 0) {
+            return -1;
+        }
+        selector->has_field = true;
+    } else if (length > 0) {
+        selector->pattern = strdup(rest);
+    } else {
+        return 0;
+    }
+
+    if (!selector->has_field && !selector->pattern) {
+        return -1;
+    }
+    return 0;
+}
+
+void log_selector_destroy(log_selector_t* selector) {
+    if (!selector) {
+        return;
+    }
+
+    if (selector->has_field) {
+        field_rule_destroy(&selector->field);
+    }
+    free(selector->pattern);
+    memset(selector, 0, sizeof(log_selector_t));
+}
+
+bool log_selector_matches(const log_selector_t* selector, log_entry_t* entry) {
+    if (!selector || !entry || entry->level < selector->min_level) {
+        return false;
+    }
+
+    if (selector->has_field) {
+        return field_rule_matches(&selector->field, entry);
+    }
+    if (selector->pattern) {
+        return strstr(entry->message, selector->pattern) != NULL;
+    }
+    return true;
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "log_source.h"
 #include "log_entry.h"
-#include "queue.h"
+#include "ingest.h"
+#include "line_parser.h"
+#include "line_scan.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,13 +17,86 @@
 #include <sys/select.h>
 #include <pthread.h>
 
+#define READ_BUFFER_SIZE 65536
+
 // Forward declarations for thread functions
 static void* file_monitor_thread_func(void* arg);
 static void* network_server_thread_func(void* arg);
 
+// Per-source ingest state, resolved once per file read or connection
+typedef struct {
+    const line_parser_t* parser;
+    const log_format_t* format;
+    pushdown_source_t filter;
+    const char* source;
+    const ingest_t* ingest;
+    uint64_t affinity;
+} source_reader_t;
+
+static void reader_init(source_reader_t* reader, const line_parser_t* parser,
+                        const char* source, const ingest_t* ingest) {
+    reader->parser = parser;
+    reader->format = line_parser_format_for(parser, source);
+    line_parser_source_filter(parser, &reader->filter, source, reader->format);
+    reader->source = source;
+    reader->ingest = ingest;
+    reader->affinity = ingest_affinity(source);
+}
+
+// Ingest a line that was not framed (overlong, or unterminated at disconnect)
+static void ingest_line(const source_reader_t* reader, const char* line, size_t len) {
+    line_span_t span = {0, (uint32_t)len, 0, LOG_LEVEL_INFO, 0};
+    log_entry_t* entry = line_parser_create_entry_span(reader->parser, reader->format,
+                                                       &reader->filter, reader->source,
+                                                       line, &span);
+    if (entry) {
+        ingest_submit(reader->ingest, &entry, 1, reader->affinity);
+    }
+}
+
+// Frame every complete line in buf and submit the entries one batch per
+// scan. Returns the number of bytes of a trailing partial line, moved to
+// the front of buf.
+static size_t ingest_buffer(const source_reader_t* reader, char* buf, size_t len) {
+    line_span_t spans[LINE_SCAN_BATCH];
+    log_entry_t* entries[LINE_SCAN_BATCH];
+    size_t offset = 0;
+    
+    for (;;) {
+        size_t consumed;
+        size_t count = line_scan(buf + offset, len - offset, spans, LINE_SCAN_BATCH, &consumed);
+        size_t num_entries = 0;
+        for (size_t i = 0; i < count; i++) {
+            log_entry_t* entry = line_parser_create_entry_span(reader->parser, reader->format,
+                                                               &reader->filter, reader->source,
+                                                               buf + offset, &spans[i]);
+            if (entry) {
+                entries[num_entries++] = entry;
+            }
+        }
+        ingest_submit(reader->ingest, entries, num_entries, reader->affinity);
+        offset += consumed;
+        if (count < LINE_SCAN_BATCH) {
+            break;
+        }
+    }
+    
+    size_t pending = len - offset;
+    if (pending == READ_BUFFER_SIZE) {
+        // Line longer than the buffer: ingest what we have as one line
+        ingest_line(reader, buf, pending);
+        return 0;
+    }
+    if (pending > 0 && offset > 0) {
+        memmove(buf, buf + offset, pending);
+    }
+    return pending;
+}
+
 // Helper function to read new lines from a file
 static void read_new_lines(const char* filepath, FILE* file_handle, 
-                          log_queue_t* queue, off_t* last_position) {
+                          const ingest_t* ingest, const line_parser_t* parser,
+                          off_t* last_position) {
     struct stat st;
     if (stat(filepath, &st) != 0) {
         return;
@@ -30,48 +105,36 @@ static void read_new_lines(const char* filepath, FILE* file_handle,
     // If file was truncated, reset position
     if (st.st_size < *last_position) {
         *last_position = 0;
-        fseek(file_handle, 0, SEEK_SET);
+    } else if (st.st_size == *last_position) {
+        return;
     }
+    fseek(file_handle, *last_position, SEEK_SET);  // Also clears a sticky EOF
     
-    char line[4096];
-    while (fgets(line, sizeof(line), file_handle)) {
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') {
-            line[len-1] = '\0';
-        }
-        
-        // Parse log entry (simple format: [LEVEL] message)
-        log_level_t level = LOG_LEVEL_INFO;
-        char* message = line;
-        
-        if (line[0] == '[') {
-            char* end_bracket = strchr(line, ']');
-            if (end_bracket) {
-                *end_bracket = '\0';
-                level = log_entry_parse_level(line + 1);
-                message = end_bracket + 1;
-                while (*message == ' ') message++; // Skip spaces
-            }
-        }
-        
-        log_entry_t* entry = log_entry_create(filepath, message, level, line);
-        if (entry) {
-            queue_enqueue(queue, entry);
-        }
+    source_reader_t reader;
+    reader_init(&reader, parser, filepath, ingest);
+    char buffer[READ_BUFFER_SIZE];
+    size_t pending = 0;
+    size_t bytes_read;
+    while ((bytes_read = fread(buffer + pending, 1, sizeof(buffer) - pending, file_handle)) > 0) {
+        pending = ingest_buffer(&reader, buffer, pending + bytes_read);
     }
     
-    *last_position = ftell(file_handle);
+    // A partial last line is re-read once its newline has been written
+    *last_position = ftell(file_handle) - (long)pending;
+    fseek(file_handle, *last_position, SEEK_SET);
 }
 
 int file_monitor_init(file_monitor_t* monitor, const char* directory, 
-                      int poll_interval, log_queue_t* queue) {
-    if (!monitor || !directory || !queue) {
+                      int poll_interval, const ingest_t* ingest,
+                      const line_parser_t* parser) {
+    if (!monitor || !directory || !ingest) {
         return -1;
     }
     
     monitor->directory = strdup(directory);
     monitor->poll_interval = poll_interval;
-    monitor->queue = queue;
+    monitor->ingest = ingest;
+    monitor->parser = parser;
     monitor->running = false;
     
     if (!monitor->directory) {
@@ -145,10 +208,8 @@ static void* file_monitor_thread_func(void* arg) {
                             // Read existing content first
                             fseek(files[num_files].handle, 0, SEEK_SET); // Start from beginning
                             read_new_lines(filepath, files[num_files].handle,
-                                         monitor->queue, &files[num_files].last_position);
-                            // Now seek to end so we only read new content in future polls
-                            fseek(files[num_files].handle, 0, SEEK_END);
-                            files[num_files].last_position = ftell(files[num_files].handle);
+                                         monitor->ingest, monitor->parser,
+                                         &files[num_files].last_position);
                             num_files++;
                         } else {
                             free(files[num_files].filepath);
@@ -157,7 +218,8 @@ static void* file_monitor_thread_func(void* arg) {
                         // Existing file, read new lines
                         if (files[i].handle) {
                             read_new_lines(files[i].filepath, files[i].handle,
-                                         monitor->queue, &files[i].last_position);
+                                         monitor->ingest, monitor->parser,
+                                         &files[i].last_position);
                         }
                     }
                 }
@@ -212,13 +274,15 @@ void file_monitor_destroy(file_monitor_t* monitor) {
     free(monitor->directory);
 }
 
-int network_server_init(network_server_t* server, int port, log_queue_t* queue) {
-    if (!server || !queue) {
+int network_server_init(network_server_t* server, int port, const ingest_t* ingest,
+                        const line_parser_t* parser) {
+    if (!server || !ingest) {
         return -1;
     }
     
     server->port = port;
-    server->queue = queue;
+    server->ingest = ingest;
+    server->parser = parser;
     server->running = false;
     server->server_fd = -1;
     
@@ -285,42 +349,21 @@ static void* network_server_thread_func(void* arg) {
                 inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
                 char source[256];
                 snprintf(source, sizeof(source), "network:%s:%d", client_ip, ntohs(client_addr.sin_port));
+                source_reader_t reader;
+                reader_init(&reader, server->parser, source, server->ingest);
                 
-                // Read log lines from client
-                char buffer[4096];
+                // Read log lines from client; a line may span several reads
+                char buffer[READ_BUFFER_SIZE];
+                size_t pending = 0;
                 ssize_t bytes_read;
-                while ((bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0)) > 0) {
-                    buffer[bytes_read] = '\0';
-                    
-                    // Process each line
-                    char* line = buffer;
-                    char* newline;
-                    while ((newline = strchr(line, '\n')) != NULL) {
-                        *newline = '\0';
-                        
-                        if (strlen(line) > 0) {
-                            log_level_t level = LOG_LEVEL_INFO;
-                            char* message = line;
-                            
-                            // Parse [LEVEL] format
-                            if (line[0] == '[') {
-                                char* end_bracket = strchr(line, ']');
-                                if (end_bracket) {
-                                    *end_bracket = '\0';
-                                    level = log_entry_parse_level(line + 1);
-                                    message = end_bracket + 1;
-                                    while (*message == ' ') message++;
-                                }
-                            }
-                            
-                            log_entry_t* entry = log_entry_create(source, message, level, line);
-                            if (entry) {
-                                queue_enqueue(server->queue, entry);
-                            }
-                        }
-                        
-                        line = newline + 1;
-                    }
+                while ((bytes_read = recv(client_fd, buffer + pending,
+                                          sizeof(buffer) - pending, 0)) > 0) {
+                    pending = ingest_buffer(&reader, buffer, pending + (size_t)bytes_read);
+                }
+                
+                // The client closed the connection: the last line needs no newline
+                if (pending > 0) {
+                    ingest_line(&reader, buffer, pending);
                 }
                 
                 close(client_fd);
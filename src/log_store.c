@@ -0,0 +1,782 @@
+#include "log_store.h"
+#include "segment.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include "token_index.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Unflushed bytes a shard collects before adding them to the shared count
+#define PUBLISH_BYTES 65536
+// First arena of a shard
+#define SHARD_INITIAL 65536
+
+// Row in a memtable, followed by the source and the raw line (padded to 8 bytes)
+typedef struct {
+    int64_t timestamp;
+    uint32_t source_len;
+    uint32_t line_len;
+    uint32_t level;
+    uint32_t reserved;
+} row_header_t;
+
+// Memtable taken from a shard by a flush
+typedef struct {
+    char* data;
+    size_t used;
+} arena_t;
+
+static void* log_store_thread_func(void* arg);
+
+static inline size_t row_size(size_t source_len, size_t line_len) {
+    return (sizeof(row_header_t) + source_len + line_len + 7) & ~(size_t)7;
+}
+
+// Start of the partition holding a time (rounded down for negative times too)
+static int64_t partition_start(const log_store_t* store, int64_t time) {
+    int64_t quotient = time / store->partition;
+    if (time % store->partition < 0) {
+        quotient--;
+    }
+    return quotient * store->partition;
+}
+
+// "YYYYmmdd-HHMMSS" of a partition's UTC start
+static void partition_name(int64_t start, char* out, size_t size) {
+    time_t seconds = (time_t)(start / TIMESTAMP_NS_PER_SEC);
+    struct tm timeinfo;
+    gmtime_r(&seconds, &timeinfo);
+    strftime(out, size, "%Y%m%d-%H%M%S", &timeinfo);
+}
+
+static bool parse_partition(const char* name, int64_t* start) {
+    struct tm timeinfo;
+    memset(&timeinfo, 0, sizeof(timeinfo));
+    char end;
+    if (sscanf(name, "%4d%2d%2d-%2d%2d%2d%c", &timeinfo.tm_year, &timeinfo.tm_mon,
+               &timeinfo.tm_mday, &timeinfo.tm_hour, &timeinfo.tm_min, &timeinfo.tm_sec,
+               &end) != 6) {
+        return false;
+    }
+    timeinfo.tm_year -= 1900;
+    timeinfo.tm_mon -= 1;
+    *start = (int64_t)timegm(&timeinfo) * TIMESTAMP_NS_PER_SEC;
+    return true;
+}
+
+static bool has_suffix(const char* name, const char* suffix) {
+    size_t length = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return length > suffix_len && strcmp(name + length - suffix_len, suffix) == 0;
+}
+
+// Add to the catalogue (caller holds the mutex)
+static int add_segment(log_store_t* store, const log_store_segment_t* segment) {
+    if (store->num_segments == store->segment_capacity) {
+        size_t capacity = store->segment_capacity ? store->segment_capacity * 2 : 64;
+        log_store_segment_t* segments = (log_store_segment_t*)realloc(
+            store->segments, capacity * sizeof(log_store_segment_t));
+        if (!segments) {
+            return -1;
+        }
+        store->segments = segments;
+        store->segment_capacity = capacity;
+    }
+    store->segments[store->num_segments++] = *segment;
+    return 0;
+}
+
+static int compare_segments(const void* a, const void* b) {
+    uint64_t left = ((const log_store_segment_t*)a)->id;
+    uint64_t right = ((const log_store_segment_t*)b)->id;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+// IDs of segments superseded by compacted ones
+typedef struct {
+    uint64_t* ids;
+    size_t count;
+    size_t capacity;
+} id_list_t;
+
+static void add_ids(id_list_t* list, const segment_t* segment) {
+    for (size_t i = 0; i < segment->num_replaces; i++) {
+        if (list->count == list->capacity) {
+            size_t capacity = list->capacity ? list->capacity * 2 : 64;
+            uint64_t* ids = (uint64_t*)realloc(list->ids, capacity * sizeof(uint64_t));
+            if (!ids) {
+                return;
+            }
+            list->ids = ids;
+            list->capacity = capacity;
+        }
+        list->ids[list->count++] = segment_replaced_id(segment, i);
+    }
+}
+
+static int compare_ids(const void* a, const void* b) {
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+// Catalogue the segments of one partition directory; leftovers of an
+// interrupted write are removed
+static void load_partition(log_store_t* store, const char* name, int64_t start,
+                           id_list_t* replaced) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", store->dir, name);
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* file;
+    while ((file = readdir(dir)) != NULL) {
+        char file_path[PATH_MAX];
+        if (snprintf(file_path, sizeof(file_path), "%s/%s", path, file->d_name) >=
+            (int)sizeof(file_path)) {
+            continue;
+        }
+        if (has_suffix(file->d_name, ".seg.tmp")) {
+            if (!store->read_only) {
+                unlink(file_path); // A writer may still own it otherwise
+            }
+            continue;
+        }
+        log_store_segment_t entry;
+        memset(&entry, 0, sizeof(entry));
+        if (!has_suffix(file->d_name, ".seg") ||
+            snprintf(entry.name, sizeof(entry.name), "%s/%s", name, file->d_name) >=
+                (int)sizeof(entry.name)) {
+            continue;
+        }
+
+        segment_t segment;
+        if (segment_open(&segment, file_path) != 0) {
+            fprintf(stderr, "Skipping unreadable segment %s\n", file_path);
+            metrics_add(store->errors, 1);
+            continue;
+        }
+        entry.id = segment.id;
+        entry.min_time = segment.min_time;
+        entry.max_time = segment.max_time;
+        entry.partition = start;
+        entry.rows = segment.num_rows;
+        entry.bytes = segment.size;
+        add_ids(replaced, &segment);
+        segment_close(&segment);
+
+        if (add_segment(store, &entry) == 0 && entry.id >= store->next_id) {
+            store->next_id = entry.id + 1;
+        }
+    }
+    closedir(dir);
+}
+
+static int load_catalogue(log_store_t* store) {
+    if (!store->read_only && mkdir(store->dir, 0755) != 0 && errno != EEXIST) {
+        perror("Failed to create store directory");
+        return -1;
+    }
+    DIR* dir = opendir(store->dir);
+    if (!dir) {
+        perror("Failed to open store directory");
+        return -1;
+    }
+
+    id_list_t replaced = {0};
+    struct dirent* partition;
+    while ((partition = readdir(dir)) != NULL) {
+        int64_t start;
+        if (parse_partition(partition->d_name, &start)) {
+            load_partition(store, partition->d_name, start, &replaced);
+        }
+    }
+    closedir(dir);
+
+    // Inputs of a compaction interrupted before it removed them
+    if (replaced.count > 0) {
+        qsort(replaced.ids, replaced.count, sizeof(uint64_t), compare_ids);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < store->num_segments; i++) {
+        log_store_segment_t* entry = &store->segments[i];
+        if (replaced.count > 0 &&
+            bsearch(&entry->id, replaced.ids, replaced.count, sizeof(uint64_t), compare_ids)) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", store->dir, entry->name);
+            if (!store->read_only) {
+                unlink(path);
+            }
+            continue;
+        }
+        store->segments[kept++] = *entry;
+    }
+    store->num_segments = kept;
+    free(replaced.ids);
+    if (store->num_segments > 1) {
+        qsort(store->segments, store->num_segments, sizeof(log_store_segment_t),
+              compare_segments);
+    }
+    return 0;
+}
+
+// Key destructor: the thread exited, so its shard may be adopted
+static void release_shard(void* arg) {
+    log_store_shard_t* shard = (log_store_shard_t*)arg;
+    log_store_t* store = (log_store_t*)shard->store;
+    pthread_mutex_lock(&store->mutex);
+    shard->owned = false;
+    pthread_mutex_unlock(&store->mutex);
+}
+
+// Adopt a released shard or add one for the calling thread
+static log_store_shard_t* attach_shard(log_store_t* store) {
+    pthread_mutex_lock(&store->mutex);
+    log_store_shard_t* shard = store->shards;
+    while (shard && shard->owned) {
+        shard = shard->next;
+    }
+    if (!shard) {
+        shard = (log_store_shard_t*)calloc(1, sizeof(log_store_shard_t));
+        if (!shard) {
+            pthread_mutex_unlock(&store->mutex);
+            return NULL;
+        }
+        pthread_mutex_init(&shard->mutex, NULL);
+        shard->store = store;
+        shard->capacity = SHARD_INITIAL;
+        shard->next = store->shards;
+        store->shards = shard;
+    }
+    shard->owned = true;
+    pthread_mutex_unlock(&store->mutex);
+
+    pthread_setspecific(store->key, shard);
+    return shard;
+}
+
+// Set up everything but the memtable settings and load the catalogue
+static int open_store(log_store_t* store, const char* dir, bool read_only) {
+    memset(store, 0, sizeof(log_store_t));
+    store->dir = strdup(dir);
+    if (!store->dir) {
+        return -1;
+    }
+    store->read_only = read_only;
+    store->next_id = 1;
+
+    store->rows = metrics_register("store.rows", METRIC_COUNTER);
+    store->raw_bytes = metrics_register("store.raw_bytes", METRIC_COUNTER);
+    store->bytes = metrics_register("store.bytes", METRIC_COUNTER);
+    store->segments_written = metrics_register("store.segments", METRIC_COUNTER);
+    store->flushes = metrics_register("store.flushes", METRIC_COUNTER);
+    store->dropped = metrics_register("store.dropped", METRIC_COUNTER);
+    store->errors = metrics_register("store.errors", METRIC_COUNTER);
+    store->memtable = metrics_register("store.memtable_bytes", METRIC_GAUGE);
+    store->searches = metrics_register("store.searches", METRIC_COUNTER);
+    store->search_skipped = metrics_register("store.search_skipped", METRIC_COUNTER);
+    store->search_scanned = metrics_register("store.search_scanned", METRIC_COUNTER);
+
+    if (pthread_key_create(&store->key, release_shard) != 0) {
+        free(store->dir);
+        memset(store, 0, sizeof(log_store_t));
+        return -1;
+    }
+    pthread_mutex_init(&store->mutex, NULL);
+    pthread_mutex_init(&store->flush_mutex, NULL);
+    pthread_cond_init(&store->wake, NULL);
+
+    if (load_catalogue(store) != 0) {
+        log_store_destroy(store);
+        return -1;
+    }
+    return 0;
+}
+
+int log_store_init(log_store_t* store, const config_t* config) {
+    if (!store || !config || !config->store_dir || config->store_memtable_size == 0 ||
+        config->store_flush_ms <= 0 || config->store_partition <= 0) {
+        return -1;
+    }
+
+    if (open_store(store, config->store_dir, false) != 0) {
+        return -1;
+    }
+    store->memtable_size = config->store_memtable_size;
+    store->flush_interval = (int64_t)config->store_flush_ms * 1000000LL;
+    store->partition = (int64_t)config->store_partition * TIMESTAMP_NS_PER_SEC;
+    return 0;
+}
+
+int log_store_open(log_store_t* store, const char* dir) {
+    if (!store || !dir) {
+        return -1;
+    }
+    // Without a memtable every append is dropped
+    return open_store(store, dir, true);
+}
+
+static void* log_store_thread_func(void* arg) {
+    log_store_t* store = (log_store_t*)arg;
+
+    pthread_mutex_lock(&store->mutex);
+    while (store->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        int64_t nanoseconds = deadline.tv_nsec + store->flush_interval;
+        deadline.tv_sec += nanoseconds / TIMESTAMP_NS_PER_SEC;
+        deadline.tv_nsec = nanoseconds % TIMESTAMP_NS_PER_SEC;
+
+        int rc = 0;
+        while (store->running && !store->flush_requested && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&store->wake, &store->mutex, &deadline);
+        }
+        if (!store->running) {
+            break;
+        }
+        store->flush_requested = false;
+        pthread_mutex_unlock(&store->mutex);
+
+        log_store_flush(store);
+
+        pthread_mutex_lock(&store->mutex);
+    }
+    pthread_mutex_unlock(&store->mutex);
+    return NULL;
+}
+
+int log_store_start(log_store_t* store) {
+    if (!store || store->read_only) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->mutex);
+    store->running = true;
+    pthread_mutex_unlock(&store->mutex);
+    if (pthread_create(&store->thread, NULL, log_store_thread_func, store) != 0) {
+        store->running = false;
+        return -1;
+    }
+    store->started = true;
+    return 0;
+}
+
+void log_store_stop(log_store_t* store) {
+    if (!store) {
+        return;
+    }
+
+    if (store->started) {
+        pthread_mutex_lock(&store->mutex);
+        store->running = false;
+        pthread_cond_signal(&store->wake);
+        pthread_mutex_unlock(&store->mutex);
+        pthread_join(store->thread, NULL);
+        store->started = false;
+    }
+    log_store_flush(store);
+}
+
+void log_store_destroy(log_store_t* store) {
+    if (!store || !store->dir) {
+        return;
+    }
+
+    log_store_shard_t* shard = store->shards;
+    while (shard) {
+        log_store_shard_t* next = shard->next;
+        pthread_mutex_destroy(&shard->mutex);
+        free(shard->data);
+        free(shard);
+        shard = next;
+    }
+    metrics_set(store->memtable, 0);
+    pthread_key_delete(store->key);
+    pthread_cond_destroy(&store->wake);
+    pthread_mutex_destroy(&store->flush_mutex);
+    pthread_mutex_destroy(&store->mutex);
+    free(store->segments);
+    free(store->dir);
+    memset(store, 0, sizeof(log_store_t));
+}
+
+void log_store_append(log_store_t* store, const log_entry_t* entry) {
+    if (!store || !entry || !entry->source) {
+        return;
+    }
+
+    // Behind by a whole memtable: lines are dropped rather than waiting for the disk
+    if (__atomic_load_n(&store->pending, __ATOMIC_RELAXED) >= 2 * store->memtable_size) {
+        metrics_add(store->dropped, 1);
+        return;
+    }
+
+    log_store_shard_t* shard = (log_store_shard_t*)pthread_getspecific(store->key);
+    if (!shard && !(shard = attach_shard(store))) {
+        metrics_add(store->dropped, 1);
+        return;
+    }
+
+    const char* line = entry->raw_line ? entry->raw_line : entry->message;
+    size_t source_len = strlen(entry->source);
+    size_t line_len = line ? strlen(line) : 0;
+    if (source_len > UINT32_MAX || line_len > UINT32_MAX) {
+        metrics_add(store->dropped, 1);
+        return;
+    }
+    size_t size = row_size(source_len, line_len);
+
+    pthread_mutex_lock(&shard->mutex);
+    if (!shard->data || shard->capacity - shard->used < size) {
+        size_t capacity = shard->capacity;
+        while (capacity - shard->used < size) {
+            capacity *= 2;
+        }
+        char* data = (char*)realloc(shard->data, capacity);
+        if (!data) {
+            pthread_mutex_unlock(&shard->mutex);
+            metrics_add(store->dropped, 1);
+            return;
+        }
+        shard->data = data;
+        shard->capacity = capacity;
+    }
+
+    char* out = shard->data + shard->used;
+    row_header_t header = {entry->timestamp, (uint32_t)source_len, (uint32_t)line_len,
+                           (uint32_t)entry->level, 0};
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), entry->source, source_len);
+    if (line_len > 0) {
+        memcpy(out + sizeof(header) + source_len, line, line_len);
+    }
+    shard->used += size;
+
+    // The shared count is updated in steps, not per line
+    size_t unpublished = shard->used - shard->published;
+    if (unpublished >= PUBLISH_BYTES) {
+        shard->published = shard->used;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (unpublished >= PUBLISH_BYTES) {
+        size_t pending = __atomic_add_fetch(&store->pending, unpublished, __ATOMIC_RELAXED);
+        if (pending >= store->memtable_size && pending - unpublished < store->memtable_size) {
+            pthread_mutex_lock(&store->mutex);
+            store->flush_requested = true;
+            pthread_cond_signal(&store->wake);
+            pthread_mutex_unlock(&store->mutex);
+        }
+    }
+}
+
+// Take every shard's memtable; the shards start over with empty ones
+static arena_t* take_memtables(log_store_t* store, size_t* count) {
+    pthread_mutex_lock(&store->mutex);
+    size_t num_shards = 0;
+    for (log_store_shard_t* shard = store->shards; shard; shard = shard->next) {
+        num_shards++;
+    }
+    arena_t* arenas = (arena_t*)calloc(num_shards + 1, sizeof(arena_t));
+    if (!arenas) {
+        pthread_mutex_unlock(&store->mutex);
+        return NULL;
+    }
+
+    size_t taken = 0;
+    size_t published = 0;
+    for (log_store_shard_t* shard = store->shards; shard; shard = shard->next) {
+        pthread_mutex_lock(&shard->mutex);
+        if (shard->used > 0) {
+            arenas[taken].data = shard->data;
+            arenas[taken].used = shard->used;
+            taken++;
+            published += shard->published;
+            shard->data = NULL;     // Reallocated at the capacity it reached
+            shard->used = 0;
+            shard->published = 0;
+        }
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    pthread_mutex_unlock(&store->mutex);
+
+    __atomic_sub_fetch(&store->pending, published, __ATOMIC_RELAXED);
+    *count = taken;
+    return arenas;
+}
+
+// Rows by time; equal times keep the order they were appended in
+static int compare_rows(const void* a, const void* b) {
+    const segment_row_t* left = (const segment_row_t*)a;
+    const segment_row_t* right = (const segment_row_t*)b;
+    if (left->timestamp != right->timestamp) {
+        return left->timestamp < right->timestamp ? -1 : 1;
+    }
+    uintptr_t left_line = (uintptr_t)left->line;
+    uintptr_t right_line = (uintptr_t)right->line;
+    return left_line < right_line ? -1 : (left_line > right_line ? 1 : 0);
+}
+
+// Write the rows of one partition as a new segment
+static int write_segment(log_store_t* store, const segment_row_t* rows, size_t count,
+                         int64_t start) {
+    char partition[32];
+    partition_name(start, partition, sizeof(partition));
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", store->dir, partition);
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    log_store_segment_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id = log_store_next_id(store);
+    entry.min_time = rows[0].timestamp;
+    entry.max_time = rows[count - 1].timestamp;
+    entry.partition = start;
+    entry.rows = count;
+    snprintf(entry.name, sizeof(entry.name), "%s/%010llu.seg", partition,
+             (unsigned long long)entry.id);
+    snprintf(path, sizeof(path), "%s/%s", store->dir, entry.name);
+    if (segment_write(path, entry.id, rows, count, &entry.bytes) != 0) {
+        return -1;
+    }
+
+    uint64_t raw_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        raw_bytes += rows[i].line_len;
+    }
+    metrics_add(store->rows, count);
+    metrics_add(store->raw_bytes, raw_bytes);
+    metrics_add(store->bytes, entry.bytes);
+    metrics_add(store->segments_written, 1);
+
+    pthread_mutex_lock(&store->mutex);
+    int result = add_segment(store, &entry);
+    pthread_mutex_unlock(&store->mutex);
+    return result;
+}
+
+int log_store_flush(log_store_t* store) {
+    if (!store) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->flush_mutex);
+    size_t num_arenas = 0;
+    arena_t* arenas = take_memtables(store, &num_arenas);
+    if (!arenas) {
+        pthread_mutex_unlock(&store->flush_mutex);
+        return -1;
+    }
+
+    size_t count = 0;
+    for (size_t a = 0; a < num_arenas; a++) {
+        for (size_t offset = 0; offset < arenas[a].used; count++) {
+            const row_header_t* header = (const row_header_t*)(arenas[a].data + offset);
+            offset += row_size(header->source_len, header->line_len);
+        }
+    }
+
+    int result = 0;
+    segment_row_t* rows = count > 0 ? (segment_row_t*)malloc(count * sizeof(segment_row_t)) : NULL;
+    if (count > 0 && !rows) {
+        metrics_add(store->dropped, count);
+        result = -1;
+    } else if (count > 0) {
+        size_t row = 0;
+        for (size_t a = 0; a < num_arenas; a++) {
+            for (size_t offset = 0; offset < arenas[a].used; row++) {
+                const char* data = arenas[a].data + offset;
+                const row_header_t* header = (const row_header_t*)data;
+                rows[row].timestamp = header->timestamp;
+                rows[row].source = data + sizeof(row_header_t);
+                rows[row].source_len = header->source_len;
+                rows[row].line = rows[row].source + header->source_len;
+                rows[row].line_len = header->line_len;
+                rows[row].level = (log_level_t)header->level;
+                offset += row_size(header->source_len, header->line_len);
+            }
+        }
+        qsort(rows, count, sizeof(segment_row_t), compare_rows);
+
+        // One segment per partition
+        size_t first = 0;
+        while (first < count) {
+            int64_t start = partition_start(store, rows[first].timestamp);
+            size_t end = first + 1;
+            while (end < count && rows[end].timestamp < start + store->partition) {
+                end++;
+            }
+            if (write_segment(store, rows + first, end - first, start) != 0) {
+                fprintf(stderr, "Failed to write a segment to %s\n", store->dir);
+                metrics_add(store->errors, 1);
+                metrics_add(store->dropped, end - first);
+                result = -1;
+            }
+            first = end;
+        }
+        metrics_add(store->flushes, 1);
+    }
+
+    free(rows);
+    for (size_t a = 0; a < num_arenas; a++) {
+        free(arenas[a].data);
+    }
+    free(arenas);
+    metrics_set(store->memtable, __atomic_load_n(&store->pending, __ATOMIC_RELAXED));
+    pthread_mutex_unlock(&store->flush_mutex);
+    return result;
+}
+
+size_t log_store_segments(log_store_t* store, log_store_segment_t* segments, size_t max) {
+    if (!store) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&store->mutex);
+    size_t count = store->num_segments;
+    if (segments && count > 0 && max > 0) {
+        memcpy(segments, store->segments,
+               (count < max ? count : max) * sizeof(log_store_segment_t));
+    }
+    pthread_mutex_unlock(&store->mutex);
+    return count;
+}
+
+uint64_t log_store_next_id(log_store_t* store) {
+    return store ? __atomic_fetch_add(&store->next_id, 1, __ATOMIC_RELAXED) : 0;
+}
+
+int log_store_replace(log_store_t* store, const uint64_t* removed, size_t num_removed,
+                      const log_store_segment_t* added) {
+    if (!store || (num_removed > 0 && !removed)) {
+        return -1;
+    }
+    char (*names)[LOG_STORE_NAME_MAX] =
+        (char (*)[LOG_STORE_NAME_MAX])calloc(num_removed + 1, LOG_STORE_NAME_MAX);
+    if (!names) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->mutex);
+    if (added && add_segment(store, added) != 0) {
+        pthread_mutex_unlock(&store->mutex);
+        free(names);
+        return -1;
+    }
+    size_t found = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < store->num_segments; i++) {
+        bool remove = false;
+        for (size_t r = 0; r < num_removed && !remove; r++) {
+            remove = store->segments[i].id == removed[r];
+        }
+        if (remove) {
+            memcpy(names[found++], store->segments[i].name, LOG_STORE_NAME_MAX);
+        } else {
+            store->segments[kept++] = store->segments[i];
+        }
+    }
+    store->num_segments = kept;
+    qsort(store->segments, store->num_segments, sizeof(log_store_segment_t), compare_segments);
+    pthread_mutex_unlock(&store->mutex);
+
+    // Readers that opened a file keep their mapping. Empty partitions go
+    // too, but not while a flush may be about to write into one
+    pthread_mutex_lock(&store->flush_mutex);
+    for (size_t i = 0; i < found; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", store->dir, names[i]);
+        unlink(path);
+        char* slash = strrchr(path, '/');
+        *slash = '\0';
+        rmdir(path);
+    }
+    pthread_mutex_unlock(&store->flush_mutex);
+    free(names);
+    return 0;
+}
+
+// Report one segment's matches; false once fn asks to stop
+static bool search_segment(log_store_t* store, segment_t* segment, const char* text,
+                           size_t length, const uint64_t* hashes, size_t num_hashes,
+                           log_store_match_fn fn, void* ctx, size_t* matches) {
+    if (num_hashes > 0 && !segment_may_contain(segment, hashes, num_hashes)) {
+        metrics_add(store->search_skipped, 1);
+        return true;
+    }
+
+    // Without usable tokens (or an index) every row is a candidate
+    uint32_t* rows = NULL;
+    size_t num_rows = segment->num_rows;
+    bool indexed = num_hashes > 0 && segment_find(segment, hashes, num_hashes, &rows,
+                                                  &num_rows) == 0;
+    if (!indexed) {
+        num_rows = segment->num_rows;
+    }
+    metrics_add(store->search_scanned, num_rows);
+
+    bool more = true;
+    for (size_t i = 0; i < num_rows && more; i++) {
+        size_t row = indexed ? rows[i] : i;
+        size_t line_len;
+        const char* line = segment_line(segment, row, &line_len);
+        if (line && token_index_match(line, line_len, text, length)) {
+            (*matches)++;
+            more = fn(ctx, segment, row);
+        }
+    }
+    free(rows);
+    return more;
+}
+
+size_t log_store_search(log_store_t* store, const char* text, size_t length,
+                        log_store_match_fn fn, void* ctx) {
+    if (!store || !text || length == 0 || !fn) {
+        return 0;
+    }
+    metrics_add(store->searches, 1);
+
+    // Search a snapshot of the catalogue, so flushes are not held up
+    pthread_mutex_lock(&store->mutex);
+    size_t count = store->num_segments;
+    log_store_segment_t* segments =
+        (log_store_segment_t*)malloc((count + 1) * sizeof(log_store_segment_t));
+    if (segments) {
+        memcpy(segments, store->segments, count * sizeof(log_store_segment_t));
+    }
+    pthread_mutex_unlock(&store->mutex);
+    if (!segments) {
+        return 0;
+    }
+
+    uint64_t hashes[TOKEN_INDEX_MAX_QUERY];
+    size_t num_hashes = token_index_tokens(text, length, hashes, TOKEN_INDEX_MAX_QUERY);
+    size_t matches = 0;
+    bool more = true;
+    for (size_t i = 0; i < count && more; i++) {
+        char path[PATH_MAX];
+        segment_t segment;
+        if (snprintf(path, sizeof(path), "%s/%s", store->dir, segments[i].name) >=
+                (int)sizeof(path) ||
+            segment_open(&segment, path) != 0) {
+            metrics_add(store->errors, 1);
+            continue;
+        }
+        more = search_segment(store, &segment, text, length, hashes, num_hashes, fn, ctx,
+                              &matches);
+        segment_close(&segment);
+    }
+    free(segments);
+    return matches;
+}
\ No newline at end of file
@@ -9,8 +9,14 @@
 #include "config.h"
 #include "queue.h"
 #include "log_source.h"
+#include "line_parser.h"
 #include "processor.h"
+#include "ingest.h"
 #include "alerter.h"
+#include "metrics.h"
+#include "query.h"
+#include "query_server.h"
+#include "compactor.h"
 
 // Global flag for graceful shutdown
 static volatile bool g_running = true;
@@ -21,9 +27,74 @@ static void signal_handler(int sig) {
     g_running = false;
 }
 
+// `log_aggregator query [-c config] key=value...`: ask the running
+// aggregator over its query socket, or read the store directory directly
+static int run_query(int argc, char* argv[]) {
+    const char* config_file = "config.txt";
+    if (argc >= 2 && strcmp(argv[0], "-c") == 0) {
+        config_file = argv[1];
+        argc -= 2;
+        argv += 2;
+    }
+
+    config_t config;
+    if (config_load(&config, config_file) != 0) {
+        fprintf(stderr, "Failed to load configuration\n");
+        return 1;
+    }
+    query_t query;
+    query_init(&query);
+    for (int i = 0; i < argc; i++) {
+        if (query_parse_term(&query, argv[i]) != 0 || strchr(argv[i], '\n')) {
+            fprintf(stderr, "Invalid query term: %s\n", argv[i]);
+            query_destroy(&query);
+            config_destroy(&config);
+            return 1;
+        }
+    }
+
+    int status = -1;
+    if (config.query_socket) {
+        status = query_server_request(config.query_socket, argv, (size_t)argc, stdout);
+    }
+    if (status < 0 && !config.store_dir) {
+        fprintf(stderr, "No running aggregator and no store_dir configured\n");
+    } else if (status < 0) {
+        // Nothing listening: scan the segments in this process
+        log_store_t store;
+        query_engine_t engine;
+        query_result_t result;
+        if (log_store_open(&store, config.store_dir) != 0) {
+            fprintf(stderr, "Failed to open store %s\n", config.store_dir);
+        } else {
+            // One query per process: nothing to cache for
+            if (query_engine_init(&engine, &store, (size_t)config.query_threads, 0) != 0) {
+                fprintf(stderr, "Failed to start query threads\n");
+            } else {
+                if (query_run(&engine, &query, &result) != 0) {
+                    fprintf(stderr, "Query failed\n");
+                } else {
+                    status = query_write(&query, &result, stdout);
+                    query_result_destroy(&result);
+                }
+                query_engine_destroy(&engine);
+            }
+            log_store_destroy(&store);
+        }
+    }
+
+    query_destroy(&query);
+    config_destroy(&config);
+    return status == 0 ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     const char* config_file = "config.txt";
     
+    if (argc > 1 && strcmp(argv[1], "query") == 0) {
+        return run_query(argc - 2, argv + 2);
+    }
+    
     // Parse command line arguments
     if (argc > 1) {
         config_file = argv[1];
@@ -39,12 +110,21 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Shared line parser for every source
+    line_parser_t line_parser;
+    if (line_parser_init(&line_parser, &config) != 0) {
+        fprintf(stderr, "Failed to initialize line parser\n");
+        config_destroy(&config);
+        return 1;
+    }
+    
     // Initialize queues
     log_queue_t input_queue;
     log_queue_t alert_queue;
     
     if (queue_init(&input_queue, config.queue_max_size) != 0) {
         fprintf(stderr, "Failed to initialize input queue\n");
+        line_parser_destroy(&line_parser);
         config_destroy(&config);
         return 1;
     }
@@ -52,25 +132,53 @@ int main(int argc, char* argv[]) {
     if (queue_init(&alert_queue, config.queue_max_size) != 0) {
         fprintf(stderr, "Failed to initialize alert queue\n");
         queue_destroy(&input_queue);
+        line_parser_destroy(&line_parser);
+        config_destroy(&config);
+        return 1;
+    }
+    
+    // Initialize processor (before the sources, which submit to it)
+    processor_t processor;
+    if (processor_init(&processor, &input_queue, &alert_queue, &config) != 0) {
+        fprintf(stderr, "Failed to initialize processor\n");
+        queue_destroy(&alert_queue);
+        queue_destroy(&input_queue);
+        line_parser_destroy(&line_parser);
+        config_destroy(&config);
+        return 1;
+    }
+    
+    if (processor_start(&processor) != 0) {
+        fprintf(stderr, "Failed to start processor\n");
+        processor_destroy(&processor);
+        queue_destroy(&alert_queue);
+        queue_destroy(&input_queue);
+        line_parser_destroy(&line_parser);
         config_destroy(&config);
         return 1;
     }
     
+    ingest_t ingest;
+    processor_ingest(&processor, &ingest);
+    
     // Initialize file monitors
     file_monitor_t* monitors = NULL;
     if (config.num_directories > 0) {
         monitors = (file_monitor_t*)calloc(config.num_directories, sizeof(file_monitor_t));
         if (!monitors) {
             fprintf(stderr, "Failed to allocate memory for monitors\n");
+            processor_destroy(&processor);
             queue_destroy(&alert_queue);
             queue_destroy(&input_queue);
+            line_parser_destroy(&line_parser);
             config_destroy(&config);
             return 1;
         }
         
         for (size_t i = 0; i < config.num_directories; i++) {
             if (file_monitor_init(&monitors[i], config.watch_directories[i],
-                                 config.poll_interval_seconds, &input_queue) != 0) {
+                                 config.poll_interval_seconds, &ingest,
+                                 &line_parser) != 0) {
                 fprintf(stderr, "Failed to initialize monitor for %s\n", 
                        config.watch_directories[i]);
                 // Cleanup already initialized monitors
@@ -78,8 +186,10 @@ int main(int argc, char* argv[]) {
                     file_monitor_destroy(&monitors[j]);
                 }
                 free(monitors);
+                processor_destroy(&processor);
                 queue_destroy(&alert_queue);
                 queue_destroy(&input_queue);
+                line_parser_destroy(&line_parser);
                 config_destroy(&config);
                 return 1;
             }
@@ -93,8 +203,10 @@ int main(int argc, char* argv[]) {
                     file_monitor_destroy(&monitors[j]);
                 }
                 free(monitors);
+                processor_destroy(&processor);
                 queue_destroy(&alert_queue);
                 queue_destroy(&input_queue);
+                line_parser_destroy(&line_parser);
                 config_destroy(&config);
                 return 1;
             }
@@ -106,7 +218,8 @@ int main(int argc, char* argv[]) {
     // Initialize network server
     network_server_t network_server;
     if (config.enable_network) {
-        if (network_server_init(&network_server, config.network_port, &input_queue) != 0) {
+        if (network_server_init(&network_server, config.network_port, &ingest,
+                                &line_parser) != 0) {
             fprintf(stderr, "Failed to initialize network server\n");
             // Cleanup
             if (monitors) {
@@ -116,8 +229,10 @@ int main(int argc, char* argv[]) {
                 }
                 free(monitors);
             }
+            processor_destroy(&processor);
             queue_destroy(&alert_queue);
             queue_destroy(&input_queue);
+            line_parser_destroy(&line_parser);
             config_destroy(&config);
             return 1;
         }
@@ -132,61 +247,20 @@ int main(int argc, char* argv[]) {
                 }
                 free(monitors);
             }
+            processor_destroy(&processor);
             queue_destroy(&alert_queue);
             queue_destroy(&input_queue);
+            line_parser_destroy(&line_parser);
             config_destroy(&config);
             return 1;
         }
     }
     
-    // Initialize processor
-    processor_t processor;
-    if (processor_init(&processor, &input_queue, &alert_queue, &config) != 0) {
-        fprintf(stderr, "Failed to initialize processor\n");
-        // Cleanup
-        if (config.enable_network) {
-            network_server_stop(&network_server);
-            network_server_destroy(&network_server);
-        }
-        if (monitors) {
-            for (size_t i = 0; i < config.num_directories; i++) {
-                file_monitor_stop(&monitors[i]);
-                file_monitor_destroy(&monitors[i]);
-            }
-            free(monitors);
-        }
-        queue_destroy(&alert_queue);
-        queue_destroy(&input_queue);
-        config_destroy(&config);
-        return 1;
-    }
-    
-    if (processor_start(&processor) != 0) {
-        fprintf(stderr, "Failed to start processor\n");
-        processor_destroy(&processor);
-        if (config.enable_network) {
-            network_server_stop(&network_server);
-            network_server_destroy(&network_server);
-        }
-        if (monitors) {
-            for (size_t i = 0; i < config.num_directories; i++) {
-                file_monitor_stop(&monitors[i]);
-                file_monitor_destroy(&monitors[i]);
-            }
-            free(monitors);
-        }
-        queue_destroy(&alert_queue);
-        queue_destroy(&input_queue);
-        config_destroy(&config);
-        return 1;
-    }
-    
     // Initialize alerter
     alerter_t alerter;
     if (alerter_init(&alerter, &alert_queue, &config) != 0) {
         fprintf(stderr, "Failed to initialize alerter\n");
         processor_stop(&processor);
-        processor_destroy(&processor);
         if (config.enable_network) {
             network_server_stop(&network_server);
             network_server_destroy(&network_server);
@@ -198,8 +272,10 @@ int main(int argc, char* argv[]) {
             }
             free(monitors);
         }
+        processor_destroy(&processor);
         queue_destroy(&alert_queue);
         queue_destroy(&input_queue);
+        line_parser_destroy(&line_parser);
         config_destroy(&config);
         return 1;
     }
@@ -208,7 +284,6 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Failed to start alerter\n");
         alerter_destroy(&alerter);
         processor_stop(&processor);
-        processor_destroy(&processor);
         if (config.enable_network) {
             network_server_stop(&network_server);
             network_server_destroy(&network_server);
@@ -220,21 +295,62 @@ int main(int argc, char* argv[]) {
             }
             free(monitors);
         }
+        processor_destroy(&processor);
         queue_destroy(&alert_queue);
         queue_destroy(&input_queue);
+        line_parser_destroy(&line_parser);
         config_destroy(&config);
         return 1;
     }
     
+    // Query endpoint over the stored lines; ingestion goes on without it
+    query_engine_t query_engine;
+    query_server_t query_server;
+    bool querying = false;
+    if (config.query_socket && processor.store) {
+        if (query_engine_init(&query_engine, processor.store,
+                              (size_t)config.query_threads, config.query_cache_size) != 0) {
+            fprintf(stderr, "Failed to start query threads\n");
+        } else if (query_server_init(&query_server, config.query_socket, &query_engine) != 0 ||
+                   query_server_start(&query_server) != 0) {
+            fprintf(stderr, "Failed to start query socket %s\n", config.query_socket);
+            query_server_destroy(&query_server);
+            query_engine_destroy(&query_engine);
+        } else {
+            querying = true;
+            printf("Answering queries on %s\n", config.query_socket);
+        }
+    }
+    
+    // Background compaction and retention of the stored segments
+    compactor_t compactor;
+    bool compacting = false;
+    if (processor.store && (config.store_compact_size > 0 || config.num_retention_rules > 0)) {
+        if (compactor_init(&compactor, processor.store, &config) != 0) {
+            fprintf(stderr, "Failed to start store compaction\n");
+        } else if (compactor_start(&compactor) != 0) {
+            fprintf(stderr, "Failed to start store compaction\n");
+            compactor_destroy(&compactor);
+        } else {
+            compacting = true;
+        }
+    }
+    
     printf("Log Aggregator running. Press Ctrl+C to stop.\n");
     
     // Set up signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
-    // Main loop - wait for shutdown signal
+    // Main loop - wait for shutdown signal, dumping metrics periodically
+    int seconds_since_dump = 0;
     while (g_running) {
         sleep(1);
+        
+        if (config.metrics_file && ++seconds_since_dump >= config.metrics_interval_seconds) {
+            metrics_write_file(config.metrics_file);
+            seconds_since_dump = 0;
+        }
     }
     
     printf("\nShutting down...\n");
@@ -244,6 +360,13 @@ int main(int argc, char* argv[]) {
     queue_shutdown(&alert_queue);
     
     // Stop components (this sets running flags to false and waits for threads)
+    if (querying) {
+        query_server_destroy(&query_server);
+        query_engine_destroy(&query_engine);
+    }
+    if (compacting) {
+        compactor_destroy(&compactor);
+    }
     alerter_stop(&alerter);
     processor_stop(&processor);
     
@@ -257,6 +380,21 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Final metrics snapshot while every component is still registered
+    if (config.metrics_file) {
+        metrics_write_file(config.metrics_file);
+    }
+    
+    if (processor.rule_cache) {
+        rule_cache_stats_t cache_stats;
+        rule_cache_get_stats(processor.rule_cache, &cache_stats);
+        uint64_t lookups = cache_stats.hits + cache_stats.misses;
+        printf("Rule cache: %llu lookups, %.1f%% hit rate, %llu evictions\n",
+               (unsigned long long)lookups,
+               lookups ? 100.0 * (double)cache_stats.hits / (double)lookups : 0.0,
+               (unsigned long long)cache_stats.evictions);
+    }
+    
     // Now destroy queues (cleanup remaining entries and resources)
     queue_destroy(&alert_queue);
     queue_destroy(&input_queue);
@@ -276,6 +414,7 @@ int main(int argc, char* argv[]) {
         free(monitors);
     }
     
+    line_parser_destroy(&line_parser);
     config_destroy(&config);
     
     printf("Shutdown complete.\n");
@@ -0,0 +1,155 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+static metric_t g_metrics[METRICS_MAX];
+static size_t g_num_metrics = 0;
+static pthread_mutex_t g_metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    metrics_collector_fn fn;
+    void* ctx;
+} metrics_collector_t;
+
+static metrics_collector_t g_collectors[METRICS_MAX_COLLECTORS];
+static size_t g_num_collectors = 0;
+static pthread_mutex_t g_collectors_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+metric_t* metrics_register(const char* name, metric_type_t type) {
+    if (!name) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_metrics_mutex);
+
+    // Registration is rare, a linear scan keeps the registry simple
+    for (size_t i = 0; i < g_num_metrics; i++) {
+        if (strcmp(g_metrics[i].name, name) == 0) {
+            pthread_mutex_unlock(&g_metrics_mutex);
+            return &g_metrics[i];
+        }
+    }
+
+    if (g_num_metrics >= METRICS_MAX) {
+        pthread_mutex_unlock(&g_metrics_mutex);
+        return NULL;
+    }
+
+    metric_t* metric = &g_metrics[g_num_metrics];
+    snprintf(metric->name, sizeof(metric->name), "%s", name);
+    metric->type = type;
+    metric->value = 0;
+
+    // Publish only after the slot is fully written
+    __atomic_store_n(&g_num_metrics, g_num_metrics + 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&g_metrics_mutex);
+    return metric;
+}
+
+void metrics_add(metric_t* metric, uint64_t delta) {
+    if (!metric) {
+        return;
+    }
+
+    __atomic_fetch_add(&metric->value, delta, __ATOMIC_RELAXED);
+}
+
+void metrics_set(metric_t* metric, uint64_t value) {
+    if (!metric) {
+        return;
+    }
+
+    __atomic_store_n(&metric->value, value, __ATOMIC_RELAXED);
+}
+
+uint64_t metrics_get(const metric_t* metric) {
+    if (!metric) {
+        return 0;
+    }
+
+    return __atomic_load_n(&metric->value, __ATOMIC_RELAXED);
+}
+
+int metrics_add_collector(metrics_collector_fn fn, void* ctx) {
+    if (!fn) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_collectors_mutex);
+    if (g_num_collectors >= METRICS_MAX_COLLECTORS) {
+        pthread_mutex_unlock(&g_collectors_mutex);
+        return -1;
+    }
+    g_collectors[g_num_collectors].fn = fn;
+    g_collectors[g_num_collectors].ctx = ctx;
+    g_num_collectors++;
+    pthread_mutex_unlock(&g_collectors_mutex);
+
+    return 0;
+}
+
+void metrics_remove_collector(metrics_collector_fn fn, void* ctx) {
+    pthread_mutex_lock(&g_collectors_mutex);
+    for (size_t i = 0; i < g_num_collectors; i++) {
+        if (g_collectors[i].fn == fn && g_collectors[i].ctx == ctx) {
+            g_collectors[i] = g_collectors[--g_num_collectors];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_collectors_mutex);
+}
+
+void metrics_collect(void) {
+    // Collectors run under the lock so that removal waits for a running dump
+    pthread_mutex_lock(&g_collectors_mutex);
+    for (size_t i = 0; i < g_num_collectors; i++) {
+        g_collectors[i].fn(g_collectors[i].ctx);
+    }
+    pthread_mutex_unlock(&g_collectors_mutex);
+}
+
+void metrics_write(FILE* out) {
+    if (!out) {
+        return;
+    }
+
+    metrics_collect();
+
+    size_t count = __atomic_load_n(&g_num_metrics, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%s %llu\n", g_metrics[i].name,
+                (unsigned long long)metrics_get(&g_metrics[i]));
+    }
+}
+
+int metrics_write_file(const char* path) {
+    if (!path) {
+        return -1;
+    }
+
+    // Write to a temporary file and rename so readers never see a partial dump
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* file = fopen(tmp_path, "w");
+    if (!file) {
+        return -1;
+    }
+
+    metrics_write(file);
+
+    if (fclose(file) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -1,6 +1,20 @@
 #include "processor.h"
 #include "log_entry.h"
 #include "queue.h"
+#include "rule_cache.h"
+#include "field_rule.h"
+#include "hash.h"
+#include "work_pool.h"
+#include "shard_pool.h"
+#include "autoscaler.h"
+#include "rate_tracker.h"
+#include "correlator.h"
+#include "stream_stats.h"
+#include "template_miner.h"
+#include "context_ring.h"
+#include "log_store.h"
+#include "timestamp.h"
+#include "ingest.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +24,25 @@
 // Forward declaration for thread function
 static void* processor_thread_func(void* arg);
 
+static void raise_rate_alert(void* ctx, const rate_rule_t* rule, log_entry_t* entry,
+                             uint64_t count);
+static void raise_sequence_alert(void* ctx, const sequence_rule_t* rule, const char* source,
+                                 log_level_t level, int64_t elapsed);
+static void release_alert(void* ctx, log_entry_t* entry);
+
+// Steal mode thread bounds; unset bounds default to num_processing_threads
+static void thread_bounds(const processor_t* processor, size_t* min, size_t* max,
+                          size_t* initial) {
+    const config_t* config = processor->config;
+    size_t threads = processor->num_threads > 0 ? (size_t)processor->num_threads : 1;
+    *min = config->min_processing_threads > 0 ? (size_t)config->min_processing_threads : threads;
+    *max = config->max_processing_threads > 0 ? (size_t)config->max_processing_threads : threads;
+    if (*max < *min) {
+        *max = *min;
+    }
+    *initial = threads < *min ? *min : (threads > *max ? *max : threads);
+}
+
 int processor_init(processor_t* processor, log_queue_t* input_queue,
                    log_queue_t* output_queue, config_t* config) {
     if (!processor || !input_queue || !output_queue || !config) {
@@ -21,15 +54,285 @@ int processor_init(processor_t* processor, log_queue_t* input_queue,
     processor->config = config;
     processor->running = false;
     processor->num_threads = config->num_processing_threads;
+    processor->rule_cache = NULL;
+    processor->pool = NULL;
+    processor->shards = NULL;
+    processor->autoscaler = NULL;
+    processor->rates = NULL;
+    processor->correlator = NULL;
+    processor->templates = NULL;
+    processor->stats = NULL;
+    processor->context = NULL;
+    processor->store = NULL;
     
     processor->threads = (pthread_t*)calloc(processor->num_threads, sizeof(pthread_t));
     if (!processor->threads) {
         return -1;
     }
     
+    if (config->rule_cache_size > 0) {
+        processor->rule_cache = (rule_cache_t*)malloc(sizeof(rule_cache_t));
+        if (!processor->rule_cache ||
+            rule_cache_init(processor->rule_cache, config->rule_cache_size) != 0) {
+            free(processor->rule_cache);
+            processor->rule_cache = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
+    if (config->template_mining) {
+        processor->templates = (template_miner_t*)malloc(sizeof(template_miner_t));
+        if (!processor->templates ||
+            template_miner_init(processor->templates, config->template_capacity,
+                                (size_t)config->template_depth,
+                                config->template_similarity) != 0) {
+            free(processor->templates);
+            processor->templates = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+        if (config->template_file &&
+            template_miner_load(processor->templates, config->template_file) < 0) {
+            fprintf(stderr, "Failed to load templates from %s\n", config->template_file);
+        }
+    }
+    
+    if (config->sketches) {
+        processor->stats = (stream_stats_t*)malloc(sizeof(stream_stats_t));
+        if (!processor->stats || stream_stats_init(processor->stats, config) != 0) {
+            free(processor->stats);
+            processor->stats = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
+    if (config->alert_context_before > 0 || config->alert_context_after > 0) {
+        processor->context = (context_ring_t*)malloc(sizeof(context_ring_t));
+        if (!processor->context ||
+            context_ring_init(processor->context, config->alert_context_before,
+                              config->alert_context_after, config->alert_context_buffer,
+                              config->alert_context_memory, config->alert_context_wait_ms,
+                              release_alert, processor) != 0) {
+            free(processor->context);
+            processor->context = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
+    if (config->store_dir) {
+        processor->store = (log_store_t*)malloc(sizeof(log_store_t));
+        if (!processor->store || log_store_init(processor->store, config) != 0) {
+            free(processor->store);
+            processor->store = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
+    if (config->num_rate_rules > 0) {
+        processor->rates = (rate_tracker_t*)malloc(sizeof(rate_tracker_t));
+        if (!processor->rates ||
+            rate_tracker_init(processor->rates, config->rate_rules, config->num_rate_rules,
+                              config->alert_rate_capacity, raise_rate_alert, processor,
+                              timestamp_now()) != 0) {
+            free(processor->rates);
+            processor->rates = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
+    if (config->num_sequence_rules > 0) {
+        processor->correlator = (correlator_t*)malloc(sizeof(correlator_t));
+        if (!processor->correlator ||
+            correlator_init(processor->correlator, config->sequence_rules,
+                            config->num_sequence_rules, config->alert_sequence_capacity,
+                            raise_sequence_alert, processor, timestamp_now()) != 0) {
+            free(processor->correlator);
+            processor->correlator = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
+    if (config->processor_mode == PROCESSOR_MODE_STEAL) {
+        size_t min_threads, max_threads, initial_threads;
+        thread_bounds(processor, &min_threads, &max_threads, &initial_threads);
+        processor->pool = (work_pool_t*)malloc(sizeof(work_pool_t));
+        if (!processor->pool ||
+            work_pool_init(processor->pool, max_threads,
+                           config->queue_max_size, processor_handle_entry, processor) != 0) {
+            free(processor->pool);
+            processor->pool = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+        
+        if (max_threads > min_threads) {
+            processor->autoscaler = (autoscaler_t*)malloc(sizeof(autoscaler_t));
+            if (!processor->autoscaler ||
+                autoscaler_init(processor->autoscaler, processor->pool, min_threads, max_threads,
+                                (unsigned int)config->autoscale_interval_ms) != 0) {
+                free(processor->autoscaler);
+                processor->autoscaler = NULL;
+                processor_destroy(processor);
+                return -1;
+            }
+        }
+    } else if (config->processor_mode == PROCESSOR_MODE_SHARD) {
+        // The pending limit is split across the shards
+        size_t max_pending = config->queue_max_size / (size_t)processor->num_threads;
+        if (config->queue_max_size > 0 && max_pending == 0) {
+            max_pending = 1;
+        }
+        processor->shards = (shard_pool_t*)malloc(sizeof(shard_pool_t));
+        if (!processor->shards ||
+            shard_pool_init(processor->shards, (size_t)processor->num_threads, max_pending,
+                            config->shard_rebalance_interval, processor_handle_entry,
+                            processor) != 0) {
+            free(processor->shards);
+            processor->shards = NULL;
+            processor_destroy(processor);
+            return -1;
+        }
+    }
+    
     return 0;
 }
 
+// Rate alerts are new entries; the one that crossed the limit goes on
+// through the per-line rules as usual
+static void raise_rate_alert(void* ctx, const rate_rule_t* rule, log_entry_t* entry,
+                             uint64_t count) {
+    processor_t* processor = (processor_t*)ctx;
+    char message[640];
+    snprintf(message, sizeof(message), "Rate rule '%s' exceeded: %llu matching entries",
+             rule->text, (unsigned long long)count);
+    
+    log_level_t level = entry->level > LOG_LEVEL_WARNING ? entry->level : LOG_LEVEL_WARNING;
+    log_entry_t* alert = log_entry_create(entry->source, message, level, message);
+    if (!alert) {
+        return;
+    }
+    alert->rule_id = LOG_RULE_ID(LOG_RULE_RATE, rule - processor->config->rate_rules);
+    context_ring_attach(processor->context, alert);
+    if (queue_enqueue(processor->output_queue, alert) != 0) {
+        log_entry_destroy(alert);
+    }
+}
+
+// Sequence alerts are new entries as well; absence rules report the
+// source class, since no entry completed them
+static void raise_sequence_alert(void* ctx, const sequence_rule_t* rule, const char* source,
+                                 log_level_t level, int64_t elapsed) {
+    processor_t* processor = (processor_t*)ctx;
+    char message[640];
+    if (rule->absence) {
+        snprintf(message, sizeof(message),
+                 "Sequence rule '%s' matched: last step missing after %llds", rule->text,
+                 (long long)(elapsed / TIMESTAMP_NS_PER_SEC));
+    } else {
+        snprintf(message, sizeof(message), "Sequence rule '%s' matched in %.1fs", rule->text,
+                 (double)elapsed / TIMESTAMP_NS_PER_SEC);
+    }
+    
+    if (level < LOG_LEVEL_WARNING) {
+        level = LOG_LEVEL_WARNING;
+    }
+    log_entry_t* alert = log_entry_create(source, message, level, message);
+    if (!alert) {
+        return;
+    }
+    alert->rule_id = LOG_RULE_ID(LOG_RULE_SEQUENCE, rule - processor->config->sequence_rules);
+    context_ring_attach(processor->context, alert);
+    if (queue_enqueue(processor->output_queue, alert) != 0) {
+        log_entry_destroy(alert);
+    }
+}
+
+// Alerts held for their following lines, now complete
+static void release_alert(void* ctx, log_entry_t* entry) {
+    processor_t* processor = (processor_t*)ctx;
+    if (queue_enqueue(processor->output_queue, entry) != 0) {
+        log_entry_destroy(entry);
+    }
+}
+
+void processor_handle_entry(void* ctx, log_entry_t* entry) {
+    processor_t* processor = (processor_t*)ctx;
+    
+    // Recorded first, so alerts raised below include this line
+    uint64_t position = 0;
+    if (processor->context) {
+        position = context_ring_record(processor->context, entry);
+    }
+    
+    if (processor->store) {
+        log_store_append(processor->store, entry);
+    }
+    
+    if (processor->templates) {
+        template_miner_observe(processor->templates, entry);
+    }
+    
+    if (processor->stats) {
+        stream_stats_observe(processor->stats, entry);
+    }
+    
+    if (processor->rates) {
+        rate_tracker_observe(processor->rates, entry, timestamp_now());
+    }
+    
+    // Process the entry
+    bool should_alert = processor_evaluate(processor, entry);
+    
+    if (processor->correlator) {
+        correlator_observe(processor->correlator, entry, timestamp_now());
+    }
+    
+    // If it should be alerted, add to alert queue
+    if (should_alert && processor->output_queue) {
+        if (processor->context) {
+            context_ring_hold(processor->context, entry, position, timestamp_now());
+        } else if (queue_enqueue(processor->output_queue, entry) != 0) {
+            log_entry_destroy(entry); // Shutting down with a full alert queue
+        }
+    } else {
+        // Entry doesn't meet alert criteria, destroy it
+        log_entry_destroy(entry);
+    }
+}
+
+static int submit_to_shards(void* ctx, log_entry_t** entries, size_t count, uint64_t affinity) {
+    processor_t* processor = (processor_t*)ctx;
+    return shard_pool_submit(processor->shards, entries, count, affinity);
+}
+
+static int submit_to_pool(void* ctx, log_entry_t** entries, size_t count, uint64_t affinity) {
+    processor_t* processor = (processor_t*)ctx;
+    return work_pool_submit(processor->pool, entries, count,
+                            processor->config->processor_affinity ? affinity : WORK_POOL_ANY);
+}
+
+void processor_ingest(processor_t* processor, ingest_t* ingest) {
+    if (!processor || !ingest) {
+        return;
+    }
+    
+    if (processor->pool) {
+        ingest->submit = submit_to_pool;
+        ingest->ctx = processor;
+    } else if (processor->shards) {
+        ingest->submit = submit_to_shards;
+        ingest->ctx = processor;
+    } else {
+        ingest_init_queue(ingest, processor->input_queue);
+    }
+}
+
 static void* processor_thread_func(void* arg) {
     processor_t* processor = (processor_t*)arg;
     
@@ -44,21 +347,22 @@ static void* processor_thread_func(void* arg) {
             continue;
         }
         
-        // Process the entry
-        bool should_alert = processor_process_entry(entry, processor->config);
-        
-        // If it should be alerted, add to alert queue
-        if (should_alert && processor->output_queue) {
-            queue_enqueue(processor->output_queue, entry);
-        } else {
-            // Entry doesn't meet alert criteria, destroy it
-            log_entry_destroy(entry);
-        }
+        processor_handle_entry(processor, entry);
     }
     
     return NULL;
 }
 
+// Stop the background threads processor_start() starts before the
+// processing threads (each stop is a no-op if it never started)
+static void stop_background(processor_t* processor) {
+    log_store_stop(processor->store);
+    context_ring_stop(processor->context);
+    stream_stats_stop(processor->stats);
+    correlator_stop(processor->correlator);
+    processor->running = false;
+}
+
 int processor_start(processor_t* processor) {
     if (!processor || processor->running) {
         return -1;
@@ -66,6 +370,48 @@ int processor_start(processor_t* processor) {
     
     processor->running = true;
     
+    // Absence rules must fire without new input
+    if (processor->correlator && correlator_start(processor->correlator) != 0) {
+        processor->running = false;
+        return -1;
+    }
+    if (processor->stats && stream_stats_start(processor->stats) != 0) {
+        stop_background(processor);
+        return -1;
+    }
+    // Alerts whose following lines never come must still go out
+    if (processor->context && context_ring_start(processor->context) != 0) {
+        stop_background(processor);
+        return -1;
+    }
+    if (processor->store && log_store_start(processor->store) != 0) {
+        stop_background(processor);
+        return -1;
+    }
+    
+    if (processor->pool) {
+        size_t min_threads, max_threads, initial_threads;
+        thread_bounds(processor, &min_threads, &max_threads, &initial_threads);
+        if (work_pool_start(processor->pool, initial_threads) != 0) {
+            stop_background(processor);
+            return -1;
+        }
+        if (processor->autoscaler && autoscaler_start(processor->autoscaler) != 0) {
+            work_pool_stop(processor->pool);
+            stop_background(processor);
+            return -1;
+        }
+        return 0;
+    }
+    
+    if (processor->shards) {
+        if (shard_pool_start(processor->shards) != 0) {
+            stop_background(processor);
+            return -1;
+        }
+        return 0;
+    }
+    
     for (int i = 0; i < processor->num_threads; i++) {
         if (pthread_create(&processor->threads[i], NULL, processor_thread_func, processor) != 0) {
             processor->running = false;
@@ -73,6 +419,7 @@ int processor_start(processor_t* processor) {
             for (int j = 0; j < i; j++) {
                 pthread_join(processor->threads[j], NULL);
             }
+            stop_background(processor);
             return -1;
         }
     }
@@ -86,19 +433,35 @@ void processor_stop(processor_t* processor) {
     }
     
     processor->running = false;
+    correlator_stop(processor->correlator);
     
-    // Wake up threads waiting on queues by broadcasting
-    // The queue_destroy will handle waking them up, but we need to ensure
-    // threads exit their loops. They'll exit when running becomes false
-    // and queue_dequeue returns NULL (after queue is destroyed)
-    
-    // Wait for threads with a timeout approach - they should exit when
-    // queue operations fail or running is false
-    for (int i = 0; i < processor->num_threads; i++) {
-        if (processor->threads[i]) {
-            pthread_join(processor->threads[i], NULL);
+    if (processor->pool) {
+        // The controller goes first so it cannot restart workers
+        autoscaler_stop(processor->autoscaler);
+        work_pool_stop(processor->pool);
+    } else if (processor->shards) {
+        shard_pool_stop(processor->shards);
+    } else if (processor->threads) {
+        // Wake up threads waiting on queues by broadcasting
+        // The queue_destroy will handle waking them up, but we need to ensure
+        // threads exit their loops. They'll exit when running becomes false
+        // and queue_dequeue returns NULL (after queue is destroyed)
+        for (int i = 0; i < processor->num_threads; i++) {
+            if (processor->threads[i]) {
+                pthread_join(processor->threads[i], NULL);
+                processor->threads[i] = 0; // Joined, safe to stop again
+            }
         }
     }
+    
+    // Nothing is recorded any more; held alerts go out as they are
+    context_ring_stop(processor->context);
+    
+    // Every appended line goes out to a segment
+    log_store_stop(processor->store);
+    
+    // Last, so the final dump includes every processed entry
+    stream_stats_stop(processor->stats);
 }
 
 void processor_destroy(processor_t* processor) {
@@ -108,6 +471,118 @@ void processor_destroy(processor_t* processor) {
     
     processor_stop(processor);
     free(processor->threads);
+    processor->threads = NULL;
+    
+    if (processor->autoscaler) {
+        autoscaler_destroy(processor->autoscaler);
+        free(processor->autoscaler);
+        processor->autoscaler = NULL;
+    }
+    
+    if (processor->pool) {
+        work_pool_destroy(processor->pool);
+        free(processor->pool);
+        processor->pool = NULL;
+    }
+    
+    if (processor->shards) {
+        shard_pool_destroy(processor->shards);
+        free(processor->shards);
+        processor->shards = NULL;
+    }
+    
+    if (processor->rates) {
+        rate_tracker_destroy(processor->rates);
+        free(processor->rates);
+        processor->rates = NULL;
+    }
+    
+    if (processor->correlator) {
+        correlator_destroy(processor->correlator);
+        free(processor->correlator);
+        processor->correlator = NULL;
+    }
+    
+    if (processor->context) {
+        context_ring_destroy(processor->context);
+        free(processor->context);
+        processor->context = NULL;
+    }
+    
+    if (processor->store) {
+        log_store_destroy(processor->store);
+        free(processor->store);
+        processor->store = NULL;
+    }
+    
+    if (processor->stats) {
+        stream_stats_destroy(processor->stats);
+        free(processor->stats);
+        processor->stats = NULL;
+    }
+    
+    if (processor->templates) {
+        const char* path = processor->config ? processor->config->template_file : NULL;
+        if (path && template_miner_save(processor->templates, path) != 0) {
+            fprintf(stderr, "Failed to save templates to %s\n", path);
+        }
+        template_miner_destroy(processor->templates);
+        free(processor->templates);
+        processor->templates = NULL;
+    }
+    
+    if (processor->rule_cache) {
+        rule_cache_destroy(processor->rule_cache);
+        free(processor->rule_cache);
+        processor->rule_cache = NULL;
+    }
+}
+
+// Rule result; only alerts carry the matched patterns, for structured
+// alert output
+static bool evaluate_rules(log_entry_t* entry, config_t* config) {
+    bool should_alert = processor_process_entry(entry, config);
+    if (should_alert) {
+        entry->patterns = processor_match_patterns(entry, config);
+    }
+    return should_alert;
+}
+
+bool processor_evaluate(processor_t* processor, log_entry_t* entry) {
+    if (!processor || !entry) {
+        return false;
+    }
+    
+    config_t* config = processor->config;
+    
+    // The threshold check is cheaper than hashing, so it stays in front.
+    // Past it, field rules and pattern scans are what is worth memoizing
+    if (!processor->rule_cache || entry->level < config->alert_threshold ||
+        (config->num_field_rules == 0 && config->num_patterns == 0)) {
+        return evaluate_rules(entry, config);
+    }
+    
+    char key[RULE_CACHE_KEY_MAX];
+    size_t key_len = rule_cache_build_key(entry, key, sizeof(key));
+    if (key_len == 0) {
+        // Too large to memoize
+        return evaluate_rules(entry, config);
+    }
+    
+    uint64_t hash = hash64(key, key_len, 0);
+    rule_cache_value_t cached;
+    if (rule_cache_lookup(processor->rule_cache, key, key_len, hash, &cached)) {
+        entry->rule_id = (uint32_t)(cached.result >> 1);
+        entry->patterns = cached.patterns;
+        return (cached.result & 1) != 0;
+    }
+    
+    // The matching rule and patterns are cached with the result
+    bool should_alert = evaluate_rules(entry, config);
+    cached.result = should_alert ? ((uint64_t)entry->rule_id << 1) | 1 : 0;
+    cached.patterns = should_alert ? entry->patterns : 0;
+    rule_cache_insert(processor->rule_cache, key, key_len, hash, &cached);
+    return should_alert;
 }
 
 bool processor_process_entry(log_entry_t* entry, config_t* config) {
@@ -120,6 +595,18 @@ bool processor_process_entry(log_entry_t* entry, config_t* config) {
         return false;
     }
     
+    // Structured rules narrow alerts to entries whose fields match; fields
+    // are only extracted here, after the level check has dropped the rest
+    if (config->num_field_rules > 0) {
+        for (size_t i = 0; i < config->num_field_rules; i++) {
+            if (field_rule_matches(&config->field_rules[i], entry)) {
+                entry->rule_id = LOG_RULE_ID(LOG_RULE_FIELD, i);
+                return true;
+            }
+        }
+        return false;
+    }
+    
     // If level meets threshold, alert
     // Also check for pattern matches (patterns can trigger alerts even below threshold)
     if (processor_check_patterns(entry, config)) {
@@ -144,4 +631,20 @@ bool processor_check_patterns(log_entry_t* entry, config_t* config) {
     }
     
     return false;
+}
+
+uint64_t processor_match_patterns(const log_entry_t* entry, const config_t* config) {
+    if (!entry || !config || !config->alert_patterns) {
+        return 0;
+    }
+    
+    uint64_t patterns = 0;
+    for (size_t i = 0; i < config->num_patterns && i < 64; i++) {
+        if (config->alert_patterns[i] &&
+            (strstr(entry->message, config->alert_patterns[i]) != NULL ||
+             strstr(entry->raw_line, config->alert_patterns[i]) != NULL)) {
+            patterns |= 1ULL << i;
+        }
+    }
+    return patterns;
 }
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "pushdown.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char** copy_globs(char** globs, size_t count) {
+    char** copy = (char**)calloc(count, sizeof(char*));
+    if (!copy) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        copy[i] = strdup(globs[i]);
+        if (!copy[i]) {
+            for (size_t j = 0; j < i; j++) {
+                free(copy[j]);
+            }
+            free(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static bool matches_any(char** globs, size_t count, const char* source) {
+    for (size_t i = 0; i < count; i++) {
+        if (fnmatch(globs[i], source, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int add_literal(pushdown_t* pushdown, const char* field) {
+    bool seen = false;
+    for (size_t j = 0; j < pushdown->num_literals; j++) {
+        seen = seen || strcmp(pushdown->literals[j], field) == 0;
+    }
+    if (seen) {
+        return 0;
+    }
+    pushdown->literals[pushdown->num_literals] = strdup(field);
+    if (!pushdown->literals[pushdown->num_literals]) {
+        return -1;
+    }
+    pushdown->literal_lengths[pushdown->num_literals++] = strlen(field);
+    return 0;
+}
+
+// Selectors of every rate rule and sequence step
+static const log_selector_t** counting_selectors(const config_t* config, size_t* count) {
+    size_t max = config->num_rate_rules + config->num_sequence_rules * SEQUENCE_RULE_MAX_STEPS;
+    *count = 0;
+    if (max == 0) {
+        return NULL;
+    }
+
+    const log_selector_t** selectors = (const log_selector_t**)calloc(max, sizeof(log_selector_t*));
+    if (!selectors) {
+        return NULL;
+    }
+    for (size_t i = 0; i < config->num_rate_rules; i++) {
+        selectors[(*count)++] = &config->rate_rules[i].selector;
+    }
+    for (size_t i = 0; i < config->num_sequence_rules; i++) {
+        for (size_t j = 0; j < config->sequence_rules[i].num_steps; j++) {
+            selectors[(*count)++] = &config->sequence_rules[i].steps[j];
+        }
+    }
+    return selectors;
+}
+
+// One literal per distinct rule field; a line without any of them cannot
+// satisfy any rule. Rate and sequence selectors count too, and one
+// without a field can match any line, which disables the prefilter.
+static int init_literals(pushdown_t* pushdown, const config_t* config,
+                         const log_selector_t** selectors, size_t num_selectors) {
+    if (config->num_field_rules == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < num_selectors; i++) {
+        if (!selectors[i]->has_field) {
+            return 0;
+        }
+    }
+
+    size_t max_literals = config->num_field_rules + num_selectors;
+    pushdown->literals = (char**)calloc(max_literals, sizeof(char*));
+    pushdown->literal_lengths = (size_t*)calloc(max_literals, sizeof(size_t));
+    if (!pushdown->literals || !pushdown->literal_lengths) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < config->num_field_rules; i++) {
+        if (add_literal(pushdown, config->field_rules[i].field) != 0) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < num_selectors; i++) {
+        if (add_literal(pushdown, selectors[i]->field.field) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Rate and sequence rules count entries that never alert on their own
+static int init_selectors(pushdown_t* pushdown, const config_t* config) {
+    size_t num_selectors;
+    const log_selector_t** selectors = counting_selectors(config, &num_selectors);
+    if (!selectors && config->num_rate_rules + config->num_sequence_rules > 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < num_selectors; i++) {
+        if (selectors[i]->min_level < pushdown->min_level) {
+            pushdown->min_level = selectors[i]->min_level;
+        }
+    }
+    int result = init_literals(pushdown, config, selectors, num_selectors);
+    free((void*)selectors);
+    return result;
+}
+
+int pushdown_init(pushdown_t* pushdown, const config_t* config) {
+    if (!pushdown) {
+        return -1;
+    }
+
+    memset(pushdown, 0, sizeof(pushdown_t));
+    pushdown->min_level = LOG_LEVEL_DEBUG;
+
+    if (!config) {
+        return 0;
+    }
+
+    pushdown->min_level = config->alert_threshold;
+
+    if (config->num_source_includes > 0) {
+        pushdown->include_globs = copy_globs(config->source_include_globs,
+                                             config->num_source_includes);
+        if (!pushdown->include_globs) {
+            return -1;
+        }
+        pushdown->num_include = config->num_source_includes;
+    }
+    if (config->num_source_excludes > 0) {
+        pushdown->exclude_globs = copy_globs(config->source_exclude_globs,
+                                             config->num_source_excludes);
+        if (!pushdown->exclude_globs) {
+            pushdown_destroy(pushdown);
+            return -1;
+        }
+        pushdown->num_exclude = config->num_source_excludes;
+    }
+    if (config->sketches || config->template_mining || config->alert_context_before > 0 ||
+        config->alert_context_after > 0 || config->store_dir) {
+        // Stream statistics, template mining, alert context and the store
+        // need every line, not only alertable ones
+        pushdown->min_level = LOG_LEVEL_DEBUG;
+    } else if (init_selectors(pushdown, config) != 0) {
+        pushdown_destroy(pushdown);
+        return -1;
+    }
+
+    pushdown->level_dropped = metrics_register("pushdown.level_dropped", METRIC_COUNTER);
+    pushdown->source_dropped = metrics_register("pushdown.source_dropped", METRIC_COUNTER);
+    pushdown->literal_dropped = metrics_register("pushdown.literal_dropped", METRIC_COUNTER);
+    return 0;
+}
+
+void pushdown_destroy(pushdown_t* pushdown) {
+    if (!pushdown) {
+        return;
+    }
+
+    for (size_t i = 0; i < pushdown->num_include; i++) {
+        free(pushdown->include_globs[i]);
+    }
+    for (size_t i = 0; i < pushdown->num_exclude; i++) {
+        free(pushdown->exclude_globs[i]);
+    }
+    for (size_t i = 0; i < pushdown->num_literals; i++) {
+        free(pushdown->literals[i]);
+    }
+    free(pushdown->include_globs);
+    free(pushdown->exclude_globs);
+    free(pushdown->literals);
+    free(pushdown->literal_lengths);
+    memset(pushdown, 0, sizeof(pushdown_t));
+}
+
+void pushdown_source_init(const pushdown_t* pushdown, pushdown_source_t* state,
+                          const char* source, bool has_format) {
+    if (!state) {
+        return;
+    }
+
+    memset(state, 0, sizeof(pushdown_source_t));
+    state->pushdown = pushdown;
+    state->admitted = true;
+    if (!pushdown || !source) {
+        return;
+    }
+
+    if (pushdown->num_include > 0 && !matches_any(pushdown->include_globs,
+                                                  pushdown->num_include, source)) {
+        state->admitted = false;
+    }
+    if (matches_any(pushdown->exclude_globs, pushdown->num_exclude, source)) {
+        state->admitted = false;
+    }
+
+    // Assigned formats name fields after captures, not after text in the line
+    state->check_literals = pushdown->num_literals > 0 && !has_format;
+
+    // Network sources are counted per client, not per connection
+    char name[METRICS_NAME_MAX];
+    snprintf(name, sizeof(name), "source.%.*s.dropped",
+             (int)log_entry_source_class_len(source), source);
+    state->dropped = metrics_register(name, METRIC_COUNTER);
+}
+
+bool pushdown_admit_source(const pushdown_source_t* state) {
+    if (!state || state->admitted) {
+        return true;
+    }
+
+    metrics_add(state->pushdown->source_dropped, 1);
+    metrics_add(state->dropped, 1);
+    return false;
+}
+
+static bool contains_literal(const char* line, size_t length, const char* literal,
+                             size_t literal_len) {
+    if (literal_len == 0) {
+        return true;
+    }
+
+    const char* p = line;
+    const char* end = line + length;
+    while ((size_t)(end - p) >= literal_len) {
+        p = (const char*)memchr(p, literal[0], (size_t)(end - p) - literal_len + 1);
+        if (!p) {
+            return false;
+        }
+        if (memcmp(p, literal, literal_len) == 0) {
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
+
+bool pushdown_admit_line(const pushdown_source_t* state, const char* line, size_t length) {
+    if (!state || !state->check_literals) {
+        return true;
+    }
+
+    const pushdown_t* pushdown = state->pushdown;
+    for (size_t i = 0; i < pushdown->num_literals; i++) {
+        if (contains_literal(line, length, pushdown->literals[i], pushdown->literal_lengths[i])) {
+            return true;
+        }
+    }
+
+    metrics_add(pushdown->literal_dropped, 1);
+    metrics_add(state->dropped, 1);
+    return false;
+}
+
+bool pushdown_admit_level(const pushdown_source_t* state, log_level_t level) {
+    if (!state || !state->pushdown || level >= state->pushdown->min_level) {
+        return true;
+    }
+
+    metrics_add(state->pushdown->level_dropped, 1);
+    metrics_add(state->dropped, 1);
+    return false;
+}
\ No newline at end of file
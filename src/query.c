@@ -0,0 +1,1018 @@
+#include "query.h"
+#include "query_cache.h"
+#include "segment.h"
+#include "timestamp.h"
+#include "token_index.h"
+#include <fnmatch.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define QUERY_BLOCK 64
+#define ALL_LEVELS ((1u << (LOG_LEVEL_CRITICAL + 1)) - 1)
+#define NS_PER_MINUTE (60 * TIMESTAMP_NS_PER_SEC)
+
+// One query in progress; threads claim segments by index
+typedef struct query_job {
+    const query_t* query;
+    const char* dir;
+    log_store_segment_t* segments;
+    size_t num_segments;
+    query_result_t* results;    // One per segment
+    size_t next;                // Next segment to claim
+    size_t finished;
+    uint64_t hashes[TOKEN_INDEX_MAX_QUERY];
+    size_t num_hashes;
+    char* normalized;           // Cache key text (NULL: not cached)
+    size_t normalized_len;
+} query_job_t;
+
+// Minute of a segment with its count
+typedef struct {
+    int64_t minute;
+    uint64_t count;
+} minute_count_t;
+
+// State of one segment's scan
+typedef struct {
+    const query_t* query;
+    segment_t* segment;
+    query_result_t* result;
+    const int64_t* timestamps;  // NULL unless needed
+    bool needs_line;            // A text filter reads every candidate's line
+    bool failed;
+    char* buffer;               // NUL-terminated line for regexec()
+    size_t buffer_capacity;
+    size_t row_capacity;
+    uint64_t level_counts[LOG_LEVEL_CRITICAL + 1];
+    uint64_t* source_counts;    // Per source ID
+    minute_count_t* minutes;    // In time order
+    size_t num_minutes;
+    size_t minute_capacity;
+} scan_t;
+
+static void* query_thread_func(void* arg);
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * TIMESTAMP_NS_PER_SEC + ts.tv_nsec;
+}
+
+void query_init(query_t* query) {
+    if (!query) {
+        return;
+    }
+    memset(query, 0, sizeof(query_t));
+    query->from = INT64_MIN;
+    query->to = INT64_MAX;
+    query->limit = QUERY_DEFAULT_LIMIT;
+    query->mode = QUERY_LINES;
+}
+
+// Absolute timestamp, or "-<duration>" before now
+static int parse_time(const char* value, int64_t* ns) {
+    if (value[0] == '-') {
+        int64_t ago;
+        if (timestamp_parse_duration(value + 1, &ago) != 0) {
+            return -1;
+        }
+        *ns = timestamp_now() - ago;
+        return 0;
+    }
+    size_t length = strlen(value);
+    return length > 0 && timestamp_parse(value, length, true, ns) == length ? 0 : -1;
+}
+
+static int parse_levels(const char* value, uint32_t* levels) {
+    uint32_t mask = 0;
+    const char* p = value;
+    while (*p) {
+        const char* comma = strchr(p, ',');
+        size_t length = comma ? (size_t)(comma - p) : strlen(p);
+        log_level_t level = log_entry_parse_level_len(p, length);
+        // Unknown names parse as INFO
+        if (length == 0 || (level == LOG_LEVEL_INFO && strncasecmp(p, "info", 4) != 0)) {
+            return -1;
+        }
+        mask |= 1u << level;
+        p += comma ? length + 1 : length;
+    }
+    if (mask == 0) {
+        return -1;
+    }
+    *levels = mask;
+    return 0;
+}
+
+static int set_string(char** field, const char* value) {
+    if (value[0] == '\0') {
+        return -1;
+    }
+    char* copy = strdup(value);
+    if (!copy) {
+        return -1;
+    }
+    free(*field);
+    *field = copy;
+    return 0;
+}
+
+int query_set(query_t* query, const char* key, const char* value) {
+    if (!query || !key || !value) {
+        return -1;
+    }
+
+    if (strcmp(key, "from") == 0) {
+        return parse_time(value, &query->from);
+    } else if (strcmp(key, "to") == 0) {
+        return parse_time(value, &query->to);
+    } else if (strcmp(key, "level") == 0) {
+        return parse_levels(value, &query->levels);
+    } else if (strcmp(key, "source") == 0) {
+        return set_string(&query->source, value);
+    } else if (strcmp(key, "contains") == 0) {
+        return set_string(&query->contains, value);
+    } else if (strcmp(key, "word") == 0) {
+        return set_string(&query->word, value);
+    } else if (strcmp(key, "regex") == 0) {
+        regex_t regex;
+        if (value[0] == '\0' || regcomp(&regex, value, REG_EXTENDED | REG_NOSUB) != 0) {
+            return -1;
+        }
+        if (query->pattern) {
+            regfree(&query->regex);
+        }
+        free(query->pattern);
+        query->pattern = strdup(value);
+        query->regex = regex;
+        if (!query->pattern) {
+            regfree(&query->regex);
+            return -1;
+        }
+        return 0;
+    } else if (strcmp(key, "limit") == 0) {
+        char* end;
+        unsigned long long limit = strtoull(value, &end, 10);
+        if (value[0] < '0' || value[0] > '9' || *end != '\0') {
+            return -1;
+        }
+        query->limit = (size_t)limit;
+        return 0;
+    } else if (strcmp(key, "count") == 0) {
+        static const char* const MODES[] = {"total", "level", "source", "minute"};
+        for (size_t i = 0; i < sizeof(MODES) / sizeof(MODES[0]); i++) {
+            if (strcmp(value, MODES[i]) == 0) {
+                query->mode = (query_mode_t)(QUERY_COUNT_TOTAL + i);
+                return 0;
+            }
+        }
+        return -1;
+    }
+    return -1;
+}
+
+int query_parse_term(query_t* query, const char* term) {
+    const char* equals = term ? strchr(term, '=') : NULL;
+    char key[32];
+    if (!equals || equals == term || (size_t)(equals - term) >= sizeof(key)) {
+        return -1;
+    }
+    memcpy(key, term, (size_t)(equals - term));
+    key[equals - term] = '\0';
+    return query_set(query, key, equals + 1);
+}
+
+void query_destroy(query_t* query) {
+    if (!query) {
+        return;
+    }
+    if (query->pattern) {
+        regfree(&query->regex);
+    }
+    free(query->pattern);
+    free(query->source);
+    free(query->contains);
+    free(query->word);
+    memset(query, 0, sizeof(query_t));
+}
+
+char* query_normalize(const query_t* query) {
+    if (!query) {
+        return NULL;
+    }
+
+    char* text = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&text, &size);
+    if (!out) {
+        return NULL;
+    }
+    // Every level is the same as none; the limit only bounds lines
+    uint32_t levels = (query->levels & ALL_LEVELS) == ALL_LEVELS ? 0 : query->levels;
+    fprintf(out, "mode=%d\nlimit=%zu\nlevel=%x\n", (int)query->mode,
+            query->mode == QUERY_LINES ? query->limit : (size_t)0, (unsigned)levels);
+    // Lengths first, so no value can pass for another's delimiter
+    const char* names[] = {"source", "contains", "word", "regex"};
+    const char* values[] = {query->source, query->contains, query->word, query->pattern};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (values[i]) {
+            fprintf(out, "%s=%zu:%s\n", names[i], strlen(values[i]), values[i]);
+        }
+    }
+    if (fclose(out) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+int query_result_copy(query_result_t* dest, const query_result_t* src) {
+    if (!dest || !src) {
+        return -1;
+    }
+
+    *dest = *src;
+    dest->rows = (query_row_t*)malloc((src->num_rows + 1) * sizeof(query_row_t));
+    dest->buckets = (query_bucket_t*)malloc((src->num_buckets + 1) * sizeof(query_bucket_t));
+    dest->num_rows = 0;
+    dest->num_buckets = 0;
+    if (!dest->rows || !dest->buckets) {
+        query_result_destroy(dest);
+        return -1;
+    }
+    for (size_t i = 0; i < src->num_rows; i++) {
+        query_row_t* row = &dest->rows[i];
+        *row = src->rows[i];
+        row->source = strdup(src->rows[i].source);
+        row->line = strdup(src->rows[i].line);
+        dest->num_rows++;
+        if (!row->source || !row->line) {
+            query_result_destroy(dest);
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < src->num_buckets; i++) {
+        dest->buckets[i].count = src->buckets[i].count;
+        dest->buckets[i].key = strdup(src->buckets[i].key);
+        if (!dest->buckets[i].key) {
+            query_result_destroy(dest);
+            return -1;
+        }
+        dest->num_buckets++;
+    }
+    return 0;
+}
+
+void query_result_destroy(query_result_t* result) {
+    if (!result) {
+        return;
+    }
+    for (size_t i = 0; i < result->num_rows; i++) {
+        free(result->rows[i].source);
+        free(result->rows[i].line);
+    }
+    for (size_t i = 0; i < result->num_buckets; i++) {
+        free(result->buckets[i].key);
+    }
+    free(result->rows);
+    free(result->buckets);
+    memset(result, 0, sizeof(query_result_t));
+}
+
+static void format_time(int64_t ns, char* out, size_t size, bool minute) {
+    int64_t seconds = ns / TIMESTAMP_NS_PER_SEC;
+    int64_t fraction = ns % TIMESTAMP_NS_PER_SEC;
+    if (fraction < 0) {
+        seconds--;
+        fraction += TIMESTAMP_NS_PER_SEC;
+    }
+    time_t t = (time_t)seconds;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    if (minute) {
+        strftime(out, size, "%Y-%m-%dT%H:%MZ", &tm);
+        return;
+    }
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(out, size, "%s.%03dZ", date, (int)(fraction / 1000000));
+}
+
+int query_write(const query_t* query, const query_result_t* result, FILE* out) {
+    if (!query || !result || !out) {
+        return -1;
+    }
+
+    char stamp[48];
+    if (query->mode == QUERY_LINES) {
+        for (size_t i = 0; i < result->num_rows; i++) {
+            const query_row_t* row = &result->rows[i];
+            format_time(row->timestamp, stamp, sizeof(stamp), false);
+            fprintf(out, "%s %s %s %s\n", stamp, log_entry_level_to_string(row->level),
+                    row->source, row->line);
+        }
+    } else if (query->mode == QUERY_COUNT_TOTAL) {
+        fprintf(out, "%llu\n", (unsigned long long)result->matched);
+    } else {
+        for (size_t i = 0; i < result->num_buckets; i++) {
+            fprintf(out, "%s\t%llu\n", result->buckets[i].key,
+                    (unsigned long long)result->buckets[i].count);
+        }
+    }
+    fprintf(out, "# %llu matched, %llu segments scanned, %llu skipped, %llu cached, "
+            "%llu lines read, %.1f ms\n",
+            (unsigned long long)result->matched, (unsigned long long)result->segments_scanned,
+            (unsigned long long)result->segments_skipped,
+            (unsigned long long)result->segments_cached, (unsigned long long)result->rows_read,
+            (double)result->elapsed_ns / 1e6);
+    return ferror(out) ? -1 : 0;
+}
+
+// Rows of 64 (or count, if fewer) whose level is allowed, as a bitmap
+static uint64_t level_bits(const uint8_t* levels, size_t count, uint32_t allowed) {
+#if defined(__SSE2__)
+    if (count == QUERY_BLOCK) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 4; i++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(levels + 16 * i));
+            __m128i hit = _mm_setzero_si128();
+            for (int level = 0; level <= LOG_LEVEL_CRITICAL; level++) {
+                if (allowed & (1u << level)) {
+                    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)level)));
+                }
+            }
+            bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << (16 * i);
+        }
+        return bits;
+    }
+#endif
+    uint64_t bits = 0;
+    for (size_t i = 0; i < count; i++) {
+        bits |= (uint64_t)((allowed >> (levels[i] & 31)) & 1) << i;
+    }
+    return bits;
+}
+
+// Rows of a block whose source is allowed, as a bitmap
+static uint64_t source_bits(const segment_t* segment, size_t base, size_t count,
+                            const bool* allowed) {
+    uint64_t bits = 0;
+    if (segment->source_width == 1) {
+        // The table covers every one-byte ID
+        const uint8_t* ids = segment->source_ids + base;
+        for (size_t i = 0; i < count; i++) {
+            bits |= (uint64_t)allowed[ids[i]] << i;
+        }
+        return bits;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t id = segment_source_id(segment, base + i);
+        bits |= (uint64_t)(id < segment->num_sources && allowed[id]) << i;
+    }
+    return bits;
+}
+
+// First row at or after time (timestamps are sorted)
+static size_t lower_bound(const int64_t* timestamps, size_t count, int64_t time) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (timestamps[middle] < time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static bool contains_text(const char* line, size_t length, const char* text, size_t text_len) {
+    if (text_len > length) {
+        return false;
+    }
+    const char* last = line + length - text_len;
+    for (const char* p = line; p <= last; p++) {
+        p = (const char*)memchr(p, text[0], (size_t)(last - p) + 1);
+        if (!p) {
+            return false;
+        }
+        if (memcmp(p, text, text_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool line_matches(scan_t* scan, const char* line, size_t length) {
+    const query_t* query = scan->query;
+    if (query->contains && !contains_text(line, length, query->contains, strlen(query->contains))) {
+        return false;
+    }
+    if (query->word && !token_index_match(line, length, query->word, strlen(query->word))) {
+        return false;
+    }
+    if (query->pattern) {
+        if (scan->buffer_capacity < length + 1) {
+            char* buffer = (char*)realloc(scan->buffer, length + 1);
+            if (!buffer) {
+                scan->failed = true;
+                return false;
+            }
+            scan->buffer = buffer;
+            scan->buffer_capacity = length + 1;
+        }
+        memcpy(scan->buffer, line, length);
+        scan->buffer[length] = '\0';
+        return regexec(&query->regex, scan->buffer, 0, NULL, 0) == 0;
+    }
+    return true;
+}
+
+static bool add_row(scan_t* scan, size_t row, const char* line, size_t length) {
+    query_result_t* result = scan->result;
+    segment_t* segment = scan->segment;
+    if (!line) {
+        line = segment_line(segment, row, &length);
+        result->rows_read++;
+    }
+    if (!line) {
+        scan->failed = true;
+        return false;
+    }
+    if (result->num_rows == scan->row_capacity) {
+        size_t capacity = scan->row_capacity ? scan->row_capacity * 2 : 64;
+        query_row_t* rows = (query_row_t*)realloc(result->rows, capacity * sizeof(query_row_t));
+        if (!rows) {
+            scan->failed = true;
+            return false;
+        }
+        result->rows = rows;
+        scan->row_capacity = capacity;
+    }
+
+    uint32_t id = segment_source_id(segment, row);
+    query_row_t* out = &result->rows[result->num_rows];
+    out->timestamp = scan->timestamps[row];
+    out->segment = segment->id;
+    out->row = (uint32_t)row;
+    out->level = (log_level_t)(segment->levels[row] <= LOG_LEVEL_CRITICAL ? segment->levels[row]
+                                                                          : LOG_LEVEL_INFO);
+    out->source = strndup(segment->source_names[id], segment->source_lengths[id]);
+    out->line = strndup(line, length);
+    if (!out->source || !out->line) {
+        free(out->source);
+        free(out->line);
+        scan->failed = true;
+        return false;
+    }
+    result->num_rows++;
+    return scan->query->limit == 0 || result->num_rows < scan->query->limit;
+}
+
+static void count_minute(scan_t* scan, int64_t timestamp) {
+    int64_t minute = timestamp / NS_PER_MINUTE - (timestamp % NS_PER_MINUTE < 0);
+    if (scan->num_minutes > 0 && scan->minutes[scan->num_minutes - 1].minute == minute) {
+        scan->minutes[scan->num_minutes - 1].count++;
+        return;
+    }
+    if (scan->num_minutes == scan->minute_capacity) {
+        size_t capacity = scan->minute_capacity ? scan->minute_capacity * 2 : 64;
+        minute_count_t* minutes =
+            (minute_count_t*)realloc(scan->minutes, capacity * sizeof(minute_count_t));
+        if (!minutes) {
+            scan->failed = true;
+            return;
+        }
+        scan->minutes = minutes;
+        scan->minute_capacity = capacity;
+    }
+    scan->minutes[scan->num_minutes].minute = minute;
+    scan->minutes[scan->num_minutes].count = 1;
+    scan->num_minutes++;
+}
+
+// Check the text filters of a row passing the column predicates and
+// account for it; false once the scan should stop
+static bool visit(scan_t* scan, size_t row) {
+    const char* line = NULL;
+    size_t length = 0;
+    if (scan->needs_line) {
+        line = segment_line(scan->segment, row, &length);
+        scan->result->rows_read++;
+        if (!line) {
+            scan->failed = true;
+            return false;
+        }
+        if (!line_matches(scan, line, length)) {
+            return !scan->failed;
+        }
+    }
+    scan->result->matched++;
+
+    uint8_t level = scan->segment->levels[row];
+    switch (scan->query->mode) {
+        case QUERY_LINES:
+            return add_row(scan, row, line, length);
+        case QUERY_COUNT_TOTAL:
+            break;
+        case QUERY_COUNT_LEVEL:
+            scan->level_counts[level <= LOG_LEVEL_CRITICAL ? level : LOG_LEVEL_INFO]++;
+            break;
+        case QUERY_COUNT_SOURCE:
+            scan->source_counts[segment_source_id(scan->segment, row)]++;
+            break;
+        case QUERY_COUNT_MINUTE:
+            count_minute(scan, scan->timestamps[row]);
+            break;
+    }
+    return !scan->failed;
+}
+
+static int add_bucket(query_result_t* result, char* key, uint64_t count, size_t* capacity) {
+    if (!key) {
+        return -1;
+    }
+    if (result->num_buckets == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        query_bucket_t* buckets =
+            (query_bucket_t*)realloc(result->buckets, grown * sizeof(query_bucket_t));
+        if (!buckets) {
+            free(key);
+            return -1;
+        }
+        result->buckets = buckets;
+        *capacity = grown;
+    }
+    result->buckets[result->num_buckets].key = key;
+    result->buckets[result->num_buckets].count = count;
+    result->num_buckets++;
+    return 0;
+}
+
+// Turn a finished scan's counters into buckets
+static int make_buckets(scan_t* scan) {
+    query_result_t* result = scan->result;
+    const segment_t* segment = scan->segment;
+    size_t capacity = 0;
+    int status = 0;
+    switch (scan->query->mode) {
+        case QUERY_COUNT_LEVEL:
+            for (int level = 0; level <= LOG_LEVEL_CRITICAL && status == 0; level++) {
+                if (scan->level_counts[level] > 0) {
+                    status = add_bucket(result, strdup(log_entry_level_to_string(level)),
+                                        scan->level_counts[level], &capacity);
+                }
+            }
+            break;
+        case QUERY_COUNT_SOURCE:
+            for (size_t id = 0; id < segment->num_sources && status == 0; id++) {
+                if (scan->source_counts[id] > 0) {
+                    status = add_bucket(result,
+                                        strndup(segment->source_names[id],
+                                                segment->source_lengths[id]),
+                                        scan->source_counts[id], &capacity);
+                }
+            }
+            break;
+        case QUERY_COUNT_MINUTE:
+            for (size_t i = 0; i < scan->num_minutes && status == 0; i++) {
+                char key[32];
+                format_time(scan->minutes[i].minute * NS_PER_MINUTE, key, sizeof(key), true);
+                status = add_bucket(result, strdup(key), scan->minutes[i].count, &capacity);
+            }
+            break;
+        default:
+            break;
+    }
+    return status;
+}
+
+static void scan_rows(scan_t* scan, size_t first, size_t end, const uint32_t* candidates,
+                      size_t num_candidates, const bool* sources) {
+    const query_t* query = scan->query;
+    const segment_t* segment = scan->segment;
+    bool filter_levels = query->levels != 0 && (query->levels & ALL_LEVELS) != ALL_LEVELS;
+
+    // Index candidates are sparse: check their columns one by one
+    if (candidates) {
+        bool more = true;
+        for (size_t i = 0; i < num_candidates && more; i++) {
+            size_t row = candidates[i];
+            if (row < first || row >= end ||
+                (filter_levels && !((query->levels >> (segment->levels[row] & 31)) & 1)) ||
+                (sources && !sources[segment_source_id(segment, row)])) {
+                continue;
+            }
+            more = visit(scan, row);
+        }
+        return;
+    }
+
+    // Counting every row that passes the columns needs no per-row work
+    bool popcount_only = !scan->needs_line && query->mode == QUERY_COUNT_TOTAL;
+    bool more = true;
+    for (size_t base = first; base < end && more; base += QUERY_BLOCK) {
+        size_t count = end - base < QUERY_BLOCK ? end - base : QUERY_BLOCK;
+        uint64_t bits = count == QUERY_BLOCK ? ~0ULL : (1ULL << count) - 1;
+        if (filter_levels) {
+            bits &= level_bits(segment->levels + base, count, query->levels);
+        }
+        if (sources && bits) {
+            bits &= source_bits(segment, base, count, sources);
+        }
+        if (popcount_only) {
+            scan->result->matched += (uint64_t)__builtin_popcountll(bits);
+            continue;
+        }
+        while (bits && more) {
+            size_t row = base + (size_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            more = visit(scan, row);
+        }
+    }
+}
+
+// Allowed source IDs, or NULL if every source is (*none set if none is)
+static bool* match_sources(const segment_t* segment, const char* glob, bool* none) {
+    size_t size = segment->num_sources < 256 ? 256 : segment->num_sources;
+    bool* allowed = (bool*)calloc(size, sizeof(bool));
+    if (!allowed) {
+        return NULL;
+    }
+    *none = true;
+    char name[PATH_MAX];
+    for (size_t id = 0; id < segment->num_sources; id++) {
+        size_t length = segment->source_lengths[id];
+        if (length < sizeof(name)) {
+            memcpy(name, segment->source_names[id], length);
+            name[length] = '\0';
+            allowed[id] = fnmatch(glob, name, 0) == 0;
+            *none &= !allowed[id];
+        }
+    }
+    return allowed;
+}
+
+// Scan one segment into its result; false if the result is incomplete
+static bool scan_segment(query_engine_t* engine, query_job_t* job,
+                         const log_store_segment_t* entry, query_result_t* result) {
+    const query_t* query = job->query;
+    char path[PATH_MAX];
+    segment_t segment;
+    if (snprintf(path, sizeof(path), "%s/%s", job->dir, entry->name) >= (int)sizeof(path) ||
+        segment_open(&segment, path) != 0) {
+        metrics_add(engine->errors, 1); // Removed by compaction, or unreadable
+        return false;
+    }
+    if (job->num_hashes > 0 && !segment_may_contain(&segment, job->hashes, job->num_hashes)) {
+        result->segments_skipped = 1;
+        segment_close(&segment);
+        return true;
+    }
+
+    scan_t scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.query = query;
+    scan.segment = &segment;
+    scan.result = result;
+    scan.needs_line = query->contains || query->word || query->pattern;
+
+    bool none = false;
+    bool* sources = query->source ? match_sources(&segment, query->source, &none) : NULL;
+    bool clipped = segment.min_time < query->from || segment.max_time >= query->to;
+    if (clipped || query->mode == QUERY_LINES || query->mode == QUERY_COUNT_MINUTE) {
+        scan.timestamps = segment_timestamps(&segment);
+    }
+    if (query->mode == QUERY_COUNT_SOURCE) {
+        scan.source_counts = (uint64_t*)calloc(segment.num_sources + 1, sizeof(uint64_t));
+    }
+    if ((query->source && !sources) || (!scan.timestamps && (clipped ||
+        query->mode == QUERY_LINES || query->mode == QUERY_COUNT_MINUTE)) ||
+        (query->mode == QUERY_COUNT_SOURCE && !scan.source_counts)) {
+        scan.failed = true;
+    }
+
+    if (!scan.failed && none) {
+        result->segments_skipped = 1;
+    } else if (!scan.failed) {
+        result->segments_scanned = 1;
+        size_t first = 0;
+        size_t end = segment.num_rows;
+        if (segment.min_time < query->from) {
+            first = lower_bound(scan.timestamps, segment.num_rows, query->from);
+        }
+        if (segment.max_time >= query->to) {
+            end = lower_bound(scan.timestamps, segment.num_rows, query->to);
+        }
+
+        uint32_t* candidates = NULL;
+        size_t num_candidates = 0;
+        bool indexed = job->num_hashes > 0 &&
+                       segment_find(&segment, job->hashes, job->num_hashes, &candidates,
+                                    &num_candidates) == 0;
+        if (first < end && (!indexed || num_candidates > 0)) {
+            scan_rows(&scan, first, end, indexed ? candidates : NULL, num_candidates, sources);
+        }
+        free(candidates);
+        if (!scan.failed && make_buckets(&scan) != 0) {
+            scan.failed = true;
+        }
+    }
+    if (scan.failed) {
+        metrics_add(engine->errors, 1);
+    }
+
+    free(sources);
+    free(scan.buffer);
+    free(scan.source_counts);
+    free(scan.minutes);
+    segment_close(&segment);
+    return !scan.failed;
+}
+
+// Answer one segment's part of the job from the catalogue, the cache or a scan
+static void answer_segment(query_engine_t* engine, query_job_t* job, size_t index) {
+    const query_t* query = job->query;
+    const log_store_segment_t* entry = &job->segments[index];
+    query_result_t* result = &job->results[index];
+    if (entry->max_time < query->from || entry->min_time >= query->to) {
+        result->segments_skipped = 1;
+        return;
+    }
+    if (!job->normalized) {
+        scan_segment(engine, job, entry, result);
+        return;
+    }
+
+    // A range covering the whole segment selects the same rows as no range
+    int64_t from = query->from <= entry->min_time ? INT64_MIN : query->from;
+    int64_t to = query->to > entry->max_time ? INT64_MAX : query->to;
+    if (query_cache_lookup(engine->cache, job->normalized, job->normalized_len, entry->id,
+                           from, to, result)) {
+        result->rows_read = 0;
+        result->segments_scanned = 0;
+        result->segments_skipped = 0;
+        result->segments_cached = 1;
+        return;
+    }
+    if (scan_segment(engine, job, entry, result)) {
+        query_cache_insert(engine->cache, job->normalized, job->normalized_len, entry->id, from,
+                           to, result);
+    }
+}
+
+static int compare_rows(const void* a, const void* b) {
+    const query_row_t* left = (const query_row_t*)a;
+    const query_row_t* right = (const query_row_t*)b;
+    if (left->timestamp != right->timestamp) {
+        return left->timestamp < right->timestamp ? -1 : 1;
+    }
+    if (left->segment != right->segment) {
+        return left->segment < right->segment ? -1 : 1;
+    }
+    return left->row < right->row ? -1 : (left->row > right->row ? 1 : 0);
+}
+
+static int compare_buckets(const void* a, const void* b) {
+    return strcmp(((const query_bucket_t*)a)->key, ((const query_bucket_t*)b)->key);
+}
+
+// Combine per-segment results; the parts are emptied
+static int merge_results(const query_t* query, query_result_t* parts, size_t count,
+                         query_result_t* result) {
+    size_t num_rows = 0;
+    size_t num_buckets = 0;
+    for (size_t i = 0; i < count; i++) {
+        num_rows += parts[i].num_rows;
+        num_buckets += parts[i].num_buckets;
+        result->matched += parts[i].matched;
+        result->rows_read += parts[i].rows_read;
+        result->segments_scanned += parts[i].segments_scanned;
+        result->segments_skipped += parts[i].segments_skipped;
+        result->segments_cached += parts[i].segments_cached;
+    }
+    result->rows = (query_row_t*)malloc((num_rows + 1) * sizeof(query_row_t));
+    result->buckets = (query_bucket_t*)malloc((num_buckets + 1) * sizeof(query_bucket_t));
+    if (!result->rows || !result->buckets) {
+        for (size_t i = 0; i < count; i++) {
+            query_result_destroy(&parts[i]);
+        }
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (parts[i].num_rows > 0) {
+            memcpy(result->rows + result->num_rows, parts[i].rows,
+                   parts[i].num_rows * sizeof(query_row_t));
+            result->num_rows += parts[i].num_rows;
+        }
+        if (parts[i].num_buckets > 0) {
+            memcpy(result->buckets + result->num_buckets, parts[i].buckets,
+                   parts[i].num_buckets * sizeof(query_bucket_t));
+            result->num_buckets += parts[i].num_buckets;
+        }
+        free(parts[i].rows);
+        free(parts[i].buckets);
+        memset(&parts[i], 0, sizeof(query_result_t));
+    }
+
+    // Earliest lines first, then the limit over all segments
+    qsort(result->rows, result->num_rows, sizeof(query_row_t), compare_rows);
+    while (query->limit > 0 && result->num_rows > query->limit) {
+        result->num_rows--;
+        free(result->rows[result->num_rows].source);
+        free(result->rows[result->num_rows].line);
+    }
+
+    // Equal keys from different segments add up
+    qsort(result->buckets, result->num_buckets, sizeof(query_bucket_t), compare_buckets);
+    size_t kept = 0;
+    for (size_t i = 0; i < result->num_buckets; i++) {
+        if (kept > 0 && strcmp(result->buckets[kept - 1].key, result->buckets[i].key) == 0) {
+            result->buckets[kept - 1].count += result->buckets[i].count;
+            free(result->buckets[i].key);
+        } else {
+            result->buckets[kept++] = result->buckets[i];
+        }
+    }
+    result->num_buckets = kept;
+    return 0;
+}
+
+int query_engine_init(query_engine_t* engine, log_store_t* store, size_t num_threads,
+                      size_t cache_size) {
+    if (!engine || !store) {
+        return -1;
+    }
+
+    memset(engine, 0, sizeof(query_engine_t));
+    engine->store = store;
+    engine->threads = (pthread_t*)calloc(num_threads + 1, sizeof(pthread_t));
+    if (!engine->threads) {
+        return -1;
+    }
+    pthread_mutex_init(&engine->run_mutex, NULL);
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->work, NULL);
+    pthread_cond_init(&engine->done, NULL);
+    engine->queries = metrics_register("query.queries", METRIC_COUNTER);
+    engine->errors = metrics_register("query.errors", METRIC_COUNTER);
+    engine->segments_scanned = metrics_register("query.segments_scanned", METRIC_COUNTER);
+    engine->segments_skipped = metrics_register("query.segments_skipped", METRIC_COUNTER);
+    engine->rows_read = metrics_register("query.rows_read", METRIC_COUNTER);
+    engine->last_ms = metrics_register("query.last_ms", METRIC_GAUGE);
+    if (cache_size > 0) {
+        engine->cache = (query_cache_t*)malloc(sizeof(query_cache_t));
+        if (!engine->cache || query_cache_init(engine->cache, cache_size) != 0) {
+            free(engine->cache);
+            engine->cache = NULL;
+            query_engine_destroy(engine);
+            return -1;
+        }
+    }
+
+    engine->running = true;
+    for (size_t i = 0; i < num_threads; i++) {
+        if (pthread_create(&engine->threads[i], NULL, query_thread_func, engine) != 0) {
+            query_engine_destroy(engine);
+            return -1;
+        }
+        engine->num_threads++;
+    }
+    return 0;
+}
+
+void query_engine_destroy(query_engine_t* engine) {
+    if (!engine || !engine->threads) {
+        return;
+    }
+
+    pthread_mutex_lock(&engine->mutex);
+    engine->running = false;
+    pthread_cond_broadcast(&engine->work);
+    pthread_mutex_unlock(&engine->mutex);
+    for (size_t i = 0; i < engine->num_threads; i++) {
+        pthread_join(engine->threads[i], NULL);
+    }
+    pthread_cond_destroy(&engine->done);
+    pthread_cond_destroy(&engine->work);
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_mutex_destroy(&engine->run_mutex);
+    if (engine->cache) {
+        query_cache_destroy(engine->cache);
+        free(engine->cache);
+    }
+    free(engine->threads);
+    memset(engine, 0, sizeof(query_engine_t));
+}
+
+// Scan segments of the current job until none is left unclaimed; called
+// with the mutex held
+static void work_on(query_engine_t* engine, query_job_t* job) {
+    while (job->next < job->num_segments) {
+        size_t index = job->next++;
+        pthread_mutex_unlock(&engine->mutex);
+        answer_segment(engine, job, index);
+        pthread_mutex_lock(&engine->mutex);
+        if (++job->finished == job->num_segments) {
+            pthread_cond_broadcast(&engine->done);
+        }
+    }
+}
+
+static void* query_thread_func(void* arg) {
+    query_engine_t* engine = (query_engine_t*)arg;
+    pthread_mutex_lock(&engine->mutex);
+    while (engine->running) {
+        if (engine->job && engine->job->next < engine->job->num_segments) {
+            work_on(engine, engine->job);
+        } else {
+            pthread_cond_wait(&engine->work, &engine->mutex);
+        }
+    }
+    pthread_mutex_unlock(&engine->mutex);
+    return NULL;
+}
+
+int query_run(query_engine_t* engine, const query_t* query, query_result_t* result) {
+    if (!engine || !engine->threads || !query || !result) {
+        return -1;
+    }
+    memset(result, 0, sizeof(query_result_t));
+    int64_t started = monotonic_ns();
+
+    pthread_mutex_lock(&engine->run_mutex);
+    query_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.query = query;
+    job.dir = engine->store->dir;
+    if (query->word) {
+        job.num_hashes = token_index_tokens(query->word, strlen(query->word), job.hashes,
+                                            TOKEN_INDEX_MAX_QUERY);
+    }
+    // Without its key text the query runs uncached
+    if (engine->cache && (job.normalized = query_normalize(query))) {
+        job.normalized_len = strlen(job.normalized);
+    }
+
+    // Snapshot the catalogue; it may grow in between
+    size_t count = log_store_segments(engine->store, NULL, 0);
+    do {
+        free(job.segments);
+        job.num_segments = count;
+        job.segments = (log_store_segment_t*)malloc((count + 1) * sizeof(log_store_segment_t));
+        if (!job.segments) {
+            free(job.normalized);
+            pthread_mutex_unlock(&engine->run_mutex);
+            metrics_add(engine->errors, 1);
+            return -1;
+        }
+        count = log_store_segments(engine->store, job.segments, count);
+    } while (count > job.num_segments);
+    job.num_segments = count;
+    job.results = (query_result_t*)calloc(count + 1, sizeof(query_result_t));
+    if (!job.results) {
+        free(job.segments);
+        free(job.normalized);
+        pthread_mutex_unlock(&engine->run_mutex);
+        metrics_add(engine->errors, 1);
+        return -1;
+    }
+
+    // The calling thread scans too
+    pthread_mutex_lock(&engine->mutex);
+    engine->job = &job;
+    pthread_cond_broadcast(&engine->work);
+    work_on(engine, &job);
+    while (job.finished < job.num_segments) {
+        pthread_cond_wait(&engine->done, &engine->mutex);
+    }
+    engine->job = NULL;
+    pthread_mutex_unlock(&engine->mutex);
+
+    int status = merge_results(query, job.results, job.num_segments, result);
+    free(job.results);
+    free(job.segments);
+    free(job.normalized);
+    pthread_mutex_unlock(&engine->run_mutex);
+
+    result->elapsed_ns = monotonic_ns() - started;
+    metrics_add(engine->queries, 1);
+    metrics_add(engine->segments_scanned, result->segments_scanned);
+    metrics_add(engine->segments_skipped, result->segments_skipped);
+    metrics_add(engine->rows_read, result->rows_read);
+    metrics_set(engine->last_ms, (uint64_t)(result->elapsed_ns / 1000000));
+    if (status != 0) {
+        metrics_add(engine->errors, 1);
+        query_result_destroy(result);
+    }
+    return status;
+}
\ No newline at end of file
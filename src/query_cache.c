@@ -0,0 +1,269 @@
+#include "query_cache.h"
+#include "hash.h"
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define QUERY_CACHE_MIN_BUCKETS 64
+
+static void query_cache_collect_metrics(void* ctx) {
+    query_cache_t* cache = (query_cache_t*)ctx;
+    query_cache_stats_t stats;
+    query_cache_get_stats(cache, &stats);
+
+    metrics_set(metrics_register("query_cache.hits", METRIC_COUNTER), stats.hits);
+    metrics_set(metrics_register("query_cache.misses", METRIC_COUNTER), stats.misses);
+    metrics_set(metrics_register("query_cache.evictions", METRIC_COUNTER), stats.evictions);
+    metrics_set(metrics_register("query_cache.entries", METRIC_GAUGE), stats.entries);
+    metrics_set(metrics_register("query_cache.bytes", METRIC_GAUGE), stats.bytes);
+
+    // Hit rate in basis points (1/100 of a percent)
+    uint64_t lookups = stats.hits + stats.misses;
+    metrics_set(metrics_register("query_cache.hit_rate_bp", METRIC_GAUGE),
+                lookups ? (stats.hits * 10000) / lookups : 0);
+}
+
+static uint64_t key_hash(const char* query, size_t query_len, uint64_t segment, int64_t from,
+                         int64_t to) {
+    uint64_t hash = hash64(query, query_len, 0x7175657279);
+    hash = hash64_mix(hash ^ segment);
+    hash = hash64_mix(hash ^ (uint64_t)from);
+    return hash64_mix(hash ^ (uint64_t)to);
+}
+
+// Memory held by an entry and its copies
+static size_t entry_bytes(size_t query_len, const query_result_t* result) {
+    size_t bytes = sizeof(query_cache_entry_t) + query_len + 1;
+    for (size_t i = 0; i < result->num_rows; i++) {
+        bytes += sizeof(query_row_t) + strlen(result->rows[i].source) +
+                 strlen(result->rows[i].line) + 2;
+    }
+    for (size_t i = 0; i < result->num_buckets; i++) {
+        bytes += sizeof(query_bucket_t) + strlen(result->buckets[i].key) + 1;
+    }
+    return bytes;
+}
+
+static void free_entry(query_cache_entry_t* entry) {
+    query_result_destroy(&entry->result);
+    free(entry->query);
+    free(entry);
+}
+
+static void unlink_lru(query_cache_t* cache, query_cache_entry_t* entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void push_newest(query_cache_t* cache, query_cache_entry_t* entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+// Remove an entry from its bucket and the LRU list, and free it
+static void remove_entry(query_cache_t* cache, query_cache_entry_t* entry) {
+    query_cache_entry_t** link = &cache->buckets[entry->hash & cache->bucket_mask];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    unlink_lru(cache, entry);
+    cache->num_entries--;
+    cache->bytes -= entry->bytes;
+    free_entry(entry);
+}
+
+static query_cache_entry_t* find_entry(query_cache_t* cache, uint64_t hash, const char* query,
+                                       size_t query_len, uint64_t segment, int64_t from,
+                                       int64_t to) {
+    query_cache_entry_t* entry = cache->buckets[hash & cache->bucket_mask];
+    for (; entry; entry = entry->next) {
+        if (entry->hash == hash && entry->segment == segment && entry->from == from &&
+            entry->to == to && entry->query_len == query_len &&
+            memcmp(entry->query, query, query_len) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Double the buckets once entries outnumber them (failure keeps the old ones)
+static void grow_buckets(query_cache_t* cache) {
+    size_t num_buckets = (cache->bucket_mask + 1) * 2;
+    query_cache_entry_t** buckets =
+        (query_cache_entry_t**)calloc(num_buckets, sizeof(query_cache_entry_t*));
+    if (!buckets) {
+        return;
+    }
+    for (size_t i = 0; i <= cache->bucket_mask; i++) {
+        query_cache_entry_t* entry = cache->buckets[i];
+        while (entry) {
+            query_cache_entry_t* next = entry->next;
+            entry->next = buckets[entry->hash & (num_buckets - 1)];
+            buckets[entry->hash & (num_buckets - 1)] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_mask = num_buckets - 1;
+}
+
+int query_cache_init(query_cache_t* cache, size_t budget) {
+    if (!cache || budget == 0) {
+        return -1;
+    }
+
+    memset(cache, 0, sizeof(query_cache_t));
+    cache->buckets =
+        (query_cache_entry_t**)calloc(QUERY_CACHE_MIN_BUCKETS, sizeof(query_cache_entry_t*));
+    if (!cache->buckets || pthread_mutex_init(&cache->mutex, NULL) != 0) {
+        free(cache->buckets);
+        cache->buckets = NULL;
+        return -1;
+    }
+    cache->bucket_mask = QUERY_CACHE_MIN_BUCKETS - 1;
+    cache->budget = budget;
+    metrics_add_collector(query_cache_collect_metrics, cache);
+    return 0;
+}
+
+void query_cache_destroy(query_cache_t* cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    metrics_remove_collector(query_cache_collect_metrics, cache);
+    query_cache_clear(cache);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache->buckets);
+    memset(cache, 0, sizeof(query_cache_t));
+}
+
+bool query_cache_lookup(query_cache_t* cache, const char* query, size_t query_len,
+                        uint64_t segment, int64_t from, int64_t to, query_result_t* result) {
+    if (!cache || !cache->buckets || !query || !result) {
+        return false;
+    }
+
+    uint64_t hash = key_hash(query, query_len, segment, from, to);
+    pthread_mutex_lock(&cache->mutex);
+    query_cache_entry_t* entry = find_entry(cache, hash, query, query_len, segment, from, to);
+    bool hit = entry && query_result_copy(result, &entry->result) == 0;
+    if (hit) {
+        unlink_lru(cache, entry);
+        push_newest(cache, entry);
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return hit;
+}
+
+void query_cache_insert(query_cache_t* cache, const char* query, size_t query_len,
+                        uint64_t segment, int64_t from, int64_t to,
+                        const query_result_t* result) {
+    if (!cache || !cache->buckets || !query || !result) {
+        return;
+    }
+    size_t bytes = entry_bytes(query_len, result);
+    if (bytes > cache->budget) {
+        return;
+    }
+
+    // Copied outside the lock
+    query_cache_entry_t* entry = (query_cache_entry_t*)calloc(1, sizeof(query_cache_entry_t));
+    if (!entry) {
+        return;
+    }
+    entry->query = (char*)malloc(query_len + 1);
+    if (!entry->query || query_result_copy(&entry->result, result) != 0) {
+        free_entry(entry);
+        return;
+    }
+    memcpy(entry->query, query, query_len);
+    entry->query[query_len] = '\0';
+    entry->query_len = query_len;
+    entry->hash = key_hash(query, query_len, segment, from, to);
+    entry->segment = segment;
+    entry->from = from;
+    entry->to = to;
+    entry->bytes = bytes;
+
+    pthread_mutex_lock(&cache->mutex);
+    query_cache_entry_t* existing =
+        find_entry(cache, entry->hash, query, query_len, segment, from, to);
+    if (existing) {
+        remove_entry(cache, existing);
+    }
+    while (cache->bytes + bytes > cache->budget && cache->oldest) {
+        remove_entry(cache, cache->oldest);
+        cache->evictions++;
+    }
+    if (cache->num_entries > cache->bucket_mask) {
+        grow_buckets(cache);
+    }
+    query_cache_entry_t** bucket = &cache->buckets[entry->hash & cache->bucket_mask];
+    entry->next = *bucket;
+    *bucket = entry;
+    push_newest(cache, entry);
+    cache->num_entries++;
+    cache->bytes += bytes;
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void query_cache_clear(query_cache_t* cache) {
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    query_cache_entry_t* entry = cache->newest;
+    while (entry) {
+        query_cache_entry_t* older = entry->older;
+        free_entry(entry);
+        entry = older;
+    }
+    memset(cache->buckets, 0, (cache->bucket_mask + 1) * sizeof(query_cache_entry_t*));
+    cache->newest = NULL;
+    cache->oldest = NULL;
+    cache->num_entries = 0;
+    cache->bytes = 0;
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void query_cache_get_stats(query_cache_t* cache, query_cache_stats_t* stats) {
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(query_cache_stats_t));
+    if (!cache || !cache->buckets) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->entries = cache->num_entries;
+    stats->bytes = cache->bytes;
+    pthread_mutex_unlock(&cache->mutex);
+}
\ No newline at end of file
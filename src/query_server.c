@@ -0,0 +1,260 @@
+#include "query_server.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void* query_server_thread_func(void* arg);
+
+static int make_address(const char* path, struct sockaddr_un* address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        return -1;
+    }
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+// Send everything, resuming after partial sends (no SIGPIPE on a closed peer)
+static int send_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return -1;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+int query_server_init(query_server_t* server, const char* path, query_engine_t* engine) {
+    if (!server || !path || !engine) {
+        return -1;
+    }
+
+    memset(server, 0, sizeof(query_server_t));
+    server->fd = -1;
+    server->engine = engine;
+    struct sockaddr_un address;
+    if (make_address(path, &address) != 0 || !(server->path = strdup(path))) {
+        return -1;
+    }
+    server->requests = metrics_register("query.requests", METRIC_COUNTER);
+    server->rejected = metrics_register("query.rejected", METRIC_COUNTER);
+
+    server->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->fd < 0) {
+        free(server->path);
+        server->path = NULL;
+        return -1;
+    }
+    unlink(path); // Left behind by a previous run
+    if (bind(server->fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(server->fd, 8) != 0) {
+        perror("Failed to bind query socket");
+        close(server->fd);
+        free(server->path);
+        server->path = NULL;
+        server->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// Read a request up to its empty line; NULL on timeout or overflow
+static char* read_request(int fd) {
+    char* request = (char*)malloc(QUERY_SERVER_MAX_REQUEST + 1);
+    if (!request) {
+        return NULL;
+    }
+    size_t used = 0;
+    while (used < QUERY_SERVER_MAX_REQUEST) {
+        ssize_t n = recv(fd, request + used, QUERY_SERVER_MAX_REQUEST - used, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            free(request);
+            return NULL;
+        }
+        size_t from = used > 0 ? used - 1 : 0;
+        used += (size_t)n;
+        request[used] = '\0';
+        if (n == 0 || strstr(request + from, "\n\n") || strcmp(request, "\n") == 0) {
+            return request;
+        }
+    }
+    free(request);
+    return NULL;
+}
+
+// Answer one connection
+static void serve_client(query_server_t* server, int fd) {
+    struct timeval timeout;
+    timeout.tv_sec = QUERY_SERVER_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (QUERY_SERVER_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    metrics_add(server->requests, 1);
+
+    char* request = read_request(fd);
+    char error[256] = "";
+    query_t query;
+    query_init(&query);
+    if (!request) {
+        snprintf(error, sizeof(error), "# error: incomplete request\n");
+    }
+
+    // One term per line, up to the first empty line
+    char* line = request;
+    while (line && *line && !error[0]) {
+        char* newline = strchr(line, '\n');
+        if (newline) {
+            *newline = '\0';
+        }
+        size_t length = strlen(line);
+        if (length > 0 && line[length - 1] == '\r') {
+            line[--length] = '\0';
+        }
+        if (length == 0) {
+            break;
+        }
+        if (query_parse_term(&query, line) != 0) {
+            snprintf(error, sizeof(error), "# error: invalid term %.200s\n", line);
+        }
+        line = newline ? newline + 1 : NULL;
+    }
+
+    query_result_t result;
+    if (!error[0] && query_run(server->engine, &query, &result) != 0) {
+        snprintf(error, sizeof(error), "# error: query failed\n");
+    }
+    if (error[0]) {
+        metrics_add(server->rejected, 1);
+        send_all(fd, error, strlen(error));
+    } else {
+        // Formatted in memory, so a slow client does not hold the result's stream
+        char* answer = NULL;
+        size_t size = 0;
+        FILE* stream = open_memstream(&answer, &size);
+        if (stream) {
+            query_write(&query, &result, stream);
+            fclose(stream);
+            send_all(fd, answer, size);
+        }
+        free(answer);
+        query_result_destroy(&result);
+    }
+    query_destroy(&query);
+    free(request);
+}
+
+static void* query_server_thread_func(void* arg) {
+    query_server_t* server = (query_server_t*)arg;
+    while (__atomic_load_n(&server->running, __ATOMIC_ACQUIRE)) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(server->fd, &read_fds);
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 200000;
+        if (select(server->fd + 1, &read_fds, NULL, NULL, &timeout) <= 0) {
+            continue;
+        }
+        int client_fd = accept(server->fd, NULL, NULL);
+        if (client_fd >= 0) {
+            serve_client(server, client_fd);
+            close(client_fd);
+        }
+    }
+    return NULL;
+}
+
+int query_server_start(query_server_t* server) {
+    if (!server || server->fd < 0 || server->started) {
+        return -1;
+    }
+
+    server->running = true;
+    if (pthread_create(&server->thread, NULL, query_server_thread_func, server) != 0) {
+        server->running = false;
+        return -1;
+    }
+    server->started = true;
+    return 0;
+}
+
+void query_server_stop(query_server_t* server) {
+    if (!server || !server->started) {
+        return;
+    }
+    __atomic_store_n(&server->running, false, __ATOMIC_RELEASE);
+    pthread_join(server->thread, NULL);
+    server->started = false;
+}
+
+void query_server_destroy(query_server_t* server) {
+    if (!server) {
+        return;
+    }
+    query_server_stop(server);
+    if (server->fd >= 0) {
+        close(server->fd);
+        unlink(server->path);
+    }
+    free(server->path);
+    memset(server, 0, sizeof(query_server_t));
+    server->fd = -1;
+}
+
+int query_server_request(const char* path, char* const* terms, size_t count, FILE* out) {
+    struct sockaddr_un address;
+    if (!path || !out || make_address(path, &address) != 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < count && status == 0; i++) {
+        if (strchr(terms[i], '\n') || send_all(fd, terms[i], strlen(terms[i])) != 0 ||
+            send_all(fd, "\n", 1) != 0) {
+            status = -1;
+        }
+    }
+    if (status == 0 && send_all(fd, "\n", 1) == 0) {
+        shutdown(fd, SHUT_WR);
+        char buffer[65536];
+        size_t received = 0;
+        bool rejected = false;
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0 ||
+               (n < 0 && errno == EINTR)) {
+            if (n < 0) {
+                continue;
+            }
+            if (received == 0 && n >= 8 && memcmp(buffer, "# error:", 8) == 0) {
+                rejected = true;
+            }
+            received += (size_t)n;
+            fwrite(buffer, 1, (size_t)n, out);
+        }
+        status = n < 0 ? -1 : (rejected ? 1 : 0);
+    }
+    close(fd);
+    return status;
+}
\ No newline at end of file
@@ -115,11 +115,17 @@ int queue_enqueue(log_queue_t* queue, log_entry_t* entry) {
     
     pthread_mutex_lock(&queue->mutex);
     
-    // Wait if queue is full (if max_size > 0)
-    while (queue->max_size > 0 && queue->size >= queue->max_size) {
+    // Wait if queue is full (if max_size > 0), but give up on shutdown
+    // since nobody may be left to make room
+    while (queue->max_size > 0 && queue->size >= queue->max_size && !queue->shutdown) {
         pthread_cond_wait(&queue->not_full, &queue->mutex);
     }
     
+    if (queue->max_size > 0 && queue->size >= queue->max_size) {
+        pthread_mutex_unlock(&queue->mutex);
+        return -1;
+    }
+    
     queue_node_t* node = (queue_node_t*)malloc(sizeof(queue_node_t));
     if (!node) {
         pthread_mutex_unlock(&queue->mutex);
@@ -143,33 +149,16 @@ int queue_enqueue(log_queue_t* queue, log_entry_t* entry) {
     return 0;
 }
 
-log_entry_t* queue_dequeue(log_queue_t* queue) {
-    if (!queue) {
-        return NULL;
-    }
-    
-    // Check if queue was destroyed
-    if (queue->destroyed) {
-        return NULL;
-    }
-    
-    pthread_mutex_lock(&queue->mutex);
-    
-    // Wait if queue is empty, but exit if shutdown
-    while (queue->size == 0 && !queue->shutdown) {
-        pthread_cond_wait(&queue->not_empty, &queue->mutex);
-    }
-    
-    // If shutdown and queue is empty, return NULL
-    if (queue->shutdown && queue->size == 0) {
-        pthread_mutex_unlock(&queue->mutex);
+// Takes the head entry; the caller holds the mutex
+static log_entry_t* pop_locked(log_queue_t* queue) {
+    // Shut down (or timed out) with nothing left
+    if (queue->size == 0) {
         return NULL;
     }
     
     // At this point, queue->size > 0, so head must not be NULL
     // This invariant is tested via gtest in tests/test_queue_gtest.cpp
     if (queue->head == NULL) {
-        pthread_mutex_unlock(&queue->mutex);
         return NULL; // Safety check - should never happen if queue is properly maintained
     }
     
@@ -183,7 +172,6 @@ log_entry_t* queue_dequeue(log_queue_t* queue) {
         queue->head = NULL;
         queue->tail = NULL;
         queue->size = 0;
-        pthread_mutex_unlock(&queue->mutex);
         return NULL;
     }
     
@@ -204,6 +192,54 @@ log_entry_t* queue_dequeue(log_queue_t* queue) {
         pthread_cond_signal(&queue->not_full);
     }
     
+    return entry;
+}
+
+log_entry_t* queue_dequeue(log_queue_t* queue) {
+    if (!queue) {
+        return NULL;
+    }
+    
+    // Check if queue was destroyed
+    if (queue->destroyed) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&queue->mutex);
+    
+    // Wait if queue is empty, but exit if shutdown
+    while (queue->size == 0 && !queue->shutdown) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    
+    log_entry_t* entry = pop_locked(queue);
+    pthread_mutex_unlock(&queue->mutex);
+    
+    return entry;
+}
+
+log_entry_t* queue_dequeue_timeout(log_queue_t* queue, unsigned int timeout_ms) {
+    if (!queue || queue->destroyed) {
+        return NULL;
+    }
+    
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    
+    pthread_mutex_lock(&queue->mutex);
+    
+    int rc = 0;
+    while (queue->size == 0 && !queue->shutdown && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&queue->not_empty, &queue->mutex, &deadline);
+    }
+    
+    log_entry_t* entry = pop_locked(queue);
     pthread_mutex_unlock(&queue->mutex);
     
     return entry;
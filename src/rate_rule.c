@@ -0,0 +1,103 @@
+#include "rate_rule.h"
+#include "log_selector.h"
+#include "timestamp.h"
+#include <stdlib.h>
+#include <string.h>
+
+// "<n>" or a rate "<n>/s", "<n>/m", "<n>/h" spread over the window
+static int parse_limit(const char* text, size_t len, int64_t window, uint64_t* limit) {
+    char buf[32];
+    if (len == 0 || len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+
+    char* end;
+    unsigned long long value = strtoull(buf, &end, 10);
+    if (end == buf || buf[0] == '-') {
+        return -1;
+    }
+    if (*end == '\0') {
+        *limit = value;
+        return 0;
+    }
+
+    int64_t per;
+    if (strcmp(end, "/s") == 0) {
+        per = TIMESTAMP_NS_PER_SEC;
+    } else if (strcmp(end, "/m") == 0) {
+        per = 60 * TIMESTAMP_NS_PER_SEC;
+    } else if (strcmp(end, "/h") == 0) {
+        per = 3600 * TIMESTAMP_NS_PER_SEC;
+    } else {
+        return -1;
+    }
+    *limit = (uint64_t)((long double)value * (long double)window / (long double)per);
+    return 0;
+}
+
+int rate_rule_parse(rate_rule_t* rule, const char* text) {
+    if (!rule || !text) {
+        return -1;
+    }
+
+    memset(rule, 0, sizeof(rate_rule_t));
+
+    while (*text == ' ') text++;
+    size_t len = strlen(text);
+    while (len > 0 && text[len - 1] == ' ') len--;
+
+    // "<limit> <selector> in <window>"
+    const char* limit = text;
+    size_t limit_len = strcspn(text, " ");
+    const char* in = NULL;
+    for (const char* p = text + limit_len; p + 4 <= text + len; p++) {
+        if (strncmp(p, " in ", 4) == 0) {
+            in = p;
+        }
+    }
+    if (!in || in <= text + limit_len) {
+        return -1;
+    }
+
+    char window[32];
+    const char* window_start = in + 4;
+    while (*window_start == ' ') window_start++;
+    size_t window_len = (size_t)(text + len - window_start);
+    if (window_len == 0 || window_len >= sizeof(window)) {
+        return -1;
+    }
+    memcpy(window, window_start, window_len);
+    window[window_len] = '\0';
+    if (timestamp_parse_duration(window, &rule->window) != 0 ||
+        parse_limit(limit, limit_len, rule->window, &rule->limit) != 0) {
+        return -1;
+    }
+
+    const char* selector = text + limit_len;
+    if (log_selector_parse(&rule->selector, selector, (size_t)(in - selector)) != 0) {
+        return -1;
+    }
+
+    rule->text = strndup(text, len);
+    if (!rule->text) {
+        rate_rule_destroy(rule);
+        return -1;
+    }
+    return 0;
+}
+
+void rate_rule_destroy(rate_rule_t* rule) {
+    if (!rule) {
+        return;
+    }
+
+    log_selector_destroy(&rule->selector);
+    free(rule->text);
+    memset(rule, 0, sizeof(rate_rule_t));
+}
+
+bool rate_rule_matches(const rate_rule_t* rule, log_entry_t* entry) {
+    return rule && log_selector_matches(&rule->selector, entry);
+}
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "rate_tracker.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Timers looked at before the earliest one is evicted regardless
+#define EVICT_ATTEMPTS 4
+
+// Passed to the wheel callback
+typedef struct {
+    rate_tracker_t* tracker;
+    rate_stripe_t* stripe;
+    int64_t now;
+} expire_ctx_t;
+
+static rate_counter_t* counter_of(timer_wheel_timer_t* timer) {
+    return (rate_counter_t*)((char*)timer - offsetof(rate_counter_t, timer));
+}
+
+static uint64_t counter_key(size_t rule, const char* source, size_t len) {
+    return hash64(source, len, (uint64_t)rule + 1);
+}
+
+static rate_stripe_t* stripe_of(rate_tracker_t* tracker, uint64_t key) {
+    return &tracker->stripes[(key >> 60) % RATE_TRACKER_STRIPES];
+}
+
+static int64_t bucket_width(const rate_rule_t* rule) {
+    int64_t width = rule->window / RATE_TRACKER_BUCKETS;
+    return width > 0 ? width : 1;
+}
+
+// Zero the buckets that fell out of the window since the last hit
+static void slide(rate_counter_t* counter, const rate_rule_t* rule, int64_t now) {
+    int64_t epoch = now / bucket_width(rule);
+    if (epoch <= counter->epoch) {
+        return; // Same sub-window, or the clock stepped back
+    }
+
+    if (epoch - counter->epoch >= RATE_TRACKER_BUCKETS) {
+        memset(counter->buckets, 0, sizeof(counter->buckets));
+        counter->total = 0;
+    } else {
+        for (int64_t e = counter->epoch + 1; e <= epoch; e++) {
+            uint32_t* bucket = &counter->buckets[e % RATE_TRACKER_BUCKETS];
+            counter->total -= *bucket;
+            *bucket = 0;
+        }
+    }
+    counter->epoch = epoch;
+}
+
+// Wall-clock time from which the counter holds nothing worth keeping
+static int64_t counter_deadline(const rate_counter_t* counter, const rate_rule_t* rule) {
+    int64_t empty = (counter->epoch + RATE_TRACKER_BUCKETS) * bucket_width(rule);
+    return (empty > counter->quiet_until ? empty : counter->quiet_until) + counter->lag;
+}
+
+static rate_counter_t** chain_of(rate_stripe_t* stripe, uint64_t key) {
+    return &stripe->table[key & stripe->table_mask];
+}
+
+// The key is only a hash: compare the rule and source too
+static rate_counter_t* lookup(rate_stripe_t* stripe, uint64_t key, size_t rule,
+                              const char* source, size_t len) {
+    size_t stored = len < RATE_TRACKER_SOURCE_MAX ? len : RATE_TRACKER_SOURCE_MAX - 1;
+    for (rate_counter_t* counter = *chain_of(stripe, key); counter; counter = counter->hash_next) {
+        if (counter->key == key && counter->rule == rule && counter->source_len == len &&
+            memcmp(counter->source, source, stored) == 0) {
+            return counter;
+        }
+    }
+    return NULL;
+}
+
+static void release(rate_tracker_t* tracker, rate_stripe_t* stripe, rate_counter_t* counter) {
+    rate_counter_t** link = chain_of(stripe, counter->key);
+    while (*link != counter) {
+        link = &(*link)->hash_next;
+    }
+    *link = counter->hash_next;
+
+    timer_wheel_cancel(&stripe->wheel, &counter->timer);
+    counter->hash_next = stripe->free_list;
+    stripe->free_list = counter;
+    size_t active = __atomic_sub_fetch(&tracker->active, 1, __ATOMIC_RELAXED);
+    metrics_set(tracker->keys, active);
+}
+
+// Wheel callback: timers are left in place on hits, so an early one is
+// pushed back and only a counter whose window really emptied is reclaimed
+static void expire_counter(void* arg, timer_wheel_timer_t* timer) {
+    expire_ctx_t* ctx = (expire_ctx_t*)arg;
+    rate_counter_t* counter = counter_of(timer);
+    int64_t deadline = counter_deadline(counter, &ctx->tracker->rules[counter->rule]);
+    if (deadline > ctx->now) {
+        timer_wheel_schedule(&ctx->stripe->wheel, timer, deadline);
+        return;
+    }
+
+    release(ctx->tracker, ctx->stripe, counter);
+    metrics_add(ctx->tracker->expired, 1);
+}
+
+// Reclaim the counter closest to expiring to make room
+static void evict(rate_tracker_t* tracker, rate_stripe_t* stripe) {
+    timer_wheel_timer_t* timer = timer_wheel_earliest(&stripe->wheel);
+    for (int i = 0; timer && i < EVICT_ATTEMPTS; i++) {
+        rate_counter_t* counter = counter_of(timer);
+        int64_t deadline = counter_deadline(counter, &tracker->rules[counter->rule]);
+        if ((int64_t)timer->expires * stripe->wheel.tick + stripe->wheel.origin >= deadline) {
+            break; // Accurate timer
+        }
+        timer_wheel_schedule(&stripe->wheel, timer, deadline);
+        timer = timer_wheel_earliest(&stripe->wheel);
+    }
+
+    if (timer) {
+        release(tracker, stripe, counter_of(timer));
+        metrics_add(tracker->evictions, 1);
+    }
+}
+
+static rate_counter_t* acquire(rate_tracker_t* tracker, rate_stripe_t* stripe, uint64_t key,
+                               size_t rule, const char* source, size_t len, int64_t event,
+                               int64_t lag) {
+    if (!stripe->free_list) {
+        evict(tracker, stripe);
+    }
+    rate_counter_t* counter = stripe->free_list;
+    if (!counter) {
+        return NULL;
+    }
+    stripe->free_list = counter->hash_next;
+
+    memset(counter, 0, sizeof(rate_counter_t));
+    counter->key = key;
+    counter->rule = (uint32_t)rule;
+    counter->epoch = event / bucket_width(&tracker->rules[rule]);
+    counter->lag = lag;
+    counter->source_len = (uint32_t)len;
+    if (len >= sizeof(counter->source)) {
+        len = sizeof(counter->source) - 1;
+    }
+    memcpy(counter->source, source, len);
+    counter->source[len] = '\0';
+    rate_counter_t** chain = chain_of(stripe, key);
+    counter->hash_next = *chain;
+    *chain = counter;
+    timer_wheel_schedule(&stripe->wheel, &counter->timer,
+                         counter_deadline(counter, &tracker->rules[rule]));
+
+    size_t active = __atomic_add_fetch(&tracker->active, 1, __ATOMIC_RELAXED);
+    metrics_set(tracker->keys, active);
+    return counter;
+}
+
+int rate_tracker_init(rate_tracker_t* tracker, const rate_rule_t* rules, size_t num_rules,
+                      size_t capacity, rate_alert_fn alert, void* ctx, int64_t now) {
+    if (!tracker || !rules || num_rules == 0 || capacity == 0 || !alert) {
+        return -1;
+    }
+
+    memset(tracker, 0, sizeof(rate_tracker_t));
+    tracker->stripes = (rate_stripe_t*)calloc(RATE_TRACKER_STRIPES, sizeof(rate_stripe_t));
+    if (!tracker->stripes) {
+        return -1;
+    }
+    tracker->rules = rules;
+    tracker->num_rules = num_rules;
+    tracker->alert = alert;
+    tracker->ctx = ctx;
+
+    size_t per_stripe = (capacity + RATE_TRACKER_STRIPES - 1) / RATE_TRACKER_STRIPES;
+    size_t table_size = 1;
+    while (table_size < per_stripe) {
+        table_size <<= 1;
+    }
+
+    for (size_t i = 0; i < RATE_TRACKER_STRIPES; i++) {
+        rate_stripe_t* stripe = &tracker->stripes[i];
+        stripe->counters = (rate_counter_t*)calloc(per_stripe, sizeof(rate_counter_t));
+        stripe->table = (rate_counter_t**)calloc(table_size, sizeof(rate_counter_t*));
+        if (!stripe->counters || !stripe->table) {
+            free(stripe->counters);
+            free(stripe->table);
+            stripe->counters = NULL;
+            rate_tracker_destroy(tracker);
+            return -1;
+        }
+        stripe->table_mask = table_size - 1;
+        for (size_t j = per_stripe; j > 0; j--) {
+            stripe->counters[j - 1].hash_next = stripe->free_list;
+            stripe->free_list = &stripe->counters[j - 1];
+        }
+        timer_wheel_init(&stripe->wheel, RATE_TRACKER_TICK_NS, now);
+        pthread_mutex_init(&stripe->mutex, NULL);
+    }
+
+    tracker->keys = metrics_register("rates.keys", METRIC_GAUGE);
+    tracker->fired = metrics_register("rates.fired", METRIC_COUNTER);
+    tracker->expired = metrics_register("rates.expired", METRIC_COUNTER);
+    tracker->evictions = metrics_register("rates.evictions", METRIC_COUNTER);
+    metrics_set(tracker->keys, 0);
+    return 0;
+}
+
+void rate_tracker_destroy(rate_tracker_t* tracker) {
+    if (!tracker || !tracker->stripes) {
+        return;
+    }
+
+    for (size_t i = 0; i < RATE_TRACKER_STRIPES; i++) {
+        rate_stripe_t* stripe = &tracker->stripes[i];
+        if (!stripe->counters) {
+            continue;
+        }
+        pthread_mutex_destroy(&stripe->mutex);
+        free(stripe->counters);
+        free(stripe->table);
+    }
+    free(tracker->stripes);
+    memset(tracker, 0, sizeof(rate_tracker_t));
+}
+
+void rate_tracker_observe(rate_tracker_t* tracker, log_entry_t* entry, int64_t now) {
+    if (!tracker || !tracker->stripes || !entry || !entry->source) {
+        return;
+    }
+
+    // Windows run on event time; the lag carries them over to the wall clock
+    int64_t event = entry->timestamp ? entry->timestamp : now;
+    int64_t lag = now > event ? now - event : 0;
+    size_t len = log_entry_source_class_len(entry->source);
+
+    for (size_t i = 0; i < tracker->num_rules; i++) {
+        const rate_rule_t* rule = &tracker->rules[i];
+        if (!rate_rule_matches(rule, entry)) {
+            continue;
+        }
+
+        uint64_t key = counter_key(i, entry->source, len);
+        rate_stripe_t* stripe = stripe_of(tracker, key);
+        uint64_t fired_count = 0;
+
+        pthread_mutex_lock(&stripe->mutex);
+        expire_ctx_t ctx = {tracker, stripe, now};
+        timer_wheel_advance(&stripe->wheel, now, expire_counter, &ctx);
+
+        rate_counter_t* counter = lookup(stripe, key, i, entry->source, len);
+        if (!counter) {
+            counter = acquire(tracker, stripe, key, i, entry->source, len, event, lag);
+        }
+        // An entry from before the window is not counted
+        int64_t epoch = event / bucket_width(rule);
+        if (counter && counter->epoch - epoch < RATE_TRACKER_BUCKETS) {
+            int64_t deadline = counter_deadline(counter, rule);
+            counter->lag = lag;
+            slide(counter, rule, event);
+            uint32_t* bucket = &counter->buckets[epoch % RATE_TRACKER_BUCKETS];
+            if (counter->total < UINT32_MAX) {
+                (*bucket)++;
+                counter->total++;
+            }
+            if (counter->total > rule->limit && event >= counter->quiet_until) {
+                counter->quiet_until = event + rule->window;
+                fired_count = counter->total;
+            }
+            // A shrinking lag moves the deadline earlier, which the
+            // push-back cannot do
+            if (counter_deadline(counter, rule) < deadline) {
+                timer_wheel_schedule(&stripe->wheel, &counter->timer,
+                                     counter_deadline(counter, rule));
+            }
+        }
+        pthread_mutex_unlock(&stripe->mutex);
+
+        if (fired_count > 0) {
+            metrics_add(tracker->fired, 1);
+            tracker->alert(tracker->ctx, rule, entry, fired_count);
+        }
+    }
+}
+
+uint64_t rate_tracker_count(rate_tracker_t* tracker, size_t rule, const char* source, int64_t now) {
+    if (!tracker || !tracker->stripes || rule >= tracker->num_rules || !source) {
+        return 0;
+    }
+
+    size_t len = log_entry_source_class_len(source);
+    uint64_t key = counter_key(rule, source, len);
+    rate_stripe_t* stripe = stripe_of(tracker, key);
+    uint64_t count = 0;
+
+    pthread_mutex_lock(&stripe->mutex);
+    rate_counter_t* counter = lookup(stripe, key, rule, source, len);
+    if (counter) {
+        slide(counter, &tracker->rules[rule], now);
+        count = counter->total;
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+    return count;
+}
+
+size_t rate_tracker_active(const rate_tracker_t* tracker) {
+    return tracker ? __atomic_load_n(&tracker->active, __ATOMIC_RELAXED) : 0;
+}
\ No newline at end of file
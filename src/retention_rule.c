@@ -0,0 +1,104 @@
+#include "retention_rule.h"
+#include "timestamp.h"
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+// "<n>K", "<n>M", "<n>G", "<n>T" or "<n>B"
+static int parse_size(const char* text, uint64_t* bytes) {
+    char* end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || text[0] < '0' || text[0] > '9' || value == 0 || end[0] == '\0' ||
+        end[1] != '\0') {
+        return -1;
+    }
+
+    static const char UNITS[] = "BKMGT";
+    const char* unit = strchr(UNITS, *end);
+    if (!unit) {
+        return -1;
+    }
+    unsigned int shift = 10 * (unsigned int)(unit - UNITS);
+    if (value > (UINT64_MAX >> shift)) {
+        return -1;
+    }
+    *bytes = (uint64_t)value << shift;
+    return 0;
+}
+
+// "<n>s", "<n>m", "<n>h" or "<n>d": unlike other durations, an age needs a unit
+static int parse_age(const char* text, int64_t* ns) {
+    size_t length = strlen(text);
+    if (length < 2 || length > 20 || !strchr("smhd", text[length - 1])) {
+        return -1;
+    }
+    if (text[length - 1] != 'd') {
+        return timestamp_parse_duration(text, ns);
+    }
+
+    // Days as hours
+    char hours[24];
+    memcpy(hours, text, length);
+    hours[length - 1] = 'h';
+    hours[length] = '\0';
+    if (timestamp_parse_duration(hours, ns) != 0 || *ns > INT64_MAX / 24) {
+        return -1;
+    }
+    *ns *= 24;
+    return 0;
+}
+
+int retention_rule_parse(retention_rule_t* rule, const char* text) {
+    if (!rule || !text) {
+        return -1;
+    }
+
+    memset(rule, 0, sizeof(retention_rule_t));
+    char* copy = strdup(text);
+    if (!copy) {
+        return -1;
+    }
+
+    // "<glob> [<age>] [<size>]", a size being the only limit ending in a multiple
+    char* save = NULL;
+    char* glob = strtok_r(copy, " \t", &save);
+    char* limits[3] = {NULL, NULL, NULL};
+    size_t num_limits = 0;
+    char* token;
+    while (num_limits < 3 && (token = strtok_r(NULL, " \t", &save)) != NULL) {
+        limits[num_limits++] = token;
+    }
+
+    bool valid = glob && num_limits >= 1 && num_limits <= 2;
+    for (size_t i = 0; i < num_limits && valid; i++) {
+        if (parse_age(limits[i], &rule->max_age) == 0) {
+            valid = i == 0;
+        } else {
+            valid = rule->max_bytes == 0 && parse_size(limits[i], &rule->max_bytes) == 0;
+        }
+    }
+    if (valid) {
+        rule->source = strdup(glob);
+        rule->text = strdup(text);
+        valid = rule->source && rule->text;
+    }
+    free(copy);
+    if (!valid) {
+        retention_rule_destroy(rule);
+        return -1;
+    }
+    return 0;
+}
+
+void retention_rule_destroy(retention_rule_t* rule) {
+    if (!rule) {
+        return;
+    }
+    free(rule->text);
+    free(rule->source);
+    memset(rule, 0, sizeof(retention_rule_t));
+}
+
+bool retention_rule_matches(const retention_rule_t* rule, const char* source) {
+    return rule && rule->source && source && fnmatch(rule->source, source, 0) == 0;
+}
\ No newline at end of file
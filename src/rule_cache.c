@@ -0,0 +1,290 @@
+#include "rule_cache.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define RULE_CACHE_MIN_SLOTS_PER_SHARD 4
+
+static size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+static void rule_cache_collect_metrics(void* ctx) {
+    rule_cache_t* cache = (rule_cache_t*)ctx;
+    rule_cache_stats_t stats;
+    rule_cache_get_stats(cache, &stats);
+
+    metrics_set(metrics_register("rule_cache.hits", METRIC_COUNTER), stats.hits);
+    metrics_set(metrics_register("rule_cache.misses", METRIC_COUNTER), stats.misses);
+    metrics_set(metrics_register("rule_cache.evictions", METRIC_COUNTER), stats.evictions);
+    metrics_set(metrics_register("rule_cache.collisions", METRIC_COUNTER), stats.collisions);
+    metrics_set(metrics_register("rule_cache.invalidations", METRIC_COUNTER), stats.invalidations);
+    metrics_set(metrics_register("rule_cache.entries", METRIC_GAUGE), stats.entries);
+
+    // Hit rate in basis points (1/100 of a percent)
+    uint64_t lookups = stats.hits + stats.misses;
+    metrics_set(metrics_register("rule_cache.hit_rate_bp", METRIC_GAUGE),
+                lookups ? (stats.hits * 10000) / lookups : 0);
+}
+
+int rule_cache_init(rule_cache_t* cache, size_t capacity) {
+    if (!cache || capacity == 0) {
+        return -1;
+    }
+
+    memset(cache, 0, sizeof(rule_cache_t));
+
+    size_t per_shard = (capacity + RULE_CACHE_NUM_SHARDS - 1) / RULE_CACHE_NUM_SHARDS;
+    if (per_shard < RULE_CACHE_MIN_SLOTS_PER_SHARD) {
+        per_shard = RULE_CACHE_MIN_SLOTS_PER_SHARD;
+    }
+    size_t num_buckets = next_power_of_two(per_shard * 2);
+
+    for (size_t i = 0; i < RULE_CACHE_NUM_SHARDS; i++) {
+        rule_cache_shard_t* shard = &cache->shards[i];
+
+        shard->slots = (rule_cache_slot_t*)calloc(per_shard, sizeof(rule_cache_slot_t));
+        shard->buckets = (int32_t*)malloc(num_buckets * sizeof(int32_t));
+        if (!shard->slots || !shard->buckets ||
+            pthread_mutex_init(&shard->mutex, NULL) != 0) {
+            free(shard->slots);
+            free(shard->buckets);
+            for (size_t j = 0; j < i; j++) {
+                pthread_mutex_destroy(&cache->shards[j].mutex);
+                free(cache->shards[j].slots);
+                free(cache->shards[j].buckets);
+            }
+            memset(cache, 0, sizeof(rule_cache_t));
+            return -1;
+        }
+
+        memset(shard->buckets, 0xff, num_buckets * sizeof(int32_t));
+        shard->num_slots = per_shard;
+        shard->bucket_mask = num_buckets - 1;
+    }
+
+    cache->capacity = per_shard * RULE_CACHE_NUM_SHARDS;
+    metrics_add_collector(rule_cache_collect_metrics, cache);
+
+    return 0;
+}
+
+void rule_cache_destroy(rule_cache_t* cache) {
+    if (!cache || cache->capacity == 0) {
+        return;
+    }
+
+    metrics_remove_collector(rule_cache_collect_metrics, cache);
+
+    for (size_t i = 0; i < RULE_CACHE_NUM_SHARDS; i++) {
+        pthread_mutex_destroy(&cache->shards[i].mutex);
+        free(cache->shards[i].slots);
+        free(cache->shards[i].buckets);
+    }
+
+    memset(cache, 0, sizeof(rule_cache_t));
+}
+
+size_t rule_cache_build_key(const log_entry_t* entry, char* buffer, size_t size) {
+    if (!entry || !buffer) {
+        return 0;
+    }
+    if (size > RULE_CACHE_KEY_MAX) {
+        size = RULE_CACHE_KEY_MAX;
+    }
+
+    // Key layout: source class, 0x1f, level, raw line
+    size_t class_len = log_entry_source_class_len(entry->source);
+    size_t raw_len = strlen(entry->raw_line);
+    size_t total = class_len + 1 + 1 + raw_len;
+    if (total > size) {
+        return 0;
+    }
+
+    char* p = buffer;
+    memcpy(p, entry->source, class_len);
+    p += class_len;
+    *p++ = 0x1f;
+    *p++ = (char)('0' + entry->level);
+    memcpy(p, entry->raw_line, raw_len);
+
+    return total;
+}
+
+// Empty a shard; caller holds the shard mutex
+static void shard_flush(rule_cache_shard_t* shard) {
+    if (shard->num_used == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < shard->num_slots; i++) {
+        shard->slots[i].used = false;
+        shard->slots[i].referenced = false;
+    }
+    memset(shard->buckets, 0xff, (shard->bucket_mask + 1) * sizeof(int32_t));
+    shard->num_used = 0;
+    shard->clock_hand = 0;
+    shard->invalidations++;
+}
+
+static inline rule_cache_shard_t* shard_for(rule_cache_t* cache, uint64_t hash) {
+    // High bits pick the shard, low bits pick the bucket inside it
+    return &cache->shards[(hash >> 60) % RULE_CACHE_NUM_SHARDS];
+}
+
+// Find a slot for key; caller holds the shard mutex
+static int32_t shard_find(rule_cache_shard_t* shard, const char* key, size_t key_len,
+                          uint64_t hash, bool* collided) {
+    int32_t index = shard->buckets[hash & shard->bucket_mask];
+    while (index >= 0) {
+        rule_cache_slot_t* slot = &shard->slots[index];
+        if (slot->hash == hash) {
+            if (slot->key_len == key_len && memcmp(slot->key, key, key_len) == 0) {
+                return index;
+            }
+            // Same 64-bit hash, different key: verified and rejected
+            *collided = true;
+        }
+        index = slot->next;
+    }
+    return -1;
+}
+
+static void shard_unlink(rule_cache_shard_t* shard, int32_t index) {
+    rule_cache_slot_t* slot = &shard->slots[index];
+    int32_t* link = &shard->buckets[slot->hash & shard->bucket_mask];
+    while (*link >= 0) {
+        if (*link == index) {
+            *link = slot->next;
+            return;
+        }
+        link = &shard->slots[*link].next;
+    }
+}
+
+bool rule_cache_lookup(rule_cache_t* cache, const char* key, size_t key_len,
+                       uint64_t hash, rule_cache_value_t* value) {
+    if (!cache || cache->capacity == 0 || !key || key_len > RULE_CACHE_KEY_MAX) {
+        return false;
+    }
+
+    rule_cache_shard_t* shard = shard_for(cache, hash);
+    pthread_mutex_lock(&shard->mutex);
+
+    bool collided = false;
+    int32_t index = shard_find(shard, key, key_len, hash, &collided);
+    if (collided) {
+        shard->collisions++;
+    }
+
+    if (index < 0) {
+        shard->misses++;
+        pthread_mutex_unlock(&shard->mutex);
+        return false;
+    }
+
+    rule_cache_slot_t* slot = &shard->slots[index];
+    slot->referenced = true;
+    if (value) {
+        *value = slot->value;
+    }
+    shard->hits++;
+
+    pthread_mutex_unlock(&shard->mutex);
+    return true;
+}
+
+void rule_cache_insert(rule_cache_t* cache, const char* key, size_t key_len,
+                       uint64_t hash, const rule_cache_value_t* value) {
+    if (!cache || cache->capacity == 0 || !key || key_len > RULE_CACHE_KEY_MAX || !value) {
+        return;
+    }
+
+    rule_cache_shard_t* shard = shard_for(cache, hash);
+    pthread_mutex_lock(&shard->mutex);
+
+    // Another thread may have raced us to the same key
+    bool collided = false;
+    int32_t index = shard_find(shard, key, key_len, hash, &collided);
+    if (index >= 0) {
+        shard->slots[index].value = *value;
+        pthread_mutex_unlock(&shard->mutex);
+        return;
+    }
+
+    if (shard->num_used < shard->num_slots) {
+        index = (int32_t)shard->num_used++;
+    } else {
+        // CLOCK: sweep, clearing reference bits, until an unreferenced slot
+        for (;;) {
+            rule_cache_slot_t* candidate = &shard->slots[shard->clock_hand];
+            size_t current = shard->clock_hand;
+            shard->clock_hand = (shard->clock_hand + 1) % shard->num_slots;
+            if (candidate->referenced) {
+                candidate->referenced = false;
+                continue;
+            }
+            index = (int32_t)current;
+            break;
+        }
+        shard_unlink(shard, index);
+        shard->evictions++;
+    }
+
+    rule_cache_slot_t* slot = &shard->slots[index];
+    slot->hash = hash;
+    slot->value = *value;
+    slot->key_len = (uint16_t)key_len;
+    slot->used = true;
+    slot->referenced = false;
+    memcpy(slot->key, key, key_len);
+
+    size_t bucket = hash & shard->bucket_mask;
+    slot->next = shard->buckets[bucket];
+    shard->buckets[bucket] = index;
+
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void rule_cache_clear(rule_cache_t* cache) {
+    if (!cache || cache->capacity == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < RULE_CACHE_NUM_SHARDS; i++) {
+        rule_cache_shard_t* shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        shard_flush(shard);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+void rule_cache_get_stats(rule_cache_t* cache, rule_cache_stats_t* stats) {
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(rule_cache_stats_t));
+    if (!cache || cache->capacity == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < RULE_CACHE_NUM_SHARDS; i++) {
+        rule_cache_shard_t* shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->collisions += shard->collisions;
+        stats->invalidations += shard->invalidations;
+        stats->entries += shard->num_used;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
\ No newline at end of file
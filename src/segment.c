@@ -0,0 +1,779 @@
+#include "segment.h"
+#include "hash.h"
+#include "token_index.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Sections every segment has, in file order
+static const uint32_t SECTIONS[] = {
+    SEGMENT_TIMESTAMPS, SEGMENT_LEVELS, SEGMENT_SOURCES, SEGMENT_SOURCE_IDS,
+    SEGMENT_LENGTHS, SEGMENT_BLOCKS, SEGMENT_LINES, SEGMENT_BLOOM, SEGMENT_TERMS,
+    SEGMENT_POSTINGS,
+};
+#define NUM_SECTIONS (sizeof(SECTIONS) / sizeof(SECTIONS[0]))
+
+// Growable output buffer; failed stays set once an allocation fails
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} buffer_t;
+
+static uint8_t* buffer_reserve(buffer_t* buffer, size_t length) {
+    if (buffer->failed) {
+        return NULL;
+    }
+    if (buffer->capacity - buffer->size < length) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 65536;
+        while (capacity - buffer->size < length) {
+            capacity *= 2;
+        }
+        uint8_t* data = (uint8_t*)realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = true;
+            return NULL;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return buffer->data + buffer->size;
+}
+
+static void buffer_put(buffer_t* buffer, const void* data, size_t length) {
+    uint8_t* out = buffer_reserve(buffer, length);
+    if (out) {
+        memcpy(out, data, length);
+        buffer->size += length;
+    }
+}
+
+static inline void store_le(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static inline uint64_t load_le(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static void buffer_put_le(buffer_t* buffer, uint64_t value, size_t bytes) {
+    uint8_t* out = buffer_reserve(buffer, bytes);
+    if (out) {
+        store_le(out, value, bytes);
+        buffer->size += bytes;
+    }
+}
+
+static void buffer_put_varint(buffer_t* buffer, uint64_t value) {
+    uint8_t* out = buffer_reserve(buffer, 10);
+    if (!out) {
+        return;
+    }
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    buffer->size += length;
+}
+
+static void buffer_align(buffer_t* buffer) {
+    static const uint8_t ZEROS[8] = {0};
+    buffer_put(buffer, ZEROS, (8 - buffer->size % 8) % 8);
+}
+
+// Varint at *offset, advancing it; false if it runs past end
+static bool read_varint(const uint8_t* data, size_t end, size_t* offset, uint64_t* value) {
+    uint64_t result = 0;
+    for (unsigned int shift = 0; shift < 64 && *offset < end; shift += 7) {
+        uint8_t byte = data[(*offset)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static unsigned int source_width(size_t num_sources) {
+    return num_sources <= 256 ? 1 : (num_sources <= 65536 ? 2 : 4);
+}
+
+// Assign every row its source's index, in order of first appearance
+static int build_sources(const segment_row_t* rows, size_t count, uint32_t* ids,
+                         uint32_t** firsts, size_t* num_sources) {
+    size_t mask = 15;
+    while (mask < count * 2) {
+        mask = mask * 2 + 1;
+    }
+    uint32_t* table = (uint32_t*)calloc(mask + 1, sizeof(uint32_t)); // id + 1, 0: free
+    uint32_t* first = (uint32_t*)malloc(count * sizeof(uint32_t));   // Row naming each source
+    if (!table || !first) {
+        free(table);
+        free(first);
+        return -1;
+    }
+
+    size_t sources = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = hash64(rows[i].source, rows[i].source_len, 0) & mask;
+        while (table[slot] != 0) {
+            const segment_row_t* known = &rows[first[table[slot] - 1]];
+            if (known->source_len == rows[i].source_len &&
+                memcmp(known->source, rows[i].source, known->source_len) == 0) {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if (table[slot] == 0) {
+            first[sources] = (uint32_t)i;
+            table[slot] = (uint32_t)++sources;
+        }
+        ids[i] = table[slot] - 1;
+    }
+    free(table);
+    *firsts = first;
+    *num_sources = sources;
+    return 0;
+}
+
+// Append one block of lines, deflated if that makes it smaller
+static void put_block(buffer_t* file, buffer_t* blocks, const uint8_t* raw, size_t length,
+                      uint32_t first_row) {
+    uint32_t codec = SEGMENT_CODEC_NONE;
+    size_t stored = length;
+    size_t offset = file->size;
+#ifdef HAVE_ZLIB
+    uLongf compressed = compressBound((uLong)length);
+    uint8_t* out = buffer_reserve(file, compressed);
+    if (out && compress2(out, &compressed, raw, (uLong)length, 1) == Z_OK &&
+        compressed < length) {
+        codec = SEGMENT_CODEC_DEFLATE;
+        stored = compressed;
+        file->size += compressed;
+    }
+#endif
+    if (codec == SEGMENT_CODEC_NONE) {
+        buffer_put(file, raw, length);
+    }
+
+    buffer_put_le(blocks, first_row, 4);
+    buffer_put_le(blocks, length, 4);
+    buffer_put_le(blocks, stored, 4);
+    buffer_put_le(blocks, codec, 4);
+    buffer_put_le(blocks, offset, 8);
+}
+
+static int write_file(const char* path, const buffer_t* file) {
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        return -1;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    size_t written = 0;
+    while (written < file->size) {
+        ssize_t n = write(fd, file->data + written, file->size - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += (size_t)n;
+    }
+    // Durable before it becomes visible under its final name
+    bool complete = written == file->size && fdatasync(fd) == 0;
+    if (close(fd) != 0 || !complete || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int segment_write(const char* path, uint64_t id, const segment_row_t* rows, size_t count,
+                  uint64_t* bytes) {
+    return segment_write_replacing(path, id, rows, count, NULL, 0, bytes);
+}
+
+int segment_write_replacing(const char* path, uint64_t id, const segment_row_t* rows,
+                            size_t count, const uint64_t* replaces, size_t num_replaces,
+                            uint64_t* bytes) {
+    if (!path || !rows || count == 0 || count > UINT32_MAX || (num_replaces > 0 && !replaces)) {
+        return -1;
+    }
+    for (size_t i = 1; i < count; i++) {
+        if (rows[i].timestamp < rows[i - 1].timestamp) {
+            return -1;
+        }
+    }
+
+    uint32_t* ids = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t* firsts = NULL;
+    size_t num_sources = 0;
+    if (!ids || build_sources(rows, count, ids, &firsts, &num_sources) != 0) {
+        free(ids);
+        return -1;
+    }
+    token_index_builder_t index;
+    bool indexed = token_index_builder_init(&index) == 0;
+    for (size_t i = 0; i < count && indexed; i++) {
+        indexed = token_index_add(&index, (uint32_t)i, rows[i].line, rows[i].line_len) == 0;
+    }
+    if (!indexed || token_index_finish(&index) != 0) {
+        token_index_builder_destroy(&index);
+        free(firsts);
+        free(ids);
+        return -1;
+    }
+
+    buffer_t file = {0};
+    buffer_t blocks = {0};
+    buffer_t raw = {0};
+    uint32_t kinds[NUM_SECTIONS + 1];
+    uint64_t offsets[NUM_SECTIONS + 1];
+    uint64_t lengths[NUM_SECTIONS + 1];
+    uint64_t raw_bytes = 0;
+    size_t num_blocks = 0;
+    size_t num_sections = NUM_SECTIONS;
+    memcpy(kinds, SECTIONS, sizeof(SECTIONS));
+    if (num_replaces > 0) {
+        kinds[num_sections++] = SEGMENT_REPLACES;
+    }
+
+    // Header and directory are filled in last
+    buffer_reserve(&file, SEGMENT_HEADER_SIZE + num_sections * SEGMENT_SECTION_SIZE);
+    file.size = SEGMENT_HEADER_SIZE + num_sections * SEGMENT_SECTION_SIZE;
+
+    for (size_t s = 0; s < num_sections && !file.failed; s++) {
+        buffer_align(&file);
+        offsets[s] = file.size;
+        switch (kinds[s]) {
+            case SEGMENT_TIMESTAMPS:
+                for (size_t i = 0; i < count; i++) {
+                    int64_t previous = i > 0 ? rows[i - 1].timestamp : rows[0].timestamp;
+                    buffer_put_varint(&file, (uint64_t)rows[i].timestamp - (uint64_t)previous);
+                }
+                break;
+            case SEGMENT_LEVELS:
+                for (size_t i = 0; i < count; i++) {
+                    uint8_t level = (uint8_t)rows[i].level;
+                    buffer_put(&file, &level, 1);
+                }
+                break;
+            case SEGMENT_SOURCES:
+                for (size_t i = 0; i < num_sources; i++) {
+                    const segment_row_t* row = &rows[firsts[i]];
+                    buffer_put_varint(&file, row->source_len);
+                    buffer_put(&file, row->source, row->source_len);
+                }
+                break;
+            case SEGMENT_SOURCE_IDS: {
+                unsigned int width = source_width(num_sources);
+                for (size_t i = 0; i < count; i++) {
+                    buffer_put_le(&file, ids[i], width);
+                }
+                break;
+            }
+            case SEGMENT_LENGTHS:
+                for (size_t i = 0; i < count; i++) {
+                    buffer_put_varint(&file, rows[i].line_len);
+                }
+                break;
+            case SEGMENT_BLOCKS:
+                // Written after the lines, whose offsets it holds
+                break;
+            case SEGMENT_LINES: {
+                size_t first_row = 0;
+                for (size_t i = 0; i < count; i++) {
+                    buffer_put(&raw, rows[i].line, rows[i].line_len);
+                    raw_bytes += rows[i].line_len;
+                    if (raw.size >= SEGMENT_BLOCK_SIZE || i + 1 == count) {
+                        put_block(&file, &blocks, raw.data, raw.size, (uint32_t)first_row);
+                        num_blocks++;
+                        raw.size = 0;
+                        first_row = i + 1;
+                    }
+                }
+                break;
+            }
+            case SEGMENT_BLOOM:
+                buffer_put(&file, index.bloom, index.bloom_size);
+                break;
+            case SEGMENT_TERMS:
+                buffer_put(&file, index.terms, index.terms_size);
+                break;
+            case SEGMENT_POSTINGS:
+                buffer_put(&file, index.postings, index.postings_size);
+                break;
+            case SEGMENT_REPLACES:
+                for (size_t i = 0; i < num_replaces; i++) {
+                    buffer_put_le(&file, replaces[i], 8);
+                }
+                break;
+        }
+        lengths[s] = file.size - offsets[s];
+    }
+
+    // The block table goes at the end, pointed to by its directory entry
+    buffer_align(&file);
+    for (size_t s = 0; s < num_sections; s++) {
+        if (kinds[s] == SEGMENT_BLOCKS) {
+            offsets[s] = file.size;
+            lengths[s] = blocks.size;
+        }
+    }
+    if (!blocks.failed) {
+        buffer_put(&file, blocks.data, blocks.size);
+    }
+
+    int result = -1;
+    if (!file.failed && !blocks.failed && !raw.failed) {
+        uint8_t* header = file.data;
+        memset(header, 0, SEGMENT_HEADER_SIZE);
+        store_le(header, SEGMENT_MAGIC, 4);
+        store_le(header + 4, SEGMENT_VERSION, 2);
+        store_le(header + 6, num_sections, 2);
+        store_le(header + 8, id, 8);
+        store_le(header + 16, (uint64_t)rows[0].timestamp, 8);
+        store_le(header + 24, (uint64_t)rows[count - 1].timestamp, 8);
+        store_le(header + 32, count, 4);
+        store_le(header + 36, num_sources, 4);
+        store_le(header + 40, num_blocks, 4);
+        store_le(header + 48, raw_bytes, 8);
+        for (size_t s = 0; s < num_sections; s++) {
+            uint8_t* entry = file.data + SEGMENT_HEADER_SIZE + s * SEGMENT_SECTION_SIZE;
+            store_le(entry, kinds[s], 4);
+            store_le(entry + 4, 0, 4);
+            store_le(entry + 8, offsets[s], 8);
+            store_le(entry + 16, lengths[s], 8);
+        }
+        result = write_file(path, &file);
+        if (result == 0 && bytes) {
+            *bytes = file.size;
+        }
+    }
+
+    free(file.data);
+    free(blocks.data);
+    free(raw.data);
+    token_index_builder_destroy(&index);
+    free(firsts);
+    free(ids);
+    return result;
+}
+
+// Decode the sources, block table and line offsets of a mapped segment
+static int decode_columns(segment_t* segment, const uint8_t* sources, size_t sources_size,
+                          const uint8_t* lengths, size_t lengths_size, const uint8_t* blocks,
+                          size_t blocks_size) {
+    segment->source_names = (const char**)calloc(segment->num_sources + 1, sizeof(char*));
+    segment->source_lengths =
+        (uint32_t*)calloc(segment->num_sources + 1, sizeof(uint32_t));
+    segment->blocks = (segment_block_t*)calloc(segment->num_blocks + 1, sizeof(segment_block_t));
+    segment->line_offsets = (uint32_t*)calloc(segment->num_rows + 1, sizeof(uint32_t));
+    if (!segment->source_names || !segment->source_lengths || !segment->blocks ||
+        !segment->line_offsets) {
+        return -1;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < segment->num_sources; i++) {
+        uint64_t length;
+        if (!read_varint(sources, sources_size, &offset, &length) ||
+            length > sources_size - offset) {
+            return -1;
+        }
+        segment->source_names[i] = (const char*)sources + offset;
+        segment->source_lengths[i] = (uint32_t)length;
+        offset += length;
+    }
+
+    if (blocks_size < segment->num_blocks * SEGMENT_BLOCK_ENTRY_SIZE) {
+        return -1;
+    }
+    for (size_t b = 0; b < segment->num_blocks; b++) {
+        const uint8_t* entry = blocks + b * SEGMENT_BLOCK_ENTRY_SIZE;
+        segment_block_t* block = &segment->blocks[b];
+        block->first_row = (uint32_t)load_le(entry, 4);
+        block->raw_length = (uint32_t)load_le(entry + 4, 4);
+        block->stored_length = (uint32_t)load_le(entry + 8, 4);
+        block->codec = (uint32_t)load_le(entry + 12, 4);
+        block->offset = load_le(entry + 16, 8);
+        bool ordered = b == 0 ? block->first_row == 0
+                              : block->first_row > segment->blocks[b - 1].first_row;
+        if (block->offset < (uint64_t)(segment->line_data - segment->map) ||
+            block->offset > segment->size ||
+            block->stored_length > segment->size - block->offset || !ordered ||
+            block->first_row >= segment->num_rows) {
+            return -1;
+        }
+    }
+
+    // Offsets restart at every block; each block's lengths must add up
+    offset = 0;
+    size_t b = 0;
+    uint64_t within = 0;
+    for (size_t row = 0; row < segment->num_rows; row++) {
+        if (b + 1 < segment->num_blocks && row == segment->blocks[b + 1].first_row) {
+            if (within != segment->blocks[b].raw_length) {
+                return -1;
+            }
+            b++;
+            within = 0;
+        }
+        uint64_t length;
+        if (!read_varint(lengths, lengths_size, &offset, &length)) {
+            return -1;
+        }
+        segment->line_offsets[row] = (uint32_t)within;
+        within += length;
+    }
+    return segment->num_blocks > 0 && within == segment->blocks[b].raw_length ? 0 : -1;
+}
+
+int segment_open(segment_t* segment, const char* path) {
+    if (!segment || !path) {
+        return -1;
+    }
+    memset(segment, 0, sizeof(segment_t));
+    segment->cached_block = SIZE_MAX;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < SEGMENT_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    segment->map = (const uint8_t*)map;
+    segment->size = (size_t)st.st_size;
+
+    const uint8_t* header = segment->map;
+    size_t num_sections = (size_t)load_le(header + 6, 2);
+    if (load_le(header, 4) != SEGMENT_MAGIC || load_le(header + 4, 2) != SEGMENT_VERSION ||
+        segment->size < SEGMENT_HEADER_SIZE + num_sections * SEGMENT_SECTION_SIZE) {
+        segment_close(segment);
+        return -1;
+    }
+    segment->id = load_le(header + 8, 8);
+    segment->min_time = (int64_t)load_le(header + 16, 8);
+    segment->max_time = (int64_t)load_le(header + 24, 8);
+    segment->num_rows = (size_t)load_le(header + 32, 4);
+    segment->num_sources = (size_t)load_le(header + 36, 4);
+    segment->num_blocks = (size_t)load_le(header + 40, 4);
+    segment->raw_bytes = load_le(header + 48, 8);
+    segment->source_width = source_width(segment->num_sources);
+
+    const uint8_t* sources = NULL;
+    const uint8_t* lengths = NULL;
+    const uint8_t* blocks = NULL;
+    size_t sources_size = 0;
+    size_t lengths_size = 0;
+    size_t blocks_size = 0;
+    bool complete = true;
+    for (size_t s = 0; s < num_sections; s++) {
+        const uint8_t* entry = header + SEGMENT_HEADER_SIZE + s * SEGMENT_SECTION_SIZE;
+        uint32_t kind = (uint32_t)load_le(entry, 4);
+        uint64_t offset = load_le(entry + 8, 8);
+        uint64_t length = load_le(entry + 16, 8);
+        if (offset > segment->size || length > segment->size - offset) {
+            complete = false;
+            break;
+        }
+        const uint8_t* data = segment->map + offset;
+        switch (kind) {
+            case SEGMENT_TIMESTAMPS:
+                segment->timestamp_data = data;
+                segment->timestamp_size = (size_t)length;
+                break;
+            case SEGMENT_LEVELS:
+                complete &= length >= segment->num_rows;
+                segment->levels = data;
+                break;
+            case SEGMENT_SOURCES:
+                sources = data;
+                sources_size = (size_t)length;
+                break;
+            case SEGMENT_SOURCE_IDS:
+                complete &= length >= segment->num_rows * segment->source_width;
+                segment->source_ids = data;
+                break;
+            case SEGMENT_LENGTHS:
+                lengths = data;
+                lengths_size = (size_t)length;
+                break;
+            case SEGMENT_BLOCKS:
+                blocks = data;
+                blocks_size = (size_t)length;
+                break;
+            case SEGMENT_LINES:
+                segment->line_data = data;
+                segment->line_size = (size_t)length;
+                break;
+            case SEGMENT_BLOOM:
+                segment->bloom = data;
+                segment->bloom_size = (size_t)length;
+                break;
+            case SEGMENT_TERMS:
+                segment->terms = data;
+                segment->num_terms = (size_t)length / TOKEN_INDEX_TERM_SIZE;
+                break;
+            case SEGMENT_POSTINGS:
+                segment->postings = data;
+                segment->postings_size = (size_t)length;
+                break;
+            case SEGMENT_REPLACES:
+                segment->replaces = data;
+                segment->num_replaces = (size_t)length / 8;
+                break;
+            default:
+                break; // Added by a later version
+        }
+    }
+
+    if (!complete || segment->num_rows == 0 || !segment->timestamp_data || !segment->levels ||
+        !sources || !segment->source_ids || !lengths || !blocks || !segment->line_data ||
+        decode_columns(segment, sources, sources_size, lengths, lengths_size, blocks,
+                       blocks_size) != 0) {
+        segment_close(segment);
+        return -1;
+    }
+    for (size_t row = 0; row < segment->num_rows; row++) {
+        if (segment_source_id(segment, row) >= segment->num_sources) {
+            segment_close(segment);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void segment_close(segment_t* segment) {
+    if (!segment) {
+        return;
+    }
+    if (segment->map) {
+        munmap((void*)segment->map, segment->size);
+    }
+    free(segment->source_names);
+    free(segment->source_lengths);
+    free(segment->blocks);
+    free(segment->line_offsets);
+    free(segment->timestamps);
+    free(segment->block_data);
+    memset(segment, 0, sizeof(segment_t));
+    segment->cached_block = SIZE_MAX;
+}
+
+const int64_t* segment_timestamps(segment_t* segment) {
+    if (!segment || !segment->map) {
+        return NULL;
+    }
+    if (segment->timestamps) {
+        return segment->timestamps;
+    }
+
+    int64_t* timestamps = (int64_t*)malloc(segment->num_rows * sizeof(int64_t));
+    if (!timestamps) {
+        return NULL;
+    }
+    uint64_t time = (uint64_t)segment->min_time;
+    size_t offset = 0;
+    for (size_t row = 0; row < segment->num_rows; row++) {
+        uint64_t delta;
+        if (!read_varint(segment->timestamp_data, segment->timestamp_size, &offset, &delta)) {
+            free(timestamps);
+            return NULL;
+        }
+        time += delta;
+        timestamps[row] = (int64_t)time;
+    }
+    segment->timestamps = timestamps;
+    return timestamps;
+}
+
+uint32_t segment_source_id(const segment_t* segment, size_t row) {
+    return (uint32_t)load_le(segment->source_ids + row * segment->source_width,
+                             segment->source_width);
+}
+
+// Block holding a row (blocks are sorted by first row)
+static size_t find_block(const segment_t* segment, size_t row) {
+    size_t low = 0;
+    size_t high = segment->num_blocks;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (segment->blocks[middle].first_row <= row) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Raw bytes of a block, inflated into block_data if stored compressed
+static const char* block_bytes(segment_t* segment, size_t index) {
+    const segment_block_t* block = &segment->blocks[index];
+    const uint8_t* stored = segment->map + block->offset;
+    if (block->codec == SEGMENT_CODEC_NONE) {
+        return block->stored_length == block->raw_length ? (const char*)stored : NULL;
+    }
+    if (segment->cached_block == index) {
+        return segment->block_data;
+    }
+#ifdef HAVE_ZLIB
+    if (block->codec == SEGMENT_CODEC_DEFLATE) {
+        if (segment->block_capacity < block->raw_length) {
+            char* data = (char*)realloc(segment->block_data, block->raw_length);
+            if (!data) {
+                return NULL;
+            }
+            segment->block_data = data;
+            segment->block_capacity = block->raw_length;
+        }
+        uLongf length = block->raw_length;
+        if (uncompress((Bytef*)segment->block_data, &length, stored, block->stored_length) !=
+                Z_OK || length != block->raw_length) {
+            segment->cached_block = SIZE_MAX;
+            return NULL;
+        }
+        segment->cached_block = index;
+        return segment->block_data;
+    }
+#endif
+    return NULL;
+}
+
+// Length of a row's line within its block
+static size_t line_length(const segment_t* segment, size_t index, size_t row) {
+    size_t end = row + 1 < segment->num_rows &&
+                         (index + 1 == segment->num_blocks ||
+                          row + 1 < segment->blocks[index + 1].first_row)
+                     ? segment->line_offsets[row + 1]
+                     : segment->blocks[index].raw_length;
+    return end - segment->line_offsets[row];
+}
+
+const char* segment_line(segment_t* segment, size_t row, size_t* length) {
+    if (!segment || !segment->map || row >= segment->num_rows || !length) {
+        return NULL;
+    }
+    size_t index = find_block(segment, row);
+    const char* data = block_bytes(segment, index);
+    if (!data) {
+        return NULL;
+    }
+    *length = line_length(segment, index, row);
+    return data + segment->line_offsets[row];
+}
+
+size_t segment_line_length(const segment_t* segment, size_t row) {
+    if (!segment || !segment->map || row >= segment->num_rows) {
+        return 0;
+    }
+    return line_length(segment, find_block(segment, row), row);
+}
+
+bool segment_may_contain(const segment_t* segment, const uint64_t* hashes, size_t count) {
+    if (!segment || !segment->bloom) {
+        return true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!token_index_bloom_test(segment->bloom, segment->bloom_size, hashes[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int segment_find(const segment_t* segment, const uint64_t* hashes, size_t count,
+                 uint32_t** rows, size_t* num_rows) {
+    if (!segment || !segment->terms || !segment->postings || !hashes || count == 0 ||
+        count > TOKEN_INDEX_MAX_QUERY || !rows || !num_rows) {
+        return -1;
+    }
+    *rows = NULL;
+    *num_rows = 0;
+
+    // Start from the shortest list so every intersection is as small as possible
+    uint32_t offsets[TOKEN_INDEX_MAX_QUERY];
+    uint32_t counts[TOKEN_INDEX_MAX_QUERY];
+    size_t shortest = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!token_index_lookup(segment->terms, segment->num_terms, hashes[i], &offsets[i],
+                                &counts[i])) {
+            return 0;
+        }
+        if (counts[i] > segment->num_rows) {
+            return -1;
+        }
+        if (counts[i] < counts[shortest]) {
+            shortest = i;
+        }
+    }
+
+    uint32_t* result = (uint32_t*)malloc((counts[shortest] + 1) * sizeof(uint32_t));
+    uint32_t* other = count > 1 ? (uint32_t*)malloc((segment->num_rows + 1) * sizeof(uint32_t))
+                                : NULL;
+    if (!result || (count > 1 && !other) ||
+        token_index_decode(segment->postings, segment->postings_size, offsets[shortest],
+                           counts[shortest], result) != 0) {
+        free(result);
+        free(other);
+        return -1;
+    }
+    size_t found = counts[shortest];
+    for (size_t i = 0; i < count && found > 0; i++) {
+        if (i == shortest) {
+            continue;
+        }
+        if (token_index_decode(segment->postings, segment->postings_size, offsets[i], counts[i],
+                               other) != 0) {
+            free(result);
+            free(other);
+            return -1;
+        }
+        found = token_index_intersect(result, found, other, counts[i]);
+    }
+    free(other);
+    if (found > 0 && result[found - 1] >= segment->num_rows) {
+        free(result);
+        return -1;
+    }
+    *rows = result;
+    *num_rows = found;
+    return 0;
+}
+
+uint64_t segment_replaced_id(const segment_t* segment, size_t index) {
+    return segment && index < segment->num_replaces ? load_le(segment->replaces + 8 * index, 8)
+                                                    : 0;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "sequence_rule.h"
+#include "log_selector.h"
+#include "timestamp.h"
+#include <stdlib.h>
+#include <string.h>
+
+int sequence_rule_parse(sequence_rule_t* rule, const char* text) {
+    if (!rule || !text) {
+        return -1;
+    }
+
+    memset(rule, 0, sizeof(sequence_rule_t));
+
+    while (*text == ' ') text++;
+    size_t len = strlen(text);
+    while (len > 0 && text[len - 1] == ' ') len--;
+
+    // "<steps> within <window>"
+    const char* within = NULL;
+    for (const char* p = text; p + 8 <= text + len; p++) {
+        if (strncmp(p, " within ", 8) == 0) {
+            within = p;
+        }
+    }
+    if (!within) {
+        return -1;
+    }
+
+    char window[32];
+    const char* window_start = within + 8;
+    while (*window_start == ' ') window_start++;
+    size_t window_len = (size_t)(text + len - window_start);
+    if (window_len == 0 || window_len >= sizeof(window)) {
+        return -1;
+    }
+    memcpy(window, window_start, window_len);
+    window[window_len] = '\0';
+    if (timestamp_parse_duration(window, &rule->window) != 0) {
+        return -1;
+    }
+
+    // Steps are separated by "->"
+    const char* step = text;
+    while (step < within) {
+        const char* end = step;
+        while (end < within && !(end + 1 < within && end[0] == '-' && end[1] == '>')) {
+            end++;
+        }
+        if (rule->num_steps == SEQUENCE_RULE_MAX_STEPS || rule->absence) {
+            sequence_rule_destroy(rule);
+            return -1; // Too many steps, or a step after the negated one
+        }
+
+        const char* start = step;
+        while (start < end && *start == ' ') start++;
+        if (start < end && *start == '!') {
+            rule->absence = true;
+            start++;
+        }
+        if (log_selector_parse(&rule->steps[rule->num_steps], start, (size_t)(end - start)) != 0) {
+            sequence_rule_destroy(rule);
+            return -1;
+        }
+        rule->num_steps++;
+        step = end < within ? end + 2 : end;
+    }
+
+    // A lone step (negated or not) has nothing to correlate
+    if (rule->num_steps < 2) {
+        sequence_rule_destroy(rule);
+        return -1;
+    }
+
+    rule->text = strndup(text, len);
+    if (!rule->text) {
+        sequence_rule_destroy(rule);
+        return -1;
+    }
+    return 0;
+}
+
+void sequence_rule_destroy(sequence_rule_t* rule) {
+    if (!rule) {
+        return;
+    }
+
+    for (size_t i = 0; i < rule->num_steps; i++) {
+        log_selector_destroy(&rule->steps[i]);
+    }
+    free(rule->text);
+    memset(rule, 0, sizeof(sequence_rule_t));
+}
\ No newline at end of file
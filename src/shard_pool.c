@@ -0,0 +1,391 @@
+#include "shard_pool.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#define INITIAL_RING_CAPACITY 16
+#define MAX_MOVES_PER_REBALANCE 8
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool is_running(const shard_pool_t* pool) {
+    return __atomic_load_n(&pool->running, __ATOMIC_ACQUIRE);
+}
+
+static void destroy_entries(log_entry_t** entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        log_entry_destroy(entries[i]);
+    }
+}
+
+// Appends a batch, blocking while the shard is over its limit
+static int shard_push(shard_t* shard, shard_batch_t* batch) {
+    shard_pool_t* pool = shard->pool;
+    pthread_mutex_lock(&shard->mutex);
+
+    // A batch larger than the limit still goes through alone
+    while (pool->max_pending > 0 && is_running(pool) && shard->pending > 0 &&
+           shard->pending + batch->count > pool->max_pending) {
+        pthread_cond_wait(&shard->space, &shard->mutex);
+    }
+    if (!is_running(pool)) {
+        pthread_mutex_unlock(&shard->mutex);
+        return -1;
+    }
+
+    if (shard->count == shard->capacity) {
+        // Grow and unwrap the ring
+        size_t capacity = shard->capacity ? shard->capacity * 2 : INITIAL_RING_CAPACITY;
+        shard_batch_t** ring = (shard_batch_t**)malloc(capacity * sizeof(shard_batch_t*));
+        if (!ring) {
+            pthread_mutex_unlock(&shard->mutex);
+            return -1;
+        }
+        for (size_t i = 0; i < shard->count; i++) {
+            ring[i] = shard->ring[(shard->head + i) & (shard->capacity - 1)];
+        }
+        free(shard->ring);
+        shard->ring = ring;
+        shard->capacity = capacity;
+        shard->head = 0;
+    }
+
+    shard->ring[(shard->head + shard->count) & (shard->capacity - 1)] = batch;
+    shard->count++;
+    shard->pending += batch->count;
+    metrics_set(shard->pending_gauge, shard->pending);
+    pthread_cond_signal(&shard->work);
+
+    pthread_mutex_unlock(&shard->mutex);
+    return 0;
+}
+
+// Caller holds the shard mutex
+static shard_batch_t* shard_pop(shard_t* shard) {
+    if (shard->count == 0) {
+        return NULL;
+    }
+
+    shard_batch_t* batch = shard->ring[shard->head];
+    shard->head = (shard->head + 1) & (shard->capacity - 1);
+    shard->count--;
+    shard->pending -= batch->count;
+    return batch;
+}
+
+static void* shard_thread_func(void* arg) {
+    shard_t* shard = (shard_t*)arg;
+    shard_pool_t* pool = shard->pool;
+
+    for (;;) {
+        pthread_mutex_lock(&shard->mutex);
+        while (is_running(pool) && shard->count == 0) {
+            pthread_cond_wait(&shard->work, &shard->mutex);
+        }
+        if (!is_running(pool)) {
+            pthread_mutex_unlock(&shard->mutex);
+            break;
+        }
+        shard_batch_t* batch = shard_pop(shard);
+        metrics_set(shard->pending_gauge, shard->pending);
+        if (pool->max_pending > 0) {
+            pthread_cond_broadcast(&shard->space);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+
+        // This shard owns the slot until inflight drops to zero
+        shard_slot_t* slot = &pool->slots[batch->slot];
+        for (size_t i = 0; i < batch->count; i++) {
+            pool->fn(pool->ctx, batch->entries[i]);
+        }
+        __atomic_sub_fetch(&slot->inflight, batch->count, __ATOMIC_RELEASE);
+        metrics_add(shard->entries, batch->count);
+        free(batch);
+    }
+
+    return NULL;
+}
+
+static void publish_slot_counts(shard_pool_t* pool) {
+    memset(pool->shard_load, 0, pool->num_shards * sizeof(uint64_t));
+    for (size_t i = 0; i < SHARD_POOL_SLOTS; i++) {
+        pool->shard_load[pool->slots[i].owner]++;
+    }
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        metrics_set(pool->shards[i].slots, pool->shard_load[i]);
+    }
+}
+
+// Caller holds route_mutex
+static size_t rebalance_locked(shard_pool_t* pool) {
+    if (pool->num_shards < 2) {
+        return 0;
+    }
+
+    uint64_t* load = pool->shard_load;
+    memset(load, 0, pool->num_shards * sizeof(uint64_t));
+    for (size_t i = 0; i < SHARD_POOL_SLOTS; i++) {
+        load[pool->slots[i].owner] += pool->slots[i].load;
+    }
+
+    size_t moved = 0;
+    while (moved < MAX_MOVES_PER_REBALANCE) {
+        size_t hot = 0;
+        size_t cold = 0;
+        for (size_t i = 1; i < pool->num_shards; i++) {
+            if (load[i] > load[hot]) {
+                hot = i;
+            }
+            if (load[i] < load[cold]) {
+                cold = i;
+            }
+        }
+
+        // Ignore small or relative imbalances under a quarter of the hot load
+        uint64_t gap = load[hot] - load[cold];
+        if (gap < SHARD_POOL_BATCH || gap * 4 < load[hot]) {
+            break;
+        }
+
+        // Move the idle slot whose load best halves the gap; a slot at
+        // least as loaded as the gap would only swap hot and cold
+        size_t best = SHARD_POOL_SLOTS;
+        uint64_t best_distance = UINT64_MAX;
+        for (size_t i = 0; i < SHARD_POOL_SLOTS; i++) {
+            shard_slot_t* slot = &pool->slots[i];
+            if (slot->owner != hot || slot->load == 0 || slot->load >= gap ||
+                __atomic_load_n(&slot->inflight, __ATOMIC_ACQUIRE) != 0) {
+                continue;
+            }
+            uint64_t twice = slot->load * 2;
+            uint64_t distance = twice > gap ? twice - gap : gap - twice;
+            if (distance < best_distance) {
+                best = i;
+                best_distance = distance;
+            }
+        }
+        if (best == SHARD_POOL_SLOTS) {
+            break;
+        }
+
+        pool->slots[best].owner = (uint32_t)cold;
+        load[hot] -= pool->slots[best].load;
+        load[cold] += pool->slots[best].load;
+        moved++;
+    }
+
+    for (size_t i = 0; i < SHARD_POOL_SLOTS; i++) {
+        pool->slots[i].load >>= 1;
+    }
+
+    if (moved > 0) {
+        metrics_add(pool->rebalances, moved);
+        publish_slot_counts(pool);
+    }
+    return moved;
+}
+
+int shard_pool_init(shard_pool_t* pool, size_t num_shards, size_t max_pending,
+                    int rebalance_interval, shard_pool_fn fn, void* ctx) {
+    if (!pool || num_shards == 0 || !fn) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(shard_pool_t));
+    pool->shards = (shard_t*)calloc(num_shards, sizeof(shard_t));
+    pool->slots = (shard_slot_t*)calloc(SHARD_POOL_SLOTS, sizeof(shard_slot_t));
+    pool->shard_load = (uint64_t*)calloc(num_shards, sizeof(uint64_t));
+    if (!pool->shards || !pool->slots || !pool->shard_load) {
+        free(pool->shards);
+        free(pool->slots);
+        free(pool->shard_load);
+        memset(pool, 0, sizeof(shard_pool_t));
+        return -1;
+    }
+
+    pool->num_shards = num_shards;
+    pool->max_pending = max_pending;
+    pool->rebalance_interval_ns = rebalance_interval > 0
+        ? (uint64_t)rebalance_interval * 1000000000ULL : 0;
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pthread_mutex_init(&pool->route_mutex, NULL);
+
+    for (size_t i = 0; i < SHARD_POOL_SLOTS; i++) {
+        pool->slots[i].owner = (uint32_t)(i % num_shards);
+    }
+
+    for (size_t i = 0; i < num_shards; i++) {
+        shard_t* shard = &pool->shards[i];
+        shard->pool = pool;
+        shard->index = i;
+        pthread_mutex_init(&shard->mutex, NULL);
+        pthread_cond_init(&shard->work, NULL);
+        pthread_cond_init(&shard->space, NULL);
+    }
+
+    return 0;
+}
+
+int shard_pool_start(shard_pool_t* pool) {
+    if (!pool || !pool->shards || is_running(pool)) {
+        return -1;
+    }
+
+    pool->rebalances = metrics_register("processor.shard.rebalances", METRIC_COUNTER);
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        shard_t* shard = &pool->shards[i];
+        char name[METRICS_NAME_MAX];
+        snprintf(name, sizeof(name), "processor.shard%zu.entries", i);
+        shard->entries = metrics_register(name, METRIC_COUNTER);
+        snprintf(name, sizeof(name), "processor.shard%zu.pending", i);
+        shard->pending_gauge = metrics_register(name, METRIC_GAUGE);
+        snprintf(name, sizeof(name), "processor.shard%zu.slots", i);
+        shard->slots = metrics_register(name, METRIC_GAUGE);
+    }
+    publish_slot_counts(pool);
+    pool->next_rebalance_ns = monotonic_ns() + pool->rebalance_interval_ns;
+
+    __atomic_store_n(&pool->running, true, __ATOMIC_RELEASE);
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        shard_t* shard = &pool->shards[i];
+        if (pthread_create(&shard->thread, NULL, shard_thread_func, shard) != 0) {
+            shard_pool_stop(pool);
+            return -1;
+        }
+        shard->started = true;
+    }
+
+    return 0;
+}
+
+void shard_pool_stop(shard_pool_t* pool) {
+    if (!pool || !pool->shards) {
+        return;
+    }
+
+    __atomic_store_n(&pool->running, false, __ATOMIC_RELEASE);
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        shard_t* shard = &pool->shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        pthread_cond_broadcast(&shard->work);
+        pthread_cond_broadcast(&shard->space);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        if (pool->shards[i].started) {
+            pthread_join(pool->shards[i].thread, NULL);
+            pool->shards[i].started = false;
+        }
+    }
+}
+
+void shard_pool_destroy(shard_pool_t* pool) {
+    if (!pool || !pool->shards) {
+        return;
+    }
+
+    shard_pool_stop(pool);
+
+    for (size_t i = 0; i < pool->num_shards; i++) {
+        shard_t* shard = &pool->shards[i];
+        shard_batch_t* batch;
+        while ((batch = shard_pop(shard)) != NULL) {
+            destroy_entries(batch->entries, batch->count);
+            free(batch);
+        }
+        free(shard->ring);
+        pthread_cond_destroy(&shard->space);
+        pthread_cond_destroy(&shard->work);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+
+    pthread_mutex_destroy(&pool->route_mutex);
+    free(pool->shard_load);
+    free(pool->slots);
+    free(pool->shards);
+    memset(pool, 0, sizeof(shard_pool_t));
+}
+
+int shard_pool_submit(shard_pool_t* pool, log_entry_t** entries, size_t count,
+                      uint64_t affinity) {
+    if (!entries || count == 0) {
+        return 0;
+    }
+    if (!pool || !is_running(pool)) {
+        destroy_entries(entries, count);
+        return -1;
+    }
+
+    // Route under the lock: raising inflight here keeps the slot from
+    // moving until these entries have been processed
+    size_t index = (size_t)(affinity & (SHARD_POOL_SLOTS - 1));
+    shard_slot_t* slot = &pool->slots[index];
+    pthread_mutex_lock(&pool->route_mutex);
+    __atomic_add_fetch(&slot->inflight, count, __ATOMIC_ACQ_REL);
+    slot->load += count;
+    shard_t* shard = &pool->shards[slot->owner];
+    if (pool->rebalance_interval_ns > 0) {
+        uint64_t now = monotonic_ns();
+        if (now >= pool->next_rebalance_ns) {
+            rebalance_locked(pool);
+            pool->next_rebalance_ns = now + pool->rebalance_interval_ns;
+        }
+    }
+    pthread_mutex_unlock(&pool->route_mutex);
+
+    int result = 0;
+    for (size_t offset = 0; offset < count; offset += SHARD_POOL_BATCH) {
+        size_t chunk = count - offset < SHARD_POOL_BATCH ? count - offset : SHARD_POOL_BATCH;
+
+        shard_batch_t* batch = (shard_batch_t*)malloc(sizeof(shard_batch_t));
+        if (!batch) {
+            destroy_entries(entries + offset, chunk);
+            __atomic_sub_fetch(&slot->inflight, chunk, __ATOMIC_RELEASE);
+            result = -1;
+            continue;
+        }
+        batch->slot = index;
+        batch->count = chunk;
+        memcpy(batch->entries, entries + offset, chunk * sizeof(log_entry_t*));
+
+        if (shard_push(shard, batch) != 0) {
+            destroy_entries(batch->entries, chunk);
+            free(batch);
+            __atomic_sub_fetch(&slot->inflight, chunk, __ATOMIC_RELEASE);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+size_t shard_pool_rebalance(shard_pool_t* pool) {
+    if (!pool || !pool->slots) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->route_mutex);
+    size_t moved = rebalance_locked(pool);
+    pthread_mutex_unlock(&pool->route_mutex);
+    return moved;
+}
+
+size_t shard_pool_shard_of(shard_pool_t* pool, uint64_t affinity) {
+    if (!pool || !pool->slots) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->route_mutex);
+    size_t owner = pool->slots[affinity & (SHARD_POOL_SLOTS - 1)].owner;
+    pthread_mutex_unlock(&pool->route_mutex);
+    return owner;
+}
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "sink_spec.h"
+#include "log_selector.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SINK_ROUTE_MAX_SINKS 16
+
+static const struct {
+    const char* name;
+    sink_type_t type;
+} SINK_TYPES[] = {
+    {"file", SINK_FILE},
+    {"stdout", SINK_STDOUT},
+    {"tcp", SINK_TCP},
+    {"unix", SINK_UNIX},
+    {"http", SINK_HTTP},
+};
+
+const char* sink_type_to_string(sink_type_t type) {
+    for (size_t i = 0; i < sizeof(SINK_TYPES) / sizeof(SINK_TYPES[0]); i++) {
+        if (SINK_TYPES[i].type == type) {
+            return SINK_TYPES[i].name;
+        }
+    }
+    return "unknown";
+}
+
+// Names end up in metric names: letters, digits, '_' and '-' only
+static bool valid_name(const char* name, size_t len) {
+    if (len == 0 || len > 32) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// "host:port" with a port in 1..65535
+static bool valid_address(const char* target) {
+    const char* colon = strrchr(target, ':');
+    if (!colon || colon == target) {
+        return false;
+    }
+    char* end;
+    long port = strtol(colon + 1, &end, 10);
+    return end != colon + 1 && *end == '\0' && port > 0 && port <= 65535;
+}
+
+static bool valid_target(sink_type_t type, const char* target) {
+    switch (type) {
+        case SINK_TCP:
+            return valid_address(target);
+        case SINK_HTTP:
+            return strncmp(target, "http://", 7) == 0 && target[7] != '\0' && target[7] != '/';
+        default:
+            return target[0] != '\0';
+    }
+}
+
+// "format=<name>" or "<option>=<n>" with n > 0
+static int parse_option(sink_spec_t* spec, const char* word, size_t len) {
+    const char* equals = memchr(word, '=', len);
+    if (!equals) {
+        return -1;
+    }
+
+    char value[32];
+    size_t value_len = len - (size_t)(equals + 1 - word);
+    if (value_len == 0 || value_len >= sizeof(value)) {
+        return -1;
+    }
+    memcpy(value, equals + 1, value_len);
+    value[value_len] = '\0';
+    if (equals - word == 6 && strncmp(word, "format", 6) == 0) {
+        if (alert_format_parse(value, &spec->format) != 0) {
+            return -1;
+        }
+        spec->has_format = true;
+        return 0;
+    }
+
+    char* end;
+    unsigned long long number = strtoull(value, &end, 10);
+    if (*end != '\0' || value[0] == '-' || number == 0) {
+        return -1;
+    }
+
+    size_t key_len = (size_t)(equals - word);
+    if (key_len == 5 && strncmp(word, "queue", 5) == 0) {
+        spec->queue_size = (size_t)number;
+    } else if (key_len == 4 && strncmp(word, "rate", 4) == 0) {
+        spec->rate = (size_t)number;
+    } else if (key_len == 6 && strncmp(word, "buffer", 6) == 0) {
+        spec->buffer_size = (size_t)number;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int sink_spec_parse(sink_spec_t* spec, const char* text) {
+    if (!spec || !text) {
+        return -1;
+    }
+
+    memset(spec, 0, sizeof(sink_spec_t));
+
+    // "<name> <type> [<target>] [option=value ...]"
+    const char* words[8];
+    size_t lengths[8];
+    size_t count = 0;
+    const char* p = text;
+    while (*p) {
+        while (*p == ' ') p++;
+        if (*p == '\0') {
+            break;
+        }
+        if (count == sizeof(words) / sizeof(words[0])) {
+            return -1;
+        }
+        words[count] = p;
+        lengths[count] = strcspn(p, " ");
+        p += lengths[count++];
+    }
+    if (count < 2 || !valid_name(words[0], lengths[0])) {
+        return -1;
+    }
+
+    size_t type = 0;
+    size_t num_types = sizeof(SINK_TYPES) / sizeof(SINK_TYPES[0]);
+    while (type < num_types && (strlen(SINK_TYPES[type].name) != lengths[1] ||
+                                strncmp(words[1], SINK_TYPES[type].name, lengths[1]) != 0)) {
+        type++;
+    }
+    if (type == num_types) {
+        return -1;
+    }
+    spec->type = SINK_TYPES[type].type;
+
+    size_t next = 2;
+    if (spec->type != SINK_STDOUT) {
+        if (count < 3) {
+            return -1;
+        }
+        spec->target = strndup(words[2], lengths[2]);
+        if (!spec->target || !valid_target(spec->type, spec->target)) {
+            sink_spec_destroy(spec);
+            return -1;
+        }
+        next = 3;
+    }
+    for (; next < count; next++) {
+        if (parse_option(spec, words[next], lengths[next]) != 0) {
+            sink_spec_destroy(spec);
+            return -1;
+        }
+    }
+
+    spec->name = strndup(words[0], lengths[0]);
+    if (!spec->name) {
+        sink_spec_destroy(spec);
+        return -1;
+    }
+    return 0;
+}
+
+void sink_spec_destroy(sink_spec_t* spec) {
+    if (!spec) {
+        return;
+    }
+
+    free(spec->name);
+    free(spec->target);
+    memset(spec, 0, sizeof(sink_spec_t));
+}
+
+int sink_route_parse(sink_route_t* route, const char* text) {
+    if (!route || !text) {
+        return -1;
+    }
+
+    memset(route, 0, sizeof(sink_route_t));
+
+    // "<selector> -> <sink>[,<sink>...]"
+    const char* arrow = strstr(text, "->");
+    if (!arrow) {
+        return -1;
+    }
+
+    const char* selector = text;
+    size_t selector_len = (size_t)(arrow - text);
+    while (selector_len > 0 && *selector == ' ') {
+        selector++;
+        selector_len--;
+    }
+    while (selector_len > 0 && selector[selector_len - 1] == ' ') {
+        selector_len--;
+    }
+    if (selector_len == 1 && selector[0] == '*') {
+        route->match_all = true;
+    } else if (log_selector_parse(&route->selector, selector, selector_len) != 0) {
+        return -1;
+    }
+
+    route->sinks = (char**)calloc(SINK_ROUTE_MAX_SINKS, sizeof(char*));
+    if (!route->sinks) {
+        sink_route_destroy(route);
+        return -1;
+    }
+    const char* p = arrow + 2;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        size_t len = strcspn(p, " ,");
+        if (len == 0) {
+            break;
+        }
+        if (!valid_name(p, len) || route->num_sinks == SINK_ROUTE_MAX_SINKS) {
+            sink_route_destroy(route);
+            return -1;
+        }
+        route->sinks[route->num_sinks] = strndup(p, len);
+        if (!route->sinks[route->num_sinks]) {
+            sink_route_destroy(route);
+            return -1;
+        }
+        route->num_sinks++;
+        p += len;
+    }
+
+    route->text = strdup(text);
+    if (route->num_sinks == 0 || !route->text) {
+        sink_route_destroy(route);
+        return -1;
+    }
+    return 0;
+}
+
+void sink_route_destroy(sink_route_t* route) {
+    if (!route) {
+        return;
+    }
+
+    log_selector_destroy(&route->selector);
+    for (size_t i = 0; i < route->num_sinks; i++) {
+        free(route->sinks[i]);
+    }
+    free(route->sinks);
+    free(route->text);
+    memset(route, 0, sizeof(sink_route_t));
+}
+
+bool sink_route_matches(const sink_route_t* route, log_entry_t* entry) {
+    if (!route || !entry) {
+        return false;
+    }
+    return route->match_all || log_selector_matches(&route->selector, entry);
+}
\ No newline at end of file
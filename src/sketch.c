@@ -0,0 +1,434 @@
+#include "sketch.h"
+#include "hash.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Space-Saving ---
+
+static size_t topk_home(const topk_t* topk, uint64_t key) {
+    return (size_t)key & topk->index_mask;
+}
+
+static size_t topk_slot(const topk_t* topk, uint64_t key) {
+    size_t slot = topk_home(topk, key);
+    while (topk->index[slot] != 0 && topk->items[topk->index[slot] - 1].key != key) {
+        slot = (slot + 1) & topk->index_mask;
+    }
+    return slot;
+}
+
+// Remove a slot, shifting back later entries of the probe run
+static void topk_unindex(topk_t* topk, size_t slot) {
+    size_t hole = slot;
+    size_t next = slot;
+    for (;;) {
+        next = (next + 1) & topk->index_mask;
+        if (topk->index[next] == 0) {
+            break;
+        }
+        size_t home = topk_home(topk, topk->items[topk->index[next] - 1].key);
+        // Movable unless its home lies cyclically in (hole, next]
+        bool stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!stays) {
+            topk->index[hole] = topk->index[next];
+            hole = next;
+        }
+    }
+    topk->index[hole] = 0;
+}
+
+static uint64_t topk_count_at(const topk_t* topk, size_t pos) {
+    return topk->items[topk->heap[pos]].count;
+}
+
+static void topk_swap(topk_t* topk, size_t a, size_t b) {
+    uint32_t tmp = topk->heap[a];
+    topk->heap[a] = topk->heap[b];
+    topk->heap[b] = tmp;
+    topk->positions[topk->heap[a]] = (uint32_t)a;
+    topk->positions[topk->heap[b]] = (uint32_t)b;
+}
+
+static void topk_sift_down(topk_t* topk, size_t pos) {
+    for (;;) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < topk->size && topk_count_at(topk, left) < topk_count_at(topk, smallest)) {
+            smallest = left;
+        }
+        if (right < topk->size && topk_count_at(topk, right) < topk_count_at(topk, smallest)) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        topk_swap(topk, pos, smallest);
+        pos = smallest;
+    }
+}
+
+static void topk_sift_up(topk_t* topk, size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (topk_count_at(topk, parent) <= topk_count_at(topk, pos)) {
+            return;
+        }
+        topk_swap(topk, pos, parent);
+        pos = parent;
+    }
+}
+
+static void set_label(topk_item_t* item, const char* label, size_t label_len) {
+    if (!label) {
+        label_len = 0;
+    }
+    if (label_len >= sizeof(item->label)) {
+        label_len = sizeof(item->label) - 1;
+    }
+    if (label_len > 0) {
+        memcpy(item->label, label, label_len);
+    }
+    item->label[label_len] = '\0';
+}
+
+int topk_init(topk_t* topk, size_t k) {
+    if (!topk || k == 0 || k >= UINT32_MAX / 2) {
+        return -1;
+    }
+
+    memset(topk, 0, sizeof(topk_t));
+    size_t index_size = 8;
+    while (index_size < 2 * k) {
+        index_size <<= 1;
+    }
+    topk->items = (topk_item_t*)calloc(k, sizeof(topk_item_t));
+    topk->heap = (uint32_t*)calloc(k, sizeof(uint32_t));
+    topk->positions = (uint32_t*)calloc(k, sizeof(uint32_t));
+    topk->index = (uint32_t*)calloc(index_size, sizeof(uint32_t));
+    if (!topk->items || !topk->heap || !topk->positions || !topk->index) {
+        topk_destroy(topk);
+        return -1;
+    }
+    topk->index_mask = index_size - 1;
+    topk->capacity = k;
+    return 0;
+}
+
+void topk_destroy(topk_t* topk) {
+    if (!topk) {
+        return;
+    }
+    free(topk->items);
+    free(topk->heap);
+    free(topk->positions);
+    free(topk->index);
+    memset(topk, 0, sizeof(topk_t));
+}
+
+void topk_reset(topk_t* topk) {
+    if (!topk || !topk->index) {
+        return;
+    }
+    memset(topk->index, 0, (topk->index_mask + 1) * sizeof(uint32_t));
+    topk->size = 0;
+}
+
+void topk_add(topk_t* topk, uint64_t key, const char* label, size_t label_len, uint64_t count) {
+    if (!topk || !topk->items || count == 0) {
+        return;
+    }
+
+    size_t slot = topk_slot(topk, key);
+    if (topk->index[slot] != 0) {
+        uint32_t id = topk->index[slot] - 1;
+        topk->items[id].count += count;
+        topk_sift_down(topk, topk->positions[id]);
+        return;
+    }
+
+    if (topk->size < topk->capacity) {
+        uint32_t id = (uint32_t)topk->size++;
+        topk_item_t* item = &topk->items[id];
+        item->key = key;
+        item->count = count;
+        item->error = 0;
+        set_label(item, label, label_len);
+        topk->index[slot] = id + 1;
+        topk->heap[id] = id;
+        topk->positions[id] = id;
+        topk_sift_up(topk, id);
+        return;
+    }
+
+    // Take over the smallest counter; its count bounds the new key's error
+    uint32_t id = topk->heap[0];
+    topk_item_t* item = &topk->items[id];
+    topk_unindex(topk, topk_slot(topk, item->key));
+    item->error = item->count;
+    item->count += count;
+    item->key = key;
+    set_label(item, label, label_len);
+    topk->index[topk_slot(topk, key)] = id + 1;
+    topk_sift_down(topk, 0);
+}
+
+static int compare_descending(const void* a, const void* b) {
+    const topk_item_t* x = (const topk_item_t*)a;
+    const topk_item_t* y = (const topk_item_t*)b;
+    if (x->count != y->count) {
+        return x->count < y->count ? 1 : -1;
+    }
+    return x->key < y->key ? -1 : (x->key > y->key ? 1 : 0);
+}
+
+int topk_merge(topk_t* topk, const topk_t* other) {
+    if (!topk || !topk->items || !other) {
+        return -1;
+    }
+    if (other->size == 0) {
+        return 0;
+    }
+
+    // Sum counts over the union, then keep the heaviest
+    size_t total = topk->size + other->size;
+    topk_item_t* items = (topk_item_t*)malloc(total * sizeof(topk_item_t));
+    if (!items) {
+        return -1;
+    }
+    memcpy(items, topk->items, topk->size * sizeof(topk_item_t));
+    size_t count = topk->size;
+    for (size_t i = 0; i < other->size; i++) {
+        const topk_item_t* item = &other->items[i];
+        size_t slot = topk_slot(topk, item->key);
+        if (topk->index[slot] != 0) {
+            topk_item_t* mine = &items[topk->index[slot] - 1];
+            mine->count += item->count;
+            mine->error += item->error;
+        } else {
+            items[count++] = *item;
+        }
+    }
+    qsort(items, count, sizeof(topk_item_t), compare_descending);
+    if (count > topk->capacity) {
+        count = topk->capacity;
+    }
+
+    // Ascending order is a valid min-heap
+    topk_reset(topk);
+    for (size_t i = 0; i < count; i++) {
+        topk->items[i] = items[count - 1 - i];
+        topk->heap[i] = (uint32_t)i;
+        topk->positions[i] = (uint32_t)i;
+        topk->index[topk_slot(topk, topk->items[i].key)] = (uint32_t)i + 1;
+    }
+    topk->size = count;
+    free(items);
+    return 0;
+}
+
+size_t topk_list(const topk_t* topk, topk_item_t* items, size_t max) {
+    if (!topk || !topk->items || !items || max == 0) {
+        return 0;
+    }
+
+    topk_item_t* sorted = (topk_item_t*)malloc((topk->size > 0 ? topk->size : 1) *
+                                               sizeof(topk_item_t));
+    if (!sorted) {
+        return 0;
+    }
+    memcpy(sorted, topk->items, topk->size * sizeof(topk_item_t));
+    qsort(sorted, topk->size, sizeof(topk_item_t), compare_descending);
+    size_t count = topk->size < max ? topk->size : max;
+    memcpy(items, sorted, count * sizeof(topk_item_t));
+    free(sorted);
+    return count;
+}
+
+// --- Count-Min ---
+
+// Row i probes key + i * step (double hashing)
+static size_t count_min_cell(const count_min_t* sketch, uint64_t key, uint64_t step, size_t row) {
+    return row * sketch->width + ((size_t)(key + row * step) & (sketch->width - 1));
+}
+
+int count_min_init(count_min_t* sketch, size_t width, size_t depth) {
+    if (!sketch || width == 0 || depth == 0 || depth > COUNT_MIN_MAX_DEPTH) {
+        return -1;
+    }
+
+    memset(sketch, 0, sizeof(count_min_t));
+    size_t columns = 1;
+    while (columns < width) {
+        columns <<= 1;
+    }
+    sketch->counters = (uint64_t*)calloc(columns * depth, sizeof(uint64_t));
+    if (!sketch->counters) {
+        return -1;
+    }
+    sketch->width = columns;
+    sketch->depth = depth;
+    return 0;
+}
+
+void count_min_destroy(count_min_t* sketch) {
+    if (!sketch) {
+        return;
+    }
+    free(sketch->counters);
+    memset(sketch, 0, sizeof(count_min_t));
+}
+
+void count_min_reset(count_min_t* sketch) {
+    if (!sketch || !sketch->counters) {
+        return;
+    }
+    memset(sketch->counters, 0, sketch->width * sketch->depth * sizeof(uint64_t));
+}
+
+void count_min_add(count_min_t* sketch, uint64_t key, uint64_t count) {
+    if (!sketch || !sketch->counters) {
+        return;
+    }
+
+    uint64_t* cells[COUNT_MIN_MAX_DEPTH];
+    uint64_t step = hash64_mix(key) | 1;
+    uint64_t min = UINT64_MAX;
+    for (size_t row = 0; row < sketch->depth; row++) {
+        cells[row] = &sketch->counters[count_min_cell(sketch, key, step, row)];
+        if (*cells[row] < min) {
+            min = *cells[row];
+        }
+    }
+
+    // Conservative update: raise only the counters below the new estimate
+    uint64_t target = min + count;
+    for (size_t row = 0; row < sketch->depth; row++) {
+        if (*cells[row] < target) {
+            *cells[row] = target;
+        }
+    }
+}
+
+uint64_t count_min_estimate(const count_min_t* sketch, uint64_t key) {
+    if (!sketch || !sketch->counters) {
+        return 0;
+    }
+
+    uint64_t step = hash64_mix(key) | 1;
+    uint64_t min = UINT64_MAX;
+    for (size_t row = 0; row < sketch->depth; row++) {
+        uint64_t value = sketch->counters[count_min_cell(sketch, key, step, row)];
+        if (value < min) {
+            min = value;
+        }
+    }
+    return min;
+}
+
+int count_min_merge(count_min_t* sketch, const count_min_t* other) {
+    if (!sketch || !other || !sketch->counters || !other->counters ||
+        sketch->width != other->width || sketch->depth != other->depth) {
+        return -1;
+    }
+
+    size_t cells = sketch->width * sketch->depth;
+    for (size_t i = 0; i < cells; i++) {
+        sketch->counters[i] += other->counters[i];
+    }
+    return 0;
+}
+
+// --- HyperLogLog ---
+
+int hll_init(hll_t* hll, unsigned int precision) {
+    if (!hll || precision < 4 || precision > 16) {
+        return -1;
+    }
+
+    hll->registers = (uint8_t*)calloc((size_t)1 << precision, 1);
+    if (!hll->registers) {
+        return -1;
+    }
+    hll->precision = precision;
+    return 0;
+}
+
+void hll_destroy(hll_t* hll) {
+    if (!hll) {
+        return;
+    }
+    free(hll->registers);
+    memset(hll, 0, sizeof(hll_t));
+}
+
+void hll_reset(hll_t* hll) {
+    if (!hll || !hll->registers) {
+        return;
+    }
+    memset(hll->registers, 0, (size_t)1 << hll->precision);
+}
+
+void hll_add(hll_t* hll, uint64_t key) {
+    if (!hll || !hll->registers) {
+        return;
+    }
+
+    size_t index = (size_t)(key >> (64 - hll->precision));
+    // The guard bit bounds the rank when the remaining bits are all zero
+    uint64_t rest = (key << hll->precision) | ((uint64_t)1 << (hll->precision - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > hll->registers[index]) {
+        hll->registers[index] = rank;
+    }
+}
+
+double hll_estimate(const hll_t* hll) {
+    if (!hll || !hll->registers) {
+        return 0.0;
+    }
+
+    size_t m = (size_t)1 << hll->precision;
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < m; i++) {
+        sum += ldexp(1.0, -(int)hll->registers[i]);
+        if (hll->registers[i] == 0) {
+            zeros++;
+        }
+    }
+
+    double alpha;
+    if (m == 16) {
+        alpha = 0.673;
+    } else if (m == 32) {
+        alpha = 0.697;
+    } else if (m == 64) {
+        alpha = 0.709;
+    } else {
+        alpha = 0.7213 / (1.0 + 1.079 / (double)m);
+    }
+    double estimate = alpha * (double)m * (double)m / sum;
+
+    // Linear counting is more accurate while many registers are empty
+    if (estimate <= 2.5 * (double)m && zeros > 0) {
+        estimate = (double)m * log((double)m / (double)zeros);
+    }
+    return estimate;
+}
+
+int hll_merge(hll_t* hll, const hll_t* other) {
+    if (!hll || !other || !hll->registers || !other->registers ||
+        hll->precision != other->precision) {
+        return -1;
+    }
+
+    size_t m = (size_t)1 << hll->precision;
+    for (size_t i = 0; i < m; i++) {
+        if (other->registers[i] > hll->registers[i]) {
+            hll->registers[i] = other->registers[i];
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,505 @@
+#include "stream_stats.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include "timestamp.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int shard_init(stream_stats_t* stats, stream_stats_shard_t* shard) {
+    memset(shard, 0, sizeof(stream_stats_shard_t));
+    shard->stats = stats;
+    pthread_mutex_init(&shard->mutex, NULL);
+
+    int failed = topk_init(&shard->sources, stats->top_k) != 0;
+    failed |= topk_init(&shard->templates, stats->top_k) != 0;
+    failed |= count_min_init(&shard->source_counts, stats->width, stats->depth) != 0;
+    failed |= hll_init(&shard->distinct_sources, stats->precision) != 0;
+    failed |= hll_init(&shard->distinct_templates, stats->precision) != 0;
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        failed |= hll_init(&shard->distinct_fields[i], stats->precision) != 0;
+    }
+    return failed ? -1 : 0;
+}
+
+static void shard_destroy(stream_stats_shard_t* shard) {
+    topk_destroy(&shard->sources);
+    topk_destroy(&shard->templates);
+    count_min_destroy(&shard->source_counts);
+    hll_destroy(&shard->distinct_sources);
+    hll_destroy(&shard->distinct_templates);
+    for (size_t i = 0; i < STREAM_STATS_MAX_FIELDS; i++) {
+        hll_destroy(&shard->distinct_fields[i]);
+    }
+    pthread_mutex_destroy(&shard->mutex);
+}
+
+// Move a pre-aggregated count into the shard's sketches
+static void flush_source(stream_stats_shard_t* shard, topk_item_t* slot) {
+    topk_add(&shard->sources, slot->key, slot->label, strlen(slot->label), slot->count);
+    count_min_add(&shard->source_counts, slot->key, slot->count);
+    hll_add(&shard->distinct_sources, slot->key);
+    slot->count = 0;
+}
+
+static void flush_template(stream_stats_shard_t* shard, topk_item_t* slot) {
+    topk_add(&shard->templates, slot->key, slot->label, strlen(slot->label), slot->count);
+    hll_add(&shard->distinct_templates, slot->key);
+    slot->count = 0;
+}
+
+static void shard_flush(stream_stats_shard_t* shard) {
+    for (size_t i = 0; i < STREAM_STATS_PENDING; i++) {
+        if (shard->pending_sources[i].count > 0) {
+            flush_source(shard, &shard->pending_sources[i]);
+        }
+        if (shard->pending_templates[i].count > 0) {
+            flush_template(shard, &shard->pending_templates[i]);
+        }
+    }
+}
+
+// Find a key's pending slot; fresh when it holds nothing or another key
+static topk_item_t* pending_slot(topk_item_t* pending, uint64_t key, bool* fresh) {
+    topk_item_t* slot = &pending[key & (STREAM_STATS_PENDING - 1)];
+    *fresh = slot->count == 0 || slot->key != key;
+    return slot;
+}
+
+static void shard_reset(stream_stats_t* stats, stream_stats_shard_t* shard) {
+    shard->entries = 0;
+    topk_reset(&shard->sources);
+    topk_reset(&shard->templates);
+    count_min_reset(&shard->source_counts);
+    hll_reset(&shard->distinct_sources);
+    hll_reset(&shard->distinct_templates);
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        hll_reset(&shard->distinct_fields[i]);
+    }
+}
+
+static void shard_merge(stream_stats_t* stats, stream_stats_shard_t* into,
+                        const stream_stats_shard_t* from) {
+    into->entries += from->entries;
+    topk_merge(&into->sources, &from->sources);
+    topk_merge(&into->templates, &from->templates);
+    count_min_merge(&into->source_counts, &from->source_counts);
+    hll_merge(&into->distinct_sources, &from->distinct_sources);
+    hll_merge(&into->distinct_templates, &from->distinct_templates);
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        hll_merge(&into->distinct_fields[i], &from->distinct_fields[i]);
+    }
+}
+
+// Key destructor: the thread exited, so its shard may be adopted
+static void release_shard(void* arg) {
+    stream_stats_shard_t* shard = (stream_stats_shard_t*)arg;
+    stream_stats_t* stats = (stream_stats_t*)shard->stats;
+    pthread_mutex_lock(&stats->mutex);
+    shard->owned = false;
+    pthread_mutex_unlock(&stats->mutex);
+}
+
+// Adopt a released shard or add one for the calling thread
+static stream_stats_shard_t* attach_shard(stream_stats_t* stats) {
+    pthread_mutex_lock(&stats->mutex);
+    stream_stats_shard_t* shard = stats->shards;
+    while (shard && shard->owned) {
+        shard = shard->next;
+    }
+    if (!shard) {
+        shard = (stream_stats_shard_t*)malloc(sizeof(stream_stats_shard_t));
+        if (!shard || shard_init(stats, shard) != 0) {
+            if (shard) {
+                shard_destroy(shard);
+                free(shard);
+            }
+            pthread_mutex_unlock(&stats->mutex);
+            return NULL;
+        }
+        shard->next = stats->shards;
+        stats->shards = shard;
+    }
+    shard->owned = true;
+    pthread_mutex_unlock(&stats->mutex);
+
+    pthread_setspecific(stats->key, shard);
+    return shard;
+}
+
+int stream_stats_init(stream_stats_t* stats, const config_t* config) {
+    if (!stats || !config || config->sketch_top_k == 0 || config->sketch_width == 0 ||
+        config->sketch_depth == 0 || config->sketch_depth > COUNT_MIN_MAX_DEPTH ||
+        config->sketch_precision < 4 || config->sketch_precision > 16) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(stream_stats_t));
+    stats->top_k = config->sketch_top_k;
+    stats->width = config->sketch_width;
+    stats->depth = config->sketch_depth;
+    stats->precision = (unsigned int)config->sketch_precision;
+    stats->num_fields = config->num_sketch_fields < STREAM_STATS_MAX_FIELDS
+                            ? config->num_sketch_fields : STREAM_STATS_MAX_FIELDS;
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        stats->fields[i] = config->sketch_fields[i];
+    }
+    stats->path = config->sketch_file;
+    stats->interval_seconds = config->sketch_interval > 0 ? config->sketch_interval : 1;
+
+    if (pthread_key_create(&stats->key, release_shard) != 0) {
+        return -1;
+    }
+    pthread_mutex_init(&stats->mutex, NULL);
+    pthread_cond_init(&stats->wake, NULL);
+    if (shard_init(stats, &stats->total) != 0 || shard_init(stats, &stats->recent) != 0) {
+        shard_destroy(&stats->total);
+        shard_destroy(&stats->recent);
+        pthread_cond_destroy(&stats->wake);
+        pthread_mutex_destroy(&stats->mutex);
+        pthread_key_delete(stats->key);
+        memset(stats, 0, sizeof(stream_stats_t));
+        return -1;
+    }
+    stats->recent_start = timestamp_now();
+    stats->recent_end = stats->recent_start;
+
+    stats->distinct_sources = metrics_register("sketch.distinct_sources", METRIC_GAUGE);
+    stats->distinct_templates = metrics_register("sketch.distinct_templates", METRIC_GAUGE);
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "sketch.distinct.%s", stats->fields[i]);
+        stats->distinct_fields[i] = metrics_register(name, METRIC_GAUGE);
+    }
+    return 0;
+}
+
+static void* stream_stats_thread_func(void* arg) {
+    stream_stats_t* stats = (stream_stats_t*)arg;
+
+    pthread_mutex_lock(&stats->mutex);
+    while (stats->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += stats->interval_seconds;
+
+        int rc = 0;
+        while (stats->running && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&stats->wake, &stats->mutex, &deadline);
+        }
+        if (!stats->running) {
+            break;
+        }
+        pthread_mutex_unlock(&stats->mutex);
+
+        stream_stats_merge(stats, timestamp_now());
+        if (stats->path) {
+            stream_stats_write_file(stats, stats->path);
+        }
+
+        pthread_mutex_lock(&stats->mutex);
+    }
+    pthread_mutex_unlock(&stats->mutex);
+
+    return NULL;
+}
+
+int stream_stats_start(stream_stats_t* stats) {
+    if (!stats || !stats->total.sources.items || stats->started) {
+        return -1;
+    }
+
+    stats->running = true;
+    if (pthread_create(&stats->thread, NULL, stream_stats_thread_func, stats) != 0) {
+        stats->running = false;
+        return -1;
+    }
+    stats->started = true;
+    return 0;
+}
+
+void stream_stats_stop(stream_stats_t* stats) {
+    if (!stats || !stats->started) {
+        return;
+    }
+
+    pthread_mutex_lock(&stats->mutex);
+    stats->running = false;
+    pthread_cond_signal(&stats->wake);
+    pthread_mutex_unlock(&stats->mutex);
+
+    pthread_join(stats->thread, NULL);
+    stats->started = false;
+
+    stream_stats_merge(stats, timestamp_now());
+    if (stats->path) {
+        stream_stats_write_file(stats, stats->path);
+    }
+}
+
+void stream_stats_destroy(stream_stats_t* stats) {
+    if (!stats || !stats->total.sources.items) {
+        return;
+    }
+
+    stream_stats_stop(stats);
+    pthread_key_delete(stats->key);
+    while (stats->shards) {
+        stream_stats_shard_t* shard = stats->shards;
+        stats->shards = shard->next;
+        shard_destroy(shard);
+        free(shard);
+    }
+    shard_destroy(&stats->total);
+    shard_destroy(&stats->recent);
+    pthread_cond_destroy(&stats->wake);
+    pthread_mutex_destroy(&stats->mutex);
+    memset(stats, 0, sizeof(stream_stats_t));
+}
+
+// Decimal digits of an ID; snprintf would dominate the per-entry cost
+static size_t format_id(uint32_t id, char* out) {
+    char digits[10];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + id % 10);
+        id /= 10;
+    } while (id > 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+void stream_stats_observe(stream_stats_t* stats, log_entry_t* entry) {
+    if (!stats || !stats->total.sources.items || !entry || !entry->source) {
+        return;
+    }
+
+    stream_stats_shard_t* shard = (stream_stats_shard_t*)pthread_getspecific(stats->key);
+    if (!shard) {
+        shard = attach_shard(stats);
+        if (!shard) {
+            return;
+        }
+    }
+
+    // Field lookups may extract, so they happen before taking the lock
+    uint64_t field_keys[STREAM_STATS_MAX_FIELDS];
+    bool has_field[STREAM_STATS_MAX_FIELDS];
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        const char* value;
+        size_t length;
+        has_field[i] = log_entry_get_field(entry, stats->fields[i], &value, &length);
+        field_keys[i] = has_field[i] ? hash64(value, length, 0) : 0;
+    }
+
+    size_t class_len = log_entry_source_class_len(entry->source);
+    uint64_t source_key = hash64(entry->source, class_len, 0);
+
+    pthread_mutex_lock(&shard->mutex);
+    shard->entries++;
+    bool fresh;
+    topk_item_t* slot = pending_slot(shard->pending_sources, source_key, &fresh);
+    if (fresh) {
+        if (slot->count > 0) {
+            flush_source(shard, slot);
+        }
+        slot->key = source_key;
+        size_t label_len = class_len < SKETCH_LABEL_MAX ? class_len : SKETCH_LABEL_MAX - 1;
+        memcpy(slot->label, entry->source, label_len);
+        slot->label[label_len] = '\0';
+    }
+    slot->count++;
+    if (entry->template_id != 0) {
+        uint64_t template_key = hash64_mix(entry->template_id);
+        slot = pending_slot(shard->pending_templates, template_key, &fresh);
+        if (fresh) {
+            if (slot->count > 0) {
+                flush_template(shard, slot);
+            }
+            slot->key = template_key;
+            slot->label[format_id(entry->template_id, slot->label)] = '\0';
+        }
+        slot->count++;
+    }
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        if (has_field[i]) {
+            hll_add(&shard->distinct_fields[i], field_keys[i]);
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void stream_stats_merge(stream_stats_t* stats, int64_t now) {
+    if (!stats || !stats->total.sources.items) {
+        return;
+    }
+
+    pthread_mutex_lock(&stats->mutex);
+    shard_reset(stats, &stats->recent);
+    for (stream_stats_shard_t* shard = stats->shards; shard; shard = shard->next) {
+        pthread_mutex_lock(&shard->mutex);
+        shard_flush(shard);
+        shard_merge(stats, &stats->recent, shard);
+        shard_reset(stats, shard);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    shard_merge(stats, &stats->total, &stats->recent);
+    stats->recent_start = stats->recent_end;
+    stats->recent_end = now;
+
+    metrics_set(stats->distinct_sources,
+                (uint64_t)(hll_estimate(&stats->total.distinct_sources) + 0.5));
+    metrics_set(stats->distinct_templates,
+                (uint64_t)(hll_estimate(&stats->total.distinct_templates) + 0.5));
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        metrics_set(stats->distinct_fields[i],
+                    (uint64_t)(hll_estimate(&stats->total.distinct_fields[i]) + 0.5));
+    }
+    pthread_mutex_unlock(&stats->mutex);
+}
+
+static size_t list_top(stream_stats_t* stats, bool templates, bool recent, topk_item_t* items,
+                       size_t max) {
+    if (!stats || !stats->total.sources.items) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&stats->mutex);
+    stream_stats_shard_t* shard = recent ? &stats->recent : &stats->total;
+    size_t count = topk_list(templates ? &shard->templates : &shard->sources, items, max);
+    pthread_mutex_unlock(&stats->mutex);
+    return count;
+}
+
+size_t stream_stats_top_sources(stream_stats_t* stats, bool recent, topk_item_t* items,
+                                size_t max) {
+    return list_top(stats, false, recent, items, max);
+}
+
+size_t stream_stats_top_templates(stream_stats_t* stats, bool recent, topk_item_t* items,
+                                  size_t max) {
+    return list_top(stats, true, recent, items, max);
+}
+
+uint64_t stream_stats_source_count(stream_stats_t* stats, const char* source) {
+    if (!stats || !stats->total.sources.items || !source) {
+        return 0;
+    }
+
+    uint64_t key = hash64(source, log_entry_source_class_len(source), 0);
+    pthread_mutex_lock(&stats->mutex);
+    uint64_t count = count_min_estimate(&stats->total.source_counts, key);
+    pthread_mutex_unlock(&stats->mutex);
+    return count;
+}
+
+uint64_t stream_stats_entries(stream_stats_t* stats) {
+    if (!stats || !stats->total.sources.items) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&stats->mutex);
+    uint64_t entries = stats->total.entries;
+    pthread_mutex_unlock(&stats->mutex);
+    return entries;
+}
+
+static double estimate(stream_stats_t* stats, const hll_t* hll) {
+    pthread_mutex_lock(&stats->mutex);
+    double value = hll_estimate(hll);
+    pthread_mutex_unlock(&stats->mutex);
+    return value;
+}
+
+double stream_stats_distinct_sources(stream_stats_t* stats) {
+    if (!stats || !stats->total.sources.items) {
+        return 0.0;
+    }
+    return estimate(stats, &stats->total.distinct_sources);
+}
+
+double stream_stats_distinct_templates(stream_stats_t* stats) {
+    if (!stats || !stats->total.sources.items) {
+        return 0.0;
+    }
+    return estimate(stats, &stats->total.distinct_templates);
+}
+
+double stream_stats_distinct_field(stream_stats_t* stats, const char* field) {
+    if (!stats || !stats->total.sources.items || !field) {
+        return -1.0;
+    }
+
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        if (strcmp(stats->fields[i], field) == 0) {
+            return estimate(stats, &stats->total.distinct_fields[i]);
+        }
+    }
+    return -1.0;
+}
+
+static void write_top(FILE* out, const char* name, const topk_t* topk) {
+    topk_item_t items[64];
+    size_t count = topk_list(topk, items, sizeof(items) / sizeof(items[0]));
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%s %llu %llu %s\n", name, (unsigned long long)items[i].count,
+                (unsigned long long)items[i].error, items[i].label);
+    }
+}
+
+void stream_stats_write(stream_stats_t* stats, FILE* out) {
+    if (!stats || !stats->total.sources.items || !out) {
+        return;
+    }
+
+    pthread_mutex_lock(&stats->mutex);
+    fprintf(out, "entries %llu\n", (unsigned long long)stats->total.entries);
+    fprintf(out, "recent.entries %llu\n", (unsigned long long)stats->recent.entries);
+    fprintf(out, "recent.seconds %.1f\n",
+            (double)(stats->recent_end - stats->recent_start) / TIMESTAMP_NS_PER_SEC);
+    fprintf(out, "distinct.sources %.0f\n", hll_estimate(&stats->total.distinct_sources));
+    fprintf(out, "distinct.templates %.0f\n", hll_estimate(&stats->total.distinct_templates));
+    for (size_t i = 0; i < stats->num_fields; i++) {
+        fprintf(out, "distinct.field.%s %.0f\n", stats->fields[i],
+                hll_estimate(&stats->total.distinct_fields[i]));
+    }
+    // <name> <count> <error> <label>: the label goes last since paths may hold spaces
+    write_top(out, "recent.source", &stats->recent.sources);
+    write_top(out, "recent.template", &stats->recent.templates);
+    write_top(out, "total.source", &stats->total.sources);
+    write_top(out, "total.template", &stats->total.templates);
+    pthread_mutex_unlock(&stats->mutex);
+}
+
+int stream_stats_write_file(stream_stats_t* stats, const char* path) {
+    if (!stats || !path) {
+        return -1;
+    }
+
+    // Write to a temporary file and rename so readers never see a partial dump
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* file = fopen(tmp_path, "w");
+    if (!file) {
+        return -1;
+    }
+
+    stream_stats_write(stats, file);
+
+    if (fclose(file) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
\ No newline at end of file
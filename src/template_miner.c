@@ -0,0 +1,667 @@
+#include "template_miner.h"
+#include "hash.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Longest template file line that is loaded
+#define LOAD_LINE_MAX 8192
+
+static const char wildcard[] = TEMPLATE_MINER_WILDCARD;
+#define WILDCARD_LEN (sizeof(wildcard) - 1)
+
+// Token of a message or template
+typedef struct {
+    const char* start;
+    size_t length;
+} span_t;
+
+// Tree node; leaves hold the templates of their path
+typedef struct template_node {
+    struct template_node* parent;       // NULL for roots
+    struct template_node* hash_next;    // Chain in the stripe table
+    char* token;
+    size_t token_len;
+    size_t num_children;
+    size_t refs;                        // Templates below
+    struct template_cluster* clusters;  // Leaves only
+} template_node_t;
+
+// Template: tokens joined by single spaces
+typedef struct template_cluster {
+    struct template_cluster* next;      // In the leaf
+    struct template_cluster* lru_prev;
+    struct template_cluster* lru_next;
+    template_node_t* leaf;
+    uint32_t id;
+    uint64_t hits;
+    char* text;
+    size_t num_tokens;
+    span_t tokens[];                    // Into text
+} template_cluster_t;
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_wildcard(const span_t* span) {
+    return span->length == WILDCARD_LEN && memcmp(span->start, wildcard, WILDCARD_LEN) == 0;
+}
+
+static bool has_digit(const span_t* span) {
+    for (size_t i = 0; i < span->length; i++) {
+        if (span->start[i] >= '0' && span->start[i] <= '9') {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool span_equal(const span_t* a, const span_t* b) {
+    return a->length == b->length && memcmp(a->start, b->start, a->length) == 0;
+}
+
+// Whitespace-separated tokens; the last one takes the rest of a long message
+static size_t tokenize(const char* text, span_t* spans) {
+    size_t n = 0;
+    const char* p = text;
+    while (*p) {
+        while (is_space(*p)) p++;
+        if (!*p) {
+            break;
+        }
+
+        const char* start = p;
+        if (n == TEMPLATE_MINER_MAX_TOKENS - 1) {
+            p += strlen(p);
+            while (p > start && is_space(p[-1])) p--;
+        } else {
+            while (*p && !is_space(*p)) p++;
+        }
+        spans[n].start = start;
+        spans[n].length = (size_t)(p - start);
+        n++;
+        if (n == TEMPLATE_MINER_MAX_TOKENS) {
+            break;
+        }
+    }
+    return n;
+}
+
+// Digit tokens are variables from the start
+static void mask(const span_t* spans, span_t* masked, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (has_digit(&spans[i])) {
+            masked[i].start = wildcard;
+            masked[i].length = WILDCARD_LEN;
+        } else {
+            masked[i] = spans[i];
+        }
+    }
+}
+
+static template_stripe_t* stripe_of(template_miner_t* miner, size_t num_tokens) {
+    return &miner->stripes[num_tokens % TEMPLATE_MINER_STRIPES];
+}
+
+static template_node_t** chain_of(template_stripe_t* stripe, const template_node_t* parent,
+                                  const span_t* token) {
+    uint64_t hash = hash64(token->start, token->length, (uint64_t)(uintptr_t)parent);
+    return &stripe->table[hash & stripe->table_mask];
+}
+
+static template_node_t* child_of(template_stripe_t* stripe, const template_node_t* parent,
+                                 const span_t* token) {
+    for (template_node_t* node = *chain_of(stripe, parent, token); node; node = node->hash_next) {
+        if (node->parent == parent && node->token_len == token->length &&
+            memcmp(node->token, token->start, token->length) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static template_node_t* add_child(template_stripe_t* stripe, template_node_t* parent,
+                                  const span_t* token) {
+    template_node_t* node = (template_node_t*)calloc(1, sizeof(template_node_t));
+    if (!node) {
+        return NULL;
+    }
+    node->token = strndup(token->start, token->length);
+    if (!node->token) {
+        free(node);
+        return NULL;
+    }
+    node->token_len = token->length;
+    node->parent = parent;
+
+    template_node_t** chain = chain_of(stripe, parent, token);
+    node->hash_next = *chain;
+    *chain = node;
+    parent->num_children++;
+    return node;
+}
+
+// Free nodes without templates below, from node towards the root
+static void prune(template_stripe_t* stripe, template_node_t* node) {
+    while (node->parent && node->refs == 0 && node->num_children == 0) {
+        template_node_t* parent = node->parent;
+        span_t token = {node->token, node->token_len};
+        template_node_t** link = chain_of(stripe, parent, &token);
+        while (*link != node) {
+            link = &(*link)->hash_next;
+        }
+        *link = node->hash_next;
+        parent->num_children--;
+        free(node->token);
+        free(node);
+        node = parent;
+    }
+}
+
+// Walk the first `depth` tokens. A search follows the exact token, else the
+// wildcard child; an insert creates the exact child while the node has
+// room (one slot stays free for the wildcard child) and the wildcard child
+// otherwise.
+static template_node_t* route(template_miner_t* miner, template_stripe_t* stripe,
+                              const span_t* masked, size_t n, bool create) {
+    template_node_t* node = &miner->roots[n];
+    size_t levels = n < miner->depth ? n : miner->depth;
+    span_t any = {wildcard, WILDCARD_LEN};
+
+    for (size_t i = 0; i < levels; i++) {
+        template_node_t* child = child_of(stripe, node, &masked[i]);
+        if (!child && create && !is_wildcard(&masked[i]) &&
+            node->num_children < TEMPLATE_MINER_MAX_CHILDREN - 1) {
+            child = add_child(stripe, node, &masked[i]);
+            if (!child) {
+                prune(stripe, node);
+                return NULL;
+            }
+        }
+        if (!child) {
+            child = child_of(stripe, node, &any);
+        }
+        if (!child && create) {
+            child = add_child(stripe, node, &any);
+            if (!child) {
+                prune(stripe, node);
+                return NULL;
+            }
+        }
+        if (!child) {
+            return NULL;
+        }
+        node = child;
+    }
+    return node;
+}
+
+// Replace a template's tokens (spans may point into its current text)
+static int set_tokens(template_cluster_t* cluster, const span_t* spans, size_t n) {
+    size_t length = 0;
+    for (size_t i = 0; i < n; i++) {
+        length += spans[i].length + 1;
+    }
+
+    char* text = (char*)malloc(length > 0 ? length : 1);
+    if (!text) {
+        return -1;
+    }
+    char* p = text;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(p, spans[i].start, spans[i].length);
+        cluster->tokens[i].start = p;
+        cluster->tokens[i].length = spans[i].length;
+        p += spans[i].length;
+        *p++ = ' ';
+    }
+    text[length > 0 ? length - 1 : 0] = '\0';
+
+    free(cluster->text);
+    cluster->text = text;
+    cluster->num_tokens = n;
+    return 0;
+}
+
+static void lru_unlink(template_stripe_t* stripe, template_cluster_t* cluster) {
+    if (cluster->lru_prev) {
+        cluster->lru_prev->lru_next = cluster->lru_next;
+    } else {
+        stripe->lru_head = cluster->lru_next;
+    }
+    if (cluster->lru_next) {
+        cluster->lru_next->lru_prev = cluster->lru_prev;
+    } else {
+        stripe->lru_tail = cluster->lru_prev;
+    }
+    cluster->lru_prev = NULL;
+    cluster->lru_next = NULL;
+}
+
+static void lru_push(template_stripe_t* stripe, template_cluster_t* cluster) {
+    cluster->lru_next = stripe->lru_head;
+    if (stripe->lru_head) {
+        stripe->lru_head->lru_prev = cluster;
+    } else {
+        stripe->lru_tail = cluster;
+    }
+    stripe->lru_head = cluster;
+}
+
+static void release(template_miner_t* miner) {
+    size_t count = __atomic_sub_fetch(&miner->count, 1, __ATOMIC_RELAXED);
+    metrics_set(miner->count_gauge, count);
+}
+
+static void evict(template_miner_t* miner, template_stripe_t* stripe,
+                  template_cluster_t* cluster) {
+    lru_unlink(stripe, cluster);
+    template_cluster_t** link = &cluster->leaf->clusters;
+    while (*link != cluster) {
+        link = &(*link)->next;
+    }
+    *link = cluster->next;
+
+    for (template_node_t* node = cluster->leaf; node; node = node->parent) {
+        node->refs--;
+    }
+    prune(stripe, cluster->leaf);
+    free(cluster->text);
+    free(cluster);
+    release(miner);
+    metrics_add(miner->evictions, 1);
+}
+
+// Evict the least recently matched template of another stripe. Their
+// locks are only tried: waiting for one while holding ours could deadlock
+static bool evict_elsewhere(template_miner_t* miner, template_stripe_t* stripe) {
+    size_t index = (size_t)(stripe - miner->stripes);
+    for (size_t i = 1; i < TEMPLATE_MINER_STRIPES; i++) {
+        template_stripe_t* other = &miner->stripes[(index + i) % TEMPLATE_MINER_STRIPES];
+        if (pthread_mutex_trylock(&other->mutex) != 0) {
+            continue;
+        }
+        bool evicted = other->lru_tail != NULL;
+        if (evicted) {
+            evict(miner, other, other->lru_tail);
+        }
+        pthread_mutex_unlock(&other->mutex);
+        if (evicted) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Take a slot for a new template, evicting this stripe's least recently
+// matched one when full (another stripe's when this one has none)
+static bool reserve(template_miner_t* miner, template_stripe_t* stripe) {
+    size_t count = __atomic_add_fetch(&miner->count, 1, __ATOMIC_RELAXED);
+    if (count > miner->capacity) {
+        if (stripe->lru_tail) {
+            evict(miner, stripe, stripe->lru_tail);
+        } else if (!evict_elsewhere(miner, stripe)) {
+            __atomic_sub_fetch(&miner->count, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    }
+    metrics_set(miner->count_gauge, __atomic_load_n(&miner->count, __ATOMIC_RELAXED));
+    return true;
+}
+
+// Add a template (caller holds the stripe lock)
+static template_cluster_t* create(template_miner_t* miner, template_stripe_t* stripe,
+                                  const span_t* tokens, size_t n, uint32_t id) {
+    if (!reserve(miner, stripe)) {
+        return NULL;
+    }
+
+    template_cluster_t* cluster =
+        (template_cluster_t*)calloc(1, sizeof(template_cluster_t) + n * sizeof(span_t));
+    template_node_t* leaf = cluster ? route(miner, stripe, tokens, n, true) : NULL;
+    if (!leaf || set_tokens(cluster, tokens, n) != 0) {
+        if (leaf) {
+            prune(stripe, leaf);
+        }
+        free(cluster);
+        release(miner);
+        return NULL;
+    }
+
+    cluster->id = id;
+    cluster->leaf = leaf;
+    cluster->next = leaf->clusters;
+    leaf->clusters = cluster;
+    for (template_node_t* node = leaf; node; node = node->parent) {
+        node->refs++;
+    }
+    lru_push(stripe, cluster);
+    metrics_add(miner->created, 1);
+    return cluster;
+}
+
+// Template of the leaf sharing the most tokens; ties go to the more
+// general one
+static template_cluster_t* best_match(const template_miner_t* miner, const template_node_t* leaf,
+                                      const span_t* masked, size_t n) {
+    template_cluster_t* best = NULL;
+    size_t best_equal = 0;
+    size_t best_params = 0;
+    for (template_cluster_t* cluster = leaf->clusters; cluster; cluster = cluster->next) {
+        size_t equal = 0;
+        size_t params = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (span_equal(&cluster->tokens[i], &masked[i])) {
+                equal++;
+            }
+            if (is_wildcard(&cluster->tokens[i])) {
+                params++;
+            }
+        }
+        if (!best || equal > best_equal || (equal == best_equal && params > best_params)) {
+            best = cluster;
+            best_equal = equal;
+            best_params = params;
+        }
+    }
+
+    if (!best || (double)best_equal < miner->similarity * (double)n) {
+        return NULL;
+    }
+    return best;
+}
+
+// Turn tokens that differ from the message into wildcards
+static void generalize(template_cluster_t* cluster, const span_t* masked) {
+    span_t merged[TEMPLATE_MINER_MAX_TOKENS];
+    bool changed = false;
+    for (size_t i = 0; i < cluster->num_tokens; i++) {
+        merged[i] = cluster->tokens[i];
+        if (!span_equal(&merged[i], &masked[i]) && !is_wildcard(&merged[i])) {
+            merged[i].start = wildcard;
+            merged[i].length = WILDCARD_LEN;
+            changed = true;
+        }
+    }
+    if (changed) {
+        set_tokens(cluster, merged, cluster->num_tokens); // Keeps the old text on failure
+    }
+}
+
+int template_miner_init(template_miner_t* miner, size_t capacity, size_t depth,
+                        double similarity) {
+    if (!miner || capacity == 0 || depth == 0 || similarity < 0.0 || similarity > 1.0) {
+        return -1;
+    }
+
+    memset(miner, 0, sizeof(template_miner_t));
+    miner->capacity = capacity;
+    miner->depth = depth;
+    miner->similarity = similarity;
+    miner->next_id = 1;
+
+    miner->roots = (template_node_t*)calloc(TEMPLATE_MINER_MAX_TOKENS + 1,
+                                            sizeof(template_node_t));
+    miner->stripes = (template_stripe_t*)calloc(TEMPLATE_MINER_STRIPES,
+                                                sizeof(template_stripe_t));
+    if (!miner->roots || !miner->stripes) {
+        free(miner->roots);
+        free(miner->stripes);
+        return -1;
+    }
+
+    // Each template holds at most `depth` nodes
+    size_t nodes = capacity * depth / TEMPLATE_MINER_STRIPES;
+    size_t table_size = 64;
+    while (table_size < nodes) {
+        table_size <<= 1;
+    }
+
+    for (size_t i = 0; i < TEMPLATE_MINER_STRIPES; i++) {
+        template_stripe_t* stripe = &miner->stripes[i];
+        stripe->table = (template_node_t**)calloc(table_size, sizeof(template_node_t*));
+        if (!stripe->table) {
+            template_miner_destroy(miner);
+            return -1;
+        }
+        stripe->table_mask = table_size - 1;
+        pthread_mutex_init(&stripe->mutex, NULL);
+    }
+
+    miner->count_gauge = metrics_register("templates.count", METRIC_GAUGE);
+    miner->created = metrics_register("templates.created", METRIC_COUNTER);
+    miner->evictions = metrics_register("templates.evictions", METRIC_COUNTER);
+    metrics_set(miner->count_gauge, 0);
+    return 0;
+}
+
+void template_miner_destroy(template_miner_t* miner) {
+    if (!miner || !miner->stripes) {
+        return;
+    }
+
+    for (size_t i = 0; i < TEMPLATE_MINER_STRIPES; i++) {
+        template_stripe_t* stripe = &miner->stripes[i];
+        if (!stripe->table) {
+            continue;
+        }
+
+        template_cluster_t* cluster = stripe->lru_head;
+        while (cluster) {
+            template_cluster_t* next = cluster->lru_next;
+            free(cluster->text);
+            free(cluster);
+            cluster = next;
+        }
+        for (size_t j = 0; j <= stripe->table_mask; j++) {
+            template_node_t* node = stripe->table[j];
+            while (node) {
+                template_node_t* next = node->hash_next;
+                free(node->token);
+                free(node);
+                node = next;
+            }
+        }
+        free(stripe->table);
+        pthread_mutex_destroy(&stripe->mutex);
+    }
+    free(miner->stripes);
+    free(miner->roots);
+    memset(miner, 0, sizeof(template_miner_t));
+}
+
+uint32_t template_miner_match(template_miner_t* miner, const char* message,
+                              template_var_t* vars, size_t max_vars, size_t* num_vars) {
+    if (num_vars) {
+        *num_vars = 0;
+    }
+    if (!miner || !miner->stripes || !message) {
+        return 0;
+    }
+
+    span_t spans[TEMPLATE_MINER_MAX_TOKENS];
+    span_t masked[TEMPLATE_MINER_MAX_TOKENS];
+    size_t n = tokenize(message, spans);
+    if (n == 0) {
+        return 0;
+    }
+    mask(spans, masked, n);
+
+    template_stripe_t* stripe = stripe_of(miner, n);
+    pthread_mutex_lock(&stripe->mutex);
+
+    template_node_t* leaf = route(miner, stripe, masked, n, false);
+    template_cluster_t* cluster = leaf ? best_match(miner, leaf, masked, n) : NULL;
+    if (cluster) {
+        generalize(cluster, masked);
+        lru_unlink(stripe, cluster);
+        lru_push(stripe, cluster);
+    } else {
+        cluster = create(miner, stripe, masked, n,
+                         __atomic_fetch_add(&miner->next_id, 1, __ATOMIC_RELAXED));
+    }
+
+    uint32_t id = 0;
+    if (cluster) {
+        id = cluster->id;
+        cluster->hits++;
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (!is_wildcard(&cluster->tokens[i])) {
+                continue;
+            }
+            if (vars && count < max_vars) {
+                vars[count].value = spans[i].start;
+                vars[count].length = spans[i].length;
+            }
+            count++;
+        }
+        if (num_vars) {
+            *num_vars = count;
+        }
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+
+    return id;
+}
+
+void template_miner_observe(template_miner_t* miner, log_entry_t* entry) {
+    if (!entry) {
+        return;
+    }
+    entry->template_id = template_miner_match(miner, entry->message, NULL, 0, NULL);
+}
+
+int template_miner_lookup(template_miner_t* miner, uint32_t id, char* text, size_t size,
+                          uint64_t* hits) {
+    if (!miner || !miner->stripes || id == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < TEMPLATE_MINER_STRIPES; i++) {
+        template_stripe_t* stripe = &miner->stripes[i];
+        pthread_mutex_lock(&stripe->mutex);
+        for (template_cluster_t* cluster = stripe->lru_head; cluster; cluster = cluster->lru_next) {
+            if (cluster->id != id) {
+                continue;
+            }
+            if (text && size > 0) {
+                snprintf(text, size, "%s", cluster->text);
+            }
+            if (hits) {
+                *hits = cluster->hits;
+            }
+            pthread_mutex_unlock(&stripe->mutex);
+            return 0;
+        }
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+    return -1;
+}
+
+size_t template_miner_count(const template_miner_t* miner) {
+    return miner ? __atomic_load_n(&miner->count, __ATOMIC_RELAXED) : 0;
+}
+
+int template_miner_save(template_miner_t* miner, const char* path) {
+    if (!miner || !miner->stripes || !path) {
+        return -1;
+    }
+
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* file = fopen(tmp_path, "w");
+    if (!file) {
+        return -1;
+    }
+
+    // Least recently matched first, so loading restores the LRU order
+    for (size_t i = 0; i < TEMPLATE_MINER_STRIPES; i++) {
+        template_stripe_t* stripe = &miner->stripes[i];
+        pthread_mutex_lock(&stripe->mutex);
+        for (template_cluster_t* cluster = stripe->lru_tail; cluster; cluster = cluster->lru_prev) {
+            fprintf(file, "%u\t%llu\t%s\n", cluster->id, (unsigned long long)cluster->hits,
+                    cluster->text);
+        }
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+
+    if (fclose(file) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int template_miner_load(template_miner_t* miner, const char* path) {
+    if (!miner || !miner->stripes || !path) {
+        return -1;
+    }
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+
+    int loaded = 0;
+    char line[LOAD_LINE_MAX];
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] != '\n' && !feof(file)) {
+            // Too long to have been written by us; skip the rest of it
+            int c = 0;
+            while (c != EOF && c != '\n') {
+                c = fgetc(file);
+            }
+            continue;
+        }
+
+        char* end;
+        unsigned long id = strtoul(line, &end, 10);
+        if (end == line || *end != '\t' || id == 0 || id >= UINT32_MAX) {
+            continue;
+        }
+        char* hits_start = end + 1;
+        unsigned long long hits = strtoull(hits_start, &end, 10);
+        if (end == hits_start || *end != '\t') {
+            continue;
+        }
+
+        span_t tokens[TEMPLATE_MINER_MAX_TOKENS];
+        span_t masked[TEMPLATE_MINER_MAX_TOKENS];
+        size_t n = tokenize(end + 1, tokens);
+        if (n == 0) {
+            continue;
+        }
+        mask(tokens, masked, n);
+
+        template_stripe_t* stripe = stripe_of(miner, n);
+        pthread_mutex_lock(&stripe->mutex);
+        template_cluster_t* cluster = create(miner, stripe, masked, n, (uint32_t)id);
+        if (cluster) {
+            cluster->hits = hits;
+            loaded++;
+        }
+        pthread_mutex_unlock(&stripe->mutex);
+
+        // New templates get fresh IDs
+        if (miner->next_id <= (uint32_t)id) {
+            miner->next_id = (uint32_t)id + 1;
+        }
+    }
+
+    int failed = ferror(file);
+    fclose(file);
+    return failed ? -1 : loaded;
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "timer_wheel.h"
+#include <string.h>
+
+#define SLOT_MASK ((uint64_t)TIMER_WHEEL_SLOTS - 1)
+#define MAX_DELTA (((uint64_t)1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1)
+
+static uint64_t tick_of(const timer_wheel_t* wheel, int64_t ns) {
+    return ns <= wheel->origin ? 0 : (uint64_t)((ns - wheel->origin) / wheel->tick);
+}
+
+static unsigned int slot_index(uint64_t tick, int level) {
+    return (unsigned int)((tick >> (level * TIMER_WHEEL_SLOT_BITS)) & SLOT_MASK);
+}
+
+static void unlink_timer(timer_wheel_timer_t* timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+static void append(timer_wheel_timer_t* head, timer_wheel_timer_t* timer) {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+// The level is picked by how far away the deadline is, so a slot is only
+// reached (fired or cascaded) at the deadline's own tick or block
+static void place(timer_wheel_t* wheel, timer_wheel_timer_t* timer) {
+    uint64_t delta = timer->expires - wheel->now;
+    if (delta > MAX_DELTA) {
+        timer->expires = wheel->now + MAX_DELTA;
+        delta = MAX_DELTA;
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (uint64_t)1 << ((level + 1) * TIMER_WHEEL_SLOT_BITS)) {
+        level++;
+    }
+    append(&wheel->slots[level][slot_index(timer->expires, level)], timer);
+}
+
+// Move one slot of a higher level down now that its block has started
+static void cascade(timer_wheel_t* wheel, int level, unsigned int index) {
+    timer_wheel_timer_t* head = &wheel->slots[level][index];
+    while (head->next != head) {
+        timer_wheel_timer_t* timer = head->next;
+        unlink_timer(timer);
+        place(wheel, timer);
+    }
+}
+
+int timer_wheel_init(timer_wheel_t* wheel, int64_t tick, int64_t now) {
+    if (!wheel || tick <= 0) {
+        return -1;
+    }
+
+    memset(wheel, 0, sizeof(timer_wheel_t));
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            timer_wheel_timer_t* head = &wheel->slots[level][i];
+            head->next = head;
+            head->prev = head;
+        }
+    }
+    wheel->origin = now;
+    wheel->tick = tick;
+    return 0;
+}
+
+void timer_wheel_timer_init(timer_wheel_timer_t* timer) {
+    if (!timer) {
+        return;
+    }
+
+    memset(timer, 0, sizeof(timer_wheel_timer_t));
+}
+
+bool timer_wheel_pending(const timer_wheel_timer_t* timer) {
+    return timer && timer->next != NULL;
+}
+
+void timer_wheel_schedule(timer_wheel_t* wheel, timer_wheel_timer_t* timer, int64_t expires) {
+    if (!wheel || !timer) {
+        return;
+    }
+
+    if (timer_wheel_pending(timer)) {
+        unlink_timer(timer);
+    } else {
+        wheel->count++;
+    }
+
+    timer->expires = tick_of(wheel, expires);
+    if (timer->expires <= wheel->now) {
+        timer->expires = wheel->now + 1;
+    }
+    place(wheel, timer);
+}
+
+void timer_wheel_cancel(timer_wheel_t* wheel, timer_wheel_timer_t* timer) {
+    if (!wheel || !timer_wheel_pending(timer)) {
+        return;
+    }
+
+    unlink_timer(timer);
+    wheel->count--;
+}
+
+size_t timer_wheel_advance(timer_wheel_t* wheel, int64_t now, timer_wheel_fn fn, void* ctx) {
+    if (!wheel) {
+        return 0;
+    }
+
+    uint64_t target = tick_of(wheel, now);
+    size_t fired = 0;
+    while (wheel->now < target) {
+        if (wheel->count == 0) {
+            wheel->now = target;
+            break;
+        }
+
+        uint64_t tick = ++wheel->now;
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (slot_index(tick, level - 1) != 0) {
+                break;
+            }
+            cascade(wheel, level, slot_index(tick, level));
+        }
+
+        // Detach the slot first so callbacks can reschedule freely
+        timer_wheel_timer_t* head = &wheel->slots[0][slot_index(tick, 0)];
+        if (head->next == head) {
+            continue;
+        }
+        timer_wheel_timer_t expired;
+        expired.next = head->next;
+        expired.prev = head->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        head->next = head;
+        head->prev = head;
+
+        while (expired.next != &expired) {
+            timer_wheel_timer_t* timer = expired.next;
+            unlink_timer(timer);
+            wheel->count--;
+            fired++;
+            if (fn) {
+                fn(ctx, timer);
+            }
+        }
+    }
+    return fired;
+}
+
+timer_wheel_timer_t* timer_wheel_earliest(timer_wheel_t* wheel) {
+    if (!wheel || wheel->count == 0) {
+        return NULL;
+    }
+
+    // Every level holds deadlines after its current slot, in slot order
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned int current = slot_index(wheel->now, level);
+        for (unsigned int i = 1; i <= TIMER_WHEEL_SLOTS; i++) {
+            timer_wheel_timer_t* head = &wheel->slots[level][(current + i) & SLOT_MASK];
+            if (head->next != head) {
+                return head->next;
+            }
+        }
+    }
+    return NULL;
+}
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include "timestamp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NS_PER_DAY (86400LL * TIMESTAMP_NS_PER_SEC)
+#define DATE_PREFIX_MAX 12
+
+// Last date prefix converted for one timestamp shape
+typedef struct {
+    char prefix[DATE_PREFIX_MAX];
+    size_t length;
+    int64_t day_ns;         // Midnight UTC of the cached date
+    int64_t local_offset;   // Local UTC offset on that date, for zone-less times
+    int64_t expires;        // Syslog dates depend on the current year
+} date_cache_t;
+
+typedef struct {
+    date_cache_t iso;
+    date_cache_t clf;
+    date_cache_t syslog;
+} timestamp_cache_t;
+
+// Per thread so parsing stays lock-free across source threads
+static _Thread_local timestamp_cache_t cache;
+
+int64_t timestamp_now(void) {
+    struct timespec ts;
+#ifdef CLOCK_REALTIME_COARSE
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+    return (int64_t)ts.tv_sec * TIMESTAMP_NS_PER_SEC + ts.tv_nsec;
+}
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool digits(const char* s, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!is_digit(s[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline int d2(const char* s) {
+    return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+static inline int d4(const char* s) {
+    return d2(s) * 100 + d2(s + 2);
+}
+
+// hh:mm:ss
+static inline bool clock_at(const char* s) {
+    return digits(s, 2) && s[2] == ':' && digits(s + 3, 2) && s[5] == ':' && digits(s + 6, 2);
+}
+
+static inline int64_t clock_ns(const char* s) {
+    return ((int64_t)d2(s) * 3600 + d2(s + 3) * 60 + d2(s + 6)) * TIMESTAMP_NS_PER_SEC;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t days_from_civil(int64_t y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Month number from a three-letter English abbreviation, 0 if unknown
+static int month_from_name(const char* s) {
+    uint32_t key = ((uint32_t)(s[0] | 0x20) << 16) | ((uint32_t)(s[1] | 0x20) << 8) |
+                   (uint32_t)(s[2] | 0x20);
+    switch (key) {
+    case ('j' << 16) | ('a' << 8) | 'n': return 1;
+    case ('f' << 16) | ('e' << 8) | 'b': return 2;
+    case ('m' << 16) | ('a' << 8) | 'r': return 3;
+    case ('a' << 16) | ('p' << 8) | 'r': return 4;
+    case ('m' << 16) | ('a' << 8) | 'y': return 5;
+    case ('j' << 16) | ('u' << 8) | 'n': return 6;
+    case ('j' << 16) | ('u' << 8) | 'l': return 7;
+    case ('a' << 16) | ('u' << 8) | 'g': return 8;
+    case ('s' << 16) | ('e' << 8) | 'p': return 9;
+    case ('o' << 16) | ('c' << 8) | 't': return 10;
+    case ('n' << 16) | ('o' << 8) | 'v': return 11;
+    case ('d' << 16) | ('e' << 8) | 'c': return 12;
+    default: return 0;
+    }
+}
+
+static inline bool valid_date(int m, int d) {
+    return m >= 1 && m <= 12 && d >= 1 && d <= 31;
+}
+
+static inline bool valid_clock(const char* s) {
+    return d2(s) < 24 && d2(s + 3) < 60 && d2(s + 6) <= 60;
+}
+
+static inline bool cache_hit(const date_cache_t* entry, const char* s, size_t length) {
+    return entry->length == length && memcmp(entry->prefix, s, length) == 0;
+}
+
+// Offset of local time from UTC around midday of a date (so DST is
+// honoured per date; only the hours around a switch are approximate)
+static int64_t local_offset_on(int64_t day_ns) {
+    time_t seconds = (time_t)(day_ns / TIMESTAMP_NS_PER_SEC + 12 * 3600);
+    struct tm tm;
+    if (!localtime_r(&seconds, &tm)) {
+        return 0;
+    }
+    return (int64_t)tm.tm_gmtoff * TIMESTAMP_NS_PER_SEC;
+}
+
+static inline void cache_store(date_cache_t* entry, const char* s, size_t length,
+                               int64_t day_ns, int64_t expires) {
+    memcpy(entry->prefix, s, length);
+    entry->length = length;
+    entry->day_ns = day_ns;
+    entry->local_offset = local_offset_on(day_ns);
+    entry->expires = expires;
+}
+
+// Numeric zone (+hh:mm, +hhmm) at s; returns bytes consumed, 0 if none
+static size_t parse_zone(const char* s, size_t n, int64_t* offset) {
+    if (n < 5 || (s[0] != '+' && s[0] != '-') || !digits(s + 1, 2)) {
+        return 0;
+    }
+
+    size_t used;
+    int minutes;
+    if (s[3] == ':' && n >= 6 && digits(s + 4, 2)) {
+        minutes = d2(s + 4);
+        used = 6;
+    } else if (digits(s + 3, 2)) {
+        minutes = d2(s + 3);
+        used = 5;
+    } else {
+        return 0;
+    }
+
+    int64_t value = ((int64_t)d2(s + 1) * 60 + minutes) * 60 * TIMESTAMP_NS_PER_SEC;
+    *offset = s[0] == '-' ? -value : value;
+    return used;
+}
+
+// 2024-01-02T03:04:05[.frac][Z|zone]
+static size_t parse_iso(const char* s, size_t n, int64_t* ns) {
+    if (n < 19 || !digits(s, 4) || s[4] != '-' || !digits(s + 5, 2) || s[7] != '-' ||
+        !digits(s + 8, 2) || (s[10] != 'T' && s[10] != ' ') || !clock_at(s + 11) ||
+        !valid_clock(s + 11)) {
+        return 0;
+    }
+
+    int64_t day_ns;
+    if (cache_hit(&cache.iso, s, 10)) {
+        day_ns = cache.iso.day_ns;
+    } else {
+        int m = d2(s + 5), d = d2(s + 8);
+        if (!valid_date(m, d)) {
+            return 0;
+        }
+        day_ns = days_from_civil(d4(s), m, d) * NS_PER_DAY;
+        cache_store(&cache.iso, s, 10, day_ns, INT64_MAX);
+    }
+
+    int64_t value = day_ns + clock_ns(s + 11);
+    size_t i = 19;
+
+    if (i < n && (s[i] == '.' || s[i] == ',')) {
+        int64_t fraction = 0, scale = TIMESTAMP_NS_PER_SEC;
+        i++;
+        while (i < n && is_digit(s[i])) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (s[i] - '0') * scale;
+            }
+            i++;
+        }
+        value += fraction;
+    }
+
+    int64_t offset;
+    size_t zone;
+    if (i < n && s[i] == 'Z') {
+        i++;
+    } else if ((zone = parse_zone(s + i, n - i, &offset)) > 0) {
+        value -= offset;
+        i += zone;
+    } else {
+        value -= cache.iso.local_offset;
+    }
+
+    *ns = value;
+    return i;
+}
+
+// 10/Oct/2000:13:55:36[ -0700]
+static size_t parse_clf(const char* s, size_t n, int64_t* ns) {
+    if (n < 20 || !digits(s, 2) || s[2] != '/' || s[6] != '/' || !digits(s + 7, 4) ||
+        s[11] != ':' || !clock_at(s + 12) || !valid_clock(s + 12)) {
+        return 0;
+    }
+
+    int64_t day_ns;
+    if (cache_hit(&cache.clf, s, 11)) {
+        day_ns = cache.clf.day_ns;
+    } else {
+        int m = month_from_name(s + 3), d = d2(s);
+        if (!valid_date(m, d)) {
+            return 0;
+        }
+        day_ns = days_from_civil(d4(s + 7), m, d) * NS_PER_DAY;
+        cache_store(&cache.clf, s, 11, day_ns, INT64_MAX);
+    }
+
+    int64_t value = day_ns + clock_ns(s + 12);
+    size_t i = 20;
+
+    int64_t offset;
+    size_t zone;
+    if (i < n && s[i] == ' ' && (zone = parse_zone(s + i + 1, n - i - 1, &offset)) > 0) {
+        value -= offset;
+        i += 1 + zone;
+    } else {
+        value -= cache.clf.local_offset;
+    }
+
+    *ns = value;
+    return i;
+}
+
+// Oct  1 22:14:15 (no year: the most recent such date not far in the future)
+static size_t parse_syslog(const char* s, size_t n, int64_t* ns) {
+    if (n < 15 || s[3] != ' ' || (s[4] != ' ' && !is_digit(s[4])) || !is_digit(s[5]) ||
+        s[6] != ' ' || !clock_at(s + 7) || !valid_clock(s + 7)) {
+        return 0;
+    }
+
+    int64_t now = timestamp_now();
+    int64_t day_ns;
+    if (cache_hit(&cache.syslog, s, 6) && now < cache.syslog.expires) {
+        day_ns = cache.syslog.day_ns;
+    } else {
+        int m = month_from_name(s);
+        int d = s[4] == ' ' ? s[5] - '0' : d2(s + 4);
+        if (!valid_date(m, d)) {
+            return 0;
+        }
+
+        time_t seconds = (time_t)(now / TIMESTAMP_NS_PER_SEC);
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        int64_t year = tm.tm_year + 1900;
+        int64_t days = days_from_civil(year, m, d);
+        if (days > now / NS_PER_DAY + 31) {
+            days = days_from_civil(year - 1, m, d);   // December lines read in January
+        }
+        day_ns = days * NS_PER_DAY;
+        cache_store(&cache.syslog, s, 6, day_ns, now + NS_PER_DAY);
+    }
+
+    *ns = day_ns + clock_ns(s + 7) - cache.syslog.local_offset;
+    return 15;
+}
+
+// Epoch number; the unit follows from the number of integer digits
+static size_t parse_epoch(const char* s, size_t n, int64_t* ns) {
+    size_t i = 0;
+    uint64_t value = 0;
+    while (i < n && is_digit(s[i]) && i < 19) {
+        value = value * 10 + (s[i] - '0');
+        i++;
+    }
+    if (i < 9 || (i < n && is_digit(s[i]))) {
+        return 0;
+    }
+
+    int64_t unit = i <= 11 ? TIMESTAMP_NS_PER_SEC : i <= 14 ? 1000000 : i <= 17 ? 1000 : 1;
+    int64_t result = (int64_t)(value * (uint64_t)unit);
+
+    if (i < n && s[i] == '.') {
+        int64_t scale = unit;
+        i++;
+        while (i < n && is_digit(s[i])) {
+            if (scale > 1) {
+                scale /= 10;
+                result += (s[i] - '0') * scale;
+            }
+            i++;
+        }
+    }
+
+    *ns = result;
+    return i;
+}
+
+size_t timestamp_parse(const char* text, size_t length, bool allow_epoch, int64_t* ns) {
+    if (!text || !ns || length == 0) {
+        return 0;
+    }
+
+    // Dispatch on the shape of the first bytes so each line tries one parser
+    size_t used = 0;
+    if (is_digit(text[0])) {
+        if (length > 4 && text[4] == '-') {
+            used = parse_iso(text, length, ns);
+        } else if (length > 2 && text[2] == '/') {
+            used = parse_clf(text, length, ns);
+        } else if (allow_epoch) {
+            used = parse_epoch(text, length, ns);
+        }
+    } else if (length > 3 && text[3] == ' ') {
+        used = parse_syslog(text, length, ns);
+    }
+    return used;
+}
+
+int timestamp_parse_duration(const char* text, int64_t* ns) {
+    if (!text || !ns) {
+        return -1;
+    }
+
+    char* end;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value <= 0) {
+        return -1;
+    }
+
+    int64_t unit = TIMESTAMP_NS_PER_SEC;
+    if (*end == 'm') {
+        unit *= 60;
+        end++;
+    } else if (*end == 'h') {
+        unit *= 3600;
+        end++;
+    } else if (*end == 's') {
+        end++;
+    }
+    if (*end != '\0' || value > INT64_MAX / unit) {
+        return -1;
+    }
+
+    *ns = value * unit;
+    return 0;
+}
\ No newline at end of file
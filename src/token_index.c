@@ -0,0 +1,428 @@
+#include "token_index.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TOKEN_SEED 0x746f6b656eULL
+
+typedef struct {
+    uint64_t hash;
+    uint32_t term;
+} term_order_t;
+
+static inline bool is_token_char(unsigned char c) {
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_';
+}
+
+static inline void store_le(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static inline uint64_t load_le(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+// Next indexed token at or after *offset; false when none is left
+static bool next_token(const char* text, size_t length, size_t* offset, size_t* start,
+                       size_t* token_len) {
+    size_t i = *offset;
+    while (i < length) {
+        while (i < length && !is_token_char((unsigned char)text[i])) {
+            i++;
+        }
+        *start = i;
+        bool number = true;
+        while (i < length && is_token_char((unsigned char)text[i])) {
+            number &= text[i] >= '0' && text[i] <= '9';
+            i++;
+        }
+        if (i > *start && (!number || i - *start >= TOKEN_INDEX_MIN_NUMBER)) {
+            *token_len = i - *start;
+            *offset = i;
+            return true;
+        }
+    }
+    *offset = i;
+    return false;
+}
+
+int token_index_builder_init(token_index_builder_t* builder) {
+    if (!builder) {
+        return -1;
+    }
+    memset(builder, 0, sizeof(token_index_builder_t));
+    builder->table_mask = 1023;
+    builder->table = (uint32_t*)calloc(builder->table_mask + 1, sizeof(uint32_t));
+    return builder->table ? 0 : -1;
+}
+
+void token_index_builder_destroy(token_index_builder_t* builder) {
+    if (!builder) {
+        return;
+    }
+    free(builder->hashes);
+    free(builder->counts);
+    free(builder->last_rows);
+    free(builder->table);
+    free(builder->pair_terms);
+    free(builder->pair_rows);
+    free(builder->terms);
+    free(builder->postings);
+    free(builder->bloom);
+    memset(builder, 0, sizeof(token_index_builder_t));
+}
+
+static int grow_table(token_index_builder_t* builder) {
+    size_t mask = builder->table_mask * 2 + 1;
+    uint32_t* table = (uint32_t*)calloc(mask + 1, sizeof(uint32_t));
+    if (!table) {
+        return -1;
+    }
+    for (size_t term = 0; term < builder->num_terms; term++) {
+        size_t slot = builder->hashes[term] & mask;
+        while (table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = (uint32_t)term + 1;
+    }
+    free(builder->table);
+    builder->table = table;
+    builder->table_mask = mask;
+    return 0;
+}
+
+// Index of a token's term, added if new; -1 on allocation failure
+static int64_t find_term(token_index_builder_t* builder, uint64_t hash) {
+    size_t slot = hash & builder->table_mask;
+    while (builder->table[slot] != 0) {
+        uint32_t term = builder->table[slot] - 1;
+        if (builder->hashes[term] == hash) {
+            return term;
+        }
+        slot = (slot + 1) & builder->table_mask;
+    }
+
+    if (builder->num_terms == builder->term_capacity) {
+        size_t capacity = builder->term_capacity ? builder->term_capacity * 2 : 1024;
+        uint64_t* hashes = (uint64_t*)realloc(builder->hashes, capacity * sizeof(uint64_t));
+        if (hashes) {
+            builder->hashes = hashes;
+        }
+        uint32_t* counts = (uint32_t*)realloc(builder->counts, capacity * sizeof(uint32_t));
+        if (counts) {
+            builder->counts = counts;
+        }
+        uint32_t* last_rows = (uint32_t*)realloc(builder->last_rows, capacity * sizeof(uint32_t));
+        if (last_rows) {
+            builder->last_rows = last_rows;
+        }
+        if (!hashes || !counts || !last_rows) {
+            return -1;
+        }
+        builder->term_capacity = capacity;
+    }
+    size_t term = builder->num_terms++;
+    builder->hashes[term] = hash;
+    builder->counts[term] = 0;
+    builder->last_rows[term] = UINT32_MAX;
+    builder->table[slot] = (uint32_t)term + 1;
+    if (builder->num_terms * 2 > builder->table_mask + 1 && grow_table(builder) != 0) {
+        return -1;
+    }
+    return (int64_t)term;
+}
+
+int token_index_add(token_index_builder_t* builder, uint32_t row, const char* text,
+                    size_t length) {
+    if (!builder || !builder->table || (row < builder->next_row) || (!text && length > 0)) {
+        return -1;
+    }
+    builder->next_row = row + 1;
+
+    size_t offset = 0;
+    size_t start;
+    size_t token_len;
+    while (next_token(text, length, &offset, &start, &token_len)) {
+        int64_t term = find_term(builder, hash64(text + start, token_len, TOKEN_SEED));
+        if (term < 0) {
+            return -1;
+        }
+        if (builder->last_rows[term] == row) {
+            continue; // Repeated within the line
+        }
+        if (builder->num_pairs == builder->pair_capacity) {
+            size_t capacity = builder->pair_capacity ? builder->pair_capacity * 2 : 16384;
+            uint32_t* terms = (uint32_t*)realloc(builder->pair_terms, capacity * sizeof(uint32_t));
+            if (terms) {
+                builder->pair_terms = terms;
+            }
+            uint32_t* rows = (uint32_t*)realloc(builder->pair_rows, capacity * sizeof(uint32_t));
+            if (rows) {
+                builder->pair_rows = rows;
+            }
+            if (!terms || !rows) {
+                return -1;
+            }
+            builder->pair_capacity = capacity;
+        }
+        builder->pair_terms[builder->num_pairs] = (uint32_t)term;
+        builder->pair_rows[builder->num_pairs] = row;
+        builder->num_pairs++;
+        builder->last_rows[term] = row;
+        builder->counts[term]++;
+    }
+    return 0;
+}
+
+static int compare_terms(const void* a, const void* b) {
+    uint64_t left = ((const term_order_t*)a)->hash;
+    uint64_t right = ((const term_order_t*)b)->hash;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+// Bit-pack one list's gaps; out must hold the worst case
+static size_t encode_list(uint8_t* out, const uint32_t* rows, size_t count) {
+    uint8_t* p = out;
+    int64_t previous = -1;
+    for (size_t first = 0; first < count; first += TOKEN_INDEX_BLOCK) {
+        size_t n = count - first < TOKEN_INDEX_BLOCK ? count - first : TOKEN_INDEX_BLOCK;
+        uint32_t gaps[TOKEN_INDEX_BLOCK];
+        uint32_t largest = 0;
+        for (size_t i = 0; i < n; i++) {
+            gaps[i] = (uint32_t)((int64_t)rows[first + i] - previous - 1);
+            previous = rows[first + i];
+            largest |= gaps[i];
+        }
+        unsigned int width = largest ? 32 - (unsigned int)__builtin_clz(largest) : 0;
+        *p++ = (uint8_t)width;
+
+        uint64_t bits = 0;
+        unsigned int filled = 0;
+        for (size_t i = 0; i < n && width > 0; i++) {
+            bits |= (uint64_t)gaps[i] << filled;
+            filled += width;
+            while (filled >= 8) {
+                *p++ = (uint8_t)bits;
+                bits >>= 8;
+                filled -= 8;
+            }
+        }
+        if (filled > 0) {
+            *p++ = (uint8_t)bits;
+        }
+    }
+    return (size_t)(p - out);
+}
+
+static void bloom_set(uint8_t* bits, size_t num_bits, uint64_t hash) {
+    uint64_t step = (hash >> 33) | 1;
+    for (unsigned int i = 0; i < TOKEN_INDEX_BLOOM_PROBES; i++) {
+        uint64_t bit = (hash + i * step) % num_bits;
+        bits[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+}
+
+int token_index_finish(token_index_builder_t* builder) {
+    if (!builder || !builder->table || builder->terms) {
+        return -1;
+    }
+
+    size_t num_terms = builder->num_terms;
+    term_order_t* order = (term_order_t*)malloc((num_terms + 1) * sizeof(term_order_t));
+    uint32_t* cursors = (uint32_t*)malloc((num_terms + 1) * sizeof(uint32_t));
+    uint32_t* rows = (uint32_t*)malloc((builder->num_pairs + 1) * sizeof(uint32_t));
+    // Worst case per list: a width byte per block and 4 bytes per row
+    size_t worst =
+        builder->num_pairs * 4 + (builder->num_pairs / TOKEN_INDEX_BLOCK + 1) * num_terms;
+    builder->postings = (uint8_t*)malloc(worst + 1);
+    builder->terms_size = num_terms * TOKEN_INDEX_TERM_SIZE;
+    builder->terms = (uint8_t*)malloc(builder->terms_size + 1);
+    size_t num_bits = num_terms * TOKEN_INDEX_BLOOM_BITS;
+    num_bits = num_bits < 64 ? 64 : (num_bits + 63) & ~(size_t)63;
+    builder->bloom_size = 8 + num_bits / 8;
+    builder->bloom = (uint8_t*)calloc(1, builder->bloom_size);
+    if (!order || !cursors || !rows || !builder->postings || !builder->terms || !builder->bloom) {
+        free(order);
+        free(cursors);
+        free(rows);
+        return -1;
+    }
+
+    // Lists are laid out by hash; pairs are in row order, so each list is too
+    for (size_t term = 0; term < num_terms; term++) {
+        order[term].hash = builder->hashes[term];
+        order[term].term = (uint32_t)term;
+    }
+    qsort(order, num_terms, sizeof(term_order_t), compare_terms);
+    uint32_t start = 0;
+    for (size_t i = 0; i < num_terms; i++) {
+        cursors[order[i].term] = start;
+        start += builder->counts[order[i].term];
+    }
+    for (size_t p = 0; p < builder->num_pairs; p++) {
+        rows[cursors[builder->pair_terms[p]]++] = builder->pair_rows[p];
+    }
+
+    store_le(builder->bloom, TOKEN_INDEX_BLOOM_PROBES, 4);
+    store_le(builder->bloom + 4, num_bits, 4);
+    start = 0;
+    for (size_t i = 0; i < num_terms; i++) {
+        uint32_t count = builder->counts[order[i].term];
+        uint8_t* entry = builder->terms + i * TOKEN_INDEX_TERM_SIZE;
+        store_le(entry, order[i].hash, 8);
+        store_le(entry + 8, builder->postings_size, 4);
+        store_le(entry + 12, count, 4);
+        builder->postings_size += encode_list(builder->postings + builder->postings_size,
+                                              rows + start, count);
+        bloom_set(builder->bloom + 8, num_bits, order[i].hash);
+        start += count;
+    }
+
+    free(order);
+    free(cursors);
+    free(rows);
+    return 0;
+}
+
+size_t token_index_tokens(const char* text, size_t length, uint64_t* hashes, size_t max) {
+    if (!text || !hashes) {
+        return 0;
+    }
+    size_t count = 0;
+    size_t offset = 0;
+    size_t start;
+    size_t token_len;
+    while (count < max && next_token(text, length, &offset, &start, &token_len)) {
+        uint64_t hash = hash64(text + start, token_len, TOKEN_SEED);
+        bool seen = false;
+        for (size_t i = 0; i < count && !seen; i++) {
+            seen = hashes[i] == hash;
+        }
+        if (!seen) {
+            hashes[count++] = hash;
+        }
+    }
+    return count;
+}
+
+bool token_index_bloom_test(const uint8_t* bloom, size_t size, uint64_t hash) {
+    if (!bloom || size < 8) {
+        return true;
+    }
+    uint32_t probes = (uint32_t)load_le(bloom, 4);
+    uint64_t num_bits = load_le(bloom + 4, 4);
+    if (num_bits == 0 || num_bits > (size - 8) * 8) {
+        return true; // Unusable: cannot rule anything out
+    }
+    const uint8_t* bits = bloom + 8;
+    uint64_t step = (hash >> 33) | 1;
+    for (uint32_t i = 0; i < probes; i++) {
+        uint64_t bit = (hash + i * step) % num_bits;
+        if (!(bits[bit / 8] & (1u << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool token_index_lookup(const uint8_t* terms, size_t num_terms, uint64_t hash, uint32_t* offset,
+                        uint32_t* count) {
+    size_t low = 0;
+    size_t high = num_terms;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const uint8_t* entry = terms + middle * TOKEN_INDEX_TERM_SIZE;
+        uint64_t found = load_le(entry, 8);
+        if (found == hash) {
+            *offset = (uint32_t)load_le(entry + 8, 4);
+            *count = (uint32_t)load_le(entry + 12, 4);
+            return true;
+        }
+        if (found < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+int token_index_decode(const uint8_t* postings, size_t size, uint32_t offset, uint32_t count,
+                       uint32_t* rows) {
+    if (offset > size) {
+        return -1;
+    }
+    const uint8_t* p = postings + offset;
+    const uint8_t* end = postings + size;
+    int64_t previous = -1;
+    for (size_t first = 0; first < count; first += TOKEN_INDEX_BLOCK) {
+        size_t n = count - first < TOKEN_INDEX_BLOCK ? count - first : TOKEN_INDEX_BLOCK;
+        if (p == end) {
+            return -1;
+        }
+        unsigned int width = *p++;
+        if (width > 32 || (size_t)(end - p) < (n * width + 7) / 8) {
+            return -1;
+        }
+        uint64_t mask = width == 32 ? 0xffffffffULL : (1ULL << width) - 1;
+        uint64_t bits = 0;
+        unsigned int filled = 0;
+        for (size_t i = 0; i < n; i++) {
+            while (filled < width) {
+                bits |= (uint64_t)*p++ << filled;
+                filled += 8;
+            }
+            uint64_t gap = bits & mask;
+            bits >>= width;
+            filled -= width;
+            previous += (int64_t)gap + 1;
+            if (previous > UINT32_MAX) {
+                return -1;
+            }
+            rows[first + i] = (uint32_t)previous;
+        }
+    }
+    return 0;
+}
+
+size_t token_index_intersect(uint32_t* rows, size_t count, const uint32_t* other,
+                             size_t other_count) {
+    size_t kept = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < count && j < other_count; i++) {
+        while (j < other_count && other[j] < rows[i]) {
+            j++;
+        }
+        if (j < other_count && other[j] == rows[i]) {
+            rows[kept++] = rows[i];
+        }
+    }
+    return kept;
+}
+
+bool token_index_match(const char* line, size_t length, const char* text, size_t text_len) {
+    if (!line || !text || text_len == 0 || text_len > length) {
+        return false;
+    }
+    bool open_start = is_token_char((unsigned char)text[0]);
+    bool open_end = is_token_char((unsigned char)text[text_len - 1]);
+    const char* last = line + length - text_len;
+    for (const char* p = line; p <= last; p++) {
+        p = (const char*)memchr(p, text[0], (size_t)(last - p) + 1);
+        if (!p) {
+            return false;
+        }
+        if (memcmp(p, text, text_len) == 0 &&
+            (!open_start || p == line || !is_token_char((unsigned char)p[-1])) &&
+            (!open_end || p == last || !is_token_char((unsigned char)p[text_len]))) {
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
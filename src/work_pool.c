@@ -0,0 +1,437 @@
+#include "work_pool.h"
+#include "log_entry.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define INITIAL_RING_CAPACITY 16
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool is_running(const work_pool_t* pool) {
+    return __atomic_load_n(&pool->running, __ATOMIC_ACQUIRE);
+}
+
+static bool is_active(const work_worker_t* worker) {
+    return worker->index < __atomic_load_n(&worker->pool->num_workers, __ATOMIC_ACQUIRE);
+}
+
+static int deque_push(work_worker_t* worker, work_batch_t* batch) {
+    pthread_mutex_lock(&worker->mutex);
+
+    if (worker->count == worker->capacity) {
+        // Grow and unwrap the ring
+        size_t capacity = worker->capacity ? worker->capacity * 2 : INITIAL_RING_CAPACITY;
+        work_batch_t** ring = (work_batch_t**)malloc(capacity * sizeof(work_batch_t*));
+        if (!ring) {
+            pthread_mutex_unlock(&worker->mutex);
+            return -1;
+        }
+        for (size_t i = 0; i < worker->count; i++) {
+            ring[i] = worker->ring[(worker->head + i) & (worker->capacity - 1)];
+        }
+        free(worker->ring);
+        worker->ring = ring;
+        worker->capacity = capacity;
+        worker->head = 0;
+    }
+
+    worker->ring[(worker->head + worker->count) & (worker->capacity - 1)] = batch;
+    __atomic_store_n(&worker->count, worker->count + 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&worker->mutex);
+    return 0;
+}
+
+// Owners take the oldest batch, thieves the newest
+static work_batch_t* deque_take(work_worker_t* worker, bool oldest) {
+    // Unlocked peek: skip empty deques without touching their lock
+    if (__atomic_load_n(&worker->count, __ATOMIC_ACQUIRE) == 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+
+    work_batch_t* batch = NULL;
+    if (worker->count > 0) {
+        size_t mask = worker->capacity - 1;
+        if (oldest) {
+            batch = worker->ring[worker->head];
+            worker->head = (worker->head + 1) & mask;
+        } else {
+            batch = worker->ring[(worker->head + worker->count - 1) & mask];
+        }
+        __atomic_store_n(&worker->count, worker->count - 1, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&worker->mutex);
+    return batch;
+}
+
+static work_batch_t* take_batch(work_pool_t* pool, work_worker_t* self, bool* stolen) {
+    work_batch_t* batch = deque_take(self, true);
+    if (batch) {
+        *stolen = false;
+        return batch;
+    }
+
+    // Scan every deque, including those of workers that have exited
+    for (size_t i = 1; i < pool->max_workers; i++) {
+        work_worker_t* victim = &pool->workers[(self->index + i) % pool->max_workers];
+        batch = deque_take(victim, false);
+        if (batch) {
+            *stolen = true;
+            return batch;
+        }
+    }
+    return NULL;
+}
+
+static void* worker_thread_func(void* arg) {
+    work_worker_t* worker = (work_worker_t*)arg;
+    work_pool_t* pool = worker->pool;
+
+    while (is_running(pool) && is_active(worker)) {
+        bool stolen = false;
+        work_batch_t* batch = take_batch(pool, worker, &stolen);
+        if (batch) {
+            uint64_t start = monotonic_ns();
+            __atomic_add_fetch(&pool->wait_ns, start - batch->submitted_ns, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&pool->waited_batches, 1, __ATOMIC_RELAXED);
+
+            // Blocked submitters are woken once half the limit is free
+            size_t left = __atomic_sub_fetch(&pool->pending, batch->count, __ATOMIC_SEQ_CST);
+            if (pool->max_pending > 0 && left <= pool->max_pending / 2 &&
+                __atomic_load_n(&pool->blocked, __ATOMIC_SEQ_CST) > 0) {
+                pthread_mutex_lock(&pool->mutex);
+                pthread_cond_broadcast(&pool->space);
+                pthread_mutex_unlock(&pool->mutex);
+            }
+            if (stolen) {
+                metrics_add(worker->steals, 1);
+            }
+
+            for (size_t i = 0; i < batch->count; i++) {
+                pool->fn(pool->ctx, batch->entries[i]);
+            }
+            __atomic_add_fetch(&worker->busy_ns, monotonic_ns() - start, __ATOMIC_RELAXED);
+            metrics_add(worker->entries, batch->count);
+            free(batch);
+            continue;
+        }
+
+        // Sleep until something is submitted. pending is raised after a
+        // batch is pushed, so seeing it non-zero here means a batch is
+        // visible or about to be taken by another worker. Submitters only
+        // signal when they see a sleeper; the sequentially consistent
+        // sleepers/pending pair guarantees one side sees the other.
+        pthread_mutex_lock(&pool->mutex);
+        bool idle = false;
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (pool->running && is_active(worker) &&
+               __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&pool->work, &pool->mutex);
+            idle = true;
+        }
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (!idle) {
+            sched_yield();  // Another worker is mid-take
+        }
+    }
+
+    return NULL;
+}
+
+static void collect_utilization(void* ctx) {
+    work_pool_t* pool = (work_pool_t*)ctx;
+    uint64_t now = monotonic_ns();
+
+    for (size_t i = 0; i < pool->max_workers; i++) {
+        work_worker_t* worker = &pool->workers[i];
+        metric_t* utilization = __atomic_load_n(&worker->utilization, __ATOMIC_ACQUIRE);
+        if (!utilization) {
+            continue;
+        }
+
+        uint64_t busy = __atomic_load_n(&worker->busy_ns, __ATOMIC_RELAXED);
+        uint64_t elapsed = now - worker->last_sample_ns;
+        if (elapsed > 0) {
+            metrics_set(utilization, (busy - worker->last_busy_ns) * 100 / elapsed);
+        }
+        worker->last_busy_ns = busy;
+        worker->last_sample_ns = now;
+    }
+}
+
+int work_pool_init(work_pool_t* pool, size_t max_workers, size_t max_pending,
+                   work_pool_fn fn, void* ctx) {
+    if (!pool || max_workers == 0 || !fn) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(work_pool_t));
+    pool->workers = (work_worker_t*)calloc(max_workers, sizeof(work_worker_t));
+    if (!pool->workers) {
+        return -1;
+    }
+
+    pool->max_workers = max_workers;
+    pool->max_pending = max_pending;
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->space, NULL);
+    pthread_mutex_init(&pool->resize_mutex, NULL);
+
+    for (size_t i = 0; i < max_workers; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pthread_mutex_init(&pool->workers[i].mutex, NULL);
+    }
+
+    return 0;
+}
+
+// Caller holds resize_mutex; workers below index are running
+static int start_worker(work_pool_t* pool, size_t index) {
+    work_worker_t* worker = &pool->workers[index];
+    char name[METRICS_NAME_MAX];
+    snprintf(name, sizeof(name), "processor.worker%zu.entries", index);
+    worker->entries = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "processor.worker%zu.steals", index);
+    worker->steals = metrics_register(name, METRIC_COUNTER);
+    snprintf(name, sizeof(name), "processor.worker%zu.utilization", index);
+    // The metrics collector may be sampling the other workers right now
+    __atomic_store_n(&worker->utilization, metrics_register(name, METRIC_GAUGE),
+                     __ATOMIC_RELEASE);
+
+    // Published before the thread starts so it sees itself as active
+    __atomic_store_n(&pool->num_workers, index + 1, __ATOMIC_RELEASE);
+    if (pthread_create(&worker->thread, NULL, worker_thread_func, worker) != 0) {
+        __atomic_store_n(&pool->num_workers, index, __ATOMIC_RELEASE);
+        return -1;
+    }
+    worker->started = true;
+    return 0;
+}
+
+// Caller holds resize_mutex
+static void join_workers(work_pool_t* pool, size_t from) {
+    pthread_mutex_lock(&pool->mutex);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = from; i < pool->max_workers; i++) {
+        if (pool->workers[i].started) {
+            pthread_join(pool->workers[i].thread, NULL);
+            pool->workers[i].started = false;
+        }
+    }
+}
+
+int work_pool_start(work_pool_t* pool, size_t num_workers) {
+    if (!pool || is_running(pool) || num_workers == 0 || num_workers > pool->max_workers) {
+        return -1;
+    }
+
+    __atomic_store_n(&pool->running, true, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&pool->resize_mutex);
+    for (size_t i = 0; i < num_workers; i++) {
+        if (start_worker(pool, i) != 0) {
+            pthread_mutex_unlock(&pool->resize_mutex);
+            work_pool_stop(pool);
+            return -1;
+        }
+    }
+    pthread_mutex_unlock(&pool->resize_mutex);
+
+    uint64_t now = monotonic_ns();
+    for (size_t i = 0; i < pool->max_workers; i++) {
+        pool->workers[i].last_busy_ns = __atomic_load_n(&pool->workers[i].busy_ns, __ATOMIC_RELAXED);
+        pool->workers[i].last_sample_ns = now;
+    }
+    metrics_add_collector(collect_utilization, pool);
+    return 0;
+}
+
+int work_pool_resize(work_pool_t* pool, size_t num_workers) {
+    if (!pool || num_workers == 0 || num_workers > pool->max_workers) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&pool->resize_mutex);
+    if (!is_running(pool)) {
+        pthread_mutex_unlock(&pool->resize_mutex);
+        return -1;
+    }
+
+    int result = 0;
+    size_t current = __atomic_load_n(&pool->num_workers, __ATOMIC_ACQUIRE);
+    for (size_t i = current; i < num_workers; i++) {
+        if (start_worker(pool, i) != 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (num_workers < current) {
+        // Submitters stop targeting the retired deques at once; what is
+        // already queued there is stolen by the remaining workers
+        __atomic_store_n(&pool->num_workers, num_workers, __ATOMIC_RELEASE);
+        join_workers(pool, num_workers);
+    }
+    pthread_mutex_unlock(&pool->resize_mutex);
+    return result;
+}
+
+size_t work_pool_size(const work_pool_t* pool) {
+    if (!pool) {
+        return 0;
+    }
+
+    return __atomic_load_n(&pool->num_workers, __ATOMIC_ACQUIRE);
+}
+
+void work_pool_stop(work_pool_t* pool) {
+    if (!pool) {
+        return;
+    }
+
+    if (!pool->workers) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->resize_mutex);
+    pthread_mutex_lock(&pool->mutex);
+    __atomic_store_n(&pool->running, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->space);
+    pthread_mutex_unlock(&pool->mutex);
+
+    join_workers(pool, 0);
+    __atomic_store_n(&pool->num_workers, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&pool->resize_mutex);
+
+    metrics_remove_collector(collect_utilization, pool);
+}
+
+void work_pool_destroy(work_pool_t* pool) {
+    if (!pool || !pool->workers) {
+        return;
+    }
+
+    work_pool_stop(pool);
+
+    for (size_t i = 0; i < pool->max_workers; i++) {
+        work_worker_t* worker = &pool->workers[i];
+        work_batch_t* batch;
+        while ((batch = deque_take(worker, true)) != NULL) {
+            for (size_t j = 0; j < batch->count; j++) {
+                log_entry_destroy(batch->entries[j]);
+            }
+            free(batch);
+        }
+        free(worker->ring);
+        pthread_mutex_destroy(&worker->mutex);
+    }
+
+    pthread_cond_destroy(&pool->space);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_mutex_destroy(&pool->resize_mutex);
+    free(pool->workers);
+    memset(pool, 0, sizeof(work_pool_t));
+}
+
+static void destroy_entries(log_entry_t** entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        log_entry_destroy(entries[i]);
+    }
+}
+
+int work_pool_submit(work_pool_t* pool, log_entry_t** entries, size_t count,
+                     uint64_t affinity) {
+    if (!entries || count == 0) {
+        return 0;
+    }
+    if (!pool || !is_running(pool)) {
+        destroy_entries(entries, count);
+        return -1;
+    }
+
+    // Backpressure; a batch larger than the limit still goes through alone
+    if (pool->max_pending > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        size_t pending;
+        __atomic_add_fetch(&pool->blocked, 1, __ATOMIC_SEQ_CST);
+        while (pool->running && (pending = __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST)) > 0 &&
+               pending + count > pool->max_pending) {
+            pthread_cond_wait(&pool->space, &pool->mutex);
+        }
+        __atomic_sub_fetch(&pool->blocked, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    size_t num_workers = __atomic_load_n(&pool->num_workers, __ATOMIC_ACQUIRE);
+    if (num_workers == 0) {
+        destroy_entries(entries, count);
+        return -1;
+    }
+
+    int result = 0;
+    size_t pushed = 0;
+    for (size_t offset = 0; offset < count; offset += WORK_POOL_BATCH) {
+        size_t chunk = count - offset < WORK_POOL_BATCH ? count - offset : WORK_POOL_BATCH;
+        size_t target = affinity == WORK_POOL_ANY
+            ? __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED) % num_workers
+            : affinity % num_workers;
+
+        work_batch_t* batch = (work_batch_t*)malloc(sizeof(work_batch_t));
+        if (!batch) {
+            destroy_entries(entries + offset, chunk);
+            result = -1;
+            continue;
+        }
+        batch->count = chunk;
+        batch->submitted_ns = monotonic_ns();
+        memcpy(batch->entries, entries + offset, chunk * sizeof(log_entry_t*));
+
+        if (deque_push(&pool->workers[target], batch) != 0) {
+            destroy_entries(batch->entries, chunk);
+            free(batch);
+            result = -1;
+            continue;
+        }
+        __atomic_add_fetch(&pool->pending, chunk, __ATOMIC_SEQ_CST);
+        pushed++;
+    }
+
+    if (pushed > 0 && __atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        if (pushed == 1) {
+            pthread_cond_signal(&pool->work);
+        } else {
+            pthread_cond_broadcast(&pool->work);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return result;
+}
+
+size_t work_pool_pending(const work_pool_t* pool) {
+    if (!pool) {
+        return 0;
+    }
+
+    return __atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE);
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "../include/alert_dedup.h"
+#include "../include/log_entry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SEC 1000000000LL
+
+typedef struct {
+    size_t summaries;
+    uint64_t repeats;
+    int64_t elapsed;
+    char sample[ALERT_DEDUP_SAMPLE_MAX];
+} summary_log_t;
+
+static void record_summary(void* ctx, const alert_dedup_slot_t* slot, uint64_t repeats,
+                           int64_t elapsed) {
+    summary_log_t* log = (summary_log_t*)ctx;
+    log->summaries++;
+    log->repeats += repeats;
+    log->elapsed = elapsed;
+    snprintf(log->sample, sizeof(log->sample), "%s", slot->sample);
+}
+
+static bool admit(alert_dedup_t* dedup, const char* source, const char* message, int64_t now) {
+    log_entry_t* entry = log_entry_create(source, message, LOG_LEVEL_ERROR, message);
+    assert(entry != NULL);
+    bool emitted = alert_dedup_admit(dedup, entry, now);
+    log_entry_destroy(entry);
+    return emitted;
+}
+
+static uint64_t fp(const char* message) {
+    return alert_dedup_fingerprint(LOG_LEVEL_ERROR, "app.log", message);
+}
+
+void test_alert_dedup(void) {
+    // Test normalization: variable tokens are masked, the text is not
+    assert(fp("timeout after 503 ms on 10.0.0.7") == fp("timeout after 12 ms on 192.168.1.20"));
+    assert(fp("request 550e8400-e29b-41d4-a716-446655440000 failed") ==
+           fp("request 123e4567-e89b-12d3-a456-426614174000 failed"));
+    assert(fp("bad pointer 0x7ffd1234") == fp("bad pointer 0xDEADBEEF"));
+    assert(fp("trace 4bf92f3577b34da6 dropped") == fp("trace a3ce929d0e0e4736 dropped"));
+    assert(fp("user42 logged out") == fp("user7 logged out"));
+    assert(fp("connection refused") != fp("connection reset"));
+    assert(fp("cache deadbeef miss") != fp("cache cafebabe miss"));
+    assert(fp("disk full") != alert_dedup_fingerprint(LOG_LEVEL_CRITICAL, "app.log", "disk full"));
+    assert(fp("disk full") != alert_dedup_fingerprint(LOG_LEVEL_ERROR, "db.log", "disk full"));
+    assert(alert_dedup_fingerprint(LOG_LEVEL_ERROR, "network:10.0.0.1:4000", "x") ==
+           alert_dedup_fingerprint(LOG_LEVEL_ERROR, "network:10.0.0.1:5000", "x"));
+
+    // Long messages hash past the normalization chunk
+    char long_a[1200];
+    char long_b[1200];
+    memset(long_a, 'a', sizeof(long_a) - 1);
+    long_a[sizeof(long_a) - 1] = '\0';
+    memcpy(long_b, long_a, sizeof(long_b));
+    long_b[1000] = 'b';
+    assert(fp(long_a) != fp(long_b));
+
+    // Test the window: first alert emitted, repeats counted, then summarized
+    summary_log_t log;
+    memset(&log, 0, sizeof(log));
+    alert_dedup_t dedup;
+    assert(alert_dedup_init(&dedup, 16, 10 * SEC, record_summary, &log) == 0);
+    int64_t now = 1000 * SEC;
+    assert(admit(&dedup, "app.log", "db timeout after 30 ms", now));
+    for (int i = 0; i < 500; i++) {
+        assert(!admit(&dedup, "app.log", "db timeout after 31 ms", now + i * 1000000LL));
+    }
+    assert(admit(&dedup, "app.log", "disk full", now));
+    alert_dedup_flush(&dedup, now + 5 * SEC, false);
+    assert(log.summaries == 0);
+    alert_dedup_flush(&dedup, now + 10 * SEC, false);
+    assert(log.summaries == 1 && log.repeats == 500);
+    assert(log.elapsed == 10 * SEC);
+    assert(strcmp(log.sample, "db timeout after 30 ms") == 0);
+
+    // The storm continues into the next window, then a quiet window ends it
+    assert(!admit(&dedup, "app.log", "db timeout after 99 ms", now + 12 * SEC));
+    alert_dedup_flush(&dedup, now + 20 * SEC, false);
+    assert(log.summaries == 2 && log.repeats == 501);
+    alert_dedup_flush(&dedup, now + 30 * SEC, false);
+    assert(log.summaries == 2);
+    assert(admit(&dedup, "app.log", "db timeout after 5 ms", now + 31 * SEC));
+
+    // An expired window is also noticed by the next alert itself
+    assert(!admit(&dedup, "app.log", "db timeout after 6 ms", now + 32 * SEC));
+    assert(!admit(&dedup, "app.log", "db timeout after 6 ms", now + 45 * SEC));
+    assert(log.summaries == 3 && log.repeats == 502);
+
+    // Shutdown summarizes what is pending
+    alert_dedup_flush(&dedup, now + 46 * SEC, true);
+    assert(log.summaries == 4 && log.repeats == 503);
+    alert_dedup_destroy(&dedup);
+
+    // Test bounded memory: many distinct fingerprints evict the oldest, and
+    // evicted counts are summarized rather than lost
+    memset(&log, 0, sizeof(log));
+    assert(alert_dedup_init(&dedup, 8, 10 * SEC, record_summary, &log) == 0);
+    size_t capacity = dedup.num_buckets * ALERT_DEDUP_WAYS;
+    assert(capacity == 8);
+    assert(admit(&dedup, "app.log", "storm", now));
+    assert(!admit(&dedup, "app.log", "storm", now + 1));
+    for (int i = 0; i < 1000; i++) {
+        char message[32];
+        snprintf(message, sizeof(message), "distinct %c%c", 'a' + i % 26, 'a' + (i / 26) % 26);
+        admit(&dedup, "app.log", message, now + 2 + i);
+    }
+    assert(dedup.num_buckets * ALERT_DEDUP_WAYS == capacity);
+    assert(log.summaries == 1 && log.repeats == 1);
+    assert(strcmp(log.sample, "storm") == 0);
+    assert(admit(&dedup, "app.log", "storm", now + 2000));
+    alert_dedup_destroy(&dedup);
+
+    // Entries tagged with a mined template fold by template, not by message
+    memset(&log, 0, sizeof(log));
+    assert(alert_dedup_init(&dedup, 16, 10 * SEC, record_summary, &log) == 0);
+    log_entry_t* first = log_entry_create("app.log", "login failed for alice", LOG_LEVEL_ERROR, "x");
+    log_entry_t* second = log_entry_create("app.log", "login failed for bob", LOG_LEVEL_ERROR, "x");
+    assert(first != NULL && second != NULL);
+    assert(alert_dedup_admit(&dedup, first, now));
+    assert(alert_dedup_admit(&dedup, second, now + 1));
+    first->template_id = 7;
+    second->template_id = 7;
+    assert(alert_dedup_admit(&dedup, first, now + 2));
+    assert(!alert_dedup_admit(&dedup, second, now + 3));
+    second->template_id = 8;
+    assert(alert_dedup_admit(&dedup, second, now + 4));
+    log_entry_destroy(first);
+    log_entry_destroy(second);
+    alert_dedup_destroy(&dedup);
+
+    assert(alert_dedup_init(&dedup, 0, SEC, record_summary, &log) == -1);
+    assert(alert_dedup_init(&dedup, 8, 0, record_summary, &log) == -1);
+}
\ No newline at end of file
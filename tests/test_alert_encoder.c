@@ -0,0 +1,258 @@
+#include "../include/alert_encoder.h"
+#include "../include/alert_writer.h"
+#include "../include/config.h"
+#include "../include/processor.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SEC 1000000000LL
+
+// Destination collecting deliveries in memory
+typedef struct {
+    char data[8192];
+    size_t length;
+    int calls;
+} capture_t;
+
+static int capture_deliver(void* ctx, struct iovec* iov, int count) {
+    capture_t* capture = (capture_t*)ctx;
+    capture->calls++;
+    for (int i = 0; i < count; i++) {
+        assert(capture->length + iov[i].iov_len < sizeof(capture->data));
+        memcpy(capture->data + capture->length, iov[i].iov_base, iov[i].iov_len);
+        capture->length += iov[i].iov_len;
+    }
+    capture->data[capture->length] = '\0';
+    return 0;
+}
+
+static uint64_t load_le(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)(unsigned char)data[i] << (8 * i);
+    }
+    return value;
+}
+
+static void test_json(void) {
+    char out[512];
+    alert_line_t line = {1700000000123456789LL, LOG_LEVEL_ERROR, "logs/app.log",
+                         "disk \"/var\" full\\\n\t\x01 caf\xc3\xa9", " (repeated 3 times in 10s)",
+                         0, 0, 0, NULL};
+    char expected[512];
+    snprintf(expected, sizeof(expected),
+             "{\"ts\":1700000000123456789,\"level\":\"ERROR\",\"source\":\"logs/app.log\","
+             "\"source_id\":%u,\"message\":\"disk \\\"/var\\\" full\\\\\\n\\t\\u0001 caf\xc3\xa9"
+             " (repeated 3 times in 10s)\"}\n",
+             alert_source_id("logs/app.log"));
+    size_t length = alert_encode_json(out, sizeof(out), &line, SIZE_MAX);
+    assert(length == strlen(expected) && memcmp(out, expected, length) == 0);
+
+    // Identifiers appear only when set
+    line.suffix = NULL;
+    line.message = "x";
+    line.timestamp = -5;
+    line.template_id = 12;
+    line.rule_id = LOG_RULE_ID(LOG_RULE_RATE, 1);
+    line.patterns = (1ULL << 0) | (1ULL << 2) | (1ULL << 63);
+    length = alert_encode_json(out, sizeof(out), &line, SIZE_MAX);
+    out[length] = '\0';
+    assert(strncmp(out, "{\"ts\":-5,", 9) == 0);
+    assert(strstr(out, ",\"message\":\"x\",\"template_id\":12,\"rule\":\"rate:2\","
+                       "\"patterns\":[1,3,64]}\n") != NULL);
+
+    // Nothing is written past the size given
+    memset(out, '#', sizeof(out));
+    assert(alert_encode_json(out, 20, &line, SIZE_MAX) == 0 && out[20] == '#');
+    assert(alert_encode_json(out, length, &line, SIZE_MAX) == length);
+    assert(alert_encode_json(out, length - 1, &line, SIZE_MAX) == 0);
+
+    // A cut message stays valid and never splits a UTF-8 sequence
+    line.message = "ab\xc3\xa9\xc3\xa9";
+    line.template_id = 0;
+    line.rule_id = 0;
+    line.patterns = 0;
+    length = alert_encode_json(out, sizeof(out), &line, 3);
+    out[length] = '\0';
+    assert(strstr(out, "\"message\":\"ab\",\"truncated\":true}\n") != NULL);
+    length = alert_encode_json(out, sizeof(out), &line, 4);
+    out[length] = '\0';
+    assert(strstr(out, "\"message\":\"ab\xc3\xa9\",\"truncated\":true}\n") != NULL);
+    length = alert_encode_json(out, sizeof(out), &line, 6);
+    out[length] = '\0';
+    assert(strstr(out, "\"message\":\"ab\xc3\xa9\xc3\xa9\"}\n") != NULL);
+
+    length = alert_encode_json_note(out, sizeof(out), 2 * SEC, 17);
+    out[length] = '\0';
+    assert(strcmp(out, "{\"ts\":2000000000,\"note\":\"rate_limit\",\"skipped\":17}\n") == 0);
+}
+
+static void test_binary(void) {
+    uint8_t header[ALERT_BINARY_HEADER];
+    alert_line_t line = {-2, LOG_LEVEL_CRITICAL, "db.log", "down", "!", 7,
+                         LOG_RULE_ID(LOG_RULE_SEQUENCE, 0), 1ULL << 40, NULL};
+    size_t total = alert_encode_binary_header(header, ALERT_BINARY_ALERT, &line);
+    const char* data = (const char*)header;
+    assert(total == ALERT_BINARY_HEADER + 6 + 5);
+    assert(load_le(data, 4) == total - 4);
+    assert(header[4] == ALERT_BINARY_ALERT && header[5] == LOG_LEVEL_CRITICAL);
+    assert(load_le(data + 6, 2) == 6);
+    assert((int64_t)load_le(data + 8, 8) == -2);
+    assert(load_le(data + 16, 4) == alert_source_id("db.log"));
+    assert(load_le(data + 20, 4) == 7);
+    assert(load_le(data + 24, 4) == ((uint32_t)LOG_RULE_SEQUENCE << 24 | 1));
+    assert(load_le(data + 28, 8) == 1ULL << 40);
+    assert(load_le(data + 36, 4) == 5);
+    assert(alert_source_id("db.log") != alert_source_id("app.log"));
+}
+
+static void test_writer(void) {
+    capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    alert_writer_t writer;
+    int64_t now = 1700000000LL * SEC;
+    alert_line_t line = {now, LOG_LEVEL_ERROR, "app.log", "disk full", NULL, 3, 0, 1, NULL};
+
+    // JSON lines ignore the text prefix and go into one batch
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_JSON, "[ALERT] ",
+                             4096, 0) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 0);
+    assert(capture.calls == 0 && writer.lines == 2);
+    assert(alert_writer_close(&writer) == 0);
+    assert(capture.calls == 1 && strncmp(capture.data, "{\"ts\":", 6) == 0);
+    const char* second = strchr(capture.data, '\n') + 1;
+    assert(strncmp(capture.data, second, (size_t)(second - capture.data)) == 0);
+    assert(strstr(capture.data, "\"template_id\":3,\"patterns\":[1]}\n") != NULL);
+    alert_writer_destroy(&writer);
+
+    // A JSON line larger than the buffer is cut to fit it
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_JSON, NULL, 160,
+                             0) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 0);
+    char long_message[400];
+    memset(long_message, 'x', sizeof(long_message) - 1);
+    long_message[sizeof(long_message) - 1] = '\0';
+    alert_line_t big = line;
+    big.message = long_message;
+    assert(alert_writer_append(&writer, &big, now) == 0);
+    assert(capture.calls == 1 && writer.used <= 160);
+    assert(alert_writer_flush(&writer) == 0);
+    const char* cut = strchr(capture.data, '\n') + 1;
+    assert(strlen(cut) <= 160 && strstr(cut, "xxx\",\"template_id\":3,") != NULL);
+    assert(strstr(cut, ",\"truncated\":true}\n") != NULL);
+    alert_writer_destroy(&writer);
+
+    // Rate-limit notes in JSON
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_JSON, NULL, 4096,
+                             1) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 1);
+    assert(alert_writer_close(&writer) == 0);
+    assert(strstr(capture.data, "{\"ts\":1700000000000000000,\"note\":\"rate_limit\","
+                                "\"skipped\":1}\n") != NULL);
+    alert_writer_destroy(&writer);
+
+    // Binary records, including one larger than the buffer and a note
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_BINARY, NULL, 128,
+                             1) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 0);
+    assert(alert_writer_append(&writer, &line, now) == 1);
+    big.timestamp = now + SEC;
+    assert(alert_writer_append(&writer, &big, now + SEC) == 0);
+    assert(alert_writer_close(&writer) == 0);
+    alert_writer_destroy(&writer);
+
+    const char* messages[] = {"disk full", "1 more alerts not shown (rate limit)", long_message};
+    int types[] = {ALERT_BINARY_ALERT, ALERT_BINARY_NOTE, ALERT_BINARY_ALERT};
+    size_t offset = 0;
+    for (int i = 0; i < 3; i++) {
+        const char* record = capture.data + offset;
+        assert(offset + ALERT_BINARY_HEADER <= capture.length);
+        size_t source_len = (size_t)load_le(record + 6, 2);
+        size_t message_len = (size_t)load_le(record + 36, 4);
+        assert(record[4] == types[i]);
+        assert(source_len == (types[i] == ALERT_BINARY_NOTE ? 0 : 7));
+        assert(message_len == strlen(messages[i]));
+        assert(memcmp(record + ALERT_BINARY_HEADER + source_len, messages[i], message_len) == 0);
+        offset += 4 + (size_t)load_le(record, 4);
+    }
+    assert(offset == capture.length);
+}
+
+static void test_ids(void) {
+    config_t config;
+    config_init_defaults(&config);
+    FILE* file = fopen("test_alert_encoder_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_threshold=ERROR\n");
+    fprintf(file, "alert_pattern1=timeout\n");
+    fprintf(file, "alert_pattern2=refused\n");
+    fprintf(file, "alert_pattern3=latency\n");
+    fprintf(file, "alert_rule1=status>=500\n");
+    fprintf(file, "alert_rule2=latency>1000\n");
+    fprintf(file, "alert_format=json\n");
+    fprintf(file, "alert_sink1=siem tcp 127.0.0.1:5140 format=binary\n");
+    fprintf(file, "alert_sink2=bad tcp 127.0.0.1:5140 format=xml\n");
+    fclose(file);
+    config_destroy(&config);
+    assert(config_load(&config, "test_alert_encoder_config.txt") == 0);
+    remove("test_alert_encoder_config.txt");
+    assert(config.alert_format == ALERT_FORMAT_JSON);
+    assert(config.num_alert_sinks == 1 && config.alert_sinks[0].has_format);
+    assert(config.alert_sinks[0].format == ALERT_FORMAT_BINARY);
+
+    log_entry_t* entry = log_entry_create("db.log", "query timeout latency=2000 status=200",
+                                          LOG_LEVEL_ERROR, "[ERROR] query timeout");
+    assert(entry != NULL);
+    assert(processor_match_patterns(entry, &config) == ((1ULL << 0) | (1ULL << 2)));
+
+    // The matching rule is remembered by the rule cache
+    rule_cache_t cache;
+    assert(rule_cache_init(&cache, 64) == 0);
+    processor_t processor;
+    memset(&processor, 0, sizeof(processor));
+    processor.config = &config;
+    processor.rule_cache = &cache;
+    assert(processor_evaluate(&processor, entry));
+    assert(entry->rule_id == LOG_RULE_ID(LOG_RULE_FIELD, 1));
+    entry->rule_id = 0;
+    assert(processor_evaluate(&processor, entry));
+    rule_cache_stats_t stats;
+    rule_cache_get_stats(&cache, &stats);
+    assert(stats.hits == 1 && entry->rule_id == LOG_RULE_ID(LOG_RULE_FIELD, 1));
+    assert(LOG_RULE_KIND(entry->rule_id) == LOG_RULE_FIELD && LOG_RULE_NUMBER(entry->rule_id) == 2);
+    assert(entry->patterns == ((1ULL << 0) | (1ULL << 2)));
+
+    // Pattern-only configurations memoize the pattern scan
+    size_t num_field_rules = config.num_field_rules;
+    config.num_field_rules = 0;
+    rule_cache_clear(&cache);
+    entry->patterns = 0;
+    assert(processor_evaluate(&processor, entry));
+    assert(entry->patterns == ((1ULL << 0) | (1ULL << 2)));
+    entry->patterns = 0;
+    assert(processor_evaluate(&processor, entry));
+    rule_cache_get_stats(&cache, &stats);
+    assert(stats.hits == 2 && entry->patterns == ((1ULL << 0) | (1ULL << 2)));
+    config.num_field_rules = num_field_rules;
+    rule_cache_destroy(&cache);
+    log_entry_destroy(entry);
+    config_destroy(&config);
+
+    alert_format_t format;
+    assert(alert_format_parse("binary", &format) == 0 && format == ALERT_FORMAT_BINARY);
+    assert(alert_format_parse("JSON", &format) == -1);
+    assert(strcmp(alert_format_to_string(ALERT_FORMAT_JSON), "json") == 0);
+}
+
+void test_alert_encoder(void) {
+    test_json();
+    test_binary();
+    test_writer();
+    test_ids();
+}
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include "../include/alert_sink.h"
+#include "../include/alerter.h"
+#include "../include/config.h"
+#include "../include/context_ring.h"
+#include "../include/metrics.h"
+#include "../include/queue.h"
+#include "../include/sink_spec.h"
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SEC 1000000000LL
+
+// Local stand-in for a remote destination
+typedef struct {
+    int listener;
+    char data[16384];           // Bytes received (HTTP: accepted bodies)
+    size_t length;
+    char request_line[128];     // First HTTP request line
+    const int* statuses;        // HTTP status per request
+    int requests;
+} server_t;
+
+static int listen_tcp(int* port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr*)&address, sizeof(address)) == 0);
+    assert(listen(fd, 4) == 0);
+    socklen_t length = sizeof(address);
+    assert(getsockname(fd, (struct sockaddr*)&address, &length) == 0);
+    *port = ntohs(address.sin_port);
+    return fd;
+}
+
+// Read one connection until the peer closes it
+static void* stream_server(void* arg) {
+    server_t* server = (server_t*)arg;
+    int fd = accept(server->listener, NULL, NULL);
+    assert(fd >= 0);
+    ssize_t n;
+    while ((n = read(fd, server->data + server->length,
+                     sizeof(server->data) - 1 - server->length)) > 0) {
+        server->length += (size_t)n;
+    }
+    server->data[server->length] = '\0';
+    close(fd);
+    return NULL;
+}
+
+// Answer each request with the next status (0 ends the script)
+static void* http_server(void* arg) {
+    server_t* server = (server_t*)arg;
+    while (server->statuses[server->requests] != 0) {
+        int fd = accept(server->listener, NULL, NULL);
+        assert(fd >= 0);
+        char request[8192];
+        size_t length = 0;
+        const char* body = NULL;
+        size_t body_len = 0;
+        while (!body || length < (size_t)(body - request) + body_len) {
+            ssize_t n = read(fd, request + length, sizeof(request) - 1 - length);
+            assert(n > 0);
+            length += (size_t)n;
+            request[length] = '\0';
+            char* end = strstr(request, "\r\n\r\n");
+            if (end && !body) {
+                const char* content_length = strstr(request, "Content-Length: ");
+                assert(content_length != NULL);
+                body = end + 4;
+                body_len = (size_t)atol(content_length + 16);
+            }
+        }
+        if (server->requests == 0) {
+            snprintf(server->request_line, sizeof(server->request_line), "%.*s",
+                     (int)strcspn(request, "\r"), request);
+        }
+
+        int status = server->statuses[server->requests++];
+        if (status == 200) {
+            memcpy(server->data + server->length, body, body_len);
+            server->length += body_len;
+            server->data[server->length] = '\0';
+        }
+        char response[128];
+        int response_len = snprintf(response, sizeof(response),
+                                    "HTTP/1.1 %d X\r\nContent-Length: 0\r\n\r\n", status);
+        assert(write(fd, response, (size_t)response_len) == response_len);
+        close(fd);
+    }
+    return NULL;
+}
+
+static void enqueue_alerts(alert_sink_t* sink, int count, const char* message) {
+    for (int i = 0; i < count; i++) {
+        alert_line_t line = {1700000000LL * SEC, LOG_LEVEL_ERROR, "app.log", message, "", 0, 0, 0,
+                             NULL};
+        alert_record_t* record = alert_record_create(&line);
+        assert(record != NULL);
+        alert_sink_enqueue(sink, record);
+        alert_record_release(record);
+    }
+}
+
+// Alert carrying `lines` context lines, half before and half after it
+static alert_record_t* context_record(const char* message, uint32_t lines) {
+    char text[CONTEXT_RING_MAX_LINES][32];
+    size_t at = sizeof(log_context_t) + lines * sizeof(log_context_line_t);
+    size_t size = at;
+    for (uint32_t i = 0; i < lines; i++) {
+        size += (size_t)snprintf(text[i], sizeof(text[i]), "context line %u", i);
+    }
+    log_context_t* context = (log_context_t*)calloc(1, size);
+    assert(context != NULL);
+    context->size = size;
+    context->num_before = lines / 2;
+    context->num_lines = lines;
+    for (uint32_t i = 0; i < lines; i++) {
+        context->lines[i].offset = (uint32_t)at;
+        context->lines[i].length = (uint32_t)strlen(text[i]);
+        memcpy((char*)context + at, text[i], context->lines[i].length);
+        at += context->lines[i].length;
+    }
+
+    alert_line_t line = {1700000000LL * SEC, LOG_LEVEL_ERROR, "app.log", message, "", 0, 0, 0,
+                         context};
+    alert_record_t* record = alert_record_create(&line);
+    assert(record != NULL);
+    free(context);
+    return record;
+}
+
+static uint64_t sink_metric(const char* sink, const char* name) {
+    char metric[METRICS_NAME_MAX];
+    snprintf(metric, sizeof(metric), "alerts.sink.%s.%s", sink, name);
+    return metrics_get(metrics_register(metric, METRIC_COUNTER));
+}
+
+static size_t count_lines(const char* text) {
+    size_t lines = 0;
+    for (const char* p = text; *p; p++) {
+        lines += *p == '\n';
+    }
+    return lines;
+}
+
+static size_t file_lines(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    size_t lines = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        lines += c == '\n';
+    }
+    fclose(file);
+    return lines;
+}
+
+void test_alert_sink(void) {
+    // Test sink and route parsing
+    sink_spec_t spec;
+    assert(sink_spec_parse(&spec, "siem tcp 127.0.0.1:5140 queue=500 rate=10 buffer=4096") == 0);
+    assert(strcmp(spec.name, "siem") == 0 && spec.type == SINK_TCP);
+    assert(strcmp(spec.target, "127.0.0.1:5140") == 0);
+    assert(spec.queue_size == 500 && spec.rate == 10 && spec.buffer_size == 4096);
+    sink_spec_destroy(&spec);
+    assert(sink_spec_parse(&spec, "console stdout rate=5") == 0);
+    assert(spec.type == SINK_STDOUT && spec.target == NULL && spec.rate == 5);
+    sink_spec_destroy(&spec);
+    assert(sink_spec_parse(&spec, "hook http http://localhost/alerts") == 0);
+    assert(strcmp(sink_type_to_string(spec.type), "http") == 0);
+    sink_spec_destroy(&spec);
+    assert(sink_spec_parse(&spec, "siem tcp 127.0.0.1") == -1);
+    assert(sink_spec_parse(&spec, "siem tcp host:99999") == -1);
+    assert(sink_spec_parse(&spec, "hook http https://localhost/alerts") == -1);
+    assert(sink_spec_parse(&spec, "audit file") == -1);
+    assert(sink_spec_parse(&spec, "audit ftp x") == -1);
+    assert(sink_spec_parse(&spec, "a.b file x") == -1);
+    assert(sink_spec_parse(&spec, "audit file x queue=0") == -1);
+    assert(sink_spec_parse(&spec, "audit file x speed=1") == -1);
+
+    sink_route_t route;
+    assert(sink_route_parse(&route, "CRITICAL -> pager, siem") == 0);
+    assert(route.num_sinks == 2 && strcmp(route.sinks[1], "siem") == 0 && !route.match_all);
+    log_entry_t* entry = log_entry_create("app.log", "down", LOG_LEVEL_CRITICAL, "down");
+    assert(sink_route_matches(&route, entry));
+    entry->level = LOG_LEVEL_ERROR;
+    assert(!sink_route_matches(&route, entry));
+    sink_route_destroy(&route);
+    assert(sink_route_parse(&route, "* -> audit") == 0 && route.match_all);
+    assert(sink_route_matches(&route, entry));
+    sink_route_destroy(&route);
+    log_entry_destroy(entry);
+    assert(sink_route_parse(&route, "ERROR pager") == -1);
+    assert(sink_route_parse(&route, "ERROR ->") == -1);
+
+    config_t config;
+    config_init_defaults(&config);
+
+    // Test a file sink: records queued before the start go out in one batch
+    const char* path = "test_alert_sink.log";
+    remove(path);
+    assert(sink_spec_parse(&spec, "audit file test_alert_sink.log") == 0);
+    alert_sink_t sink;
+    assert(alert_sink_init(&sink, &spec, &config) == 0);
+    sink_spec_destroy(&spec);
+    enqueue_alerts(&sink, 100, "disk full");
+    assert(file_lines(path) == 0);
+    assert(alert_sink_start(&sink) == 0);
+    assert(alert_sink_start(&sink) == -1);
+    enqueue_alerts(&sink, 20, "disk still full");
+    alert_sink_stop(&sink);
+    assert(file_lines(path) == 120);
+    assert(sink_metric("audit", "sent") == 120 && sink_metric("audit", "dropped") == 0);
+    alert_sink_destroy(&sink);
+    remove(path);
+
+    assert(sink_spec_parse(&spec, "audit file no_such_dir/alerts.log") == 0);
+    assert(alert_sink_init(&sink, &spec, &config) == -1);
+    sink_spec_destroy(&spec);
+
+    // Test a TCP sink against a local listener
+    int port;
+    server_t* server = (server_t*)calloc(1, sizeof(server_t));
+    assert(server != NULL);
+    server->listener = listen_tcp(&port);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, stream_server, server) == 0);
+    char text[128];
+    snprintf(text, sizeof(text), "siem tcp 127.0.0.1:%d", port);
+    assert(sink_spec_parse(&spec, text) == 0);
+    assert(alert_sink_init(&sink, &spec, &config) == 0);
+    sink_spec_destroy(&spec);
+    assert(alert_sink_start(&sink) == 0);
+    enqueue_alerts(&sink, 10, "login failed");
+    alert_sink_stop(&sink);
+    pthread_join(thread, NULL);
+    assert(count_lines(server->data) == 10);
+    assert(strstr(server->data, "] [ERROR] [app.log] login failed\n") != NULL);
+    assert(sink_metric("siem", "sent") == 10);
+    alert_sink_destroy(&sink);
+    close(server->listener);
+
+    // Test a Unix socket sink sending JSON lines
+    const char* socket_path = "test_alert_sink.sock";
+    unlink(socket_path);
+    memset(server, 0, sizeof(server_t));
+    server->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    assert(bind(server->listener, (struct sockaddr*)&address, sizeof(address)) == 0);
+    assert(listen(server->listener, 4) == 0);
+    assert(pthread_create(&thread, NULL, stream_server, server) == 0);
+    assert(sink_spec_parse(&spec, "local unix test_alert_sink.sock format=json") == 0);
+    assert(alert_sink_init(&sink, &spec, &config) == 0);
+    sink_spec_destroy(&spec);
+    enqueue_alerts(&sink, 3, "local");
+    assert(alert_sink_start(&sink) == 0);
+    alert_sink_stop(&sink);
+    pthread_join(thread, NULL);
+    assert(count_lines(server->data) == 3);
+    const char* json = "{\"ts\":1700000000000000000,\"level\":\"ERROR\",\"source\":\"app.log\",";
+    assert(strncmp(server->data, json, strlen(json)) == 0);
+    assert(strstr(server->data, ",\"message\":\"local\"}\n") != NULL);
+    alert_sink_destroy(&sink);
+    close(server->listener);
+    unlink(socket_path);
+
+    // Test an HTTP sink: a failed POST is retried with the same batch
+    static const int statuses[] = {500, 200, 0};
+    memset(server, 0, sizeof(server_t));
+    server->statuses = statuses;
+    server->listener = listen_tcp(&port);
+    assert(pthread_create(&thread, NULL, http_server, server) == 0);
+    snprintf(text, sizeof(text), "hook http http://127.0.0.1:%d/alerts", port);
+    assert(sink_spec_parse(&spec, text) == 0);
+    assert(alert_sink_init(&sink, &spec, &config) == 0);
+    sink_spec_destroy(&spec);
+    enqueue_alerts(&sink, 5, "payment declined");
+    assert(alert_sink_start(&sink) == 0);
+    pthread_join(thread, NULL);
+    alert_sink_stop(&sink);
+    assert(server->requests == 2);
+    assert(strcmp(server->request_line, "POST /alerts HTTP/1.1") == 0);
+    assert(count_lines(server->data) == 5);
+    assert(sink_metric("hook", "failures") == 1 && sink_metric("hook", "retries") == 1);
+    assert(sink_metric("hook", "sent") == 5 && sink_metric("hook", "dropped") == 0);
+    alert_sink_destroy(&sink);
+    close(server->listener);
+
+    // Alerts with context too long to batch are posted from their parts;
+    // a rejected one is dropped and the sink moves on
+    static const int context_statuses[] = {200, 400, 200, 0};
+    memset(server, 0, sizeof(server_t));
+    server->statuses = context_statuses;
+    server->listener = listen_tcp(&port);
+    assert(pthread_create(&thread, NULL, http_server, server) == 0);
+    snprintf(text, sizeof(text), "ctxhook http http://127.0.0.1:%d/alerts buffer=256", port);
+    assert(sink_spec_parse(&spec, text) == 0);
+    assert(alert_sink_init(&sink, &spec, &config) == 0);
+    sink_spec_destroy(&spec);
+    alert_record_t* record = context_record("cache miss storm", 16);
+    alert_sink_enqueue(&sink, record);
+    alert_record_release(record);
+    record = context_record("rejected", 16);
+    alert_sink_enqueue(&sink, record);
+    alert_record_release(record);
+    enqueue_alerts(&sink, 1, "after");
+    assert(alert_sink_start(&sink) == 0);
+    pthread_join(thread, NULL);
+    alert_sink_stop(&sink);
+    assert(server->requests == 3);
+    assert(count_lines(server->data) == 18);
+    assert(strstr(server->data, "[app.log] cache miss storm\n  - context line 0\n") != NULL);
+    assert(strstr(server->data, "  + context line 15\n") != NULL);
+    assert(strstr(server->data, "rejected") == NULL);
+    assert(strstr(server->data, "[app.log] after\n") != NULL);
+    assert(sink_metric("ctxhook", "sent") == 2 && sink_metric("ctxhook", "dropped") == 1);
+    alert_sink_destroy(&sink);
+    close(server->listener);
+    free(server);
+
+    // Test drop accounting: a full queue and an unreachable destination
+    assert(sink_spec_parse(&spec, "dead unix no_such_dir/alerts.sock queue=4") == 0);
+    assert(alert_sink_init(&sink, &spec, &config) == 0);
+    sink_spec_destroy(&spec);
+    enqueue_alerts(&sink, 10, "lost");
+    assert(sink_metric("dead", "dropped") == 6);
+    assert(alert_sink_start(&sink) == 0);
+    alert_sink_stop(&sink);
+    assert(sink_metric("dead", "dropped") == 10 && sink_metric("dead", "sent") == 0);
+    assert(sink_metric("dead", "failures") >= 1);
+    alert_sink_destroy(&sink);
+    config_destroy(&config);
+
+    // Test routing through the alerter: a dead sink does not hold up the others
+    FILE* file = fopen("test_alert_sink_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_sink0=audit2 file test_alert_sink.log\n");
+    fprintf(file, "alert_sink1=pager unix no_such_dir/pager.sock queue=8\n");
+    fprintf(file, "alert_sink2=bad ftp somewhere\n");
+    fprintf(file, "alert_route0=CRITICAL -> pager\n");
+    fprintf(file, "alert_route1=nonsense\n");
+    fprintf(file, "alert_sink_queue=500\n");
+    fprintf(file, "alert_sink_timeout_ms=200\n");
+    fprintf(file, "alert_sink_retry_max_ms=1000\n");
+    fprintf(file, "alert_dedup_window=0\n");
+    fclose(file);
+    assert(config_load(&config, "test_alert_sink_config.txt") == 0);
+    assert(config.num_alert_sinks == 2 && config.num_alert_routes == 1);
+    assert(config.alert_sink_queue == 500 && config.alert_sink_timeout_ms == 200);
+    assert(config.alert_sink_retry_max_ms == 1000);
+
+    log_queue_t queue;
+    assert(queue_init(&queue, 16) == 0);
+    alerter_t alerter;
+    assert(alerter_init(&alerter, &queue, &config) == 0);
+    assert(alerter.num_sinks == 2 && alerter.unrouted == 1 && alerter.route_sinks[0] == 2);
+    for (int i = 0; i < 12; i++) {
+        entry = log_entry_create("db.log", "connection lost",
+                                 i % 4 == 0 ? LOG_LEVEL_CRITICAL : LOG_LEVEL_ERROR, "x");
+        alerter_write_alert(&alerter, entry);
+        log_entry_destroy(entry);
+    }
+    alerter_destroy(&alerter);
+    assert(file_lines(path) == 12);
+    assert(sink_metric("pager", "dropped") == 3 && sink_metric("audit2", "sent") == 12);
+    remove(path);
+
+    // Routes must name configured sinks
+    config.alert_routes[0].sinks[0][0] = 'x';
+    assert(alerter_init(&alerter, &queue, &config) == -1);
+    remove(path);
+    queue_destroy(&queue);
+    config_destroy(&config);
+    remove("test_alert_sink_config.txt");
+
+    config_init_defaults(&config);
+    assert(config.alert_sink_queue == 10000 && config.alert_sink_timeout_ms == 5000);
+    assert(config.alert_sink_retry_max_ms == 30000 && config.num_alert_sinks == 0);
+    config_destroy(&config);
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "../include/alert_writer.h"
+#include "../include/config.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEC 1000000000LL
+
+// Destination collecting deliveries in memory
+typedef struct {
+    char text[4096];
+    size_t length;
+    int calls;
+    bool fail;
+} capture_t;
+
+static int capture_deliver(void* ctx, struct iovec* iov, int count) {
+    capture_t* capture = (capture_t*)ctx;
+    capture->calls++;
+    if (capture->fail) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        assert(capture->length + iov[i].iov_len < sizeof(capture->text));
+        memcpy(capture->text + capture->length, iov[i].iov_base, iov[i].iov_len);
+        capture->length += iov[i].iov_len;
+    }
+    capture->text[capture->length] = '\0';
+    return 0;
+}
+
+static int fd_deliver(void* ctx, struct iovec* iov, int count) {
+    return alert_write_fd(*(int*)ctx, iov, count);
+}
+
+static int append(alert_writer_t* writer, int64_t timestamp, log_level_t level,
+                  const char* source, const char* message, const char* suffix, int64_t now) {
+    alert_line_t line = {timestamp, level, source, message, suffix, 0, 0, 0, NULL};
+    return alert_writer_append(writer, &line, now);
+}
+
+static size_t count_lines(const char* text) {
+    size_t lines = 0;
+    for (const char* p = text; *p; p++) {
+        lines += *p == '\n';
+    }
+    return lines;
+}
+
+void test_alert_writer(void) {
+    // Test batching: nothing is delivered before a flush
+    capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    alert_writer_t writer;
+    int64_t now = 1700000000LL * SEC;
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_TEXT, NULL, 4096,
+                             0) == 0);
+    assert(append(&writer, now, LOG_LEVEL_ERROR, "app.log", "disk full", "", now) == 0);
+    assert(append(&writer, now + 1, LOG_LEVEL_CRITICAL, "db.log", "down",
+                               " (repeated 3 times in 10s)", now + 1) == 0);
+    assert(capture.calls == 0 && writer.lines == 2);
+    assert(alert_writer_flush(&writer) == 0);
+    assert(capture.calls == 1 && count_lines(capture.text) == 2 && writer.used == 0);
+    // Same second: the cached time string is reused
+    const char* text = capture.text;
+    assert(text[0] == '[' && text[20] == ']' && strncmp(text, strchr(text, '\n') + 1, 21) == 0);
+    assert(strstr(text, "] [ERROR] [app.log] disk full\n") != NULL);
+    assert(strstr(text, "] [CRITICAL] [db.log] down (repeated 3 times in 10s)\n") != NULL);
+    assert(alert_writer_flush(&writer) == 0 && capture.calls == 1);
+
+    // A failed delivery keeps the batch for a retry
+    append(&writer, now + SEC, LOG_LEVEL_ERROR, "app.log", "late", "", now);
+    capture.fail = true;
+    assert(alert_writer_flush(&writer) == -1 && writer.lines == 1);
+    capture.fail = false;
+    assert(alert_writer_flush(&writer) == 0);
+    assert(count_lines(capture.text) == 3 && strstr(capture.text, "late\n") != NULL);
+    alert_writer_destroy(&writer);
+
+    // Test a full buffer: the batch is delivered before the next line
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_TEXT, NULL, 64,
+                             0) == 0);
+    append(&writer, now, LOG_LEVEL_ERROR, "a.log", "first", "", now);
+    assert(capture.calls == 0);
+    append(&writer, now, LOG_LEVEL_ERROR, "a.log", "second", "", now);
+    assert(count_lines(capture.text) == 1 && strstr(capture.text, "first\n") != NULL);
+
+    // Lines larger than the buffer bypass it, in order
+    char long_message[200];
+    memset(long_message, 'x', sizeof(long_message) - 1);
+    long_message[sizeof(long_message) - 1] = '\0';
+    assert(append(&writer, now, LOG_LEVEL_ERROR, "a.log", long_message, "", now) == 0);
+    assert(count_lines(capture.text) == 3 && capture.calls == 3);
+    assert(strstr(capture.text, "second\n") < strstr(capture.text, long_message));
+
+    // A full batch that cannot be delivered rejects the line
+    append(&writer, now, LOG_LEVEL_ERROR, "a.log", "third", "", now);
+    capture.fail = true;
+    assert(append(&writer, now, LOG_LEVEL_ERROR, "a.log", "fourth one", "", now) == -1);
+    assert(writer.lines == 1);
+    capture.fail = false;
+    assert(alert_writer_close(&writer) == 0);
+    assert(strstr(capture.text, "third\n") != NULL && strstr(capture.text, "fourth") == NULL);
+    alert_writer_destroy(&writer);
+
+    // Test the prefix and rate limit
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_TEXT, "[ALERT] ",
+                             4096, 2) == 0);
+    int held = 0;
+    for (int i = 0; i < 5; i++) {
+        held += append(&writer, now, LOG_LEVEL_ERROR, "app.log", "storm", "", now);
+    }
+    assert(held == 3);
+    append(&writer, now + SEC, LOG_LEVEL_ERROR, "app.log", "after", "", now + SEC);
+    assert(alert_writer_close(&writer) == 0);
+    alert_writer_destroy(&writer);
+    assert(count_lines(capture.text) == 4);
+    assert(strncmp(capture.text, "[ALERT] [", 9) == 0);
+    assert(strstr(capture.text, "] [ERROR] [app.log] storm\n") != NULL);
+    assert(strstr(capture.text, "[ALERT] 3 more alerts not shown (rate limit)\n") <
+           strstr(capture.text, "after\n"));
+
+    // Test the periodic tick: the note goes out without another alert
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_TEXT, "[ALERT] ",
+                             4096, 1) == 0);
+    append(&writer, now, LOG_LEVEL_ERROR, "app.log", "storm", "", now);
+    assert(append(&writer, now, LOG_LEVEL_ERROR, "app.log", "storm", "", now) == 1);
+    assert(alert_writer_tick(&writer, now + SEC / 2) == 0);
+    assert(writer.rate_skipped == 1);
+    assert(alert_writer_tick(&writer, now + SEC) == 0 && writer.rate_skipped == 0);
+    assert(alert_writer_flush(&writer) == 0);
+    assert(strstr(capture.text, "[ALERT] 1 more alerts not shown (rate limit)\n") != NULL);
+    alert_writer_destroy(&writer);
+
+    // Test delivery to a file descriptor
+    const char* path = "test_alert_writer.log";
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    assert(alert_writer_init(&writer, fd_deliver, &fd, ALERT_FORMAT_TEXT, NULL, 4096, 0) == 0);
+    append(&writer, now, LOG_LEVEL_WARNING, "app.log", "slow", "", now);
+    assert(alert_writer_close(&writer) == 0);
+    alert_writer_destroy(&writer);
+    close(fd);
+    FILE* file = fopen(path, "r");
+    assert(file != NULL);
+    char line[256];
+    assert(fgets(line, sizeof(line), file) && strstr(line, "] [WARNING] [app.log] slow\n") != NULL);
+    fclose(file);
+    remove(path);
+
+    assert(alert_writer_init(&writer, NULL, NULL, ALERT_FORMAT_TEXT, NULL, 4096, 0) == -1);
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_TEXT, NULL, 0,
+                             0) == -1);
+
+    // Test config keys
+    file = fopen("test_alert_writer_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_buffer_size=1048576\n");
+    fprintf(file, "alert_flush_ms=250\n");
+    fprintf(file, "alert_stdout=false\n");
+    fprintf(file, "alert_stdout_rate=0\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_alert_writer_config.txt") == 0);
+    assert(config.alert_buffer_size == 1048576 && config.alert_flush_ms == 250);
+    assert(!config.alert_stdout && config.alert_stdout_rate == 0);
+    config_destroy(&config);
+    config_init_defaults(&config);
+    assert(config.alert_stdout && config.alert_stdout_rate == 100 && config.alert_flush_ms == 100);
+    config_destroy(&config);
+    remove("test_alert_writer_config.txt");
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "../include/autoscaler.h"
+#include "../include/work_pool.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static size_t g_processed;
+static long g_slow_ns;
+
+static void sleep_ms(long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void slow_entry(void* ctx, log_entry_t* entry) {
+    (void)ctx;
+    if (g_slow_ns > 0) {
+        struct timespec ts = {0, g_slow_ns};
+        nanosleep(&ts, NULL);
+    }
+    log_entry_destroy(entry);
+    __atomic_add_fetch(&g_processed, 1, __ATOMIC_RELAXED);
+}
+
+static void submit(work_pool_t* pool, size_t count) {
+    log_entry_t* entries[64];
+    for (size_t offset = 0; offset < count; offset += 64) {
+        size_t chunk = count - offset < 64 ? count - offset : 64;
+        for (size_t i = 0; i < chunk; i++) {
+            entries[i] = log_entry_create("app.log", "message", LOG_LEVEL_ERROR, "message");
+            assert(entries[i] != NULL);
+        }
+        assert(work_pool_submit(pool, entries, chunk, WORK_POOL_ANY) == 0);
+    }
+}
+
+static bool wait_for(size_t* value, size_t expected) {
+    for (int i = 0; i < 400 && __atomic_load_n(value, __ATOMIC_RELAXED) != expected; i++) {
+        sleep_ms(5);
+    }
+    return __atomic_load_n(value, __ATOMIC_RELAXED) == expected;
+}
+
+void test_autoscaler(void) {
+    work_pool_t pool;
+    autoscaler_t autoscaler;
+    autoscale_sample_t sample;
+
+    // Test the hysteresis without running anything
+    assert(work_pool_init(&pool, 4, 1000, slow_entry, NULL) == 0);
+    assert(autoscaler_init(&autoscaler, &pool, 1, 5, 10) == -1);
+    assert(autoscaler_init(&autoscaler, &pool, 3, 2, 10) == -1);
+    assert(autoscaler_init(&autoscaler, &pool, 1, 4, 10) == 0);
+
+    memset(&sample, 0, sizeof(sample));
+    sample.workers = 2;
+    sample.utilization = 90;
+    sample.peak_utilization = 95;
+    assert(autoscaler_decide(&autoscaler, &sample) == 2);
+    assert(autoscaler_decide(&autoscaler, &sample) == 3);
+
+    // A sample in between resets the streak
+    assert(autoscaler_decide(&autoscaler, &sample) == 2);
+    sample.utilization = 50;
+    assert(autoscaler_decide(&autoscaler, &sample) == 2);
+    sample.utilization = 10;
+    sample.wait_us = AUTOSCALE_UP_WAIT_US;
+    assert(autoscaler_decide(&autoscaler, &sample) == 2);
+    sample.wait_us = 0;
+    sample.pending = 500;
+    assert(autoscaler_decide(&autoscaler, &sample) == 3);
+
+    // Shrinking needs a long idle streak and stops at the minimum
+    sample.pending = 0;
+    sample.utilization = 5;
+    sample.peak_utilization = 30;
+    for (int i = 0; i < AUTOSCALE_DOWN_SAMPLES * 2; i++) {
+        assert(autoscaler_decide(&autoscaler, &sample) == 2);
+    }
+    sample.peak_utilization = 10;
+    for (int i = 1; i < AUTOSCALE_DOWN_SAMPLES; i++) {
+        assert(autoscaler_decide(&autoscaler, &sample) == 2);
+    }
+    assert(autoscaler_decide(&autoscaler, &sample) == 1);
+    sample.workers = 1;
+    for (int i = 0; i < AUTOSCALE_DOWN_SAMPLES * 2; i++) {
+        assert(autoscaler_decide(&autoscaler, &sample) == 1);
+    }
+
+    // Growing stops at the maximum; out-of-range counts are clamped
+    sample.workers = 4;
+    sample.utilization = 100;
+    sample.peak_utilization = 100;
+    for (int i = 0; i < AUTOSCALE_UP_SAMPLES * 2; i++) {
+        assert(autoscaler_decide(&autoscaler, &sample) == 4);
+    }
+    sample.workers = 0;
+    assert(autoscaler_decide(&autoscaler, &sample) == 1);
+    autoscaler_destroy(&autoscaler);
+
+    // Test resizing a running pool: every entry is processed exactly once
+    assert(work_pool_resize(&pool, 2) == -1);
+    assert(work_pool_start(&pool, 1) == 0);
+    assert(work_pool_resize(&pool, 4) == 0);
+    assert(work_pool_size(&pool) == 4);
+    submit(&pool, 1000);
+    assert(work_pool_resize(&pool, 1) == 0);
+    assert(work_pool_size(&pool) == 1);
+    submit(&pool, 1000);
+    assert(wait_for(&g_processed, 2000));
+    assert(work_pool_resize(&pool, 0) == -1);
+    assert(work_pool_resize(&pool, 5) == -1);
+    work_pool_stop(&pool);
+    assert(work_pool_resize(&pool, 2) == -1);
+    work_pool_destroy(&pool);
+
+    // Test the controller: slow entries scale the pool up, idleness back down
+    g_processed = 0;
+    g_slow_ns = 200000;
+    metric_t* scale_ups = metrics_register("processor.scale_ups", METRIC_COUNTER);
+    metric_t* scale_downs = metrics_register("processor.scale_downs", METRIC_COUNTER);
+    uint64_t ups_before = metrics_get(scale_ups);
+    uint64_t downs_before = metrics_get(scale_downs);
+    assert(work_pool_init(&pool, 3, 0, slow_entry, NULL) == 0);
+    assert(work_pool_start(&pool, 1) == 0);
+    assert(autoscaler_init(&autoscaler, &pool, 1, 3, 10) == 0);
+    assert(autoscaler_start(&autoscaler) == 0);
+
+    submit(&pool, 2000);
+    // Scale events are counted after the resize completes
+    for (int i = 0; i < 200 && metrics_get(scale_ups) == ups_before; i++) {
+        sleep_ms(5);
+    }
+    assert(metrics_get(scale_ups) > ups_before);
+    assert(work_pool_size(&pool) >= 2);
+    assert(wait_for(&g_processed, 2000));
+
+    for (int i = 0; i < 400 && (work_pool_size(&pool) > 1 ||
+                                metrics_get(scale_downs) - downs_before < metrics_get(scale_ups) - ups_before);
+         i++) {
+        sleep_ms(5);
+    }
+    assert(work_pool_size(&pool) == 1);
+    assert(metrics_get(scale_downs) > downs_before);
+
+    // Stopping the controller leaves the pool running at its size
+    autoscaler_stop(&autoscaler);
+    assert(work_pool_size(&pool) == 1);
+    autoscaler_destroy(&autoscaler);
+    work_pool_destroy(&pool);
+    g_slow_ns = 0;
+}
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "../include/compactor.h"
+#include "../include/segment.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEC 1000000000LL
+#define HOUR (3600 * SEC)
+#define DIR_NAME "test_compactor_dir"
+
+// 2025-01-01 10:00:00 UTC
+static const int64_t BASE = 1735725600LL * SEC;
+
+static void remove_tree(const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        unlink(path);
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+            char child[512];
+            snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+            remove_tree(child);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static void append(log_store_t* store, const char* source, const char* line, int64_t timestamp) {
+    log_entry_t* entry = log_entry_create(source, line, LOG_LEVEL_INFO, line);
+    assert(entry != NULL);
+    entry->timestamp = timestamp;
+    log_store_append(store, entry);
+    log_entry_destroy(entry);
+}
+
+static config_t store_config(void) {
+    config_t config;
+    config_init_defaults(&config);
+    config.store_dir = strdup(DIR_NAME);
+    config.store_compact_size = 1 << 20;
+    config.store_compact_rate = 0;
+    return config;
+}
+
+static bool segment_exists(const log_store_segment_t* entry) {
+    char path[256];
+    snprintf(path, sizeof(path), DIR_NAME "/%s", entry->name);
+    return access(path, F_OK) == 0;
+}
+
+// Check that the store holds "line <n>" once for every n below count, and
+// that every segment is sorted by time
+static void check_lines(log_store_t* store, int count) {
+    log_store_segment_t segments[64];
+    size_t num_segments = log_store_segments(store, segments, 64);
+    assert(num_segments <= 64);
+    int* seen = (int*)calloc((size_t)count, sizeof(int));
+    assert(seen != NULL);
+    for (size_t i = 0; i < num_segments; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), DIR_NAME "/%s", segments[i].name);
+        segment_t segment;
+        assert(segment_open(&segment, path) == 0);
+        assert(segment.num_rows == segments[i].rows);
+        const int64_t* timestamps = segment_timestamps(&segment);
+        for (size_t row = 0; row < segment.num_rows; row++) {
+            assert(row == 0 || timestamps[row] >= timestamps[row - 1]);
+            size_t length;
+            const char* line = segment_line(&segment, row, &length);
+            int n = -1;
+            assert(line && sscanf(line, "line %d", &n) == 1 && n >= 0 && n < count);
+            seen[n]++;
+        }
+        segment_close(&segment);
+    }
+    for (int n = 0; n < count; n++) {
+        assert(seen[n] == 1);
+    }
+    free(seen);
+}
+
+static void test_rule_parse(void) {
+    retention_rule_t rule;
+    assert(retention_rule_parse(&rule, "/var/log/debug/* 1d") == 0);
+    assert(strcmp(rule.source, "/var/log/debug/*") == 0);
+    assert(rule.max_age == 24 * HOUR && rule.max_bytes == 0);
+    assert(retention_rule_matches(&rule, "/var/log/debug/a.log"));
+    assert(!retention_rule_matches(&rule, "/var/log/app.log"));
+    retention_rule_destroy(&rule);
+
+    assert(retention_rule_parse(&rule, "network:* 10G") == 0);
+    assert(rule.max_age == 0 && rule.max_bytes == 10ULL << 30);
+    retention_rule_destroy(&rule);
+    assert(retention_rule_parse(&rule, "* 30d 512K") == 0);
+    assert(rule.max_age == 30 * 24 * HOUR && rule.max_bytes == 512 << 10);
+    retention_rule_destroy(&rule);
+    assert(retention_rule_parse(&rule, "* 100B") == 0 && rule.max_bytes == 100);
+    retention_rule_destroy(&rule);
+
+    // A limit is required, ages come first and need a unit
+    assert(retention_rule_parse(&rule, "*") != 0);
+    assert(retention_rule_parse(&rule, "* 10G 1d") != 0);
+    assert(retention_rule_parse(&rule, "* 30") != 0);
+    assert(retention_rule_parse(&rule, "* 1d 2d") != 0);
+    assert(retention_rule_parse(&rule, "* 1x") != 0);
+    assert(retention_rule_parse(&rule, "* 1d 1G extra") != 0);
+}
+
+static void test_merge(void) {
+    remove_tree(DIR_NAME);
+    config_t config = store_config();
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+
+    // 20 flushes into one partition and 2 into the next, interleaved in time
+    char line[64];
+    for (int flush = 0; flush < 20; flush++) {
+        for (int i = 0; i < 50; i++) {
+            snprintf(line, sizeof(line), "line %d", flush * 50 + i);
+            int64_t timestamp = BASE + (int64_t)(i * 20 + flush) * SEC;
+            append(&store, i % 2 ? "a.log" : "b.log", line, timestamp);
+        }
+        assert(log_store_flush(&store) == 0);
+    }
+    for (int n = 1000; n < 1010; n++) {
+        snprintf(line, sizeof(line), "line %d", n);
+        append(&store, "a.log", line, BASE + HOUR + n);
+        if (n == 1004 || n == 1009) {
+            assert(log_store_flush(&store) == 0);
+        }
+    }
+    log_store_segment_t before[32];
+    assert(log_store_segments(&store, before, 32) == 22);
+
+    compactor_t compactor;
+    assert(compactor_init(&compactor, &store, &config) == 0);
+    uint64_t merges = metrics_get(compactor.merges);
+    uint64_t merged = metrics_get(compactor.merged_segments);
+    uint64_t written = metrics_get(compactor.bytes_written);
+    assert(compactor_run(&compactor, BASE) == 0);
+    assert(metrics_get(compactor.merges) == merges + 2);
+    assert(metrics_get(compactor.merged_segments) == merged + 22);
+    assert(metrics_get(compactor.bytes_written) > written);
+    assert(metrics_get(compactor.pending) == 0);
+    assert(metrics_get(compactor.write_amplification) >= 100);
+
+    // One segment per partition with new IDs; the inputs are gone
+    log_store_segment_t after[32];
+    assert(log_store_segments(&store, after, 32) == 2);
+    assert(after[0].id == 23 && after[0].partition == BASE && after[0].rows == 1000);
+    assert(after[0].min_time == BASE && after[0].max_time == BASE + 999 * SEC);
+    assert(strcmp(after[0].name, "20250101-100000/0000000023.seg") == 0);
+    assert(after[1].id == 24 && after[1].partition == BASE + HOUR && after[1].rows == 10);
+    for (size_t i = 0; i < 22; i++) {
+        assert(!segment_exists(&before[i]));
+    }
+    check_lines(&store, 1010);
+
+    // Nothing left to merge; new IDs continue after the merged ones
+    assert(compactor_run(&compactor, BASE) == 0);
+    assert(metrics_get(compactor.merges) == merges + 2);
+    append(&store, "a.log", "line 1010", BASE + 2 * SEC);
+    assert(log_store_flush(&store) == 0);
+    assert(log_store_segments(&store, after, 32) == 3 && after[2].id == 25);
+    compactor_destroy(&compactor);
+    log_store_destroy(&store);
+
+    // Segments larger than half of store_compact_size are left alone
+    config.store_compact_size = (size_t)after[0].bytes * 2;
+    assert(log_store_init(&store, &config) == 0);
+    assert(log_store_segments(&store, after, 32) == 3);
+    assert(compactor_init(&compactor, &store, &config) == 0);
+    assert(compactor_run(&compactor, BASE) == 0);
+    assert(log_store_segments(&store, before, 32) == 3);
+    assert(before[0].id == after[0].id);
+    compactor_destroy(&compactor);
+    log_store_destroy(&store);
+
+    // A rewrite interrupted after its segment was written: the segments it
+    // replaces are removed at the next start
+    segment_row_t row = {BASE, "a.log", "line 0", 5, 6, LOG_LEVEL_INFO};
+    uint64_t replaced[2] = {after[0].id, after[2].id};
+    assert(segment_write_replacing(DIR_NAME "/20250101-100000/0000000100.seg", 100, &row, 1,
+                                   replaced, 2, NULL) == 0);
+    segment_t segment;
+    assert(segment_open(&segment, DIR_NAME "/20250101-100000/0000000100.seg") == 0);
+    assert(segment.num_replaces == 2 && segment_replaced_id(&segment, 1) == after[2].id);
+    assert(segment_replaced_id(&segment, 2) == 0);
+    segment_close(&segment);
+    assert(log_store_init(&store, &config) == 0);
+    assert(log_store_segments(&store, before, 32) == 2);
+    assert(before[0].id == after[1].id && before[1].id == 100);
+    assert(!segment_exists(&after[0]) && !segment_exists(&after[2]));
+    assert(log_store_next_id(&store) == 101);
+    log_store_destroy(&store);
+
+    config_destroy(&config);
+    remove_tree(DIR_NAME);
+}
+
+static void test_retention(void) {
+    remove_tree(DIR_NAME);
+    FILE* file = fopen("test_compactor_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "store_dir=" DIR_NAME "\n");
+    fprintf(file, "store_compact_size=0\n");
+    fprintf(file, "store_compact_interval=5\n");
+    fprintf(file, "store_compact_rate=0\n");
+    fprintf(file, "store_retention=debug.log 1h\n");
+    fprintf(file, "store_retention1=big.log 1G\n");
+    fprintf(file, "store_retention2=bad.log\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_compactor_config.txt") == 0);
+    assert(config.store_compact_size == 0 && config.store_compact_interval == 5);
+    assert(config.num_retention_rules == 2);
+    assert(strcmp(config.retention_rules[0].source, "debug.log") == 0);
+    assert(config.retention_rules[1].max_bytes == 1ULL << 30);
+    remove("test_compactor_config.txt");
+
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+
+    // Mixed debug and app lines, then debug only, then four big segments
+    char line[160];
+    int n = 0;
+    for (int i = 0; i < 20; i++) {
+        snprintf(line, sizeof(line), "line %d", n++);
+        append(&store, i % 2 ? "debug.log" : "app.log", line, BASE + i * SEC);
+    }
+    assert(log_store_flush(&store) == 0);
+    for (int i = 0; i < 5; i++) {
+        snprintf(line, sizeof(line), "line %d", n++);
+        append(&store, "debug.log", line, BASE + (30 + i) * SEC);
+    }
+    assert(log_store_flush(&store) == 0);
+    for (int flush = 0; flush < 4; flush++) {
+        for (int i = 0; i < 100; i++) {
+            snprintf(line, sizeof(line), "line %d %0100d", n++, i * flush);
+            append(&store, "big.log", line, BASE + (60 + flush * 100 + i) * SEC);
+        }
+        assert(log_store_flush(&store) == 0);
+    }
+    log_store_segment_t segments[16];
+    assert(log_store_segments(&store, segments, 16) == 6);
+
+    compactor_t compactor;
+    assert(compactor_init(&compactor, &store, &config) == 0);
+    uint64_t expired = metrics_get(compactor.expired_segments);
+    uint64_t rewritten = metrics_get(compactor.rewritten_segments);
+    uint64_t rows = metrics_get(compactor.expired_rows);
+
+    // Nothing is old yet (rules are read from the configuration on every pass)
+    config.retention_rules[1].max_bytes = UINT64_MAX;
+    assert(compactor_run(&compactor, BASE + HOUR / 2) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 6);
+    assert(metrics_get(compactor.expired_rows) == rows);
+
+    // Debug lines expire, app lines stay, big.log has room for its newest
+    // segment only
+    config.retention_rules[1].max_bytes = segments[5].bytes + segments[4].bytes / 2;
+    assert(compactor_run(&compactor, BASE + 2 * HOUR) == 0);
+    assert(metrics_get(compactor.expired_segments) == expired + 4);
+    assert(metrics_get(compactor.rewritten_segments) == rewritten + 1);
+    assert(metrics_get(compactor.expired_rows) == rows + 15 + 300);
+
+    log_store_segment_t after[16];
+    assert(log_store_segments(&store, after, 16) == 2);
+    assert(after[0].id == segments[5].id && after[1].id == 7 && after[1].rows == 10);
+    for (size_t i = 0; i < 5; i++) {
+        assert(!segment_exists(&segments[i]));
+    }
+    segment_t segment;
+    char path[256];
+    snprintf(path, sizeof(path), DIR_NAME "/%s", after[1].name);
+    assert(segment_open(&segment, path) == 0);
+    assert(segment.num_sources == 1 && segment.source_lengths[0] == 7);
+    assert(memcmp(segment.source_names[0], "app.log", 7) == 0);
+    assert(segment.num_replaces == 1 && segment_replaced_id(&segment, 0) == segments[0].id);
+    segment_close(&segment);
+
+    // A second pass finds nothing more to do
+    assert(compactor_run(&compactor, BASE + 2 * HOUR) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 2);
+    assert(metrics_get(compactor.expired_rows) == rows + 315);
+    compactor_destroy(&compactor);
+    log_store_destroy(&store);
+    config_destroy(&config);
+    remove_tree(DIR_NAME);
+}
+
+static void test_thread(void) {
+    remove_tree(DIR_NAME);
+    config_t config = store_config();
+    config.store_compact_interval = 1;
+    config.store_compact_rate = 1 << 20;
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+    for (int n = 0; n < 4; n++) {
+        char line[32];
+        snprintf(line, sizeof(line), "line %d", n);
+        append(&store, "a.log", line, BASE + n);
+        assert(log_store_flush(&store) == 0);
+    }
+
+    // The background pass merges the four segments
+    compactor_t compactor;
+    assert(compactor_init(&compactor, &store, &config) == 0);
+    assert(compactor_start(&compactor) == 0);
+    assert(compactor_start(&compactor) != 0);
+    for (int i = 0; i < 300 && log_store_segments(&store, NULL, 0) > 1; i++) {
+        usleep(10000);
+    }
+    assert(log_store_segments(&store, NULL, 0) == 1);
+    compactor_stop(&compactor);
+    check_lines(&store, 4);
+    compactor_destroy(&compactor);
+    log_store_destroy(&store);
+
+    // A read-only store is never compacted
+    assert(log_store_open(&store, DIR_NAME) == 0);
+    assert(compactor_init(&compactor, &store, &config) != 0);
+    log_store_destroy(&store);
+    config_destroy(&config);
+    remove_tree(DIR_NAME);
+}
+
+void test_compactor(void) {
+    test_rule_parse();
+    test_merge();
+    test_retention();
+    test_thread();
+}
\ No newline at end of file
@@ -38,6 +38,12 @@ void test_config(void) {
     fprintf(test_file, "watch_directory1=/tmp/logs\n");
     fprintf(test_file, "alert_pattern0=ERROR\n");
     fprintf(test_file, "alert_pattern1=CRITICAL\n");
+    fprintf(test_file, "alert_rule0=status>=500\n");
+    fprintf(test_file, "alert_rule1=>=bad\n");
+    fprintf(test_file, "rule_cache_size=128\n");
+    fprintf(test_file, "log_format0=app %%{timestamp:ts} [%%{word:level}] %%{rest:message}\n");
+    fprintf(test_file, "source_format0=*access.log combined\n");
+    fprintf(test_file, "source_format1=nospec\n");
     fclose(test_file);
     
     // Test loading from file
@@ -56,6 +62,16 @@ void test_config(void) {
     assert(config.num_patterns == 2);
     assert(strcmp(config.alert_patterns[0], "ERROR") == 0);
     assert(strcmp(config.alert_patterns[1], "CRITICAL") == 0);
+    assert(config.num_field_rules == 1); // Invalid rule is skipped
+    assert(strcmp(config.field_rules[0].field, "status") == 0);
+    assert(config.field_rules[0].op == FIELD_OP_GE);
+    assert(config.rule_cache_size == 128);
+    assert(config.num_log_formats == 1);
+    assert(strcmp(config.log_format_names[0], "app") == 0);
+    assert(strcmp(config.log_format_specs[0], "%{timestamp:ts} [%{word:level}] %{rest:message}") == 0);
+    assert(config.num_source_formats == 1); // Assignment without a format is skipped
+    assert(strcmp(config.source_format_globs[0], "*access.log") == 0);
+    assert(strcmp(config.source_format_names[0], "combined") == 0);
     
     // Cleanup
     config_destroy(&config);
@@ -0,0 +1,379 @@
+#include "../include/context_ring.h"
+#include "../include/alert_sink.h"
+#include "../include/alert_writer.h"
+#include "../include/config.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include "../include/processor.h"
+#include "../include/queue.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SEC 1000000000LL
+
+// Released alerts, in order
+typedef struct {
+    log_entry_t* entries[16];
+    size_t count;
+} release_log_t;
+
+static void collect(void* ctx, log_entry_t* entry) {
+    release_log_t* log = (release_log_t*)ctx;
+    assert(log->count < 16);
+    log->entries[log->count++] = entry;
+}
+
+static void clear(release_log_t* log) {
+    for (size_t i = 0; i < log->count; i++) {
+        log_entry_destroy(log->entries[i]);
+    }
+    log->count = 0;
+}
+
+static log_entry_t* make_entry(const char* source, log_level_t level, const char* line,
+                               int64_t timestamp) {
+    log_entry_t* entry = log_entry_create(source, line, level, line);
+    assert(entry != NULL);
+    entry->timestamp = timestamp;
+    return entry;
+}
+
+static uint64_t record(context_ring_t* ring, const char* source, log_level_t level,
+                       const char* line, int64_t timestamp) {
+    log_entry_t* entry = make_entry(source, level, line, timestamp);
+    uint64_t position = context_ring_record(ring, entry);
+    log_entry_destroy(entry);
+    return position;
+}
+
+static bool line_is(const log_context_t* context, size_t i, const char* text) {
+    return context->lines[i].length == strlen(text) &&
+           memcmp(LOG_CONTEXT_TEXT(context, i), text, strlen(text)) == 0;
+}
+
+// Destination collecting deliveries in memory
+typedef struct {
+    char data[4096];
+    size_t length;
+} capture_t;
+
+static int capture_deliver(void* ctx, struct iovec* iov, int count) {
+    capture_t* capture = (capture_t*)ctx;
+    for (int i = 0; i < count; i++) {
+        assert(capture->length + iov[i].iov_len < sizeof(capture->data));
+        memcpy(capture->data + capture->length, iov[i].iov_base, iov[i].iov_len);
+        capture->length += iov[i].iov_len;
+    }
+    capture->data[capture->length] = '\0';
+    return 0;
+}
+
+static void test_before_after(void) {
+    release_log_t log;
+    memset(&log, 0, sizeof(log));
+    context_ring_t ring;
+    assert(context_ring_init(&ring, 2, 2, 4096, 1 << 20, 1000, collect, &log) == 0);
+    int64_t now = 1000 * SEC;
+
+    record(&ring, "app.log", LOG_LEVEL_INFO, "line 1", now);
+    record(&ring, "app.log", LOG_LEVEL_DEBUG, "line 2", now + SEC);
+    record(&ring, "app.log", LOG_LEVEL_INFO, "line 3", now + 2 * SEC);
+    log_entry_t* alert = make_entry("app.log", LOG_LEVEL_ERROR, "line 4 failed", now + 3 * SEC);
+    uint64_t position = context_ring_record(&ring, alert);
+    context_ring_hold(&ring, alert, position, now);
+    assert(log.count == 0 && metrics_get(ring.held) == 1);
+
+    // Other sources do not count as following lines
+    record(&ring, "db.log", LOG_LEVEL_INFO, "db line", now + 4 * SEC);
+    record(&ring, "app.log", LOG_LEVEL_WARNING, "line 5", now + 2 * SEC);
+    assert(log.count == 0);
+    record(&ring, "app.log", LOG_LEVEL_INFO, "line 6", now + 6 * SEC);
+    assert(log.count == 1 && log.entries[0] == alert && metrics_get(ring.held) == 0);
+
+    const log_context_t* context = alert->context;
+    assert(context != NULL && context->num_before == 2 && context->num_lines == 4);
+    assert(line_is(context, 0, "line 2") && line_is(context, 1, "line 3"));
+    assert(line_is(context, 2, "line 5") && line_is(context, 3, "line 6"));
+    assert(context->lines[0].level == LOG_LEVEL_DEBUG);
+    assert(context->lines[2].level == LOG_LEVEL_WARNING);
+    // Timestamps survive delta encoding, including ones going backwards
+    assert(context->lines[0].timestamp == now + SEC);
+    assert(context->lines[1].timestamp == now + 2 * SEC);
+    assert(context->lines[2].timestamp == now + 2 * SEC);
+    assert(context->lines[3].timestamp == now + 6 * SEC);
+
+    // Alerts follow each other's lines; the later one is its own preceding line
+    clear(&log);
+    log_entry_t* first = make_entry("app.log", LOG_LEVEL_ERROR, "first", now);
+    context_ring_hold(&ring, first, context_ring_record(&ring, first), now);
+    log_entry_t* second = make_entry("app.log", LOG_LEVEL_ERROR, "second", now);
+    context_ring_hold(&ring, second, context_ring_record(&ring, second), now);
+    record(&ring, "app.log", LOG_LEVEL_INFO, "after", now);
+    assert(log.count == 1 && log.entries[0] == first);
+    assert(line_is(first->context, 2, "second") && line_is(first->context, 3, "after"));
+    record(&ring, "app.log", LOG_LEVEL_INFO, "after 2", now);
+    assert(log.count == 2 && log.entries[1] == second);
+    assert(line_is(second->context, 1, "first") && second->context->num_before == 2);
+
+    // Alerts whose following lines do not come are released after the wait
+    clear(&log);
+    uint64_t expired = metrics_get(ring.expired);
+    alert = make_entry("app.log", LOG_LEVEL_ERROR, "last words", now);
+    context_ring_hold(&ring, alert, context_ring_record(&ring, alert), now);
+    record(&ring, "app.log", LOG_LEVEL_INFO, "one more", now);
+    context_ring_advance(&ring, now + SEC - 1);
+    assert(log.count == 0);
+    context_ring_advance(&ring, now + SEC);
+    assert(log.count == 1 && metrics_get(ring.expired) == expired + 1);
+    assert(alert->context->num_before == 2 && alert->context->num_lines == 3);
+    assert(line_is(alert->context, 2, "one more"));
+
+    // Rate alerts take the latest lines along
+    clear(&log);
+    alert = make_entry("app.log", LOG_LEVEL_WARNING, "rate exceeded", now);
+    context_ring_attach(&ring, alert);
+    assert(alert->context->num_before == 2 && alert->context->num_lines == 2);
+    assert(line_is(alert->context, 1, "one more"));
+    log_entry_destroy(alert);
+    alert = make_entry("new.log", LOG_LEVEL_WARNING, "rate exceeded", now);
+    context_ring_attach(&ring, alert);
+    assert(alert->context == NULL);
+    log_entry_destroy(alert);
+
+    // Stopping releases what is still held
+    alert = make_entry("app.log", LOG_LEVEL_ERROR, "at shutdown", now);
+    context_ring_hold(&ring, alert, context_ring_record(&ring, alert), now);
+    assert(context_ring_start(&ring) == 0);
+    context_ring_destroy(&ring);
+    assert(log.count == 1 && log.entries[0]->context->num_lines == 2);
+    clear(&log);
+
+    // Without following lines alerts are released at once
+    assert(context_ring_init(&ring, 1, 0, 4096, 1 << 20, 1000, collect, &log) == 0);
+    alert = make_entry("app.log", LOG_LEVEL_ERROR, "alone", now);
+    context_ring_hold(&ring, alert, context_ring_record(&ring, alert), now);
+    assert(log.count == 1 && alert->context == NULL);
+    record(&ring, "app.log", LOG_LEVEL_INFO, "before", now);
+    alert = make_entry("app.log", LOG_LEVEL_ERROR, "not alone", now);
+    context_ring_hold(&ring, alert, context_ring_record(&ring, alert), now);
+    assert(log.count == 2 && alert->context->num_lines == 1);
+    assert(line_is(alert->context, 0, "before"));
+    context_ring_destroy(&ring);
+    clear(&log);
+
+    assert(context_ring_init(&ring, CONTEXT_RING_MAX_LINES + 1, 0, 4096, 1 << 20, 1000, collect,
+                             &log) == -1);
+    assert(context_ring_init(&ring, 1, 1, 16, 1 << 20, 1000, collect, &log) == -1);
+}
+
+static void test_overwrite(void) {
+    release_log_t log;
+    memset(&log, 0, sizeof(log));
+    context_ring_t ring;
+    assert(context_ring_init(&ring, 64, 0, 256, 1 << 20, 1000, collect, &log) == 0);
+
+    // Only the newest lines fit; the oldest are overwritten in place
+    char line[64];
+    for (int i = 0; i < 100; i++) {
+        snprintf(line, sizeof(line), "request %03d handled in %d ms", i, i * 7 % 50);
+        record(&ring, "app.log", LOG_LEVEL_INFO, line, (1000 + i) * SEC - (i % 3) * SEC / 2);
+    }
+    log_entry_t* alert = make_entry("app.log", LOG_LEVEL_ERROR, "out of memory", 0);
+    context_ring_hold(&ring, alert, context_ring_record(&ring, alert), 0);
+    assert(log.count == 1);
+    const log_context_t* context = alert->context;
+    assert(context != NULL && context->num_lines > 3 && context->num_lines < 10);
+    assert(context->num_before == context->num_lines);
+    for (uint32_t i = 0; i < context->num_lines; i++) {
+        int n = 100 - (int)context->num_lines + (int)i;
+        snprintf(line, sizeof(line), "request %03d handled in %d ms", n, n * 7 % 50);
+        assert(line_is(context, i, line));
+        assert(context->lines[i].timestamp == (1000 + n) * SEC - (n % 3) * SEC / 2);
+    }
+
+    // Long lines are cut to a quarter of the ring
+    char long_line[200];
+    memset(long_line, 'x', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+    record(&ring, "app.log", LOG_LEVEL_INFO, long_line, 0);
+    alert = make_entry("app.log", LOG_LEVEL_ERROR, "after long", 0);
+    context_ring_attach(&ring, alert);
+    assert(alert->context->lines[alert->context->num_lines - 1].length == 64);
+    log_entry_destroy(alert);
+
+    context_ring_destroy(&ring);
+    clear(&log);
+}
+
+static void test_eviction(void) {
+    release_log_t log;
+    memset(&log, 0, sizeof(log));
+    context_ring_t ring;
+    // Room for a single ring
+    assert(context_ring_init(&ring, 1, 1, 1024, 1500, 1000, collect, &log) == 0);
+    assert(ring.num_stripes == 1);
+    uint64_t evictions = metrics_get(ring.evictions);
+
+    record(&ring, "a.log", LOG_LEVEL_INFO, "a1", 0);
+    log_entry_t* alert = make_entry("a.log", LOG_LEVEL_ERROR, "a2", 0);
+    uint64_t position = context_ring_record(&ring, alert);
+    context_ring_hold(&ring, alert, position, 0);
+    assert(log.count == 0);
+
+    // A new source takes the idle ring and releases what it held
+    record(&ring, "b.log", LOG_LEVEL_INFO, "b1", 0);
+    assert(log.count == 1 && metrics_get(ring.evictions) == evictions + 1);
+    assert(alert->context->num_lines == 1 && line_is(alert->context, 0, "a1"));
+    assert(metrics_get(ring.sources) == 1);
+
+    // Positions of an evicted source never match its new ring
+    record(&ring, "a.log", LOG_LEVEL_INFO, "a3", 0);
+    alert = make_entry("a.log", LOG_LEVEL_ERROR, "stale", 0);
+    context_ring_hold(&ring, alert, position, 0);
+    assert(log.count == 2 && alert->context == NULL);
+
+    context_ring_destroy(&ring);
+    clear(&log);
+}
+
+static void test_output(void) {
+    release_log_t log;
+    memset(&log, 0, sizeof(log));
+    context_ring_t ring;
+    assert(context_ring_init(&ring, 1, 1, 1024, 1 << 20, 1000, collect, &log) == 0);
+    record(&ring, "app.log", LOG_LEVEL_INFO, "2025-01-01 10:00:00 [INFO] \"GET /\"", 1 * SEC);
+    log_entry_t* alert = make_entry("app.log", LOG_LEVEL_ERROR, "db down", 2 * SEC);
+    context_ring_hold(&ring, alert, context_ring_record(&ring, alert), 0);
+    record(&ring, "app.log", LOG_LEVEL_WARNING, "2025-01-01 10:00:03 [WARN] retrying", 3 * SEC);
+    assert(log.count == 1);
+
+    alert_line_t line = {2 * SEC, LOG_LEVEL_ERROR, "app.log", "db down", NULL, 0, 0, 0,
+                         alert->context};
+    capture_t capture;
+    memset(&capture, 0, sizeof(capture));
+    alert_writer_t writer;
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_TEXT, NULL, 1024,
+                             0) == 0);
+    assert(alert_writer_append(&writer, &line, 0) == 0);
+    assert(writer.lines == 1);
+    assert(alert_writer_flush(&writer) == 0);
+    const char* text = strchr(capture.data, '\n');
+    assert(text && strcmp(text, "\n  - 2025-01-01 10:00:00 [INFO] \"GET /\"\n"
+                                "  + 2025-01-01 10:00:03 [WARN] retrying\n") == 0);
+    alert_writer_destroy(&writer);
+
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_JSON, NULL, 1024,
+                             0) == 0);
+    assert(alert_writer_append(&writer, &line, 0) == 0);
+    assert(alert_writer_flush(&writer) == 0);
+    assert(strstr(capture.data, ",\"before\":[\"2025-01-01 10:00:00 [INFO] \\\"GET /\\\"\"],"
+                                "\"after\":[\"2025-01-01 10:00:03 [WARN] retrying\"]}\n"));
+    alert_writer_destroy(&writer);
+
+    // Context that does not fit the buffer is dropped before the message is cut
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_JSON, NULL, 160,
+                             0) == 0);
+    assert(alert_writer_append(&writer, &line, 0) == 0);
+    assert(alert_writer_flush(&writer) == 0);
+    assert(strstr(capture.data, "\"message\":\"db down\"") && !strstr(capture.data, "before"));
+    alert_writer_destroy(&writer);
+
+    // Binary context lines are records of their own after the alert
+    memset(&capture, 0, sizeof(capture));
+    assert(alert_writer_init(&writer, capture_deliver, &capture, ALERT_FORMAT_BINARY, NULL, 1024,
+                             0) == 0);
+    assert(alert_writer_append(&writer, &line, 0) == 0);
+    assert(alert_writer_flush(&writer) == 0);
+    size_t offset = 0;
+    int types[3];
+    for (int i = 0; i < 3; i++) {
+        const unsigned char* record_data = (const unsigned char*)capture.data + offset;
+        size_t length = (size_t)record_data[0] | (size_t)record_data[1] << 8;
+        types[i] = record_data[4];
+        if (i == 2) {
+            uint32_t source_id = (uint32_t)record_data[16] | (uint32_t)record_data[17] << 8 |
+                                 (uint32_t)record_data[18] << 16 | (uint32_t)record_data[19] << 24;
+            assert(record_data[5] == LOG_LEVEL_WARNING && source_id == alert_source_id("app.log"));
+            assert(memcmp(record_data + ALERT_BINARY_HEADER + 7, "2025-01-01 10:00:03", 19) == 0);
+        }
+        offset += 4 + length;
+    }
+    assert(offset == capture.length);
+    assert(types[0] == ALERT_BINARY_ALERT && types[1] == ALERT_BINARY_BEFORE &&
+           types[2] == ALERT_BINARY_AFTER);
+    alert_writer_destroy(&writer);
+
+    // Records carry a copy of the context
+    alert_record_t* copy = alert_record_create(&line);
+    assert(copy && copy->line.context != alert->context);
+    assert(line_is(copy->line.context, 1, "2025-01-01 10:00:03 [WARN] retrying"));
+    alert_record_release(copy);
+
+    context_ring_destroy(&ring);
+    clear(&log);
+}
+
+static void test_processor(void) {
+    FILE* file = fopen("test_context_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_context_before=2\n");
+    fprintf(file, "alert_context_after=1\n");
+    fprintf(file, "alert_context_buffer=8192\n");
+    fprintf(file, "alert_context_memory=1048576\n");
+    fprintf(file, "alert_context_wait_ms=500\n");
+    fprintf(file, "processor_mode=queue\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_context_config.txt") == 0);
+    assert(config.alert_context_before == 2 && config.alert_context_after == 1);
+    assert(config.alert_context_buffer == 8192 && config.alert_context_memory == 1048576);
+    assert(config.alert_context_wait_ms == 500);
+
+    log_queue_t input;
+    log_queue_t output;
+    assert(queue_init(&input, 16) == 0 && queue_init(&output, 16) == 0);
+    processor_t processor;
+    assert(processor_init(&processor, &input, &output, &config) == 0);
+    assert(processor.context != NULL);
+
+    // Lines below the threshold are recorded too
+    processor_handle_entry(&processor, make_entry("app.log", LOG_LEVEL_INFO, "warming up", 0));
+    processor_handle_entry(&processor, make_entry("app.log", LOG_LEVEL_ERROR, "crashed", 0));
+    assert(queue_size(&output) == 0);
+    processor_handle_entry(&processor, make_entry("app.log", LOG_LEVEL_INFO, "restarting", 0));
+    assert(queue_size(&output) == 1);
+    log_entry_t* alert = queue_dequeue(&output);
+    assert(strcmp(alert->message, "crashed") == 0 && alert->context->num_lines == 2);
+    assert(line_is(alert->context, 0, "warming up") && line_is(alert->context, 1, "restarting"));
+    log_entry_destroy(alert);
+
+    // Held alerts go out when the processor stops
+    processor_handle_entry(&processor, make_entry("app.log", LOG_LEVEL_ERROR, "crashed again", 0));
+    processor_stop(&processor);
+    assert(queue_size(&output) == 1);
+    processor_destroy(&processor);
+    queue_destroy(&output);
+    queue_destroy(&input);
+    config_destroy(&config);
+
+    file = fopen("test_context_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_context_before=65\n");
+    fprintf(file, "alert_context_buffer=100\n");
+    fclose(file);
+    assert(config_load(&config, "test_context_config.txt") == 0);
+    assert(config.alert_context_before == 0 && config.alert_context_buffer == 16384);
+    config_destroy(&config);
+    remove("test_context_config.txt");
+}
+
+void test_context_ring(void) {
+    test_before_after();
+    test_overwrite();
+    test_eviction();
+    test_output();
+    test_processor();
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "../include/correlator.h"
+#include "../include/sequence_rule.h"
+#include "../include/config.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SEC 1000000000LL
+
+typedef struct {
+    size_t alerts;
+    const sequence_rule_t* rule;
+    char source[64];
+    log_level_t level;
+    int64_t elapsed;
+} match_log_t;
+
+static void record_match(void* ctx, const sequence_rule_t* rule, const char* source,
+                         log_level_t level, int64_t elapsed) {
+    match_log_t* log = (match_log_t*)ctx;
+    log->alerts++;
+    log->rule = rule;
+    snprintf(log->source, sizeof(log->source), "%s", source);
+    log->level = level;
+    log->elapsed = elapsed;
+}
+
+// Observe an entry written at `event` and processed at `now`
+static void observe_at(correlator_t* correlator, const char* source, log_level_t level,
+                       const char* message, int64_t event, int64_t now) {
+    log_entry_t* entry = log_entry_create(source, message, level, message);
+    assert(entry != NULL);
+    entry->timestamp = event;
+    correlator_observe(correlator, entry, now);
+    log_entry_destroy(entry);
+}
+
+static void observe(correlator_t* correlator, const char* source, log_level_t level,
+                    const char* message, int64_t now) {
+    observe_at(correlator, source, level, message, now, now);
+}
+
+void test_correlator(void) {
+    sequence_rule_t rules[3];
+
+    // Test rule parsing
+    assert(sequence_rule_parse(&rules[0], "connection refused -> circuit open within 30s") == 0);
+    assert(rules[0].num_steps == 2 && !rules[0].absence && rules[0].window == 30 * SEC);
+    assert(strcmp(rules[0].steps[0].pattern, "connection refused") == 0);
+    assert(strcmp(rules[0].steps[1].pattern, "circuit open") == 0);
+    sequence_rule_destroy(&rules[0]);
+
+    assert(sequence_rule_parse(&rules[0], "ERROR db timeout -> status>=500 -> circuit open within 1m") == 0);
+    assert(rules[0].num_steps == 3 && rules[0].window == 60 * SEC);
+    assert(rules[0].steps[0].min_level == LOG_LEVEL_ERROR);
+    assert(rules[0].steps[1].has_field && !rules[0].steps[2].has_field);
+    sequence_rule_destroy(&rules[0]);
+
+    assert(sequence_rule_parse(&rules[0], "deploy started -> !deploy finished within 10m") == 0);
+    assert(rules[0].num_steps == 2 && rules[0].absence && rules[0].window == 600 * SEC);
+    assert(strcmp(rules[0].steps[1].pattern, "deploy finished") == 0);
+    sequence_rule_destroy(&rules[0]);
+
+    assert(sequence_rule_parse(&rules[0], "connection refused within 30s") == -1);
+    assert(sequence_rule_parse(&rules[0], "a -> b") == -1);
+    assert(sequence_rule_parse(&rules[0], "a -> b within 0s") == -1);
+    assert(sequence_rule_parse(&rules[0], "a -> -> b within 30s") == -1);
+    assert(sequence_rule_parse(&rules[0], "a -> !b -> c within 30s") == -1);
+    assert(sequence_rule_parse(&rules[0], "!a -> b within 30s") == -1);
+    assert(sequence_rule_parse(&rules[0], "a -> b -> c -> d -> e within 30s") == -1);
+
+    // Test ordered steps per source
+    assert(sequence_rule_parse(&rules[0], "refused -> circuit open within 10s") == 0);
+    assert(sequence_rule_parse(&rules[1], "ERROR begin -> middle -> end within 10s") == 0);
+    assert(sequence_rule_parse(&rules[2], "deploy started -> !deploy finished within 5s") == 0);
+    match_log_t log;
+    memset(&log, 0, sizeof(log));
+    correlator_t correlator;
+    int64_t now = 1000 * SEC;
+    assert(correlator_init(&correlator, rules, 3, 1024, record_match, &log, now) == 0);
+
+    observe(&correlator, "app.log", LOG_LEVEL_INFO, "circuit open", now);
+    assert(log.alerts == 0 && correlator_open(&correlator) == 0);
+    observe(&correlator, "app.log", LOG_LEVEL_ERROR, "connection refused", now + SEC);
+    observe(&correlator, "db.log", LOG_LEVEL_INFO, "circuit open", now + 2 * SEC);
+    assert(log.alerts == 0 && correlator_open(&correlator) == 1);
+    observe(&correlator, "app.log", LOG_LEVEL_ERROR, "circuit open", now + 3 * SEC);
+    assert(log.alerts == 1 && log.rule == &rules[0] && log.elapsed == 2 * SEC);
+    assert(strcmp(log.source, "app.log") == 0 && log.level == LOG_LEVEL_ERROR);
+    assert(correlator_open(&correlator) == 0);
+
+    // A repeated first step restarts the window
+    observe(&correlator, "app.log", LOG_LEVEL_INFO, "refused", now + 10 * SEC);
+    observe(&correlator, "app.log", LOG_LEVEL_INFO, "refused", now + 18 * SEC);
+    observe(&correlator, "app.log", LOG_LEVEL_INFO, "circuit open", now + 25 * SEC);
+    assert(log.alerts == 2 && log.elapsed == 7 * SEC);
+
+    // Steps out of order or too late do not match
+    observe(&correlator, "x.log", LOG_LEVEL_ERROR, "begin", now + 30 * SEC);
+    observe(&correlator, "x.log", LOG_LEVEL_ERROR, "end", now + 31 * SEC);
+    observe(&correlator, "x.log", LOG_LEVEL_ERROR, "middle", now + 32 * SEC);
+    assert(log.alerts == 2);
+    observe(&correlator, "x.log", LOG_LEVEL_ERROR, "end", now + 41 * SEC);
+    assert(log.alerts == 2 && correlator_open(&correlator) == 0);
+    observe(&correlator, "x.log", LOG_LEVEL_WARNING, "begin", now + 42 * SEC);
+    assert(correlator_open(&correlator) == 0);
+    observe(&correlator, "x.log", LOG_LEVEL_ERROR, "begin", now + 43 * SEC);
+    observe(&correlator, "x.log", LOG_LEVEL_INFO, "middle", now + 44 * SEC);
+    observe(&correlator, "x.log", LOG_LEVEL_INFO, "end", now + 45 * SEC);
+    assert(log.alerts == 3 && log.rule == &rules[1] && log.elapsed == 2 * SEC);
+
+    // Timed-out partial matches expire through the wheel
+    metric_t* expired = metrics_register("correlator.expired", METRIC_COUNTER);
+    uint64_t expired_before = metrics_get(expired);
+    observe(&correlator, "y.log", LOG_LEVEL_INFO, "refused", now + 50 * SEC);
+    assert(correlator_open(&correlator) == 1);
+    correlator_advance(&correlator, now + 59 * SEC);
+    assert(correlator_open(&correlator) == 1);
+    correlator_advance(&correlator, now + 61 * SEC);
+    assert(correlator_open(&correlator) == 0);
+    assert(metrics_get(expired) - expired_before == 1);
+    assert(log.alerts == 3);
+
+    // Absence rules fire when the last step does not arrive in time
+    observe(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy started", now + 70 * SEC);
+    observe(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy finished", now + 72 * SEC);
+    correlator_advance(&correlator, now + 80 * SEC);
+    assert(log.alerts == 3 && correlator_open(&correlator) == 0);
+    observe(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy started", now + 80 * SEC);
+    correlator_advance(&correlator, now + 84 * SEC);
+    assert(log.alerts == 3);
+    correlator_advance(&correlator, now + 86 * SEC);
+    assert(log.alerts == 4 && log.rule == &rules[2] && log.elapsed == 5 * SEC);
+    assert(strcmp(log.source, "deploy.log") == 0 && log.level == LOG_LEVEL_WARNING);
+    observe(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy finished", now + 87 * SEC);
+    assert(log.alerts == 4 && correlator_open(&correlator) == 0);
+
+    // Network sources are tracked per client address
+    observe(&correlator, "network:10.0.0.1:4000", LOG_LEVEL_INFO, "refused", now + 90 * SEC);
+    observe(&correlator, "network:10.0.0.2:4000", LOG_LEVEL_INFO, "circuit open", now + 91 * SEC);
+    assert(log.alerts == 4);
+    observe(&correlator, "network:10.0.0.1:4001", LOG_LEVEL_INFO, "circuit open", now + 92 * SEC);
+    assert(log.alerts == 5 && strcmp(log.source, "network:10.0.0.1:4001") == 0);
+
+    // A replayed backlog is judged by event time, not processing time
+    observe_at(&correlator, "old.log", LOG_LEVEL_INFO, "refused", now + 100 * SEC, now + 200 * SEC);
+    observe_at(&correlator, "old.log", LOG_LEVEL_INFO, "circuit open", now + 115 * SEC,
+               now + 200 * SEC);
+    assert(log.alerts == 5 && correlator_open(&correlator) == 0);
+    observe_at(&correlator, "old.log", LOG_LEVEL_INFO, "refused", now + 120 * SEC, now + 200 * SEC);
+    observe_at(&correlator, "old.log", LOG_LEVEL_INFO, "circuit open", now + 125 * SEC,
+               now + 200 * SEC);
+    assert(log.alerts == 6 && log.elapsed == 5 * SEC);
+
+    // A queue running behind does not time out absence rules early
+    observe_at(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy started", now + 230 * SEC,
+               now + 260 * SEC);
+    correlator_advance(&correlator, now + 263 * SEC);
+    observe_at(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy finished", now + 233 * SEC,
+               now + 264 * SEC);
+    assert(log.alerts == 6 && correlator_open(&correlator) == 0);
+    observe_at(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy started", now + 240 * SEC,
+               now + 270 * SEC);
+    correlator_advance(&correlator, now + 274 * SEC);
+    assert(log.alerts == 6);
+    correlator_advance(&correlator, now + 276 * SEC);
+    assert(log.alerts == 7 && log.rule == &rules[2] && log.elapsed == 5 * SEC);
+
+    // A last step written after the window still fires the absence rule
+    observe_at(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy started", now + 280 * SEC,
+               now + 281 * SEC);
+    observe_at(&correlator, "deploy.log", LOG_LEVEL_INFO, "deploy finished", now + 290 * SEC,
+               now + 282 * SEC);
+    assert(log.alerts == 8 && log.rule == &rules[2] && correlator_open(&correlator) == 0);
+    correlator_destroy(&correlator);
+
+    // Test the expiry thread
+    memset(&log, 0, sizeof(log));
+    assert(correlator_init(&correlator, &rules[2], 1, 16, record_match, &log, now) == 0);
+    assert(correlator_start(&correlator) == 0);
+    correlator_stop(&correlator);
+    correlator_stop(&correlator);
+    correlator_destroy(&correlator);
+
+    // Test bounded memory: a full stripe evicts instead of growing
+    metric_t* evictions = metrics_register("correlator.evictions", METRIC_COUNTER);
+    uint64_t evictions_before = metrics_get(evictions);
+    assert(correlator_init(&correlator, rules, 1, CORRELATOR_STRIPES, record_match, &log, now) == 0);
+    for (int i = 0; i < 1000; i++) {
+        char source[32];
+        snprintf(source, sizeof(source), "host%d.log", i);
+        observe(&correlator, source, LOG_LEVEL_INFO, "refused", now + i);
+    }
+    assert(correlator_open(&correlator) <= CORRELATOR_STRIPES);
+    assert(metrics_get(evictions) - evictions_before >= 1000 - CORRELATOR_STRIPES);
+    observe(&correlator, "host999.log", LOG_LEVEL_INFO, "circuit open", now + 2000);
+    assert(log.alerts == 1);
+    correlator_destroy(&correlator);
+
+    assert(correlator_init(&correlator, rules, 0, 16, record_match, &log, now) == -1);
+    assert(correlator_init(&correlator, rules, 1, 0, record_match, &log, now) == -1);
+    for (int i = 0; i < 3; i++) {
+        sequence_rule_destroy(&rules[i]);
+    }
+
+    // Test config keys
+    FILE* file = fopen("test_sequence_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_sequence0=refused -> circuit open within 30s\n");
+    fprintf(file, "alert_sequence1=not a rule\n");
+    fprintf(file, "alert_sequence2=deploy started -> !deploy finished within 10m\n");
+    fprintf(file, "alert_sequence_capacity=4096\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_sequence_config.txt") == 0);
+    assert(config.num_sequence_rules == 2);
+    assert(config.sequence_rules[1].absence);
+    assert(strcmp(config.sequence_rules[1].text, "deploy started -> !deploy finished within 10m") == 0);
+    assert(config.alert_sequence_capacity == 4096);
+    // Sequences need per-source order, so shard mode replaces the default
+    assert(config.processor_mode == PROCESSOR_MODE_SHARD);
+    config_destroy(&config);
+    remove("test_sequence_config.txt");
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "../include/file_rotator.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define SEC 1000000000LL
+#define DIR_NAME "test_rotate_dir"
+
+// Rotated files in the directory; the newest name (by timestamp) is copied out
+static size_t list_rotated(char* newest, size_t size) {
+    DIR* dir = opendir(DIR_NAME);
+    assert(dir != NULL);
+    size_t count = 0;
+    newest[0] = '\0';
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (strncmp(item->d_name, "alerts.log.", 11) == 0) {
+            count++;
+            if (strcmp(item->d_name, newest) > 0) {
+                snprintf(newest, size, "%s", item->d_name);
+            }
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void clean_dir(void) {
+    DIR* dir = opendir(DIR_NAME);
+    if (!dir) {
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (item->d_name[0] != '.') {
+            char path[512];
+            snprintf(path, sizeof(path), DIR_NAME "/%s", item->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+    rmdir(DIR_NAME);
+}
+
+static void write_line(file_rotator_t* rotator, const char* line, int64_t now) {
+    struct iovec iov = {(void*)line, strlen(line)};
+    assert(file_rotator_write(rotator, &iov, 1, now) == 0);
+}
+
+static uint64_t metric(const char* name) {
+    return metrics_get(metrics_register(name, METRIC_COUNTER));
+}
+
+void test_file_rotator(void) {
+    clean_dir();
+    assert(mkdir(DIR_NAME, 0755) == 0);
+    config_t config;
+    config_init_defaults(&config);
+
+    // Test size rotation with count retention
+    config.alert_rotate_size = 100;
+    config.alert_rotate_keep = 2;
+    file_rotator_t rotator;
+    assert(file_rotator_open(&rotator, "test.rotate_size", DIR_NAME "/alerts.log", &config) == 0);
+    int64_t now = 1700000000LL * SEC;
+    for (int i = 1; i <= 10; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "line %02d .................................\n", i);
+        assert(strlen(line) == 42);
+        write_line(&rotator, line, now + i * SEC);
+    }
+    file_rotator_close(&rotator);
+    assert(metric("test.rotate_size.rotations") == 4);
+    assert(metric("test.rotate_size.expired") == 2);
+    assert(metric("test.rotate_size.rotate_errors") == 0);
+
+    char newest[256];
+    assert(list_rotated(newest, sizeof(newest)) == 2);
+    char path[512];
+    snprintf(path, sizeof(path), DIR_NAME "/%s", newest);
+    char text[256];
+#ifdef HAVE_ZLIB
+    assert(strcmp(newest + strlen(newest) - 3, ".gz") == 0);
+    // Retention may remove a rotated file before its turn to be compressed
+    assert(metric("test.rotate_size.compressed") >= 2);
+    gzFile in = gzopen(path, "rb");
+    assert(in != NULL);
+    int length = gzread(in, text, sizeof(text) - 1);
+    gzclose(in);
+#else
+    FILE* in = fopen(path, "r");
+    assert(in != NULL);
+    int length = (int)fread(text, 1, sizeof(text) - 1, in);
+    fclose(in);
+#endif
+    assert(length == 84);
+    text[length] = '\0';
+    assert(strncmp(text, "line 07", 7) == 0 && strstr(text, "line 08") != NULL);
+
+    FILE* file = fopen(DIR_NAME "/alerts.log", "r");
+    assert(file != NULL);
+    assert(fread(text, 1, sizeof(text), file) == 84 && strncmp(text, "line 09", 7) == 0);
+    fclose(file);
+    clean_dir();
+    assert(mkdir(DIR_NAME, 0755) == 0);
+
+    // Test interval rotation with age retention
+    config.alert_rotate_size = 0;
+    config.alert_rotate_keep = 0;
+    config.alert_rotate_interval = 60;
+    config.alert_rotate_max_age = 3600;
+    config.alert_rotate_compress = false;
+    file = fopen(DIR_NAME "/alerts.log.20200101-000000", "w");
+    assert(file != NULL);
+    fclose(file);
+    struct utimbuf old = {1577836800, 1577836800};
+    assert(utime(DIR_NAME "/alerts.log.20200101-000000", &old) == 0);
+
+    assert(file_rotator_open(&rotator, "test.rotate_interval", DIR_NAME "/alerts.log",
+                             &config) == 0);
+    // Retention runs at open, before any rotation
+    assert(metric("test.rotate_interval.expired") == 1);
+    assert(access(DIR_NAME "/alerts.log.20200101-000000", F_OK) != 0);
+    now = rotator.opened_at;
+    write_line(&rotator, "first\n", now);
+    write_line(&rotator, "second\n", now + 59 * SEC);
+    assert(metric("test.rotate_interval.rotations") == 0);
+    write_line(&rotator, "third\n", now + 61 * SEC);
+    assert(metric("test.rotate_interval.rotations") == 1);
+    // Rotating twice within a second picks a fresh name
+    assert(file_rotator_rotate(&rotator, now + 61 * SEC) == 0);
+    file_rotator_close(&rotator);
+    assert(list_rotated(newest, sizeof(newest)) == 2);
+    assert(strcmp(newest + strlen(newest) - 2, ".1") == 0);
+    assert(metric("test.rotate_interval.compressed") == 0);
+    clean_dir();
+
+    assert(file_rotator_open(&rotator, "test.rotate_missing", "no_such_dir/alerts.log",
+                             &config) == -1);
+    config_destroy(&config);
+
+    // Test config keys
+    file = fopen("test_file_rotator_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_rotate_size=10485760\n");
+    fprintf(file, "alert_rotate_interval=86400\n");
+    fprintf(file, "alert_rotate_keep=7\n");
+    fprintf(file, "alert_rotate_max_age=604800\n");
+    fprintf(file, "alert_rotate_compress=false\n");
+    fclose(file);
+    assert(config_load(&config, "test_file_rotator_config.txt") == 0);
+    assert(config.alert_rotate_size == 10485760 && config.alert_rotate_interval == 86400);
+    assert(config.alert_rotate_keep == 7 && config.alert_rotate_max_age == 604800);
+    assert(!config.alert_rotate_compress);
+    config_destroy(&config);
+    config_init_defaults(&config);
+    assert(config.alert_rotate_size == 0 && config.alert_rotate_interval == 0);
+    assert(config.alert_rotate_compress);
+    config_destroy(&config);
+    remove("test_file_rotator_config.txt");
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "../include/json_lines.h"
+#include "../include/line_parser.h"
+#include "../include/log_entry.h"
+#include "../include/timestamp.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static int span_equals(const json_span_t* span, const char* expected) {
+    return span->start && span->length == strlen(expected) &&
+           memcmp(span->start, expected, span->length) == 0;
+}
+
+void test_json_lines(void) {
+    json_lines_t parser;
+    json_lines_result_t result;
+    char* fields[] = {"status", "user"};
+    
+    // Test initialization with default key mappings
+    assert(json_lines_init(&parser, NULL, NULL, NULL, fields, 2) == 0);
+    assert(parser.level_keys.count > 0);
+    assert(parser.num_fields == 2);
+    
+    // Test basic scan
+    const char* line = "{\"ts\":1700000000123,\"level\":\"error\",\"msg\":\"db down\","
+                       "\"status\":503,\"user\":\"bob\"}";
+    assert(json_lines_is_json(line, strlen(line)));
+    assert(json_lines_scan(&parser, line, strlen(line), &result) == 0);
+    assert(span_equals(&result.level, "error") && result.level.is_string);
+    assert(span_equals(&result.message, "db down"));
+    assert(span_equals(&result.timestamp, "1700000000123") && !result.timestamp.is_string);
+    assert(span_equals(&result.fields[0], "503"));
+    assert(span_equals(&result.fields[1], "bob"));
+    
+    // Test skipped nested values, escaped quotes and structurals inside strings,
+    // spread over more than one 64-byte block
+    const char* nested = "  { \"ctx\": {\"a\": [1, {\"b\": \"}]\"}], \"c\": \"x,y:z\"}, "
+                         "\"note\": \"say \\\"hi\\\" {not structural}\", "
+                         "\"path\": \"C:\\\\dir\\\\\", \"message\" : \"tab\\there\" , "
+                         "\"severity\": \"WARN\" }";
+    assert(json_lines_scan(&parser, nested, strlen(nested), &result) == 0);
+    assert(span_equals(&result.level, "WARN"));
+    assert(span_equals(&result.message, "tab\\there"));
+    assert(result.fields[0].start == NULL);
+    
+    json_span_t span;
+    assert(json_lines_find(nested, strlen(nested), "ctx", &span));
+    assert(span.length > 0 && span.start[0] == '{' && span.start[span.length - 1] == '}');
+    assert(json_lines_find(nested, strlen(nested), "path", &span));
+    assert(span_equals(&span, "C:\\\\dir\\\\"));
+    assert(!json_lines_find(nested, strlen(nested), "a", &span)); // Not top-level
+    
+    // Test unescape
+    char decoded[64];
+    const char* escaped = "a\\\"b\\\\c\\nd\\u00e9\\ud83d\\ude00";
+    size_t n = json_lines_unescape(escaped, strlen(escaped), decoded, sizeof(decoded));
+    assert(n == strlen("a\"b\\c\nd\xc3\xa9\xf0\x9f\x98\x80"));
+    assert(strcmp(decoded, "a\"b\\c\nd\xc3\xa9\xf0\x9f\x98\x80") == 0);
+    n = json_lines_unescape("x\\u0000y", 8, decoded, sizeof(decoded));
+    assert(n == 8 && strcmp(decoded, "x\\u0000y") == 0); // NUL stays escaped
+    
+    // Test malformed input
+    assert(json_lines_scan(&parser, "{\"a\":", 5, &result) == -1);
+    assert(json_lines_scan(&parser, "[1,2]", 5, &result) == -1);
+    assert(json_lines_scan(&parser, "{\"a\" 1}", 7, &result) == -1);
+    assert(!json_lines_is_json("[INFO] x", 8));
+    
+    json_lines_destroy(&parser);
+    
+    // Test the line parser: JSON and bracket lines share one entry point
+    config_t config;
+    config_init_defaults(&config);
+    config.json_lines = true;
+    config.json_fields = fields;
+    config.num_json_fields = 1;
+    
+    line_parser_t line_parser;
+    assert(line_parser_init(&line_parser, &config) == 0);
+    config.json_fields = NULL;
+    config.num_json_fields = 0;
+    
+    const char* json_line = "{\"level\":50,\"msg\":\"disk \\\"full\\\"\",\"time\":1700000000,"
+                            "\"status\":507,\"latency_ms\":12}";
+    log_entry_t* entry = line_parser_create_entry(&line_parser, "svc", json_line, strlen(json_line));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(strcmp(entry->message, "disk \"full\"") == 0);
+    assert(strcmp(entry->raw_line, json_line) == 0);
+    assert(entry->timestamp == 1700000000LL * TIMESTAMP_NS_PER_SEC);
+    assert(entry->ingest_time > 0);
+    assert(entry->num_fields == 1); // Selected field stored during the scan
+    
+    double number;
+    assert(log_entry_get_field_number(entry, "status", &number) && number == 507);
+    assert(log_entry_get_field_number(entry, "latency_ms", &number) && number == 12);
+    log_entry_destroy(entry);
+    
+    const char* text_line = "[ERROR] POST /api/data 500";
+    entry = line_parser_create_entry(&line_parser, "svc", text_line, strlen(text_line));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(strcmp(entry->message, "POST /api/data 500") == 0);
+    assert(strcmp(entry->raw_line, text_line) == 0);
+    log_entry_destroy(entry);
+    
+    assert(line_parser_create_entry(&line_parser, "svc", "", 0) == NULL);
+    
+    line_parser_destroy(&line_parser);
+    config_destroy(&config);
+}
\ No newline at end of file
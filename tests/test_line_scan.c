@@ -0,0 +1,148 @@
+#include "../include/line_scan.h"
+#include "../include/line_parser.h"
+#include "../include/log_entry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const char* IMPL_NAMES[] = {"avx512", "avx2", "sse2", "scalar"};
+
+static int line_equals(const char* buf, const line_span_t* line, const char* expected) {
+    return line->length == strlen(expected) && memcmp(buf + line->start, expected, line->length) == 0;
+}
+
+static int message_equals(const char* buf, const line_span_t* line, const char* expected) {
+    return line->length - line->message == strlen(expected) &&
+           memcmp(buf + line->start + line->message, expected, line->length - line->message) == 0;
+}
+
+static void check_framing(void) {
+    line_span_t lines[8];
+    size_t consumed;
+
+    // Framing, '\r' stripping and the partial last line
+    const char* text = "[ERROR] disk full\r\nplain line\n\n[warn]   cache miss\npartial";
+    size_t count = line_scan(text, strlen(text), lines, 8, &consumed);
+    assert(count == 4);
+    assert(consumed == strlen(text) - strlen("partial"));
+    assert(line_equals(text, &lines[0], "[ERROR] disk full"));
+    assert(lines[0].has_level && lines[0].level == LOG_LEVEL_ERROR);
+    assert(message_equals(text, &lines[0], "disk full"));
+    assert(line_equals(text, &lines[1], "plain line"));
+    assert(!lines[1].has_level && lines[1].level == LOG_LEVEL_INFO && lines[1].message == 0);
+    assert(lines[2].length == 0);
+    assert(lines[3].has_level && lines[3].level == LOG_LEVEL_WARNING);
+    assert(message_equals(text, &lines[3], "cache miss"));
+
+    // Batches stop at max_lines and resume from consumed
+    count = line_scan(text, strlen(text), lines, 2, &consumed);
+    assert(count == 2);
+    assert(consumed == strlen("[ERROR] disk full\r\nplain line\n"));
+    count = line_scan(text + consumed, strlen(text) - consumed, lines, 8, &consumed);
+    assert(count == 2);
+
+    // No newline at all: nothing consumed
+    assert(line_scan("no newline", 10, lines, 8, &consumed) == 0);
+    assert(consumed == 0);
+
+    // Unterminated or overlong level tokens are not a prefix
+    text = "[ERROR disk full\n[this-token-is-far-too-long] x\n[] x\n";
+    count = line_scan(text, strlen(text), lines, 8, &consumed);
+    assert(count == 3);
+    assert(!lines[0].has_level);
+    assert(!lines[1].has_level);
+    assert(lines[2].has_level && lines[2].level == LOG_LEVEL_INFO);
+
+    // Lines and brackets straddling 64-byte blocks
+    char buf[512];
+    size_t used = 0;
+    for (int i = 0; i < 20; i++) {
+        used += (size_t)snprintf(buf + used, sizeof(buf) - used, "%.*s[CRITICAL] m%d\n",
+                                 i % 7, "       ", i);
+    }
+    count = line_scan(buf, used, lines, 8, &consumed);
+    assert(count == 8);
+    size_t total = count;
+    size_t offset = consumed;
+    line_span_t more[LINE_SCAN_BATCH];
+    count = line_scan(buf + offset, used - offset, more, LINE_SCAN_BATCH, &consumed);
+    total += count;
+    assert(total == 20);
+    assert(offset + consumed == used);
+    for (size_t i = 0; i < count; i++) {
+        int n = (int)(i + 8);
+        // Lines indented by the template do not start with '['
+        assert(more[i].has_level == (n % 7 == 0));
+        if (more[i].has_level) {
+            assert(more[i].level == LOG_LEVEL_CRITICAL);
+        }
+    }
+
+    // Long line: its newline lies several blocks after the prefix
+    memset(buf, 'x', sizeof(buf));
+    memcpy(buf, "[fatal]", 7);
+    buf[200] = '\n';
+    memcpy(buf + 201, "[error]ok\n", 10);
+    count = line_scan(buf, 211, lines, 8, &consumed);
+    assert(count == 2);
+    assert(lines[0].has_level && lines[0].level == LOG_LEVEL_CRITICAL);
+    assert(lines[1].has_level && lines[1].level == LOG_LEVEL_ERROR);
+    assert(message_equals(buf, &lines[1], "ok"));
+
+    // The closing bracket lies in the block after the opening one
+    memset(buf, 'y', sizeof(buf));
+    buf[60] = '\n';
+    memcpy(buf + 61, "[debug] z\n", 10);
+    count = line_scan(buf, 71, lines, 8, &consumed);
+    assert(count == 2);
+    assert(lines[1].has_level && lines[1].level == LOG_LEVEL_DEBUG);
+    assert(message_equals(buf, &lines[1], "z"));
+}
+
+void test_line_scan(void) {
+    // Test the exact-token hash and the substring fallback
+    assert(log_entry_parse_level_len("ERROR", 5) == LOG_LEVEL_ERROR);
+    assert(log_entry_parse_level_len("Warning", 7) == LOG_LEVEL_WARNING);
+    assert(log_entry_parse_level_len("dbg", 3) == LOG_LEVEL_DEBUG);
+    assert(log_entry_parse_level_len("CRIT", 4) == LOG_LEVEL_CRITICAL);
+    assert(log_entry_parse_level_len("fatal", 5) == LOG_LEVEL_CRITICAL);
+    assert(log_entry_parse_level_len("err", 3) == LOG_LEVEL_ERROR);
+    assert(log_entry_parse_level_len("E_ERROR", 7) == LOG_LEVEL_ERROR);
+    assert(log_entry_parse_level_len("warn:db", 7) == LOG_LEVEL_WARNING);
+    assert(log_entry_parse_level_len("trace", 5) == LOG_LEVEL_INFO);
+    assert(log_entry_parse_level_len("", 0) == LOG_LEVEL_INFO);
+
+    // Test every block classifier this CPU supports
+    int tested = 0;
+    for (size_t i = 0; i < sizeof(IMPL_NAMES) / sizeof(IMPL_NAMES[0]); i++) {
+        if (line_scan_force(IMPL_NAMES[i]) != 0) {
+            continue;
+        }
+        assert(strcmp(line_scan_impl(), IMPL_NAMES[i]) == 0);
+        check_framing();
+        tested++;
+    }
+    assert(tested >= 1);
+    assert(line_scan_force("neon-or-whatever") == -1);
+    assert(line_scan_force(NULL) == 0);
+
+    // Test entries built from framed lines
+    const char* text = "[ERROR] disk full\nplain line\n";
+    line_span_t lines[2];
+    size_t consumed;
+    assert(line_scan(text, strlen(text), lines, 2, &consumed) == 2);
+
+    log_entry_t* entry = line_parser_create_entry_span(NULL, NULL, NULL, "app.log", text, &lines[0]);
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(strcmp(entry->message, "disk full") == 0);
+    assert(strcmp(entry->raw_line, "[ERROR] disk full") == 0);
+    log_entry_destroy(entry);
+
+    entry = line_parser_create_entry_span(NULL, NULL, NULL, "app.log", text, &lines[1]);
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_INFO);
+    assert(strcmp(entry->message, "plain line") == 0);
+    log_entry_destroy(entry);
+}
\ No newline at end of file
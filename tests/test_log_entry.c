@@ -1,4 +1,5 @@
 #include "../include/log_entry.h"
+#include "../include/field_rule.h"
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
@@ -22,6 +23,9 @@ void test_log_entry(void) {
     assert(log_entry_parse_level("CRITICAL") == LOG_LEVEL_CRITICAL);
     assert(log_entry_parse_level("debug") == LOG_LEVEL_DEBUG); // Case insensitive
     assert(log_entry_parse_level("unknown") == LOG_LEVEL_INFO); // Default
+    assert(log_entry_parse_level("E_ERROR") == LOG_LEVEL_ERROR); // Substring fallback
+    assert(log_entry_parse_level("terrible") == LOG_LEVEL_ERROR);
+    assert(log_entry_parse_level("something_longer_error") == LOG_LEVEL_INFO); // Past byte 15
     
     // Test level to string
     assert(strcmp(log_entry_level_to_string(LOG_LEVEL_DEBUG), "DEBUG") == 0);
@@ -37,6 +41,63 @@ void test_log_entry(void) {
     null_entry = log_entry_create("src", NULL, LOG_LEVEL_INFO, "raw");
     assert(null_entry == NULL);
     
+    // Test lazy field extraction
+    log_entry_t* fields = log_entry_create("api.log",
+        "request done status=503 latency_ms=1250ms path=\"/api/v1 users\" {\"user\": \"bob\"}",
+        LOG_LEVEL_ERROR, "raw");
+    assert(fields != NULL);
+    assert(fields->num_fields == 0); // Nothing tokenized until asked
+    
+    const char* value;
+    size_t length;
+    assert(log_entry_get_field(fields, "status", &value, &length));
+    assert(length == 3 && strncmp(value, "503", 3) == 0);
+    assert(fields->num_fields == 1);
+    assert(log_entry_get_field(fields, "path", &value, &length));
+    assert(length == 13 && strncmp(value, "/api/v1 users", 13) == 0);
+    assert(log_entry_get_field(fields, "user", &value, &length));
+    assert(length == 3 && strncmp(value, "bob", 3) == 0);
+    assert(!log_entry_get_field(fields, "missing", &value, &length));
+    assert(!log_entry_get_field(fields, "atus", &value, &length)); // Not a key boundary
+    
+    double number;
+    assert(log_entry_get_field_number(fields, "latency_ms", &number));
+    assert(number == 1250.0);
+    
+    // Repeated lookups are served from the slot table
+    unsigned int slots = fields->num_fields;
+    assert(log_entry_get_field(fields, "status", &value, &length));
+    assert(!log_entry_get_field(fields, "missing", &value, &length));
+    assert(fields->num_fields == slots);
+    
+    // Test field rules
+    field_rule_t rule;
+    assert(field_rule_parse(&rule, "status>=500") == 0);
+    assert(rule.op == FIELD_OP_GE && rule.numeric);
+    assert(field_rule_matches(&rule, fields));
+    field_rule_destroy(&rule);
+    
+    assert(field_rule_parse(&rule, "latency_ms<1000") == 0);
+    assert(!field_rule_matches(&rule, fields));
+    field_rule_destroy(&rule);
+    
+    assert(field_rule_parse(&rule, "user==bob") == 0);
+    assert(field_rule_matches(&rule, fields));
+    field_rule_destroy(&rule);
+    
+    assert(field_rule_parse(&rule, "path~/api/") == 0);
+    assert(field_rule_matches(&rule, fields));
+    field_rule_destroy(&rule);
+    
+    assert(field_rule_parse(&rule, "missing") == 0);
+    assert(rule.op == FIELD_OP_EXISTS);
+    assert(!field_rule_matches(&rule, fields));
+    field_rule_destroy(&rule);
+    
+    assert(field_rule_parse(&rule, ">=500") == -1);
+    assert(field_rule_parse(&rule, "status>=") == -1);
+    log_entry_destroy(fields);
+    
     // Test destruction
     log_entry_destroy(entry);
     log_entry_destroy(NULL); // Should handle NULL gracefully
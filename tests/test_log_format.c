@@ -0,0 +1,158 @@
+#include "../include/log_format.h"
+#include "../include/line_parser.h"
+#include "../include/log_entry.h"
+#include "../include/config.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static int span_equals(const format_span_t* span, const char* expected) {
+    return span->start && span->length == strlen(expected) &&
+           memcmp(span->start, expected, span->length) == 0;
+}
+
+static int field_equals(log_entry_t* entry, const char* name, const char* expected) {
+    const char* value;
+    size_t length;
+    return log_entry_get_field(entry, name, &value, &length) &&
+           length == strlen(expected) && memcmp(value, expected, length) == 0;
+}
+
+void test_log_format(void) {
+    log_format_t format;
+    format_span_t spans[LOG_FORMAT_MAX_CAPTURES];
+
+    // Test compiling a custom format
+    assert(log_format_compile(&format, "app",
+                              "%{timestamp:ts} [%{word:level}] %{word:component}: %{rest:message}") == 0);
+    assert(format.num_captures == 4);
+    assert(format.level_capture == 1);
+    assert(format.message_capture == 3);
+
+    const char* line = "2024-03-01T12:00:00.123Z [ERROR] db: connection refused";
+    assert(log_format_match(&format, line, strlen(line), spans, NULL));
+    assert(span_equals(&spans[0], "2024-03-01T12:00:00.123Z"));
+    assert(span_equals(&spans[1], "ERROR"));
+    assert(span_equals(&spans[2], "db"));
+    assert(span_equals(&spans[3], "connection refused"));
+
+    // Blanks in the spec match runs of blanks; other literals must match exactly
+    const char* padded = "2024-03-01 12:00:00   [WARNING]  cache: miss";
+    assert(log_format_match(&format, padded, strlen(padded), spans, NULL));
+    assert(span_equals(&spans[0], "2024-03-01 12:00:00"));
+    assert(!log_format_match(&format, "[ERROR] db: x", 13, spans, NULL));
+    assert(!log_format_match(&format, "2024-03-01T12:00:00Z (ERROR) db: x", 34, spans, NULL));
+
+    log_entry_t* entry = log_format_create_entry(&format, "app.log", line, strlen(line));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(strcmp(entry->message, "connection refused") == 0);
+    assert(strcmp(entry->raw_line, line) == 0);
+    assert(field_equals(entry, "component", "db"));
+    assert(field_equals(entry, "ts", "2024-03-01T12:00:00.123Z"));
+    log_entry_destroy(entry);
+    log_format_destroy(&format);
+
+    // Test invalid specs
+    assert(log_format_compile(&format, "bad", "%{float:x}") == -1);
+    assert(log_format_compile(&format, "bad", "%{word:x") == -1);
+    assert(log_format_compile(&format, "bad", "%{data:a}%{int:b}") == -1);
+
+    // Test the combined access log built-in; level follows the HTTP status
+    assert(log_format_builtin(&format, "combined") == 0);
+    const char* access = "192.168.1.20 - alice [10/Oct/2000:13:55:36 -0700] "
+                         "\"GET /api/data?id=\\\"7\\\" HTTP/1.1\" 503 2326 \"-\" \"curl/8.0\"";
+    entry = log_format_create_entry(&format, "access.log", access, strlen(access));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(field_equals(entry, "client", "192.168.1.20"));
+    assert(field_equals(entry, "user", "alice"));
+    assert(field_equals(entry, "timestamp", "10/Oct/2000:13:55:36 -0700"));
+    assert(field_equals(entry, "request", "GET /api/data?id=\\\"7\\\" HTTP/1.1"));
+    assert(field_equals(entry, "agent", "curl/8.0"));
+    double status;
+    assert(log_entry_get_field_number(entry, "status", &status) && status == 503);
+    log_entry_destroy(entry);
+
+    const char* ipv6 = "::1 - - [10/Oct/2000:13:55:36 +0000] \"GET / HTTP/1.1\" 404 0 \"-\" \"-\"";
+    entry = log_format_create_entry(&format, "access.log", ipv6, strlen(ipv6));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_WARNING);
+    assert(field_equals(entry, "client", "::1"));
+    log_entry_destroy(entry);
+    log_format_destroy(&format);
+
+    // Test syslog built-ins; level follows the PRI severity
+    assert(log_format_builtin(&format, "rfc3164") == 0);
+    const char* syslog = "<34>Oct  1 22:14:15 mymachine su[230]: 'su root' failed for lonvick";
+    entry = log_format_create_entry(&format, "network:10.0.0.1:514", syslog, strlen(syslog));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_CRITICAL);
+    assert(strcmp(entry->message, "'su root' failed for lonvick") == 0);
+    assert(field_equals(entry, "host", "mymachine"));
+    assert(field_equals(entry, "program", "su[230]"));
+    log_entry_destroy(entry);
+    log_format_destroy(&format);
+
+    assert(log_format_builtin(&format, "rfc5424") == 0);
+    const char* rfc5424 = "<165>1 2003-10-11T22:14:15.003Z host.example.com evntslog - ID47 "
+                          "[exampleSDID@32473 iut=\"3\"] An application event";
+    entry = log_format_create_entry(&format, "network:10.0.0.1:514", rfc5424, strlen(rfc5424));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_INFO);
+    assert(field_equals(entry, "app", "evntslog"));
+    assert(field_equals(entry, "msgid", "ID47"));
+    log_entry_destroy(entry);
+    log_format_destroy(&format);
+
+    assert(log_format_builtin(&format, "no_such_format") == -1);
+
+    // Test per-source assignment through the line parser
+    config_t config;
+    config_init_defaults(&config);
+    char* format_names[] = {"kv"};
+    char* format_specs[] = {"%{word:level} %{rest:message}"};
+    char* globs[] = {"*access.log", "network:*"};
+    char* assigned[] = {"clf", "kv"};
+    config.log_format_names = format_names;
+    config.log_format_specs = format_specs;
+    config.num_log_formats = 1;
+    config.source_format_globs = globs;
+    config.source_format_names = assigned;
+    config.num_source_formats = 2;
+
+    line_parser_t parser;
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(line_parser_format_for(&parser, "logs/access.log") != NULL);
+    assert(strcmp(line_parser_format_for(&parser, "logs/access.log")->name, "clf") == 0);
+    assert(strcmp(line_parser_format_for(&parser, "network:1.2.3.4:99")->name, "kv") == 0);
+    assert(line_parser_format_for(&parser, "logs/app.log") == NULL);
+
+    entry = line_parser_create_entry(&parser, "network:1.2.3.4:99", "warning disk 91%", 16);
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_WARNING);
+    assert(strcmp(entry->message, "disk 91%") == 0);
+    log_entry_destroy(entry);
+
+    // Lines the assigned format does not describe fall back to [LEVEL] parsing
+    entry = line_parser_create_entry(&parser, "logs/access.log", "[ERROR] POST /api/data 500", 26);
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(strcmp(entry->message, "POST /api/data 500") == 0);
+    log_entry_destroy(entry);
+
+    line_parser_destroy(&parser);
+
+    // Unknown format names are a startup error
+    assigned[1] = "missing";
+    assert(line_parser_init(&parser, &config) == -1);
+
+    config.log_format_names = NULL;
+    config.log_format_specs = NULL;
+    config.num_log_formats = 0;
+    config.source_format_globs = NULL;
+    config.source_format_names = NULL;
+    config.num_source_formats = 0;
+    config_destroy(&config);
+}
\ No newline at end of file
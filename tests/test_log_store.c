@@ -0,0 +1,346 @@
+#include "../include/log_store.h"
+#include "../include/segment.h"
+#include "../include/config.h"
+#include "../include/processor.h"
+#include "../include/queue.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SEC 1000000000LL
+#define HOUR (3600 * SEC)
+#define DIR_NAME "test_store_dir"
+#define SEGMENT_PATH "test_segment.seg"
+
+// 2025-01-01 10:00:00 UTC
+static const int64_t BASE = 1735725600LL * SEC;
+
+static void remove_tree(const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        unlink(path);
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+            char child[512];
+            snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+            remove_tree(child);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static log_entry_t* make_entry(const char* source, log_level_t level, const char* line,
+                               int64_t timestamp) {
+    log_entry_t* entry = log_entry_create(source, line, level, line);
+    assert(entry != NULL);
+    entry->timestamp = timestamp;
+    return entry;
+}
+
+static void append(log_store_t* store, const char* source, log_level_t level, const char* line,
+                   int64_t timestamp) {
+    log_entry_t* entry = make_entry(source, level, line, timestamp);
+    log_store_append(store, entry);
+    log_entry_destroy(entry);
+}
+
+static bool line_is(segment_t* segment, size_t row, const char* expected) {
+    size_t length;
+    const char* line = segment_line(segment, row, &length);
+    return line && length == strlen(expected) && memcmp(line, expected, length) == 0;
+}
+
+static bool source_is(const segment_t* segment, size_t row, const char* expected) {
+    uint32_t id = segment_source_id(segment, row);
+    return segment->source_lengths[id] == strlen(expected) &&
+           memcmp(segment->source_names[id], expected, strlen(expected)) == 0;
+}
+
+static void test_segment_roundtrip(void) {
+    // Enough sources for two-byte IDs and enough bytes for several blocks
+    const size_t count = 5000;
+    segment_row_t* rows = (segment_row_t*)calloc(count, sizeof(segment_row_t));
+    char (*sources)[32] = calloc(count, 32);
+    char (*lines)[96] = calloc(count, 96);
+    assert(rows && sources && lines);
+    for (size_t i = 0; i < count; i++) {
+        snprintf(sources[i], 32, "host-%zu.log", i % 300);
+        snprintf(lines[i], 96, "2025-01-01 10:00:00 [INFO] request %zu served in %zu ms", i,
+                 i * 7 % 1000);
+        rows[i].timestamp = BASE + (int64_t)(i / 3) * 1000;
+        rows[i].source = sources[i];
+        rows[i].source_len = (uint32_t)strlen(sources[i]);
+        rows[i].line = lines[i];
+        rows[i].line_len = (uint32_t)strlen(lines[i]);
+        rows[i].level = (log_level_t)(i % 5);
+    }
+    uint64_t bytes = 0;
+    assert(segment_write(SEGMENT_PATH, 42, rows, count, &bytes) == 0);
+    assert(access(SEGMENT_PATH ".tmp", F_OK) != 0);
+
+    segment_t segment;
+    assert(segment_open(&segment, SEGMENT_PATH) == 0);
+    assert(segment.id == 42 && segment.num_rows == count && segment.size == bytes);
+    assert(segment.num_sources == 300 && segment.source_width == 2);
+    assert(segment.num_blocks > 1);
+    assert(segment.min_time == BASE && segment.max_time == rows[count - 1].timestamp);
+    const int64_t* timestamps = segment_timestamps(&segment);
+    assert(timestamps != NULL);
+    uint64_t raw_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        assert(timestamps[i] == rows[i].timestamp);
+        assert(segment.levels[i] == i % 5);
+        assert(source_is(&segment, i, sources[i]));
+        assert(line_is(&segment, i, lines[i]));
+        raw_bytes += rows[i].line_len;
+    }
+    assert(segment.raw_bytes == raw_bytes);
+    // Random access across blocks
+    assert(line_is(&segment, 4999, lines[4999]) && line_is(&segment, 0, lines[0]));
+#ifdef HAVE_ZLIB
+    assert(bytes < raw_bytes / 2);
+#endif
+    segment_close(&segment);
+
+    // Rows must come sorted; a truncated file does not open
+    rows[1].timestamp = BASE - 1;
+    assert(segment_write("test_unsorted.seg", 1, rows, count, NULL) != 0);
+    assert(access("test_unsorted.seg", F_OK) != 0);
+    assert(truncate(SEGMENT_PATH, (off_t)(bytes / 2)) == 0);
+    assert(segment_open(&segment, SEGMENT_PATH) != 0);
+    remove(SEGMENT_PATH);
+
+    free(lines);
+    free(sources);
+    free(rows);
+}
+
+static void test_segment_edges(void) {
+    // One line longer than a block, an empty line and a single source
+    size_t long_len = SEGMENT_BLOCK_SIZE * 2;
+    char* long_line = (char*)malloc(long_len);
+    assert(long_line != NULL);
+    for (size_t i = 0; i < long_len; i++) {
+        long_line[i] = (char)('a' + i % 26);
+    }
+    segment_row_t rows[3] = {
+        {BASE, "a.log", "first", 5, 5, LOG_LEVEL_ERROR},
+        {BASE, "a.log", long_line, 5, (uint32_t)long_len, LOG_LEVEL_INFO},
+        {BASE + SEC, "a.log", "", 5, 0, LOG_LEVEL_DEBUG},
+    };
+    assert(segment_write(SEGMENT_PATH, 7, rows, 3, NULL) == 0);
+    segment_t segment;
+    assert(segment_open(&segment, SEGMENT_PATH) == 0);
+    assert(segment.num_sources == 1 && segment.source_width == 1);
+    assert(line_is(&segment, 0, "first") && line_is(&segment, 2, ""));
+    size_t length;
+    const char* line = segment_line(&segment, 1, &length);
+    assert(line && length == long_len && memcmp(line, long_line, long_len) == 0);
+    assert(segment_line(&segment, 3, &length) == NULL);
+    segment_close(&segment);
+    remove(SEGMENT_PATH);
+    free(long_line);
+}
+
+static config_t store_config(void) {
+    config_t config;
+    config_init_defaults(&config);
+    config.store_dir = strdup(DIR_NAME);
+    config.store_memtable_size = 1 << 20;
+    return config;
+}
+
+typedef struct {
+    log_store_t* store;
+    int thread;
+} appender_t;
+
+static void* append_thread(void* arg) {
+    appender_t* appender = (appender_t*)arg;
+    for (int i = 0; i < 1000; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "thread %d line %d", appender->thread, i);
+        // Half of the lines fall into the next hour
+        int64_t timestamp = BASE + (int64_t)i * (HOUR / 500) + appender->thread;
+        append(appender->store, appender->thread ? "b.log" : "a.log", LOG_LEVEL_INFO, line,
+               timestamp);
+    }
+    return NULL;
+}
+
+static void test_store_flush(void) {
+    remove_tree(DIR_NAME);
+    config_t config = store_config();
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 0);
+
+    // Threads append to their own memtables; a flush merges them by time
+    pthread_t threads[2];
+    appender_t appenders[2] = {{&store, 0}, {&store, 1}};
+    for (int t = 0; t < 2; t++) {
+        assert(pthread_create(&threads[t], NULL, append_thread, &appenders[t]) == 0);
+    }
+    for (int t = 0; t < 2; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    assert(log_store_flush(&store) == 0);
+
+    log_store_segment_t segments[4];
+    assert(log_store_segments(&store, segments, 4) == 2);
+    assert(segments[0].id == 1 && segments[1].id == 2);
+    assert(segments[0].partition == BASE && segments[1].partition == BASE + HOUR);
+    assert(segments[0].rows == 1000 && segments[1].rows == 1000);
+    assert(strcmp(segments[0].name, "20250101-100000/0000000001.seg") == 0);
+    assert(strcmp(segments[1].name, "20250101-110000/0000000002.seg") == 0);
+
+    segment_t segment;
+    assert(segment_open(&segment, DIR_NAME "/20250101-100000/0000000001.seg") == 0);
+    assert(segment.num_sources == 2);
+    const int64_t* timestamps = segment_timestamps(&segment);
+    for (size_t row = 1; row < segment.num_rows; row++) {
+        assert(timestamps[row] >= timestamps[row - 1]);
+    }
+    assert(timestamps[0] == BASE && source_is(&segment, 0, "a.log"));
+    assert(line_is(&segment, 0, "thread 0 line 0"));
+    assert(timestamps[1] == BASE + 1 && source_is(&segment, 1, "b.log"));
+    assert(line_is(&segment, 1, "thread 1 line 0"));
+    segment_close(&segment);
+
+    // Nothing pending: no segment
+    assert(log_store_flush(&store) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 2);
+    assert(metrics_get(store.rows) >= 2000);
+    log_store_stop(&store);
+    log_store_destroy(&store);
+
+    // A restart loads the catalogue, removes interrupted writes and
+    // continues the IDs
+    FILE* file = fopen(DIR_NAME "/20250101-100000/0000000003.seg.tmp", "w");
+    assert(file != NULL);
+    fclose(file);
+    assert(log_store_init(&store, &config) == 0);
+    assert(access(DIR_NAME "/20250101-100000/0000000003.seg.tmp", F_OK) != 0);
+    assert(log_store_segments(&store, segments, 4) == 2);
+    assert(segments[1].min_time == BASE + HOUR && segments[1].rows == 1000);
+    append(&store, "a.log", LOG_LEVEL_ERROR, "after restart", BASE);
+    log_store_stop(&store);
+    assert(log_store_segments(&store, segments, 4) == 3 && segments[2].id == 3);
+    assert(strcmp(segments[2].name, "20250101-100000/0000000003.seg") == 0);
+    log_store_destroy(&store);
+
+    config_destroy(&config);
+    remove_tree(DIR_NAME);
+}
+
+static void test_store_thread(void) {
+    remove_tree(DIR_NAME);
+    config_t config = store_config();
+    config.store_memtable_size = 65536;
+    config.store_flush_ms = 60000;
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+    assert(log_store_start(&store) == 0);
+
+    // Filling the memtable wakes the flush thread long before its interval
+    char line[200];
+    memset(line, 'x', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    for (int i = 0; i < 1000; i++) {
+        append(&store, "a.log", LOG_LEVEL_INFO, line, BASE + i);
+    }
+    for (int i = 0; i < 200 && log_store_segments(&store, NULL, 0) == 0; i++) {
+        usleep(10000);
+    }
+    assert(log_store_segments(&store, NULL, 0) >= 1);
+    log_store_stop(&store);
+
+    log_store_segment_t segments[16];
+    size_t count = log_store_segments(&store, segments, 16);
+    uint64_t rows = 0;
+    for (size_t i = 0; i < count && i < 16; i++) {
+        rows += segments[i].rows;
+    }
+    assert(rows + metrics_get(store.dropped) >= 1000);
+    log_store_destroy(&store);
+    config_destroy(&config);
+    remove_tree(DIR_NAME);
+}
+
+static void test_store_processor(void) {
+    remove_tree(DIR_NAME);
+    FILE* file = fopen("test_store_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "store_dir=" DIR_NAME "\n");
+    fprintf(file, "store_memtable_size=131072\n");
+    fprintf(file, "store_flush_ms=250\n");
+    fprintf(file, "store_partition=86400\n");
+    fprintf(file, "processor_mode=queue\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_store_config.txt") == 0);
+    assert(strcmp(config.store_dir, DIR_NAME) == 0);
+    assert(config.store_memtable_size == 131072 && config.store_flush_ms == 250);
+    assert(config.store_partition == 86400);
+
+    log_queue_t input;
+    log_queue_t output;
+    assert(queue_init(&input, 16) == 0 && queue_init(&output, 16) == 0);
+    processor_t processor;
+    assert(processor_init(&processor, &input, &output, &config) == 0);
+    assert(processor.store != NULL);
+
+    // Every line is stored, alerting or not; stopping flushes
+    processor_handle_entry(&processor, make_entry("app.log", LOG_LEVEL_INFO, "started", BASE));
+    processor_handle_entry(&processor,
+                           make_entry("app.log", LOG_LEVEL_ERROR, "crashed", BASE + SEC));
+    assert(queue_size(&output) == 1);
+    processor_stop(&processor);
+    log_store_segment_t segments[2];
+    assert(log_store_segments(processor.store, segments, 2) == 1);
+    assert(segments[0].rows == 2 && strncmp(segments[0].name, "20250101-000000/", 16) == 0);
+
+    char path[256];
+    snprintf(path, sizeof(path), DIR_NAME "/%s", segments[0].name);
+    segment_t segment;
+    assert(segment_open(&segment, path) == 0);
+    assert(line_is(&segment, 0, "started") && line_is(&segment, 1, "crashed"));
+    assert(segment.levels[0] == LOG_LEVEL_INFO && segment.levels[1] == LOG_LEVEL_ERROR);
+    segment_close(&segment);
+
+    processor_destroy(&processor);
+    queue_destroy(&output);
+    queue_destroy(&input);
+    config_destroy(&config);
+
+    file = fopen("test_store_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "store_memtable_size=100\n");
+    fprintf(file, "store_flush_ms=0\n");
+    fprintf(file, "store_partition=-5\n");
+    fclose(file);
+    assert(config_load(&config, "test_store_config.txt") == 0);
+    assert(config.store_dir == NULL && config.store_memtable_size == 8 * 1024 * 1024);
+    assert(config.store_flush_ms == 5000 && config.store_partition == 3600);
+    config_destroy(&config);
+    remove("test_store_config.txt");
+    remove_tree(DIR_NAME);
+}
+
+void test_log_store(void) {
+    test_segment_roundtrip();
+    test_segment_edges();
+    test_store_flush();
+    test_store_thread();
+    test_store_processor();
+}
\ No newline at end of file
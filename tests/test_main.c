@@ -6,6 +6,31 @@
 extern void test_log_entry(void);
 extern void test_queue(void);
 extern void test_config(void);
+extern void test_rule_cache(void);
+extern void test_json_lines(void);
+extern void test_log_format(void);
+extern void test_timestamp(void);
+extern void test_line_scan(void);
+extern void test_pushdown(void);
+extern void test_work_pool(void);
+extern void test_shard_pool(void);
+extern void test_autoscaler(void);
+extern void test_alert_dedup(void);
+extern void test_timer_wheel(void);
+extern void test_rate_tracker(void);
+extern void test_correlator(void);
+extern void test_template_miner(void);
+extern void test_sketch(void);
+extern void test_context_ring(void);
+extern void test_log_store(void);
+extern void test_token_index(void);
+extern void test_query(void);
+extern void test_query_cache(void);
+extern void test_compactor(void);
+extern void test_alert_writer(void);
+extern void test_alert_encoder(void);
+extern void test_alert_sink(void);
+extern void test_file_rotator(void);
 
 int main(void) {
     printf("Running Log Aggregator Tests...\n\n");
@@ -22,6 +47,106 @@ int main(void) {
     test_config();
     printf("✓ config tests passed\n\n");
     
+    printf("Testing rule_cache...\n");
+    test_rule_cache();
+    printf("✓ rule_cache tests passed\n\n");
+    
+    printf("Testing json_lines...\n");
+    test_json_lines();
+    printf("✓ json_lines tests passed\n\n");
+    
+    printf("Testing log_format...\n");
+    test_log_format();
+    printf("✓ log_format tests passed\n\n");
+    
+    printf("Testing timestamp...\n");
+    test_timestamp();
+    printf("✓ timestamp tests passed\n\n");
+    
+    printf("Testing line_scan...\n");
+    test_line_scan();
+    printf("✓ line_scan tests passed\n\n");
+    
+    printf("Testing pushdown...\n");
+    test_pushdown();
+    printf("✓ pushdown tests passed\n\n");
+    
+    printf("Testing work_pool...\n");
+    test_work_pool();
+    printf("✓ work_pool tests passed\n\n");
+    
+    printf("Testing shard_pool...\n");
+    test_shard_pool();
+    printf("✓ shard_pool tests passed\n\n");
+    
+    printf("Testing autoscaler...\n");
+    test_autoscaler();
+    printf("✓ autoscaler tests passed\n\n");
+    
+    printf("Testing alert_dedup...\n");
+    test_alert_dedup();
+    printf("✓ alert_dedup tests passed\n\n");
+    
+    printf("Testing timer_wheel...\n");
+    test_timer_wheel();
+    printf("✓ timer_wheel tests passed\n\n");
+    
+    printf("Testing rate_tracker...\n");
+    test_rate_tracker();
+    printf("✓ rate_tracker tests passed\n\n");
+    
+    printf("Testing correlator...\n");
+    test_correlator();
+    printf("✓ correlator tests passed\n\n");
+    
+    printf("Testing template_miner...\n");
+    test_template_miner();
+    printf("✓ template_miner tests passed\n\n");
+    
+    printf("Testing sketch...\n");
+    test_sketch();
+    printf("✓ sketch tests passed\n\n");
+    
+    printf("Testing context_ring...\n");
+    test_context_ring();
+    printf("✓ context_ring tests passed\n\n");
+    
+    printf("Testing log_store...\n");
+    test_log_store();
+    printf("✓ log_store tests passed\n\n");
+
+    printf("Testing token_index...\n");
+    test_token_index();
+    printf("✓ token_index tests passed\n\n");
+
+    printf("Testing query...\n");
+    test_query();
+    printf("✓ query tests passed\n\n");
+    
+    printf("Testing query_cache...\n");
+    test_query_cache();
+    printf("✓ query_cache tests passed\n\n");
+    
+    printf("Testing compactor...\n");
+    test_compactor();
+    printf("✓ compactor tests passed\n\n");
+    
+    printf("Testing alert_writer...\n");
+    test_alert_writer();
+    printf("✓ alert_writer tests passed\n\n");
+    
+    printf("Testing alert_encoder...\n");
+    test_alert_encoder();
+    printf("✓ alert_encoder tests passed\n\n");
+    
+    printf("Testing alert_sink...\n");
+    test_alert_sink();
+    printf("✓ alert_sink tests passed\n\n");
+    
+    printf("Testing file_rotator...\n");
+    test_file_rotator();
+    printf("✓ file_rotator tests passed\n\n");
+    
     printf("All tests passed!\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "../include/pushdown.h"
+#include "../include/line_parser.h"
+#include "../include/line_scan.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Frame text and count the entries that survive the source's prefilters
+static size_t ingest(const line_parser_t* parser, const char* source, const char* text) {
+    const log_format_t* format = line_parser_format_for(parser, source);
+    pushdown_source_t filter;
+    line_parser_source_filter(parser, &filter, source, format);
+
+    line_span_t lines[16];
+    size_t consumed;
+    size_t count = line_scan(text, strlen(text), lines, 16, &consumed);
+    size_t created = 0;
+    for (size_t i = 0; i < count; i++) {
+        log_entry_t* entry = line_parser_create_entry_span(parser, format, &filter, source,
+                                                           text, &lines[i]);
+        if (entry) {
+            created++;
+            log_entry_destroy(entry);
+        }
+    }
+    return created;
+}
+
+static uint64_t counter(const char* name) {
+    return metrics_get(metrics_register(name, METRIC_COUNTER));
+}
+
+void test_pushdown(void) {
+    config_t config;
+    config_init_defaults(&config);
+    config.alert_threshold = LOG_LEVEL_WARNING;
+    config.json_lines = true;
+
+    char* includes[] = {"logs/*", "network:*"};
+    char* excludes[] = {"logs/debug*.log"};
+    config.source_include_globs = includes;
+    config.num_source_includes = 2;
+    config.source_exclude_globs = excludes;
+    config.num_source_excludes = 1;
+
+    line_parser_t parser;
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(parser.pushdown.min_level == LOG_LEVEL_WARNING);
+    assert(parser.pushdown.num_literals == 0);
+
+    uint64_t level_before = counter("pushdown.level_dropped");
+    uint64_t source_before = counter("pushdown.source_dropped");
+
+    // Test the level threshold on prefixed, timestamped and JSON lines
+    const char* text = "[DEBUG] a\n[INFO] b\n[WARNING] c\n[ERROR] d\n"
+                       "2024-03-01T12:00:00Z [INFO] e\n2024-03-01T12:00:00Z [CRITICAL] f\n"
+                       "{\"level\":\"debug\",\"msg\":\"g\"}\n{\"level\":\"error\",\"msg\":\"h\"}\n"
+                       "no level at all\n";
+    assert(ingest(&parser, "logs/app.log", text) == 4);
+    assert(counter("pushdown.level_dropped") - level_before == 5);
+    assert(counter("source.logs/app.log.dropped") == 5);
+
+    // Test include and exclude globs; excluded sources create nothing
+    assert(ingest(&parser, "logs/debug-worker.log", "[ERROR] x\n[CRITICAL] y\n") == 0);
+    assert(ingest(&parser, "other/app.log", "[ERROR] x\n") == 0);
+    assert(counter("pushdown.source_dropped") - source_before == 3);
+    assert(counter("source.logs/debug-worker.log.dropped") == 2);
+
+    // Network drops are counted per client, not per connection
+    assert(ingest(&parser, "network:10.1.2.3:40001", "[INFO] x\n") == 0);
+    assert(ingest(&parser, "network:10.1.2.3:40002", "[DEBUG] y\n[ERROR] z\n") == 1);
+    assert(counter("source.network:10.1.2.3.dropped") == 2);
+
+    // Unfiltered parsing is unchanged
+    log_entry_t* entry = line_parser_create_entry(&parser, "other/app.log", "[DEBUG] kept", 12);
+    assert(entry != NULL);
+    log_entry_destroy(entry);
+    line_parser_destroy(&parser);
+
+    // Test the literal prefilter derived from alert rules
+    config.source_include_globs = NULL;
+    config.num_source_includes = 0;
+    config.source_exclude_globs = NULL;
+    config.num_source_excludes = 0;
+    config.field_rules = (field_rule_t*)calloc(3, sizeof(field_rule_t));
+    assert(field_rule_parse(&config.field_rules[0], "status>=500") == 0);
+    assert(field_rule_parse(&config.field_rules[1], "latency_ms>1000") == 0);
+    assert(field_rule_parse(&config.field_rules[2], "status==503") == 0);
+    config.num_field_rules = 3;
+
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(parser.pushdown.num_literals == 2);
+
+    uint64_t literal_before = counter("pushdown.literal_dropped");
+    text = "[ERROR] request failed status=502\n[ERROR] slow latency_ms=1500\n"
+           "[ERROR] disk full\n{\"level\":\"error\",\"status\":500}\n";
+    assert(ingest(&parser, "logs/api.log", text) == 3);
+    assert(counter("pushdown.literal_dropped") - literal_before == 1);
+    line_parser_destroy(&parser);
+
+    // Sources with an assigned format name fields after captures: no literals
+    char* format_names[] = {"kv"};
+    char* format_specs[] = {"%{word:level} %{int:status} %{rest:message}"};
+    char* globs[] = {"*access.log"};
+    char* assigned[] = {"kv"};
+    config.log_format_names = format_names;
+    config.log_format_specs = format_specs;
+    config.num_log_formats = 1;
+    config.source_format_globs = globs;
+    config.source_format_names = assigned;
+    config.num_source_formats = 1;
+
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(ingest(&parser, "logs/access.log", "error 503 upstream timeout\ninfo 200 ok\n") == 1);
+    line_parser_destroy(&parser);
+
+    config.log_format_names = NULL;
+    config.log_format_specs = NULL;
+    config.num_log_formats = 0;
+    config.source_format_globs = NULL;
+    config.source_format_names = NULL;
+    config.num_source_formats = 0;
+
+    // Rate rules add their field selectors as literals and lower the level
+    config.rate_rules = (rate_rule_t*)calloc(2, sizeof(rate_rule_t));
+    assert(rate_rule_parse(&config.rate_rules[0], "100 retries>3 in 60s") == 0);
+    config.num_rate_rules = 1;
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(parser.pushdown.num_literals == 3);
+    assert(parser.pushdown.min_level == LOG_LEVEL_DEBUG);
+    assert(ingest(&parser, "logs/api.log", "[INFO] retries=5\n[INFO] disk full\n") == 1);
+    line_parser_destroy(&parser);
+
+    // A rate rule without a field can match any line: no literal prefilter
+    assert(rate_rule_parse(&config.rate_rules[1], "5 INFO timeout in 10s") == 0);
+    config.num_rate_rules = 2;
+    config.rate_rules[0].selector.min_level = LOG_LEVEL_ERROR;
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(parser.pushdown.num_literals == 0);
+    assert(parser.pushdown.min_level == LOG_LEVEL_INFO);
+    assert(ingest(&parser, "logs/api.log", "[DEBUG] timeout\n[INFO] timeout\n") == 1);
+    line_parser_destroy(&parser);
+
+    // Sketches count every line: only the source globs remain
+    config.sketches = true;
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(parser.pushdown.num_literals == 0);
+    assert(parser.pushdown.min_level == LOG_LEVEL_DEBUG);
+    assert(ingest(&parser, "logs/api.log", "[DEBUG] timeout\n[INFO] disk full\n") == 2);
+    line_parser_destroy(&parser);
+
+    // So does template mining
+    config.sketches = false;
+    config.template_mining = true;
+    assert(line_parser_init(&parser, &config) == 0);
+    assert(parser.pushdown.min_level == LOG_LEVEL_DEBUG);
+    assert(ingest(&parser, "logs/api.log", "[DEBUG] timeout\n[INFO] disk full\n") == 2);
+    line_parser_destroy(&parser);
+    config_destroy(&config);
+
+    // Test config keys
+    FILE* file = fopen("test_pushdown_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "source_include0=/var/log/*\n");
+    fprintf(file, "source_exclude0=*/debug.log\n");
+    fprintf(file, "source_exclude1=network:10.0.0.*\n");
+    fclose(file);
+    assert(config_load(&config, "test_pushdown_config.txt") == 0);
+    assert(config.num_source_includes == 1);
+    assert(strcmp(config.source_include_globs[0], "/var/log/*") == 0);
+    assert(config.num_source_excludes == 2);
+    assert(strcmp(config.source_exclude_globs[1], "network:10.0.0.*") == 0);
+    config_destroy(&config);
+    remove("test_pushdown_config.txt");
+}
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "../include/query.h"
+#include "../include/query_server.h"
+#include "../include/log_store.h"
+#include "../include/config.h"
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEC 1000000000LL
+#define DIR_NAME "test_query_dir"
+#define SOCKET_PATH "test_query.sock"
+#define ROWS 600
+
+// 2025-01-01 10:00:00 UTC
+static const int64_t BASE = 1735725600LL * SEC;
+
+static void remove_tree(const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        unlink(path);
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+            char child[512];
+            snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+            remove_tree(child);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+// Row i: 12 s apart (two hourly segments), three sources, every tenth an error
+static log_level_t row_level(int i) {
+    if (i % 50 == 0) {
+        return LOG_LEVEL_CRITICAL;
+    }
+    if (i % 10 == 0) {
+        return LOG_LEVEL_ERROR;
+    }
+    return i % 2 ? LOG_LEVEL_INFO : LOG_LEVEL_DEBUG;
+}
+
+static const char* row_source(int i) {
+    static const char* const SOURCES[] = {"web-1.log", "web-2.log", "db.log"};
+    return SOURCES[i % 3];
+}
+
+static void row_line(int i, char* line, size_t size) {
+    if (i % 10 == 0) {
+        snprintf(line, size, "request %d failed: upstream timeout", i);
+    } else {
+        snprintf(line, size, "request %d served for bob", i);
+    }
+}
+
+static void fill_store(void) {
+    remove_tree(DIR_NAME);
+    config_t config;
+    config_init_defaults(&config);
+    config.store_dir = strdup(DIR_NAME);
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+    for (int i = ROWS - 1; i >= 0; i--) {
+        char line[96];
+        row_line(i, line, sizeof(line));
+        log_entry_t* entry = log_entry_create(row_source(i), line, row_level(i), line);
+        assert(entry != NULL);
+        entry->timestamp = BASE + (int64_t)i * 12 * SEC;
+        log_store_append(&store, entry);
+        log_entry_destroy(entry);
+    }
+    assert(log_store_flush(&store) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 2);
+    log_store_destroy(&store);
+    config_destroy(&config);
+}
+
+// Run terms (NULL-terminated) and return the result
+static query_result_t run(query_engine_t* engine, const char* const* terms) {
+    query_t query;
+    query_init(&query);
+    for (size_t i = 0; terms[i]; i++) {
+        assert(query_parse_term(&query, terms[i]) == 0);
+    }
+    query_result_t result;
+    assert(query_run(engine, &query, &result) == 0);
+    query_destroy(&query);
+    return result;
+}
+
+static uint64_t count_of(query_engine_t* engine, const char* const* terms) {
+    query_result_t result = run(engine, terms);
+    uint64_t matched = result.matched;
+    query_result_destroy(&result);
+    return matched;
+}
+
+static void test_parse(void) {
+    query_t query;
+    query_init(&query);
+    assert(query.limit == QUERY_DEFAULT_LIMIT && query.mode == QUERY_LINES);
+    assert(query_parse_term(&query, "from=2025-01-01T10:30:00Z") == 0);
+    assert(query.from == BASE + 1800 * SEC);
+    assert(query_parse_term(&query, "to=-1h") == 0 && query.to > BASE);
+    assert(query_parse_term(&query, "level=error,CRITICAL") == 0);
+    assert(query.levels == ((1u << LOG_LEVEL_ERROR) | (1u << LOG_LEVEL_CRITICAL)));
+    assert(query_parse_term(&query, "level=info") == 0 && query.levels == 1u << LOG_LEVEL_INFO);
+    assert(query_parse_term(&query, "regex=^a+b") == 0);
+    assert(query_parse_term(&query, "regex=c$") == 0);
+    assert(query_parse_term(&query, "count=minute") == 0 && query.mode == QUERY_COUNT_MINUTE);
+    assert(query_parse_term(&query, "limit=0") == 0 && query.limit == 0);
+
+    assert(query_parse_term(&query, "bogus=1") == -1);
+    assert(query_parse_term(&query, "level=LOUD") == -1);
+    assert(query_parse_term(&query, "level=") == -1);
+    assert(query_parse_term(&query, "count=avg") == -1);
+    assert(query_parse_term(&query, "limit=-3") == -1);
+    assert(query_parse_term(&query, "regex=(") == -1);
+    assert(query_parse_term(&query, "from=yesterday") == -1);
+    assert(query_parse_term(&query, "source=") == -1);
+    assert(query_parse_term(&query, "contains") == -1);
+    query_destroy(&query);
+}
+
+static void test_counts(query_engine_t* engine) {
+    uint64_t errors = 0;
+    uint64_t second_hour = 0;
+    for (int i = 0; i < ROWS; i++) {
+        errors += row_level(i) >= LOG_LEVEL_ERROR;
+        second_hour += i >= 300;
+    }
+
+    const char* all[] = {"count=total", NULL};
+    query_result_t result = run(engine, all);
+    assert(result.matched == ROWS && result.segments_scanned == 2);
+    assert(result.rows_read == 0 && result.num_buckets == 0);
+    query_result_destroy(&result);
+
+    const char* severe[] = {"count=total", "level=ERROR,CRITICAL", NULL};
+    assert(count_of(engine, severe) == errors);
+
+    // The first hour's segment is pruned by its time range
+    const char* later[] = {"count=total", "from=2025-01-01T11:00:00Z", NULL};
+    result = run(engine, later);
+    assert(result.matched == second_hour);
+    assert(result.segments_scanned == 1 && result.segments_skipped == 1);
+    query_result_destroy(&result);
+
+    const char* by_source[] = {"count=source", "source=web-*", NULL};
+    result = run(engine, by_source);
+    assert(result.num_buckets == 2);
+    assert(strcmp(result.buckets[0].key, "web-1.log") == 0 && result.buckets[0].count == 200);
+    assert(strcmp(result.buckets[1].key, "web-2.log") == 0 && result.buckets[1].count == 200);
+    query_result_destroy(&result);
+
+    const char* by_level[] = {"count=level", NULL};
+    result = run(engine, by_level);
+    assert(result.num_buckets == 4);
+    assert(strcmp(result.buckets[0].key, "CRITICAL") == 0 && result.buckets[0].count == 12);
+    assert(strcmp(result.buckets[2].key, "ERROR") == 0 && result.buckets[2].count == 48);
+    query_result_destroy(&result);
+
+    const char* by_minute[] = {"count=minute", "from=2025-01-01T10:58:00Z",
+                               "to=2025-01-01T11:02:00Z", NULL};
+    result = run(engine, by_minute);
+    assert(result.num_buckets == 4 && result.matched == 20);
+    assert(strcmp(result.buckets[0].key, "2025-01-01T10:58Z") == 0);
+    assert(strcmp(result.buckets[3].key, "2025-01-01T11:01Z") == 0);
+    for (size_t i = 0; i < result.num_buckets; i++) {
+        assert(result.buckets[i].count == 5);
+    }
+    query_result_destroy(&result);
+
+    const char* nothing[] = {"count=source", "source=*.txt", NULL};
+    result = run(engine, nothing);
+    assert(result.matched == 0 && result.num_buckets == 0 && result.segments_skipped == 2);
+    query_result_destroy(&result);
+}
+
+static void test_lines(query_engine_t* engine) {
+    // The earliest matches over both segments, in time order
+    const char* first[] = {"word=timeout", "limit=5", NULL};
+    query_result_t result = run(engine, first);
+    assert(result.num_rows == 5);
+    for (size_t i = 0; i < result.num_rows; i++) {
+        char line[96];
+        row_line((int)i * 10, line, sizeof(line));
+        assert(strcmp(result.rows[i].line, line) == 0);
+        assert(strcmp(result.rows[i].source, row_source((int)i * 10)) == 0);
+        assert(result.rows[i].timestamp == BASE + (int64_t)i * 120 * SEC);
+    }
+    assert(result.rows[0].level == LOG_LEVEL_CRITICAL && result.rows[1].level == LOG_LEVEL_ERROR);
+    query_result_destroy(&result);
+
+    const char* every[] = {"word=upstream timeout", "limit=0", NULL};
+    result = run(engine, every);
+    assert(result.num_rows == ROWS / 10 && result.matched == ROWS / 10);
+    // Only the indexed candidates were read
+    assert(result.rows_read == ROWS / 10);
+    for (size_t i = 1; i < result.num_rows; i++) {
+        assert(result.rows[i].timestamp > result.rows[i - 1].timestamp);
+    }
+    query_result_destroy(&result);
+
+    const char* substring[] = {"contains=stream time", "count=total", NULL};
+    assert(count_of(engine, substring) == ROWS / 10);
+    const char* pattern[] = {"regex=request [0-9]*5 ", "count=total", NULL};
+    assert(count_of(engine, pattern) == ROWS / 10);
+    const char* partial[] = {"word=stream", "count=total", NULL};
+    assert(count_of(engine, partial) == 0);
+    const char* absent[] = {"word=kernel panic", NULL};
+    assert(count_of(engine, absent) == 0);
+
+    const char* combined[] = {"word=bob", "source=web-1.log", "level=INFO",
+                              "from=2025-01-01T10:00:12Z", "to=2025-01-01T10:02:00Z", NULL};
+    result = run(engine, combined);
+    // Rows 1 to 9: web-1.log is every third, INFO every odd one: 3 and 9
+    assert(result.num_rows == 2);
+    assert(strcmp(result.rows[0].line, "request 3 served for bob") == 0);
+    assert(strcmp(result.rows[1].line, "request 9 served for bob") == 0);
+    query_result_destroy(&result);
+
+    FILE* out = tmpfile();
+    assert(out != NULL);
+    query_t query;
+    query_init(&query);
+    assert(query_parse_term(&query, "limit=1") == 0);
+    result.num_rows = 0;
+    assert(query_run(engine, &query, &result) == 0);
+    assert(query_write(&query, &result, out) == 0);
+    rewind(out);
+    char line[256];
+    assert(fgets(line, sizeof(line), out) != NULL);
+    assert(strcmp(line, "2025-01-01T10:00:00.000Z CRITICAL web-1.log "
+                        "request 0 failed: upstream timeout\n") == 0);
+    assert(fgets(line, sizeof(line), out) != NULL && line[0] == '#');
+    fclose(out);
+    query_result_destroy(&result);
+    query_destroy(&query);
+}
+
+static void test_cache(query_engine_t* engine) {
+    query_t first;
+    query_t second;
+    query_init(&first);
+    query_init(&second);
+    assert(query_parse_term(&first, "level=ERROR,CRITICAL") == 0);
+    assert(query_parse_term(&first, "from=-1h") == 0);
+    assert(query_parse_term(&second, "level=CRITICAL,error") == 0);
+    char* text = query_normalize(&first);
+    char* other = query_normalize(&second);
+    assert(text && other && strcmp(text, other) == 0);
+    free(other);
+    // Every level is no level filter; the limit does not matter for counts
+    assert(query_parse_term(&second, "level=DEBUG,INFO,WARNING,ERROR,CRITICAL") == 0);
+    assert(query_parse_term(&first, "level=DEBUG,INFO,WARNING,ERROR,CRITICAL") == 0);
+    assert(query_parse_term(&first, "count=level") == 0);
+    assert(query_parse_term(&second, "count=level") == 0);
+    assert(query_parse_term(&second, "limit=7") == 0);
+    query_t plain;
+    query_init(&plain);
+    assert(query_parse_term(&plain, "count=level") == 0);
+    other = query_normalize(&plain);
+    char* limited = query_normalize(&second);
+    assert(other && limited && strcmp(other, limited) == 0 && strcmp(text, other) != 0);
+    free(limited);
+    free(other);
+    free(text);
+    query_destroy(&plain);
+    query_destroy(&second);
+    query_destroy(&first);
+
+    const char* by_source[] = {"count=source", "source=web-*", NULL};
+    query_result_t result = run(engine, by_source);
+    assert(result.segments_scanned == 2 && result.segments_cached == 0);
+    query_result_destroy(&result);
+    result = run(engine, by_source);
+    assert(result.segments_scanned == 0 && result.segments_cached == 2);
+    assert(result.num_buckets == 2 && result.buckets[1].count == 200);
+    query_result_destroy(&result);
+
+    const char* lines[] = {"word=timeout", "limit=5", NULL};
+    query_result_t scanned = run(engine, lines);
+    result = run(engine, lines);
+    assert(result.segments_cached == 2 && result.rows_read == 0);
+    assert(result.num_rows == 5 && scanned.num_rows == 5);
+    for (size_t i = 0; i < result.num_rows; i++) {
+        assert(strcmp(result.rows[i].line, scanned.rows[i].line) == 0);
+        assert(result.rows[i].timestamp == scanned.rows[i].timestamp);
+    }
+    query_result_destroy(&scanned);
+    query_result_destroy(&result);
+
+    // A range covering a whole segment shares its entry with no range
+    const char* all[] = {"count=total", NULL};
+    assert(count_of(engine, all) == ROWS);
+    const char* covering[] = {"count=total", "from=2025-01-01T09:00:00Z", NULL};
+    result = run(engine, covering);
+    assert(result.matched == ROWS && result.segments_cached == 2);
+    query_result_destroy(&result);
+    const char* cut[] = {"count=total", "from=2025-01-01T10:30:00Z", NULL};
+    result = run(engine, cut);
+    assert(result.matched == ROWS - 150);
+    assert(result.segments_scanned == 1 && result.segments_cached == 1);
+    query_result_destroy(&result);
+}
+
+static void test_server(query_engine_t* engine) {
+    query_server_t server;
+    assert(query_server_init(&server, SOCKET_PATH, engine) == 0);
+    assert(query_server_start(&server) == 0);
+
+    char* terms[] = {"level=ERROR", "count=total"};
+    FILE* out = tmpfile();
+    assert(out != NULL);
+    assert(query_server_request(SOCKET_PATH, terms, 2, out) == 0);
+    rewind(out);
+    char line[256];
+    assert(fgets(line, sizeof(line), out) != NULL && strcmp(line, "48\n") == 0);
+    assert(fgets(line, sizeof(line), out) != NULL && strncmp(line, "# 48 matched", 12) == 0);
+    fclose(out);
+
+    char* invalid[] = {"level=LOUD"};
+    out = tmpfile();
+    assert(query_server_request(SOCKET_PATH, invalid, 1, out) == 1);
+    rewind(out);
+    assert(fgets(line, sizeof(line), out) != NULL && strncmp(line, "# error:", 8) == 0);
+    fclose(out);
+
+    assert(query_server_request("no_such_query.sock", terms, 2, stdout) == -1);
+    query_server_destroy(&server);
+    assert(access(SOCKET_PATH, F_OK) != 0);
+}
+
+static void test_read_only(void) {
+    // A segment still being written by another process is left alone
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/20250101-100000/0000000099.seg.tmp", DIR_NAME);
+    FILE* file = fopen(tmp_path, "w");
+    assert(file != NULL);
+    fclose(file);
+
+    log_store_t store;
+    assert(log_store_open(&store, DIR_NAME) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 2);
+    assert(log_store_start(&store) == -1);
+    log_store_destroy(&store);
+    assert(access(tmp_path, F_OK) == 0);
+    assert(log_store_open(&store, "no_such_store_dir") == -1);
+}
+
+void test_query(void) {
+    test_parse();
+    fill_store();
+
+    log_store_t store;
+    assert(log_store_open(&store, DIR_NAME) == 0);
+    query_engine_t engine;
+    assert(query_engine_init(&engine, &store, 3, 0) == 0);
+    test_counts(&engine);
+    test_lines(&engine);
+    test_server(&engine);
+    query_engine_destroy(&engine);
+
+    // The calling thread alone gives the same answers
+    assert(query_engine_init(&engine, &store, 0, 0) == 0);
+    test_counts(&engine);
+    test_lines(&engine);
+    query_engine_destroy(&engine);
+
+    assert(query_engine_init(&engine, &store, 3, 1024 * 1024) == 0);
+    test_cache(&engine);
+    query_engine_destroy(&engine);
+    log_store_destroy(&store);
+
+    test_read_only();
+    remove_tree(DIR_NAME);
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "../include/query_cache.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUERY_TEXT "mode=2\nlimit=0\nlevel=0\n"
+
+// Result with one bucket holding count
+static query_result_t make_result(uint64_t count) {
+    query_result_t result;
+    memset(&result, 0, sizeof(result));
+    result.buckets = (query_bucket_t*)malloc(sizeof(query_bucket_t));
+    assert(result.buckets != NULL);
+    result.buckets[0].key = strdup("ERROR");
+    result.buckets[0].count = count;
+    result.num_buckets = 1;
+    result.matched = count;
+    result.segments_scanned = 1;
+    return result;
+}
+
+static void insert(query_cache_t* cache, uint64_t segment, uint64_t count) {
+    query_result_t result = make_result(count);
+    query_cache_insert(cache, QUERY_TEXT, strlen(QUERY_TEXT), segment, INT64_MIN, INT64_MAX,
+                       &result);
+    query_result_destroy(&result);
+}
+
+// Cached count of a segment, or 0 on a miss
+static uint64_t lookup(query_cache_t* cache, uint64_t segment) {
+    query_result_t result;
+    if (!query_cache_lookup(cache, QUERY_TEXT, strlen(QUERY_TEXT), segment, INT64_MIN,
+                            INT64_MAX, &result)) {
+        return 0;
+    }
+    assert(result.num_buckets == 1 && strcmp(result.buckets[0].key, "ERROR") == 0);
+    uint64_t count = result.buckets[0].count;
+    query_result_destroy(&result);
+    return count;
+}
+
+static void test_lookup(void) {
+    query_cache_t cache;
+    assert(query_cache_init(&cache, 0) == -1);
+    assert(query_cache_init(&cache, 1024 * 1024) == 0);
+
+    assert(lookup(&cache, 1) == 0);
+    insert(&cache, 1, 42);
+    assert(lookup(&cache, 1) == 42);
+    assert(lookup(&cache, 2) == 0);
+
+    // Every part of the key counts
+    query_result_t result;
+    assert(!query_cache_lookup(&cache, QUERY_TEXT, strlen(QUERY_TEXT) - 1, 1, INT64_MIN,
+                               INT64_MAX, &result));
+    assert(!query_cache_lookup(&cache, QUERY_TEXT, strlen(QUERY_TEXT), 1, 0, INT64_MAX,
+                               &result));
+
+    // Storing again replaces the entry
+    insert(&cache, 1, 43);
+    assert(lookup(&cache, 1) == 43);
+
+    // Many entries outgrow the initial buckets
+    for (uint64_t segment = 100; segment < 1100; segment++) {
+        insert(&cache, segment, segment);
+    }
+    for (uint64_t segment = 100; segment < 1100; segment++) {
+        assert(lookup(&cache, segment) == segment);
+    }
+
+    query_cache_stats_t stats;
+    query_cache_get_stats(&cache, &stats);
+    assert(stats.entries == 1001 && stats.evictions == 0 && stats.bytes > 0);
+    assert(stats.hits == 1002 && stats.misses == 4);
+
+    query_cache_clear(&cache);
+    query_cache_get_stats(&cache, &stats);
+    assert(stats.entries == 0 && stats.bytes == 0);
+    assert(lookup(&cache, 1) == 0);
+    query_cache_destroy(&cache);
+}
+
+static void test_eviction(void) {
+    // Room for a few entries only
+    query_cache_t cache;
+    assert(query_cache_init(&cache, 4 * 1024) == 0);
+    for (uint64_t segment = 1; segment <= 4; segment++) {
+        insert(&cache, segment, segment);
+    }
+    query_cache_stats_t stats;
+    query_cache_get_stats(&cache, &stats);
+    size_t per_entry = stats.bytes / stats.entries;
+    size_t room = cache.budget / per_entry;
+    assert(room >= 4);
+
+    // Segment 1 was used last, so 2 goes first
+    assert(lookup(&cache, 1) == 1);
+    for (uint64_t segment = 5; segment <= room + 1; segment++) {
+        insert(&cache, segment, segment);
+    }
+    query_cache_get_stats(&cache, &stats);
+    assert(stats.evictions == 1 && stats.bytes <= cache.budget);
+    assert(lookup(&cache, 1) == 1);
+    assert(lookup(&cache, 2) == 0);
+    assert(lookup(&cache, 3) == 3);
+
+    // A result larger than the whole budget is not kept
+    query_result_t large = make_result(7);
+    free(large.buckets[0].key);
+    large.buckets[0].key = (char*)malloc(8 * 1024);
+    assert(large.buckets[0].key != NULL);
+    memset(large.buckets[0].key, 'x', 8 * 1024 - 1);
+    large.buckets[0].key[8 * 1024 - 1] = '\0';
+    query_cache_insert(&cache, QUERY_TEXT, strlen(QUERY_TEXT), 99, INT64_MIN, INT64_MAX,
+                       &large);
+    query_result_destroy(&large);
+    query_cache_get_stats(&cache, &stats);
+    assert(stats.evictions == 1);
+    assert(lookup(&cache, 99) == 0 && lookup(&cache, 1) == 1);
+    query_cache_destroy(&cache);
+}
+
+void test_query_cache(void) {
+    test_lookup();
+    test_eviction();
+}
\ No newline at end of file
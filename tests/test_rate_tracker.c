@@ -0,0 +1,188 @@
+#include "../include/rate_tracker.h"
+#include "../include/rate_rule.h"
+#include "../include/config.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SEC 1000000000LL
+
+typedef struct {
+    size_t alerts;
+    uint64_t count;
+    const rate_rule_t* rule;
+    char source[64];
+} alert_log_t;
+
+static void record_alert(void* ctx, const rate_rule_t* rule, log_entry_t* entry, uint64_t count) {
+    alert_log_t* log = (alert_log_t*)ctx;
+    log->alerts++;
+    log->count = count;
+    log->rule = rule;
+    snprintf(log->source, sizeof(log->source), "%s", entry->source);
+}
+
+// Observe an entry written at `event` and processed at `now`
+static void observe_at(rate_tracker_t* tracker, const char* source, log_level_t level,
+                       const char* message, int64_t event, int64_t now) {
+    log_entry_t* entry = log_entry_create(source, message, level, message);
+    assert(entry != NULL);
+    entry->timestamp = event;
+    rate_tracker_observe(tracker, entry, now);
+    log_entry_destroy(entry);
+}
+
+static void observe(rate_tracker_t* tracker, const char* source, log_level_t level,
+                    const char* message, int64_t now) {
+    observe_at(tracker, source, level, message, now, now);
+}
+
+void test_rate_tracker(void) {
+    rate_rule_t rules[2];
+
+    // Test rule parsing
+    assert(rate_rule_parse(&rules[0], "50 ERROR in 60s") == 0);
+    assert(rules[0].limit == 50 && rules[0].window == 60 * SEC);
+    assert(rules[0].selector.min_level == LOG_LEVEL_ERROR);
+    assert(!rules[0].selector.has_field && rules[0].selector.pattern == NULL);
+    rate_rule_destroy(&rules[0]);
+
+    assert(rate_rule_parse(&rules[0], "100 status>=500 in 5m") == 0);
+    assert(rules[0].selector.has_field && rules[0].limit == 100 && rules[0].window == 300 * SEC);
+    assert(rules[0].selector.min_level == LOG_LEVEL_DEBUG);
+    rate_rule_destroy(&rules[0]);
+
+    assert(rate_rule_parse(&rules[0], "10/s WARN connection refused in 30") == 0);
+    assert(rules[0].limit == 300 && rules[0].window == 30 * SEC);
+    assert(rules[0].selector.min_level == LOG_LEVEL_WARNING);
+    assert(strcmp(rules[0].selector.pattern, "connection refused") == 0);
+    rate_rule_destroy(&rules[0]);
+
+    assert(rate_rule_parse(&rules[0], "3 \"user=admin in\" in 1h") == 0);
+    assert(strcmp(rules[0].selector.pattern, "user=admin in") == 0 && rules[0].window == 3600 * SEC);
+    rate_rule_destroy(&rules[0]);
+
+    assert(rate_rule_parse(&rules[0], "ERROR in 60s") == -1);
+    assert(rate_rule_parse(&rules[0], "50 in 60s") == -1);
+    assert(rate_rule_parse(&rules[0], "50 ERROR in") == -1);
+    assert(rate_rule_parse(&rules[0], "50 ERROR in 0s") == -1);
+    assert(rate_rule_parse(&rules[0], "50 ERROR in 60d") == -1);
+    assert(rate_rule_parse(&rules[0], "5/d ERROR in 60s") == -1);
+    assert(rate_rule_parse(&rules[0], "-5 ERROR in 60s") == -1);
+
+    // Test counting and firing per source
+    assert(rate_rule_parse(&rules[0], "5 ERROR in 8s") == 0);
+    assert(rate_rule_parse(&rules[1], "2 timeout in 8s") == 0);
+    alert_log_t log;
+    memset(&log, 0, sizeof(log));
+    rate_tracker_t tracker;
+    int64_t now = 1000 * SEC;
+    assert(rate_tracker_init(&tracker, rules, 2, 1024, record_alert, &log, now) == 0);
+
+    for (int i = 0; i < 5; i++) {
+        observe(&tracker, "app.log", LOG_LEVEL_ERROR, "disk full", now + i * SEC / 10);
+        observe(&tracker, "db.log", LOG_LEVEL_CRITICAL, "disk full", now + i * SEC / 10);
+    }
+    observe(&tracker, "app.log", LOG_LEVEL_WARNING, "disk full", now + SEC);
+    assert(log.alerts == 0);
+    assert(rate_tracker_count(&tracker, 0, "app.log", now + SEC) == 5);
+    observe(&tracker, "app.log", LOG_LEVEL_ERROR, "disk full", now + SEC);
+    assert(log.alerts == 1 && log.count == 6 && log.rule == &rules[0]);
+    assert(strcmp(log.source, "app.log") == 0);
+
+    // Quiet for one window after firing
+    for (int i = 0; i < 20; i++) {
+        observe(&tracker, "app.log", LOG_LEVEL_ERROR, "disk full", now + 2 * SEC);
+    }
+    assert(log.alerts == 1);
+    assert(rate_tracker_count(&tracker, 0, "app.log", now + 2 * SEC) == 26);
+
+    // Network sources are counted per client address
+    observe(&tracker, "network:10.0.0.1:4000", LOG_LEVEL_INFO, "timeout", now);
+    observe(&tracker, "network:10.0.0.1:4001", LOG_LEVEL_INFO, "timeout", now);
+    observe(&tracker, "network:10.0.0.1:4002", LOG_LEVEL_INFO, "timeout", now);
+    assert(log.alerts == 2 && log.count == 3 && log.rule == &rules[1]);
+
+    // The window slides: early hits drop out one sub-window at a time
+    assert(rate_tracker_count(&tracker, 0, "db.log", now + 7 * SEC) == 5);
+    assert(rate_tracker_count(&tracker, 0, "db.log", now + 9 * SEC) == 0);
+    assert(rate_tracker_count(&tracker, 0, "app.log", now + 9 * SEC) == 20);
+    observe(&tracker, "app.log", LOG_LEVEL_ERROR, "disk full", now + 9 * SEC + SEC / 2);
+    assert(log.alerts == 3 && log.count == 21);
+
+    // Idle counters expire through the wheel
+    assert(rate_tracker_active(&tracker) == 3);
+    observe(&tracker, "other.log", LOG_LEVEL_ERROR, "x", now + 30 * SEC);
+    for (int i = 0; i < 64; i++) {
+        char source[32];
+        snprintf(source, sizeof(source), "spread%d.log", i);
+        observe(&tracker, source, LOG_LEVEL_ERROR, "x", now + 30 * SEC);
+    }
+    assert(rate_tracker_active(&tracker) == 65);
+    assert(rate_tracker_count(&tracker, 0, "app.log", now + 30 * SEC) == 0);
+
+    // A replayed backlog is counted by event time, not arrival speed
+    memset(&log, 0, sizeof(log));
+    for (int i = 0; i < 20; i++) {
+        observe_at(&tracker, "replay.log", LOG_LEVEL_ERROR, "x", now + 40 * SEC + i * 2 * SEC,
+                   now + 100 * SEC);
+    }
+    assert(log.alerts == 0);
+    assert(rate_tracker_count(&tracker, 0, "replay.log", now + 78 * SEC) == 4);
+    // Entries from before the window are not counted
+    observe_at(&tracker, "replay.log", LOG_LEVEL_ERROR, "x", now + 40 * SEC, now + 100 * SEC);
+    assert(rate_tracker_count(&tracker, 0, "replay.log", now + 78 * SEC) == 4);
+
+    // A source running behind keeps its counter past the wall-clock window
+    for (int i = 0; i < 3; i++) {
+        observe_at(&tracker, "behind.log", LOG_LEVEL_ERROR, "x", now + 40 * SEC, now + 100 * SEC);
+    }
+    observe_at(&tracker, "behind.log", LOG_LEVEL_ERROR, "x", now + 41 * SEC, now + 105 * SEC);
+    assert(rate_tracker_count(&tracker, 0, "behind.log", now + 41 * SEC) == 4);
+    for (int i = 0; i < 2; i++) {
+        observe_at(&tracker, "behind.log", LOG_LEVEL_ERROR, "x", now + 42 * SEC, now + 106 * SEC);
+    }
+    assert(log.alerts == 1 && log.count == 6 && strcmp(log.source, "behind.log") == 0);
+    rate_tracker_destroy(&tracker);
+
+    // Test bounded memory: a full stripe evicts instead of growing
+    memset(&log, 0, sizeof(log));
+    metric_t* evictions = metrics_register("rates.evictions", METRIC_COUNTER);
+    uint64_t evictions_before = metrics_get(evictions);
+    assert(rate_tracker_init(&tracker, rules, 1, RATE_TRACKER_STRIPES, record_alert, &log, now) == 0);
+    for (int i = 0; i < 1000; i++) {
+        char source[32];
+        snprintf(source, sizeof(source), "host%d.log", i);
+        observe(&tracker, source, LOG_LEVEL_ERROR, "x", now + i);
+    }
+    assert(rate_tracker_active(&tracker) <= RATE_TRACKER_STRIPES);
+    assert(metrics_get(evictions) - evictions_before >= 1000 - RATE_TRACKER_STRIPES);
+    for (int i = 0; i < 10; i++) {
+        observe(&tracker, "hot.log", LOG_LEVEL_ERROR, "x", now + 2000);
+    }
+    assert(log.alerts == 1 && log.count == 6);
+    rate_tracker_destroy(&tracker);
+
+    assert(rate_tracker_init(&tracker, rules, 0, 16, record_alert, &log, now) == -1);
+    assert(rate_tracker_init(&tracker, rules, 1, 0, record_alert, &log, now) == -1);
+    rate_rule_destroy(&rules[0]);
+    rate_rule_destroy(&rules[1]);
+
+    // Test config keys
+    FILE* file = fopen("test_rate_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "alert_rate0=50 ERROR in 60s\n");
+    fprintf(file, "alert_rate1=not a rule\n");
+    fprintf(file, "alert_rate2=100 status>=500 in 5m\n");
+    fprintf(file, "alert_rate_capacity=1000000\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_rate_config.txt") == 0);
+    assert(config.num_rate_rules == 2);
+    assert(strcmp(config.rate_rules[1].text, "100 status>=500 in 5m") == 0);
+    assert(config.alert_rate_capacity == 1000000);
+    config_destroy(&config);
+    remove("test_rate_config.txt");
+}
\ No newline at end of file
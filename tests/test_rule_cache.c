@@ -0,0 +1,104 @@
+#include "../include/rule_cache.h"
+#include "../include/log_entry.h"
+#include "../include/hash.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+void test_rule_cache(void) {
+    rule_cache_t cache;
+    rule_cache_stats_t stats;
+    char key[RULE_CACHE_KEY_MAX];
+    rule_cache_value_t value = {0, 0};
+    
+    // Test initialization
+    assert(rule_cache_init(&cache, 0) == -1);
+    assert(rule_cache_init(&cache, 64) == 0);
+    
+    // Test key building: network ports are stripped from the source class
+    log_entry_t* a = log_entry_create("network:10.0.0.1:40001", "health check",
+                                      LOG_LEVEL_INFO, "[INFO");
+    log_entry_t* b = log_entry_create("network:10.0.0.1:40002", "health check",
+                                      LOG_LEVEL_INFO, "[INFO");
+    log_entry_t* c = log_entry_create("network:10.0.0.2:40001", "health check",
+                                      LOG_LEVEL_INFO, "[INFO");
+    assert(a && b && c);
+    
+    char key_b[RULE_CACHE_KEY_MAX];
+    size_t len_a = rule_cache_build_key(a, key, sizeof(key));
+    size_t len_b = rule_cache_build_key(b, key_b, sizeof(key_b));
+    assert(len_a > 0 && len_a == len_b);
+    assert(memcmp(key, key_b, len_a) == 0);
+    
+    char key_c[RULE_CACHE_KEY_MAX];
+    size_t len_c = rule_cache_build_key(c, key_c, sizeof(key_c));
+    assert(len_c == len_a && memcmp(key, key_c, len_a) != 0);
+    
+    // Test miss, insert, hit
+    uint64_t hash = hash64(key, len_a, 0);
+    assert(rule_cache_lookup(&cache, key, len_a, hash, &value) == false);
+    rule_cache_value_t stored = {1, 0x5};
+    rule_cache_insert(&cache, key, len_a, hash, &stored);
+    assert(rule_cache_lookup(&cache, key, len_a, hash, &value) == true);
+    assert(value.result == 1 && value.patterns == 0x5);
+    
+    // Test collision verification: same hash, different key must miss
+    assert(rule_cache_lookup(&cache, key_c, len_c, hash, &value) == false);
+    rule_cache_get_stats(&cache, &stats);
+    assert(stats.collisions == 1);
+    assert(stats.hits == 1);
+    assert(stats.misses == 2);
+    
+    // Test invalidation
+    rule_cache_clear(&cache);
+    assert(rule_cache_lookup(&cache, key, len_a, hash, &value) == false);
+    rule_cache_get_stats(&cache, &stats);
+    assert(stats.invalidations == 1);
+    assert(stats.entries == 0);
+    
+    // Test that the cache stays bounded under CLOCK eviction
+    for (int i = 0; i < 1000; i++) {
+        char k[32];
+        int n = snprintf(k, sizeof(k), "key-%d", i);
+        stored.result = (uint64_t)i;
+        rule_cache_insert(&cache, k, (size_t)n, hash64(k, (size_t)n, 0), &stored);
+    }
+    rule_cache_get_stats(&cache, &stats);
+    assert(stats.entries <= cache.capacity);
+    assert(stats.evictions >= 1000 - cache.capacity);
+    
+    // Recently inserted keys are still found with the right value
+    int n = snprintf(key, sizeof(key), "key-%d", 999);
+    assert(rule_cache_lookup(&cache, key, (size_t)n, hash64(key, (size_t)n, 0), &value));
+    assert(value.result == 999);
+    
+    // Typical lines of a couple of hundred bytes are cacheable
+    char line[200];
+    memset(line, 'y', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    log_entry_t* typical = log_entry_create("/var/log/app/service.log", line + 20,
+                                            LOG_LEVEL_ERROR, line);
+    assert(typical != NULL);
+    assert(rule_cache_build_key(typical, key, sizeof(key)) == 24 + 2 + 199);
+    log_entry_destroy(typical);
+    
+    // Test that oversized entries are not cached
+    char big_message[512];
+    memset(big_message, 'x', sizeof(big_message) - 1);
+    big_message[sizeof(big_message) - 1] = '\0';
+    log_entry_t* big = log_entry_create("big.log", big_message, LOG_LEVEL_ERROR, big_message);
+    assert(big != NULL);
+    assert(rule_cache_build_key(big, key, sizeof(key)) == 0);
+    
+    // Test clear
+    rule_cache_clear(&cache);
+    rule_cache_get_stats(&cache, &stats);
+    assert(stats.entries == 0);
+    
+    // Cleanup
+    log_entry_destroy(a);
+    log_entry_destroy(b);
+    log_entry_destroy(c);
+    log_entry_destroy(big);
+    rule_cache_destroy(&cache);
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "../include/shard_pool.h"
+#include "../include/log_entry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_SOURCES 8
+
+static size_t g_next_seq[TEST_SOURCES];
+static size_t g_expected_seq[TEST_SOURCES];
+static unsigned int g_seen_shards[TEST_SOURCES];
+static size_t g_processed;
+static size_t g_order_errors;
+static bool g_gate_open;
+
+static void sleep_ms(long ms) {
+    struct timespec ts = {0, ms * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void check_entry(void* ctx, log_entry_t* entry) {
+    shard_pool_t* pool = (shard_pool_t*)ctx;
+    while (!__atomic_load_n(&g_gate_open, __ATOMIC_ACQUIRE)) {
+        sleep_ms(1);
+    }
+
+    // A source is only ever processed by one thread at a time, so plain
+    // per-source bookkeeping must see every sequence number in order
+    size_t source = (size_t)atoi(entry->source + 1);
+    size_t seq = (size_t)atol(entry->message);
+    if (seq != g_expected_seq[source]) {
+        __atomic_add_fetch(&g_order_errors, 1, __ATOMIC_RELAXED);
+    }
+    g_expected_seq[source] = seq + 1;
+    // The slot cannot move while this entry is in flight
+    size_t shard = shard_pool_shard_of(pool, source);
+    __atomic_or_fetch(&g_seen_shards[source], 1u << shard, __ATOMIC_RELAXED);
+
+    log_entry_destroy(entry);
+    __atomic_add_fetch(&g_processed, 1, __ATOMIC_RELEASE);
+}
+
+static void wait_processed(size_t expected) {
+    for (int i = 0; i < 1000 && __atomic_load_n(&g_processed, __ATOMIC_ACQUIRE) < expected; i++) {
+        sleep_ms(5);
+    }
+}
+
+static void submit_source(shard_pool_t* pool, size_t source, size_t count) {
+    log_entry_t* entries[64];
+    char name[16];
+    snprintf(name, sizeof(name), "s%zu", source);
+
+    for (size_t offset = 0; offset < count; offset += 64) {
+        size_t chunk = count - offset < 64 ? count - offset : 64;
+        for (size_t i = 0; i < chunk; i++) {
+            char message[32];
+            snprintf(message, sizeof(message), "%zu", g_next_seq[source]++);
+            entries[i] = log_entry_create(name, message, LOG_LEVEL_ERROR, message);
+            assert(entries[i] != NULL);
+        }
+        // Affinity equals the source index, so with two shards the even
+        // sources all start on shard 0
+        assert(shard_pool_submit(pool, entries, chunk, source) == 0);
+    }
+}
+
+void test_shard_pool(void) {
+    shard_pool_t pool;
+    size_t total = 0;
+
+    assert(shard_pool_init(&pool, 2, 128, 0, check_entry, &pool) == 0);
+    assert(shard_pool_start(&pool) == 0);
+    assert(shard_pool_shard_of(&pool, 0) == 0);
+    assert(shard_pool_shard_of(&pool, 3) == 1);
+
+    // Test that slots with entries in flight never move
+    submit_source(&pool, 0, 50);
+    submit_source(&pool, 2, 50);
+    total += 100;
+    assert(shard_pool_rebalance(&pool) == 0);
+    __atomic_store_n(&g_gate_open, true, __ATOMIC_RELEASE);
+    wait_processed(total);
+    assert(g_processed == total);
+
+    // Test rebalancing: shard 0 carries every source, shard 1 is idle
+    for (int round = 0; round < 4; round++) {
+        for (size_t source = 0; source < TEST_SOURCES; source += 2) {
+            submit_source(&pool, source, 50);
+            total += 50;
+        }
+    }
+    wait_processed(total);
+    assert(shard_pool_rebalance(&pool) >= 1);
+    size_t moved = 0;
+    for (size_t source = 0; source < TEST_SOURCES; source += 2) {
+        moved += shard_pool_shard_of(&pool, source) == 1;
+    }
+    assert(moved >= 1 && moved < 4);
+
+    // Test per-source order across the move, with sources interleaved
+    for (int round = 0; round < 4; round++) {
+        for (size_t source = 0; source < TEST_SOURCES; source++) {
+            submit_source(&pool, source, 30);
+            total += 30;
+        }
+    }
+    wait_processed(total);
+    assert(g_processed == total);
+    assert(g_order_errors == 0);
+    bool migrated = false;
+    for (size_t source = 0; source < TEST_SOURCES; source += 2) {
+        migrated |= g_seen_shards[source] == 3;
+    }
+    assert(migrated);
+
+    // Submitting to a stopped pool destroys the entries
+    shard_pool_stop(&pool);
+    log_entry_t* entry = log_entry_create("s1", "0", LOG_LEVEL_ERROR, "0");
+    assert(shard_pool_submit(&pool, &entry, 1, 1) == -1);
+
+    shard_pool_destroy(&pool);
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "../include/sketch.h"
+#include "../include/stream_stats.h"
+#include "../include/config.h"
+#include "../include/hash.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+#define ENTRIES_PER_THREAD 2000
+
+static void* observe_worker(void* arg) {
+    stream_stats_t* stats = (stream_stats_t*)arg;
+    for (int i = 0; i < ENTRIES_PER_THREAD; i++) {
+        // One source in two is "hot"; the rest spread over 100 sources
+        char source[32];
+        char message[64];
+        if (i % 2 == 0) {
+            snprintf(source, sizeof(source), "hot.log");
+        } else {
+            snprintf(source, sizeof(source), "cold%d.log", i % 100);
+        }
+        snprintf(message, sizeof(message), "login user=u%d ok", i % 500);
+        log_entry_t* entry = log_entry_create(source, message, LOG_LEVEL_INFO, "x");
+        assert(entry != NULL);
+        entry->template_id = (uint32_t)(i % 3 + 1);
+        stream_stats_observe(stats, entry);
+        log_entry_destroy(entry);
+    }
+    return NULL;
+}
+
+static uint64_t key_of(const char* label) {
+    return hash64(label, strlen(label), 0);
+}
+
+void test_sketch(void) {
+    // Test Space-Saving: heavy hitters survive a long tail
+    topk_t topk;
+    assert(topk_init(&topk, 16) == 0);
+    for (int i = 0; i < 10000; i++) {
+        char label[16];
+        if (i % 4 == 0) {
+            topk_add(&topk, key_of("heavy"), "heavy", 5, 1);
+        } else if (i % 10 == 1) {
+            topk_add(&topk, key_of("medium"), "medium", 6, 1);
+        } else {
+            snprintf(label, sizeof(label), "k%d", i);
+            topk_add(&topk, key_of(label), label, strlen(label), 1);
+        }
+    }
+    topk_item_t items[16];
+    size_t count = topk_list(&topk, items, 16);
+    assert(count == 16);
+    assert(strcmp(items[0].label, "heavy") == 0);
+    assert(items[0].count >= 2500 && items[0].count - items[0].error <= 2500);
+    assert(strcmp(items[1].label, "medium") == 0);
+    assert(items[1].count >= 1000 && items[1].count - items[1].error <= 1000);
+    for (size_t i = 1; i < count; i++) {
+        assert(items[i - 1].count >= items[i].count);
+    }
+    assert(topk_list(&topk, items, 1) == 1 && strcmp(items[0].label, "heavy") == 0);
+
+    // Long labels are truncated
+    char long_label[200];
+    memset(long_label, 'a', sizeof(long_label));
+    topk_add(&topk, 42, long_label, sizeof(long_label), 100000);
+    assert(topk_list(&topk, items, 1) == 1 && items[0].key == 42);
+    assert(strlen(items[0].label) == SKETCH_LABEL_MAX - 1);
+
+    // Test merging: counts add up over the union of keys
+    topk_t other;
+    assert(topk_init(&other, 8) == 0);
+    topk_add(&other, key_of("medium"), "medium", 6, 5000);
+    topk_add(&other, key_of("fresh"), "fresh", 5, 3);
+    assert(topk_merge(&topk, &other) == 0);
+    count = topk_list(&topk, items, 16);
+    assert(count == 16);
+    assert(items[0].key == 42);
+    assert(strcmp(items[1].label, "medium") == 0 && items[1].count >= 6000);
+    assert(strcmp(items[2].label, "heavy") == 0);
+    topk_reset(&topk);
+    assert(topk_list(&topk, items, 16) == 0);
+    topk_add(&topk, 1, "one", 3, 2);
+    assert(topk_list(&topk, items, 16) == 1 && items[0].count == 2 && items[0].error == 0);
+    topk_destroy(&topk);
+    topk_destroy(&other);
+    assert(topk_init(&topk, 0) == -1);
+
+    // Test Count-Min: never below the true count, exact without collisions
+    count_min_t sketch;
+    assert(count_min_init(&sketch, 1000, 4) == 0);
+    assert(sketch.width == 1024);
+    uint64_t true_counts[2000];
+    for (uint64_t key = 0; key < 2000; key++) {
+        true_counts[key] = key % 7 + 1;
+        count_min_add(&sketch, hash64_mix(key), true_counts[key]);
+    }
+    uint64_t overestimated = 0;
+    for (uint64_t key = 0; key < 2000; key++) {
+        uint64_t estimate = count_min_estimate(&sketch, hash64_mix(key));
+        assert(estimate >= true_counts[key]);
+        overestimated += estimate - true_counts[key];
+    }
+    // Conservative update keeps the average overestimate small
+    assert(overestimated / 2000 < 4);
+    count_min_t copy;
+    assert(count_min_init(&copy, 1024, 4) == 0);
+    count_min_add(&copy, hash64_mix(7), 100);
+    assert(count_min_merge(&copy, &sketch) == 0);
+    assert(count_min_estimate(&copy, hash64_mix(7)) >= 100 + true_counts[7]);
+    count_min_reset(&copy);
+    assert(count_min_estimate(&copy, hash64_mix(7)) == 0);
+    count_min_destroy(&copy);
+    assert(count_min_init(&copy, 512, 4) == 0);
+    assert(count_min_merge(&copy, &sketch) == -1);
+    count_min_destroy(&copy);
+    count_min_destroy(&sketch);
+    assert(count_min_init(&sketch, 1024, 0) == -1);
+    assert(count_min_init(&sketch, 1024, COUNT_MIN_MAX_DEPTH + 1) == -1);
+
+    // Test HyperLogLog accuracy (standard error ~1.6% at precision 12)
+    hll_t hll;
+    hll_t half;
+    assert(hll_init(&hll, 12) == 0);
+    assert(hll_init(&half, 12) == 0);
+    assert(hll_estimate(&hll) == 0.0);
+    for (uint64_t key = 0; key < 100; key++) {
+        hll_add(&hll, hash64_mix(key));
+        hll_add(&hll, hash64_mix(key));
+    }
+    assert(fabs(hll_estimate(&hll) - 100.0) < 5.0);
+    for (uint64_t key = 100; key < 100000; key++) {
+        hll_add(key < 50000 ? &hll : &half, hash64_mix(key));
+    }
+    assert(fabs(hll_estimate(&hll) - 50000.0) < 2500.0);
+    assert(hll_merge(&hll, &half) == 0);
+    assert(fabs(hll_estimate(&hll) - 100000.0) < 5000.0);
+    hll_reset(&hll);
+    assert(hll_estimate(&hll) == 0.0);
+    hll_destroy(&half);
+    assert(hll_init(&half, 10) == 0);
+    assert(hll_merge(&hll, &half) == -1);
+    hll_destroy(&half);
+    hll_destroy(&hll);
+    assert(hll_init(&hll, 3) == -1);
+    assert(hll_init(&hll, 17) == -1);
+
+    // Test the aggregator with per-thread shards
+    config_t config;
+    config_init_defaults(&config);
+    char* fields[] = {"user", "session"};
+    config.sketches = true;
+    config.sketch_top_k = 8;
+    config.sketch_fields = fields;
+    config.num_sketch_fields = 2;
+    config.sketch_file = "test_sketch_dump.txt";
+
+    stream_stats_t stats;
+    assert(stream_stats_init(&stats, &config) == 0);
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        assert(pthread_create(&threads[i], NULL, observe_worker, &stats) == 0);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    // Nothing is visible before a merge
+    assert(stream_stats_entries(&stats) == 0);
+    stream_stats_merge(&stats, 0);
+    assert(stream_stats_entries(&stats) == THREADS * ENTRIES_PER_THREAD);
+
+    count = stream_stats_top_sources(&stats, false, items, 16);
+    assert(count == 8 && strcmp(items[0].label, "hot.log") == 0);
+    assert(items[0].count >= THREADS * ENTRIES_PER_THREAD / 2);
+    assert(stream_stats_source_count(&stats, "hot.log") >= THREADS * ENTRIES_PER_THREAD / 2);
+    assert(stream_stats_source_count(&stats, "never.log") < 50);
+    count = stream_stats_top_templates(&stats, true, items, 16);
+    assert(count == 3 && strcmp(items[0].label, "1") == 0);
+    assert(fabs(stream_stats_distinct_sources(&stats) - 51.0) < 3.0);
+    assert(fabs(stream_stats_distinct_templates(&stats) - 3.0) < 0.5);
+    assert(fabs(stream_stats_distinct_field(&stats, "user") - 500.0) < 25.0);
+    assert(stream_stats_distinct_field(&stats, "session") == 0.0);
+    assert(stream_stats_distinct_field(&stats, "host") == -1.0);
+    metric_t* gauge = metrics_register("sketch.distinct.user", METRIC_GAUGE);
+    assert(metrics_get(gauge) >= 475 && metrics_get(gauge) <= 525);
+
+    // The recent view covers only the last interval; totals keep growing
+    observe_worker(&stats);
+    stream_stats_merge(&stats, 0);
+    assert(stream_stats_entries(&stats) == (THREADS + 1) * ENTRIES_PER_THREAD);
+    assert(stream_stats_top_sources(&stats, true, items, 1) == 1);
+    assert(strcmp(items[0].label, "hot.log") == 0);
+    assert(items[0].count >= ENTRIES_PER_THREAD / 2);
+    assert(items[0].count - items[0].error <= ENTRIES_PER_THREAD / 2);
+
+    // Test the dump written on stop
+    assert(stream_stats_start(&stats) == 0);
+    assert(stream_stats_start(&stats) == -1);
+    stream_stats_stop(&stats);
+    FILE* file = fopen("test_sketch_dump.txt", "r");
+    assert(file != NULL);
+    char line[256];
+    bool saw_entries = false;
+    bool saw_field = false;
+    bool saw_source = false;
+    while (fgets(line, sizeof(line), file)) {
+        saw_entries |= strcmp(line, "entries 10000\n") == 0;
+        saw_field |= strncmp(line, "distinct.field.user ", 20) == 0;
+        saw_source |= strstr(line, "total.source ") == line && strstr(line, " hot.log\n") != NULL;
+    }
+    fclose(file);
+    assert(saw_entries && saw_field && saw_source);
+    stream_stats_destroy(&stats);
+    remove("test_sketch_dump.txt");
+
+    config.sketch_precision = 20;
+    assert(stream_stats_init(&stats, &config) == -1);
+    config.sketch_fields = NULL;
+    config.num_sketch_fields = 0;
+    config.sketch_file = NULL;
+    config_destroy(&config);
+
+    // Test config keys
+    file = fopen("test_sketch_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "sketches=true\n");
+    fprintf(file, "sketch_top_k=16\n");
+    fprintf(file, "sketch_width=4096\n");
+    fprintf(file, "sketch_depth=40\n");
+    fprintf(file, "sketch_precision=14\n");
+    fprintf(file, "sketch_field=user\n");
+    fprintf(file, "sketch_field=client_ip\n");
+    fprintf(file, "sketch_interval=5\n");
+    fprintf(file, "sketch_file=sketches.txt\n");
+    fclose(file);
+    assert(config_load(&config, "test_sketch_config.txt") == 0);
+    assert(config.sketches && config.sketch_top_k == 16 && config.sketch_width == 4096);
+    assert(config.sketch_depth == 4 && config.sketch_precision == 14);
+    assert(config.num_sketch_fields == 2 && strcmp(config.sketch_fields[1], "client_ip") == 0);
+    assert(config.sketch_interval == 5 && strcmp(config.sketch_file, "sketches.txt") == 0);
+    config_destroy(&config);
+    remove("test_sketch_config.txt");
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "../include/template_miner.h"
+#include "../include/config.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+
+typedef struct {
+    template_miner_t* miner;
+    uint32_t ids[2];
+} worker_t;
+
+static void* match_worker(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+    for (int i = 0; i < 1000; i++) {
+        char message[64];
+        snprintf(message, sizeof(message), "request %d served in %d ms", i, i % 50);
+        uint32_t id = template_miner_match(worker->miner, message, NULL, 0, NULL);
+        assert(worker->ids[0] == 0 || worker->ids[0] == id);
+        worker->ids[0] = id;
+        snprintf(message, sizeof(message), "cache miss for key k%d", i);
+        id = template_miner_match(worker->miner, message, NULL, 0, NULL);
+        assert(worker->ids[1] == 0 || worker->ids[1] == id);
+        worker->ids[1] = id;
+    }
+    return NULL;
+}
+
+static bool has_template(template_miner_t* miner, uint32_t id, const char* expected) {
+    char text[256];
+    return template_miner_lookup(miner, id, text, sizeof(text), NULL) == 0 &&
+           strcmp(text, expected) == 0;
+}
+
+void test_template_miner(void) {
+    template_miner_t miner;
+    template_var_t vars[4];
+    size_t num_vars;
+
+    // Test clustering: digit tokens are variables from the start
+    assert(template_miner_init(&miner, 64, 2, 0.4) == 0);
+    uint32_t id = template_miner_match(&miner, "Failed to process user request 4711", vars, 4,
+                                       &num_vars);
+    assert(id != 0 && num_vars == 1);
+    assert(vars[0].length == 4 && strncmp(vars[0].value, "4711", 4) == 0);
+    assert(template_miner_match(&miner, "Failed  to process user request 4712", vars, 4,
+                                &num_vars) == id);
+    assert(has_template(&miner, id, "Failed to process user request <*>"));
+    assert(strncmp(vars[0].value, "4712", 4) == 0);
+
+    // Differing tokens are generalized; the ID stays
+    uint32_t closed = template_miner_match(&miner, "Connection from alice closed", NULL, 0, NULL);
+    assert(closed != id && has_template(&miner, closed, "Connection from alice closed"));
+    assert(template_miner_match(&miner, "Connection from bob closed", vars, 4, &num_vars) == closed);
+    assert(has_template(&miner, closed, "Connection from <*> closed"));
+    assert(num_vars == 1 && vars[0].length == 3 && strncmp(vars[0].value, "bob", 3) == 0);
+    uint64_t hits = 0;
+    assert(template_miner_lookup(&miner, closed, NULL, 0, &hits) == 0 && hits == 2);
+
+    // Token count and leading tokens separate templates
+    assert(template_miner_match(&miner, "Connection from bob closed early", NULL, 0, NULL) != closed);
+    assert(template_miner_match(&miner, "Session from bob closed", NULL, 0, NULL) != closed);
+    assert(template_miner_match(&miner, "", NULL, 0, NULL) == 0);
+    assert(template_miner_match(&miner, " \t ", NULL, 0, NULL) == 0);
+    assert(template_miner_lookup(&miner, 9999, NULL, 0, NULL) == -1);
+
+    // Long messages fold their tail into the last token
+    char long_message[1024] = "";
+    for (int i = 0; i < 100; i++) {
+        strcat(long_message, "word ");
+    }
+    uint32_t long_id = template_miner_match(&miner, long_message, NULL, 0, NULL);
+    assert(long_id != 0 && template_miner_match(&miner, long_message, NULL, 0, NULL) == long_id);
+
+    // Entries are tagged with their template
+    log_entry_t* entry = log_entry_create("app.log", "Failed to process user request 17",
+                                          LOG_LEVEL_ERROR, "x");
+    assert(entry != NULL && entry->template_id == 0);
+    template_miner_observe(&miner, entry);
+    assert(entry->template_id == id);
+    log_entry_destroy(entry);
+
+    // Test persistence: IDs and counts survive a restart
+    size_t count = template_miner_count(&miner);
+    assert(template_miner_save(&miner, "test_templates.txt") == 0);
+    template_miner_destroy(&miner);
+    assert(template_miner_init(&miner, 64, 2, 0.4) == 0);
+    assert(template_miner_load(&miner, "test_templates.txt") == (int)count);
+    assert(template_miner_count(&miner) == count);
+    assert(has_template(&miner, closed, "Connection from <*> closed"));
+    assert(template_miner_lookup(&miner, closed, NULL, 0, &hits) == 0 && hits == 2);
+    assert(template_miner_match(&miner, "Connection from carol closed", NULL, 0, NULL) == closed);
+    assert(template_miner_match(&miner, "Failed to process user request 99", NULL, 0, NULL) == id);
+    assert(template_miner_match(&miner, "something new", NULL, 0, NULL) > long_id);
+    template_miner_destroy(&miner);
+    remove("test_templates.txt");
+    assert(template_miner_init(&miner, 64, 2, 0.4) == 0);
+    assert(template_miner_load(&miner, "test_templates_missing.txt") == 0);
+    template_miner_destroy(&miner);
+
+    // Test the similarity threshold
+    assert(template_miner_init(&miner, 64, 2, 0.6) == 0);
+    id = template_miner_match(&miner, "job started cleanly now", NULL, 0, NULL);
+    assert(template_miner_match(&miner, "job started with errors", NULL, 0, NULL) != id);
+    template_miner_destroy(&miner);
+    assert(template_miner_init(&miner, 64, 2, 0.4) == 0);
+    id = template_miner_match(&miner, "job started cleanly now", NULL, 0, NULL);
+    assert(template_miner_match(&miner, "job started with errors", NULL, 0, NULL) == id);
+    assert(has_template(&miner, id, "job started <*> <*>"));
+    template_miner_destroy(&miner);
+
+    // Test bounded memory: the least recently matched template is evicted
+    metric_t* evictions = metrics_register("templates.evictions", METRIC_COUNTER);
+    uint64_t evictions_before = metrics_get(evictions);
+    assert(template_miner_init(&miner, 4, 2, 0.4) == 0);
+    uint32_t first = template_miner_match(&miner, "alpha one x", NULL, 0, NULL);
+    const char* shapes[] = {"beta one x", "gamma one x", "delta one x", "epsilon one x",
+                            "zeta one x", "eta one x"};
+    for (size_t i = 0; i < 6; i++) {
+        template_miner_match(&miner, shapes[i], NULL, 0, NULL);
+        template_miner_match(&miner, "alpha one x", NULL, 0, NULL);
+    }
+    assert(template_miner_count(&miner) == 4);
+    assert(metrics_get(evictions) - evictions_before == 3);
+    assert(template_miner_match(&miner, "alpha one x", NULL, 0, NULL) == first);
+    assert(template_miner_lookup(&miner, first + 1, NULL, 0, NULL) == -1);
+    assert(has_template(&miner, first + 6, "eta one x"));
+
+    // A new token count still gets a template when other groups fill the pool
+    uint32_t other = template_miner_match(&miner, "theta one two x", NULL, 0, NULL);
+    assert(other != 0 && has_template(&miner, other, "theta one two x"));
+    assert(template_miner_count(&miner) == 4);
+    assert(metrics_get(evictions) - evictions_before == 4);
+    template_miner_destroy(&miner);
+
+    // Test concurrent matching
+    assert(template_miner_init(&miner, 64, 2, 0.4) == 0);
+    pthread_t threads[THREADS];
+    worker_t workers[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        memset(&workers[i], 0, sizeof(worker_t));
+        workers[i].miner = &miner;
+        assert(pthread_create(&threads[i], NULL, match_worker, &workers[i]) == 0);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        assert(workers[i].ids[0] == workers[0].ids[0] && workers[i].ids[1] == workers[0].ids[1]);
+    }
+    assert(template_miner_count(&miner) == 2);
+    template_miner_destroy(&miner);
+
+    assert(template_miner_init(&miner, 0, 2, 0.4) == -1);
+    assert(template_miner_init(&miner, 16, 0, 0.4) == -1);
+    assert(template_miner_init(&miner, 16, 2, 1.5) == -1);
+
+    // Test config keys
+    FILE* file = fopen("test_template_config.txt", "w");
+    assert(file != NULL);
+    fprintf(file, "template_mining=true\n");
+    fprintf(file, "template_capacity=100\n");
+    fprintf(file, "template_depth=0\n");
+    fprintf(file, "template_similarity=0.7\n");
+    fprintf(file, "template_file=templates.txt\n");
+    fclose(file);
+    config_t config;
+    assert(config_load(&config, "test_template_config.txt") == 0);
+    assert(config.template_mining && config.template_capacity == 100);
+    assert(config.template_depth == 2 && config.template_similarity == 0.7);
+    assert(strcmp(config.template_file, "templates.txt") == 0);
+    config_destroy(&config);
+    remove("test_template_config.txt");
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "../include/timer_wheel.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TICK 1000LL
+
+typedef struct {
+    timer_wheel_timer_t timer;
+    int64_t deadline;           // ns
+    int64_t fired_at;           // ns, 0 until fired
+} test_timer_t;
+
+typedef struct {
+    int64_t now;
+    size_t fired;
+    bool late;                  // A timer fired after its tick
+    bool early;                 // A timer fired before its deadline
+} fire_log_t;
+
+static void on_fire(void* ctx, timer_wheel_timer_t* timer) {
+    fire_log_t* log = (fire_log_t*)ctx;
+    test_timer_t* t = (test_timer_t*)timer;
+    t->fired_at = log->now;
+    log->fired++;
+    log->early |= log->now < t->deadline;
+    log->late |= log->now >= t->deadline + TICK;
+}
+
+// Step one tick at a time so every firing time is observed
+static void run_until(timer_wheel_t* wheel, fire_log_t* log, int64_t until) {
+    while (log->now < until) {
+        log->now += TICK;
+        timer_wheel_advance(wheel, log->now, on_fire, log);
+    }
+}
+
+void test_timer_wheel(void) {
+    timer_wheel_t wheel;
+    fire_log_t log;
+    memset(&log, 0, sizeof(log));
+    assert(timer_wheel_init(&wheel, 0, 0) == -1);
+    assert(timer_wheel_init(&wheel, TICK, 0) == 0);
+    assert(timer_wheel_earliest(&wheel) == NULL);
+
+    // Test deadlines on every level, including cascade boundaries
+    int64_t deadlines[] = {1, 5, 63, 64, 65, 127, 128, 4095, 4096, 4097, 5000,
+                           262143, 262144, 300000, 1000000};
+    size_t count = sizeof(deadlines) / sizeof(deadlines[0]);
+    test_timer_t* timers = (test_timer_t*)calloc(count, sizeof(test_timer_t));
+    assert(timers != NULL);
+    for (size_t i = 0; i < count; i++) {
+        timer_wheel_timer_init(&timers[i].timer);
+        assert(!timer_wheel_pending(&timers[i].timer));
+        timers[i].deadline = deadlines[i] * TICK;
+        timer_wheel_schedule(&wheel, &timers[i].timer, timers[i].deadline);
+        assert(timer_wheel_pending(&timers[i].timer));
+    }
+    assert(wheel.count == count);
+    assert(timer_wheel_earliest(&wheel) == &timers[0].timer);
+
+    // Cancelled and rescheduled timers
+    timer_wheel_cancel(&wheel, &timers[3].timer);
+    assert(!timer_wheel_pending(&timers[3].timer));
+    timers[5].deadline = 70 * TICK;
+    timer_wheel_schedule(&wheel, &timers[5].timer, timers[5].deadline);
+    assert(wheel.count == count - 1);
+
+    run_until(&wheel, &log, 1000000 * TICK);
+    assert(log.fired == count - 1);
+    assert(!log.early && !log.late);
+    assert(timers[3].fired_at == 0);
+    assert(timers[5].fired_at == 70 * TICK);
+    assert(wheel.count == 0);
+
+    // Past deadlines fire on the next tick; a large jump fires everything due
+    test_timer_t past;
+    timer_wheel_timer_init(&past.timer);
+    past.deadline = 0;
+    timer_wheel_schedule(&wheel, &past.timer, 5);
+    test_timer_t far;
+    timer_wheel_timer_init(&far.timer);
+    far.deadline = log.now + 10000 * TICK;
+    timer_wheel_schedule(&wheel, &far.timer, far.deadline);
+    log.now += TICK;
+    assert(timer_wheel_advance(&wheel, log.now, on_fire, &log) == 1);
+    log.now += 20000 * TICK;
+    assert(timer_wheel_advance(&wheel, log.now, on_fire, &log) == 1);
+    assert(far.fired_at == log.now);
+
+    // Deadlines past the wheel's range are clamped and fire early
+    test_timer_t clamped;
+    timer_wheel_timer_init(&clamped.timer);
+    clamped.deadline = log.now + ((int64_t)1 << 30) * TICK;
+    timer_wheel_schedule(&wheel, &clamped.timer, clamped.deadline);
+    assert(timer_wheel_earliest(&wheel) == &clamped.timer);
+    log.now += ((int64_t)1 << 24) * TICK;
+    assert(timer_wheel_advance(&wheel, log.now, on_fire, &log) == 1);
+    assert(log.early);
+
+    free(timers);
+}
\ No newline at end of file
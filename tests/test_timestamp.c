@@ -0,0 +1,99 @@
+#include "../include/timestamp.h"
+#include "../include/line_parser.h"
+#include "../include/log_entry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NS TIMESTAMP_NS_PER_SEC
+
+static int64_t parse(const char* text, bool allow_epoch, size_t* used) {
+    int64_t ns = 0;
+    *used = timestamp_parse(text, strlen(text), allow_epoch, &ns);
+    return ns;
+}
+
+void test_timestamp(void) {
+    size_t used;
+
+    // Test the coarse clock against the system clock
+    int64_t now = timestamp_now();
+    assert(now / NS >= time(NULL) - 1 && now / NS <= time(NULL) + 1);
+
+    // Test ISO-8601 / RFC3339 with fractions and zones
+    assert(parse("2024-03-01T12:00:00Z", false, &used) == 1709294400LL * NS);
+    assert(used == 20);
+    assert(parse("2024-03-01T12:00:00.123456789Z", false, &used) == 1709294400LL * NS + 123456789);
+    assert(parse("2024-03-01T12:00:00.5Z", false, &used) == 1709294400LL * NS + 500000000);
+    assert(parse("2024-03-01T12:00:00,25+01:00 rest", false, &used) == 1709290800LL * NS + 250000000);
+    assert(used == 28);
+    assert(parse("2024-03-01T12:00:00-0130", false, &used) == 1709299800LL * NS);
+    assert(used == 24);
+
+    // Same date again comes from the cached prefix
+    assert(parse("2024-03-01T23:59:59Z", false, &used) == 1709337599LL * NS);
+    assert(parse("2024-02-29T00:00:00Z", false, &used) == 1709164800LL * NS);
+
+    // Zone-less times are local
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 2024 - 1900;
+    tm.tm_mon = 2;
+    tm.tm_mday = 1;
+    tm.tm_hour = 12;
+    tm.tm_isdst = -1;
+    assert(parse("2024-03-01 12:00:00", false, &used) == (int64_t)mktime(&tm) * NS);
+    assert(used == 19);
+
+    // Test common log format
+    assert(parse("10/Oct/2000:13:55:36 -0700", false, &used) == 971211336LL * NS);
+    assert(used == 26);
+
+    // Test syslog: no year, so the result is within the last year
+    int64_t syslog = parse("Oct  1 22:14:15 host su: x", false, &used);
+    assert(used == 15);
+    assert(syslog > now - 366LL * 86400 * NS && syslog < now + 32LL * 86400 * NS);
+    assert(parse("Jun 11 22:14:15", false, &used) - parse("Jun 10 22:14:15", false, &used) ==
+           86400LL * NS);
+
+    // Test epoch values; the unit follows from the digit count
+    assert(parse("1700000000", true, &used) == 1700000000LL * NS);
+    assert(parse("1700000000123", true, &used) == 1700000000123LL * 1000000);
+    assert(parse("1700000000123456", true, &used) == 1700000000123456LL * 1000);
+    assert(parse("1700000000123456789", true, &used) == 1700000000123456789LL);
+    assert(parse("1700000000.25", true, &used) == 1700000000LL * NS + 250000000);
+    assert(used == 13);
+    parse("1700000000", false, &used);
+    assert(used == 0);
+
+    // Test rejects
+    parse("2024-13-01T00:00:00Z", false, &used);
+    assert(used == 0);
+    parse("2024-03-01T25:00:00Z", false, &used);
+    assert(used == 0);
+    parse("Foo  1 22:14:15", false, &used);
+    assert(used == 0);
+    parse("12345", true, &used);
+    assert(used == 0);
+    parse("[ERROR] x", true, &used);
+    assert(used == 0);
+
+    // Test event time on plain lines: leading timestamp, then [LEVEL]
+    const char* line = "2024-03-01T12:00:00.250Z [ERROR] disk full";
+    log_entry_t* entry = line_parser_create_entry(NULL, "app.log", line, strlen(line));
+    assert(entry != NULL);
+    assert(entry->level == LOG_LEVEL_ERROR);
+    assert(strcmp(entry->message, "disk full") == 0);
+    assert(strcmp(entry->raw_line, line) == 0);
+    assert(entry->timestamp == 1709294400LL * NS + 250000000);
+    assert(entry->ingest_time >= now);
+    log_entry_destroy(entry);
+
+    // Lines without a timestamp keep the ingest time
+    entry = line_parser_create_entry(NULL, "app.log", "[INFO] started", 14);
+    assert(entry != NULL);
+    assert(entry->timestamp == entry->ingest_time);
+    log_entry_destroy(entry);
+}
\ No newline at end of file
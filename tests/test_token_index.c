@@ -0,0 +1,248 @@
+#include "../include/token_index.h"
+#include "../include/segment.h"
+#include "../include/log_store.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SEC 1000000000LL
+#define DIR_NAME "test_token_dir"
+#define SEGMENT_PATH "test_token.seg"
+
+// 2025-01-01 10:00:00 UTC
+static const int64_t BASE = 1735725600LL * SEC;
+
+static void remove_tree(const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        unlink(path);
+        return;
+    }
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+            char child[512];
+            snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+            remove_tree(child);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static uint64_t token_hash(const char* token) {
+    uint64_t hash = 0;
+    assert(token_index_tokens(token, strlen(token), &hash, 1) == 1);
+    return hash;
+}
+
+// Rows of a token in a finished builder, NULL if not indexed
+static uint32_t* builder_rows(const token_index_builder_t* builder, const char* token,
+                              uint32_t* count) {
+    uint32_t offset;
+    if (!token_index_lookup(builder->terms, builder->terms_size / TOKEN_INDEX_TERM_SIZE,
+                            token_hash(token), &offset, count)) {
+        return NULL;
+    }
+    uint32_t* rows = (uint32_t*)malloc((*count + 1) * sizeof(uint32_t));
+    assert(rows != NULL);
+    assert(token_index_decode(builder->postings, builder->postings_size, offset, *count,
+                              rows) == 0);
+    return rows;
+}
+
+static void test_builder(void) {
+    token_index_builder_t builder;
+    assert(token_index_builder_init(&builder) == 0);
+
+    // "even" on even rows, "rare" on every 1000th (gaps needing wide blocks),
+    // "user_<n>" on one row each (enough terms to grow the table)
+    const uint32_t count = 20000;
+    for (uint32_t row = 0; row < count; row++) {
+        char line[128];
+        snprintf(line, sizeof(line), "%s request user_%u done %s user_%u",
+                 row % 2 ? "odd" : "even", row, row % 1000 ? "" : "rare", row);
+        assert(token_index_add(&builder, row, line, strlen(line)) == 0);
+    }
+    assert(token_index_add(&builder, 5, "late", 4) == -1);
+    assert(token_index_finish(&builder) == 0);
+    assert(builder.terms_size / TOKEN_INDEX_TERM_SIZE == count + 5);
+
+    uint32_t found;
+    uint32_t* rows = builder_rows(&builder, "even", &found);
+    assert(rows && found == count / 2);
+    for (uint32_t i = 0; i < found; i++) {
+        assert(rows[i] == i * 2);
+    }
+    free(rows);
+
+    rows = builder_rows(&builder, "rare", &found);
+    assert(rows && found == count / 1000);
+    for (uint32_t i = 0; i < found; i++) {
+        assert(rows[i] == i * 1000);
+    }
+    free(rows);
+
+    // Repeated within a line: listed once
+    rows = builder_rows(&builder, "user_12345", &found);
+    assert(rows && found == 1 && rows[0] == 12345);
+    free(rows);
+    rows = builder_rows(&builder, "request", &found);
+    assert(rows && found == count && rows[count - 1] == count - 1);
+    free(rows);
+
+    assert(builder_rows(&builder, "missing", &found) == NULL);
+    assert(builder_rows(&builder, "Request", &found) == NULL);
+
+    // No false negatives, few false positives
+    assert(token_index_bloom_test(builder.bloom, builder.bloom_size, token_hash("user_0")));
+    assert(token_index_bloom_test(builder.bloom, builder.bloom_size, token_hash("odd")));
+    int positives = 0;
+    for (int i = 0; i < 10000; i++) {
+        char token[32];
+        snprintf(token, sizeof(token), "absent_%d", i);
+        positives += token_index_bloom_test(builder.bloom, builder.bloom_size, token_hash(token));
+    }
+    assert(positives < 300);
+
+    // A truncated section is corrupt
+    assert(token_index_decode(builder.postings, 3, 0, count, (uint32_t*)builder.terms) == -1);
+    token_index_builder_destroy(&builder);
+}
+
+static void test_helpers(void) {
+    uint64_t hashes[8];
+    assert(token_index_tokens("disk full, disk /dev/sda1", 25, hashes, 8) == 4);
+    assert(token_index_tokens(":: --", 5, hashes, 8) == 0);
+    assert(token_index_tokens("error 404 after 30 ms", 21, hashes, 8) == 3);
+    assert(token_index_tokens("order 1234567", 13, hashes, 8) == 2);
+    assert(token_index_tokens("a b c d", 7, hashes, 2) == 2);
+
+    uint32_t rows[] = {1, 3, 5, 7, 9, 11};
+    uint32_t other[] = {0, 3, 4, 9, 11, 12};
+    assert(token_index_intersect(rows, 6, other, 6) == 3);
+    assert(rows[0] == 3 && rows[1] == 9 && rows[2] == 11);
+    assert(token_index_intersect(rows, 3, other, 0) == 0);
+
+    const char* line = "ERROR disk_full on /dev/sda1: disk full";
+    size_t length = strlen(line);
+    assert(token_index_match(line, length, "disk full", 9));
+    assert(token_index_match(line, length, "ERROR", 5));
+    assert(token_index_match(line, length, "/dev/sda1:", 10));
+    assert(token_index_match(line, length, "sda1", 4));
+    assert(!token_index_match(line, length, "disk_", 5));
+    assert(token_index_match(line, length, "disk", 4));
+    assert(!token_index_match(line, length, "RROR", 4));
+    assert(!token_index_match(line, length, "full on /dev/sda", 16));
+    assert(!token_index_match(line, length, "", 0));
+    assert(!token_index_match("ab", 2, "abc", 3));
+}
+
+static void test_segment_search(void) {
+    const char* lines[] = {
+        "connection reset by peer",
+        "disk full on /var",
+        "connection refused",
+        "user alice logged in",
+        "disk full on /home",
+    };
+    segment_row_t rows[5];
+    for (int i = 0; i < 5; i++) {
+        rows[i].timestamp = BASE + i;
+        rows[i].source = "app.log";
+        rows[i].source_len = 7;
+        rows[i].line = lines[i];
+        rows[i].line_len = (uint32_t)strlen(lines[i]);
+        rows[i].level = LOG_LEVEL_INFO;
+    }
+    assert(segment_write(SEGMENT_PATH, 1, rows, 5, NULL) == 0);
+
+    segment_t segment;
+    assert(segment_open(&segment, SEGMENT_PATH) == 0);
+    assert(segment.bloom && segment.terms && segment.postings);
+
+    uint64_t hashes[TOKEN_INDEX_MAX_QUERY];
+    size_t num_hashes = token_index_tokens("disk full", 9, hashes, TOKEN_INDEX_MAX_QUERY);
+    assert(segment_may_contain(&segment, hashes, num_hashes));
+    uint32_t* found = NULL;
+    size_t num_found = 0;
+    assert(segment_find(&segment, hashes, num_hashes, &found, &num_found) == 0);
+    assert(num_found == 2 && found[0] == 1 && found[1] == 4);
+    free(found);
+
+    num_hashes = token_index_tokens("connection", 10, hashes, TOKEN_INDEX_MAX_QUERY);
+    assert(segment_find(&segment, hashes, num_hashes, &found, &num_found) == 0);
+    assert(num_found == 2 && found[0] == 0 && found[1] == 2);
+    free(found);
+
+    // A word in no line: the bloom filter usually rules it out, the terms always do
+    num_hashes = token_index_tokens("connection kernel", 17, hashes, TOKEN_INDEX_MAX_QUERY);
+    assert(segment_find(&segment, hashes, num_hashes, &found, &num_found) == 0);
+    assert(num_found == 0 && found == NULL);
+    segment_close(&segment);
+    remove(SEGMENT_PATH);
+}
+
+static bool collect(void* ctx, segment_t* segment, size_t row) {
+    int* matches = (int*)ctx;
+    size_t length;
+    const char* line = segment_line(segment, row, &length);
+    assert(line != NULL);
+    (*matches)++;
+    return *matches < 3;
+}
+
+static void test_store_search(void) {
+    remove_tree(DIR_NAME);
+    config_t config;
+    config_init_defaults(&config);
+    config.store_dir = strdup(DIR_NAME);
+
+    log_store_t store;
+    assert(log_store_init(&store, &config) == 0);
+    // Two segments (one per hour); only the first mentions "timeout"
+    for (int i = 0; i < 200; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "%s request %d", i < 100 && i % 10 == 0 ? "timeout" : "ok",
+                 i);
+        log_entry_t* entry = log_entry_create("app.log", line, LOG_LEVEL_INFO, line);
+        assert(entry != NULL);
+        entry->timestamp = BASE + (int64_t)i * 36 * SEC;
+        log_store_append(&store, entry);
+        log_entry_destroy(entry);
+    }
+    assert(log_store_flush(&store) == 0);
+    assert(log_store_segments(&store, NULL, 0) == 2);
+
+    uint64_t skipped = metrics_get(store.search_skipped);
+    uint64_t scanned = metrics_get(store.search_scanned);
+    int matches = 0;
+    assert(log_store_search(&store, "timeout request", 15, collect, &matches) == 3);
+    assert(matches == 3);
+    matches = -1000;
+    assert(log_store_search(&store, "timeout", 7, collect, &matches) == 10);
+    // Only the indexed candidates were read, and the second hour was skipped
+    assert(metrics_get(store.search_scanned) - scanned <= 20);
+    assert(metrics_get(store.search_skipped) - skipped >= 1);
+
+    matches = -1000;
+    assert(log_store_search(&store, "request 150", 11, collect, &matches) == 1);
+    assert(log_store_search(&store, "request 15", 10, collect, &matches) == 1);
+    assert(log_store_search(&store, "equest", 6, collect, &matches) == 0);
+
+    log_store_destroy(&store);
+    config_destroy(&config);
+    remove_tree(DIR_NAME);
+}
+
+void test_token_index(void) {
+    test_builder();
+    test_helpers();
+    test_segment_search();
+    test_store_search();
+}
\ No newline at end of file
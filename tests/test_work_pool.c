@@ -0,0 +1,107 @@
+#include "../include/work_pool.h"
+#include "../include/ingest.h"
+#include "../include/log_entry.h"
+#include "../include/metrics.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    size_t processed;
+    size_t slow_ns;
+} pool_counter_t;
+
+static void count_entry(void* ctx, log_entry_t* entry) {
+    pool_counter_t* counter = (pool_counter_t*)ctx;
+    if (counter->slow_ns > 0) {
+        struct timespec ts = {0, (long)counter->slow_ns};
+        nanosleep(&ts, NULL);
+    }
+    __atomic_add_fetch(&counter->processed, 1, __ATOMIC_RELAXED);
+    log_entry_destroy(entry);
+}
+
+static void wait_processed(pool_counter_t* counter, size_t expected) {
+    for (int i = 0; i < 1000 && __atomic_load_n(&counter->processed, __ATOMIC_RELAXED) < expected;
+         i++) {
+        struct timespec ts = {0, 5000000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void make_entries(log_entry_t** entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        entries[i] = log_entry_create("app.log", "message", LOG_LEVEL_ERROR, "[ERROR] message");
+        assert(entries[i] != NULL);
+    }
+}
+
+void test_work_pool(void) {
+    pool_counter_t counter = {0, 0};
+    work_pool_t pool;
+    log_entry_t* entries[200];
+
+    // Test round-robin submission: every entry is processed exactly once
+    assert(work_pool_init(&pool, 4, 0, count_entry, &counter) == 0);
+    assert(work_pool_start(&pool, 3) == 0);
+    for (int round = 0; round < 10; round++) {
+        make_entries(entries, 200);
+        assert(work_pool_submit(&pool, entries, 200, WORK_POOL_ANY) == 0);
+    }
+    wait_processed(&counter, 2000);
+    assert(counter.processed == 2000);
+    assert(work_pool_pending(&pool) == 0);
+    work_pool_stop(&pool);
+
+    // Submitting to a stopped pool destroys the entries
+    make_entries(entries, 3);
+    assert(work_pool_submit(&pool, entries, 3, WORK_POOL_ANY) == -1);
+    work_pool_destroy(&pool);
+
+    // Test stealing: all batches go to one worker, slow entries let the
+    // other workers steal
+    counter.processed = 0;
+    counter.slow_ns = 200000;
+    assert(work_pool_init(&pool, 3, 0, count_entry, &counter) == 0);
+    assert(work_pool_start(&pool, 3) == 0);
+    uint64_t steals_before = metrics_get(metrics_register("processor.worker1.steals", METRIC_COUNTER)) +
+                             metrics_get(metrics_register("processor.worker2.steals", METRIC_COUNTER));
+    make_entries(entries, 200);
+    assert(work_pool_submit(&pool, entries, 200, 7) == 0);
+    wait_processed(&counter, 200);
+    assert(counter.processed == 200);
+    uint64_t steals = metrics_get(metrics_register("processor.worker1.steals", METRIC_COUNTER)) +
+                      metrics_get(metrics_register("processor.worker2.steals", METRIC_COUNTER));
+    assert(steals > steals_before);
+    work_pool_destroy(&pool);
+
+    // Test backpressure with a small pending limit and the ingest adapter
+    counter.processed = 0;
+    counter.slow_ns = 10000;
+    assert(work_pool_init(&pool, 2, 64, count_entry, &counter) == 0);
+    assert(work_pool_start(&pool, 2) == 0);
+    for (int round = 0; round < 5; round++) {
+        make_entries(entries, 100);
+        assert(work_pool_submit(&pool, entries, 100, WORK_POOL_ANY) == 0);
+        assert(work_pool_pending(&pool) <= 100);
+    }
+    wait_processed(&counter, 500);
+    assert(counter.processed == 500);
+
+    // Entries still queued when the pool is destroyed are freed
+    work_pool_stop(&pool);
+    work_pool_destroy(&pool);
+
+    // Test the queue sink used in queue mode
+    log_queue_t queue;
+    ingest_t ingest;
+    assert(queue_init(&queue, 0) == 0);
+    ingest_init_queue(&ingest, &queue);
+    make_entries(entries, 5);
+    assert(ingest_submit(&ingest, entries, 5, ingest_affinity("app.log")) == 0);
+    assert(queue_size(&queue) == 5);
+    assert(ingest_affinity("network:10.0.0.1:4000") == ingest_affinity("network:10.0.0.1:4001"));
+    queue_destroy(&queue);
+}
\ No newline at end of file